@@ -5,6 +5,7 @@
 #include "modules.h"
 #include "beefile.h"
 #include <strings.h>
+#include <string.h>
 
 
 /*
@@ -1377,6 +1378,7 @@ sy6545_state;
 #define sy6545_LPEN_RESET_COUNTER_BUS(what)      DEREF_32BUS(what,0)
 #define sy6545_UPDATE_RESET_COUNTER_BUS(what)    DEREF_32BUS(what,1)
 #define sy6545_LPEN_CALL_MASK_BUS(what)          DEREF_32BUS(what,2)
+#define sy6545_FRAME_COUNTER_BUS(what)           DEREF_32BUS(what,3)
 
 #define sy6545_CHANGE_LEFT_MARGIN(what)          OUTFNCALL(what,0)
 #define sy6545_CHANGE_SCREEN_WIDTH(what)         OUTFNCALL(what,1)
@@ -1391,6 +1393,8 @@ sy6545_state;
 #define sy6545_FEEDBACK_INCER_CLOW(what)         OUTFNCALL(what,10)
 #define sy6545_FEEDRFSH_INCER(what)              OUTFNCALL(what,11)
 #define sy6545_FEEDRFSH_INCER_CLOW(what)         OUTFNCALL(what,12)
+#define sy6545_CATCH_UP(what)                    OUTFNCALL(what,13)
+#define sy6545_RESCHEDULE(what)                  OUTFNCALL(what,14)
 
 #define sy6545_FEEDBACK_INCER_dxfn(what)         DEREF_OUTFN(what,9)
 #define sy6545_FEEDBACK_INCER_dxfn_CLOW(what)    DEREF_OUTFN(what,10)
@@ -1465,7 +1469,7 @@ module_data *sy6545_alloc(const char *module_name)
 {
     module_data *what;
 
-    what = gen_module_data(module_name,1,1,0,0,1,0,11,22,3,10,13);
+    what = gen_module_data(module_name,1,1,0,0,1,0,11,22,4,10,15);
 
     sy6545_ASSUMED_ROMCHAR_HEIGHT(what) = 16;
 
@@ -1688,6 +1692,8 @@ Operation: Reset the internal state of the 6545 to power on defaults.
 
 void sy6545_reset(void *what)
 {
+    sy6545_CATCH_UP(what);
+
     #ifdef DEBUGMODE
     fprintf(stderr,"reset start\n");
     #endif
@@ -1788,6 +1794,8 @@ void sy6545_reset(void *what)
     fprintf(stderr,"fix cursor\n");
     #endif
 
+    sy6545_RESCHEDULE(what);
+
     return;
 }
 
@@ -1943,6 +1951,422 @@ char *sy6545_getinf(module_data *what)
 
 
 
+/*
+Function: sy6545_serialise(), sy6545_deserialise()
+Operation: Save and load the 6545 in a snapshot (see 6545.h).
+
+The body is the registers, the counters, bus and signal state, the lightpen
+state (with the refresh/random and clock high/low choice of feedback
+function saved as a number, SY6545_SNAP_SEL_*), then the VDU positions that
+differ from power on (address, char_num and colours for each) and the
+characters that aren't blank (char_num and lines for each).  Each list is
+ended by SY6545_SNAP_END in place of an address, so that the tables need
+only be gone through once.
+*/
+
+#define SY6545_SNAP_SEL_BACK      0
+#define SY6545_SNAP_SEL_RFSH      1
+#define SY6545_SNAP_SEL_BACK_CLOW 2
+#define SY6545_SNAP_SEL_RFSH_CLOW 3
+
+#define SY6545_SNAP_END           0x0ffffffff
+
+static int sy6545_snap_vdu_default(C6545_vdu_point *point)
+{
+    return ( ( point->char_num       == C6545_DEFAULT_CHAR  ) &&
+             ( point->fore_colour[0] == DEFAULT_FORE_COLOUR ) &&
+             ( point->back_colour[0] == DEFAULT_BACK_COLOUR ) &&
+             ( point->fore_colour[1] == DEFAULT_BACK_COLOUR ) &&
+             ( point->back_colour[1] == DEFAULT_FORE_COLOUR )    );
+}
+
+static int sy6545_snap_char_blank(C6545_char *chr)
+{
+    UINT_8 any;
+    int i;
+
+    /*
+       No early exit, so that this is a straight run of ORs.
+    */
+
+    any = 0;
+
+    for ( i = 0 ; i < C6545_MAX_CHR_HEIGHT ; i++ )
+    {
+        any |= (chr->lines)[i];
+    }
+
+    return ( any == 0 );
+}
+
+int sy6545_serialise(module_data *what, snap_data *snap)
+{
+    C6545_vdu_point *point;
+    UINT_32 i;
+    UINT_8 sel;
+
+    snap_put8(snap,RADDR(what));
+    snap_put8(snap,R0_(what));
+    snap_put8(snap,R1_(what));
+    snap_put8(snap,R2_(what));
+    snap_put8(snap,R3_(what));
+    snap_put8(snap,R3_H(what));
+    snap_put8(snap,R3_V(what));
+    snap_put8(snap,R4_(what));
+    snap_put8(snap,R5_(what));
+    snap_put8(snap,R6_(what));
+    snap_put8(snap,R7_(what));
+    snap_put8(snap,R8_(what));
+    snap_put8(snap,R8_ADM(what));
+    snap_put8(snap,R8_CSK(what));
+    snap_put8(snap,R9_(what));
+    snap_put8(snap,R10_BB(what));
+    snap_put8(snap,R10_CS(what));
+    snap_put8(snap,R11_(what));
+    snap_put16(snap,R12_13_(what));
+    snap_put8(snap,R12_RA(what));
+    snap_put8(snap,R13_CA(what));
+    snap_put16(snap,R14_15_(what));
+    snap_put8(snap,R14_RA(what));
+    snap_put8(snap,R15_CA(what));
+    snap_put16(snap,R16_17_(what));
+    snap_put8(snap,R16_RA(what));
+    snap_put8(snap,R17_CA(what));
+    snap_put16(snap,R18_19_(what));
+    snap_put8(snap,R18_RA(what));
+    snap_put8(snap,R19_CA(what));
+
+    snap_put16(snap,sy6545_HORIZ_CHAR_COUNT(what));
+    snap_put16(snap,sy6545_VERT_CHAR_COUNT(what));
+    snap_put16(snap,sy6545_VERT_SCAN_COUNT(what));
+    snap_put8(snap,sy6545_VERT_SYNC_COUNT(what));
+    snap_put8(snap,sy6545_FRAME_COUNT(what));
+
+    snap_put8(snap,sy6545_VBLANK(what));
+    snap_put8(snap,sy6545_HBLANK(what));
+    snap_put8(snap,sy6545_LPEN_REGISTER_FULL(what));
+    snap_put8(snap,sy6545_UPDATE_READY(what));
+
+    snap_put16(snap,sy6545_MA_BUS_NO_UPDATE(what));
+    snap_put16(snap,sy6545_MA_BUS_CLOW(what));
+    snap_put16(snap,sy6545_MA_BUS(what));
+    snap_put8(snap,sy6545_CR_BUS_CLOW(what));
+    snap_put8(snap,sy6545_CR_BUS(what));
+
+    snap_put8(snap,sy6545_IS_CURSOR(what));
+    snap_put8(snap,sy6545_IS_VSYNC(what));
+    snap_put8(snap,sy6545_IS_HSYNC(what));
+    snap_put8(snap,sy6545_DISPEN(what));
+    snap_put8(snap,sy6545_UPDATE_DISPEN_COUNT(what));
+    snap_put32(snap,sy6545_LINE_UP_MASK(what));
+
+    snap_put8(snap,sy6545_IS_LPEN_CLOW(what));
+    snap_put8(snap,sy6545_IS_LPEN(what));
+    snap_put8(snap,sy6545_PREVIOUS_LPEN_CLOW(what));
+    snap_put8(snap,sy6545_PREVIOUS_LPEN(what));
+    snap_put8(snap,sy6545_LATCH_LPEN(what));
+    snap_put16(snap,sy6545_LPEN_FEEDBACK_ADDR(what));
+    snap_put8(snap,sy6545_LPEN_FEEDBACK_ADDR_TYPE(what));
+    snap_put8(snap,sy6545_LPEN_FEEDBACK_ADDR_TYPE_CLW(what));
+
+    if      ( ( sy6545_FEEDx_INCER_dxfn_SEL(what) == sy6545_FEEDRFSH_INCER_dxfn(what)      ) && ( sy6545_LPEN_ADDR_BUS_SEL(what) == sy6545_LPEN_ADDR_BUS_RFSH(what)      ) ) { sel = SY6545_SNAP_SEL_RFSH;      }
+    else if ( ( sy6545_FEEDx_INCER_dxfn_SEL(what) == sy6545_FEEDBACK_INCER_dxfn_CLOW(what) ) && ( sy6545_LPEN_ADDR_BUS_SEL(what) == sy6545_LPEN_ADDR_BUS_BACK_CLOW(what) ) ) { sel = SY6545_SNAP_SEL_BACK_CLOW; }
+    else if ( ( sy6545_FEEDx_INCER_dxfn_SEL(what) == sy6545_FEEDRFSH_INCER_dxfn_CLOW(what) ) && ( sy6545_LPEN_ADDR_BUS_SEL(what) == sy6545_LPEN_ADDR_BUS_RFSH_CLOW(what) ) ) { sel = SY6545_SNAP_SEL_RFSH_CLOW; }
+    else                                                                                                                                                                     { sel = SY6545_SNAP_SEL_BACK;      }
+
+    snap_put8(snap,sel);
+
+    for ( i = 0 ; i < C6545_VDU_MEM_SIZE ; i++ )
+    {
+        point = &((sy6545_VDU_MEMORY(what))[i]);
+
+        if ( !sy6545_snap_vdu_default(point) )
+        {
+            snap_put32(snap,i);
+            snap_put16(snap,point->char_num);
+            snap_put8(snap,(point->fore_colour)[0]);
+            snap_put8(snap,(point->back_colour)[0]);
+            snap_put8(snap,(point->fore_colour)[1]);
+            snap_put8(snap,(point->back_colour)[1]);
+        }
+    }
+
+    snap_put32(snap,SY6545_SNAP_END);
+
+    for ( i = 0 ; i < C6545_CHAR_MEM_SIZE ; i++ )
+    {
+        if ( !sy6545_snap_char_blank(&((sy6545_CHAR_MEMORY(what))[i])) )
+        {
+            snap_put32(snap,i);
+            snap_put_data(snap,((sy6545_CHAR_MEMORY(what))[i]).lines,C6545_MAX_CHR_HEIGHT);
+        }
+    }
+
+    snap_put32(snap,SY6545_SNAP_END);
+
+    return snap->error;
+}
+
+int sy6545_deserialise(module_data *what, snap_data *snap)
+{
+    C6545_vdu_point *point;
+    C6545_char *chr;
+    UINT_32 i;
+
+    RADDR(what)   = snap_get8(snap);
+    R0_(what)     = snap_get8(snap);
+    R1_(what)     = snap_get8(snap);
+    R2_(what)     = snap_get8(snap);
+    R3_(what)     = snap_get8(snap);
+    R3_H(what)    = snap_get8(snap);
+    R3_V(what)    = snap_get8(snap);
+    R4_(what)     = snap_get8(snap);
+    R5_(what)     = snap_get8(snap);
+    R6_(what)     = snap_get8(snap);
+    R7_(what)     = snap_get8(snap);
+    R8_(what)     = snap_get8(snap);
+    R8_ADM(what)  = snap_get8(snap);
+    R8_CSK(what)  = snap_get8(snap);
+    R9_(what)     = snap_get8(snap);
+    R10_BB(what)  = snap_get8(snap);
+    R10_CS(what)  = snap_get8(snap);
+    R11_(what)    = snap_get8(snap);
+    R12_13_(what) = snap_get16(snap);
+    R12_RA(what)  = snap_get8(snap);
+    R13_CA(what)  = snap_get8(snap);
+    R14_15_(what) = snap_get16(snap);
+    R14_RA(what)  = snap_get8(snap);
+    R15_CA(what)  = snap_get8(snap);
+    R16_17_(what) = snap_get16(snap);
+    R16_RA(what)  = snap_get8(snap);
+    R17_CA(what)  = snap_get8(snap);
+    R18_19_(what) = snap_get16(snap);
+    R18_RA(what)  = snap_get8(snap);
+    R19_CA(what)  = snap_get8(snap);
+
+    sy6545_HORIZ_CHAR_COUNT(what) = snap_get16(snap);
+    sy6545_VERT_CHAR_COUNT(what)  = snap_get16(snap);
+    sy6545_VERT_SCAN_COUNT(what)  = snap_get16(snap);
+    sy6545_VERT_SYNC_COUNT(what)  = snap_get8(snap);
+    sy6545_FRAME_COUNT(what)      = snap_get8(snap);
+
+    sy6545_VBLANK(what)             = snap_get8(snap);
+    sy6545_HBLANK(what)             = snap_get8(snap);
+    sy6545_LPEN_REGISTER_FULL(what) = snap_get8(snap);
+    sy6545_UPDATE_READY(what)       = snap_get8(snap);
+
+    sy6545_MA_BUS_NO_UPDATE(what) = snap_get16(snap);
+    sy6545_MA_BUS_CLOW(what)      = snap_get16(snap);
+    sy6545_MA_BUS(what)           = snap_get16(snap);
+    sy6545_CR_BUS_CLOW(what)      = snap_get8(snap);
+    sy6545_CR_BUS(what)           = snap_get8(snap);
+
+    sy6545_IS_CURSOR(what)           = snap_get8(snap);
+    sy6545_IS_VSYNC(what)            = snap_get8(snap);
+    sy6545_IS_HSYNC(what)            = snap_get8(snap);
+    sy6545_DISPEN(what)              = snap_get8(snap);
+    sy6545_UPDATE_DISPEN_COUNT(what) = snap_get8(snap);
+    sy6545_LINE_UP_MASK(what)        = snap_get32(snap);
+
+    sy6545_IS_LPEN_CLOW(what)                = snap_get8(snap);
+    sy6545_IS_LPEN(what)                     = snap_get8(snap);
+    sy6545_PREVIOUS_LPEN_CLOW(what)          = snap_get8(snap);
+    sy6545_PREVIOUS_LPEN(what)               = snap_get8(snap);
+    sy6545_LATCH_LPEN(what)                  = snap_get8(snap);
+    sy6545_LPEN_FEEDBACK_ADDR(what)          = snap_get16(snap);
+    sy6545_LPEN_FEEDBACK_ADDR_TYPE(what)     = snap_get8(snap);
+    sy6545_LPEN_FEEDBACK_ADDR_TYPE_CLW(what) = snap_get8(snap);
+
+    switch ( snap_get8(snap) )
+    {
+        case SY6545_SNAP_SEL_RFSH:
+        {
+            sy6545_FEEDx_INCER_dxfn_SEL(what)   = sy6545_FEEDRFSH_INCER_dxfn(what);
+            sy6545_FEEDx_INCER_dxargs_SEL(what) = sy6545_FEEDRFSH_INCER_dxargs(what);
+            sy6545_LPEN_ADDR_BUS_SEL(what)      = sy6545_LPEN_ADDR_BUS_RFSH(what);
+
+            break;
+        }
+
+        case SY6545_SNAP_SEL_BACK_CLOW:
+        {
+            sy6545_FEEDx_INCER_dxfn_SEL(what)   = sy6545_FEEDBACK_INCER_dxfn_CLOW(what);
+            sy6545_FEEDx_INCER_dxargs_SEL(what) = sy6545_FEEDBACK_INCER_dxargs_CLOW(what);
+            sy6545_LPEN_ADDR_BUS_SEL(what)      = sy6545_LPEN_ADDR_BUS_BACK_CLOW(what);
+
+            break;
+        }
+
+        case SY6545_SNAP_SEL_RFSH_CLOW:
+        {
+            sy6545_FEEDx_INCER_dxfn_SEL(what)   = sy6545_FEEDRFSH_INCER_dxfn_CLOW(what);
+            sy6545_FEEDx_INCER_dxargs_SEL(what) = sy6545_FEEDRFSH_INCER_dxargs_CLOW(what);
+            sy6545_LPEN_ADDR_BUS_SEL(what)      = sy6545_LPEN_ADDR_BUS_RFSH_CLOW(what);
+
+            break;
+        }
+
+        default:
+        {
+            sy6545_FEEDx_INCER_dxfn_SEL(what)   = sy6545_FEEDBACK_INCER_dxfn(what);
+            sy6545_FEEDx_INCER_dxargs_SEL(what) = sy6545_FEEDBACK_INCER_dxargs(what);
+            sy6545_LPEN_ADDR_BUS_SEL(what)      = sy6545_LPEN_ADDR_BUS_BACK(what);
+
+            break;
+        }
+    }
+
+    /*
+       Back to power on, then fill in what was saved.
+    */
+
+    for ( i = 0 ; i < C6545_VDU_MEM_SIZE ; i++ )
+    {
+        point = &((sy6545_VDU_MEMORY(what))[i]);
+
+        point->char_num         = C6545_DEFAULT_CHAR;
+        (point->fore_colour)[0] = DEFAULT_FORE_COLOUR;
+        (point->back_colour)[0] = DEFAULT_BACK_COLOUR;
+        (point->fore_colour)[1] = DEFAULT_BACK_COLOUR;
+        (point->back_colour)[1] = DEFAULT_FORE_COLOUR;
+    }
+
+    while ( ( ( i = snap_get32(snap) ) != SY6545_SNAP_END ) && !(snap->error) )
+    {
+        point = &((sy6545_VDU_MEMORY(what))[i & ( C6545_VDU_MEM_SIZE - 1 )]);
+
+        point->char_num         = snap_get16(snap);
+        (point->fore_colour)[0] = snap_get8(snap);
+        (point->back_colour)[0] = snap_get8(snap);
+        (point->fore_colour)[1] = snap_get8(snap);
+        (point->back_colour)[1] = snap_get8(snap);
+    }
+
+    /*
+       Blank every character and empty every chain in one go (first_occur
+       is NULL when zeroed), then fill in the characters that were saved.
+    */
+
+    memset(sy6545_CHAR_MEMORY(what),0,C6545_CHAR_MEM_SIZE*sizeof(C6545_char));
+
+    while ( ( ( i = snap_get32(snap) ) != SY6545_SNAP_END ) && !(snap->error) )
+    {
+        snap_get_data(snap,((sy6545_CHAR_MEMORY(what))[i & ( C6545_CHAR_MEM_SIZE - 1 )]).lines,C6545_MAX_CHR_HEIGHT);
+    }
+
+    /*
+       Rebuild the character chains (backwards, so each chain comes out in
+       address order, as sy6545_init leaves it) and mark everything as
+       changed.
+    */
+
+    for ( i = C6545_VDU_MEM_SIZE ; i > 0 ; i-- )
+    {
+        point = &((sy6545_VDU_MEMORY(what))[i-1]);
+        chr   = &((sy6545_CHAR_MEMORY(what))[point->char_num]);
+
+        point->prev_same_char   = NULL;
+        point->next_same_char   = chr->first_occur;
+        point->line_change_mask = 0x0ffffffff;
+
+        if ( chr->first_occur != NULL )
+        {
+            (chr->first_occur)->prev_same_char = point;
+        }
+
+        chr->first_occur = point;
+    }
+
+    SET_C6545_LEFT_MARGIN(what);
+    SET_C6545_SCREEN_WIDTH(what);
+    SET_C6545_RIGHT_MARGIN(what);
+
+    SET_C6545_TOP_MARGIN(what);
+    SET_C6545_SCREEN_HEIGHT(what);
+    SET_C6545_BOTTOM_MARGIN(what);
+
+    sy6545_GEOMETRY_BUS_L(what) = sy6545_LEFT_MARGIN(what);  sy6545_CHANGE_LEFT_MARGIN(what);
+    sy6545_GEOMETRY_BUS_W(what) = sy6545_SCREEN_WIDTH(what); sy6545_CHANGE_SCREEN_WIDTH(what);
+    sy6545_GEOMETRY_BUS_R(what) = sy6545_RIGHT_MARGIN(what); sy6545_CHANGE_RIGHT_MARGIN(what);
+
+    sy6545_GEOMETRY_BUS_T(what) = sy6545_TOP_MARGIN(what);    sy6545_CHANGE_TOP_MARGIN(what);
+    sy6545_GEOMETRY_BUS_H(what) = sy6545_SCREEN_HEIGHT(what); sy6545_CHANGE_SCREEN_HEIGHT(what);
+    sy6545_GEOMETRY_BUS_B(what) = sy6545_BOTTOM_MARGIN(what); sy6545_CHANGE_BOTTOM_MARGIN(what);
+
+    sy6545_fix_coordspoint(what);
+
+    sy6545_REDRAW_BIT(what) |= 0x02;
+
+    return snap->error;
+}
+
+void sy6545_text_geometry(module_data *what, UINT_16 *start, UINT_8 *cols, UINT_8 *rows)
+{
+    *start = R12_13_(what);
+    *cols  = R1_(what);
+    *rows  = R6_(what);
+
+    return;
+}
+
+UINT_32 sy6545_horizon(module_data *what)
+{
+    UINT_32 line_cycles;
+    UINT_32 result;
+    UINT_32 lines;
+
+    /*
+       A lightpen latch or an update strobe under way can change the status
+       register on the very next cycle.
+    */
+
+    if ( sy6545_LATCH_LPEN(what) )
+    {
+        return 1;
+    }
+
+    if ( ( R8_(what) & 0x008 ) && ( !sy6545_UPDATE_READY(what) || sy6545_UPDATE_DISPEN_COUNT(what) ) )
+    {
+        return 1;
+    }
+
+    /*
+       Otherwise the status can only change (VBLANK) when the vertical
+       character counter does, which is at the end of the last scanline of
+       the current character row (or of the vertical adjust).  The counters
+       wrap exactly as in GENERIC_FINAL_PART.
+    */
+
+    line_cycles = ( (UINT_32) R0_(what) ) + 1;
+
+    if ( sy6545_HORIZ_CHAR_COUNT(what) > R0_(what) )
+    {
+        return 1;
+    }
+
+    result = line_cycles - sy6545_HORIZ_CHAR_COUNT(what);
+
+    if ( sy6545_VERT_CHAR_COUNT(what) <= R4_(what) )
+    {
+        lines = ( sy6545_VERT_SCAN_COUNT(what) < R9_(what) ) ? ( R9_(what) - sy6545_VERT_SCAN_COUNT(what) ) : 0;
+    }
+
+    else if ( ( sy6545_VERT_CHAR_COUNT(what) == R4_(what)+1 ) && ( sy6545_VERT_SCAN_COUNT(what)+1 < R5_(what) ) )
+    {
+        lines = R5_(what) - sy6545_VERT_SCAN_COUNT(what) - 1;
+    }
+
+    else
+    {
+        lines = 0;
+    }
+
+    return result + ( lines * line_cycles );
+}
+
+
+
+
 /*
 Function: sy6545_addr_wr(void)
 Operation: Write to the 6545 address register.
@@ -1950,6 +2374,8 @@ Operation: Write to the 6545 address register.
 
 void sy6545_addr_wr(void *what)
 {
+    sy6545_CATCH_UP(what);
+
     RADDR(what) = sy6545_COMMS_DATA_BUS_A(what) & 0x01F;
 
     return;
@@ -1965,6 +2391,8 @@ Operation: Read from the 6545 address register.
 
 void sy6545_addr_rd(void *what)
 {
+    sy6545_CATCH_UP(what);
+
     sy6545_COMMS_DATA_BUS_C(what) = sy6545_VBLANK(what) | sy6545_LPEN_REGISTER_FULL(what) | sy6545_UPDATE_READY(what);
 
     return;
@@ -1983,6 +2411,8 @@ void sy6545_data_wr(void *what)
 {
     UINT_8 i;
 
+    sy6545_CATCH_UP(what);
+
     switch ( RADDR(what) )
     {
         case 0x000:
@@ -2298,6 +2728,16 @@ void sy6545_data_wr(void *what)
         }
     }
 
+    /*
+       The frame timing (R0-R9) or an update strobe (R31) may have changed
+       when the status register will next change.
+    */
+
+    if ( ( RADDR(what) <= 0x009 ) || ( RADDR(what) == 0x01F ) )
+    {
+        sy6545_RESCHEDULE(what);
+    }
+
     return;
 }
 
@@ -2312,6 +2752,8 @@ Operation: Read from the 6545 data register.
 
 void sy6545_data_rd(void *what)
 {
+    sy6545_CATCH_UP(what);
+
     sy6545_COMMS_DATA_BUS_D(what) = 0;
 
     switch ( RADDR(what) )
@@ -2358,6 +2800,8 @@ void sy6545_data_rd(void *what)
 
             (sy6545_UPDATE_RESET_COUNTER_BUS(what))++;
 
+            sy6545_RESCHEDULE(what);
+
             break;
         }
 
@@ -2391,6 +2835,8 @@ void sy6545_write_char_mem(void *what)
 
     if ( sy6545_VIDEO_DATA_BUS_C(what) != (((sy6545_CHAR_MEMORY(what))[sy6545_VIDEO_MEM_ADDR_BUS_C(what)]).lines)[sy6545_VIDEO_CHAR_LINE_BUS(what)] )
     {
+        sy6545_CATCH_UP(what);
+
         sy6545_XPOS_BUS(what) = sy6545_VIDEO_MEM_ADDR_BUS_C(what);
         sy6545_YPOS_BUS(what) = sy6545_VIDEO_CHAR_LINE_BUS(what);
 
@@ -2437,6 +2883,8 @@ void sy6545_write_vdu_mem(void *what)
 
     if ( sy6545_VIDEO_DATA_BUS_V(what) != ((sy6545_VDU_MEMORY(what))[sy6545_VIDEO_MEM_ADDR_BUS_V(what)]).char_num )
     {
+        sy6545_CATCH_UP(what);
+
         sy6545_XPOS_BUS(what) = ((sy6545_VDU_MEMORY(what))[sy6545_VIDEO_MEM_ADDR_BUS_V(what)]).char_x_coord;
         sy6545_YPOS_BUS(what) = ((sy6545_VDU_MEMORY(what))[sy6545_VIDEO_MEM_ADDR_BUS_V(what)]).char_y_coord;
 
@@ -2557,6 +3005,8 @@ void sy6545_write_fore_colour(void *what)
 {
     if ( sy6545_VIDEO_DATA_BUS_FC(what) != (((sy6545_VDU_MEMORY(what))[sy6545_VIDEO_MEM_ADDR_BUS_FC(what)]).fore_colour)[0] )
     {
+        sy6545_CATCH_UP(what);
+
         sy6545_XPOS_BUS(what) = ((sy6545_VDU_MEMORY(what))[sy6545_VIDEO_MEM_ADDR_BUS_FC(what)]).char_x_coord;
         sy6545_YPOS_BUS(what) = ((sy6545_VDU_MEMORY(what))[sy6545_VIDEO_MEM_ADDR_BUS_FC(what)]).char_y_coord;
         (sy6545_COL_MAP(what))[sy6545_XPOS_BUS(what)][sy6545_YPOS_BUS(what)][0] = sy6545_VIDEO_DATA_BUS_FC(what);
@@ -2619,6 +3069,8 @@ void sy6545_write_back_colour(void *what)
 {
     if ( sy6545_VIDEO_DATA_BUS_BC(what) != (((sy6545_VDU_MEMORY(what))[sy6545_VIDEO_MEM_ADDR_BUS_BC(what)]).back_colour)[0] )
     {
+        sy6545_CATCH_UP(what);
+
         sy6545_XPOS_BUS(what) = ((sy6545_VDU_MEMORY(what))[sy6545_VIDEO_MEM_ADDR_BUS_BC(what)]).char_x_coord;
         sy6545_YPOS_BUS(what) = ((sy6545_VDU_MEMORY(what))[sy6545_VIDEO_MEM_ADDR_BUS_BC(what)]).char_y_coord;
         (sy6545_COL_MAP(what))[sy6545_XPOS_BUS(what)][sy6545_YPOS_BUS(what)][1] = sy6545_VIDEO_DATA_BUS_BC(what);
@@ -2884,6 +3336,11 @@ DMID_PART_DO_CYCLE: Ignoring the position on the screen, work out if the
             sy6545_VERT_SYNC_COUNT(what)++;                             \
             sy6545_IS_VSYNC(what) = 0x002;                              \
                                                                         \
+            if ( sy6545_VERT_SYNC_COUNT(what) == 1 )                    \
+            {                                                           \
+                sy6545_FRAME_COUNTER_BUS(what)++;                       \
+            }                                                           \
+                                                                        \
             if ( sy6545_VERT_SYNC_COUNT(what) > R3_V(what) )            \
             {                                                           \
                 sy6545_VERT_SYNC_COUNT(what) = 0;                       \
@@ -116,6 +116,8 @@ string variables: svar0 preloaded character ROM (leave "" if none).
                     this bit is zero then the lightpen will be read as zero.
                     Otherwise, the lightpen will be determined by lookup
                     of memory using outfn7 or outfn8.
+              busc3 frame counter bus - this bus will be incremented by
+                    the 6545 module at the start of each VSYNC.
 
 incoming functions: infn0 reset the 6545 state.
                     infn1 refresh (ie. redraw) the screen.  Usually the
@@ -194,11 +196,45 @@ outgoing functions: outfn0  change width of left margin to busb0 pixels.
                             element, and this occurs due to a targetted
                             refresh test (i.e. not random).  The address
                             leading to a strobe is placed on busb21.
+                    outfn13 called before anything the z80 does through
+                            infn0 and infn2-9 (a port access, or a write
+                            that changes video, colour or character
+                            memory), so that the 6545 can be clocked up
+                            to the point in the z80 run that the access
+                            happens at (see sy6545_horizon).
+                    outfn14 called after infn0, a write to R0-R9 or R31,
+                            or a read of R31, any of which can change when
+                            the status register will next change.
 
 Module is clocked.
 
+sy6545_horizon returns the number of 6545 clock cycles until the status
+register (VBLANK, lightpen register full and update ready) could next
+change by itself: 1 while a lightpen latch or an update strobe is under
+way, and otherwise the cycles to the end of the current character row,
+where VBLANK is set or cleared.  The lightpen can also be strobed on any
+cycle where the lightpen table (outfn7/8) is non-zero, which this doesn't
+know about, so the caller should allow for that itself.  Between one of
+these and outfn14 the 6545 only affects the rest of the machine through
+the screen, so it may be clocked late, in as many cycles at a time as
+wanted, as long as outfn13 brings it up to date first.
+
+sy6545_serialise/sy6545_deserialise save and load the crtc in a snapshot
+section (see modules.h), version SY6545_SNAP_VERSION: the registers, the
+counters and signals, the lightpen state and the internal copies of VDU,
+colour and character memory.  Only the VDU positions that differ from
+power on, and the characters that aren't blank, are saved, which keeps the
+section small.  Loading rebuilds the character chains and the screen maps,
+passes the geometry on through outfn0-5 and asks for a full redraw.
+
+sy6545_text_geometry gives the display start address (R12/R13), the
+characters per row (R1) and the rows displayed (R6), so that the screen
+text can be read straight out of VDU memory.
+
 */
 
+#define SY6545_SNAP_VERSION     1
+
 
 module_data *sy6545_alloc(const char *module_name);
 int          sy6545_init(module_data *what);
@@ -207,5 +243,9 @@ void         sy6545_stop(module_data *what);
 void         sy6545_remove(module_data *what);
 void         sy6545_cycle(module_data *what, UINT_16 num_cycles, UINT_8 clock_div, int lsync_point);
 char        *sy6545_getinf(module_data *what);
+int          sy6545_serialise(module_data *what, snap_data *snap);
+int          sy6545_deserialise(module_data *what, snap_data *snap);
+void         sy6545_text_geometry(module_data *what, UINT_16 *start, UINT_8 *cols, UINT_8 *rows);
+UINT_32      sy6545_horizon(module_data *what);
 
 #endif
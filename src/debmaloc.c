@@ -172,6 +172,49 @@ void deb_free(void *what, const char *mess, int line)
     return;
 }
 
+void deb_carve(void *what, int size)
+{
+    if ( ( what != NULL ) && ( num_malled > 0 ) && ( num_malled < MAX_MALL_BUFSIZE-1 ) )
+    {
+        malled_addr[num_malled] = what;
+        malled_size[num_malled] = size;
+
+        num_malled++;
+    }
+
+    return;
+}
+
+void deb_uncarve(void *what)
+{
+    int i,j;
+
+    if ( what != NULL )
+    {
+        j = -1;
+
+        for ( i = 0 ; i < num_malled ; i++ )
+        {
+            if ( malled_addr[i] == what )
+            {
+                j = i;
+            }
+        }
+
+        if ( j > -1 )
+        {
+            num_malled--;
+
+            for ( i = j ; i < num_malled ; i++ )
+            {
+                malled_addr[i] = malled_addr[i+1];
+                malled_size[i] = malled_size[i+1];
+            }
+        }
+    }
+
+    return;
+}
 
 void report_error(const char *mess, int line)
 {
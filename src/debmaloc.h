@@ -5,10 +5,20 @@
 #ifndef _debmaloc_h
 #define _debmaloc_h
 
+/*
+   DEBCARVE(what,size) tells the checker about an array that has been
+   carved out of a bigger DEBMALLOCed block, so that DEBDEREF will check
+   it like any other, and DEBUNCARVE(what) forgets it again (it must be
+   called before the block is freed).  Neither does anything unless
+   DEBUG_MALLOC is defined.
+*/
+
 #ifdef DEBUG_MALLOC
 #define DEBMALLOC(size)         deb_malloc((size),__FILE__,__LINE__)
 #define DEBDEREF(what,where)    (what)[(where) + deb_deref((what),(where),__FILE__,__LINE__)]
 #define DEBFREE(what)           deb_free((void *) (what),__FILE__,__LINE__)
+#define DEBCARVE(what,size)     deb_carve((void *) (what),(int) (size))
+#define DEBUNCARVE(what)        deb_uncarve((void *) (what))
 #define DEBASSERT(cond)         if ( !(cond) ) { report_error(__FILE__,__LINE__); }
 #endif
 
@@ -16,12 +26,16 @@
 #define DEBMALLOC(size)         malloc(size)
 #define DEBDEREF(what,where)    (what)[where]
 #define DEBFREE(what)           free(what)
+#define DEBCARVE(what,size)
+#define DEBUNCARVE(what)
 #define DEBASSERT(cond)
 #endif
 
 void *deb_malloc(int size, const char *mess, int line);
 int deb_deref(void *what, int where, const char *mess, int line);
 void deb_free(void *what, const char *mess, int line);
+void deb_carve(void *what, int size);
+void deb_uncarve(void *what);
 void report_error(const char *mess, int line);
 
 #endif
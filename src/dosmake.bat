@@ -1,9 +1,20 @@
+rem - z80 core: portable C core (z80core.c) by default.  To use the
+rem   original asm core instead, uncomment the nasm line and add
+rem   -DZ80_ASM_CORE to the z80cpu.c and z80core.c lines.
+rem - block translator: add -DZ80_JIT to the z80cpu.c, z80core.c and
+rem   z80jit.c lines (x86-64 gcc hosts only, ignored elsewhere).
+rem - opcode profiler: add -DZ80_PROFILE to the z80cpu.c, z80core.c and
+rem   mbee.c lines (writes z80ops.csv and z80mem.csv on exit).
+rem - instruction trace: add -DZ80_TRACE to the z80cpu.c, z80core.c and
+rem   mbee.c lines, and set cpu_trace_depth in mbee32k.ini.
 rem nasm -fcoff z80cpu.asm -o z80cpux.o
 
 rem - stuff to do here
 rem gcc -c -W -Wall -O3 6545.c              %1 %2
 rem gcc -c -W -Wall -O3 z80pio.c            %1 %2
 rem gcc -c -W -Wall -O3 z80cpu.c            %1 %2
+rem gcc -c -W -Wall -O3 z80core.c           %1 %2
+rem gcc -c -W -Wall -O3 z80jit.c            %1 %2
 rem gcc -c -W -Wall -O3 genmod.c            %1 %2
 rem gcc -c -W -Wall -O3 interf.c -DIS_DJGPP %1 %2
 
@@ -11,9 +22,21 @@ rem gcc -c -W -Wall -O3 modules.c           %1 %2
 rem gcc -c -W -Wall -O3 configer.c          %1 %2
 rem gcc -c -W -Wall -O3 debmaloc.c          %1 %2
 rem gcc -c -W -Wall -O3 beefile.c           %1 %2
+rem gcc -c -W -Wall -O3 machine.c           %1 %2
 
 gcc -W -Wall -O3 %1 %2 -DIS_DJGPP mbee.c *.o -o mbee.exe -lalleg
 rem gcc -W -Wall -O3 %1 %2 -DIS_DJGPP -DDEBUGMODE mbee.c *.o -o mbee.exe -lalleg
 rem gcc -W -Wall -O3 %1 %2 -DIS_DJGPP -DDEBUG_MALLOC mbee.c *.o -o mbee.exe -lalleg
 rem gcc -W -Wall -O3 %1 %2 -DIS_DJGPP -DDEBUGMODE -DDEBUG_MALLOC mbee.c *.o -o mbee.exe -lalleg
 
+rem - core throughput benchmark (needs the objects above)
+rem gcc -W -Wall -O3 %1 %2 z80bench.c z80cpu.o z80core.o z80jit.o modules.o debmaloc.o -o z80bench.exe
+rem - or, to run -instances on threads of their own (needs pthreads)
+rem gcc -W -Wall -O3 %1 %2 -DZ80BENCH_THREADS z80bench.c z80cpu.o z80core.o z80jit.o modules.o debmaloc.o -o z80bench.exe -lpthread
+
+rem - trace decoder (stands alone)
+rem gcc -W -Wall -O3 %1 %2 z80trace.c -o z80trace.exe
+
+rem - ZEXDOC/ZEXALL conformance runner (needs the objects above)
+rem gcc -W -Wall -O3 %1 %2 z80zex.c z80cpu.o z80core.o z80jit.o genmod.o beefile.o modules.o debmaloc.o -o z80zex.exe
+
@@ -5,6 +5,7 @@
 #include "modules.h"
 #include "beefile.h"
 #include <stdlib.h>
+#include <string.h>
 #include <strings.h>
 
 
@@ -577,6 +578,8 @@ Functional module 1: bus
 #define BUSMOD_BUS_16BIT(what)  DEREF_16MEM(what,0)
 #define BUSMOD_BUS_32BIT(what)  DEREF_32MEM(what,0)
 
+#define BUSMOD_STORE(what)      ((busmod_store *) DEREF_INTERNAL(what))
+
 void busmod_reset(void *what);
 
 void busmod_inc8(void *what);
@@ -932,9 +935,14 @@ module_data *busmod_alloc(const char *module_name)
 
 int busmod_init(module_data *what)
 {
-    if ( ( BUSMOD_BUS_8BIT(what)  = (UINT_8 *)  DEBMALLOC(sizeof(UINT_8))  ) == NULL ) { return 1; }
-    if ( ( BUSMOD_BUS_16BIT(what) = (UINT_16 *) DEBMALLOC(sizeof(UINT_16)) ) == NULL ) { return 1; }
-    if ( ( BUSMOD_BUS_32BIT(what) = (UINT_32 *) DEBMALLOC(sizeof(UINT_32)) ) == NULL ) { return 1; }
+    if ( ( DEREF_INTERNAL(what) = (void *) DEBMALLOC(sizeof(busmod_store)) ) == NULL )
+    {
+        return 1;
+    }
+
+    BUSMOD_BUS_8BIT(what)  = &(BUSMOD_STORE(what)->bus_8bit);
+    BUSMOD_BUS_16BIT(what) = &(BUSMOD_STORE(what)->bus_16bit);
+    BUSMOD_BUS_32BIT(what) = &(BUSMOD_STORE(what)->bus_32bit);
 
     DEREF_INFN(what,0x000) = busmod_preset00;
     DEREF_INFN(what,0x001) = busmod_preset01;
@@ -1294,22 +1302,38 @@ void busmod_remove(module_data *what)
 {
     if ( what != NULL )
     {
-        if ( BUSMOD_BUS_8BIT(what) != NULL )
+        if ( DEREF_INTERNAL(what) != NULL )
         {
-            DEBFREE(BUSMOD_BUS_8BIT(what));
+            DEBFREE(DEREF_INTERNAL(what));
         }
 
-        if ( BUSMOD_BUS_16BIT(what) != NULL )
-        {
-            DEBFREE(BUSMOD_BUS_16BIT(what));
-        }
+        free_module_data(what);
+    }
 
-        if ( BUSMOD_BUS_32BIT(what) != NULL )
-        {
-            DEBFREE(BUSMOD_BUS_32BIT(what));
-        }
+    return;
+}
 
-        free_module_data(what);
+/*
+   Move the buses into *dest (see genmod.h).  Once moved, the buses
+   belong to whoever owns dest, so busmod_remove leaves them alone.
+*/
+
+void busmod_relocate(module_data *what, busmod_store *dest)
+{
+    dest->bus_8bit  = *BUSMOD_BUS_8BIT(what);
+    dest->bus_16bit = *BUSMOD_BUS_16BIT(what);
+    dest->bus_32bit = *BUSMOD_BUS_32BIT(what);
+    dest->unused    = 0;
+
+    BUSMOD_BUS_8BIT(what)  = &(dest->bus_8bit);
+    BUSMOD_BUS_16BIT(what) = &(dest->bus_16bit);
+    BUSMOD_BUS_32BIT(what) = &(dest->bus_32bit);
+
+    if ( DEREF_INTERNAL(what) != NULL )
+    {
+        DEBFREE(DEREF_INTERNAL(what));
+
+        DEREF_INTERNAL(what) = NULL;
     }
 
     return;
@@ -1339,6 +1363,24 @@ char *busmod_getinf(module_data *what)
     what = NULL;
 }
 
+int busmod_serialise(module_data *what, snap_data *snap)
+{
+    snap_put8(snap,*BUSMOD_BUS_8BIT(what));
+    snap_put16(snap,*BUSMOD_BUS_16BIT(what));
+    snap_put32(snap,*BUSMOD_BUS_32BIT(what));
+
+    return snap->error;
+}
+
+int busmod_deserialise(module_data *what, snap_data *snap)
+{
+    *BUSMOD_BUS_8BIT(what)  = snap_get8(snap);
+    *BUSMOD_BUS_16BIT(what) = snap_get16(snap);
+    *BUSMOD_BUS_32BIT(what) = snap_get32(snap);
+
+    return snap->error;
+}
+
 void busmod_reset(void *what)
 {
     if ( BUSMOD_8RESTYPE(what) == 1 )
@@ -2239,7 +2281,7 @@ memmod_state;
 #define MEMMOD_MASK_32(what)    (((memmod_state *) DEREF_INTERNAL(what))->alias_32)
 
 #define MEMMOD_MEMCONTENT(what) DEREF_8MEM(what,2)
-#define MEMMOD_MEMCON(what,i)   DEREF_8MEM(what,2+i)
+#define MEMMOD_MEMMASK(what)    DEREF_32MEM(what,1)
 
 #define MEMMOD_ROMNAME(what)    DEREF_STRGVAR(what,0)
 
@@ -2286,7 +2328,7 @@ int memmod_init(module_data *what)
     UINT_64 i;
     PC_FILE *fp;
 
-    if ( ( what = gen_module_data_nonvaronly(what,0,2+((UINT_64) MEMMOD_RAWSIZE(what)),1,1,13,0) ) != NULL )
+    if ( ( what = gen_module_data_nonvaronly(what,0,3,1,2,13,0) ) != NULL )
     {
         DEREF_INFN(what,0)  = memmod_reset;
         DEREF_INFN(what,1)  = memmod_and_write8;
@@ -2340,13 +2382,17 @@ int memmod_init(module_data *what)
             MEMMOD_MASK_16(what) = (UINT_16) (MEMMOD_RAWSIZE(what) & MEMMOD_RAWMASK(what) & 0x00000ffff);
             MEMMOD_MASK_32(what) = (UINT_32) (MEMMOD_RAWSIZE(what) & MEMMOD_RAWMASK(what) & 0x0ffffffff);
 
+            /*
+               The memory is exported as a base pointer and a mask only.
+               Anything wanting to get at the contents directly (the CPU
+               page tables, say) works out where address n is as
+               busa2[n & busc1].
+            */
+
+            MEMMOD_MEMMASK(what) = &MEMMOD_MASK_32(what);
+
             if ( ( MEMMOD_MEMCONTENT(what) = (UINT_8 *) DEBMALLOC(((((UINT_64) MEMMOD_RAWSIZE(what))+0x10))*sizeof(UINT_8)) ) != NULL )
             {
-                for ( i = 0 ; i < MEMMOD_RAWSIZE(what) ; i++ )
-                {
-                    MEMMOD_MEMCON(what,i) = &(DEBDEREF((MEMMOD_MEMCONTENT(what)),i));
-                }
-
                 /*
                    Test to see if ROM
                 */
@@ -2488,6 +2534,117 @@ char *memmod_getinf(module_data *what)
     return dest;
 }
 
+/*
+   Snapshot body: block number, size, whether the contents follow and (if
+   so) the contents.
+*/
+
+int memmod_serialise(module_data *what, snap_data *snap)
+{
+    UINT_32 size = MEMMOD_RAWSIZE(what)+1;
+
+    snap_put32(snap,snap_add_block(snap,MEMMOD_MEMCONTENT(what),size));
+    snap_put32(snap,size);
+
+    if ( strlen(MEMMOD_ROMNAME(what)) > 0 )
+    {
+        snap_put8(snap,0);
+    }
+
+    else
+    {
+        snap_put8(snap,1);
+        snap_put_data(snap,MEMMOD_MEMCONTENT(what),size);
+    }
+
+    return snap->error;
+}
+
+int memmod_deserialise(module_data *what, snap_data *snap)
+{
+    UINT_32 size = MEMMOD_RAWSIZE(what)+1;
+    UINT_32 num;
+
+    num = snap_get32(snap);
+
+    if ( snap_get32(snap) != size )
+    {
+        snap->error = 1;
+
+        return 1;
+    }
+
+    snap_set_block(snap,num,MEMMOD_MEMCONTENT(what),size);
+
+    if ( snap_get8(snap) && ( strlen(MEMMOD_ROMNAME(what)) == 0 ) )
+    {
+        snap_get_data(snap,MEMMOD_MEMCONTENT(what),size);
+    }
+
+    return snap->error;
+}
+
+/*
+   ROM snapshot body: block number, size and a checksum of the contents
+   (32 bit FNV-1a, masked as UINT_32 may be wider).
+*/
+
+static UINT_32 memmod_rom_checksum(module_data *what)
+{
+    UINT_32 size = MEMMOD_RAWSIZE(what)+1;
+    UINT_32 sum = 0x811C9DC5;
+    UINT_32 i;
+
+    for ( i = 0 ; i < size ; i++ )
+    {
+        sum = ( ( sum ^ DEBDEREF(MEMMOD_MEMCONTENT(what),i) ) * 0x01000193 ) & 0xFFFFFFFF;
+    }
+
+    return sum;
+}
+
+int memmod_rom_serialise(module_data *what, snap_data *snap)
+{
+    UINT_32 size = MEMMOD_RAWSIZE(what)+1;
+
+    snap_put32(snap,snap_add_block(snap,MEMMOD_MEMCONTENT(what),size));
+    snap_put32(snap,size);
+    snap_put32(snap,memmod_rom_checksum(what));
+
+    return snap->error;
+}
+
+int memmod_rom_deserialise(module_data *what, snap_data *snap)
+{
+    UINT_32 size = MEMMOD_RAWSIZE(what)+1;
+    UINT_32 num;
+
+    num = snap_get32(snap);
+
+    if ( snap_get32(snap) != size )
+    {
+        snap->error = 1;
+
+        return 1;
+    }
+
+    snap_set_block(snap,num,MEMMOD_MEMCONTENT(what),size);
+
+    /*
+       Older snapshots (MEMMOD_SNAP_VERSION) hold the contents instead, or
+       nothing for a ROM loaded from a file, and are taken as they are.
+    */
+
+    if ( ( snap->sect_version >= MEMMOD_ROM_SNAP_VERSION ) && ( snap_get32(snap) != memmod_rom_checksum(what) ) )
+    {
+        snap->error = 1;
+
+        return 1;
+    }
+
+    return snap->error;
+}
+
 void memmod_reset(void *what)
 {
     UINT_64 i;
@@ -2510,14 +2667,7 @@ void memmod_reset(void *what)
 
         case 2:
         {
-            for ( i = 0 ; i < MEMMOD_RAWSIZE(what) ; i++ )
-            {
-                DEBDEREF(MEMMOD_MEMCONTENT(what),i) = MEMMOD_RESET_VAL(what);
-            }
-
-            {
-                DEBDEREF(MEMMOD_MEMCONTENT(what),i) = MEMMOD_RESET_VAL(what);
-            }
+            memset(MEMMOD_MEMCONTENT(what),MEMMOD_RESET_VAL(what),(size_t) (((UINT_64) MEMMOD_RAWSIZE(what))+1));
 
             break;
         }
@@ -9068,3 +9218,658 @@ void slconstbmod_32(void *what)
 }
 
 
+/**********************************************************************
+
+Netlist compiler
+
+**********************************************************************/
+
+#define GENMOD_NET_MAX_NODES    1024
+#define GENMOD_NET_MAX_DEPTH    32
+#define GENMOD_NET_MESSAGE_SIZE 256
+
+#define GENMOD_NET_CALL         0
+#define GENMOD_NET_JUMP         1
+#define GENMOD_NET_END          2
+#define GENMOD_NET_NZ8          3
+#define GENMOD_NET_NZ16         4
+#define GENMOD_NET_NZ32         5
+#define GENMOD_NET_EQ8          6
+#define GENMOD_NET_EQ16         7
+#define GENMOD_NET_EQ32         8
+#define GENMOD_NET_GT8          9
+#define GENMOD_NET_GT16         10
+#define GENMOD_NET_GT32         11
+#define GENMOD_NET_LT8          12
+#define GENMOD_NET_LT16         13
+#define GENMOD_NET_LT32         14
+
+#define GENMOD_NET_RIGHT_NONE   0
+#define GENMOD_NET_RIGHT_BUS    1
+#define GENMOD_NET_RIGHT_VAR    2
+
+/*
+   A program is a list of nodes run by genmod_net_run.  CALL calls fn(arg)
+   and moves on; the tests (NZ/EQ/GT/LT) compare *left with *right (or
+   *left with 0) and move on if true, otherwise go to node jump; JUMP
+   goes to node jump; END returns.
+*/
+
+typedef struct
+{
+    UINT_8                    op;
+    UINT_32                   jump;
+    weird_pointer_jive_wargs  fn;
+    void                     *arg;
+    VOLATILITY void          *left;
+    VOLATILITY void          *right;
+}
+genmod_net_node;
+
+typedef struct Genmod_Net_Prog
+{
+    weird_pointer_jive_wargs  fn;
+    void                     *arg;
+    genmod_net_node          *node;
+    UINT_32                   num_node;
+    UINT_32                   size_node;
+    struct Genmod_Net_Prog   *next;
+}
+genmod_net_prog;
+
+typedef struct
+{
+    module_data              *mod;
+    UINT_64                   num;
+    weird_pointer_jive_wargs  fn;
+    void                     *arg;
+    genmod_net_prog          *prog;
+}
+genmod_net_slot;
+
+struct Genmod_Net
+{
+    genmod_net_prog *prog;
+    genmod_net_slot *slot;
+    UINT_32          num_slot;
+    UINT_32          size_slot;
+    UINT_32          num_prog;
+    UINT_32          num_node;
+    UINT_32          num_direct;
+    UINT_32          num_folded;
+};
+
+/*
+   Two-way branch modules: the test used, the outfn called if it is true
+   (the next one is called if it is false) and where the right hand side
+   of the test comes from.
+*/
+
+typedef struct
+{
+    weird_pointer_jive_wargs fn;
+    UINT_8                   op;
+    UINT_8                   outfn;
+    UINT_8                   right;
+}
+genmod_net_branch;
+
+void global_nothingfn(void *what);
+
+static const genmod_net_branch genmod_net_branches[] = { { istruemod_branch8,        GENMOD_NET_NZ8,  0, GENMOD_NET_RIGHT_NONE },
+                                                         { istruemod_branch16,       GENMOD_NET_NZ16, 2, GENMOD_NET_RIGHT_NONE },
+                                                         { istruemod_branch32,       GENMOD_NET_NZ32, 4, GENMOD_NET_RIGHT_NONE },
+                                                         { equalsmod_branch8,        GENMOD_NET_EQ8,  0, GENMOD_NET_RIGHT_BUS  },
+                                                         { equalsmod_branch16,       GENMOD_NET_EQ16, 2, GENMOD_NET_RIGHT_BUS  },
+                                                         { equalsmod_branch32,       GENMOD_NET_EQ32, 4, GENMOD_NET_RIGHT_BUS  },
+                                                         { greatermod_branch8,       GENMOD_NET_GT8,  0, GENMOD_NET_RIGHT_BUS  },
+                                                         { greatermod_branch16,      GENMOD_NET_GT16, 2, GENMOD_NET_RIGHT_BUS  },
+                                                         { greatermod_branch32,      GENMOD_NET_GT32, 4, GENMOD_NET_RIGHT_BUS  },
+                                                         { lessmod_branch8,          GENMOD_NET_LT8,  0, GENMOD_NET_RIGHT_BUS  },
+                                                         { lessmod_branch16,         GENMOD_NET_LT16, 2, GENMOD_NET_RIGHT_BUS  },
+                                                         { lessmod_branch32,         GENMOD_NET_LT32, 4, GENMOD_NET_RIGHT_BUS  },
+                                                         { equalsconstmod_branch8,   GENMOD_NET_EQ8,  0, GENMOD_NET_RIGHT_VAR  },
+                                                         { equalsconstmod_branch16,  GENMOD_NET_EQ16, 2, GENMOD_NET_RIGHT_VAR  },
+                                                         { equalsconstmod_branch32,  GENMOD_NET_EQ32, 4, GENMOD_NET_RIGHT_VAR  },
+                                                         { greaterconstmod_branch8,  GENMOD_NET_GT8,  0, GENMOD_NET_RIGHT_VAR  },
+                                                         { greaterconstmod_branch16, GENMOD_NET_GT16, 2, GENMOD_NET_RIGHT_VAR  },
+                                                         { greaterconstmod_branch32, GENMOD_NET_GT32, 4, GENMOD_NET_RIGHT_VAR  },
+                                                         { lessconstmod_branch8,     GENMOD_NET_LT8,  0, GENMOD_NET_RIGHT_VAR  },
+                                                         { lessconstmod_branch16,    GENMOD_NET_LT16, 2, GENMOD_NET_RIGHT_VAR  },
+                                                         { lessconstmod_branch32,    GENMOD_NET_LT32, 4, GENMOD_NET_RIGHT_VAR  },
+                                                         { NULL,                     0,               0, 0                     } };
+
+static const genmod_net_branch *genmod_net_find_branch(weird_pointer_jive_wargs fn)
+{
+    const genmod_net_branch *branch;
+
+    for ( branch = genmod_net_branches ; branch->fn != NULL ; branch++ )
+    {
+        if ( branch->fn == fn )
+        {
+            return branch;
+        }
+    }
+
+    return NULL;
+}
+
+static int genmod_net_foldable(weird_pointer_jive_wargs fn)
+{
+    if ( ( fn == domod_branch        ) ||
+         ( fn == dowhilemod_branch8  ) ||
+         ( fn == dowhilemod_branch16 ) ||
+         ( fn == dowhilemod_branch32 ) )
+    {
+        return 1;
+    }
+
+    return ( genmod_net_find_branch(fn) != NULL );
+}
+
+/*
+   Add a node to the end of a program, returning nonzero if it's full.
+*/
+
+static int genmod_net_add(genmod_net_prog *prog, UINT_8 op, weird_pointer_jive_wargs fn, void *arg)
+{
+    genmod_net_node *node;
+
+    if ( prog->num_node >= prog->size_node )
+    {
+        if ( prog->size_node >= GENMOD_NET_MAX_NODES )
+        {
+            return 1;
+        }
+
+        if ( ( node = (genmod_net_node *) DEBMALLOC(2*(prog->size_node)*sizeof(genmod_net_node)) ) == NULL )
+        {
+            return 1;
+        }
+
+        memcpy(node,prog->node,(prog->num_node)*sizeof(genmod_net_node));
+
+        DEBFREE(prog->node);
+
+        prog->node       = node;
+        prog->size_node *= 2;
+    }
+
+    node = &((prog->node)[prog->num_node]);
+
+    node->op    = op;
+    node->jump  = 0;
+    node->fn    = fn;
+    node->arg   = arg;
+    node->left  = NULL;
+    node->right = NULL;
+
+    (prog->num_node)++;
+
+    return 0;
+}
+
+/*
+   Append what fn(arg) does to a program.  do, dowhile and branch modules
+   are folded in (reading their outfns as they are wired now), anything
+   else is called.  Past GENMOD_NET_MAX_DEPTH the structural modules are
+   just called, which also stops loops in the wiring.
+*/
+
+static int genmod_net_emit(genmod_net *net, genmod_net_prog *prog, weird_pointer_jive_wargs fn, void *arg, int depth)
+{
+    const genmod_net_branch *branch;
+    UINT_64 i;
+    UINT_32 loop;
+    UINT_32 test;
+    UINT_32 jump;
+    int size;
+
+    if ( ( fn == global_nothingfn ) || ( fn == nullmod_nothing ) )
+    {
+        return 0;
+    }
+
+    if ( depth >= GENMOD_NET_MAX_DEPTH )
+    {
+        return genmod_net_add(prog,GENMOD_NET_CALL,fn,arg);
+    }
+
+    if ( fn == domod_branch )
+    {
+        (net->num_folded)++;
+
+        for ( i = 0 ; i < DOMOD_NUMFNS(arg) ; i++ )
+        {
+            if ( genmod_net_emit(net,prog,DEREF_OUTFN(arg,i),DEREF_OUTARGS(arg,i),depth+1) )
+            {
+                return 1;
+            }
+        }
+
+        return 0;
+    }
+
+    if ( ( fn == dowhilemod_branch8 ) || ( fn == dowhilemod_branch16 ) || ( fn == dowhilemod_branch32 ) )
+    {
+        (net->num_folded)++;
+
+        if ( DOWHILEMOD_NUMFNS(arg) == 0 )
+        {
+            return 0;
+        }
+
+        loop = prog->num_node;
+
+        for ( i = 0 ; i < DOWHILEMOD_NUMFNS(arg) ; i++ )
+        {
+            if ( genmod_net_emit(net,prog,DEREF_OUTFN(arg,i),DEREF_OUTARGS(arg,i),depth+1) )
+            {
+                return 1;
+            }
+        }
+
+        test = prog->num_node;
+
+        if ( fn == dowhilemod_branch8 )
+        {
+            if ( genmod_net_add(prog,GENMOD_NET_NZ8,NULL,NULL) ) { return 1; }
+
+            (prog->node)[test].left = DEREF_8MEM(arg,0);
+        }
+
+        else if ( fn == dowhilemod_branch16 )
+        {
+            if ( genmod_net_add(prog,GENMOD_NET_NZ16,NULL,NULL) ) { return 1; }
+
+            (prog->node)[test].left = DEREF_16MEM(arg,0);
+        }
+
+        else
+        {
+            if ( genmod_net_add(prog,GENMOD_NET_NZ32,NULL,NULL) ) { return 1; }
+
+            (prog->node)[test].left = DEREF_32MEM(arg,0);
+        }
+
+        if ( genmod_net_add(prog,GENMOD_NET_JUMP,NULL,NULL) )
+        {
+            return 1;
+        }
+
+        (prog->node)[test+1].jump = loop;
+        (prog->node)[test].jump   = prog->num_node;
+
+        return 0;
+    }
+
+    if ( ( branch = genmod_net_find_branch(fn) ) == NULL )
+    {
+        return genmod_net_add(prog,GENMOD_NET_CALL,fn,arg);
+    }
+
+    (net->num_folded)++;
+
+    /*
+       A branch with the same thing wired to both outfns is constant.
+    */
+
+    if ( ( DEREF_OUTFN(arg,branch->outfn)   == DEREF_OUTFN(arg,branch->outfn+1)   ) &&
+         ( DEREF_OUTARGS(arg,branch->outfn) == DEREF_OUTARGS(arg,branch->outfn+1) )    )
+    {
+        return genmod_net_emit(net,prog,DEREF_OUTFN(arg,branch->outfn),DEREF_OUTARGS(arg,branch->outfn),depth+1);
+    }
+
+    test = prog->num_node;
+    size = ( branch->op - GENMOD_NET_NZ8 ) % 3;
+
+    if ( genmod_net_add(prog,branch->op,NULL,NULL) )
+    {
+        return 1;
+    }
+
+    switch ( size )
+    {
+        case 0:
+        {
+            (prog->node)[test].left  = DEREF_8MEM(arg,0);
+            (prog->node)[test].right = ( branch->right == GENMOD_NET_RIGHT_BUS ) ? (VOLATILITY void *) DEREF_8MEM(arg,1) : (VOLATILITY void *) &DEREF_8VAR(arg,0);
+
+            break;
+        }
+
+        case 1:
+        {
+            (prog->node)[test].left  = DEREF_16MEM(arg,0);
+            (prog->node)[test].right = ( branch->right == GENMOD_NET_RIGHT_BUS ) ? (VOLATILITY void *) DEREF_16MEM(arg,1) : (VOLATILITY void *) &DEREF_16VAR(arg,0);
+
+            break;
+        }
+
+        default:
+        {
+            (prog->node)[test].left  = DEREF_32MEM(arg,0);
+            (prog->node)[test].right = ( branch->right == GENMOD_NET_RIGHT_BUS ) ? (VOLATILITY void *) DEREF_32MEM(arg,1) : (VOLATILITY void *) &DEREF_32VAR(arg,0);
+
+            break;
+        }
+    }
+
+    if ( branch->right == GENMOD_NET_RIGHT_NONE )
+    {
+        (prog->node)[test].right = NULL;
+    }
+
+    if ( genmod_net_emit(net,prog,DEREF_OUTFN(arg,branch->outfn),DEREF_OUTARGS(arg,branch->outfn),depth+1) )
+    {
+        return 1;
+    }
+
+    jump = prog->num_node;
+
+    if ( genmod_net_add(prog,GENMOD_NET_JUMP,NULL,NULL) )
+    {
+        return 1;
+    }
+
+    if ( genmod_net_emit(net,prog,DEREF_OUTFN(arg,branch->outfn+1),DEREF_OUTARGS(arg,branch->outfn+1),depth+1) )
+    {
+        return 1;
+    }
+
+    /*
+       Drop the jump if the false side does nothing, and the test as well
+       if neither side does (reading a bus has no side effects).
+    */
+
+    if ( prog->num_node == jump+1 )
+    {
+        prog->num_node = jump;
+
+        (prog->node)[test].jump = jump;
+
+        if ( jump == test+1 )
+        {
+            prog->num_node = test;
+        }
+    }
+
+    else
+    {
+        (prog->node)[jump].jump = prog->num_node;
+        (prog->node)[test].jump = jump+1;
+    }
+
+    return 0;
+}
+
+static void genmod_net_prog_free(genmod_net_prog *prog)
+{
+    if ( prog != NULL )
+    {
+        if ( prog->node != NULL )
+        {
+            DEBFREE(prog->node);
+        }
+
+        DEBFREE(prog);
+    }
+
+    return;
+}
+
+/*
+   Find or compile the program for fn(arg).  Returns NULL if it can't be
+   compiled, in which case the outfn is left as it is.
+*/
+
+static genmod_net_prog *genmod_net_prog_get(genmod_net *net, weird_pointer_jive_wargs fn, void *arg)
+{
+    genmod_net_prog *prog;
+
+    for ( prog = net->prog ; prog != NULL ; prog = prog->next )
+    {
+        if ( ( prog->fn == fn ) && ( prog->arg == arg ) )
+        {
+            return prog;
+        }
+    }
+
+    if ( ( prog = (genmod_net_prog *) DEBMALLOC(sizeof(genmod_net_prog)) ) == NULL )
+    {
+        return NULL;
+    }
+
+    prog->fn        = fn;
+    prog->arg       = arg;
+    prog->num_node  = 0;
+    prog->size_node = 16;
+    prog->next      = NULL;
+
+    if ( ( prog->node = (genmod_net_node *) DEBMALLOC((prog->size_node)*sizeof(genmod_net_node)) ) == NULL )
+    {
+        genmod_net_prog_free(prog);
+
+        return NULL;
+    }
+
+    if ( genmod_net_emit(net,prog,fn,arg,0) || genmod_net_add(prog,GENMOD_NET_END,NULL,NULL) )
+    {
+        genmod_net_prog_free(prog);
+
+        return NULL;
+    }
+
+    prog->next = net->prog;
+    net->prog  = prog;
+
+    (net->num_prog)++;
+    net->num_node += prog->num_node;
+
+    return prog;
+}
+
+static int genmod_net_add_slot(genmod_net *net, module_data *mod, UINT_64 num, genmod_net_prog *prog)
+{
+    genmod_net_slot *slot;
+
+    if ( net->num_slot >= net->size_slot )
+    {
+        if ( ( slot = (genmod_net_slot *) DEBMALLOC(2*(net->size_slot)*sizeof(genmod_net_slot)) ) == NULL )
+        {
+            return 1;
+        }
+
+        memcpy(slot,net->slot,(net->num_slot)*sizeof(genmod_net_slot));
+
+        DEBFREE(net->slot);
+
+        net->slot       = slot;
+        net->size_slot *= 2;
+    }
+
+    slot = &((net->slot)[net->num_slot]);
+
+    slot->mod  = mod;
+    slot->num  = num;
+    slot->fn   = DEREF_OUTFN(mod,num);
+    slot->arg  = DEREF_OUTARGS(mod,num);
+    slot->prog = prog;
+
+    (net->num_slot)++;
+
+    return 0;
+}
+
+genmod_net *genmod_net_compile(module_data **mods)
+{
+    genmod_net *net;
+    genmod_net_prog *prog;
+    genmod_net_slot *slot;
+    module_data **mod;
+    UINT_64 i;
+    UINT_32 j;
+
+    if ( ( net = (genmod_net *) DEBMALLOC(sizeof(genmod_net)) ) == NULL )
+    {
+        return NULL;
+    }
+
+    net->prog       = NULL;
+    net->num_slot   = 0;
+    net->size_slot  = 16;
+    net->num_prog   = 0;
+    net->num_node   = 0;
+    net->num_direct = 0;
+    net->num_folded = 0;
+
+    if ( ( net->slot = (genmod_net_slot *) DEBMALLOC((net->size_slot)*sizeof(genmod_net_slot)) ) == NULL )
+    {
+        DEBFREE(net);
+
+        return NULL;
+    }
+
+    /*
+       Compile everything against the wiring as it is before changing any
+       of it, so that each program only calls the leaf functions.
+    */
+
+    for ( mod = mods ; *mod != NULL ; mod++ )
+    {
+        for ( i = 0 ; i < (*mod)->num_sig_calls_outof_module ; i++ )
+        {
+            if ( genmod_net_foldable(DEREF_OUTFN(*mod,i)) )
+            {
+                if ( ( prog = genmod_net_prog_get(net,DEREF_OUTFN(*mod,i),DEREF_OUTARGS(*mod,i)) ) != NULL )
+                {
+                    if ( genmod_net_add_slot(net,*mod,i,prog) )
+                    {
+                        genmod_net_free(net);
+
+                        return NULL;
+                    }
+                }
+            }
+        }
+    }
+
+    /*
+       An outfn that now does nothing, or only calls one function, is
+       wired straight to it.  The rest run their program.
+    */
+
+    for ( j = 0 ; j < net->num_slot ; j++ )
+    {
+        slot = &((net->slot)[j]);
+        prog = slot->prog;
+
+        if ( prog->num_node == 1 )
+        {
+            DEREF_OUTFN(slot->mod,slot->num)   = global_nothingfn;
+            DEREF_OUTARGS(slot->mod,slot->num) = NULL;
+
+            (net->num_direct)++;
+        }
+
+        else if ( ( prog->num_node == 2 ) && ( (prog->node)[0].op == GENMOD_NET_CALL ) )
+        {
+            DEREF_OUTFN(slot->mod,slot->num)   = (prog->node)[0].fn;
+            DEREF_OUTARGS(slot->mod,slot->num) = (prog->node)[0].arg;
+
+            (net->num_direct)++;
+        }
+
+        else
+        {
+            DEREF_OUTFN(slot->mod,slot->num)   = genmod_net_run;
+            DEREF_OUTARGS(slot->mod,slot->num) = (void *) prog;
+        }
+    }
+
+    return net;
+}
+
+void genmod_net_free(genmod_net *net)
+{
+    genmod_net_prog *prog;
+    genmod_net_slot *slot;
+    UINT_32 j;
+
+    if ( net != NULL )
+    {
+        for ( j = 0 ; j < net->num_slot ; j++ )
+        {
+            slot = &((net->slot)[j]);
+
+            DEREF_OUTFN(slot->mod,slot->num)   = slot->fn;
+            DEREF_OUTARGS(slot->mod,slot->num) = slot->arg;
+        }
+
+        while ( net->prog != NULL )
+        {
+            prog      = net->prog;
+            net->prog = prog->next;
+
+            genmod_net_prog_free(prog);
+        }
+
+        DEBFREE(net->slot);
+        DEBFREE(net);
+    }
+
+    return;
+}
+
+char *genmod_net_getinf(genmod_net *net)
+{
+    char *dest;
+
+    if ( ( dest = (char *) DEBMALLOC((GENMOD_NET_MESSAGE_SIZE+1)*sizeof(char)) ) == NULL )
+    {
+        return NULL;
+    }
+
+    dest[0] = '\0';
+
+    if ( net != NULL )
+    {
+        sprintf(dest,"Netlist: %lu outfns compiled (%lu wired direct), %lu programs of %lu nodes, %lu do/branch calls folded.\n",
+                (unsigned long) net->num_slot,(unsigned long) net->num_direct,(unsigned long) net->num_prog,
+                (unsigned long) net->num_node,(unsigned long) net->num_folded);
+    }
+
+    return dest;
+}
+
+void genmod_net_run(void *what)
+{
+    genmod_net_node *base;
+    genmod_net_node *node;
+
+    base = ((genmod_net_prog *) what)->node;
+    node = base;
+
+    while ( 1 )
+    {
+        switch ( node->op )
+        {
+            case GENMOD_NET_CALL: { (node->fn)(node->arg); node++;                                                                                            break; }
+            case GENMOD_NET_JUMP: { node = base + node->jump;                                                                                                 break; }
+            case GENMOD_NET_NZ8:  { node = ( *((VOLATILITY UINT_8  *) node->left)                                           ) ? node+1 : base + node->jump; break; }
+            case GENMOD_NET_NZ16: { node = ( *((VOLATILITY UINT_16 *) node->left)                                           ) ? node+1 : base + node->jump; break; }
+            case GENMOD_NET_NZ32: { node = ( *((VOLATILITY UINT_32 *) node->left)                                           ) ? node+1 : base + node->jump; break; }
+            case GENMOD_NET_EQ8:  { node = ( *((VOLATILITY UINT_8  *) node->left) == *((VOLATILITY UINT_8  *) node->right) ) ? node+1 : base + node->jump; break; }
+            case GENMOD_NET_EQ16: { node = ( *((VOLATILITY UINT_16 *) node->left) == *((VOLATILITY UINT_16 *) node->right) ) ? node+1 : base + node->jump; break; }
+            case GENMOD_NET_EQ32: { node = ( *((VOLATILITY UINT_32 *) node->left) == *((VOLATILITY UINT_32 *) node->right) ) ? node+1 : base + node->jump; break; }
+            case GENMOD_NET_GT8:  { node = ( *((VOLATILITY UINT_8  *) node->left) >  *((VOLATILITY UINT_8  *) node->right) ) ? node+1 : base + node->jump; break; }
+            case GENMOD_NET_GT16: { node = ( *((VOLATILITY UINT_16 *) node->left) >  *((VOLATILITY UINT_16 *) node->right) ) ? node+1 : base + node->jump; break; }
+            case GENMOD_NET_GT32: { node = ( *((VOLATILITY UINT_32 *) node->left) >  *((VOLATILITY UINT_32 *) node->right) ) ? node+1 : base + node->jump; break; }
+            case GENMOD_NET_LT8:  { node = ( *((VOLATILITY UINT_8  *) node->left) <  *((VOLATILITY UINT_8  *) node->right) ) ? node+1 : base + node->jump; break; }
+            case GENMOD_NET_LT16: { node = ( *((VOLATILITY UINT_16 *) node->left) <  *((VOLATILITY UINT_16 *) node->right) ) ? node+1 : base + node->jump; break; }
+            case GENMOD_NET_LT32: { node = ( *((VOLATILITY UINT_32 *) node->left) <  *((VOLATILITY UINT_32 *) node->right) ) ? node+1 : base + node->jump; break; }
+            default:              { return; }
+        }
+    }
+}
+
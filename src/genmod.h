@@ -245,6 +245,16 @@ outgoing functions: none
 
 Module is unclocked.
 
+busmod_serialise/busmod_deserialise save and load the three buses in a
+snapshot section (see modules.h), version BUSMOD_SNAP_VERSION.
+
+The three buses are kept together in a busmod_store (8 bytes, or 16
+where UINT_32 is a 64 bit long).  busmod_relocate(what,dest) moves them
+into *dest, values and all, so that the buses of a whole machine can be
+packed into a few cache lines (see machine.h, "Bus arena").  It only
+repoints the bus module itself: the caller has to repoint anything else
+connected to the buses.
+
 
 Functional module 2: mem
 ========================
@@ -272,13 +282,20 @@ string variables: svar0 if nonempty, the memory module will act as ROM and
 
 module pointers: none
 
-8  bit buses: busa data bus
-              busb 8-bit address bus (starts at 0)
-              (out) bus0 points to memory address 0 (memory is sequential)
-              (out) bus1 points to memory address 1
-                    ...
-16 bit buses: busc 16-bit address bus (starts at 0)
-32 bit buses: busd 32-bit address bus (starts at 0)
+8  bit buses: busa0 data bus
+              busa1 8-bit address bus (starts at 0)
+              (out) busa2 points to memory address 0 (memory is
+                    sequential, so address n is at busa2[n & busc1])
+16 bit buses: busb0 16-bit address bus (starts at 0)
+32 bit buses: busc0 32-bit address bus (starts at 0)
+              (out) busc1 points to the address mask actually used
+                    (varc0 & varc1)
+
+Only the base pointer and mask are exported, not a pointer per byte, so
+the module costs the same however big the memory is (apart from the
+memory itself).  Modules that go straight to the memory (eg. setbus
+feeding the Z80 page tables) should be given busa2 and do their own
+address arithmetic.
 
 incoming functions: infn0  reset the memory module
                     infn1  write to memory using 8-bit address
@@ -298,6 +315,18 @@ outgoing functions: none
 
 Module is unclocked.
 
+memmod_serialise/memmod_deserialise save and load the module in a snapshot
+section (see modules.h), version MEMMOD_SNAP_VERSION.  The memory is always
+registered as a snapshot block, so that other modules can save pointers
+into it, but the contents are only saved for RAM (ROM is loaded from its
+file as usual).  A snapshot taken with a different memory size is refused.
+
+memmod_rom_serialise/memmod_rom_deserialise are for memory the machine
+can't write (ROM sockets, including empty ones with no file), version
+MEMMOD_ROM_SNAP_VERSION.  The contents are never saved, just a checksum,
+so snapshots (and the rewind ring) don't carry copies of the ROMs.  A
+snapshot taken with different ROM contents is refused.
+
 
 Functional module 3: setbus
 ===========================
@@ -1610,8 +1639,53 @@ outgoing functions: none
 Module is unclocked.
 
 
+Netlist compiler
+================
+
+Every call through a do, dowhile or branch module is an indirect call that
+then makes more indirect calls, so a z80 write to video RAM (say) goes
+through several modules before anything is done.  Once the machine is
+wired up, genmod_net_compile can flatten these chains:
+
+genmod_net_compile(mods) goes through the outfns of the modules in the
+NULL terminated list mods.  Each outfn wired to a do, dowhile or branch
+module (infn0-2) is compiled into a program that makes the same calls,
+with the do modules inlined, the dowhile loops and branch tests done in
+place, branches with the same thing wired to both sides treated as
+constant, and calls to nothing dropped.  The outfn is then rewired to run
+the program (genmod_net_run), or straight to the one function it ends up
+calling.  Outfns with the same target share a program.  Returns NULL if
+there isn't enough memory (nothing is changed in that case).
+
+The buses and variables tested are the same ones the modules would have
+read, so the results are the same, but the wiring (outfns, bus pointers
+and the number of outfns of do modules) is read when compiling: anything
+re-wired afterwards must be compiled again (so a setbus module mustn't
+point at a do, dowhile or branch module that is compiled).  Modules that
+copy their outfns (such as the 6545) must be compiled before they are
+started.
+
+genmod_net_free(net) puts the outfns back as they were and frees the
+programs.  genmod_net_getinf(net) describes what was compiled.
+
+
 */
 
+#define BUSMOD_SNAP_VERSION     1
+#define MEMMOD_SNAP_VERSION     1
+#define MEMMOD_ROM_SNAP_VERSION 2
+
+typedef struct Genmod_Net genmod_net;
+
+typedef struct
+{
+    UINT_32 bus_32bit;
+    UINT_16 bus_16bit;
+    UINT_8  bus_8bit;
+    UINT_8  unused;
+}
+busmod_store;
+
 module_data *nullmod_alloc(const char *module_name);
 int          nullmod_init(module_data *what);
 void         nullmod_go(module_data *what);
@@ -1659,6 +1733,9 @@ void         busmod_stop(module_data *what);
 void         busmod_remove(module_data *what);
 void         busmod_cycle(module_data *what, UINT_16 num_cycles, UINT_8 clock_div, int lsync_point);
 char        *busmod_getinf(module_data *what);
+int          busmod_serialise(module_data *what, snap_data *snap);
+int          busmod_deserialise(module_data *what, snap_data *snap);
+void         busmod_relocate(module_data *what, busmod_store *dest);
 
 module_data *memmod_alloc(const char *module_name);
 int          memmod_init(module_data *what);
@@ -1667,6 +1744,10 @@ void         memmod_stop(module_data *what);
 void         memmod_remove(module_data *what);
 void         memmod_cycle(module_data *what, UINT_16 num_cycles, UINT_8 clock_div, int lsync_point);
 char        *memmod_getinf(module_data *what);
+int          memmod_serialise(module_data *what, snap_data *snap);
+int          memmod_deserialise(module_data *what, snap_data *snap);
+int          memmod_rom_serialise(module_data *what, snap_data *snap);
+int          memmod_rom_deserialise(module_data *what, snap_data *snap);
 
 module_data *setbusmod_alloc(const char *module_name);
 int          setbusmod_init(module_data *what);
@@ -2012,4 +2093,9 @@ void         slconstbmod_remove(module_data *what);
 void         slconstbmod_cycle(module_data *what, UINT_16 num_cycles, UINT_8 clock_div, int lsync_point);
 char        *slconstbmod_getinf(module_data *what);
 
+genmod_net *genmod_net_compile(module_data **mods);
+void        genmod_net_free(genmod_net *net);
+char       *genmod_net_getinf(genmod_net *net);
+void        genmod_net_run(void *what);
+
 #endif
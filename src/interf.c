@@ -130,6 +130,18 @@ void *interf_indir_nonvol   = NULL;
 #define INTERF_CTRL_RESTART_EMU(what)   OUTFNCALL(what,7)
 #define INTERF_PARA_STROBE(what)        OUTFNCALL(what,8)
 #define INTERF_TAPE_STROBE(what)        OUTFNCALL(what,9)
+#define INTERF_CTRL_DCACHE_ON(what)     OUTFNCALL(what,10)
+#define INTERF_CTRL_DCACHE_OFF(what)    OUTFNCALL(what,11)
+#define INTERF_CTRL_END_RUN(what)       OUTFNCALL(what,12)
+#define INTERF_CTRL_SKIP_NONE(what)     OUTFNCALL(what,13)
+#define INTERF_CTRL_SKIP_HALT(what)     OUTFNCALL(what,14)
+#define INTERF_CTRL_SKIP_IDLE(what)     OUTFNCALL(what,15)
+#define INTERF_CTRL_TRACE_DUMP(what)    OUTFNCALL(what,16)
+#define INTERF_CTRL_SNAP_SAVE(what)     OUTFNCALL(what,17)
+#define INTERF_CTRL_SNAP_LOAD(what)     OUTFNCALL(what,18)
+#define INTERF_CTRL_REWIND(what)        OUTFNCALL(what,19)
+#define INTERF_CTRL_TURBO(what)         OUTFNCALL(what,20)
+#define INTERF_CATCH_UP(what)           OUTFNCALL(what,21)
 
 
 /*
@@ -175,7 +187,10 @@ volatile int interf_prtscr_flag      = 0;
 volatile int interf_interact_flag    = 0;
 
 int interf_is_in_menu_mode = 0;
-int interf_speed_emu_on    = 0;
+int interf_speed_emu_on    = 0; /* 0 unlimited, 1 normal, 2 turbo */
+int interf_dcache_on       = 1;
+int interf_idle_skip       = 2;
+int interf_headless        = 0;
 
 
 #ifdef IS_WEB
@@ -528,6 +543,91 @@ UINT_32 interf_para_responsetime_in  = 500000;
 UINT_32 interf_para_strobe_time      = 15;
 UINT_32 interf_para_readgranularity  = 50;
 
+
+
+
+/*
+   Input record and replay
+   =======================
+
+   Keypresses, the reset key, tape input and parallel port input all come
+   from the host at times that have nothing to do with the emulation (the
+   keyboard interupt, the menu, the pc parallel port and so on), so no two
+   runs are ever quite the same.  If input_log is set to 1 (in
+   mbee32k.ini) every change the host makes to the microbee is written to
+   INTERF_INPUT_LOG_FILE, stamped with the number of z80 clock cycles since
+   the emulator started.  If it's set to 2 the changes are read back from
+   the file rather than from the host and made at exactly the same clock
+   cycle, so the emulation runs exactly as it did when it was recorded.
+   Speed emulation is off when replaying, so the replay runs as fast as the
+   host allows, and the emulator exits at the clock cycle where the
+   recording stopped.
+
+   The things recorded are:
+
+   - the microbee key matrix (INTERF_INPUT_KEYS), recorded whenever the
+     keys held down change.  Bit n is key n, ie. the key at lightpen
+     address n<<4.
+   - the reset key (INTERF_INPUT_RESET), going down (1) or up (0).
+   - tape input edges (INTERF_INPUT_TAPE), 0 or 1.
+   - parallel port input in modes 0 (pc parallel port) and 3 (input from
+     file) (INTERF_INPUT_PARA): data and strobe, recorded when either
+     changes.
+   - the end of the recording (INTERF_INPUT_END).
+
+   The file is INTERF_INPUT_MAGIC and INTERF_INPUT_VERSION (4 bytes)
+   followed by INTERF_INPUT_REC_SIZE byte records: the clock cycle
+   (8 bytes), the type (1 byte) and the data (8 bytes), least significant
+   byte first.
+
+   Replay must start from the same point as the recording (that is, a
+   freshly started emulator using the same mbee32k.ini and roms).  Both
+   modes run the 6545 without any granularity (see mbee.c), as it would
+   otherwise depend on the speed control.  Keystrokes from a file, loading
+   and rewinding the machine state, and changes made from the menu other
+   than tape and parallel port input are not recorded.
+
+   interf_input_mode: 0 normally, 1 when recording, 2 when replaying.
+   interf_input_fp: file being recorded or replayed (NULL if none).
+   interf_input_clock: z80 clock cycles since the emulator started.
+   interf_input_next_*: next record to be replayed (if interf_input_ready).
+   interf_input_keys, interf_input_para: last key matrix and parallel
+        port input recorded.
+*/
+
+#define INTERF_INPUT_LOG_FILE   "mbee32k.inp"
+#define INTERF_INPUT_MAGIC      "MBEEINPT"
+#define INTERF_INPUT_VERSION    1
+#define INTERF_INPUT_REC_SIZE   17
+
+#define INTERF_INPUT_END        0
+#define INTERF_INPUT_KEYS       1
+#define INTERF_INPUT_RESET      2
+#define INTERF_INPUT_TAPE       3
+#define INTERF_INPUT_PARA       4
+
+int     interf_input_mode       = INTERF_INPUT_OFF;
+FILE   *interf_input_fp         = NULL;
+UINT_64 interf_input_clock      = 0;
+int     interf_input_ready      = 0;
+UINT_64 interf_input_next_clock = 0;
+UINT_8  interf_input_next_type  = 0;
+UINT_64 interf_input_next_data  = 0;
+UINT_64 interf_input_keys       = 0;
+UINT_64 interf_input_para       = 0;
+
+int  interf_input_open(void);
+void interf_input_close(void);
+void interf_input_put(UINT_8 type, UINT_64 data);
+void interf_input_get(void);
+void interf_input_replay(module_data *what);
+void interf_input_record_keys(void);
+void interf_tape_in_edge(module_data *what, UINT_8 state);
+void interf_para_in_strobe(module_data *what);
+
+
+
+
 SetupData interf_setdat[] =
 {
     { "screen_mode",                &interf_scrn_video_mode,       6, 0,   9           },
@@ -545,6 +645,8 @@ SetupData interf_setdat[] =
     { "key_count_start",            &interf_key_clkcnt_max,        0, 0,   1024        },
     { "key_refresh_cycles",         &interf_key_rfsh_cycles,       2, 0,   1024        },
     { "tape_autosave",              &interf_tape_autosave_mode,    6, 0,   1           },
+    { "cpu_decode_cache",           &interf_dcache_on,             6, 0,   1           },
+    { "cpu_idle_skip",              &interf_idle_skip,             6, 0,   2           },
     { "pc_lpt_num",                 &interf_para_lptnum,           6, 0,   255         },
     { "pc_lpt_port",                &interf_para_lptport,          6, 0,   255         },
     { "simulate_lpt_pulse",         &interf_para_sim_pulse,        6, 0,   1           },
@@ -553,6 +655,7 @@ SetupData interf_setdat[] =
     { "Parallel_response_time_in",  &interf_para_responsetime_in,  2, 0,   0x0ffffffff },
     { "Parallel_strobe_time",       &interf_para_strobe_time,      2, 0,   1024        },
     { "Parallel_read_granularity",  &interf_para_readgranularity,  2, 1,   1024        },
+    { "input_log",                  &interf_input_mode,            6, 0,   2           },
     { "", NULL, 0, 0, 0 }
 };
 
@@ -912,6 +1015,11 @@ int  interf_scrn_set_vidmode(int what);
          +-------+-------------------------------------------+
 
    interf_para_cycle_cnt: general clock cycle counter variable.
+   interf_para_cycle_hold: set when a handshake is started by a write from
+        the pio part way through a cpu run.  The run is then ended early
+        (at the end of the slice the write was in - see interf_horizon) and
+        the clock cycles of that run are not counted, so the handshake
+        timing doesn't depend on how long the run was.
    interf_para_upstat_cnt: counts calls to interf_cycle in mode 0.  When
         this counter exceeds interf_para_readgranularity then checks to
         the pc parallel port are carried out.
@@ -959,6 +1067,7 @@ int interf_para_mode  = 4;
 int interf_para_state = 0;
 
 UINT_32 interf_para_cycle_cnt  = 0;
+int     interf_para_cycle_hold = 0;
 UINT_8  interf_para_upstat_cnt = 0;
 
 char interf_para_filename_dest[DEFAULT_STRLEN] = "";
@@ -1475,6 +1584,7 @@ void interf_key_lowlevel_react(int scancode);
 #endif
 void interf_key_setfile(const char *interf_key_sourcefilename);
 void interf_key_closefile(void);
+void interf_key_update_lpen(module_data *what);
 
 int interf_key_unshift_0      = 0;
 int interf_key_unshift_2      = 0;
@@ -2403,6 +2513,16 @@ module_data *interf_alloc(const char *module_name)
 
     interf_is_in_menu_mode = 0;
     interf_speed_emu_on    = 0;
+    interf_dcache_on       = 1;
+    interf_idle_skip       = 2;
+    interf_headless        = 0;
+
+    interf_input_mode  = INTERF_INPUT_OFF;
+    interf_input_fp    = NULL;
+    interf_input_clock = 0;
+    interf_input_ready = 0;
+    interf_input_keys  = 0;
+    interf_input_para  = 0;
 
     interf_scrn_mono_forecolour = 0;
     interf_scrn_mono_backcolour = 0;
@@ -2440,6 +2560,7 @@ module_data *interf_alloc(const char *module_name)
     interf_para_state = 0;
 
     interf_para_cycle_cnt  = 0;
+    interf_para_cycle_hold = 0;
     interf_para_upstat_cnt = 0;
 
     interf_para_dest_fp = NULL;
@@ -2623,7 +2744,7 @@ module_data *interf_alloc(const char *module_name)
     {
         interf_is_alloced = 1;
 
-        what = gen_module_data(module_name,1,0,0,0,0,0,16,8,2,10,10);
+        what = gen_module_data(module_name,1,0,0,0,1,0,16,8,2,10,22);
 
         DEREF_INFN(what,0) = interf_scrn_set_left_margin;
         DEREF_INFN(what,1) = interf_scrn_set_screen_width;
@@ -3178,11 +3299,46 @@ void interf_go(module_data *what)
     #endif
 
     /*
-       Set emulation speed.
+       Start recording or replaying input.  If the log can't be opened
+       input comes from the host as usual.
+    */
+
+    if ( interf_input_open() )
+    {
+        interf_input_mode = INTERF_INPUT_OFF;
+    }
+
+    /*
+       Set emulation speed (always flat out when replaying or running
+       headless).
+    */
+
+    if ( ( ( interf_input_mode == INTERF_INPUT_REPLAY ) || interf_headless ) && ( interf_speed_emu_on == 1 ) )
+    {
+        interf_speed_emu_on = 0;
+    }
+
+    if      ( interf_speed_emu_on == 2 ) { INTERF_CTRL_TURBO(what);         }
+    else if ( interf_speed_emu_on      ) { INTERF_CTRL_SPEEDCTRL_ON(what);  }
+    else                                 { INTERF_CTRL_SPEEDCTRL_OFF(what); }
+
+    /*
+       Set the cpu decode cache.
+    */
+
+    if ( interf_dcache_on ) { INTERF_CTRL_DCACHE_ON(what);  }
+    else                    { INTERF_CTRL_DCACHE_OFF(what); }
+
+    /*
+       Set cpu idle time skipping.
     */
 
-    if ( interf_speed_emu_on ) { INTERF_CTRL_SPEEDCTRL_ON(what);  }
-    else                       { INTERF_CTRL_SPEEDCTRL_OFF(what); }
+    switch ( interf_idle_skip )
+    {
+        case 0:  { INTERF_CTRL_SKIP_NONE(what); break; }
+        case 1:  { INTERF_CTRL_SKIP_HALT(what); break; }
+        default: { INTERF_CTRL_SKIP_IDLE(what); break; }
+    }
 
     return;
 
@@ -3198,6 +3354,12 @@ void interf_stop(module_data *what)
     interf_tape_out_reset_state();
     interf_tape_in_reset_state();
 
+    /*
+       Finish recording or replaying input.
+    */
+
+    interf_input_close();
+
     /*
        Redirect keyboard actions to interf_key_lowlevel_exit.
     */
@@ -3312,6 +3474,9 @@ void interf_remove(module_data *what)
 void interf_cycle(module_data *what, UINT_16 num_cycles, UINT_8 clock_div, int lsync_point)
 {
     UINT_16 i;
+    UINT_16 para_cycles;
+
+    interf_input_clock += num_cycles;
 
     /*
        Allow for non-interupt type hardware.
@@ -3459,15 +3624,44 @@ void interf_cycle(module_data *what, UINT_16 num_cycles, UINT_8 clock_div, int l
     */
 
     if ( interf_snd_toggle_flag  ) { interf_snd_toggle_flag  = 0; interf_snd_toggle_snd();         }
-    if ( interf_sig_rsetdwn_flag ) { interf_sig_rsetdwn_flag = 0; INTERF_CTRL_RESET_ON(what);      }
-    if ( interf_sig_rsetup_flag  ) { interf_sig_rsetup_flag  = 0; INTERF_CTRL_RESET_OFF(what);     }
     if ( interf_scrn_rfsh_flag   ) { interf_scrn_rfsh_flag   = 0; INTERF_SCRN_RFSH(what);          }
 
+    if ( interf_input_mode == INTERF_INPUT_REPLAY )
+    {
+        /*
+           The reset key and keyboard come from the log.
+        */
+
+        interf_sig_rsetdwn_flag = 0;
+        interf_sig_rsetup_flag  = 0;
+        interf_key_lowcall_flag = 0;
+
+        interf_input_replay(what);
+    }
+
+    if ( interf_sig_rsetdwn_flag )
+    {
+        interf_sig_rsetdwn_flag = 0;
+
+        if ( interf_input_mode == INTERF_INPUT_RECORD ) { interf_input_put(INTERF_INPUT_RESET,1); }
+
+        INTERF_CTRL_RESET_ON(what);
+    }
+
+    if ( interf_sig_rsetup_flag )
+    {
+        interf_sig_rsetup_flag = 0;
+
+        if ( interf_input_mode == INTERF_INPUT_RECORD ) { interf_input_put(INTERF_INPUT_RESET,0); }
+
+        INTERF_CTRL_RESET_OFF(what);
+    }
+
     if ( interf_speedtoggle_flag )
     {
         interf_speedtoggle_flag = 0;
 
-        if ( interf_speed_emu_on )
+        if ( interf_speed_emu_on == 1 )
         {
             INTERF_CTRL_SPEEDCTRL_OFF(what);
 
@@ -3663,24 +3857,12 @@ void interf_cycle(module_data *what, UINT_16 num_cycles, UINT_8 clock_div, int l
                 DEBDEREF(interf_key_worktable,0x3F1) = ( key[KEY_TILDE] | key[KEY_QUOTE] | key[KEY_EQUALS] | key[KEY_0] ) & KB_NORMAL;
             }
 
-            interf_key_keydown = 0;
-
-            for ( i = 0x00000 ; i <= 0x003F0 ; i += 0x00010 )
+            if ( interf_input_mode == INTERF_INPUT_RECORD )
             {
-                if ( DEBDEREF(interf_key_worktable,i+1) & !DEBDEREF(INTERF_KEY_LPEN_TABLE(what),i) )
-                {
-                    /* Key has just been pressed. */
-                    /* -= start the counter =- */
-
-                    DEBDEREF(INTERF_KEY_LPEN_TABLE(what),i) = 1;
-                    DEBDEREF(interf_key_worktable,i+2)      = interf_key_clkcnt_max;
-
-                    DEBDEREF(INTERF_KEY_FEEDBACK_TABLE(what),i) = 0;
-                    DEBDEREF(INTERF_KEY_FEEDRFSH_TABLE(what),i) = 0;
-                }
-
-                interf_key_keydown |= DEBDEREF(INTERF_KEY_LPEN_TABLE(what),i);
+                interf_input_record_keys();
             }
+
+            interf_key_update_lpen(what);
         }
 
         /*
@@ -3911,6 +4093,10 @@ void interf_cycle(module_data *what, UINT_16 num_cycles, UINT_8 clock_div, int l
        Parallel port cycling
     */
 
+    para_cycles = interf_para_cycle_hold ? 0 : num_cycles;
+
+    interf_para_cycle_hold = 0;
+
     switch ( interf_para_mode )
     {
         case 0:
@@ -3918,6 +4104,7 @@ void interf_cycle(module_data *what, UINT_16 num_cycles, UINT_8 clock_div, int l
             /* output direct to pc parallel port */
 
             #ifdef PARA_ACCESS_HARD
+            if ( interf_input_mode != INTERF_INPUT_REPLAY )
             {
                 if ( lsync_point )
                 {
@@ -3998,7 +4185,7 @@ void interf_cycle(module_data *what, UINT_16 num_cycles, UINT_8 clock_div, int l
                     }
                 }
 
-                INTERF_PARA_STROBE(what);
+                interf_para_in_strobe(what);
             }
             #endif
 
@@ -4015,7 +4202,7 @@ void interf_cycle(module_data *what, UINT_16 num_cycles, UINT_8 clock_div, int l
             {
                 case 1:
                 {
-                    interf_para_cycle_cnt += num_cycles;
+                    interf_para_cycle_cnt += para_cycles;
 
                     if ( interf_para_cycle_cnt >= interf_para_responsetime_out )
                     {
@@ -4032,7 +4219,7 @@ void interf_cycle(module_data *what, UINT_16 num_cycles, UINT_8 clock_div, int l
 
                 case 2:
                 {
-                    interf_para_cycle_cnt += num_cycles;
+                    interf_para_cycle_cnt += para_cycles;
 
                     if ( interf_para_cycle_cnt >= interf_para_strobe_time )
                     {
@@ -4060,11 +4247,18 @@ void interf_cycle(module_data *what, UINT_16 num_cycles, UINT_8 clock_div, int l
         {
             /* input from file */
 
+            if ( interf_input_mode == INTERF_INPUT_REPLAY )
+            {
+                /* replayed from the input log */
+
+                break;
+            }
+
             switch ( interf_para_state )
             {
                 case 1:
                 {
-                    interf_para_cycle_cnt += num_cycles;
+                    interf_para_cycle_cnt += para_cycles;
 
                     if ( interf_para_cycle_cnt >= interf_para_responsetime_in )
                     {
@@ -4082,7 +4276,7 @@ void interf_cycle(module_data *what, UINT_16 num_cycles, UINT_8 clock_div, int l
                             INTERF_PARA_DATA_BUS_OUT(what) = pc_fgetc(interf_para_src_fp);
                         }
 
-                        INTERF_PARA_STROBE(what);
+                        interf_para_in_strobe(what);
 
                         interf_para_cycle_cnt = 0;
                         interf_para_state     = 2;
@@ -4093,13 +4287,13 @@ void interf_cycle(module_data *what, UINT_16 num_cycles, UINT_8 clock_div, int l
 
                 case 2:
                 {
-                    interf_para_cycle_cnt += num_cycles;
+                    interf_para_cycle_cnt += para_cycles;
 
                     if ( interf_para_cycle_cnt >= interf_para_strobe_time )
                     {
                         INTERF_PARA_STRB_BUS_OUT(what) = 1;
 
-                        INTERF_PARA_STROBE(what);
+                        interf_para_in_strobe(what);
 
                         interf_para_cycle_cnt = 0;
                         interf_para_state     = 0;
@@ -4135,185 +4329,866 @@ void interf_cycle(module_data *what, UINT_16 num_cycles, UINT_8 clock_div, int l
            Output cycle - If timeout then reset state
         */
 
-        if ( interf_tape_out_elapsed_zclk > INTERF_TAPE_TIMEOUT_POINT )
-        {
-            interf_tape_out_elapsed_zclk = INTERF_TAPE_TIMEOUT_PUSH;
+        if ( interf_tape_out_elapsed_zclk > INTERF_TAPE_TIMEOUT_POINT )
+        {
+            interf_tape_out_elapsed_zclk = INTERF_TAPE_TIMEOUT_PUSH;
+
+            interf_tape_out_reset_state_after_block();
+
+            if ( interf_tape_autosave_mode )
+            {
+                interf_tape_out_reset_state_after_file();
+            }
+        }
+
+        /*
+           Input cycle
+        */
+
+        if ( interf_tape_in_type && ( interf_tape_in_elapsed_zclk >= interf_tape_lower[1] ) && ( interf_input_mode != INTERF_INPUT_REPLAY ) )
+        {
+            if ( interf_tape_in_kansascycle == 0 )
+            {
+                interf_tape_in_elapsed_zclk = 0;
+
+                /*
+                   0 is used to signify that the process has just started (this
+                   is needed to make cycles HL, not LH).  Thus we need to set
+                   the bit to 1 to get things started.
+                */
+
+                interf_tape_in_edge(what,1);
+                interf_tape_in_state_fine = 1;
+
+                interf_tape_in_kansascycle = 1;
+
+                /*
+                   Get bit from the bit buffer.
+                */
+
+                INTERF_TAPE_IN_GETBITFROMBUFF(interf_tape_in_bit_fine);
+            }
+
+            else
+            {
+                if ( interf_tape_in_elapsed_zclk >= interf_tape_cycles[interf_tape_in_bit_fine][interf_tape_in_state_fine] )
+                {
+                    /*
+                       OK, current cycle done.
+                    */
+
+                    interf_tape_in_elapsed_zclk -= interf_tape_cycles[interf_tape_in_bit_fine][interf_tape_in_state_fine];
+
+                    /*
+                       Invert the state, and update the cycle counter if this
+                       was a low->high transition.
+                    */
+
+                    if ( interf_tape_in_state_fine )
+                    {
+                        interf_tape_in_edge(what,0);
+                        interf_tape_in_state_fine = 0;
+                    }
+
+                    else
+                    {
+                        interf_tape_in_edge(what,1);
+                        interf_tape_in_state_fine = 1;
+
+                        interf_tape_in_kansascycle++;
+                    }
+
+                    if ( interf_tape_in_kansascycle > interf_tape_count[interf_tape_in_tapesped][interf_tape_in_bit_fine] )
+                    {
+                        /*
+                           Current bit is done, get the next one.
+                        */
+
+                        INTERF_TAPE_IN_GETBITFROMBUFF(interf_tape_in_bit_fine);
+
+                        /*
+                           Reset the counter (1 start deliberate)
+                        */
+
+                        interf_tape_in_kansascycle = 1;
+
+                        /*
+                           Change to 1200baud if trigger hit
+                        */
+
+                        if ( interf_tape_in_pos_bitcnt == interf_tape_in_spedchgbitcht )
+                        {
+                            interf_tape_in_tapesped = 1;
+                        }
+                    }
+                }
+            }
+
+            if ( interf_tape_in_pos_bitcnt >= interf_tape_in_bufsize )
+            {
+                /*
+                   This will actually cut the final stop bit off the final
+                   transmitted byte.  That's why the buffer is always padded
+                   with a NULL at the end, so only the (unimportant) NULL
+                   character is affected.
+                */
+
+                interf_tape_in_edge(what,0);
+                interf_tape_in_state_fine = 0;
+
+                interf_tape_in_reset_state();
+            }
+        }
+    }
+
+    /*
+       Screen cycling
+    */
+
+    {
+        if ( interf_interact_flag || interf_scrn_stepmode )
+        {
+            /*
+               Enter interactive mode.
+            */
+
+            interf_is_in_menu_mode = 1;
+            INTERF_CTRL_PAUSE_EMU(what);
+            #ifdef IS_ALLEGRO
+            {
+                interf_menu_enter();
+            }
+            #endif
+            INTERF_CTRL_RESTART_EMU(what);
+            interf_is_in_menu_mode = 0;
+        }
+
+        interf_interact_flag = 0;
+    }
+
+    #ifdef IS_WEB
+    {
+        /*
+           Under allegro, the menu is only available when the emulation is
+           paused.  See interf_menu_enter() for more info.  Not sure if this
+           is optimal for the web based version.  See call for
+           interf_menu_enter above.
+        */
+    }
+    #endif
+
+    if ( interf_prtscr_flag )
+    {
+        /*
+           Save screen snapshot.
+        */
+
+        interf_scrn_screenshot(DEFAULT_SCREENDUMP_FILE);
+
+        interf_prtscr_flag = 0;
+    }
+
+    return;
+
+    clock_div = 0;
+}
+
+UINT_32 interf_horizon(module_data *what)
+{
+    UINT_32 result = INTERF_HORIZON_NONE;
+    UINT_32 temp;
+
+    /*
+       Keyboard refresh.  This comes around every interf_key_rfsh_cycles
+       clock cycles whether or not any keys are down, and must not be
+       skipped as the counter is only wound back once per call.
+    */
+
+    if ( interf_key_cyclecnt >= interf_key_rfsh_cycles )
+    {
+        return 1;
+    }
+
+    result = (UINT_32) ( interf_key_rfsh_cycles - interf_key_cyclecnt ) + 1;
+
+    /*
+       Key file typing.  Whether the next key can be pressed or released
+       is checked on every call, so while a key file is open the z80
+       can't be run ahead at all.
+    */
+
+    if ( interf_key_sourcefp != NULL )
+    {
+        return 1;
+    }
+
+    /*
+       Sound cycle counter overflow trim.
+    */
+
+    if ( interf_snd_sndon )
+    {
+        if ( interf_snd_clkcycle_cnt_a >= interf_snd_clkcnt_max )
+        {
+            return 1;
+        }
+
+        if ( interf_snd_clkcnt_max - interf_snd_clkcycle_cnt_a < result )
+        {
+            result = (UINT_32) ( interf_snd_clkcnt_max - interf_snd_clkcycle_cnt_a ) + 1;
+        }
+    }
+
+    /*
+       Input replay.  Each run stops at the clock cycle of the next record
+       so that it's made at exactly the point it was recorded.
+    */
+
+    if ( ( interf_input_mode == INTERF_INPUT_REPLAY ) && interf_input_ready )
+    {
+        if ( interf_input_next_clock <= interf_input_clock )
+        {
+            return 1;
+        }
+
+        if ( interf_input_next_clock - interf_input_clock < result )
+        {
+            result = (UINT_32) ( interf_input_next_clock - interf_input_clock );
+        }
+    }
+
+    /*
+       Parallel port handshaking.  Mode 0 counts calls rather than clock
+       cycles, so it can't be run ahead at all.  Input modes 0 and 3 do
+       nothing when replaying (the input comes from the log instead).
+    */
+
+    temp = INTERF_HORIZON_NONE;
+
+    switch ( interf_para_mode )
+    {
+        case 0:
+        {
+            if ( interf_input_mode == INTERF_INPUT_REPLAY )
+            {
+                break;
+            }
+
+            return 1;
+        }
+
+        case 1:
+        case 2:
+        case 5:
+        {
+            if ( interf_para_state == 1 ) { temp = interf_para_responsetime_out; }
+            if ( interf_para_state == 2 ) { temp = interf_para_strobe_time;      }
+
+            break;
+        }
+
+        case 3:
+        {
+            if ( interf_input_mode == INTERF_INPUT_REPLAY )
+            {
+                break;
+            }
+
+            if ( interf_para_state == 1 ) { temp = interf_para_responsetime_in; }
+            if ( interf_para_state == 2 ) { temp = interf_para_strobe_time;     }
+
+            break;
+        }
+
+        default:
+        {
+            break;
+        }
+    }
+
+    if ( temp != INTERF_HORIZON_NONE )
+    {
+        if ( interf_para_cycle_cnt >= temp )
+        {
+            return 1;
+        }
+
+        if ( temp - interf_para_cycle_cnt < result )
+        {
+            result = temp - interf_para_cycle_cnt;
+        }
+    }
+
+    /*
+       Tape output timeout (which repeats every few hundred clock cycles
+       once the tape has stopped) and tape input edges.  At most one input
+       edge is dealt with per call.
+    */
+
+    if ( interf_tape_out_elapsed_zclk >= INTERF_TAPE_TIMEOUT_POINT )
+    {
+        return 1;
+    }
+
+    if ( INTERF_TAPE_TIMEOUT_POINT - interf_tape_out_elapsed_zclk < result )
+    {
+        result = ( INTERF_TAPE_TIMEOUT_POINT - interf_tape_out_elapsed_zclk ) + 1;
+    }
+
+    if ( interf_tape_in_type )
+    {
+        temp = interf_tape_lower[1];
+
+        if ( interf_tape_in_kansascycle && ( interf_tape_cycles[interf_tape_in_bit_fine][interf_tape_in_state_fine] > temp ) )
+        {
+            temp = interf_tape_cycles[interf_tape_in_bit_fine][interf_tape_in_state_fine];
+        }
+
+        if ( interf_tape_in_elapsed_zclk >= temp )
+        {
+            return 1;
+        }
+
+        if ( temp - interf_tape_in_elapsed_zclk < result )
+        {
+            result = temp - interf_tape_in_elapsed_zclk;
+        }
+    }
+
+    return result;
+
+    what = NULL;
+}
+
+int interf_key_down(module_data *what)
+{
+    UINT_16 i;
+
+    /*
+       interf_key_keydown isn't kept up to date in every case (keys typed
+       from a file), so look at the table itself.
+    */
+
+    for ( i = 0x00000 ; i <= 0x003F0 ; i += 0x00010 )
+    {
+        if ( DEBDEREF(INTERF_KEY_LPEN_TABLE(what),i) )
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+char *interf_getinf(module_data *what)
+{
+    char *dest;
+
+    dest = DEBMALLOC(10*sizeof(UINT_8));
+
+    sprintf(dest,"\n");
+
+    return dest;
+
+    what = NULL;
+}
+
+/*
+Function: interf_serialise(), interf_deserialise()
+Operation: Save and load the interface in a snapshot (see interf.h).
+
+Only the state that moves as the emulation runs is saved: the tape in and
+out bit engines, the speaker and the parallel port handshaking.  The tape
+in position is only restored if the tape loaded now is the same size as
+the one that was loaded when the snapshot was taken.  Host side things
+(files, video mode, sound card, etc.) are left as they are.
+*/
+
+int interf_serialise(module_data *what, snap_data *snap)
+{
+    snap_put32(snap,interf_tape_in_bufsize);
+    snap_put32(snap,interf_tape_in_pos_byte);
+    snap_put32(snap,interf_tape_in_pos_bit);
+    snap_put32(snap,interf_tape_in_pos_bitcnt);
+    snap_put32(snap,interf_tape_in_spedchgbitcht);
+    snap_put32(snap,(UINT_32) interf_tape_in_tapesped);
+    snap_put32(snap,(UINT_32) interf_tape_in_state_fine);
+    snap_put32(snap,(UINT_32) interf_tape_in_bit_fine);
+    snap_put8(snap,interf_tape_in_crc);
+    snap_put32(snap,interf_tape_in_kansascycle);
+    snap_put32(snap,interf_tape_in_elapsed_zclk);
+
+    snap_put32(snap,(UINT_32) interf_tape_out_state_fine);
+    snap_put32(snap,(UINT_32) interf_tape_out_tapefreq);
+    snap_put8(snap,interf_tape_out_byte);
+    snap_put8(snap,interf_tape_out_crc);
+    snap_put32(snap,interf_tape_out_kansascycle);
+    snap_put32(snap,interf_tape_out_elapsed_zclk);
+    snap_put32(snap,(UINT_32) interf_tape_out_hl_state);
+    snap_put8(snap,interf_tape_out_hl_length);
+    snap_put8(snap,interf_tape_out_hl_overall);
+    snap_put8(snap,interf_tape_out_hl_endit);
+
+    snap_put8(snap,(UINT_8) interf_snd_speaker_state);
+    snap_put8(snap,(UINT_8) interf_snd_speaker_state_old);
+    snap_put8(snap,(UINT_8) interf_snd_click_here);
+    snap_put8(snap,(UINT_8) interf_snd_click_next);
+    snap_put8(snap,(UINT_8) interf_snd_click_stop);
+    snap_put8(snap,(UINT_8) interf_snd_tone_here);
+    snap_put32(snap,interf_snd_freq);
+    snap_put64(snap,interf_snd_clkcycle_cnt_a);
+    snap_put64(snap,interf_snd_clkcycle_cnt_b);
+
+    snap_put32(snap,(UINT_32) interf_para_state);
+    snap_put32(snap,interf_para_cycle_cnt);
+    snap_put32(snap,(UINT_32) interf_para_cycle_hold);
+    snap_put8(snap,interf_para_upstat_cnt);
+    snap_put32(snap,(UINT_32) interf_para_havepulsed);
+    snap_put32(snap,(UINT_32) interf_para_havestrobed);
+    snap_put32(snap,(UINT_32) interf_para_trigpulsecnt);
+
+    return snap->error;
+
+    what = NULL;
+}
+
+int interf_deserialise(module_data *what, snap_data *snap)
+{
+    UINT_32 bufsize;
+    UINT_32 pos_byte,pos_bit,pos_bitcnt,spedchgbitcht;
+    int tapesped,state_fine,bit_fine;
+    UINT_8 crc;
+    UINT_32 kansascycle,elapsed_zclk;
+
+    bufsize       = snap_get32(snap);
+    pos_byte      = snap_get32(snap);
+    pos_bit       = snap_get32(snap);
+    pos_bitcnt    = snap_get32(snap);
+    spedchgbitcht = snap_get32(snap);
+    tapesped      = (int) snap_get32(snap);
+    state_fine    = (int) snap_get32(snap);
+    bit_fine      = (int) snap_get32(snap);
+    crc           = snap_get8(snap);
+    kansascycle   = snap_get32(snap);
+    elapsed_zclk  = snap_get32(snap);
+
+    if ( bufsize == interf_tape_in_bufsize )
+    {
+        interf_tape_in_pos_byte      = pos_byte;
+        interf_tape_in_pos_bit       = pos_bit;
+        interf_tape_in_pos_bitcnt    = pos_bitcnt;
+        interf_tape_in_spedchgbitcht = spedchgbitcht;
+        interf_tape_in_tapesped      = tapesped;
+        interf_tape_in_state_fine    = state_fine;
+        interf_tape_in_bit_fine      = bit_fine;
+        interf_tape_in_crc           = crc;
+        interf_tape_in_kansascycle   = kansascycle;
+        interf_tape_in_elapsed_zclk  = elapsed_zclk;
+    }
+
+    interf_tape_out_state_fine   = (int) snap_get32(snap);
+    interf_tape_out_tapefreq     = (int) snap_get32(snap);
+    interf_tape_out_byte         = snap_get8(snap);
+    interf_tape_out_crc          = snap_get8(snap);
+    interf_tape_out_kansascycle  = snap_get32(snap);
+    interf_tape_out_elapsed_zclk = snap_get32(snap);
+    interf_tape_out_hl_state     = (int) snap_get32(snap);
+    interf_tape_out_hl_length    = snap_get8(snap);
+    interf_tape_out_hl_overall   = snap_get8(snap);
+    interf_tape_out_hl_endit     = snap_get8(snap);
+
+    interf_snd_speaker_state     = snap_get8(snap);
+    interf_snd_speaker_state_old = snap_get8(snap);
+    interf_snd_click_here        = snap_get8(snap);
+    interf_snd_click_next        = snap_get8(snap);
+    interf_snd_click_stop        = snap_get8(snap);
+    interf_snd_tone_here         = snap_get8(snap);
+    interf_snd_freq              = snap_get32(snap);
+    interf_snd_clkcycle_cnt_a    = snap_get64(snap);
+    interf_snd_clkcycle_cnt_b    = snap_get64(snap);
+
+    interf_para_state        = (int) snap_get32(snap);
+    interf_para_cycle_cnt    = snap_get32(snap);
+    interf_para_cycle_hold   = (int) snap_get32(snap);
+    interf_para_upstat_cnt   = snap_get8(snap);
+    interf_para_havepulsed   = (int) snap_get32(snap);
+    interf_para_havestrobed  = (int) snap_get32(snap);
+    interf_para_trigpulsecnt = (int) snap_get32(snap);
+
+    return snap->error;
+
+    what = NULL;
+}
+
+/*
+Function: interf_input_open(), interf_input_close(), interf_input_get_mode()
+Operation: Start and finish recording or replaying input (see "Input
+record and replay" above), and say which it's doing.
+
+interf_input_open() returns 0 on success (or if input_log is 0), nonzero
+if the file can't be opened or isn't an input log.  Closing a recording
+writes the INTERF_INPUT_END record at the current clock cycle.
+*/
+
+int interf_input_open(void)
+{
+    UINT_8 header[12];
+
+    interf_input_fp    = NULL;
+    interf_input_clock = 0;
+    interf_input_ready = 0;
+    interf_input_keys  = 0;
+    interf_input_para  = 0;
+
+    switch ( interf_input_mode )
+    {
+        case INTERF_INPUT_RECORD:
+        {
+            if ( ( interf_input_fp = fopen(INTERF_INPUT_LOG_FILE,"wb") ) == NULL )
+            {
+                return 1;
+            }
+
+            memcpy(header,INTERF_INPUT_MAGIC,8);
+
+            header[8]  = (UINT_8) (   INTERF_INPUT_VERSION         & 0x0ff );
+            header[9]  = (UINT_8) ( ( INTERF_INPUT_VERSION >> 8  ) & 0x0ff );
+            header[10] = (UINT_8) ( ( INTERF_INPUT_VERSION >> 16 ) & 0x0ff );
+            header[11] = (UINT_8) ( ( INTERF_INPUT_VERSION >> 24 ) & 0x0ff );
+
+            if ( fwrite(header,1,12,interf_input_fp) != 12 )
+            {
+                fclose(interf_input_fp);
+                interf_input_fp = NULL;
+
+                return 1;
+            }
+
+            break;
+        }
+
+        case INTERF_INPUT_REPLAY:
+        {
+            if ( ( interf_input_fp = fopen(INTERF_INPUT_LOG_FILE,"rb") ) == NULL )
+            {
+                return 1;
+            }
+
+            if ( ( fread(header,1,12,interf_input_fp) != 12 )       ||
+                 memcmp(header,INTERF_INPUT_MAGIC,8)                ||
+                 ( header[8]  != ( INTERF_INPUT_VERSION & 0x0ff ) ) ||
+                 header[9] || header[10] || header[11]                 )
+            {
+                fclose(interf_input_fp);
+                interf_input_fp = NULL;
+
+                return 1;
+            }
+
+            interf_input_get();
+
+            break;
+        }
+
+        default:
+        {
+            break;
+        }
+    }
+
+    return 0;
+}
+
+void interf_input_close(void)
+{
+    if ( interf_input_fp != NULL )
+    {
+        if ( interf_input_mode == INTERF_INPUT_RECORD )
+        {
+            interf_input_put(INTERF_INPUT_END,0);
+        }
+
+        fclose(interf_input_fp);
+    }
+
+    interf_input_fp    = NULL;
+    interf_input_ready = 0;
+
+    return;
+}
+
+int interf_input_get_mode(module_data *what)
+{
+    return interf_input_mode;
+
+    what = NULL;
+}
+
+void interf_set_turbo(module_data *what)
+{
+    interf_speed_emu_on = 2;
+
+    return;
+
+    what = NULL;
+}
+
+void interf_set_headless(module_data *what)
+{
+    interf_headless = 1;
+
+    return;
+
+    what = NULL;
+}
+
+int interf_set_key_file(module_data *what, const char *filename)
+{
+    interf_key_setfile(filename);
+
+    return ( interf_key_sourcefp == NULL );
+
+    what = NULL;
+}
+
+char *interf_set_tape_file(module_data *what, char *filename, int tapesped)
+{
+    return interf_tape_in_pipe_data(filename,tapesped);
+
+    what = NULL;
+}
+
+/*
+Function: interf_input_put(), interf_input_get()
+Operation: Write a record stamped with the current clock cycle, and read
+the next record to be replayed into interf_input_next_*.
+
+If the log runs out (or is cut short) interf_input_ready is cleared and
+the replay just carries on with no more input.
+*/
+
+void interf_input_put(UINT_8 type, UINT_64 data)
+{
+    UINT_8 rec[INTERF_INPUT_REC_SIZE];
+    int i;
+
+    if ( interf_input_fp == NULL )
+    {
+        return;
+    }
+
+    for ( i = 0 ; i < 8 ; i++ )
+    {
+        rec[i]   = (UINT_8) ( ( interf_input_clock >> (8*i) ) & 0x0ff );
+        rec[i+9] = (UINT_8) ( ( data               >> (8*i) ) & 0x0ff );
+    }
+
+    rec[8] = type;
 
-            interf_tape_out_reset_state_after_block();
+    fwrite(rec,1,INTERF_INPUT_REC_SIZE,interf_input_fp);
 
-            if ( interf_tape_autosave_mode )
-            {
-                interf_tape_out_reset_state_after_file();
-            }
-        }
+    return;
+}
 
-        /*
-           Input cycle
-        */
+void interf_input_get(void)
+{
+    UINT_8 rec[INTERF_INPUT_REC_SIZE];
+    int i;
 
-        if ( interf_tape_in_type && ( interf_tape_in_elapsed_zclk >= interf_tape_lower[1] ) )
-        {
-            if ( interf_tape_in_kansascycle == 0 )
-            {
-                interf_tape_in_elapsed_zclk = 0;
+    interf_input_ready = 0;
 
-                /*
-                   0 is used to signify that the process has just started (this
-                   is needed to make cycles HL, not LH).  Thus we need to set
-                   the bit to 1 to get things started.
-                */
+    if ( ( interf_input_fp == NULL ) || ( fread(rec,1,INTERF_INPUT_REC_SIZE,interf_input_fp) != INTERF_INPUT_REC_SIZE ) )
+    {
+        return;
+    }
 
-                INTERF_TAPE_INSTATE(what) = 1;
-                INTERF_TAPE_STROBE(what);
-                interf_tape_in_state_fine = 1;
+    interf_input_next_clock = 0;
+    interf_input_next_data  = 0;
 
-                interf_tape_in_kansascycle = 1;
+    for ( i = 7 ; i >= 0 ; i-- )
+    {
+        interf_input_next_clock = ( interf_input_next_clock << 8 ) | rec[i];
+        interf_input_next_data  = ( interf_input_next_data  << 8 ) | rec[i+9];
+    }
 
-                /*
-                   Get bit from the bit buffer.
-                */
+    interf_input_next_type = rec[8];
+    interf_input_ready     = 1;
 
-                INTERF_TAPE_IN_GETBITFROMBUFF(interf_tape_in_bit_fine);
-            }
+    return;
+}
 
-            else
-            {
-                if ( interf_tape_in_elapsed_zclk >= interf_tape_cycles[interf_tape_in_bit_fine][interf_tape_in_state_fine] )
-                {
-                    /*
-                       OK, current cycle done.
-                    */
+/*
+Function: interf_input_replay()
+Operation: Make every logged change that is due at or before the current
+clock cycle.
 
-                    interf_tape_in_elapsed_zclk -= interf_tape_cycles[interf_tape_in_bit_fine][interf_tape_in_state_fine];
+interf_horizon() makes sure that each run of the z80 stops at the clock
+cycle of the next record, so in practice records are never late.
+*/
 
-                    /*
-                       Invert the state, and update the cycle counter if this
-                       was a low->high transition.
-                    */
+void interf_input_replay(module_data *what)
+{
+    int i;
 
-                    if ( interf_tape_in_state_fine )
-                    {
-                        INTERF_TAPE_INSTATE(what) = 0;
-                        INTERF_TAPE_STROBE(what);
-                        interf_tape_in_state_fine = 0;
-                    }
+    while ( interf_input_ready && ( interf_input_next_clock <= interf_input_clock ) )
+    {
+        switch ( interf_input_next_type )
+        {
+            case INTERF_INPUT_KEYS:
+            {
+                for ( i = 0 ; i < 64 ; i++ )
+                {
+                    DEBDEREF(interf_key_worktable,(i<<4)+1) = (UINT_8) ( ( interf_input_next_data >> i ) & 1 );
+                }
 
-                    else
-                    {
-                        INTERF_TAPE_INSTATE(what) = 1;
-                        INTERF_TAPE_STROBE(what);
-                        interf_tape_in_state_fine = 1;
+                interf_key_update_lpen(what);
 
-                        interf_tape_in_kansascycle++;
-                    }
+                break;
+            }
 
-                    if ( interf_tape_in_kansascycle > interf_tape_count[interf_tape_in_tapesped][interf_tape_in_bit_fine] )
-                    {
-                        /*
-                           Current bit is done, get the next one.
-                        */
+            case INTERF_INPUT_RESET:
+            {
+                if ( interf_input_next_data ) { INTERF_CTRL_RESET_ON(what);  }
+                else                          { INTERF_CTRL_RESET_OFF(what); }
 
-                        INTERF_TAPE_IN_GETBITFROMBUFF(interf_tape_in_bit_fine);
+                break;
+            }
 
-                        /*
-                           Reset the counter (1 start deliberate)
-                        */
+            case INTERF_INPUT_TAPE:
+            {
+                INTERF_TAPE_INSTATE(what) = (UINT_8) ( interf_input_next_data & 1 );
+                INTERF_TAPE_STROBE(what);
 
-                        interf_tape_in_kansascycle = 1;
+                break;
+            }
 
-                        /*
-                           Change to 1200baud if trigger hit
-                        */
+            case INTERF_INPUT_PARA:
+            {
+                INTERF_PARA_DATA_BUS_OUT(what) = (UINT_8) (   interf_input_next_data        & 0x0ff );
+                INTERF_PARA_STRB_BUS_OUT(what) = (UINT_8) ( ( interf_input_next_data >> 8 ) & 0x0ff );
+                INTERF_PARA_STROBE(what);
 
-                        if ( interf_tape_in_pos_bitcnt == interf_tape_in_spedchgbitcht )
-                        {
-                            interf_tape_in_tapesped = 1;
-                        }
-                    }
-                }
+                break;
             }
 
-            if ( interf_tape_in_pos_bitcnt >= interf_tape_in_bufsize )
+            default:
             {
                 /*
-                   This will actually cut the final stop bit off the final
-                   transmitted byte.  That's why the buffer is always padded
-                   with a NULL at the end, so only the (unimportant) NULL
-                   character is affected.
+                   End of the recording.
                 */
 
-                INTERF_TAPE_INSTATE(what) = 0;
-                INTERF_TAPE_STROBE(what);
-                interf_tape_in_state_fine = 0;
+                interf_input_close();
 
-                interf_tape_in_reset_state();
+                INTERF_CTRL_EXIT(what);
+
+                return;
             }
         }
+
+        interf_input_get();
     }
 
-    /*
-       Screen cycling
-    */
+    return;
+}
+
+/*
+Function: interf_input_record_keys(), interf_tape_in_edge(),
+          interf_para_in_strobe()
+Operation: Pass input from the host on to the microbee, recording it if
+input_log is 1.
+
+interf_input_record_keys() packs the "is down" bytes of the key worktable
+into a 64 bit matrix and records it if it has changed.
+interf_tape_in_edge() sets the tape input line and strobes it.
+interf_para_in_strobe() strobes whatever is on the parallel port input
+buses.
+*/
+
+void interf_input_record_keys(void)
+{
+    UINT_64 keys = 0;
+    int i;
 
+    for ( i = 0 ; i < 64 ; i++ )
     {
-        if ( interf_interact_flag || interf_scrn_stepmode )
+        if ( DEBDEREF(interf_key_worktable,(i<<4)+1) )
         {
-            /*
-               Enter interactive mode.
-            */
-
-            interf_is_in_menu_mode = 1;
-            INTERF_CTRL_PAUSE_EMU(what);
-            #ifdef IS_ALLEGRO
-            {
-                interf_menu_enter();
-            }
-            #endif
-            INTERF_CTRL_RESTART_EMU(what);
-            interf_is_in_menu_mode = 0;
+            keys |= ( ((UINT_64) 1) << i );
         }
+    }
 
-        interf_interact_flag = 0;
+    if ( keys != interf_input_keys )
+    {
+        interf_input_keys = keys;
+
+        interf_input_put(INTERF_INPUT_KEYS,keys);
     }
 
-    #ifdef IS_WEB
+    return;
+}
+
+void interf_tape_in_edge(module_data *what, UINT_8 state)
+{
+    INTERF_TAPE_INSTATE(what) = state;
+    INTERF_TAPE_STROBE(what);
+
+    if ( interf_input_mode == INTERF_INPUT_RECORD )
     {
-        /*
-           Under allegro, the menu is only available when the emulation is
-           paused.  See interf_menu_enter() for more info.  Not sure if this
-           is optimal for the web based version.  See call for
-           interf_menu_enter above.
-        */
+        interf_input_put(INTERF_INPUT_TAPE,state);
     }
-    #endif
 
-    if ( interf_prtscr_flag )
+    return;
+}
+
+void interf_para_in_strobe(module_data *what)
+{
+    UINT_64 para;
+
+    INTERF_PARA_STROBE(what);
+
+    if ( interf_input_mode == INTERF_INPUT_RECORD )
     {
-        /*
-           Save screen snapshot.
-        */
+        para = ( ((UINT_64) INTERF_PARA_STRB_BUS_OUT(what)) << 8 ) | INTERF_PARA_DATA_BUS_OUT(what);
 
-        interf_scrn_screenshot(DEFAULT_SCREENDUMP_FILE);
+        if ( para != interf_input_para )
+        {
+            interf_input_para = para;
 
-        interf_prtscr_flag = 0;
+            interf_input_put(INTERF_INPUT_PARA,para);
+        }
     }
 
     return;
-
-    clock_div = 0;
 }
 
-char *interf_getinf(module_data *what)
+/*
+Function: interf_key_update_lpen()
+Operation: Start the lightpen countdown for any key that has just gone
+down in the key worktable, and work out interf_key_keydown.
+*/
+
+void interf_key_update_lpen(module_data *what)
 {
-    char *dest;
+    UINT_16 i;
 
-    dest = DEBMALLOC(10*sizeof(UINT_8));
+    interf_key_keydown = 0;
 
-    sprintf(dest,"\n");
+    for ( i = 0x00000 ; i <= 0x003F0 ; i += 0x00010 )
+    {
+        if ( DEBDEREF(interf_key_worktable,i+1) & !DEBDEREF(INTERF_KEY_LPEN_TABLE(what),i) )
+        {
+            /* Key has just been pressed. */
+            /* -= start the counter =- */
+            DEBDEREF(INTERF_KEY_LPEN_TABLE(what),i) = 1;
+            DEBDEREF(interf_key_worktable,i+2)      = interf_key_clkcnt_max;
+            DEBDEREF(INTERF_KEY_FEEDBACK_TABLE(what),i) = 0;
+            DEBDEREF(INTERF_KEY_FEEDRFSH_TABLE(what),i) = 0;
+        }
 
-    return dest;
+        interf_key_keydown |= DEBDEREF(INTERF_KEY_LPEN_TABLE(what),i);
+    }
 
-    what = NULL;
+    return;
 }
 
 int interf_para_set_mode0(void)
@@ -4450,6 +5325,7 @@ int interf_para_set_mode4(void)
     interf_para_state = 0;
 
     interf_para_cycle_cnt  = 0;
+    interf_para_cycle_hold = 0;
     interf_para_upstat_cnt = 0;
 
     if ( interf_para_dest_fp != NULL )
@@ -4486,6 +5362,12 @@ int interf_para_set_mode5(void)
 
 void interf_para_data_written(void *what)
 {
+    int para_state_old;
+
+    INTERF_CATCH_UP(what);
+
+    para_state_old = interf_para_state;
+
     switch ( interf_para_mode )
     {
         case 0:
@@ -4625,6 +5507,18 @@ void interf_para_data_written(void *what)
         }
     }
 
+    /*
+       If a handshake has just been started then the next event has been
+       brought forward, so the current cpu run needs to be cut short.
+    */
+
+    if ( ( interf_para_state == 1 ) && ( para_state_old == 0 ) )
+    {
+        interf_para_cycle_hold = 1;
+
+        INTERF_CTRL_END_RUN(what);
+    }
+
     return;
 }
 
@@ -4676,6 +5570,8 @@ void interf_speaker_state_change(void *what)
 {
     UINT_32 freq_temp;
 
+    INTERF_CATCH_UP(what);
+
     if ( interf_snd_sndon )
     {
         /*
@@ -5637,6 +6533,8 @@ void interf_tape_out_send_byte(void)
 
 void interf_tape_state_change(void *what)
 {
+    INTERF_CATCH_UP(what);
+
     if ( interf_tape_out_state_fine != INTERF_TAPE_OUTSTATE(what) )
     {
         /*
@@ -7874,6 +8772,25 @@ int interf_scrn_set_vidmode(int what)
     }    
     #endif
 
+    #ifdef IS_WEB
+    {
+        /*
+           There is no real display, so just pretend to be the smallest
+           mode so that the margin corrections have something to work with.
+        */
+
+        interf_scrn_video_mode = what;
+
+        interf_scrn_physical_width  = 640;
+        interf_scrn_physical_height = 480;
+
+        interf_scrn_horiz_line_mult = 1;
+        interf_scrn_vert_line_mult  = 1;
+
+        interf_scrn_multip_fill = 0;
+    }
+    #endif
+
     return 0;
 
     what = NULL;
@@ -7952,6 +8869,13 @@ int interf_menu_setcontrastx(void *dp3, int d2);
 
 int interf_menu_cpuclkon(void);
 int interf_menu_cpuclkoff(void);
+int interf_menu_cpuclkturbo(void);
+int interf_menu_dcacheon(void);
+int interf_menu_dcacheoff(void);
+int interf_menu_tracedump(void);
+int interf_menu_snapsave(void);
+int interf_menu_snapload(void);
+int interf_menu_rewind(void);
 int interf_menu_stepreturn(void);
 int interf_menu_prtscrn(void);
 int interf_menu_return(void);
@@ -8003,12 +8927,25 @@ int interf_menu_tapestopload(void);
 
 char interf_menu_main_clock_stra[] = "- CPU clock speed &normal (3.141 MHz).";
 char interf_menu_main_clock_strb[] = "- CPU clock speed &unlimited.";
+char interf_menu_main_clock_stre[] = "- CPU clock speed tur&bo (benchmark).";
+char interf_menu_main_clock_strc[] = "- CPU decode cache o&n.";
+char interf_menu_main_clock_strd[] = "- CPU decode cache o&ff.";
 
 MENU interf_menu_main_clock[] =
 {
-    { interf_menu_main_clock_stra, interf_menu_cpuclkon,  NULL, 0, NULL },
-    { interf_menu_main_clock_strb, interf_menu_cpuclkoff, NULL, 0, NULL },
-    { NULL,                        NULL,                  NULL, 0, NULL }
+    { interf_menu_main_clock_stra, interf_menu_cpuclkon,    NULL, 0, NULL },
+    { interf_menu_main_clock_strb, interf_menu_cpuclkoff,   NULL, 0, NULL },
+    { interf_menu_main_clock_stre, interf_menu_cpuclkturbo, NULL, 0, NULL },
+    { "",                          NULL,                    NULL, 0, NULL },
+    { interf_menu_main_clock_strc, interf_menu_dcacheon,    NULL, 0, NULL },
+    { interf_menu_main_clock_strd, interf_menu_dcacheoff,   NULL, 0, NULL },
+    { "",                          NULL,                    NULL, 0, NULL },
+    { "  Dump CPU &trace.",        interf_menu_tracedump,   NULL, 0, NULL },
+    { "",                          NULL,                    NULL, 0, NULL },
+    { "  &Save machine state.",    interf_menu_snapsave,    NULL, 0, NULL },
+    { "  &Load machine state.",    interf_menu_snapload,    NULL, 0, NULL },
+    { "  Re&wind 1 second.",       interf_menu_rewind,      NULL, 0, NULL },
+    { NULL,                        NULL,                    NULL, 0, NULL }
 };
 
 MENU interf_menu_main[] =
@@ -8950,9 +9887,19 @@ void interf_menu_update_menu_marks(void)
     {
         interf_menu_main_clock_stra[0] = ' ';
         interf_menu_main_clock_strb[0] = ' ';
+        interf_menu_main_clock_stre[0] = ' ';
 
-        if ( interf_speed_emu_on ) { interf_menu_main_clock_stra[0] = '-'; }
-        else                       { interf_menu_main_clock_strb[0] = '-'; }
+        if      ( interf_speed_emu_on == 2 ) { interf_menu_main_clock_stre[0] = '-'; }
+        else if ( interf_speed_emu_on      ) { interf_menu_main_clock_stra[0] = '-'; }
+        else                                 { interf_menu_main_clock_strb[0] = '-'; }
+    }
+
+    {
+        interf_menu_main_clock_strc[0] = ' ';
+        interf_menu_main_clock_strd[0] = ' ';
+
+        if ( interf_dcache_on ) { interf_menu_main_clock_strc[0] = '-'; }
+        else                    { interf_menu_main_clock_strd[0] = '-'; }
     }
 
     {
@@ -9095,6 +10042,67 @@ int interf_menu_cpuclkoff(void)
     return D_O_K;
 }
 
+int interf_menu_cpuclkturbo(void)
+{
+    INTERF_CTRL_TURBO(interf_indir_nonvol);
+
+    interf_speed_emu_on = 2;
+
+    interf_menu_update_menu_marks();
+
+    return D_O_K;
+}
+
+int interf_menu_dcacheon(void)
+{
+    INTERF_CTRL_DCACHE_ON(interf_indir_nonvol);
+
+    interf_dcache_on = 1;
+
+    interf_menu_update_menu_marks();
+
+    return D_O_K;
+}
+
+int interf_menu_dcacheoff(void)
+{
+    INTERF_CTRL_DCACHE_OFF(interf_indir_nonvol);
+
+    interf_dcache_on = 0;
+
+    interf_menu_update_menu_marks();
+
+    return D_O_K;
+}
+
+int interf_menu_tracedump(void)
+{
+    INTERF_CTRL_TRACE_DUMP(interf_indir_nonvol);
+
+    return D_O_K;
+}
+
+int interf_menu_snapsave(void)
+{
+    INTERF_CTRL_SNAP_SAVE(interf_indir_nonvol);
+
+    return D_O_K;
+}
+
+int interf_menu_snapload(void)
+{
+    INTERF_CTRL_SNAP_LOAD(interf_indir_nonvol);
+
+    return D_O_K;
+}
+
+int interf_menu_rewind(void)
+{
+    INTERF_CTRL_REWIND(interf_indir_nonvol);
+
+    return D_O_K;
+}
+
 int interf_menu_stepreturn(void)
 {
     interf_scrn_stepmode = 1;
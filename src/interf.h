@@ -117,12 +117,80 @@ outgoing functions: == graphics functions ==
                     == tape interface functions ==
                     outfn9  called to indicate a (possible) change in the
                             state of the tape input state bus (busa16).
+                    == cpu control functions ==
+                    outfn10 called to turn the cpu decode cache on.
+                    outfn11 called to turn the cpu decode cache off.
+                    outfn12 called when an io write has brought the next
+                            interf event forward, to end the current cpu
+                            run early.
+                    outfn13 called to stop the cpu skipping idle time.
+                    outfn14 called to make the cpu skip time in HALT.
+                    outfn15 called to make the cpu skip time in HALT and in
+                            idle loops.
+                    outfn16 called to dump the cpu trace (from the menu).
+                    == snapshot functions ==
+                    outfn17 called to save the machine state (from the
+                            menu).
+                    outfn18 called to load the machine state (from the
+                            menu).
+                    outfn19 called to rewind the machine one second (from
+                            the menu).
+                    outfn20 called to turn turbo (benchmark) mode on.  This
+                            is turned off again by outfn2 or outfn3.
+                    == clock functions ==
+                    outfn21 called before the parallel port, speaker or
+                            tape output buses are looked at, to clock the
+                            interface up to where the cpu is in its run.
+
+
+
+Module is clocked.  interf_horizon gives the number of clock cycles until
+the next thing interf_cycle will do that depends on the clock (keyboard
+refresh, parallel port handshaking, tape edges and timeouts, and so on),
+or INTERF_HORIZON_NONE if there is nothing coming up.  Clocking the module
+in one big step up to the step in which the horizon falls gives the same
+result as clocking it in lots of small steps over the same time.  Things
+driven by the host (keypresses, the menu etc.) are dealt with whenever
+interf_cycle is next called.  While a key file is being typed the horizon
+is always 1, as each call may press or release the next key.
+
+interf_key_down returns non-zero if any key is down in the lightpen table
+(busa4), so that the 6545 could strobe the lightpen on any cycle.  The
+table is only changed by interf_cycle.
+
+interf_serialise/interf_deserialise save and load the tape, speaker and
+parallel port state in a snapshot section (see modules.h), version
+INTERF_SNAP_VERSION.  The tape in position is only put back if the same
+size tape is loaded.  Files, video and sound card settings aren't saved.
+
+interf_input_get_mode returns the input_log setting (INTERF_INPUT_OFF,
+INTERF_INPUT_RECORD or INTERF_INPUT_REPLAY), which is OFF if the log
+couldn't be opened.  Host input (keys, reset, tape and parallel port in)
+is recorded to or replayed from a log stamped with z80 clock cycles - see
+interf.c for the details.  It's only valid after interf_init.
+
+interf_set_turbo makes interf_go start in turbo (benchmark) mode rather
+than with speed emulation off.  Like the "CPU clock rate" menu, it calls
+outfn20 to do this.  It must be called between interf_alloc and interf_go.
+
+interf_set_headless makes interf_go start with speed emulation off (unless
+turbo mode was asked for), as for replaying, for scripted runs.  It must be
+called between interf_alloc and interf_go.  interf_set_key_file and
+interf_set_tape_file do what the "Keyboard" and "Tape in" menus do: the
+first types the keystrokes in filename (returning nonzero if it can't be
+opened), the second pipes filename in through the tape port at 300 baud
+(tapesped 0) or 1200 baud (tapesped 1), returning NULL or a description of
+the error.  Both must be called after interf_go.
 
+*/
 
+#define INTERF_HORIZON_NONE     0x0ffffffff
 
-Module is clocked.
+#define INTERF_SNAP_VERSION     1
 
-*/
+#define INTERF_INPUT_OFF        0
+#define INTERF_INPUT_RECORD     1
+#define INTERF_INPUT_REPLAY     2
 
 
 module_data *interf_alloc(const char *module_name);
@@ -131,7 +199,16 @@ void         interf_go(module_data *what);
 void         interf_stop(module_data *what);
 void         interf_remove(module_data *what);
 void         interf_cycle(module_data *what, UINT_16 num_cycles, UINT_8 clock_div, int lsync_point);
+UINT_32      interf_horizon(module_data *what);
+int          interf_key_down(module_data *what);
 char        *interf_getinf(module_data *what);
+int          interf_serialise(module_data *what, snap_data *snap);
+int          interf_deserialise(module_data *what, snap_data *snap);
+int          interf_input_get_mode(module_data *what);
+void         interf_set_turbo(module_data *what);
+void         interf_set_headless(module_data *what);
+int          interf_set_key_file(module_data *what, const char *filename);
+char        *interf_set_tape_file(module_data *what, char *filename, int tapesped);
 
 
 #ifdef IS_WEB
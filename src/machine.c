@@ -0,0 +1,1396 @@
+
+#include "machine.h"
+#include "u_dtype.h"
+#include "debmaloc.h"
+#include "modules.h"
+#include "beefile.h"
+#include "genmod.h"
+#include "interf.h"
+#include "6545.h"
+#include "z80cpu.h"
+#include "z80pio.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+/*
+
+                          Machine Descriptions
+                          ====================
+
+*/
+
+
+/*
+   Module types that can appear in a module statement.
+*/
+
+struct Machine_Type
+{
+    const char    *name;
+    module_data *(*alloc)(const char *module_name);
+    int          (*init)(module_data *what);
+    void         (*go)(module_data *what);
+    void         (*stop)(module_data *what);
+    void         (*remove)(module_data *what);
+};
+
+#define MACHINE_TYPE(modname) { #modname, modname##_alloc, modname##_init, modname##_go, modname##_stop, modname##_remove }
+
+static const machine_type machine_types[] =
+{
+    MACHINE_TYPE(nullmod),
+    MACHINE_TYPE(domod),
+    MACHINE_TYPE(dowhilemod),
+    MACHINE_TYPE(table8mod),
+    MACHINE_TYPE(lut8mod),
+    MACHINE_TYPE(busmod),
+    MACHINE_TYPE(memmod),
+    MACHINE_TYPE(setbusmod),
+    MACHINE_TYPE(istruemod),
+    MACHINE_TYPE(equalsmod),
+    MACHINE_TYPE(greatermod),
+    MACHINE_TYPE(lessmod),
+    MACHINE_TYPE(equalsconstmod),
+    MACHINE_TYPE(greaterconstmod),
+    MACHINE_TYPE(lessconstmod),
+    MACHINE_TYPE(assignmod),
+    MACHINE_TYPE(notmod),
+    MACHINE_TYPE(twosmod),
+    MACHINE_TYPE(addmod),
+    MACHINE_TYPE(submod),
+    MACHINE_TYPE(mulmod),
+    MACHINE_TYPE(divmod),
+    MACHINE_TYPE(modmod),
+    MACHINE_TYPE(andmod),
+    MACHINE_TYPE(ormod),
+    MACHINE_TYPE(xormod),
+    MACHINE_TYPE(rrmod),
+    MACHINE_TYPE(rlmod),
+    MACHINE_TYPE(srmod),
+    MACHINE_TYPE(slmod),
+    MACHINE_TYPE(assignconstmod),
+    MACHINE_TYPE(addconstmod),
+    MACHINE_TYPE(subconstamod),
+    MACHINE_TYPE(subconstbmod),
+    MACHINE_TYPE(mulconstmod),
+    MACHINE_TYPE(divconstamod),
+    MACHINE_TYPE(divconstbmod),
+    MACHINE_TYPE(modconstamod),
+    MACHINE_TYPE(modconstbmod),
+    MACHINE_TYPE(andconstmod),
+    MACHINE_TYPE(orconstmod),
+    MACHINE_TYPE(xorconstmod),
+    MACHINE_TYPE(rrconstamod),
+    MACHINE_TYPE(rrconstbmod),
+    MACHINE_TYPE(rlconstamod),
+    MACHINE_TYPE(rlconstbmod),
+    MACHINE_TYPE(srconstamod),
+    MACHINE_TYPE(srconstbmod),
+    MACHINE_TYPE(slconstamod),
+    MACHINE_TYPE(slconstbmod),
+    MACHINE_TYPE(interf),
+    MACHINE_TYPE(sy6545),
+    MACHINE_TYPE(z80cpu),
+    MACHINE_TYPE(z80pio),
+    { NULL, NULL, NULL, NULL, NULL, NULL }
+};
+
+
+/*
+   Slots.  A slot is written module.<prefix>N, or host.<name> for
+   something provided by the emulator.
+*/
+
+#define MACHINE_SLOT_VAR        0
+#define MACHINE_SLOT_SVAR       1
+#define MACHINE_SLOT_BUS        2
+#define MACHINE_SLOT_MOD        3
+#define MACHINE_SLOT_INFN       4
+#define MACHINE_SLOT_OUTFN      5
+#define MACHINE_SLOT_HOST       6
+
+#define MACHINE_HOST_SRC        0x0FFFFFFFFUL
+#define MACHINE_MAX_TOKENS      64
+
+typedef struct
+{
+    UINT_8  kind;
+    UINT_8  size;
+    UINT_32 mod;
+    UINT_64 num;
+}
+machine_slot;
+
+static const struct
+{
+    const char *prefix;
+    UINT_8      kind;
+    UINT_8      size;
+}
+machine_slot_names[] =
+{
+    { "vara",  MACHINE_SLOT_VAR,   0 },
+    { "varb",  MACHINE_SLOT_VAR,   1 },
+    { "varc",  MACHINE_SLOT_VAR,   2 },
+    { "svar",  MACHINE_SLOT_SVAR,  0 },
+    { "busa",  MACHINE_SLOT_BUS,   0 },
+    { "busb",  MACHINE_SLOT_BUS,   1 },
+    { "busc",  MACHINE_SLOT_BUS,   2 },
+    { "mod",   MACHINE_SLOT_MOD,   0 },
+    { "infn",  MACHINE_SLOT_INFN,  0 },
+    { "outfn", MACHINE_SLOT_OUTFN, 0 },
+    { NULL,    0,                  0 }
+};
+
+extern UINT_8  *global_8dummyptr;
+extern UINT_16 *global_16dummyptr;
+extern UINT_32 *global_32dummyptr;
+
+void global_nothingfn(void *what);
+
+static int machine_fail(machine_data *mach, UINT_32 line, const char *what, const char *text);
+static char *machine_strdup(const char *text);
+static int machine_number(const char *text, UINT_64 *value);
+static UINT_32 machine_index(machine_data *mach, const char *name);
+static int machine_parse_slot(machine_data *mach, UINT_32 line, const char *text, machine_slot *slot);
+static int machine_add_module(machine_data *mach, UINT_32 line, char **tok, int num_tok);
+static int machine_set_vars(machine_data *mach, UINT_32 line, char **tok, int num_tok);
+static int machine_set_string(machine_data *mach, UINT_32 line, char **tok, int num_tok, const char *rest);
+static int machine_add_link(machine_data *mach, UINT_32 line, char **tok, int num_tok);
+static int machine_is_bus(machine_data *mach, UINT_32 n);
+static int machine_in_arena(machine_data *mach, UINT_32 n);
+static int machine_arena_add(machine_data *mach, UINT_32 n);
+static int machine_add_arena(machine_data *mach, UINT_32 line, char **tok, int num_tok);
+static int machine_statement(machine_data *mach, UINT_32 line, char *text);
+static int machine_make_link(machine_data *mach, machine_link *link);
+static void machine_repoint(machine_data *mach, UINT_32 n, busmod_store *dest);
+static int machine_build_arena(machine_data *mach);
+static int machine_cat(char **dest, UINT_32 *size, const char *text);
+static void *machine_grow(void *what, size_t old_size, size_t new_size);
+static int machine_unconnected(module_data *mod, int kind, UINT_64 num);
+static int machine_report(char **dest, UINT_32 *size, int *hdr, const char *name, module_data *mod, int kind);
+
+
+/*
+   Error messages are "file line N: what text".  line 0 is used for
+   problems that don't belong to a particular line.
+*/
+
+static int machine_fail(machine_data *mach, UINT_32 line, const char *what, const char *text)
+{
+    if ( line > 0 )
+    {
+        sprintf(mach->error,"%.100s line %lu: %.60s%.64s",mach->filename,(unsigned long) line,what,text);
+    }
+
+    else
+    {
+        sprintf(mach->error,"%.100s: %.60s%.64s",mach->filename,what,text);
+    }
+
+    return 1;
+}
+
+/*
+   Arrays are grown by copying into a new block, as there is no
+   DEBMALLOC equivalent of realloc.  Returns NULL (leaving what alone) if
+   out of memory.
+*/
+
+static void *machine_grow(void *what, size_t old_size, size_t new_size)
+{
+    void *result;
+
+    if ( ( result = DEBMALLOC(new_size) ) != NULL )
+    {
+        if ( what != NULL )
+        {
+            memcpy(result,what,old_size);
+            DEBFREE(what);
+        }
+    }
+
+    return result;
+}
+
+static char *machine_strdup(const char *text)
+{
+    char *result;
+
+    if ( ( result = (char *) DEBMALLOC((strlen(text)+1)*sizeof(char)) ) != NULL )
+    {
+        strcpy(result,text);
+    }
+
+    return result;
+}
+
+static int machine_number(const char *text, UINT_64 *value)
+{
+    char *end;
+
+    if ( ( *text < '0' ) || ( *text > '9' ) )
+    {
+        return 1;
+    }
+
+    *value = (UINT_64) strtoul(text,&end,0);
+
+    return ( *end != '\0' );
+}
+
+static UINT_32 machine_index(machine_data *mach, const char *name)
+{
+    UINT_32 i;
+
+    for ( i = 0 ; i < mach->num_mods ; i++ )
+    {
+        if ( strcmp(DEBDEREF((mach->names),i),name) == 0 )
+        {
+            return i;
+        }
+    }
+
+    return MACHINE_HOST_SRC;
+}
+
+static int machine_parse_slot(machine_data *mach, UINT_32 line, const char *text, machine_slot *slot)
+{
+    char name[MACHINE_NAME_SIZE+1];
+    const char *dot;
+    const char *tail;
+    size_t len;
+    int i;
+
+    if ( ( ( dot = strchr(text,'.') ) == NULL ) || ( (size_t) (dot-text) > MACHINE_NAME_SIZE ) )
+    {
+        return machine_fail(mach,line,"expected module.slot, not ",text);
+    }
+
+    strncpy(name,text,dot-text);
+    name[dot-text] = '\0';
+    tail = dot+1;
+
+    if ( strcmp(name,"host") == 0 )
+    {
+        for ( i = 0 ; ( mach->host != NULL ) && ( (mach->host)[i].name != NULL ) ; i++ )
+        {
+            if ( strcmp((mach->host)[i].name,tail) == 0 )
+            {
+                slot->kind = MACHINE_SLOT_HOST;
+                slot->size = 0;
+                slot->mod  = MACHINE_HOST_SRC;
+                slot->num  = i;
+
+                return 0;
+            }
+        }
+
+        return machine_fail(mach,line,"the emulator doesn't provide ",text);
+    }
+
+    if ( ( slot->mod = machine_index(mach,name) ) == MACHINE_HOST_SRC )
+    {
+        return machine_fail(mach,line,"unknown module in ",text);
+    }
+
+    for ( i = 0 ; machine_slot_names[i].prefix != NULL ; i++ )
+    {
+        len = strlen(machine_slot_names[i].prefix);
+
+        if ( ( strncmp(tail,machine_slot_names[i].prefix,len) == 0 ) && !machine_number(tail+len,&(slot->num)) )
+        {
+            slot->kind = machine_slot_names[i].kind;
+            slot->size = machine_slot_names[i].size;
+
+            return 0;
+        }
+    }
+
+    return machine_fail(mach,line,"unknown slot ",text);
+}
+
+
+/*
+   module <name> <type> [<id>]
+*/
+
+static int machine_add_module(machine_data *mach, UINT_32 line, char **tok, int num_tok)
+{
+    const machine_type *type;
+    module_data *mod;
+    char *name;
+    char *id;
+    void *grow;
+    UINT_32 size;
+
+    if ( ( num_tok < 3 ) || ( num_tok > 4 ) )
+    {
+        return machine_fail(mach,line,"expected module <name> <type> [<id>]","");
+    }
+
+    if ( ( strlen(tok[1]) > MACHINE_NAME_SIZE ) || ( strchr(tok[1],'.') != NULL ) || ( strcmp(tok[1],"host") == 0 ) )
+    {
+        return machine_fail(mach,line,"bad module name ",tok[1]);
+    }
+
+    if ( machine_index(mach,tok[1]) != MACHINE_HOST_SRC )
+    {
+        return machine_fail(mach,line,"module declared twice: ",tok[1]);
+    }
+
+    for ( type = machine_types ; type->name != NULL ; type++ )
+    {
+        if ( strcmp(type->name,tok[2]) == 0 )
+        {
+            break;
+        }
+    }
+
+    if ( type->name == NULL )
+    {
+        return machine_fail(mach,line,"unknown module type ",tok[2]);
+    }
+
+    if ( mach->num_mods+1 >= mach->size_mods )
+    {
+        size = ( mach->size_mods == 0 ) ? 64 : 2*mach->size_mods;
+
+        if ( ( grow = machine_grow(mach->mods,mach->size_mods*sizeof(module_data *),size*sizeof(module_data *)) ) == NULL ) { return machine_fail(mach,line,"out of memory",""); }
+        mach->mods = (module_data **) grow;
+        if ( ( grow = machine_grow(mach->names,mach->size_mods*sizeof(char *),size*sizeof(char *)) ) == NULL ) { return machine_fail(mach,line,"out of memory",""); }
+        mach->names = (char **) grow;
+        if ( ( grow = machine_grow(mach->types,mach->size_mods*sizeof(machine_type *),size*sizeof(machine_type *)) ) == NULL ) { return machine_fail(mach,line,"out of memory",""); }
+        mach->types = (const machine_type **) grow;
+        if ( ( grow = machine_grow(mach->ids,mach->size_mods*sizeof(char *),size*sizeof(char *)) ) == NULL ) { return machine_fail(mach,line,"out of memory",""); }
+        mach->ids = (char **) grow;
+
+        mach->size_mods = size;
+    }
+
+    name = machine_strdup(tok[1]);
+    id   = machine_strdup(( num_tok == 4 ) ? tok[3] : "");
+
+    if ( ( name == NULL ) || ( id == NULL ) || ( ( mod = (type->alloc)(id) ) == NULL ) )
+    {
+        if ( name != NULL ) { DEBFREE(name); }
+        if ( id   != NULL ) { DEBFREE(id);   }
+
+        return machine_fail(mach,line,"unable to allocate module ",tok[1]);
+    }
+
+    DEBDEREF((mach->mods),mach->num_mods)  = mod;
+    DEBDEREF((mach->names),mach->num_mods) = name;
+    DEBDEREF((mach->types),mach->num_mods) = type;
+    DEBDEREF((mach->ids),mach->num_mods)   = id;
+
+    (mach->num_mods)++;
+
+    DEBDEREF((mach->mods),mach->num_mods) = NULL;
+
+    return 0;
+}
+
+
+/*
+   var <name>.varaN = <value> [<value> ...]
+*/
+
+static int machine_set_vars(machine_data *mach, UINT_32 line, char **tok, int num_tok)
+{
+    machine_slot slot;
+    module_data *mod;
+    UINT_64 value;
+    UINT_64 num;
+    int i;
+
+    if ( ( num_tok < 4 ) || ( strcmp(tok[2],"=") != 0 ) )
+    {
+        return machine_fail(mach,line,"expected var <name>.<slot> = <value> ...","");
+    }
+
+    if ( machine_parse_slot(mach,line,tok[1],&slot) )
+    {
+        return 1;
+    }
+
+    if ( slot.kind != MACHINE_SLOT_VAR )
+    {
+        return machine_fail(mach,line,"not a variable: ",tok[1]);
+    }
+
+    mod = DEBDEREF((mach->mods),slot.mod);
+
+    switch ( slot.size )
+    {
+        case 0:  { num = mod->num_var_8bit;  break; }
+        case 1:  { num = mod->num_var_16bit; break; }
+        default: { num = mod->num_var_32bit; break; }
+    }
+
+    if ( slot.num+(num_tok-3) > num )
+    {
+        return machine_fail(mach,line,"variable out of range: ",tok[1]);
+    }
+
+    for ( i = 3 ; i < num_tok ; i++ )
+    {
+        if ( machine_number(tok[i],&value) )
+        {
+            return machine_fail(mach,line,"bad value ",tok[i]);
+        }
+
+        switch ( slot.size )
+        {
+            case 0:
+            {
+                if ( value > 0x0FFUL ) { return machine_fail(mach,line,"value too big for 8 bits: ",tok[i]); }
+                DEBDEREF((mod->var_8bit),slot.num+i-3) = (UINT_8) value;
+                break;
+            }
+
+            case 1:
+            {
+                if ( value > 0x0FFFFUL ) { return machine_fail(mach,line,"value too big for 16 bits: ",tok[i]); }
+                DEBDEREF((mod->var_16bit),slot.num+i-3) = (UINT_16) value;
+                break;
+            }
+
+            default:
+            {
+                if ( value > 0x0FFFFFFFFUL ) { return machine_fail(mach,line,"value too big for 32 bits: ",tok[i]); }
+                DEBDEREF((mod->var_32bit),slot.num+i-3) = (UINT_32) value;
+                break;
+            }
+        }
+    }
+
+    return 0;
+}
+
+
+/*
+   string <name>.svarN = <text>
+*/
+
+static int machine_set_string(machine_data *mach, UINT_32 line, char **tok, int num_tok, const char *rest)
+{
+    machine_slot slot;
+    module_data *mod;
+    char *text;
+    void *grow;
+    UINT_32 size;
+
+    if ( ( num_tok < 3 ) || ( strcmp(tok[2],"=") != 0 ) )
+    {
+        return machine_fail(mach,line,"expected string <name>.<slot> = <text>","");
+    }
+
+    if ( machine_parse_slot(mach,line,tok[1],&slot) )
+    {
+        return 1;
+    }
+
+    mod = DEBDEREF((mach->mods),slot.mod);
+
+    if ( ( slot.kind != MACHINE_SLOT_SVAR ) || ( slot.num >= mod->num_stringvars ) )
+    {
+        return machine_fail(mach,line,"no such string variable: ",tok[1]);
+    }
+
+    if ( mach->num_strs >= mach->size_strs )
+    {
+        size = ( mach->size_strs == 0 ) ? 16 : 2*mach->size_strs;
+
+        if ( ( grow = machine_grow(mach->strs,mach->size_strs*sizeof(char *),size*sizeof(char *)) ) == NULL )
+        {
+            return machine_fail(mach,line,"out of memory","");
+        }
+
+        mach->strs      = (char **) grow;
+        mach->size_strs = size;
+    }
+
+    while ( ( *rest == ' ' ) || ( *rest == '\t' ) )
+    {
+        rest++;
+    }
+
+    if ( ( text = machine_strdup(rest) ) == NULL )
+    {
+        return machine_fail(mach,line,"out of memory","");
+    }
+
+    DEBDEREF((mach->strs),mach->num_strs) = text;
+    (mach->num_strs)++;
+
+    DEBDEREF((mod->stringvars),slot.num) = text;
+
+    return 0;
+}
+
+
+/*
+   bus, modptr and call statements.
+*/
+
+static int machine_add_link(machine_data *mach, UINT_32 line, char **tok, int num_tok)
+{
+    machine_link link;
+    machine_slot dest;
+    machine_slot src;
+    void *grow;
+    UINT_32 size;
+
+    if ( ( num_tok != 4 ) || ( strcmp(tok[2],"=") != 0 ) )
+    {
+        return machine_fail(mach,line,"expected ",( strcmp(tok[0],"bus") == 0 ) ? "bus <slot> = <slot>" : ( strcmp(tok[0],"call") == 0 ) ? "call <slot> = <slot>" : "modptr <slot> = <name>");
+    }
+
+    if ( machine_parse_slot(mach,line,tok[1],&dest) )
+    {
+        return 1;
+    }
+
+    if ( strcmp(tok[0],"modptr") == 0 )
+    {
+        if ( dest.kind != MACHINE_SLOT_MOD )
+        {
+            return machine_fail(mach,line,"not a module pointer: ",tok[1]);
+        }
+
+        if ( ( src.mod = machine_index(mach,tok[3]) ) == MACHINE_HOST_SRC )
+        {
+            return machine_fail(mach,line,"unknown module ",tok[3]);
+        }
+
+        src.kind = MACHINE_SLOT_MOD;
+        src.size = 0;
+        src.num  = 0;
+    }
+
+    else
+    {
+        if ( machine_parse_slot(mach,line,tok[3],&src) )
+        {
+            return 1;
+        }
+
+        if ( strcmp(tok[0],"bus") == 0 )
+        {
+            if ( dest.kind != MACHINE_SLOT_BUS )
+            {
+                return machine_fail(mach,line,"not a bus: ",tok[1]);
+            }
+
+            if ( src.kind == MACHINE_SLOT_HOST )
+            {
+                if ( (mach->host)[src.num].data == NULL )
+                {
+                    return machine_fail(mach,line,"not a variable: ",tok[3]);
+                }
+            }
+
+            else if ( ( src.kind != MACHINE_SLOT_BUS ) || ( src.size != dest.size ) )
+            {
+                return machine_fail(mach,line,"not a bus of the same size: ",tok[3]);
+            }
+        }
+
+        else
+        {
+            if ( dest.kind != MACHINE_SLOT_OUTFN )
+            {
+                return machine_fail(mach,line,"not an outgoing function: ",tok[1]);
+            }
+
+            if ( src.kind == MACHINE_SLOT_HOST )
+            {
+                if ( (mach->host)[src.num].fn == NULL )
+                {
+                    return machine_fail(mach,line,"not a function: ",tok[3]);
+                }
+            }
+
+            else if ( src.kind != MACHINE_SLOT_INFN )
+            {
+                return machine_fail(mach,line,"not an incoming function: ",tok[3]);
+            }
+        }
+    }
+
+    if ( mach->num_links >= mach->size_links )
+    {
+        size = ( mach->size_links == 0 ) ? 256 : 2*mach->size_links;
+
+        if ( ( grow = machine_grow(mach->links,mach->size_links*sizeof(machine_link),size*sizeof(machine_link)) ) == NULL )
+        {
+            return machine_fail(mach,line,"out of memory","");
+        }
+
+        mach->links      = (machine_link *) grow;
+        mach->size_links = size;
+    }
+
+    link.kind      = dest.kind;
+    link.dest_size = dest.size;
+    link.src_size  = src.size;
+    link.line      = line;
+    link.dest      = dest.mod;
+    link.dest_num  = dest.num;
+    link.src       = ( src.kind == MACHINE_SLOT_HOST ) ? MACHINE_HOST_SRC : src.mod;
+    link.src_num   = ( src.kind == MACHINE_SLOT_HOST ) ? 0                : src.num;
+    link.host      = ( src.kind == MACHINE_SLOT_HOST ) ? (UINT_32) src.num : 0;
+
+    DEBDEREF((mach->links),mach->num_links) = link;
+    (mach->num_links)++;
+
+    return 0;
+}
+
+
+/*
+   arena <name> [<name> ...]
+*/
+
+static int machine_is_bus(machine_data *mach, UINT_32 n)
+{
+    return ( strcmp(DEBDEREF((mach->types),n)->name,"busmod") == 0 );
+}
+
+static int machine_in_arena(machine_data *mach, UINT_32 n)
+{
+    UINT_32 i;
+
+    for ( i = 0 ; i < mach->num_arena ; i++ )
+    {
+        if ( DEBDEREF((mach->arena_order),i) == n )
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static int machine_arena_add(machine_data *mach, UINT_32 n)
+{
+    void *grow;
+    UINT_32 size;
+
+    if ( mach->num_arena >= mach->size_arena )
+    {
+        size = ( mach->size_arena == 0 ) ? 64 : 2*mach->size_arena;
+
+        if ( ( grow = machine_grow(mach->arena_order,mach->size_arena*sizeof(UINT_32),size*sizeof(UINT_32)) ) == NULL )
+        {
+            return 1;
+        }
+
+        mach->arena_order = (UINT_32 *) grow;
+        mach->size_arena  = size;
+    }
+
+    DEBDEREF((mach->arena_order),mach->num_arena) = n;
+    (mach->num_arena)++;
+
+    return 0;
+}
+
+static int machine_add_arena(machine_data *mach, UINT_32 line, char **tok, int num_tok)
+{
+    UINT_32 n;
+    int i;
+
+    if ( num_tok < 2 )
+    {
+        return machine_fail(mach,line,"expected arena <name> [<name> ...]","");
+    }
+
+    for ( i = 1 ; i < num_tok ; i++ )
+    {
+        if ( ( n = machine_index(mach,tok[i]) ) == MACHINE_HOST_SRC )
+        {
+            return machine_fail(mach,line,"unknown module ",tok[i]);
+        }
+
+        if ( !machine_is_bus(mach,n) )
+        {
+            return machine_fail(mach,line,"not a bus module: ",tok[i]);
+        }
+
+        if ( machine_in_arena(mach,n) )
+        {
+            return machine_fail(mach,line,"already in the arena: ",tok[i]);
+        }
+
+        if ( machine_arena_add(mach,n) )
+        {
+            return machine_fail(mach,line,"out of memory","");
+        }
+    }
+
+    return 0;
+}
+
+
+/*
+   Split a line into tokens and carry it out (or save it for later).
+*/
+
+static int machine_statement(machine_data *mach, UINT_32 line, char *text)
+{
+    char rest[MACHINE_LINE_SIZE+1];
+    char *tok[MACHINE_MAX_TOKENS];
+    char *eq;
+    int num_tok;
+
+    rest[0] = '\0';
+
+    if ( ( eq = strchr(text,'=') ) != NULL )
+    {
+        strcpy(rest,eq+1);
+    }
+
+    num_tok = 0;
+
+    while ( 1 )
+    {
+        while ( ( *text == ' ' ) || ( *text == '\t' ) )
+        {
+            text++;
+        }
+
+        if ( ( *text == '\0' ) || ( ( num_tok == 0 ) && ( *text == '%' ) ) )
+        {
+            break;
+        }
+
+        if ( num_tok >= MACHINE_MAX_TOKENS )
+        {
+            return machine_fail(mach,line,"too many values on one line","");
+        }
+
+        tok[num_tok] = text;
+        num_tok++;
+
+        while ( ( *text != ' ' ) && ( *text != '\t' ) && ( *text != '\0' ) )
+        {
+            text++;
+        }
+
+        if ( *text != '\0' )
+        {
+            *text = '\0';
+            text++;
+        }
+    }
+
+    if      ( num_tok == 0                  ) { return 0;                                               }
+    else if ( strcmp(tok[0],"module") == 0  ) { return machine_add_module(mach,line,tok,num_tok);       }
+    else if ( strcmp(tok[0],"var")    == 0  ) { return machine_set_vars(mach,line,tok,num_tok);         }
+    else if ( strcmp(tok[0],"string") == 0  ) { return machine_set_string(mach,line,tok,num_tok,rest);  }
+    else if ( strcmp(tok[0],"bus")    == 0  ) { return machine_add_link(mach,line,tok,num_tok);         }
+    else if ( strcmp(tok[0],"modptr") == 0  ) { return machine_add_link(mach,line,tok,num_tok);         }
+    else if ( strcmp(tok[0],"call")   == 0  ) { return machine_add_link(mach,line,tok,num_tok);         }
+    else if ( strcmp(tok[0],"arena")  == 0  ) { return machine_add_arena(mach,line,tok,num_tok);        }
+
+    return machine_fail(mach,line,"unknown statement ",tok[0]);
+}
+
+
+/*
+   Public functions (see machine.h).
+*/
+
+machine_data *machine_alloc(const char *filename, machine_host *host)
+{
+    machine_data *mach;
+    PC_FILE *fp;
+    char text[MACHINE_LINE_SIZE+1];
+    size_t len;
+    UINT_32 line;
+
+    if ( ( mach = (machine_data *) DEBMALLOC(sizeof(machine_data)) ) == NULL )
+    {
+        return NULL;
+    }
+
+    mach->mods       = NULL;
+    mach->names      = NULL;
+    mach->types      = NULL;
+    mach->ids        = NULL;
+    mach->num_mods   = 0;
+    mach->size_mods  = 0;
+    mach->links      = NULL;
+    mach->num_links  = 0;
+    mach->size_links = 0;
+    mach->strs       = NULL;
+    mach->num_strs   = 0;
+    mach->size_strs  = 0;
+    mach->arena_order = NULL;
+    mach->num_arena   = 0;
+    mach->size_arena  = 0;
+    mach->arena       = NULL;
+    mach->arena_block = NULL;
+    mach->host       = host;
+    mach->filename   = filename;
+    mach->error[0]   = '\0';
+
+    if ( ( fp = pc_fopen(filename,"r") ) == NULL )
+    {
+        machine_fail(mach,0,"unable to open file","");
+
+        return mach;
+    }
+
+    line = 0;
+
+    while ( pc_fgets(text,MACHINE_LINE_SIZE,fp) != NULL )
+    {
+        line++;
+
+        len = strlen(text);
+
+        if ( ( len == MACHINE_LINE_SIZE-1 ) && ( text[len-1] != '\n' ) )
+        {
+            machine_fail(mach,line,"line too long","");
+
+            break;
+        }
+
+        while ( ( len > 0 ) && ( ( text[len-1] == '\n' ) || ( text[len-1] == '\r' ) ) )
+        {
+            len--;
+            text[len] = '\0';
+        }
+
+        if ( machine_statement(mach,line,text) )
+        {
+            break;
+        }
+    }
+
+    pc_fclose(fp);
+
+    if ( ( mach->error[0] == '\0' ) && ( mach->num_mods == 0 ) )
+    {
+        machine_fail(mach,0,"no modules","");
+    }
+
+    return mach;
+}
+
+module_data *machine_find(machine_data *mach, const char *name)
+{
+    UINT_32 i;
+
+    if ( ( i = machine_index(mach,name) ) == MACHINE_HOST_SRC )
+    {
+        return NULL;
+    }
+
+    return DEBDEREF((mach->mods),i);
+}
+
+static int machine_make_link(machine_data *mach, machine_link *link)
+{
+    char text[MACHINE_NAME_SIZE+32];
+    module_data *dest;
+    module_data *src;
+    UINT_64 dest_max;
+    UINT_64 src_max;
+
+    dest = DEBDEREF((mach->mods),link->dest);
+    src  = ( link->src == MACHINE_HOST_SRC ) ? NULL : DEBDEREF((mach->mods),link->src);
+
+    switch ( link->kind )
+    {
+        case MACHINE_SLOT_BUS:
+        {
+            switch ( link->dest_size )
+            {
+                case 0:  { dest_max = dest->num_bus_8bit;  src_max = ( src == NULL ) ? 1 : src->num_bus_8bit;  break; }
+                case 1:  { dest_max = dest->num_bus_16bit; src_max = ( src == NULL ) ? 1 : src->num_bus_16bit; break; }
+                default: { dest_max = dest->num_bus_32bit; src_max = ( src == NULL ) ? 1 : src->num_bus_32bit; break; }
+            }
+
+            break;
+        }
+
+        case MACHINE_SLOT_MOD:
+        {
+            dest_max = dest->num_modptrs;
+            src_max  = 1;
+
+            break;
+        }
+
+        default:
+        {
+            dest_max = dest->num_sig_calls_outof_module;
+            src_max  = ( src == NULL ) ? 1 : src->num_sig_calls_into_module;
+
+            break;
+        }
+    }
+
+    if ( link->dest_num >= dest_max )
+    {
+        sprintf(text,"%.64s",DEBDEREF((mach->names),link->dest));
+        return machine_fail(mach,link->line,"slot out of range in ",text);
+    }
+
+    if ( link->src_num >= src_max )
+    {
+        sprintf(text,"%.64s",DEBDEREF((mach->names),link->src));
+        return machine_fail(mach,link->line,"slot out of range in ",text);
+    }
+
+    switch ( link->kind )
+    {
+        case MACHINE_SLOT_BUS:
+        {
+            switch ( link->dest_size )
+            {
+                case 0:  { DEBDEREF((dest->bus_8bit),link->dest_num)  = ( src == NULL ) ? (VOLATILITY UINT_8  *) (mach->host)[link->host].data : DEBDEREF((src->bus_8bit),link->src_num);  break; }
+                case 1:  { DEBDEREF((dest->bus_16bit),link->dest_num) = ( src == NULL ) ? (VOLATILITY UINT_16 *) (mach->host)[link->host].data : DEBDEREF((src->bus_16bit),link->src_num); break; }
+                default: { DEBDEREF((dest->bus_32bit),link->dest_num) = ( src == NULL ) ? (VOLATILITY UINT_32 *) (mach->host)[link->host].data : DEBDEREF((src->bus_32bit),link->src_num); break; }
+            }
+
+            break;
+        }
+
+        case MACHINE_SLOT_MOD:
+        {
+            DEBDEREF((dest->modptrs),link->dest_num) = src;
+
+            break;
+        }
+
+        default:
+        {
+            if ( DEBDEREF((dest->sig_calls_outof_module),link->dest_num) != global_nothingfn )
+            {
+                sprintf(text,"%.64s.outfn%lu",DEBDEREF((mach->names),link->dest),(unsigned long) link->dest_num);
+                return machine_fail(mach,link->line,"wired twice: ",text);
+            }
+
+            if ( src == NULL )
+            {
+                DEBDEREF((dest->sig_calls_outof_module),link->dest_num) = (mach->host)[link->host].fn;
+                DEBDEREF((dest->sig_calls_outof_args),link->dest_num)   = NULL;
+            }
+
+            else
+            {
+                DEBDEREF((dest->sig_calls_outof_module),link->dest_num) = DEBDEREF((src->sig_calls_into_module),link->src_num);
+                DEBDEREF((dest->sig_calls_outof_args),link->dest_num)   = (void *) src;
+            }
+
+            break;
+        }
+    }
+
+    return 0;
+}
+
+/*
+   Repoint every bus connected to bus module n at the same bus in *dest,
+   which the module is about to be moved to (see "Bus arena" in
+   machine.h).  The module itself is left to busmod_relocate.
+*/
+
+static void machine_repoint(machine_data *mach, UINT_32 n, busmod_store *dest)
+{
+    VOLATILITY UINT_8  *old_8;
+    VOLATILITY UINT_16 *old_16;
+    VOLATILITY UINT_32 *old_32;
+    module_data *mod;
+    UINT_32 i;
+    UINT_64 j;
+
+    mod    = DEBDEREF((mach->mods),n);
+    old_8  = DEREF_8MEM(mod,0);
+    old_16 = DEREF_16MEM(mod,0);
+    old_32 = DEREF_32MEM(mod,0);
+
+    for ( i = 0 ; i < mach->num_mods ; i++ )
+    {
+        if ( i == n )
+        {
+            continue;
+        }
+
+        mod = DEBDEREF((mach->mods),i);
+
+        for ( j = 0 ; j < mod->num_bus_8bit  ; j++ ) { if ( DEBDEREF((mod->bus_8bit),j)  == old_8  ) { DEBDEREF((mod->bus_8bit),j)  = &(dest->bus_8bit);  } }
+        for ( j = 0 ; j < mod->num_bus_16bit ; j++ ) { if ( DEBDEREF((mod->bus_16bit),j) == old_16 ) { DEBDEREF((mod->bus_16bit),j) = &(dest->bus_16bit); } }
+        for ( j = 0 ; j < mod->num_bus_32bit ; j++ ) { if ( DEBDEREF((mod->bus_32bit),j) == old_32 ) { DEBDEREF((mod->bus_32bit),j) = &(dest->bus_32bit); } }
+    }
+
+    return;
+}
+
+static int machine_build_arena(machine_data *mach)
+{
+    UINT_32 i;
+
+    for ( i = 0 ; i < mach->num_mods ; i++ )
+    {
+        if ( machine_is_bus(mach,i) && !machine_in_arena(mach,i) )
+        {
+            if ( machine_arena_add(mach,i) )
+            {
+                return machine_fail(mach,0,"out of memory","");
+            }
+        }
+    }
+
+    if ( mach->num_arena == 0 )
+    {
+        return 0;
+    }
+
+    if ( ( mach->arena_block = DEBMALLOC(mach->num_arena*sizeof(busmod_store)+MODULE_ALIGN-1) ) == NULL )
+    {
+        return machine_fail(mach,0,"out of memory","");
+    }
+
+    mach->arena = (busmod_store *) ( ( ( (size_t) mach->arena_block ) + MODULE_ALIGN - 1 ) & ~( (size_t) ( MODULE_ALIGN - 1 ) ) );
+
+    DEBCARVE(mach->arena,mach->num_arena*sizeof(busmod_store));
+
+    for ( i = 0 ; i < mach->num_arena ; i++ )
+    {
+        machine_repoint(mach,DEBDEREF((mach->arena_order),i),&(DEBDEREF((mach->arena),i)));
+
+        busmod_relocate(DEBDEREF((mach->mods),DEBDEREF((mach->arena_order),i)),&(DEBDEREF((mach->arena),i)));
+    }
+
+    return 0;
+}
+
+int machine_init(machine_data *mach)
+{
+    UINT_32 i;
+
+    if ( mach->error[0] != '\0' )
+    {
+        return 1;
+    }
+
+    for ( i = 0 ; i < mach->num_mods ; i++ )
+    {
+        if ( (DEBDEREF((mach->types),i)->init)(DEBDEREF((mach->mods),i)) )
+        {
+            return machine_fail(mach,0,"unable to initialise module ",DEBDEREF((mach->names),i));
+        }
+    }
+
+    for ( i = 0 ; i < mach->num_links ; i++ )
+    {
+        if ( machine_make_link(mach,&(DEBDEREF((mach->links),i))) )
+        {
+            return 1;
+        }
+    }
+
+    return machine_build_arena(mach);
+}
+
+void machine_go(machine_data *mach)
+{
+    UINT_32 i;
+
+    for ( i = 0 ; i < mach->num_mods ; i++ )
+    {
+        (DEBDEREF((mach->types),i)->go)(DEBDEREF((mach->mods),i));
+    }
+
+    return;
+}
+
+void machine_stop(machine_data *mach)
+{
+    UINT_32 i;
+
+    for ( i = 0 ; i < mach->num_mods ; i++ )
+    {
+        (DEBDEREF((mach->types),i)->stop)(DEBDEREF((mach->mods),i));
+    }
+
+    return;
+}
+
+void machine_remove(machine_data *mach)
+{
+    UINT_32 i;
+
+    if ( mach == NULL )
+    {
+        return;
+    }
+
+    for ( i = 0 ; i < mach->num_mods ; i++ )
+    {
+        (DEBDEREF((mach->types),i)->remove)(DEBDEREF((mach->mods),i));
+
+        DEBFREE(DEBDEREF((mach->names),i));
+        DEBFREE(DEBDEREF((mach->ids),i));
+    }
+
+    for ( i = 0 ; i < mach->num_strs ; i++ )
+    {
+        DEBFREE(DEBDEREF((mach->strs),i));
+    }
+
+    if ( mach->mods  != NULL ) { DEBFREE(mach->mods);  }
+    if ( mach->names != NULL ) { DEBFREE(mach->names); }
+    if ( mach->types != NULL ) { DEBFREE(mach->types); }
+    if ( mach->ids   != NULL ) { DEBFREE(mach->ids);   }
+    if ( mach->links != NULL ) { DEBFREE(mach->links); }
+    if ( mach->strs  != NULL ) { DEBFREE(mach->strs);  }
+
+    if ( mach->arena_order != NULL ) { DEBFREE(mach->arena_order); }
+
+    if ( mach->arena_block != NULL )
+    {
+        DEBUNCARVE(mach->arena);
+        DEBFREE(mach->arena_block);
+    }
+
+    DEBFREE(mach);
+
+    return;
+}
+
+static int machine_cat(char **dest, UINT_32 *size, const char *text)
+{
+    void *grow;
+    UINT_32 len;
+    UINT_32 new_size;
+
+    len = strlen(*dest)+strlen(text);
+
+    if ( len >= *size )
+    {
+        new_size = *size;
+
+        while ( len >= new_size )
+        {
+            new_size *= 2;
+        }
+
+        if ( ( grow = machine_grow(*dest,(*size)*sizeof(char),new_size*sizeof(char)) ) == NULL )
+        {
+            return 1;
+        }
+
+        *dest = (char *) grow;
+        *size = new_size;
+    }
+
+    strcat(*dest,text);
+
+    return 0;
+}
+
+/*
+   Unconnected slots of one kind (0 to 2 for 8, 16 and 32 bit buses, 3
+   for outgoing functions) are added to the report, with runs of them
+   given as first-last.  Many modules work on whichever of the 8, 16 and
+   32 bit buses are connected, so buses are only reported if the module
+   has other buses of the same size connected.
+*/
+
+static const char *machine_report_names[4] = { "busa", "busb", "busc", "outfn" };
+
+static int machine_unconnected(module_data *mod, int kind, UINT_64 num)
+{
+    switch ( kind )
+    {
+        case 0:  { return ( DEBDEREF((mod->bus_8bit),num)  == global_8dummyptr  ); }
+        case 1:  { return ( DEBDEREF((mod->bus_16bit),num) == global_16dummyptr ); }
+        case 2:  { return ( DEBDEREF((mod->bus_32bit),num) == global_32dummyptr ); }
+        default: { return ( DEBDEREF((mod->sig_calls_outof_module),num) == global_nothingfn ); }
+    }
+}
+
+static int machine_report(char **dest, UINT_32 *size, int *hdr, const char *name, module_data *mod, int kind)
+{
+    char text[MACHINE_NAME_SIZE+64];
+    UINT_64 num;
+    UINT_64 first;
+    UINT_64 j;
+    int fail;
+
+    switch ( kind )
+    {
+        case 0:  { num = mod->num_bus_8bit;               break; }
+        case 1:  { num = mod->num_bus_16bit;              break; }
+        case 2:  { num = mod->num_bus_32bit;              break; }
+        default: { num = mod->num_sig_calls_outof_module; break; }
+    }
+
+    if ( kind < 3 )
+    {
+        for ( j = 0 ; ( j < num ) && machine_unconnected(mod,kind,j) ; j++ )
+        {
+            ;
+        }
+
+        if ( j == num )
+        {
+            return 0;
+        }
+    }
+
+    fail = 0;
+
+    for ( j = 0 ; j < num ; j++ )
+    {
+        if ( machine_unconnected(mod,kind,j) )
+        {
+            first = j;
+
+            while ( ( j+1 < num ) && machine_unconnected(mod,kind,j+1) )
+            {
+                j++;
+            }
+
+            if ( !(*hdr) )
+            {
+                sprintf(text,"  %.64s: unconnected",name);
+                fail |= machine_cat(dest,size,text);
+                *hdr = 1;
+            }
+
+            if ( first == j )
+            {
+                sprintf(text," %s%lu",machine_report_names[kind],(unsigned long) j);
+            }
+
+            else
+            {
+                sprintf(text," %s%lu-%lu",machine_report_names[kind],(unsigned long) first,(unsigned long) j);
+            }
+
+            fail |= machine_cat(dest,size,text);
+        }
+    }
+
+    return fail;
+}
+
+char *machine_getinf(machine_data *mach)
+{
+    char text[MACHINE_NAME_SIZE+32];
+    char *used;
+    char *dest;
+    module_data *mod;
+    UINT_32 size;
+    UINT_32 i;
+    int kind;
+    int fail;
+    int hdr;
+
+    size = 1024;
+
+    if ( ( dest = (char *) DEBMALLOC(size*sizeof(char)) ) == NULL )
+    {
+        return NULL;
+    }
+
+    if ( ( used = (char *) DEBMALLOC((mach->num_mods+1)*sizeof(char)) ) == NULL )
+    {
+        DEBFREE(dest);
+
+        return NULL;
+    }
+
+    for ( i = 0 ; i < mach->num_mods ; i++ )
+    {
+        DEBDEREF(used,i) = 0;
+    }
+
+    for ( i = 0 ; i < mach->num_links ; i++ )
+    {
+        if ( DEBDEREF((mach->links),i).src != MACHINE_HOST_SRC )
+        {
+            DEBDEREF(used,DEBDEREF((mach->links),i).src) = 1;
+        }
+    }
+
+    sprintf(dest,"Machine %.100s: %lu modules, %lu connections.\n",mach->filename,(unsigned long) mach->num_mods,(unsigned long) mach->num_links);
+
+    fail = 0;
+
+    for ( i = 0 ; ( i < mach->num_mods ) && !fail ; i++ )
+    {
+        mod = DEBDEREF((mach->mods),i);
+        hdr = 0;
+
+        for ( kind = 0 ; kind < 4 ; kind++ )
+        {
+            fail |= machine_report(&dest,&size,&hdr,DEBDEREF((mach->names),i),mod,kind);
+        }
+
+        if ( !DEBDEREF(used,i) )
+        {
+            if ( hdr )
+            {
+                fail |= machine_cat(&dest,&size,"; nothing connects to it");
+            }
+
+            else
+            {
+                sprintf(text,"  %.64s: nothing connects to it",DEBDEREF((mach->names),i));
+                fail |= machine_cat(&dest,&size,text);
+                hdr = 1;
+            }
+        }
+
+        if ( hdr )
+        {
+            fail |= machine_cat(&dest,&size,".\n");
+        }
+    }
+
+    DEBFREE(used);
+
+    /*
+       The bus arena, one cache line to a row.
+    */
+
+    if ( ( mach->arena != NULL ) && !fail )
+    {
+        sprintf(text,"Bus arena: %lu buses, %lu bytes each, %lu to a cache line:",(unsigned long) mach->num_arena,(unsigned long) sizeof(busmod_store),(unsigned long) (MODULE_ALIGN/sizeof(busmod_store)));
+        fail |= machine_cat(&dest,&size,text);
+
+        for ( i = 0 ; ( i < mach->num_arena ) && !fail ; i++ )
+        {
+            if ( ( i % (MODULE_ALIGN/sizeof(busmod_store)) ) == 0 )
+            {
+                sprintf(text,"\n  line %lu:",(unsigned long) (i/(MODULE_ALIGN/sizeof(busmod_store))));
+                fail |= machine_cat(&dest,&size,text);
+            }
+
+            sprintf(text," %.64s",DEBDEREF((mach->names),DEBDEREF((mach->arena_order),i)));
+            fail |= machine_cat(&dest,&size,text);
+        }
+
+        fail |= machine_cat(&dest,&size,"\n");
+    }
+
+    if ( fail )
+    {
+        DEBFREE(dest);
+
+        return NULL;
+    }
+
+    return dest;
+}
@@ -0,0 +1,211 @@
+#include "u_dtype.h"
+#include "modules.h"
+#include "genmod.h"
+
+#ifndef _machine_h
+#define _machine_h
+
+/*
+
+                          Machine Descriptions
+                          ====================
+
+A machine description file lists the modules that make up a machine and
+how they are wired together, so that a different machine (or a cut down
+one) can be put together without recompiling the emulator.  The file is
+read into the same module_data graph that would otherwise be built by
+hand, following the steps in modules.h.
+
+The file is plain text, one statement per line.  Blank lines and lines
+starting with % are ignored.  Slots are given as module.slot, where slot
+is one of:
+
+   varaN, varbN, varcN - 8, 16 and 32 bit variable N
+   svarN               - string variable N
+   busaN, busbN, buscN - 8, 16 and 32 bit bus N
+   modN                - module pointer N
+   infnN, outfnN       - incoming and outgoing function N
+
+and N (and any value) may be decimal or hex (0x...).  The statements are:
+
+   module <name> <type> [<id>]
+
+      Allocate a module called <name>.  <type> is the prefix of the
+      module's functions (eg. andconstmod, memmod, z80cpu) and <id> is the
+      string given to its alloc function (empty if left out).
+
+   var <name>.varaN = <value> [<value> ...]
+
+      Set variable N (and N+1, N+2 ... for the values after the first).
+
+   string <name>.svarN = <text>
+
+      Set string variable N to the rest of the line (which may be empty).
+
+   bus <name>.busaN = <name>.busaM
+   bus <name>.busaN = host.<variable>
+
+      Point bus N of the first module at bus M of the second (which must
+      be the same size), or at a variable provided by the emulator.
+
+   modptr <name>.modN = <name>
+
+      Point module pointer N at a module.
+
+   call <name>.outfnN = <name>.infnM
+   call <name>.outfnN = host.<function>
+
+      Wire outgoing function N of the first module to incoming function M
+      of the second (which is called with the second module as argument),
+      or to a function provided by the emulator (called with NULL).
+
+   arena <name> [<name> ...]
+
+      Put the listed bus modules (busmod) at the start of the bus arena,
+      in the order given (see "Bus arena").  May be given more than once,
+      in which case the lists follow on from each other.
+
+module, var, string and arena statements are carried out as the file is
+read, so a module has to be declared before anything else refers to it.
+The rest are carried out once all modules are initialised.
+
+Bus arena
+=========
+
+Each bus module holds its three buses in a busmod_store of its own, and
+everything connected to the bus follows a pointer to it, so the buses a
+machine uses most end up spread all over the heap.  Once the machine is
+wired up, machine_init moves the buses of every bus module into one block
+(the bus arena) aligned to MODULE_ALIGN, and repoints all of the buses
+connected to them.  The modules named in arena statements go first, in
+that order, followed by the rest in the order they were declared.  A
+cache line holds MODULE_ALIGN/sizeof(busmod_store) bus modules (8 with
+HAVE_STDINT_H, 4 where UINT_32 is a 64 bit long), so listing the buses
+the CPU, memory and CRTC use all the time first keeps them in the first
+line or two (machine_getinf shows where they ended up).
+
+Buses are connected after modname_init (step 4 in modules.h), so a
+module that keeps copies of its bus pointers has to take them in
+modname_go, by which time the arena is in place.
+
+Functions
+=========
+
+machine_alloc(filename,host) reads the file, allocates the modules and
+sets their variables (steps 1 and 2 in modules.h).  host lists the
+functions and variables the file can refer to as host.<name>, ending with
+a NULL name.  Returns NULL if out of memory; otherwise if something is
+wrong with the file, mach->error says what and where (mach->error[0] is
+'\0' if all is well), and the machine can't be used.
+
+machine_find(mach,name) returns the module called name, or NULL.  The
+caller can use this to fill in anything not given in the file before
+machine_init.
+
+machine_init(mach) initialises the modules in the order they were
+declared, wires them up (steps 3 and 4) and builds the bus arena.
+Returns nonzero with mach->error set if a connection refers to a slot the
+module doesn't have, an outgoing function is wired twice or there isn't
+enough memory.
+
+machine_go, machine_stop and machine_remove call modname_go, _stop and
+_remove for each module in the order they were declared (machine_remove
+also frees the machine).
+
+machine_getinf(mach) checks the wiring, and lists the buses and outgoing
+functions that were left unconnected, and the modules nothing connects
+to (as nothing calls them or uses their buses).  As many modules work on
+whichever of their 8, 16 and 32 bit buses are connected, buses are only
+listed if the module has others of the same size connected.  Unconnected
+outgoing functions do nothing, and unconnected buses read from and write
+to a dummy variable, which isn't always a mistake, so it's up to the
+reader.  It then lists the bus arena, cache line by cache line.
+
+*/
+
+#define MACHINE_NAME_SIZE       64
+#define MACHINE_LINE_SIZE       1024
+#define MACHINE_MESSAGE_SIZE    256
+
+typedef struct
+{
+    const char               *name;
+    weird_pointer_jive_wargs  fn;
+    void                     *data;
+}
+machine_host;
+
+/*
+   A connection waiting for machine_init (bus, modptr or call statement).
+*/
+
+typedef struct
+{
+    UINT_8  kind;
+    UINT_8  dest_size;
+    UINT_8  src_size;
+    UINT_32 line;
+    UINT_32 dest;
+    UINT_64 dest_num;
+    UINT_32 src;
+    UINT_64 src_num;
+    UINT_32 host;
+}
+machine_link;
+
+typedef struct Machine_Type machine_type;
+
+typedef struct
+{
+    /*
+       mods:   the modules, in the order declared, followed by NULL.
+       names:  name of each module.
+       types:  type of each module.
+       ids:    id string given to each module's alloc function.
+       links:  connections made by machine_init.
+       strs:   copies of the strings given to string variables.
+       arena_order: module number of each bus in the bus arena (those
+               named in arena statements until machine_init adds the
+               rest).
+       arena:  the bus arena (NULL until machine_init), arena_block the
+               allocation it is aligned within.
+       error:  what went wrong ("" if nothing).
+    */
+
+    module_data        **mods;
+    char               **names;
+    const machine_type **types;
+    char               **ids;
+    UINT_32              num_mods;
+    UINT_32              size_mods;
+
+    machine_link        *links;
+    UINT_32              num_links;
+    UINT_32              size_links;
+
+    char               **strs;
+    UINT_32              num_strs;
+    UINT_32              size_strs;
+
+    UINT_32             *arena_order;
+    UINT_32              num_arena;
+    UINT_32              size_arena;
+    busmod_store        *arena;
+    void                *arena_block;
+
+    machine_host        *host;
+    const char          *filename;
+
+    char error[MACHINE_MESSAGE_SIZE+1];
+}
+machine_data;
+
+machine_data *machine_alloc(const char *filename, machine_host *host);
+int           machine_init(machine_data *mach);
+void          machine_go(machine_data *mach);
+void          machine_stop(machine_data *mach);
+void          machine_remove(machine_data *mach);
+char         *machine_getinf(machine_data *mach);
+module_data  *machine_find(machine_data *mach, const char *name);
+
+#endif
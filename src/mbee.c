@@ -13,8 +13,10 @@ TO DO: make "microbee" filetype which can do ascii/bin processing
 */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <errno.h>
 #include "u_dtype.h"
 #include "z80cpu.h"
 #include "6545.h"
@@ -24,25 +26,68 @@ TO DO: make "microbee" filetype which can do ascii/bin processing
 #include "debmaloc.h"
 #include "beefile.h"
 #include "genmod.h"
+#include "machine.h"
 
 
 
 
-#define KEYBOARD_USES_LPEN              1
 /*#define FAST_IS_SLOW                    1*/
 #define CONFIG_FILE                     "mbee32k.ini"
+#define MACHINE_FILE                    "mbee32k.mdf"
+#define Z80_PROFILE_OP_FILE             "z80ops.csv"
+#define Z80_PROFILE_MEM_FILE            "z80mem.csv"
+#define PC_SAMPLE_FILE                  "pcprof.folded"
+#define WATCH_LOG_FILE                  "z80watch.txt"
+#define TURBO_LOG_FILE                  "mbeeturbo.txt"
+#define TURBO_REPORT_NS                 1000000000
+#define TURBO_CHECK_MASK                0x0fff
+#define TURBO_MESSAGE_SIZE              256
+#define SNAPSHOT_FILE                   "mbee32k.snp"
+#define REWIND_FRAME_CLOCKS             67500
+#define REWIND_FRAMES_PER_SEC           50
+#define REWIND_MAX_BYTES                0x01000000
+#define BATCH_TEXT_CLOCKS               67500
+#define BATCH_VDU_SIZE                  0x0800
+#define BATCH_MAX_DUMPS                 8
+#define BATCH_MESSAGE_SIZE              256
+#define BATCH_HIT_PC                    1
+#define BATCH_HIT_MEM                   2
+#define BATCH_HIT_TEXT                  3
+#define BATCH_HIT_BUDGET                4
+#define BATCH_EXIT_NOT_MET              3
+#define BATCH_EXIT_DUMP_FAILED          4
+#define PC_SAMPLE_REGIONS               7
+#define PC_SAMPLE_TOP                   16
+#define PC_SAMPLE_LINE                  64
 
-#ifdef KEYBOARD_USES_LPEN
-#define ROMREAD0_LPEN_MASK              0x0ffffff00
-#define ROMREAD1_LPEN_MASK              0x0ffff0000
+#define CRTC6545_RELATIVE_CLOCK_RATE    2
+
+/*#define DISABLE_THROTTLE_SLEEP          1*/
+#define THROTTLE_SLEEP_NS               1000000
+#define THROTTLE_SPIN_NS                5000
+
+#if defined(__GNUC__) && ( defined(__i386__) || defined(__x86_64__) )
+#define TURBO_HOST_CYCLES()             __builtin_ia32_rdtsc()
 #endif
 
-#ifndef KEYBOARD_USES_LPEN
-#define ROMREAD0_LPEN_MASK              0x000000000
-#define ROMREAD1_LPEN_MASK              0x000000000
+#if defined(__GNUC__) && defined(__linux__)
+#define TURBO_CACHE_MISSES              1
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
 #endif
 
-#define CRTC6545_RELATIVE_CLOCK_RATE    2
+#ifdef CLOCK_MONOTONIC
+#define HOST_CLOCK_NS                   1
+#endif
+
+#ifndef DISABLE_THROTTLE_SLEEP
+#ifdef TIMER_ABSTIME
+#ifdef HOST_CLOCK_NS
+#define THROTTLE_SLEEPS                 1
+#endif
+#endif
+#endif
 #define DEFAULT_CLOCK_PERIOD            296
 #define DEFAULT_TIMER_PERIOD            1000000
 #define DEFAULT_CATCHUP_COUNT           500
@@ -54,6 +99,7 @@ TO DO: make "microbee" filetype which can do ascii/bin processing
 #define DEFAULT_MAX_CRTC_GRANULARITY    128
 #define DEFAULT_MAX_CRTC_CLOCK_DIV      16
 #define OVERLOOK_TIMER_PERIOD           2
+#define MAX_RUN_CLOCKS                  0x01000
 
 
 
@@ -62,60 +108,13 @@ module_data *bus_z80_rfsh;
 module_data *bus_z80_data;
 module_data *bus_z80_addr;
 module_data *bus_z80_reti_count;
+module_data *bus_z80_clk_left;
 module_data *bus_z80_tab_num_start;
 module_data *bus_z80_tab_num_finish;
 module_data *bus_z80_tab_wr_wait;
 module_data *bus_z80_tab_rd_wait;
 module_data *bus_sy6545_data;
 module_data *bus_sy6545_addr;
-module_data *mask_romread;
-module_data *mask_colback;
-module_data *mask_colctrl;
-module_data *mask_soundbit;
-module_data *mask_tapeout;
-module_data *mask_video_mem_addr;
-module_data *mask_video_mem_slfaddr;
-module_data *mask_video_charline;
-module_data *mask_video_data;
-module_data *assign_romread;
-module_data *assign_colback;
-module_data *assign_colctrl;
-module_data *assign_lpenmask0;
-module_data *assign_lpenmask1;
-module_data *assign_video_data;
-module_data *assign_video_charline;
-module_data *branch_romread_change;
-module_data *do_romread_goes_high;
-module_data *do_romread_goes_low;
-module_data *do_startup_ramtest;
-module_data *do_fixup_romread;
-module_data *branch_if_romread_diff;
-module_data *branch_mem_startup;
-module_data *do_romread_wr;
-module_data *do_reset_ramset;
-module_data *do_init_ramset;
-module_data *lut8_colour_table;
-module_data *or_backcol_backint;
-module_data *dowhile_redo_bcolint;
-module_data *do_vdu_ram_wr;
-module_data *do_col_ram_wr;
-module_data *do_pcg_ram_wr;
-module_data *branch_vdu_ram_wr;
-module_data *branch_sw_col_pcg;
-module_data *branch_memwr;
-module_data *do_switch_in_col_ram;
-module_data *do_switch_in_pcg_ram;
-module_data *branch_sub_colpcg;
-module_data *do_colback_change;
-module_data *do_colctrl_change;
-module_data *branch_diff_colback;
-module_data *branch_diff_colctrl;
-module_data *do_col_port_wr;
-module_data *do_pio_b_rdy_data_out;
-module_data *do_tape_strober;
-module_data *mask_pio_b;
-module_data *or_pio_b_tape;
-module_data *setbus_cpu_tab;
 module_data *bus_cputabsel;
 module_data *bus_lpen_callmask;
 module_data *mem_lpen_table;
@@ -125,10 +124,6 @@ module_data *bee_interf;
 module_data *z80cpu_base;
 module_data *z80pio_base;
 module_data *sy6545_base;
-module_data *jtable_io_wr__base;
-module_data *jtable_io_rd__base;
-module_data *do_z80_ack_INT;
-module_data *do_z80_ack_reset;
 module_data *bus_cnt_lpen;
 module_data *bus_cnt_update;
 module_data *bus_video_mem_addr;
@@ -176,10 +171,54 @@ void timer_speed_emul_off(void *what);
 void timer_speed_emul_on(void *what);
 void pause_emulation(void *what);
 void restart_emulation(void *what);
+void turbo_on(void *what);
 void speed_throttle(void);
+void throttle_behind(void);
 void overlook_timer(void);
 
+#ifdef HOST_CLOCK_NS
+UINT_64 throttle_host_ns(void);
+#endif
+
+#ifdef THROTTLE_SLEEPS
+void    throttle_sleep_until(UINT_64 deadline);
+#endif
+
 void sync_clock(void);
+void crtc_clock(UINT_32 clocks, int lsync_point);
+void crtc_catch_up(void *what);
+void interf_catch_up(void *what);
+
+int         pc_sample_region(int page);
+const char *pc_sample_region_name(int region);
+char       *pc_sample_getinf(void);
+int         pc_sample_folded(const char *filename);
+
+void watch_report(void);
+
+void  turbo_start(void);
+void  turbo_stop(void);
+void  turbo_report(void);
+char *turbo_getinf(void);
+UINT_64 turbo_cache_misses(void);
+double turbo_elapsed_ns(void);
+
+int     batch_option(const char *opt, int nargs, char *args[]);
+int     batch_start(void);
+void    batch_watch_hit(UINT_8 kind, UINT_16 addr);
+void    batch_check(UINT_16 clk_bus);
+UINT_8  batch_peek(UINT_16 addr);
+UINT_32 batch_screen_text(char *dest, UINT_8 *cols);
+int     batch_finish(void);
+char   *batch_getinf(void);
+
+int  snapshot_save(const char *filename);
+int  snapshot_load(const char *filename);
+void save_machine_state(void *what);
+void load_machine_state(void *what);
+void rewind_capture(void);
+int  rewind_back(UINT_32 seconds);
+void rewind_machine_state(void *what);
 
 /*
    Variables
@@ -194,6 +233,56 @@ void sync_clock(void);
         interupt but can't be because you can't call functions in this
         context.
    is_wait: Set when the emulation is in a wait loop.
+   throttle_rebase: Set wherever actual_clocks is zeroed, so that (if
+        THROTTLE_SLEEPS) sync_clock starts its deadline again from now.
+   cpu_trace_depth: Number of instructions kept in the cpu trace (0 for
+        no trace, only used if compiled with Z80_TRACE).
+   cpu_pc_sample: Set to sample the z80 PC on every timer tick (see "PC
+        sampling").
+   pc_sample_count: Number of PC samples in each 256 byte page.
+   watch_start, watch_end, watch_kinds: Watchpoint set from mbee32k.ini
+        (watch_kinds 0 for none, see "Watchpoints").
+   watch_fp: WATCH_LOG_FILE, while there is a watchpoint.
+   snapshot: Buffer used to save and load the machine state (allocated
+        the first time it is needed, see "Snapshots").
+   rewind_seconds: How far back the machine can be rewound (0 for no
+        rewind, see "Rewind").
+   rewind_frames: Number of frames between rewind snapshots.
+   rewind_ring: Rewind snapshots (NULL if rewind is off).
+   netlist_compile: Set to compile the do/dowhile/branch module chains
+        once the machine is wired (see genmod.h, "Netlist compiler").
+   netlist: The compiled chains (NULL if not compiled).
+   machine_file: Machine description file (see machine.h and mbee32k.mdf).
+   machine_report: Set to list the unconnected parts of the machine and
+        the bus arena layout when it is built (see machine_getinf).
+   machine: The machine, as built from machine_file.
+   turbo_mode: Set in turbo (benchmark) mode (see "Turbo mode").
+   turbo_ticks: Timer ticks since the last turbo report.
+   turbo_ns_base: Host clock at the last turbo report (HOST_CLOCK_NS).
+   turbo_fp: TURBO_LOG_FILE, once turbo mode has been used.
+   turbo_clocks, turbo_runs, turbo_frames_base, turbo_host_base,
+        turbo_cache_base: clock cycles run, sync_clock runs,
+        crtc_frame_count, host cycle counter and host cache miss counter
+        since the last turbo report.
+   turbo_cache_fd: Host cache miss counter (-1 if not opened yet, -2 if
+        it can't be).
+   turbo_total_*: totals over all time spent in turbo mode.
+   crtc_frame_count: 6545 frame counter (busc3 of the 6545).
+   batch_*: Batch run options and state (see "Batch runs").
+   crtc_pinned: Set when input is being recorded or replayed (see
+        interf.h) or when running headless, in which case the 6545 is
+        always clocked with REAL_CRTC_GRANULARITY and REAL_CRTC_CLOCK_DIV
+        so that the emulation doesn't depend on how fast the host is
+        running.
+   crtc_cycle_counter: 6545 clock cycles not yet passed on to the 6545.
+   crtc_clk_odds: z80 clock cycles left over from the last conversion to
+        6545 clock cycles.
+   crtc_lazy: Set for a run in which the 6545 is only clocked when the z80
+        does something that involves it (see "Scheduling").
+   crtc_run_clocks: Clock cycles of the run the z80 is in the middle of.
+   crtc_run_done: Clock cycles of that run the 6545 has been clocked for.
+   interf_run_done: Clock cycles of that run the interface has been clocked
+        for.
    overlook_timer_firstcall: Set on startup, reset by first call to the
         overlook timer.
 */
@@ -204,6 +293,7 @@ volatile int do_throttle              = 0;
 volatile int is_paused                = 0;
 volatile int sync_point               = 0;
 volatile int overlook_timer_firstcall = 1;
+volatile int throttle_rebase          = 1;
 
 volatile UINT_64 throttle_call_count      = 0;
 volatile SINT_64 actual_clocks            = 0;
@@ -220,6 +310,180 @@ volatile UINT_32 max_crtc_granularity     = DEFAULT_MAX_CRTC_GRANULARITY;
 volatile UINT_8  crtc_clock_division      = REAL_CRTC_CLOCK_DIV;
 volatile UINT_8  max_crtc_clock_division  = DEFAULT_MAX_CRTC_CLOCK_DIV;
          UINT_8  temp_crtc_clock_division = REAL_CRTC_CLOCK_DIV;
+         UINT_32 cpu_trace_depth          = 0;
+         UINT_32 cpu_pc_sample            = 0;
+         UINT_64 pc_sample_count[256];
+         UINT_32 watch_start              = 0;
+         UINT_32 watch_end                = 0x0ffff;
+         UINT_32 watch_kinds              = 0;
+         FILE   *watch_fp                 = NULL;
+
+         snap_data *snapshot       = NULL;
+         snap_ring *rewind_ring    = NULL;
+         UINT_32    rewind_seconds = 0;
+         UINT_32    rewind_frames  = 5;
+
+         UINT_32     netlist_compile = 1;
+         genmod_net *netlist         = NULL;
+
+         char          machine_file[CONFIG_BUFFER_LEN+1] = MACHINE_FILE;
+         UINT_32       machine_report                    = 0;
+         machine_data *machine                           = NULL;
+
+         int crtc_pinned = 0;
+
+         UINT_32 crtc_cycle_counter = 0;
+         UINT_32 crtc_clk_odds      = 0;
+         int     crtc_lazy          = 0;
+         UINT_32 crtc_run_clocks    = 0;
+         UINT_32 crtc_run_done      = 0;
+         UINT_32 interf_run_done    = 0;
+
+volatile int     turbo_mode          = 0;
+volatile UINT_32 turbo_ticks         = 0;
+         FILE   *turbo_fp            = NULL;
+         UINT_64 turbo_clocks        = 0;
+         UINT_64 turbo_runs          = 0;
+         UINT_32 turbo_frames_base   = 0;
+         UINT_64 turbo_host_base     = 0;
+         UINT_64 turbo_cache_base    = 0;
+         UINT_64 turbo_ns_base       = 0;
+         int     turbo_cache_fd      = -1;
+         UINT_64 turbo_total_clocks  = 0;
+         UINT_64 turbo_total_runs    = 0;
+         UINT_64 turbo_total_frames  = 0;
+         UINT_64 turbo_total_host    = 0;
+         UINT_64 turbo_total_cache   = 0;
+         double  turbo_total_ns      = 0;
+         UINT_32 crtc_frame_count    = 0;
+
+         int     batch_headless                   = 0;
+         int     batch_on                         = 0;
+         int     batch_watched                    = 0;
+         int     batch_hit                        = 0;
+         int     batch_has_pc                     = 0;
+         int     batch_has_mem                    = 0;
+         UINT_16 batch_until_pc                   = 0;
+         UINT_16 batch_until_addr                 = 0;
+         UINT_8  batch_until_val                  = 0;
+         char   *batch_until_text                 = NULL;
+         UINT_64 batch_max_cycles                 = 0;
+         UINT_64 batch_cycles                     = 0;
+         UINT_32 batch_text_clocks                = 0;
+         char    batch_text[BATCH_VDU_SIZE+1];
+         char   *batch_key_file                   = NULL;
+         char   *batch_tape_file                  = NULL;
+         int     batch_tape_speed                 = 0;
+         char   *batch_screen_file                = NULL;
+         char   *batch_state_file                 = NULL;
+         int     batch_dumps                      = 0;
+         UINT_16 batch_dump_start[BATCH_MAX_DUMPS];
+         UINT_16 batch_dump_end[BATCH_MAX_DUMPS];
+         char   *batch_dump_file[BATCH_MAX_DUMPS];
+
+/*
+   Machine description
+   ===================
+
+   machine_hosts: what the machine description can refer to as
+        host.<name> (see machine.h).
+   machine_bindings: modules the emulator uses directly, which are picked
+        out of the machine by name once it has been read.  If required is
+        set the machine must have the module, otherwise it is left NULL
+        (and not saved in snapshots) if the machine doesn't.
+*/
+
+typedef struct
+{
+    const char   *name;
+    module_data **module;
+    int           required;
+}
+machine_binding;
+
+machine_host machine_hosts[] =
+{
+    { "stop_emulator",        stop_emulator,        NULL              },
+    { "restart_emulation",    restart_emulation,    NULL              },
+    { "pause_emulation",      pause_emulation,      NULL              },
+    { "set_reset_flag",       set_reset_flag,       NULL              },
+    { "clear_reset_flag",     clear_reset_flag,     NULL              },
+    { "timer_speed_emul_on",  timer_speed_emul_on,  NULL              },
+    { "timer_speed_emul_off", timer_speed_emul_off, NULL              },
+    { "turbo_on",             turbo_on,             NULL              },
+    { "save_machine_state",   save_machine_state,   NULL              },
+    { "load_machine_state",   load_machine_state,   NULL              },
+    { "rewind_machine_state", rewind_machine_state, NULL              },
+    { "crtc_catch_up",        crtc_catch_up,        NULL              },
+    { "interf_catch_up",      interf_catch_up,      NULL              },
+    { "crtc_frame_count",     NULL,                 &crtc_frame_count },
+    { NULL,                   NULL,                 NULL              }
+};
+
+machine_binding machine_bindings[] =
+{
+    { "z80cpu_base",            &z80cpu_base,            1 },
+    { "sy6545_base",            &sy6545_base,            1 },
+    { "z80pio_base",            &z80pio_base,            1 },
+    { "bee_interf",             &bee_interf,             1 },
+    { "bus_z80_reti_count",     &bus_z80_reti_count,     1 },
+    { "bus_z80_clk_left",       &bus_z80_clk_left,       1 },
+    { "mem_user_ram_a",         &mem_user_ram_a,         1 },
+    { "mem_user_ram_b",         &mem_user_ram_b,         1 },
+    { "mem_vdu_ram",            &mem_vdu_ram,            1 },
+    { "mem_pcg_ram",            &mem_pcg_ram,            1 },
+    { "mem_rom1",               &mem_rom1,               1 },
+    { "mem_rom2",               &mem_rom2,               1 },
+    { "mem_rom3",               &mem_rom3,               1 },
+    { "mem_rom4",               &mem_rom4,               1 },
+    { "mem_rom5",               &mem_rom5,               0 },
+    { "mem_colour_ram",         &mem_colour_ram,         0 },
+    { "mem_lpen_feedback",      &mem_lpen_feedback,      0 },
+    { "mem_lpen_feedrfsh",      &mem_lpen_feedrfsh,      0 },
+    { "mem_lpen_table",         &mem_lpen_table,         0 },
+    { "bus_z80_wait",           &bus_z80_wait,           0 },
+    { "bus_z80_rfsh",           &bus_z80_rfsh,           0 },
+    { "bus_z80_data",           &bus_z80_data,           0 },
+    { "bus_z80_addr",           &bus_z80_addr,           0 },
+    { "bus_z80_tab_num_start",  &bus_z80_tab_num_start,  0 },
+    { "bus_z80_tab_num_finish", &bus_z80_tab_num_finish, 0 },
+    { "bus_z80_tab_wr_wait",    &bus_z80_tab_wr_wait,    0 },
+    { "bus_z80_tab_rd_wait",    &bus_z80_tab_rd_wait,    0 },
+    { "bus_sy6545_data",        &bus_sy6545_data,        0 },
+    { "bus_sy6545_addr",        &bus_sy6545_addr,        0 },
+    { "bus_cputabsel",          &bus_cputabsel,          0 },
+    { "bus_lpen_callmask",      &bus_lpen_callmask,      0 },
+    { "bus_cnt_lpen",           &bus_cnt_lpen,           0 },
+    { "bus_cnt_update",         &bus_cnt_update,         0 },
+    { "bus_video_mem_addr",     &bus_video_mem_addr,     0 },
+    { "bus_video_data",         &bus_video_data,         0 },
+    { "bus_video_char_line",    &bus_video_char_line,    0 },
+    { "bus_geom",               &bus_geom,               0 },
+    { "bus_geom_pos_x",         &bus_geom_pos_x,         0 },
+    { "bus_geom_pos_y",         &bus_geom_pos_y,         0 },
+    { "bus_col_isfore",         &bus_col_isfore,         0 },
+    { "bus_col_fore",           &bus_col_fore,           0 },
+    { "bus_col_back",           &bus_col_back,           0 },
+    { "bus_col_inv",            &bus_col_inv,            0 },
+    { "bus_pio_ieo",            &bus_pio_ieo,            0 },
+    { "bus_pio_iei",            &bus_pio_iei,            0 },
+    { "bus_pio_a_rdy",          &bus_pio_a_rdy,          0 },
+    { "bus_pio_a_strb",         &bus_pio_a_strb,         0 },
+    { "bus_pio_a_data",         &bus_pio_a_data,         0 },
+    { "bus_pio_b_rdy",          &bus_pio_b_rdy,          0 },
+    { "bus_pio_b_strb",         &bus_pio_b_strb,         0 },
+    { "bus_pio_b_data",         &bus_pio_b_data,         0 },
+    { "bus_sound_bit",          &bus_sound_bit,          0 },
+    { "bus_tape_out",           &bus_tape_out,           0 },
+    { "bus_tape_in",            &bus_tape_in,            0 },
+    { "bus_romread",            &bus_romread,            0 },
+    { "bus_colctrl",            &bus_colctrl,            0 },
+    { "bus_colback",            &bus_colback,            0 },
+    { "bus_new_romread",        &bus_new_romread,        0 },
+    { "bus_new_colctrl",        &bus_new_colctrl,        0 },
+    { "bus_new_colback",        &bus_new_colback,        0 },
+    { NULL,                     NULL,                    0 }
+};
 
 
 
@@ -241,8 +505,14 @@ void speed_throttle(void)
     {
         throttle_call_count++;
 
+        if ( turbo_mode )
+        {
+            turbo_ticks++;
+        }
+
         if ( do_throttle )
         {
+            #ifndef THROTTLE_SLEEPS
             actual_clocks += timer_period_x/clock_period;
 
             #ifndef DISABLE_CRTC_THROTTLING
@@ -250,23 +520,10 @@ void speed_throttle(void)
             {
                 actual_clocks = max_clockovr_pb;
 
-                /*
-                   The emulator is not keeping up, so try to reduce the
-                   load due to CRTC emulation.
-                */
-
-                if ( crtc_granularity < max_crtc_granularity )
-                {
-                    crtc_granularity++;
-                }
-
-                else if ( crtc_clock_division < max_crtc_clock_division )
-                {
-                    crtc_granularity     = REAL_CRTC_GRANULARITY;
-                    crtc_clock_division *= 2;
-                }
+                throttle_behind();
             }
             #endif
+            #endif
 
             /*
                If we're going really fast, we can afford to slow down
@@ -274,7 +531,7 @@ void speed_throttle(void)
             */
 
             #ifndef DISABLE_CRTC_THROTTLING
-            if ( is_wait )
+            if ( is_wait && !crtc_pinned )
             {
                 if ( is_wait >= lag_point )
                 {
@@ -305,6 +562,33 @@ void speed_throttle(void)
 }
 END_OF_FUNCTION(speed_throttle)
 
+void throttle_behind(void)
+{
+    /*
+       The emulator is not keeping up, so try to reduce the load due to
+       CRTC emulation.
+    */
+
+    if ( crtc_pinned )
+    {
+        /* leave the 6545 alone */
+    }
+
+    else if ( crtc_granularity < max_crtc_granularity )
+    {
+        crtc_granularity++;
+    }
+
+    else if ( crtc_clock_division < max_crtc_clock_division )
+    {
+        crtc_granularity     = REAL_CRTC_GRANULARITY;
+        crtc_clock_division *= 2;
+    }
+
+    return;
+}
+END_OF_FUNCTION(throttle_behind)
+
 void overlook_timer(void)
 {
     if ( !is_paused )
@@ -332,10 +616,69 @@ void overlook_timer(void)
 }
 END_OF_FUNCTION(overlook_timer)
 
+#ifdef HOST_CLOCK_NS
+UINT_64 throttle_host_ns(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC,&now);
+
+    return ( ( (UINT_64) now.tv_sec ) * 1000000000 ) + (UINT_64) now.tv_nsec;
+}
+#endif
+
+#ifdef THROTTLE_SLEEPS
+void throttle_sleep_until(UINT_64 deadline)
+{
+    struct timespec wake;
+
+    /*
+       Sleep until THROTTLE_SPIN_NS before the deadline and spin for the
+       rest.  The host may well oversleep by more than that, but that's
+       made up on the next run.
+    */
+
+    if ( deadline > THROTTLE_SPIN_NS )
+    {
+        wake.tv_sec  = (time_t) ( ( deadline - THROTTLE_SPIN_NS ) / 1000000000 );
+        wake.tv_nsec = (long)   ( ( deadline - THROTTLE_SPIN_NS ) % 1000000000 );
+
+        while ( clock_nanosleep(CLOCK_MONOTONIC,TIMER_ABSTIME,&wake,NULL) == EINTR )
+        {
+            if ( !do_throttle )
+            {
+                return;
+            }
+        }
+    }
+
+    while ( throttle_host_ns() < deadline )
+    {
+        if ( !do_throttle )
+        {
+            break;
+        }
+    }
+
+    return;
+}
+#endif
+
 
 int main(int argc, char *argv[])
 {
     int configerror;
+    char *cpu_report;
+    char *pc_report = NULL;
+    char *turbo_report_str = NULL;
+    char *batch_report_str = NULL;
+    char *netlist_report = NULL;
+    char *machine_report_str;
+    machine_binding *binding;
+    int turbo_cmdline = 0;
+    int batch_exit = 0;
+    int argused;
+    const char *opt;
     SetupData main_setdat[] = { { "timer_period",         &timer_period_x,          2, 1,   50     },
                                 { "max_crtc_granularity", &max_crtc_granularity,    2, 1,   512    },
                                 { "max_crtc_clock_div",   &max_crtc_clock_division, 0, 1,   512    },
@@ -344,12 +687,23 @@ int main(int argc, char *argv[])
                                 { "max_clockovr_pb",      &max_clockovr_pb,         2, 100, 200000 },
                                 { "catchup_point",        &catchup_point,           2, 100, 200000 },
                                 { "lag_point",            &lag_point,               2, 2,   100    },
+                                { "cpu_trace_depth",      &cpu_trace_depth,         2, 0,   200000 },
+                                { "cpu_pc_sample",        &cpu_pc_sample,           2, 0,   1      },
+                                { "watch_start",          &watch_start,             2, 0,   65535  },
+                                { "watch_end",            &watch_end,               2, 0,   65535  },
+                                { "watch_kinds",          &watch_kinds,             2, 0,   7      },
+                                { "rewind_seconds",       &rewind_seconds,          2, 0,   600    },
+                                { "rewind_frames",        &rewind_frames,           2, 1,   50     },
+                                { "netlist_compile",      &netlist_compile,         2, 0,   1      },
+                                { "machine_file",         machine_file,             7, 0,   0      },
+                                { "machine_report",       &machine_report,          2, 0,   1      },
                                 { "", NULL, 0, 0, 0 } };
     SetupData *all_setdat[2] = { main_setdat , NULL };
     char *configfilename;
     char standard_configfile[] = CONFIG_FILE;
 
     LOCK_FUNCTION(speed_throttle);
+    LOCK_FUNCTION(throttle_behind);
     LOCK_FUNCTION(overlook_timer);
 
     LOCK_VARIABLE(do_throttle);
@@ -368,6 +722,8 @@ int main(int argc, char *argv[])
     LOCK_VARIABLE(sync_point);
     LOCK_VARIABLE(overlook_timer_firstcall);
     LOCK_VARIABLE(throttle_call_count);
+    LOCK_VARIABLE(turbo_mode);
+    LOCK_VARIABLE(turbo_ticks);
 
     #ifdef DEBUGMODE
     fprintf(stderr,"starting emulator\n");
@@ -379,14 +735,44 @@ int main(int argc, char *argv[])
 
     configfilename = standard_configfile;
 
+    /*
+       Options may be given as -opt or --opt (see "Batch runs").
+    */
+
+    while ( ( argc >= 2 ) && ( argv[1][0] == '-' ) )
+    {
+        opt = argv[1] + ( ( argv[1][1] == '-' ) ? 2 : 1 );
+
+        if ( strcmp(opt,"turbo") == 0 )
+        {
+            turbo_cmdline = 1;
+
+            argused = 1;
+        }
+
+        else if ( ( argused = batch_option(opt,argc-2,argv+2) ) == 0 )
+        {
+            argc = 0;
+
+            break;
+        }
+
+        argc -= argused;
+        argv += argused;
+    }
+
     if ( argc == 2 )
     {
         configfilename = argv[1];
     }
 
-    if ( argc >= 3 )
+    if ( ( argc == 0 ) || ( argc >= 3 ) )
     {
-        printf("Usage: mbee32k {control_file}\n");
+        printf("Usage: mbee32k [-turbo] [-headless] [batch options] {control_file}\n"
+               "Batch options: -load file, -load1200 file, -keys file,\n"
+               "               -until-pc addr, -until-mem addr=val, -until-text string,\n"
+               "               -max-cycles n, -dump-screen file, -dump-ram start-end=file,\n"
+               "               -save-state file\n");
 
         return 2;
     }
@@ -400,1309 +786,79 @@ int main(int argc, char *argv[])
 
     timer_period_x *= 1000000;
 
+    machine_file[strcspn(machine_file," \t\r\n")] = '\0';
+
     /*
-       Allocate modules
+       Build the machine from its description (see machine.h), then pick
+       out the modules the emulator deals with directly.
     */
 
     #ifdef DEBUGMODE
-    fprintf(stderr,"allocating modules\n");
+    fprintf(stderr,"build machine\n");
     #endif
 
-    if ( ( mask_colback           = andconstmod_alloc("")                  ) == NULL ) { return 10; }
-    if ( ( mask_colctrl           = andconstmod_alloc("")                  ) == NULL ) { return 10; }
-    if ( ( mask_pio_b             = andconstmod_alloc("")                  ) == NULL ) { return 10; }
-    if ( ( mask_romread           = andconstmod_alloc("")                  ) == NULL ) { return 10; }
-    if ( ( mask_soundbit          = andconstmod_alloc("")                  ) == NULL ) { return 10; }
-    if ( ( mask_tapeout           = andconstmod_alloc("")                  ) == NULL ) { return 10; }
-    if ( ( mask_video_mem_addr    = andconstmod_alloc("")                  ) == NULL ) { return 10; }
-    if ( ( mask_video_mem_slfaddr = andconstmod_alloc("")                  ) == NULL ) { return 10; }
-    if ( ( mask_video_charline    = andconstmod_alloc("")                  ) == NULL ) { return 10; }
-    if ( ( mask_video_data        = andconstmod_alloc("")                  ) == NULL ) { return 10; }
-    if ( ( assign_colback         = assignmod_alloc("")                    ) == NULL ) { return 10; }
-    if ( ( assign_colctrl         = assignmod_alloc("")                    ) == NULL ) { return 10; }
-    if ( ( assign_romread         = assignmod_alloc("")                    ) == NULL ) { return 10; }
-    if ( ( assign_video_data      = assignmod_alloc("")                    ) == NULL ) { return 10; }
-    if ( ( assign_video_charline  = assignmod_alloc("")                    ) == NULL ) { return 10; }
-    if ( ( assign_lpenmask0       = assignconstmod_alloc("")               ) == NULL ) { return 10; }
-    if ( ( assign_lpenmask1       = assignconstmod_alloc("")               ) == NULL ) { return 10; }
-    if ( ( bus_cnt_lpen           = busmod_alloc("")                       ) == NULL ) { return 10; }
-    if ( ( bus_cnt_update         = busmod_alloc("")                       ) == NULL ) { return 10; }
-    if ( ( bus_col_back           = busmod_alloc("")                       ) == NULL ) { return 10; }
-    if ( ( bus_col_fore           = busmod_alloc("")                       ) == NULL ) { return 10; }
-    if ( ( bus_col_inv            = busmod_alloc("")                       ) == NULL ) { return 10; }
-    if ( ( bus_col_isfore         = busmod_alloc("")                       ) == NULL ) { return 10; }
-    if ( ( bus_colback            = busmod_alloc("")                       ) == NULL ) { return 10; }
-    if ( ( bus_colctrl            = busmod_alloc("")                       ) == NULL ) { return 10; }
-    if ( ( bus_cputabsel          = busmod_alloc("")                       ) == NULL ) { return 10; }
-    if ( ( bus_geom               = busmod_alloc("")                       ) == NULL ) { return 10; }
-    if ( ( bus_geom_pos_x         = busmod_alloc("")                       ) == NULL ) { return 10; }
-    if ( ( bus_geom_pos_y         = busmod_alloc("")                       ) == NULL ) { return 10; }
-    if ( ( bus_lpen_callmask      = busmod_alloc("")                       ) == NULL ) { return 10; }
-    if ( ( bus_new_colback        = busmod_alloc("")                       ) == NULL ) { return 10; }
-    if ( ( bus_new_colctrl        = busmod_alloc("")                       ) == NULL ) { return 10; }
-    if ( ( bus_new_romread        = busmod_alloc("")                       ) == NULL ) { return 10; }
-    if ( ( bus_pio_iei            = busmod_alloc("")                       ) == NULL ) { return 10; }
-    if ( ( bus_pio_ieo            = busmod_alloc("")                       ) == NULL ) { return 10; }
-    if ( ( bus_pio_a_data         = busmod_alloc("")                       ) == NULL ) { return 10; }
-    if ( ( bus_pio_a_rdy          = busmod_alloc("")                       ) == NULL ) { return 10; }
-    if ( ( bus_pio_a_strb         = busmod_alloc("")                       ) == NULL ) { return 10; }
-    if ( ( bus_pio_b_data         = busmod_alloc("")                       ) == NULL ) { return 10; }
-    if ( ( bus_pio_b_rdy          = busmod_alloc("")                       ) == NULL ) { return 10; }
-    if ( ( bus_pio_b_strb         = busmod_alloc("")                       ) == NULL ) { return 10; }
-    if ( ( bus_romread            = busmod_alloc("")                       ) == NULL ) { return 10; }
-    if ( ( bus_sound_bit          = busmod_alloc("")                       ) == NULL ) { return 10; }
-    if ( ( bus_sy6545_addr        = busmod_alloc("")                       ) == NULL ) { return 10; }
-    if ( ( bus_sy6545_data        = busmod_alloc("")                       ) == NULL ) { return 10; }
-    if ( ( bus_tape_in            = busmod_alloc("")                       ) == NULL ) { return 10; }
-    if ( ( bus_tape_out           = busmod_alloc("")                       ) == NULL ) { return 10; }
-    if ( ( bus_video_char_line    = busmod_alloc("")                       ) == NULL ) { return 10; }
-    if ( ( bus_video_data         = busmod_alloc("")                       ) == NULL ) { return 10; }
-    if ( ( bus_video_mem_addr     = busmod_alloc("")                       ) == NULL ) { return 10; }
-    if ( ( bus_z80_addr           = busmod_alloc("")                       ) == NULL ) { return 10; }
-    if ( ( bus_z80_data           = busmod_alloc("")                       ) == NULL ) { return 10; }
-    if ( ( bus_z80_reti_count     = busmod_alloc("")                       ) == NULL ) { return 10; }
-    if ( ( bus_z80_rfsh           = busmod_alloc("")                       ) == NULL ) { return 10; }
-    if ( ( bus_z80_tab_num_start  = busmod_alloc("")                       ) == NULL ) { return 10; }
-    if ( ( bus_z80_tab_num_finish = busmod_alloc("")                       ) == NULL ) { return 10; }
-    if ( ( bus_z80_tab_rd_wait    = busmod_alloc("")                       ) == NULL ) { return 10; }
-    if ( ( bus_z80_tab_wr_wait    = busmod_alloc("")                       ) == NULL ) { return 10; }
-    if ( ( bus_z80_wait           = busmod_alloc("")                       ) == NULL ) { return 10; }
-    if ( ( do_fixup_romread       = domod_alloc("")                        ) == NULL ) { return 10; }
-    if ( ( do_init_ramset         = domod_alloc("")                        ) == NULL ) { return 10; }
-    if ( ( do_reset_ramset        = domod_alloc("")                        ) == NULL ) { return 10; }
-    if ( ( do_romread_goes_high   = domod_alloc("")                        ) == NULL ) { return 10; }
-    if ( ( do_romread_goes_low    = domod_alloc("")                        ) == NULL ) { return 10; }
-    if ( ( do_romread_wr          = domod_alloc("")                        ) == NULL ) { return 10; }
-    if ( ( do_startup_ramtest     = domod_alloc("")                        ) == NULL ) { return 10; }
-    if ( ( do_vdu_ram_wr          = domod_alloc("")                        ) == NULL ) { return 10; }
-    if ( ( do_z80_ack_INT         = domod_alloc("")                        ) == NULL ) { return 10; }
-    if ( ( do_z80_ack_reset       = domod_alloc("")                        ) == NULL ) { return 10; }
-    if ( ( do_col_ram_wr          = domod_alloc("")                        ) == NULL ) { return 10; }
-    if ( ( do_pcg_ram_wr          = domod_alloc("")                        ) == NULL ) { return 10; }
-    if ( ( do_switch_in_col_ram   = domod_alloc("")                        ) == NULL ) { return 10; }
-    if ( ( do_switch_in_pcg_ram   = domod_alloc("")                        ) == NULL ) { return 10; }
-    if ( ( do_colback_change      = domod_alloc("")                        ) == NULL ) { return 10; }
-    if ( ( do_colctrl_change      = domod_alloc("")                        ) == NULL ) { return 10; }
-    if ( ( do_col_port_wr         = domod_alloc("")                        ) == NULL ) { return 10; }
-    if ( ( do_pio_b_rdy_data_out  = domod_alloc("")                        ) == NULL ) { return 10; }
-    if ( ( do_tape_strober        = domod_alloc("")                        ) == NULL ) { return 10; }
-    if ( ( dowhile_redo_bcolint   = dowhilemod_alloc("")                   ) == NULL ) { return 10; }
-    if ( ( branch_if_romread_diff = equalsmod_alloc("")                    ) == NULL ) { return 10; }
-    if ( ( branch_mem_startup     = equalsconstmod_alloc("")               ) == NULL ) { return 10; }
-    if ( ( branch_romread_change  = istruemod_alloc("")                    ) == NULL ) { return 10; }
-    if ( ( branch_vdu_ram_wr      = istruemod_alloc("")                    ) == NULL ) { return 10; }
-    if ( ( branch_sw_col_pcg      = istruemod_alloc("")                    ) == NULL ) { return 10; }
-    if ( ( branch_memwr           = lessconstmod_alloc("")                 ) == NULL ) { return 10; }
-    if ( ( branch_sub_colpcg      = istruemod_alloc("")                    ) == NULL ) { return 10; }
-    if ( ( branch_diff_colback    = equalsmod_alloc("")                    ) == NULL ) { return 10; }
-    if ( ( branch_diff_colctrl    = equalsmod_alloc("")                    ) == NULL ) { return 10; }
-    if ( ( lut8_colour_table      = lut8mod_alloc("")                      ) == NULL ) { return 10; }
-    if ( ( mem_colour_ram         = memmod_alloc("ram_col")                ) == NULL ) { return 10; }
-    if ( ( mem_lpen_feedback      = memmod_alloc("ram_lpen_readcnt")       ) == NULL ) { return 10; }
-    if ( ( mem_lpen_feedrfsh      = memmod_alloc("ram_lpen_rfshcnt")       ) == NULL ) { return 10; }
-    if ( ( mem_lpen_table         = memmod_alloc("ram_lpen_keymap")        ) == NULL ) { return 10; }
-    if ( ( mem_pcg_ram            = memmod_alloc("ram_pcg")                ) == NULL ) { return 10; }
-    if ( ( mem_rom1               = memmod_alloc("rom_basic1")             ) == NULL ) { return 10; }
-    if ( ( mem_rom2               = memmod_alloc("rom_basic2")             ) == NULL ) { return 10; }
-    if ( ( mem_rom3               = memmod_alloc("rom_edasm")              ) == NULL ) { return 10; }
-    if ( ( mem_rom4               = memmod_alloc("rom_empty")              ) == NULL ) { return 10; }
-    if ( ( mem_rom5               = memmod_alloc("rom_char")               ) == NULL ) { return 10; }
-    if ( ( mem_user_ram_a         = memmod_alloc("ram_base1")              ) == NULL ) { return 10; }
-    if ( ( mem_user_ram_b         = memmod_alloc("ram_base2")              ) == NULL ) { return 10; }
-    if ( ( mem_vdu_ram            = memmod_alloc("ram_vdu")                ) == NULL ) { return 10; }
-    if ( ( or_backcol_backint     = ormod_alloc("")                        ) == NULL ) { return 10; }
-    if ( ( or_pio_b_tape          = ormod_alloc("")                        ) == NULL ) { return 10; }
-    if ( ( setbus_cpu_tab         = setbusmod_alloc("")                    ) == NULL ) { return 10; }
-    if ( ( jtable_io_rd__base     = table8mod_alloc("")                    ) == NULL ) { return 10; }
-    if ( ( jtable_io_wr__base     = table8mod_alloc("")                    ) == NULL ) { return 10; }
-
-    if ( ( bee_interf             = interf_alloc("")                       ) == NULL ) { return 10; }
-    if ( ( sy6545_base            = sy6545_alloc("crtc")                   ) == NULL ) { return 10; }
-    if ( ( z80cpu_base            = z80cpu_alloc("")                       ) == NULL ) { return 10; }
-    if ( ( z80pio_base            = z80pio_alloc("")                       ) == NULL ) { return 10; }
-
-    /*
-       Set variables controlling module performance
-    */
+    if ( ( machine = machine_alloc(machine_file,machine_hosts) ) == NULL )
+    {
+        return 10;
+    }
 
-    #ifdef DEBUGMODE
-    fprintf(stderr,"set module variables\n");
-    #endif
+    if ( machine->error[0] != '\0' )
+    {
+        printf("%s\n",machine->error);
 
-    DEBDEREF((mask_colback->var_8bit),0)            = 0x00e;
-    DEBDEREF((mask_colctrl->var_8bit),0)            = 0x040;
-    DEBDEREF((mask_pio_b->var_8bit),0)              = 0x0fe;
-    DEBDEREF((mask_romread->var_8bit),0)            = 0x001;
-    DEBDEREF((mask_soundbit->var_8bit),0)           = 0x040;
-    DEBDEREF((mask_tapeout->var_8bit),0)            = 0x002;
-    DEBDEREF((mask_video_mem_addr->var_16bit),0)    = 0x007FF;
-    DEBDEREF((mask_video_mem_slfaddr->var_16bit),0) = 0x007FF;
-    DEBDEREF((mask_video_charline->var_8bit),0)     = 0x00f;
-    DEBDEREF((mask_video_data->var_16bit),0)        = 0x000E0;
-
-    DEBDEREF((assign_lpenmask0->var_32bit),0) = ROMREAD0_LPEN_MASK;
-    DEBDEREF((assign_lpenmask1->var_32bit),0) = ROMREAD1_LPEN_MASK;
-
-    DEBDEREF((branch_mem_startup->var_16bit),0) = 0x07fff;
-    DEBDEREF((branch_memwr->var_16bit),0)       = 0x0f800;
-
-    DEBDEREF((bus_lpen_callmask->var_32bit),0) = ROMREAD0_LPEN_MASK;
-
-    DEBDEREF((do_fixup_romread->var_32bit),0)      = 2;
-    DEBDEREF((do_init_ramset->var_32bit),0)        = 54;
-    DEBDEREF((do_reset_ramset->var_32bit),0)       = 10;
-    DEBDEREF((do_romread_goes_high->var_32bit),0)  = 7;
-    DEBDEREF((do_romread_goes_low->var_32bit),0)   = 7;
-    DEBDEREF((do_startup_ramtest->var_32bit),0)    = 2;
-    DEBDEREF((do_romread_wr->var_32bit),0)         = 2;
-    DEBDEREF((do_z80_ack_INT->var_32bit),0)        = 3;
-    DEBDEREF((do_z80_ack_reset->var_32bit),0)      = 7;
-    DEBDEREF((do_vdu_ram_wr->var_32bit),0)         = 4;
-    DEBDEREF((do_col_ram_wr->var_32bit),0)         = 10;
-    DEBDEREF((do_pcg_ram_wr->var_32bit),0)         = 11;
-    DEBDEREF((do_switch_in_col_ram->var_32bit),0)  = 6;
-    DEBDEREF((do_switch_in_pcg_ram->var_32bit),0)  = 6;
-    DEBDEREF((do_colback_change->var_32bit),0)     = 3;
-    DEBDEREF((do_colctrl_change->var_32bit),0)     = 2;
-    DEBDEREF((do_col_port_wr->var_32bit),0)        = 5;
-    DEBDEREF((do_pio_b_rdy_data_out->var_32bit),0) = 4;
-    DEBDEREF((do_tape_strober->var_32bit),0)       = 3;
-
-    DEBDEREF((dowhile_redo_bcolint->var_32bit),0) = 9;
-
-    DEBDEREF((lut8_colour_table->var_8bit),0x000) = 0x000;
-    DEBDEREF((lut8_colour_table->var_8bit),0x001) = 0x008;
-    DEBDEREF((lut8_colour_table->var_8bit),0x002) = 0x010;
-    DEBDEREF((lut8_colour_table->var_8bit),0x003) = 0x018;
-    DEBDEREF((lut8_colour_table->var_8bit),0x004) = 0x020;
-    DEBDEREF((lut8_colour_table->var_8bit),0x005) = 0x028;
-    DEBDEREF((lut8_colour_table->var_8bit),0x006) = 0x030;
-    DEBDEREF((lut8_colour_table->var_8bit),0x007) = 0x038;
-    DEBDEREF((lut8_colour_table->var_8bit),0x008) = 0x006;
-    DEBDEREF((lut8_colour_table->var_8bit),0x009) = 0x00e;
-    DEBDEREF((lut8_colour_table->var_8bit),0x00a) = 0x016;
-    DEBDEREF((lut8_colour_table->var_8bit),0x00b) = 0x01e;
-    DEBDEREF((lut8_colour_table->var_8bit),0x00c) = 0x026;
-    DEBDEREF((lut8_colour_table->var_8bit),0x00d) = 0x02e;
-    DEBDEREF((lut8_colour_table->var_8bit),0x00e) = 0x036;
-    DEBDEREF((lut8_colour_table->var_8bit),0x00f) = 0x03e;
-    DEBDEREF((lut8_colour_table->var_8bit),0x010) = 0x007;
-    DEBDEREF((lut8_colour_table->var_8bit),0x011) = 0x00f;
-    DEBDEREF((lut8_colour_table->var_8bit),0x012) = 0x017;
-    DEBDEREF((lut8_colour_table->var_8bit),0x013) = 0x01f;
-    DEBDEREF((lut8_colour_table->var_8bit),0x014) = 0x027;
-    DEBDEREF((lut8_colour_table->var_8bit),0x015) = 0x02f;
-    DEBDEREF((lut8_colour_table->var_8bit),0x016) = 0x037;
-    DEBDEREF((lut8_colour_table->var_8bit),0x017) = 0x03f;
-    DEBDEREF((lut8_colour_table->var_8bit),0x018) = 0x005;
-    DEBDEREF((lut8_colour_table->var_8bit),0x019) = 0x00d;
-    DEBDEREF((lut8_colour_table->var_8bit),0x01a) = 0x015;
-    DEBDEREF((lut8_colour_table->var_8bit),0x01b) = 0x01d;
-    DEBDEREF((lut8_colour_table->var_8bit),0x01c) = 0x025;
-    DEBDEREF((lut8_colour_table->var_8bit),0x01d) = 0x02d;
-    DEBDEREF((lut8_colour_table->var_8bit),0x01e) = 0x035;
-    DEBDEREF((lut8_colour_table->var_8bit),0x01f) = 0x03d;
-    DEBDEREF((lut8_colour_table->var_8bit),0x020) = 0x000;
-    DEBDEREF((lut8_colour_table->var_8bit),0x021) = 0x008;
-    DEBDEREF((lut8_colour_table->var_8bit),0x022) = 0x010;
-    DEBDEREF((lut8_colour_table->var_8bit),0x023) = 0x018;
-    DEBDEREF((lut8_colour_table->var_8bit),0x024) = 0x020;
-    DEBDEREF((lut8_colour_table->var_8bit),0x025) = 0x028;
-    DEBDEREF((lut8_colour_table->var_8bit),0x026) = 0x030;
-    DEBDEREF((lut8_colour_table->var_8bit),0x027) = 0x038;
-    DEBDEREF((lut8_colour_table->var_8bit),0x028) = 0x006;
-    DEBDEREF((lut8_colour_table->var_8bit),0x029) = 0x00e;
-    DEBDEREF((lut8_colour_table->var_8bit),0x02a) = 0x016;
-    DEBDEREF((lut8_colour_table->var_8bit),0x02b) = 0x01e;
-    DEBDEREF((lut8_colour_table->var_8bit),0x02c) = 0x026;
-    DEBDEREF((lut8_colour_table->var_8bit),0x02d) = 0x02e;
-    DEBDEREF((lut8_colour_table->var_8bit),0x02e) = 0x036;
-    DEBDEREF((lut8_colour_table->var_8bit),0x02f) = 0x03e;
-    DEBDEREF((lut8_colour_table->var_8bit),0x030) = 0x007;
-    DEBDEREF((lut8_colour_table->var_8bit),0x031) = 0x00f;
-    DEBDEREF((lut8_colour_table->var_8bit),0x032) = 0x017;
-    DEBDEREF((lut8_colour_table->var_8bit),0x033) = 0x01f;
-    DEBDEREF((lut8_colour_table->var_8bit),0x034) = 0x027;
-    DEBDEREF((lut8_colour_table->var_8bit),0x035) = 0x02f;
-    DEBDEREF((lut8_colour_table->var_8bit),0x036) = 0x037;
-    DEBDEREF((lut8_colour_table->var_8bit),0x037) = 0x03f;
-    DEBDEREF((lut8_colour_table->var_8bit),0x038) = 0x005;
-    DEBDEREF((lut8_colour_table->var_8bit),0x039) = 0x00d;
-    DEBDEREF((lut8_colour_table->var_8bit),0x03a) = 0x015;
-    DEBDEREF((lut8_colour_table->var_8bit),0x03b) = 0x01d;
-    DEBDEREF((lut8_colour_table->var_8bit),0x03c) = 0x025;
-    DEBDEREF((lut8_colour_table->var_8bit),0x03d) = 0x02d;
-    DEBDEREF((lut8_colour_table->var_8bit),0x03e) = 0x035;
-    DEBDEREF((lut8_colour_table->var_8bit),0x03f) = 0x03d;
-    DEBDEREF((lut8_colour_table->var_8bit),0x040) = 0x000;
-    DEBDEREF((lut8_colour_table->var_8bit),0x041) = 0x008;
-    DEBDEREF((lut8_colour_table->var_8bit),0x042) = 0x010;
-    DEBDEREF((lut8_colour_table->var_8bit),0x043) = 0x018;
-    DEBDEREF((lut8_colour_table->var_8bit),0x044) = 0x020;
-    DEBDEREF((lut8_colour_table->var_8bit),0x045) = 0x028;
-    DEBDEREF((lut8_colour_table->var_8bit),0x046) = 0x030;
-    DEBDEREF((lut8_colour_table->var_8bit),0x047) = 0x038;
-    DEBDEREF((lut8_colour_table->var_8bit),0x048) = 0x006;
-    DEBDEREF((lut8_colour_table->var_8bit),0x049) = 0x00e;
-    DEBDEREF((lut8_colour_table->var_8bit),0x04a) = 0x016;
-    DEBDEREF((lut8_colour_table->var_8bit),0x04b) = 0x01e;
-    DEBDEREF((lut8_colour_table->var_8bit),0x04c) = 0x026;
-    DEBDEREF((lut8_colour_table->var_8bit),0x04d) = 0x02e;
-    DEBDEREF((lut8_colour_table->var_8bit),0x04e) = 0x036;
-    DEBDEREF((lut8_colour_table->var_8bit),0x04f) = 0x03e;
-    DEBDEREF((lut8_colour_table->var_8bit),0x050) = 0x007;
-    DEBDEREF((lut8_colour_table->var_8bit),0x051) = 0x00f;
-    DEBDEREF((lut8_colour_table->var_8bit),0x052) = 0x017;
-    DEBDEREF((lut8_colour_table->var_8bit),0x053) = 0x01f;
-    DEBDEREF((lut8_colour_table->var_8bit),0x054) = 0x027;
-    DEBDEREF((lut8_colour_table->var_8bit),0x055) = 0x02f;
-    DEBDEREF((lut8_colour_table->var_8bit),0x056) = 0x037;
-    DEBDEREF((lut8_colour_table->var_8bit),0x057) = 0x03f;
-    DEBDEREF((lut8_colour_table->var_8bit),0x058) = 0x005;
-    DEBDEREF((lut8_colour_table->var_8bit),0x059) = 0x00d;
-    DEBDEREF((lut8_colour_table->var_8bit),0x05a) = 0x015;
-    DEBDEREF((lut8_colour_table->var_8bit),0x05b) = 0x01d;
-    DEBDEREF((lut8_colour_table->var_8bit),0x05c) = 0x025;
-    DEBDEREF((lut8_colour_table->var_8bit),0x05d) = 0x02d;
-    DEBDEREF((lut8_colour_table->var_8bit),0x05e) = 0x035;
-    DEBDEREF((lut8_colour_table->var_8bit),0x05f) = 0x03d;
-    DEBDEREF((lut8_colour_table->var_8bit),0x060) = 0x000;
-    DEBDEREF((lut8_colour_table->var_8bit),0x061) = 0x008;
-    DEBDEREF((lut8_colour_table->var_8bit),0x062) = 0x010;
-    DEBDEREF((lut8_colour_table->var_8bit),0x063) = 0x018;
-    DEBDEREF((lut8_colour_table->var_8bit),0x064) = 0x020;
-    DEBDEREF((lut8_colour_table->var_8bit),0x065) = 0x028;
-    DEBDEREF((lut8_colour_table->var_8bit),0x066) = 0x030;
-    DEBDEREF((lut8_colour_table->var_8bit),0x067) = 0x038;
-    DEBDEREF((lut8_colour_table->var_8bit),0x068) = 0x006;
-    DEBDEREF((lut8_colour_table->var_8bit),0x069) = 0x00e;
-    DEBDEREF((lut8_colour_table->var_8bit),0x06a) = 0x016;
-    DEBDEREF((lut8_colour_table->var_8bit),0x06b) = 0x01e;
-    DEBDEREF((lut8_colour_table->var_8bit),0x06c) = 0x026;
-    DEBDEREF((lut8_colour_table->var_8bit),0x06d) = 0x02e;
-    DEBDEREF((lut8_colour_table->var_8bit),0x06e) = 0x036;
-    DEBDEREF((lut8_colour_table->var_8bit),0x06f) = 0x03e;
-    DEBDEREF((lut8_colour_table->var_8bit),0x070) = 0x007;
-    DEBDEREF((lut8_colour_table->var_8bit),0x071) = 0x00f;
-    DEBDEREF((lut8_colour_table->var_8bit),0x072) = 0x017;
-    DEBDEREF((lut8_colour_table->var_8bit),0x073) = 0x01f;
-    DEBDEREF((lut8_colour_table->var_8bit),0x074) = 0x027;
-    DEBDEREF((lut8_colour_table->var_8bit),0x075) = 0x02f;
-    DEBDEREF((lut8_colour_table->var_8bit),0x076) = 0x037;
-    DEBDEREF((lut8_colour_table->var_8bit),0x077) = 0x03f;
-    DEBDEREF((lut8_colour_table->var_8bit),0x078) = 0x005;
-    DEBDEREF((lut8_colour_table->var_8bit),0x079) = 0x00d;
-    DEBDEREF((lut8_colour_table->var_8bit),0x07a) = 0x015;
-    DEBDEREF((lut8_colour_table->var_8bit),0x07b) = 0x01d;
-    DEBDEREF((lut8_colour_table->var_8bit),0x07c) = 0x025;
-    DEBDEREF((lut8_colour_table->var_8bit),0x07d) = 0x02d;
-    DEBDEREF((lut8_colour_table->var_8bit),0x07e) = 0x035;
-    DEBDEREF((lut8_colour_table->var_8bit),0x07f) = 0x03d;
-    DEBDEREF((lut8_colour_table->var_8bit),0x080) = 0x000;
-    DEBDEREF((lut8_colour_table->var_8bit),0x081) = 0x008;
-    DEBDEREF((lut8_colour_table->var_8bit),0x082) = 0x010;
-    DEBDEREF((lut8_colour_table->var_8bit),0x083) = 0x018;
-    DEBDEREF((lut8_colour_table->var_8bit),0x084) = 0x020;
-    DEBDEREF((lut8_colour_table->var_8bit),0x085) = 0x028;
-    DEBDEREF((lut8_colour_table->var_8bit),0x086) = 0x030;
-    DEBDEREF((lut8_colour_table->var_8bit),0x087) = 0x038;
-    DEBDEREF((lut8_colour_table->var_8bit),0x088) = 0x006;
-    DEBDEREF((lut8_colour_table->var_8bit),0x089) = 0x00e;
-    DEBDEREF((lut8_colour_table->var_8bit),0x08a) = 0x016;
-    DEBDEREF((lut8_colour_table->var_8bit),0x08b) = 0x01e;
-    DEBDEREF((lut8_colour_table->var_8bit),0x08c) = 0x026;
-    DEBDEREF((lut8_colour_table->var_8bit),0x08d) = 0x02e;
-    DEBDEREF((lut8_colour_table->var_8bit),0x08e) = 0x036;
-    DEBDEREF((lut8_colour_table->var_8bit),0x08f) = 0x03e;
-    DEBDEREF((lut8_colour_table->var_8bit),0x090) = 0x007;
-    DEBDEREF((lut8_colour_table->var_8bit),0x091) = 0x00f;
-    DEBDEREF((lut8_colour_table->var_8bit),0x092) = 0x017;
-    DEBDEREF((lut8_colour_table->var_8bit),0x093) = 0x01f;
-    DEBDEREF((lut8_colour_table->var_8bit),0x094) = 0x027;
-    DEBDEREF((lut8_colour_table->var_8bit),0x095) = 0x02f;
-    DEBDEREF((lut8_colour_table->var_8bit),0x096) = 0x037;
-    DEBDEREF((lut8_colour_table->var_8bit),0x097) = 0x03f;
-    DEBDEREF((lut8_colour_table->var_8bit),0x098) = 0x005;
-    DEBDEREF((lut8_colour_table->var_8bit),0x099) = 0x00d;
-    DEBDEREF((lut8_colour_table->var_8bit),0x09a) = 0x015;
-    DEBDEREF((lut8_colour_table->var_8bit),0x09b) = 0x01d;
-    DEBDEREF((lut8_colour_table->var_8bit),0x09c) = 0x025;
-    DEBDEREF((lut8_colour_table->var_8bit),0x09d) = 0x02d;
-    DEBDEREF((lut8_colour_table->var_8bit),0x09e) = 0x035;
-    DEBDEREF((lut8_colour_table->var_8bit),0x09f) = 0x03d;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0a0) = 0x000;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0a1) = 0x008;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0a2) = 0x010;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0a3) = 0x018;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0a4) = 0x020;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0a5) = 0x028;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0a6) = 0x030;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0a7) = 0x038;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0a8) = 0x006;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0a9) = 0x00e;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0aa) = 0x016;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0ab) = 0x01e;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0ac) = 0x026;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0ad) = 0x02e;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0ae) = 0x036;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0af) = 0x03e;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0b0) = 0x007;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0b1) = 0x00f;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0b2) = 0x017;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0b3) = 0x01f;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0b4) = 0x027;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0b5) = 0x02f;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0b6) = 0x037;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0b7) = 0x03f;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0b8) = 0x005;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0b9) = 0x00d;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0ba) = 0x015;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0bb) = 0x01d;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0bc) = 0x025;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0bd) = 0x02d;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0be) = 0x035;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0bf) = 0x03d;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0c0) = 0x000;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0c1) = 0x008;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0c2) = 0x010;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0c3) = 0x018;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0c4) = 0x020;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0c5) = 0x028;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0c6) = 0x030;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0c7) = 0x038;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0c8) = 0x006;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0c9) = 0x00e;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0ca) = 0x016;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0cb) = 0x01e;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0cc) = 0x026;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0cd) = 0x02e;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0ce) = 0x036;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0cf) = 0x03e;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0d0) = 0x007;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0d1) = 0x00f;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0d2) = 0x017;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0d3) = 0x01f;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0d4) = 0x027;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0d5) = 0x02f;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0d6) = 0x037;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0d7) = 0x03f;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0d8) = 0x005;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0d9) = 0x00d;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0da) = 0x015;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0db) = 0x01d;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0dc) = 0x025;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0dd) = 0x02d;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0de) = 0x035;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0df) = 0x03d;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0e0) = 0x000;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0e1) = 0x008;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0e2) = 0x010;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0e3) = 0x018;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0e4) = 0x020;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0e5) = 0x028;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0e6) = 0x030;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0e7) = 0x038;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0e8) = 0x006;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0e9) = 0x00e;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0ea) = 0x016;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0eb) = 0x01e;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0ec) = 0x026;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0ed) = 0x02e;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0ee) = 0x036;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0ef) = 0x03e;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0f0) = 0x007;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0f1) = 0x00f;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0f2) = 0x017;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0f3) = 0x01f;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0f4) = 0x027;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0f5) = 0x02f;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0f6) = 0x037;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0f7) = 0x03f;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0f8) = 0x005;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0f9) = 0x00d;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0fa) = 0x015;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0fb) = 0x01d;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0fc) = 0x025;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0fd) = 0x02d;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0fe) = 0x035;
-    DEBDEREF((lut8_colour_table->var_8bit),0x0ff) = 0x03d;
-
-    DEBDEREF((mem_colour_ram->var_32bit),0)    = 0x007ff;
-    DEBDEREF((mem_colour_ram->var_32bit),1)    = 0x007ff;
-    DEBDEREF((mem_lpen_feedback->var_32bit),0) = 0x03fff;
-    DEBDEREF((mem_lpen_feedback->var_32bit),1) = 0x003f0;
-    DEBDEREF((mem_lpen_feedrfsh->var_32bit),0) = 0x03fff;
-    DEBDEREF((mem_lpen_feedrfsh->var_32bit),1) = 0x003f0;
-    DEBDEREF((mem_lpen_table->var_32bit),0)    = 0x03fff;
-    DEBDEREF((mem_lpen_table->var_32bit),1)    = 0x003f0;
-    DEBDEREF((mem_pcg_ram->var_32bit),0)       = 0x007ff;
-    DEBDEREF((mem_pcg_ram->var_32bit),1)       = 0x007ff;
-    DEBDEREF((mem_rom1->var_32bit),0)          = 0x01fff;
-    DEBDEREF((mem_rom1->var_32bit),1)          = 0x01fff;
-    DEBDEREF((mem_rom2->var_32bit),0)          = 0x01fff;
-    DEBDEREF((mem_rom2->var_32bit),1)          = 0x01fff;
-    DEBDEREF((mem_rom3->var_32bit),0)          = 0x01fff;
-    DEBDEREF((mem_rom3->var_32bit),1)          = 0x01fff;
-    DEBDEREF((mem_rom4->var_32bit),0)          = 0x00fff;
-    DEBDEREF((mem_rom4->var_32bit),1)          = 0x00fff;
-    DEBDEREF((mem_rom5->var_32bit),0)          = 0x007ff;
-    DEBDEREF((mem_rom5->var_32bit),1)          = 0x007ff;
-    DEBDEREF((mem_user_ram_a->var_32bit),0)    = 0x03fff;
-    DEBDEREF((mem_user_ram_a->var_32bit),1)    = 0x03fff;
-    DEBDEREF((mem_user_ram_b->var_32bit),0)    = 0x03fff;
-    DEBDEREF((mem_user_ram_b->var_32bit),1)    = 0x03fff;
-    DEBDEREF((mem_vdu_ram->var_32bit),0)       = 0x007ff;
-    DEBDEREF((mem_vdu_ram->var_32bit),1)       = 0x007ff;
-
-    DEREF_STRGVAR(mem_rom1,0) = "bas522a.rom";
-    DEREF_STRGVAR(mem_rom2,0) = "bas522b.rom";
-    DEREF_STRGVAR(mem_rom3,0) = "edasm.rom";
-    DEREF_STRGVAR(mem_rom4,0) = "";
-    DEREF_STRGVAR(mem_rom5,0) = "charrom.rom";
-
-    DEREF_STRGVAR(sy6545_base,0) = "charrom.rom";
+        return 10;
+    }
 
-    DEREF_STRGVAR(bee_interf,0) = configfilename;
+    for ( binding = machine_bindings ; binding->name != NULL ; binding++ )
+    {
+        if ( ( ( *(binding->module) = machine_find(machine,binding->name) ) == NULL ) && binding->required )
+        {
+            printf("%s: there is no %s module.\n",machine_file,binding->name);
 
-    DEBDEREF((setbus_cpu_tab->var_32bit),0) = 10;
-    DEBDEREF((setbus_cpu_tab->var_32bit),3) = 5;
+            return 10;
+        }
+    }
 
-    /*
-       Initialise modules
-    */
+    DEREF_STRGVAR(bee_interf,0) = configfilename;
 
     #ifdef DEBUGMODE
     fprintf(stderr,"init modules\n");
     #endif
 
-    if ( andconstmod_init(mask_colback)           ) { return 11; }
-    if ( andconstmod_init(mask_colctrl)           ) { return 11; }
-    if ( andconstmod_init(mask_pio_b)             ) { return 11; }
-    if ( andconstmod_init(mask_romread)           ) { return 11; }
-    if ( andconstmod_init(mask_soundbit)          ) { return 11; }
-    if ( andconstmod_init(mask_tapeout)           ) { return 11; }
-    if ( andconstmod_init(mask_video_mem_addr)    ) { return 11; }
-    if ( andconstmod_init(mask_video_mem_slfaddr) ) { return 11; }
-    if ( andconstmod_init(mask_video_charline)    ) { return 11; }
-    if ( andconstmod_init(mask_video_data)        ) { return 11; }
-    if ( assignmod_init(assign_colback)           ) { return 11; }
-    if ( assignmod_init(assign_colctrl)           ) { return 11; }
-    if ( assignmod_init(assign_romread)           ) { return 11; }
-    if ( assignmod_init(assign_video_data)        ) { return 11; }
-    if ( assignmod_init(assign_video_charline)    ) { return 11; }
-    if ( assignconstmod_init(assign_lpenmask0)    ) { return 11; }
-    if ( assignconstmod_init(assign_lpenmask1)    ) { return 11; }
-    if ( busmod_init(bus_cnt_lpen)                ) { return 11; }
-    if ( busmod_init(bus_cnt_update)              ) { return 11; }
-    if ( busmod_init(bus_col_back)                ) { return 11; }
-    if ( busmod_init(bus_col_fore)                ) { return 11; }
-    if ( busmod_init(bus_col_inv)                 ) { return 11; }
-    if ( busmod_init(bus_col_isfore)              ) { return 11; }
-    if ( busmod_init(bus_colback)                 ) { return 11; }
-    if ( busmod_init(bus_colctrl)                 ) { return 11; }
-    if ( busmod_init(bus_cputabsel)               ) { return 11; }
-    if ( busmod_init(bus_geom)                    ) { return 11; }
-    if ( busmod_init(bus_geom_pos_x)              ) { return 11; }
-    if ( busmod_init(bus_geom_pos_y)              ) { return 11; }
-    if ( busmod_init(bus_lpen_callmask)           ) { return 11; }
-    if ( busmod_init(bus_new_colback)             ) { return 11; }
-    if ( busmod_init(bus_new_colctrl)             ) { return 11; }
-    if ( busmod_init(bus_new_romread)             ) { return 11; }
-    if ( busmod_init(bus_pio_iei)                 ) { return 11; }
-    if ( busmod_init(bus_pio_ieo)                 ) { return 11; }
-    if ( busmod_init(bus_pio_a_data)              ) { return 11; }
-    if ( busmod_init(bus_pio_a_rdy)               ) { return 11; }
-    if ( busmod_init(bus_pio_a_strb)              ) { return 11; }
-    if ( busmod_init(bus_pio_b_data)              ) { return 11; }
-    if ( busmod_init(bus_pio_b_rdy)               ) { return 11; }
-    if ( busmod_init(bus_pio_b_strb)              ) { return 11; }
-    if ( busmod_init(bus_romread)                 ) { return 11; }
-    if ( busmod_init(bus_sound_bit)               ) { return 11; }
-    if ( busmod_init(bus_sy6545_addr)             ) { return 11; }
-    if ( busmod_init(bus_sy6545_data)             ) { return 11; }
-    if ( busmod_init(bus_tape_in)                 ) { return 11; }
-    if ( busmod_init(bus_tape_out)                ) { return 11; }
-    if ( busmod_init(bus_video_char_line)         ) { return 11; }
-    if ( busmod_init(bus_video_data)              ) { return 11; }
-    if ( busmod_init(bus_video_mem_addr)          ) { return 11; }
-    if ( busmod_init(bus_z80_addr)                ) { return 11; }
-    if ( busmod_init(bus_z80_data)                ) { return 11; }
-    if ( busmod_init(bus_z80_reti_count)          ) { return 11; }
-    if ( busmod_init(bus_z80_rfsh)                ) { return 11; }
-    if ( busmod_init(bus_z80_tab_num_start)       ) { return 11; }
-    if ( busmod_init(bus_z80_tab_num_finish)      ) { return 11; }
-    if ( busmod_init(bus_z80_tab_rd_wait)         ) { return 11; }
-    if ( busmod_init(bus_z80_tab_wr_wait)         ) { return 11; }
-    if ( busmod_init(bus_z80_wait)                ) { return 11; }
-    if ( domod_init(do_fixup_romread)             ) { return 11; }
-    if ( domod_init(do_init_ramset)               ) { return 11; }
-    if ( domod_init(do_reset_ramset)              ) { return 11; }
-    if ( domod_init(do_romread_goes_high)         ) { return 11; }
-    if ( domod_init(do_romread_goes_low)          ) { return 11; }
-    if ( domod_init(do_startup_ramtest)           ) { return 11; }
-    if ( domod_init(do_romread_wr)                ) { return 11; }
-    if ( domod_init(do_z80_ack_INT)               ) { return 11; }
-    if ( domod_init(do_z80_ack_reset)             ) { return 11; }
-    if ( domod_init(do_vdu_ram_wr)                ) { return 11; }
-    if ( domod_init(do_col_ram_wr)                ) { return 11; }
-    if ( domod_init(do_pcg_ram_wr)                ) { return 11; }
-    if ( domod_init(do_switch_in_col_ram)         ) { return 11; }
-    if ( domod_init(do_switch_in_pcg_ram)         ) { return 11; }
-    if ( domod_init(do_colback_change)            ) { return 11; }
-    if ( domod_init(do_colctrl_change)            ) { return 11; }
-    if ( domod_init(do_col_port_wr)               ) { return 11; }
-    if ( domod_init(do_pio_b_rdy_data_out)        ) { return 11; }
-    if ( domod_init(do_tape_strober)              ) { return 11; }
-    if ( dowhilemod_init(dowhile_redo_bcolint)    ) { return 11; }
-    if ( equalsmod_init(branch_if_romread_diff)   ) { return 11; }
-    if ( equalsconstmod_init(branch_mem_startup)  ) { return 11; }
-    if ( istruemod_init(branch_romread_change)    ) { return 11; }
-    if ( istruemod_init(branch_vdu_ram_wr)        ) { return 11; }
-    if ( istruemod_init(branch_sw_col_pcg)        ) { return 11; }
-    if ( lessconstmod_init(branch_memwr)          ) { return 11; }
-    if ( istruemod_init(branch_sub_colpcg)        ) { return 11; }
-    if ( equalsmod_init(branch_diff_colback)      ) { return 11; }
-    if ( equalsmod_init(branch_diff_colctrl)      ) { return 11; }
-    if ( lut8mod_init(lut8_colour_table)          ) { return 11; }
-    if ( memmod_init(mem_colour_ram)              ) { return 11; }
-    if ( memmod_init(mem_lpen_feedback)           ) { return 11; }
-    if ( memmod_init(mem_lpen_feedrfsh)           ) { return 11; }
-    if ( memmod_init(mem_lpen_table)              ) { return 11; }
-    if ( memmod_init(mem_pcg_ram)                 ) { return 11; }
-    if ( memmod_init(mem_rom1)                    ) { return 11; }
-    if ( memmod_init(mem_rom2)                    ) { return 11; }
-    if ( memmod_init(mem_rom3)                    ) { return 11; }
-    if ( memmod_init(mem_rom4)                    ) { return 11; }
-    if ( memmod_init(mem_rom5)                    ) { return 11; }
-    if ( memmod_init(mem_user_ram_a)              ) { return 11; }
-    if ( memmod_init(mem_user_ram_b)              ) { return 11; }
-    if ( memmod_init(mem_vdu_ram)                 ) { return 11; }
-    if ( ormod_init(or_backcol_backint)           ) { return 11; }
-    if ( ormod_init(or_pio_b_tape)                ) { return 11; }
-    if ( setbusmod_init(setbus_cpu_tab)           ) { return 11; }
-    if ( table8mod_init(jtable_io_rd__base)       ) { return 11; }
-    if ( table8mod_init(jtable_io_wr__base)       ) { return 11; }
-
-    if ( interf_init(bee_interf)                  ) { return 11; }
-    if ( sy6545_init(sy6545_base)                 ) { return 11; }
-    if ( z80cpu_init(z80cpu_base)                 ) { return 11; }
-    if ( z80pio_init(z80pio_base)                 ) { return 11; }
+    if ( machine_init(machine) )
+    {
+        printf("%s\n",machine->error);
+
+        return 11;
+    }
+
+    if ( machine_report )
+    {
+        if ( ( machine_report_str = machine_getinf(machine) ) != NULL )
+        {
+            printf("%s",machine_report_str);
+
+            DEBFREE(machine_report_str);
+        }
+    }
 
     /*
-       Set module pointers.
+       Compile the do, dowhile and branch chains hanging off the modules
+       that call out into the netlist.  This has to be done before the
+       6545 is started, as it keeps copies of its outfns.
     */
 
-    #ifdef DEBUGMODE
-    fprintf(stderr,"set module pointers\n");
-    #endif
+    if ( netlist_compile )
+    {
+        #ifdef DEBUGMODE
+        fprintf(stderr,"compile netlist\n");
+        #endif
 
-    DEBDEREF((bee_interf->bus_8bit),0)                = DEBDEREF((bus_col_isfore->bus_8bit),0);
-    DEBDEREF((bee_interf->bus_8bit),1)                = DEBDEREF((bus_col_fore->bus_8bit),0);
-    DEBDEREF((bee_interf->bus_8bit),2)                = DEBDEREF((bus_col_back->bus_8bit),0);
-    DEBDEREF((bee_interf->bus_8bit),3)                = DEBDEREF((bus_col_inv->bus_8bit),0);
-    DEBDEREF((bee_interf->bus_8bit),4)                = DEBDEREF((mem_lpen_table->bus_8bit),2);
-    DEBDEREF((bee_interf->bus_8bit),5)                = DEBDEREF((mem_lpen_feedback->bus_8bit),2);
-    DEBDEREF((bee_interf->bus_8bit),6)                = DEBDEREF((mem_lpen_feedrfsh->bus_8bit),2);
-    DEBDEREF((bee_interf->bus_8bit),7)                = DEBDEREF((bus_pio_a_data->bus_8bit),0);
-    DEBDEREF((bee_interf->bus_8bit),8)                = DEBDEREF((bus_pio_a_strb->bus_8bit),0);
-    DEBDEREF((bee_interf->bus_8bit),9)                = DEBDEREF((bus_pio_a_rdy->bus_8bit),0);
-    DEBDEREF((bee_interf->bus_8bit),10)               = DEBDEREF((bus_pio_a_data->bus_8bit),0);
-    DEBDEREF((bee_interf->bus_8bit),11)               = DEBDEREF((bus_pio_a_strb->bus_8bit),0);
-    DEBDEREF((bee_interf->bus_8bit),12)               = DEBDEREF((bus_pio_a_rdy->bus_8bit),0);
-    DEBDEREF((bee_interf->bus_8bit),13)               = DEBDEREF((bus_sound_bit->bus_8bit),0);
-    DEBDEREF((bee_interf->bus_8bit),14)               = DEBDEREF((bus_tape_in->bus_8bit),0);
-    DEBDEREF((bee_interf->bus_8bit),15)               = DEBDEREF((bus_tape_out->bus_8bit),0);
-    DEBDEREF((bee_interf->bus_16bit),0)               = DEBDEREF((bus_geom->bus_16bit),0);
-    DEBDEREF((bee_interf->bus_16bit),1)               = DEBDEREF((bus_geom->bus_16bit),0);
-    DEBDEREF((bee_interf->bus_16bit),2)               = DEBDEREF((bus_geom->bus_16bit),0);
-    DEBDEREF((bee_interf->bus_16bit),3)               = DEBDEREF((bus_geom->bus_16bit),0);
-    DEBDEREF((bee_interf->bus_16bit),4)               = DEBDEREF((bus_geom->bus_16bit),0);
-    DEBDEREF((bee_interf->bus_16bit),6)               = DEBDEREF((bus_geom_pos_x->bus_16bit),0);
-    DEBDEREF((bee_interf->bus_16bit),7)               = DEBDEREF((bus_geom_pos_y->bus_16bit),0);
-    DEBDEREF((bee_interf->bus_32bit),0)               = DEBDEREF((bus_cnt_lpen->bus_32bit),0);
-    DEBDEREF((bee_interf->bus_32bit),1)               = DEBDEREF((bus_cnt_update->bus_32bit),0);
-    DEBDEREF((bee_interf->sig_calls_outof_module),0)  = DEBDEREF((sy6545_base->sig_calls_into_module),1);
-    DEBDEREF((bee_interf->sig_calls_outof_module),1)  = stop_emulator;
-    DEBDEREF((bee_interf->sig_calls_outof_module),2)  = timer_speed_emul_on;
-    DEBDEREF((bee_interf->sig_calls_outof_module),3)  = timer_speed_emul_off;
-    DEBDEREF((bee_interf->sig_calls_outof_module),4)  = set_reset_flag;
-    DEBDEREF((bee_interf->sig_calls_outof_module),5)  = clear_reset_flag;
-    DEBDEREF((bee_interf->sig_calls_outof_module),6)  = pause_emulation;
-    DEBDEREF((bee_interf->sig_calls_outof_module),7)  = restart_emulation;
-    DEBDEREF((bee_interf->sig_calls_outof_module),8)  = DEBDEREF((z80pio_base->sig_calls_into_module),9);
-    DEBDEREF((bee_interf->sig_calls_outof_module),9)  = DEBDEREF((do_tape_strober->sig_calls_into_module),0);
-    DEBDEREF((bee_interf->sig_calls_outof_args),0)    = sy6545_base;
-    DEBDEREF((bee_interf->sig_calls_outof_args),1)    = NULL;
-    DEBDEREF((bee_interf->sig_calls_outof_args),2)    = NULL;
-    DEBDEREF((bee_interf->sig_calls_outof_args),3)    = NULL;
-    DEBDEREF((bee_interf->sig_calls_outof_args),4)    = NULL;
-    DEBDEREF((bee_interf->sig_calls_outof_args),5)    = NULL;
-    DEBDEREF((bee_interf->sig_calls_outof_args),6)    = NULL;
-    DEBDEREF((bee_interf->sig_calls_outof_args),7)    = NULL;
-    DEBDEREF((bee_interf->sig_calls_outof_args),8)    = z80pio_base;
-    DEBDEREF((bee_interf->sig_calls_outof_args),9)    = do_tape_strober;
-
-    DEBDEREF((mask_colback->bus_8bit),0) = DEBDEREF((bus_new_colback->bus_8bit),0);
-    DEBDEREF((mask_colback->bus_8bit),1) = DEBDEREF((bus_z80_data->bus_8bit),0);
-
-    DEBDEREF((mask_colctrl->bus_8bit),0) = DEBDEREF((bus_new_colctrl->bus_8bit),0);
-    DEBDEREF((mask_colctrl->bus_8bit),1) = DEBDEREF((bus_z80_data->bus_8bit),0);
-
-    DEBDEREF((mask_pio_b->bus_8bit),0) = DEBDEREF((bus_pio_b_data->bus_8bit),0);
-    DEBDEREF((mask_pio_b->bus_8bit),1) = DEBDEREF((bus_pio_b_data->bus_8bit),0);
-
-    DEBDEREF((mask_romread->bus_8bit),0) = DEBDEREF((bus_new_romread->bus_8bit),0);
-    DEBDEREF((mask_romread->bus_8bit),1) = DEBDEREF((bus_z80_data->bus_8bit),0);
-
-    DEBDEREF((mask_soundbit->bus_8bit),0) = DEBDEREF((bus_sound_bit->bus_8bit),0);
-    DEBDEREF((mask_soundbit->bus_8bit),1) = DEBDEREF((bus_pio_b_data->bus_8bit),0);
-
-    DEBDEREF((mask_tapeout->bus_8bit),0) = DEBDEREF((bus_tape_out->bus_8bit),0);
-    DEBDEREF((mask_tapeout->bus_8bit),1) = DEBDEREF((bus_pio_b_data->bus_8bit),0);
-
-    DEBDEREF((mask_video_mem_addr->bus_16bit),0) = DEBDEREF((bus_video_mem_addr->bus_16bit),0);
-    DEBDEREF((mask_video_mem_addr->bus_16bit),1) = DEBDEREF((bus_z80_addr->bus_16bit),0);
-
-    DEBDEREF((mask_video_mem_slfaddr->bus_16bit),0) = DEBDEREF((bus_video_mem_addr->bus_16bit),0);
-    DEBDEREF((mask_video_mem_slfaddr->bus_16bit),1) = DEBDEREF((bus_video_mem_addr->bus_16bit),0);
-
-    DEBDEREF((mask_video_data->bus_16bit),0) = DEBDEREF((bus_video_data->bus_16bit),0);
-    DEBDEREF((mask_video_data->bus_16bit),1) = DEBDEREF((bus_video_data->bus_16bit),0);
-
-    DEBDEREF((mask_video_charline->bus_8bit),0) = DEBDEREF((bus_video_char_line->bus_8bit),0);
-    DEBDEREF((mask_video_charline->bus_8bit),1) = DEBDEREF((bus_video_char_line->bus_8bit),0);
-
-    DEBDEREF((assign_colback->bus_8bit),0) = DEBDEREF((bus_colback->bus_8bit),0);
-    DEBDEREF((assign_colback->bus_8bit),1) = DEBDEREF((bus_new_colback->bus_8bit),0);
-
-    DEBDEREF((assign_colctrl->bus_8bit),0) = DEBDEREF((bus_colctrl->bus_8bit),0);
-    DEBDEREF((assign_colctrl->bus_8bit),1) = DEBDEREF((bus_new_colctrl->bus_8bit),0);
-
-    DEBDEREF((assign_romread->bus_8bit),0) = DEBDEREF((bus_romread->bus_8bit),0);
-    DEBDEREF((assign_romread->bus_8bit),1) = DEBDEREF((bus_new_romread->bus_8bit),0);
-
-    DEBDEREF((assign_video_data->bus_16bit),0) = DEBDEREF((bus_video_data->bus_16bit),0);
-    DEBDEREF((assign_video_data->bus_8bit),1)  = DEBDEREF((bus_z80_data->bus_8bit),0);
-
-    DEBDEREF((assign_video_charline->bus_8bit),0)  = DEBDEREF((bus_video_char_line->bus_8bit),0);
-    DEBDEREF((assign_video_charline->bus_16bit),1) = DEBDEREF((bus_video_mem_addr->bus_16bit),0);
-
-    DEBDEREF((assign_lpenmask0->bus_32bit),0) = DEBDEREF((bus_lpen_callmask->bus_32bit),0);
-
-    DEBDEREF((assign_lpenmask1->bus_32bit),0) = DEBDEREF((bus_lpen_callmask->bus_32bit),0);
-
-    DEBDEREF((branch_if_romread_diff->bus_8bit),0)               = DEBDEREF((bus_romread->bus_8bit),0);
-    DEBDEREF((branch_if_romread_diff->bus_8bit),1)               = DEBDEREF((bus_new_romread->bus_8bit),0);
-    DEBDEREF((branch_if_romread_diff->sig_calls_outof_module),1) = DEBDEREF((do_fixup_romread->sig_calls_into_module),0);
-    DEBDEREF((branch_if_romread_diff->sig_calls_outof_args),1)   = (void *) do_fixup_romread;
-
-    DEBDEREF((branch_mem_startup->bus_16bit),0)              = DEBDEREF((bus_z80_addr->bus_16bit),0);
-    DEBDEREF((branch_mem_startup->sig_calls_outof_module),2) = DEBDEREF((do_init_ramset->sig_calls_into_module),0);
-    DEBDEREF((branch_mem_startup->sig_calls_outof_args),2)   = (void *) do_init_ramset;
-
-    DEBDEREF((branch_romread_change->bus_8bit),0)               = DEBDEREF((bus_romread->bus_8bit),0);
-    DEBDEREF((branch_romread_change->sig_calls_outof_module),0) = DEBDEREF((do_romread_goes_high->sig_calls_into_module),0);
-    DEBDEREF((branch_romread_change->sig_calls_outof_module),1) = DEBDEREF((do_romread_goes_low->sig_calls_into_module),0);
-    DEBDEREF((branch_romread_change->sig_calls_outof_args),0)   = (void *) do_romread_goes_high;
-    DEBDEREF((branch_romread_change->sig_calls_outof_args),1)   = (void *) do_romread_goes_low;
-
-    DEBDEREF((branch_vdu_ram_wr->bus_8bit),0)               = DEBDEREF((bus_romread->bus_8bit),0);
-    DEBDEREF((branch_vdu_ram_wr->sig_calls_outof_module),1) = DEBDEREF((do_vdu_ram_wr->sig_calls_into_module),0);
-    DEBDEREF((branch_vdu_ram_wr->sig_calls_outof_args),1)   = (void *) do_vdu_ram_wr;
-
-    DEBDEREF((branch_sw_col_pcg->bus_8bit),0)               = DEBDEREF((bus_colctrl->bus_8bit),0);
-    DEBDEREF((branch_sw_col_pcg->sig_calls_outof_module),0) = DEBDEREF((do_col_ram_wr->sig_calls_into_module),0);
-    DEBDEREF((branch_sw_col_pcg->sig_calls_outof_module),1) = DEBDEREF((do_pcg_ram_wr->sig_calls_into_module),0);
-    DEBDEREF((branch_sw_col_pcg->sig_calls_outof_args),0)   = (void *) do_col_ram_wr;
-    DEBDEREF((branch_sw_col_pcg->sig_calls_outof_args),1)   = (void *) do_pcg_ram_wr;
-
-    DEBDEREF((branch_memwr->bus_16bit),0)              = DEBDEREF((bus_z80_addr->bus_16bit),0);
-    DEBDEREF((branch_memwr->sig_calls_outof_module),2) = DEBDEREF((branch_vdu_ram_wr->sig_calls_into_module),0);
-    DEBDEREF((branch_memwr->sig_calls_outof_module),3) = DEBDEREF((branch_sw_col_pcg->sig_calls_into_module),0);
-    DEBDEREF((branch_memwr->sig_calls_outof_args),2)   = (void *) branch_vdu_ram_wr;
-    DEBDEREF((branch_memwr->sig_calls_outof_args),3)   = (void *) branch_sw_col_pcg;
-
-    DEBDEREF((branch_sub_colpcg->bus_8bit),0)               = DEBDEREF((bus_colctrl->bus_8bit),0);
-    DEBDEREF((branch_sub_colpcg->sig_calls_outof_module),0) = DEBDEREF((do_switch_in_col_ram->sig_calls_into_module),0);
-    DEBDEREF((branch_sub_colpcg->sig_calls_outof_module),1) = DEBDEREF((do_switch_in_pcg_ram->sig_calls_into_module),0);
-    DEBDEREF((branch_sub_colpcg->sig_calls_outof_args),0)   = (void *) do_switch_in_col_ram;
-    DEBDEREF((branch_sub_colpcg->sig_calls_outof_args),1)   = (void *) do_switch_in_pcg_ram;
-
-    DEBDEREF((branch_diff_colback->bus_8bit),0)               = DEBDEREF((bus_colback->bus_8bit),0);
-    DEBDEREF((branch_diff_colback->bus_8bit),1)               = DEBDEREF((bus_new_colback->bus_8bit),0);
-    DEBDEREF((branch_diff_colback->sig_calls_outof_module),1) = DEBDEREF((do_colback_change->sig_calls_into_module),0);
-    DEBDEREF((branch_diff_colback->sig_calls_outof_args),1)   = (void *) do_colback_change;
-
-    DEBDEREF((branch_diff_colctrl->bus_8bit),0)               = DEBDEREF((bus_colctrl->bus_8bit),0);
-    DEBDEREF((branch_diff_colctrl->bus_8bit),1)               = DEBDEREF((bus_new_colctrl->bus_8bit),0);
-    DEBDEREF((branch_diff_colctrl->sig_calls_outof_module),1) = DEBDEREF((do_colctrl_change->sig_calls_into_module),0);
-    DEBDEREF((branch_diff_colctrl->sig_calls_outof_args),1)   = (void *) do_colctrl_change;
-
-    DEBDEREF((do_fixup_romread->sig_calls_outof_module),0) = DEBDEREF((assign_romread->sig_calls_into_module),0);
-    DEBDEREF((do_fixup_romread->sig_calls_outof_module),1) = DEBDEREF((branch_romread_change->sig_calls_into_module),0);
-    DEBDEREF((do_fixup_romread->sig_calls_outof_args),0)   = (void *) assign_romread;
-    DEBDEREF((do_fixup_romread->sig_calls_outof_args),1)   = (void *) branch_romread_change;
-
-    DEBDEREF((do_reset_ramset->sig_calls_outof_module),0) = DEBDEREF((bus_z80_tab_num_start ->sig_calls_into_module),0x000);
-    DEBDEREF((do_reset_ramset->sig_calls_outof_module),1) = DEBDEREF((bus_z80_tab_num_finish->sig_calls_into_module),0x03F);
-    DEBDEREF((do_reset_ramset->sig_calls_outof_module),2) = DEBDEREF((bus_cputabsel->sig_calls_into_module),0);
-    DEBDEREF((do_reset_ramset->sig_calls_outof_module),3) = DEBDEREF((setbus_cpu_tab->sig_calls_into_module),0);
-    DEBDEREF((do_reset_ramset->sig_calls_outof_module),4) = DEBDEREF((z80cpu_base->sig_calls_into_module),23);
-    DEBDEREF((do_reset_ramset->sig_calls_outof_module),5) = DEBDEREF((bus_z80_tab_num_start ->sig_calls_into_module),0x040);
-    DEBDEREF((do_reset_ramset->sig_calls_outof_module),6) = DEBDEREF((bus_z80_tab_num_finish->sig_calls_into_module),0x07F);
-    DEBDEREF((do_reset_ramset->sig_calls_outof_module),7) = DEBDEREF((bus_cputabsel->sig_calls_into_module),1);
-    DEBDEREF((do_reset_ramset->sig_calls_outof_module),8) = DEBDEREF((setbus_cpu_tab->sig_calls_into_module),0);
-    DEBDEREF((do_reset_ramset->sig_calls_outof_module),9) = DEBDEREF((z80cpu_base->sig_calls_into_module),23);
-    DEBDEREF((do_reset_ramset->sig_calls_outof_args),0)   = (void *) bus_z80_tab_num_start;
-    DEBDEREF((do_reset_ramset->sig_calls_outof_args),1)   = (void *) bus_z80_tab_num_finish;
-    DEBDEREF((do_reset_ramset->sig_calls_outof_args),2)   = (void *) bus_cputabsel;
-    DEBDEREF((do_reset_ramset->sig_calls_outof_args),3)   = (void *) setbus_cpu_tab;
-    DEBDEREF((do_reset_ramset->sig_calls_outof_args),4)   = (void *) z80cpu_base;
-    DEBDEREF((do_reset_ramset->sig_calls_outof_args),5)   = (void *) bus_z80_tab_num_start;
-    DEBDEREF((do_reset_ramset->sig_calls_outof_args),6)   = (void *) bus_z80_tab_num_finish;
-    DEBDEREF((do_reset_ramset->sig_calls_outof_args),7)   = (void *) bus_cputabsel;
-    DEBDEREF((do_reset_ramset->sig_calls_outof_args),8)   = (void *) setbus_cpu_tab;
-    DEBDEREF((do_reset_ramset->sig_calls_outof_args),9)   = (void *) z80cpu_base;
-
-    DEBDEREF((do_init_ramset->sig_calls_outof_module), 0) = DEBDEREF((bus_z80_tab_num_start ->sig_calls_into_module),0x000);
-    DEBDEREF((do_init_ramset->sig_calls_outof_module), 1) = DEBDEREF((bus_z80_tab_num_finish->sig_calls_into_module),0x03F);
-    DEBDEREF((do_init_ramset->sig_calls_outof_module), 2) = DEBDEREF((bus_cputabsel->sig_calls_into_module),0);
-    DEBDEREF((do_init_ramset->sig_calls_outof_module), 3) = DEBDEREF((setbus_cpu_tab->sig_calls_into_module),0);
-    DEBDEREF((do_init_ramset->sig_calls_outof_module), 4) = DEBDEREF((z80cpu_base->sig_calls_into_module),16);
-    DEBDEREF((do_init_ramset->sig_calls_outof_module), 5) = DEBDEREF((z80cpu_base->sig_calls_into_module),19);
-    DEBDEREF((do_init_ramset->sig_calls_outof_module), 6) = DEBDEREF((z80cpu_base->sig_calls_into_module),22);
-    DEBDEREF((do_init_ramset->sig_calls_outof_module), 7) = DEBDEREF((bus_z80_tab_num_start ->sig_calls_into_module),0x040);
-    DEBDEREF((do_init_ramset->sig_calls_outof_module), 8) = DEBDEREF((bus_z80_tab_num_finish->sig_calls_into_module),0x07F);
-    DEBDEREF((do_init_ramset->sig_calls_outof_module), 9) = DEBDEREF((bus_cputabsel->sig_calls_into_module),1);
-    DEBDEREF((do_init_ramset->sig_calls_outof_module),10) = DEBDEREF((setbus_cpu_tab->sig_calls_into_module),0);
-    DEBDEREF((do_init_ramset->sig_calls_outof_module),11) = DEBDEREF((z80cpu_base->sig_calls_into_module),16);
-    DEBDEREF((do_init_ramset->sig_calls_outof_module),12) = DEBDEREF((z80cpu_base->sig_calls_into_module),19);
-    DEBDEREF((do_init_ramset->sig_calls_outof_module),13) = DEBDEREF((z80cpu_base->sig_calls_into_module),22);
-    DEBDEREF((do_init_ramset->sig_calls_outof_module),14) = DEBDEREF((bus_z80_tab_num_start ->sig_calls_into_module),0x080);
-    DEBDEREF((do_init_ramset->sig_calls_outof_module),15) = DEBDEREF((bus_z80_tab_num_finish->sig_calls_into_module),0x09F);
-    DEBDEREF((do_init_ramset->sig_calls_outof_module),16) = DEBDEREF((bus_cputabsel->sig_calls_into_module),5);
-    DEBDEREF((do_init_ramset->sig_calls_outof_module),17) = DEBDEREF((setbus_cpu_tab->sig_calls_into_module),0);
-    DEBDEREF((do_init_ramset->sig_calls_outof_module),18) = DEBDEREF((z80cpu_base->sig_calls_into_module),15);
-    DEBDEREF((do_init_ramset->sig_calls_outof_module),19) = DEBDEREF((z80cpu_base->sig_calls_into_module),19);
-    DEBDEREF((do_init_ramset->sig_calls_outof_module),20) = DEBDEREF((z80cpu_base->sig_calls_into_module),22);
-    DEBDEREF((do_init_ramset->sig_calls_outof_module),21) = DEBDEREF((bus_z80_tab_num_start ->sig_calls_into_module),0x0A0);
-    DEBDEREF((do_init_ramset->sig_calls_outof_module),22) = DEBDEREF((bus_z80_tab_num_finish->sig_calls_into_module),0x0BF);
-    DEBDEREF((do_init_ramset->sig_calls_outof_module),23) = DEBDEREF((bus_cputabsel->sig_calls_into_module),6);
-    DEBDEREF((do_init_ramset->sig_calls_outof_module),24) = DEBDEREF((setbus_cpu_tab->sig_calls_into_module),0);
-    DEBDEREF((do_init_ramset->sig_calls_outof_module),25) = DEBDEREF((z80cpu_base->sig_calls_into_module),15);
-    DEBDEREF((do_init_ramset->sig_calls_outof_module),26) = DEBDEREF((z80cpu_base->sig_calls_into_module),19);
-    DEBDEREF((do_init_ramset->sig_calls_outof_module),27) = DEBDEREF((z80cpu_base->sig_calls_into_module),22);
-    DEBDEREF((do_init_ramset->sig_calls_outof_module),28) = DEBDEREF((bus_z80_tab_num_start ->sig_calls_into_module),0x0C0);
-    DEBDEREF((do_init_ramset->sig_calls_outof_module),29) = DEBDEREF((bus_z80_tab_num_finish->sig_calls_into_module),0x0DF);
-    DEBDEREF((do_init_ramset->sig_calls_outof_module),30) = DEBDEREF((bus_cputabsel->sig_calls_into_module),7);
-    DEBDEREF((do_init_ramset->sig_calls_outof_module),31) = DEBDEREF((setbus_cpu_tab->sig_calls_into_module),0);
-    DEBDEREF((do_init_ramset->sig_calls_outof_module),32) = DEBDEREF((z80cpu_base->sig_calls_into_module),15);
-    DEBDEREF((do_init_ramset->sig_calls_outof_module),33) = DEBDEREF((z80cpu_base->sig_calls_into_module),19);
-    DEBDEREF((do_init_ramset->sig_calls_outof_module),34) = DEBDEREF((z80cpu_base->sig_calls_into_module),22);
-    DEBDEREF((do_init_ramset->sig_calls_outof_module),35) = DEBDEREF((bus_z80_tab_num_start ->sig_calls_into_module),0x0E0);
-    DEBDEREF((do_init_ramset->sig_calls_outof_module),36) = DEBDEREF((bus_z80_tab_num_finish->sig_calls_into_module),0x0EF);
-    DEBDEREF((do_init_ramset->sig_calls_outof_module),37) = DEBDEREF((bus_cputabsel->sig_calls_into_module),8);
-    DEBDEREF((do_init_ramset->sig_calls_outof_module),38) = DEBDEREF((setbus_cpu_tab->sig_calls_into_module),0);
-    DEBDEREF((do_init_ramset->sig_calls_outof_module),39) = DEBDEREF((z80cpu_base->sig_calls_into_module),15);
-    DEBDEREF((do_init_ramset->sig_calls_outof_module),40) = DEBDEREF((z80cpu_base->sig_calls_into_module),19);
-    DEBDEREF((do_init_ramset->sig_calls_outof_module),41) = DEBDEREF((z80cpu_base->sig_calls_into_module),22);
-    DEBDEREF((do_init_ramset->sig_calls_outof_module),42) = DEBDEREF((bus_z80_tab_num_start ->sig_calls_into_module),0x0F0);
-    DEBDEREF((do_init_ramset->sig_calls_outof_module),43) = DEBDEREF((bus_z80_tab_num_finish->sig_calls_into_module),0x0F7);
-    DEBDEREF((do_init_ramset->sig_calls_outof_module),44) = DEBDEREF((bus_cputabsel->sig_calls_into_module),2);
-    DEBDEREF((do_init_ramset->sig_calls_outof_module),45) = DEBDEREF((setbus_cpu_tab->sig_calls_into_module),0);
-    DEBDEREF((do_init_ramset->sig_calls_outof_module),46) = DEBDEREF((z80cpu_base->sig_calls_into_module),19);
-    DEBDEREF((do_init_ramset->sig_calls_outof_module),47) = DEBDEREF((z80cpu_base->sig_calls_into_module),22);
-    DEBDEREF((do_init_ramset->sig_calls_outof_module),48) = DEBDEREF((bus_z80_tab_num_start ->sig_calls_into_module),0x0F8);
-    DEBDEREF((do_init_ramset->sig_calls_outof_module),49) = DEBDEREF((bus_z80_tab_num_finish->sig_calls_into_module),0x0FF);
-    DEBDEREF((do_init_ramset->sig_calls_outof_module),50) = DEBDEREF((bus_cputabsel->sig_calls_into_module),3);
-    DEBDEREF((do_init_ramset->sig_calls_outof_module),51) = DEBDEREF((setbus_cpu_tab->sig_calls_into_module),0);
-    DEBDEREF((do_init_ramset->sig_calls_outof_module),52) = DEBDEREF((z80cpu_base->sig_calls_into_module),19);
-    DEBDEREF((do_init_ramset->sig_calls_outof_module),53) = DEBDEREF((z80cpu_base->sig_calls_into_module),22);
-    DEBDEREF((do_init_ramset->sig_calls_outof_args), 0)   = (void *) bus_z80_tab_num_start;
-    DEBDEREF((do_init_ramset->sig_calls_outof_args), 1)   = (void *) bus_z80_tab_num_finish;
-    DEBDEREF((do_init_ramset->sig_calls_outof_args), 2)   = (void *) bus_cputabsel;
-    DEBDEREF((do_init_ramset->sig_calls_outof_args), 3)   = (void *) setbus_cpu_tab;
-    DEBDEREF((do_init_ramset->sig_calls_outof_args), 4)   = (void *) z80cpu_base;
-    DEBDEREF((do_init_ramset->sig_calls_outof_args), 5)   = (void *) z80cpu_base;
-    DEBDEREF((do_init_ramset->sig_calls_outof_args), 6)   = (void *) z80cpu_base;
-    DEBDEREF((do_init_ramset->sig_calls_outof_args), 7)   = (void *) bus_z80_tab_num_start;
-    DEBDEREF((do_init_ramset->sig_calls_outof_args), 8)   = (void *) bus_z80_tab_num_finish;
-    DEBDEREF((do_init_ramset->sig_calls_outof_args), 9)   = (void *) bus_cputabsel;
-    DEBDEREF((do_init_ramset->sig_calls_outof_args),10)   = (void *) setbus_cpu_tab;
-    DEBDEREF((do_init_ramset->sig_calls_outof_args),11)   = (void *) z80cpu_base;
-    DEBDEREF((do_init_ramset->sig_calls_outof_args),12)   = (void *) z80cpu_base;
-    DEBDEREF((do_init_ramset->sig_calls_outof_args),13)   = (void *) z80cpu_base;
-    DEBDEREF((do_init_ramset->sig_calls_outof_args),14)   = (void *) bus_z80_tab_num_start;
-    DEBDEREF((do_init_ramset->sig_calls_outof_args),15)   = (void *) bus_z80_tab_num_finish;
-    DEBDEREF((do_init_ramset->sig_calls_outof_args),16)   = (void *) bus_cputabsel;
-    DEBDEREF((do_init_ramset->sig_calls_outof_args),17)   = (void *) setbus_cpu_tab;
-    DEBDEREF((do_init_ramset->sig_calls_outof_args),18)   = (void *) z80cpu_base;
-    DEBDEREF((do_init_ramset->sig_calls_outof_args),19)   = (void *) z80cpu_base;
-    DEBDEREF((do_init_ramset->sig_calls_outof_args),20)   = (void *) z80cpu_base;
-    DEBDEREF((do_init_ramset->sig_calls_outof_args),21)   = (void *) bus_z80_tab_num_start;
-    DEBDEREF((do_init_ramset->sig_calls_outof_args),22)   = (void *) bus_z80_tab_num_finish;
-    DEBDEREF((do_init_ramset->sig_calls_outof_args),23)   = (void *) bus_cputabsel;
-    DEBDEREF((do_init_ramset->sig_calls_outof_args),24)   = (void *) setbus_cpu_tab;
-    DEBDEREF((do_init_ramset->sig_calls_outof_args),25)   = (void *) z80cpu_base;
-    DEBDEREF((do_init_ramset->sig_calls_outof_args),26)   = (void *) z80cpu_base;
-    DEBDEREF((do_init_ramset->sig_calls_outof_args),27)   = (void *) z80cpu_base;
-    DEBDEREF((do_init_ramset->sig_calls_outof_args),28)   = (void *) bus_z80_tab_num_start;
-    DEBDEREF((do_init_ramset->sig_calls_outof_args),29)   = (void *) bus_z80_tab_num_finish;
-    DEBDEREF((do_init_ramset->sig_calls_outof_args),30)   = (void *) bus_cputabsel;
-    DEBDEREF((do_init_ramset->sig_calls_outof_args),31)   = (void *) setbus_cpu_tab;
-    DEBDEREF((do_init_ramset->sig_calls_outof_args),32)   = (void *) z80cpu_base;
-    DEBDEREF((do_init_ramset->sig_calls_outof_args),33)   = (void *) z80cpu_base;
-    DEBDEREF((do_init_ramset->sig_calls_outof_args),34)   = (void *) z80cpu_base;
-    DEBDEREF((do_init_ramset->sig_calls_outof_args),35)   = (void *) bus_z80_tab_num_start ;
-    DEBDEREF((do_init_ramset->sig_calls_outof_args),36)   = (void *) bus_z80_tab_num_finish;
-    DEBDEREF((do_init_ramset->sig_calls_outof_args),37)   = (void *) bus_cputabsel;
-    DEBDEREF((do_init_ramset->sig_calls_outof_args),38)   = (void *) setbus_cpu_tab;
-    DEBDEREF((do_init_ramset->sig_calls_outof_args),39)   = (void *) z80cpu_base;
-    DEBDEREF((do_init_ramset->sig_calls_outof_args),40)   = (void *) z80cpu_base;
-    DEBDEREF((do_init_ramset->sig_calls_outof_args),41)   = (void *) z80cpu_base;
-    DEBDEREF((do_init_ramset->sig_calls_outof_args),42)   = (void *) bus_z80_tab_num_start ;
-    DEBDEREF((do_init_ramset->sig_calls_outof_args),43)   = (void *) bus_z80_tab_num_finish;
-    DEBDEREF((do_init_ramset->sig_calls_outof_args),44)   = (void *) bus_cputabsel;
-    DEBDEREF((do_init_ramset->sig_calls_outof_args),45)   = (void *) setbus_cpu_tab;
-    DEBDEREF((do_init_ramset->sig_calls_outof_args),46)   = (void *) z80cpu_base;
-    DEBDEREF((do_init_ramset->sig_calls_outof_args),47)   = (void *) z80cpu_base;
-    DEBDEREF((do_init_ramset->sig_calls_outof_args),48)   = (void *) bus_z80_tab_num_start ;
-    DEBDEREF((do_init_ramset->sig_calls_outof_args),49)   = (void *) bus_z80_tab_num_finish;
-    DEBDEREF((do_init_ramset->sig_calls_outof_args),50)   = (void *) bus_cputabsel;
-    DEBDEREF((do_init_ramset->sig_calls_outof_args),51)   = (void *) setbus_cpu_tab;
-    DEBDEREF((do_init_ramset->sig_calls_outof_args),52)   = (void *) z80cpu_base;
-    DEBDEREF((do_init_ramset->sig_calls_outof_args),53)   = (void *) z80cpu_base;
-
-    DEBDEREF((do_romread_goes_high->sig_calls_outof_module),0) = DEBDEREF((assign_lpenmask1->sig_calls_into_module),18);
-    DEBDEREF((do_romread_goes_high->sig_calls_outof_module),1) = DEBDEREF((bus_z80_tab_num_start ->sig_calls_into_module),0x0F0);
-    DEBDEREF((do_romread_goes_high->sig_calls_outof_module),2) = DEBDEREF((bus_z80_tab_num_finish->sig_calls_into_module),0x0F7);
-    DEBDEREF((do_romread_goes_high->sig_calls_outof_module),3) = DEBDEREF((bus_cputabsel->sig_calls_into_module),9);
-    DEBDEREF((do_romread_goes_high->sig_calls_outof_module),4) = DEBDEREF((setbus_cpu_tab->sig_calls_into_module),0);
-    DEBDEREF((do_romread_goes_high->sig_calls_outof_module),5) = DEBDEREF((z80cpu_base->sig_calls_into_module),19);
-    DEBDEREF((do_romread_goes_high->sig_calls_outof_module),6) = DEBDEREF((z80cpu_base->sig_calls_into_module),22);
-    DEBDEREF((do_romread_goes_high->sig_calls_outof_args),0)   = (void *) assign_lpenmask1;
-    DEBDEREF((do_romread_goes_high->sig_calls_outof_args),1)   = (void *) bus_z80_tab_num_start;
-    DEBDEREF((do_romread_goes_high->sig_calls_outof_args),2)   = (void *) bus_z80_tab_num_finish;
-    DEBDEREF((do_romread_goes_high->sig_calls_outof_args),3)   = (void *) bus_cputabsel;
-    DEBDEREF((do_romread_goes_high->sig_calls_outof_args),4)   = (void *) setbus_cpu_tab;
-    DEBDEREF((do_romread_goes_high->sig_calls_outof_args),5)   = (void *) z80cpu_base;
-    DEBDEREF((do_romread_goes_high->sig_calls_outof_args),6)   = (void *) z80cpu_base;
-
-    DEBDEREF((do_romread_goes_low->sig_calls_outof_module),0) = DEBDEREF((assign_lpenmask0->sig_calls_into_module),18);
-    DEBDEREF((do_romread_goes_low->sig_calls_outof_module),1) = DEBDEREF((bus_z80_tab_num_start ->sig_calls_into_module),0x0F0);
-    DEBDEREF((do_romread_goes_low->sig_calls_outof_module),2) = DEBDEREF((bus_z80_tab_num_finish->sig_calls_into_module),0x0F7);
-    DEBDEREF((do_romread_goes_low->sig_calls_outof_module),3) = DEBDEREF((bus_cputabsel->sig_calls_into_module),2);
-    DEBDEREF((do_romread_goes_low->sig_calls_outof_module),4) = DEBDEREF((setbus_cpu_tab->sig_calls_into_module),0);
-    DEBDEREF((do_romread_goes_low->sig_calls_outof_module),5) = DEBDEREF((z80cpu_base->sig_calls_into_module),19);
-    DEBDEREF((do_romread_goes_low->sig_calls_outof_module),6) = DEBDEREF((z80cpu_base->sig_calls_into_module),22);
-    DEBDEREF((do_romread_goes_low->sig_calls_outof_args),0)   = (void *) assign_lpenmask0;
-    DEBDEREF((do_romread_goes_low->sig_calls_outof_args),1)   = (void *) bus_z80_tab_num_start;
-    DEBDEREF((do_romread_goes_low->sig_calls_outof_args),2)   = (void *) bus_z80_tab_num_finish;
-    DEBDEREF((do_romread_goes_low->sig_calls_outof_args),3)   = (void *) bus_cputabsel;
-    DEBDEREF((do_romread_goes_low->sig_calls_outof_args),4)   = (void *) setbus_cpu_tab;
-    DEBDEREF((do_romread_goes_low->sig_calls_outof_args),5)   = (void *) z80cpu_base;
-    DEBDEREF((do_romread_goes_low->sig_calls_outof_args),6)   = (void *) z80cpu_base;
-
-    DEBDEREF((do_startup_ramtest->sig_calls_outof_module),0) = DEBDEREF((bus_z80_data->sig_calls_into_module),256);
-    DEBDEREF((do_startup_ramtest->sig_calls_outof_module),1) = DEBDEREF((branch_mem_startup->sig_calls_into_module),1);
-    DEBDEREF((do_startup_ramtest->sig_calls_outof_args),0)   = (void *) bus_z80_data;
-    DEBDEREF((do_startup_ramtest->sig_calls_outof_args),1)   = (void *) branch_mem_startup;
-
-    DEBDEREF((do_romread_wr->sig_calls_outof_module),0) = DEBDEREF((mask_romread->sig_calls_into_module),0);
-    DEBDEREF((do_romread_wr->sig_calls_outof_module),1) = DEBDEREF((branch_if_romread_diff->sig_calls_into_module),0);
-    DEBDEREF((do_romread_wr->sig_calls_outof_args),0)   = (void *) mask_romread;
-    DEBDEREF((do_romread_wr->sig_calls_outof_args),1)   = (void *) branch_if_romread_diff;
-
-    DEBDEREF((do_z80_ack_INT->sig_calls_outof_module),0) = DEBDEREF((bus_z80_data->sig_calls_into_module),256);
-    DEBDEREF((do_z80_ack_INT->sig_calls_outof_module),1) = DEBDEREF((z80pio_base->sig_calls_into_module),12);
-    DEBDEREF((do_z80_ack_INT->sig_calls_outof_module),2) = DEBDEREF((z80cpu_base->sig_calls_into_module),4);
-    DEBDEREF((do_z80_ack_INT->sig_calls_outof_args),0)   = (void *) bus_z80_data;
-    DEBDEREF((do_z80_ack_INT->sig_calls_outof_args),1)   = (void *) z80pio_base;
-    DEBDEREF((do_z80_ack_INT->sig_calls_outof_args),2)   = (void *) z80cpu_base;
-
-    DEBDEREF((do_z80_ack_reset->sig_calls_outof_module),0) = DEBDEREF((bus_romread->sig_calls_into_module),256);
-    DEBDEREF((do_z80_ack_reset->sig_calls_outof_module),1) = DEBDEREF((bus_colctrl->sig_calls_into_module),256);
-    DEBDEREF((do_z80_ack_reset->sig_calls_outof_module),2) = DEBDEREF((bus_colback->sig_calls_into_module),256);
-    DEBDEREF((do_z80_ack_reset->sig_calls_outof_module),3) = DEBDEREF((bus_lpen_callmask->sig_calls_into_module),256);
-    DEBDEREF((do_z80_ack_reset->sig_calls_outof_module),4) = DEBDEREF((sy6545_base->sig_calls_into_module),0);
-    DEBDEREF((do_z80_ack_reset->sig_calls_outof_module),5) = DEBDEREF((z80pio_base->sig_calls_into_module),0);
-    DEBDEREF((do_z80_ack_reset->sig_calls_outof_module),6) = DEBDEREF((do_reset_ramset->sig_calls_into_module),0);
-    DEBDEREF((do_z80_ack_reset->sig_calls_outof_args),0)   = (void *) bus_romread;
-    DEBDEREF((do_z80_ack_reset->sig_calls_outof_args),1)   = (void *) bus_colctrl;
-    DEBDEREF((do_z80_ack_reset->sig_calls_outof_args),2)   = (void *) bus_colback;
-    DEBDEREF((do_z80_ack_reset->sig_calls_outof_args),3)   = (void *) bus_lpen_callmask;
-    DEBDEREF((do_z80_ack_reset->sig_calls_outof_args),4)   = (void *) sy6545_base;
-    DEBDEREF((do_z80_ack_reset->sig_calls_outof_args),5)   = (void *) z80pio_base;
-    DEBDEREF((do_z80_ack_reset->sig_calls_outof_args),6)   = (void *) do_reset_ramset;
-
-    DEBDEREF((do_vdu_ram_wr->sig_calls_outof_module),0) = DEBDEREF((mask_video_mem_addr->sig_calls_into_module),1);
-    DEBDEREF((do_vdu_ram_wr->sig_calls_outof_module),1) = DEBDEREF((assign_video_data->sig_calls_into_module),26);
-    DEBDEREF((do_vdu_ram_wr->sig_calls_outof_module),2) = DEBDEREF((mem_vdu_ram->sig_calls_into_module),2);
-    DEBDEREF((do_vdu_ram_wr->sig_calls_outof_module),3) = DEBDEREF((sy6545_base->sig_calls_into_module),7);
-    DEBDEREF((do_vdu_ram_wr->sig_calls_outof_args),0)   = (void *) mask_video_mem_addr;
-    DEBDEREF((do_vdu_ram_wr->sig_calls_outof_args),1)   = (void *) assign_video_data;
-    DEBDEREF((do_vdu_ram_wr->sig_calls_outof_args),2)   = (void *) mem_vdu_ram;
-    DEBDEREF((do_vdu_ram_wr->sig_calls_outof_args),3)   = (void *) sy6545_base;
-
-    DEBDEREF((do_col_ram_wr->sig_calls_outof_module),0) = DEBDEREF((mask_video_mem_addr->sig_calls_into_module),1);
-    DEBDEREF((do_col_ram_wr->sig_calls_outof_module),1) = DEBDEREF((mem_colour_ram->sig_calls_into_module),2);
-    DEBDEREF((do_col_ram_wr->sig_calls_outof_module),2) = DEBDEREF((lut8_colour_table->sig_calls_into_module),1);
-    DEBDEREF((do_col_ram_wr->sig_calls_outof_module),3) = DEBDEREF((sy6545_base->sig_calls_into_module),8);
-    DEBDEREF((do_col_ram_wr->sig_calls_outof_module),4) = DEBDEREF((assign_video_data->sig_calls_into_module),26);
-    DEBDEREF((do_col_ram_wr->sig_calls_outof_module),5) = DEBDEREF((mask_video_data->sig_calls_into_module),1);
-    DEBDEREF((do_col_ram_wr->sig_calls_outof_module),6) = DEBDEREF((bus_video_data->sig_calls_into_module),265);
-    DEBDEREF((do_col_ram_wr->sig_calls_outof_module),7) = DEBDEREF((bus_video_data->sig_calls_into_module),265);
-    DEBDEREF((do_col_ram_wr->sig_calls_outof_module),8) = DEBDEREF((or_backcol_backint->sig_calls_into_module),3);
-    DEBDEREF((do_col_ram_wr->sig_calls_outof_module),9) = DEBDEREF((sy6545_base->sig_calls_into_module),9);
-    DEBDEREF((do_col_ram_wr->sig_calls_outof_args),0)   = (void *) mask_video_mem_addr;
-    DEBDEREF((do_col_ram_wr->sig_calls_outof_args),1)   = (void *) mem_colour_ram;
-    DEBDEREF((do_col_ram_wr->sig_calls_outof_args),2)   = (void *) lut8_colour_table;
-    DEBDEREF((do_col_ram_wr->sig_calls_outof_args),3)   = (void *) sy6545_base;
-    DEBDEREF((do_col_ram_wr->sig_calls_outof_args),4)   = (void *) assign_video_data;
-    DEBDEREF((do_col_ram_wr->sig_calls_outof_args),5)   = (void *) mask_video_data;
-    DEBDEREF((do_col_ram_wr->sig_calls_outof_args),6)   = (void *) bus_video_data;
-    DEBDEREF((do_col_ram_wr->sig_calls_outof_args),7)   = (void *) bus_video_data;
-    DEBDEREF((do_col_ram_wr->sig_calls_outof_args),8)   = (void *) or_backcol_backint;
-    DEBDEREF((do_col_ram_wr->sig_calls_outof_args),9)   = (void *) sy6545_base;
-
-    DEBDEREF((do_pcg_ram_wr->sig_calls_outof_module),0)  = DEBDEREF((mask_video_mem_addr->sig_calls_into_module),1);
-    DEBDEREF((do_pcg_ram_wr->sig_calls_outof_module),1)  = DEBDEREF((assign_video_data->sig_calls_into_module),26);
-    DEBDEREF((do_pcg_ram_wr->sig_calls_outof_module),2)  = DEBDEREF((mem_pcg_ram->sig_calls_into_module),2);
-    DEBDEREF((do_pcg_ram_wr->sig_calls_outof_module),3)  = DEBDEREF((assign_video_charline->sig_calls_into_module),1);
-    DEBDEREF((do_pcg_ram_wr->sig_calls_outof_module),4)  = DEBDEREF((mask_video_charline->sig_calls_into_module),0);
-    DEBDEREF((do_pcg_ram_wr->sig_calls_outof_module),5)  = DEBDEREF((bus_video_mem_addr->sig_calls_into_module),265);
-    DEBDEREF((do_pcg_ram_wr->sig_calls_outof_module),6)  = DEBDEREF((bus_video_mem_addr->sig_calls_into_module),265);
-    DEBDEREF((do_pcg_ram_wr->sig_calls_outof_module),7)  = DEBDEREF((bus_video_mem_addr->sig_calls_into_module),265);
-    DEBDEREF((do_pcg_ram_wr->sig_calls_outof_module),8)  = DEBDEREF((bus_video_mem_addr->sig_calls_into_module),265);
-    DEBDEREF((do_pcg_ram_wr->sig_calls_outof_module),9)  = DEBDEREF((bus_video_mem_addr->sig_calls_into_module),290);
-    DEBDEREF((do_pcg_ram_wr->sig_calls_outof_module),10) = DEBDEREF((sy6545_base->sig_calls_into_module),6);
-    DEBDEREF((do_pcg_ram_wr->sig_calls_outof_args),0)    = (void *) mask_video_mem_addr;
-    DEBDEREF((do_pcg_ram_wr->sig_calls_outof_args),1)    = (void *) assign_video_data;
-    DEBDEREF((do_pcg_ram_wr->sig_calls_outof_args),2)    = (void *) mem_pcg_ram;
-    DEBDEREF((do_pcg_ram_wr->sig_calls_outof_args),3)    = (void *) assign_video_charline;
-    DEBDEREF((do_pcg_ram_wr->sig_calls_outof_args),4)    = (void *) mask_video_charline;
-    DEBDEREF((do_pcg_ram_wr->sig_calls_outof_args),5)    = (void *) bus_video_mem_addr;
-    DEBDEREF((do_pcg_ram_wr->sig_calls_outof_args),6)    = (void *) bus_video_mem_addr;
-    DEBDEREF((do_pcg_ram_wr->sig_calls_outof_args),7)    = (void *) bus_video_mem_addr;
-    DEBDEREF((do_pcg_ram_wr->sig_calls_outof_args),8)    = (void *) bus_video_mem_addr;
-    DEBDEREF((do_pcg_ram_wr->sig_calls_outof_args),9)    = (void *) bus_video_mem_addr;
-    DEBDEREF((do_pcg_ram_wr->sig_calls_outof_args),10)   = (void *) sy6545_base;
-
-    DEBDEREF((do_switch_in_col_ram->sig_calls_outof_module),0) = DEBDEREF((bus_z80_tab_num_start ->sig_calls_into_module),0x0F8);
-    DEBDEREF((do_switch_in_col_ram->sig_calls_outof_module),1) = DEBDEREF((bus_z80_tab_num_finish->sig_calls_into_module),0x0FF);
-    DEBDEREF((do_switch_in_col_ram->sig_calls_outof_module),2) = DEBDEREF((bus_cputabsel->sig_calls_into_module),4);
-    DEBDEREF((do_switch_in_col_ram->sig_calls_outof_module),3) = DEBDEREF((setbus_cpu_tab->sig_calls_into_module),0);
-    DEBDEREF((do_switch_in_col_ram->sig_calls_outof_module),4) = DEBDEREF((z80cpu_base->sig_calls_into_module),19);
-    DEBDEREF((do_switch_in_col_ram->sig_calls_outof_module),5) = DEBDEREF((z80cpu_base->sig_calls_into_module),22);
-    DEBDEREF((do_switch_in_col_ram->sig_calls_outof_args),0)   = (void *) bus_z80_tab_num_start;
-    DEBDEREF((do_switch_in_col_ram->sig_calls_outof_args),1)   = (void *) bus_z80_tab_num_finish;
-    DEBDEREF((do_switch_in_col_ram->sig_calls_outof_args),2)   = (void *) bus_cputabsel;
-    DEBDEREF((do_switch_in_col_ram->sig_calls_outof_args),3)   = (void *) setbus_cpu_tab;
-    DEBDEREF((do_switch_in_col_ram->sig_calls_outof_args),4)   = (void *) z80cpu_base;
-    DEBDEREF((do_switch_in_col_ram->sig_calls_outof_args),5)   = (void *) z80cpu_base;
-
-    DEBDEREF((do_switch_in_pcg_ram->sig_calls_outof_module),0) = DEBDEREF((bus_z80_tab_num_start ->sig_calls_into_module),0x0F8);
-    DEBDEREF((do_switch_in_pcg_ram->sig_calls_outof_module),1) = DEBDEREF((bus_z80_tab_num_finish->sig_calls_into_module),0x0FF);
-    DEBDEREF((do_switch_in_pcg_ram->sig_calls_outof_module),2) = DEBDEREF((bus_cputabsel->sig_calls_into_module),3);
-    DEBDEREF((do_switch_in_pcg_ram->sig_calls_outof_module),3) = DEBDEREF((setbus_cpu_tab->sig_calls_into_module),0);
-    DEBDEREF((do_switch_in_pcg_ram->sig_calls_outof_module),4) = DEBDEREF((z80cpu_base->sig_calls_into_module),19);
-    DEBDEREF((do_switch_in_pcg_ram->sig_calls_outof_module),5) = DEBDEREF((z80cpu_base->sig_calls_into_module),22);
-    DEBDEREF((do_switch_in_pcg_ram->sig_calls_outof_args),0)   = (void *) bus_z80_tab_num_start;
-    DEBDEREF((do_switch_in_pcg_ram->sig_calls_outof_args),1)   = (void *) bus_z80_tab_num_finish;
-    DEBDEREF((do_switch_in_pcg_ram->sig_calls_outof_args),2)   = (void *) bus_cputabsel;
-    DEBDEREF((do_switch_in_pcg_ram->sig_calls_outof_args),3)   = (void *) setbus_cpu_tab;
-    DEBDEREF((do_switch_in_pcg_ram->sig_calls_outof_args),4)   = (void *) z80cpu_base;
-    DEBDEREF((do_switch_in_pcg_ram->sig_calls_outof_args),5)   = (void *) z80cpu_base;
-
-    DEBDEREF((do_colback_change->sig_calls_outof_module),0) = DEBDEREF((assign_colback->sig_calls_into_module),0);
-    DEBDEREF((do_colback_change->sig_calls_outof_module),1) = DEBDEREF((bus_video_mem_addr->sig_calls_into_module),256);
-    DEBDEREF((do_colback_change->sig_calls_outof_module),2) = DEBDEREF((dowhile_redo_bcolint->sig_calls_into_module),1);
-    DEBDEREF((do_colback_change->sig_calls_outof_args),0)   = (void *) assign_colback;
-    DEBDEREF((do_colback_change->sig_calls_outof_args),1)   = (void *) bus_video_mem_addr;
-    DEBDEREF((do_colback_change->sig_calls_outof_args),2)   = (void *) dowhile_redo_bcolint;
-
-    DEBDEREF((do_colctrl_change->sig_calls_outof_module),0) = DEBDEREF((assign_colctrl->sig_calls_into_module),0);
-    DEBDEREF((do_colctrl_change->sig_calls_outof_module),1) = DEBDEREF((branch_sub_colpcg->sig_calls_into_module),0);
-    DEBDEREF((do_colctrl_change->sig_calls_outof_args),0)   = (void *) assign_colctrl;
-    DEBDEREF((do_colctrl_change->sig_calls_outof_args),1)   = (void *) branch_sub_colpcg;
-
-    DEBDEREF((do_col_port_wr->sig_calls_outof_module),0) = DEBDEREF((mask_colctrl->sig_calls_into_module),0);
-    DEBDEREF((do_col_port_wr->sig_calls_outof_module),1) = DEBDEREF((mask_colback->sig_calls_into_module),0);
-    DEBDEREF((do_col_port_wr->sig_calls_outof_module),2) = DEBDEREF((bus_new_colback->sig_calls_into_module),259);
-    DEBDEREF((do_col_port_wr->sig_calls_outof_module),3) = DEBDEREF((branch_diff_colback->sig_calls_into_module),0);
-    DEBDEREF((do_col_port_wr->sig_calls_outof_module),4) = DEBDEREF((branch_diff_colctrl->sig_calls_into_module),0);
-    DEBDEREF((do_col_port_wr->sig_calls_outof_args),0)   = (void *) mask_colctrl;
-    DEBDEREF((do_col_port_wr->sig_calls_outof_args),1)   = (void *) mask_colback;
-    DEBDEREF((do_col_port_wr->sig_calls_outof_args),2)   = (void *) bus_new_colback;
-    DEBDEREF((do_col_port_wr->sig_calls_outof_args),3)   = (void *) branch_diff_colback;
-    DEBDEREF((do_col_port_wr->sig_calls_outof_args),4)   = (void *) branch_diff_colctrl;
-
-    DEBDEREF((do_pio_b_rdy_data_out->sig_calls_outof_module),0) = DEBDEREF((mask_tapeout->sig_calls_into_module),0);
-    DEBDEREF((do_pio_b_rdy_data_out->sig_calls_outof_module),1) = DEBDEREF((bee_interf->sig_calls_into_module),9);
-    DEBDEREF((do_pio_b_rdy_data_out->sig_calls_outof_module),2) = DEBDEREF((mask_soundbit->sig_calls_into_module),0);
-    DEBDEREF((do_pio_b_rdy_data_out->sig_calls_outof_module),3) = DEBDEREF((bee_interf->sig_calls_into_module),8);
-    DEBDEREF((do_pio_b_rdy_data_out->sig_calls_outof_args),0)   = (void *) mask_tapeout;
-    DEBDEREF((do_pio_b_rdy_data_out->sig_calls_outof_args),1)   = (void *) bee_interf;
-    DEBDEREF((do_pio_b_rdy_data_out->sig_calls_outof_args),2)   = (void *) mask_soundbit;
-    DEBDEREF((do_pio_b_rdy_data_out->sig_calls_outof_args),3)   = (void *) bee_interf;
-
-    DEBDEREF((do_tape_strober->sig_calls_outof_module),0) = DEBDEREF((mask_pio_b->sig_calls_into_module),0);
-    DEBDEREF((do_tape_strober->sig_calls_outof_module),1) = DEBDEREF((or_pio_b_tape->sig_calls_into_module),0);
-    DEBDEREF((do_tape_strober->sig_calls_outof_module),2) = DEBDEREF((z80pio_base->sig_calls_into_module),10);
-    DEBDEREF((do_tape_strober->sig_calls_outof_args),0)   = (void *) mask_pio_b;
-    DEBDEREF((do_tape_strober->sig_calls_outof_args),1)   = (void *) or_pio_b_tape;
-    DEBDEREF((do_tape_strober->sig_calls_outof_args),2)   = (void *) z80pio_base;
-
-    DEBDEREF((dowhile_redo_bcolint->bus_16bit),0)              = DEBDEREF((bus_video_mem_addr->bus_16bit),0);
-    DEBDEREF((dowhile_redo_bcolint->sig_calls_outof_module),0) = DEBDEREF((mem_colour_ram->sig_calls_into_module),5);
-    DEBDEREF((dowhile_redo_bcolint->sig_calls_outof_module),1) = DEBDEREF((assign_video_data->sig_calls_into_module),26);
-    DEBDEREF((dowhile_redo_bcolint->sig_calls_outof_module),2) = DEBDEREF((mask_video_data->sig_calls_into_module),1);
-    DEBDEREF((dowhile_redo_bcolint->sig_calls_outof_module),3) = DEBDEREF((bus_video_data->sig_calls_into_module),265);
-    DEBDEREF((dowhile_redo_bcolint->sig_calls_outof_module),4) = DEBDEREF((bus_video_data->sig_calls_into_module),265);
-    DEBDEREF((dowhile_redo_bcolint->sig_calls_outof_module),5) = DEBDEREF((or_backcol_backint->sig_calls_into_module),3);
-    DEBDEREF((dowhile_redo_bcolint->sig_calls_outof_module),6) = DEBDEREF((sy6545_base->sig_calls_into_module),9);
-    DEBDEREF((dowhile_redo_bcolint->sig_calls_outof_module),7) = DEBDEREF((bus_video_mem_addr->sig_calls_into_module),263);
-    DEBDEREF((dowhile_redo_bcolint->sig_calls_outof_module),8) = DEBDEREF((mask_video_mem_slfaddr->sig_calls_into_module),1);
-    DEBDEREF((dowhile_redo_bcolint->sig_calls_outof_args),0)   = (void *) mem_colour_ram;
-    DEBDEREF((dowhile_redo_bcolint->sig_calls_outof_args),1)   = (void *) assign_video_data;
-    DEBDEREF((dowhile_redo_bcolint->sig_calls_outof_args),2)   = (void *) mask_video_data;
-    DEBDEREF((dowhile_redo_bcolint->sig_calls_outof_args),3)   = (void *) bus_video_data;
-    DEBDEREF((dowhile_redo_bcolint->sig_calls_outof_args),4)   = (void *) bus_video_data;
-    DEBDEREF((dowhile_redo_bcolint->sig_calls_outof_args),5)   = (void *) or_backcol_backint;
-    DEBDEREF((dowhile_redo_bcolint->sig_calls_outof_args),6)   = (void *) sy6545_base;
-    DEBDEREF((dowhile_redo_bcolint->sig_calls_outof_args),7)   = (void *) bus_video_mem_addr;
-    DEBDEREF((dowhile_redo_bcolint->sig_calls_outof_args),8)   = (void *) mask_video_mem_slfaddr;
-
-    DEBDEREF((lut8_colour_table->bus_16bit),0) = DEBDEREF((bus_video_data->bus_16bit),0);
-    DEBDEREF((lut8_colour_table->bus_8bit),1)  = DEBDEREF((bus_z80_data->bus_8bit),0);
-
-    DEBDEREF((mem_colour_ram->bus_8bit),0)  = DEBDEREF((bus_z80_data->bus_8bit),0);
-    DEBDEREF((mem_colour_ram->bus_16bit),0) = DEBDEREF((bus_video_mem_addr->bus_16bit),0);
-
-    DEBDEREF((mem_lpen_feedback->bus_8bit),0)  = DEBDEREF((bus_sy6545_data->bus_8bit),0);
-    DEBDEREF((mem_lpen_feedback->bus_16bit),0) = DEBDEREF((bus_sy6545_addr->bus_16bit),0);
-
-    DEBDEREF((mem_lpen_feedrfsh->bus_8bit),0)  = DEBDEREF((bus_sy6545_data->bus_8bit),0);
-    DEBDEREF((mem_lpen_feedrfsh->bus_16bit),0) = DEBDEREF((bus_sy6545_addr->bus_16bit),0);
-
-    DEBDEREF((mem_lpen_table->bus_8bit),0)  = DEBDEREF((bus_sy6545_data->bus_8bit),0);
-    DEBDEREF((mem_lpen_table->bus_16bit),0) = DEBDEREF((bus_sy6545_addr->bus_16bit),0);
-
-    DEBDEREF((mem_pcg_ram->bus_8bit),0)  = DEBDEREF((bus_z80_data->bus_8bit),0);
-    DEBDEREF((mem_pcg_ram->bus_16bit),0) = DEBDEREF((bus_video_mem_addr->bus_16bit),0);
-
-    DEBDEREF((mem_vdu_ram->bus_8bit),0)  = DEBDEREF((bus_z80_data->bus_8bit),0);
-    DEBDEREF((mem_vdu_ram->bus_16bit),0) = DEBDEREF((bus_video_mem_addr->bus_16bit),0);
-
-    DEBDEREF((or_backcol_backint->bus_8bit),2)  = DEBDEREF((bus_colback->bus_8bit),0);
-    DEBDEREF((or_backcol_backint->bus_16bit),0) = DEBDEREF((bus_video_data->bus_16bit),0);
-    DEBDEREF((or_backcol_backint->bus_16bit),1) = DEBDEREF((bus_video_data->bus_16bit),0);
-
-    DEBDEREF((or_pio_b_tape->bus_8bit),0) = DEBDEREF((bus_pio_b_data->bus_8bit),0);
-    DEBDEREF((or_pio_b_tape->bus_8bit),1) = DEBDEREF((bus_pio_b_data->bus_8bit),0);
-    DEBDEREF((or_pio_b_tape->bus_8bit),2) = DEBDEREF((bus_tape_in->bus_8bit),0);
-
-    DEBDEREF((setbus_cpu_tab->modptrs),0)   = z80cpu_base;
-    DEBDEREF((setbus_cpu_tab->bus_8bit),0)  = DEBDEREF((bus_cputabsel->bus_8bit),0);
-    DEBDEREF((setbus_cpu_tab->bus_8bit),3)  = DEBDEREF((mem_user_ram_a->bus_8bit),2);
-    DEBDEREF((setbus_cpu_tab->bus_8bit),4)  = DEBDEREF((mem_user_ram_b->bus_8bit),2);
-    DEBDEREF((setbus_cpu_tab->bus_8bit),5)  = DEBDEREF((mem_vdu_ram->bus_8bit),2);
-    DEBDEREF((setbus_cpu_tab->bus_8bit),6)  = DEBDEREF((mem_pcg_ram->bus_8bit),2);
-    DEBDEREF((setbus_cpu_tab->bus_8bit),7)  = DEBDEREF((mem_colour_ram->bus_8bit),2);
-    DEBDEREF((setbus_cpu_tab->bus_8bit),8)  = DEBDEREF((mem_rom1->bus_8bit),2);
-    DEBDEREF((setbus_cpu_tab->bus_8bit),9)  = DEBDEREF((mem_rom2->bus_8bit),2);
-    DEBDEREF((setbus_cpu_tab->bus_8bit),10) = DEBDEREF((mem_rom3->bus_8bit),2);
-    DEBDEREF((setbus_cpu_tab->bus_8bit),11) = DEBDEREF((mem_rom4->bus_8bit),2);
-    DEBDEREF((setbus_cpu_tab->bus_8bit),12) = DEBDEREF((mem_rom5->bus_8bit),2);
-
-    DEBDEREF((jtable_io_rd__base->bus_16bit),0)                 = DEBDEREF((bus_z80_addr->bus_16bit),0);
-    DEBDEREF((jtable_io_rd__base->sig_calls_outof_module),0x00) = DEBDEREF((z80pio_base->sig_calls_into_module),5);
-    DEBDEREF((jtable_io_rd__base->sig_calls_outof_module),0x01) = DEBDEREF((z80pio_base->sig_calls_into_module),6);
-    DEBDEREF((jtable_io_rd__base->sig_calls_outof_module),0x02) = DEBDEREF((z80pio_base->sig_calls_into_module),7);
-    DEBDEREF((jtable_io_rd__base->sig_calls_outof_module),0x03) = DEBDEREF((z80pio_base->sig_calls_into_module),8);
-    DEBDEREF((jtable_io_rd__base->sig_calls_outof_module),0x0c) = DEBDEREF((sy6545_base->sig_calls_into_module),4);
-    DEBDEREF((jtable_io_rd__base->sig_calls_outof_module),0x0d) = DEBDEREF((sy6545_base->sig_calls_into_module),5);
-    DEBDEREF((jtable_io_rd__base->sig_calls_outof_module),0x0e) = DEBDEREF((sy6545_base->sig_calls_into_module),4);
-    DEBDEREF((jtable_io_rd__base->sig_calls_outof_module),0x0f) = DEBDEREF((sy6545_base->sig_calls_into_module),5);
-    DEBDEREF((jtable_io_rd__base->sig_calls_outof_module),0x10) = DEBDEREF((z80pio_base->sig_calls_into_module),5);
-    DEBDEREF((jtable_io_rd__base->sig_calls_outof_module),0x11) = DEBDEREF((z80pio_base->sig_calls_into_module),6);
-    DEBDEREF((jtable_io_rd__base->sig_calls_outof_module),0x12) = DEBDEREF((z80pio_base->sig_calls_into_module),7);
-    DEBDEREF((jtable_io_rd__base->sig_calls_outof_module),0x13) = DEBDEREF((z80pio_base->sig_calls_into_module),8);
-    DEBDEREF((jtable_io_rd__base->sig_calls_outof_module),0x1c) = DEBDEREF((sy6545_base->sig_calls_into_module),4);
-    DEBDEREF((jtable_io_rd__base->sig_calls_outof_module),0x1d) = DEBDEREF((sy6545_base->sig_calls_into_module),5);
-    DEBDEREF((jtable_io_rd__base->sig_calls_outof_module),0x1e) = DEBDEREF((sy6545_base->sig_calls_into_module),4);
-    DEBDEREF((jtable_io_rd__base->sig_calls_outof_module),0x1f) = DEBDEREF((sy6545_base->sig_calls_into_module),5);
-    DEBDEREF((jtable_io_rd__base->sig_calls_outof_args),0x00)   = (void *) z80pio_base;
-    DEBDEREF((jtable_io_rd__base->sig_calls_outof_args),0x01)   = (void *) z80pio_base;
-    DEBDEREF((jtable_io_rd__base->sig_calls_outof_args),0x02)   = (void *) z80pio_base;
-    DEBDEREF((jtable_io_rd__base->sig_calls_outof_args),0x03)   = (void *) z80pio_base;
-    DEBDEREF((jtable_io_rd__base->sig_calls_outof_args),0x0c)   = (void *) sy6545_base;
-    DEBDEREF((jtable_io_rd__base->sig_calls_outof_args),0x0d)   = (void *) sy6545_base;
-    DEBDEREF((jtable_io_rd__base->sig_calls_outof_args),0x0e)   = (void *) sy6545_base;
-    DEBDEREF((jtable_io_rd__base->sig_calls_outof_args),0x0f)   = (void *) sy6545_base;
-    DEBDEREF((jtable_io_rd__base->sig_calls_outof_args),0x10)   = (void *) z80pio_base;
-    DEBDEREF((jtable_io_rd__base->sig_calls_outof_args),0x11)   = (void *) z80pio_base;
-    DEBDEREF((jtable_io_rd__base->sig_calls_outof_args),0x12)   = (void *) z80pio_base;
-    DEBDEREF((jtable_io_rd__base->sig_calls_outof_args),0x13)   = (void *) z80pio_base;
-    DEBDEREF((jtable_io_rd__base->sig_calls_outof_args),0x1c)   = (void *) sy6545_base;
-    DEBDEREF((jtable_io_rd__base->sig_calls_outof_args),0x1d)   = (void *) sy6545_base;
-    DEBDEREF((jtable_io_rd__base->sig_calls_outof_args),0x1e)   = (void *) sy6545_base;
-    DEBDEREF((jtable_io_rd__base->sig_calls_outof_args),0x1f)   = (void *) sy6545_base;
-
-    DEBDEREF((jtable_io_wr__base->bus_16bit),0)                 = DEBDEREF((bus_z80_addr->bus_16bit),0);
-    DEBDEREF((jtable_io_wr__base->sig_calls_outof_module),0x00) = DEBDEREF((z80pio_base->sig_calls_into_module),1);
-    DEBDEREF((jtable_io_wr__base->sig_calls_outof_module),0x01) = DEBDEREF((z80pio_base->sig_calls_into_module),2);
-    DEBDEREF((jtable_io_wr__base->sig_calls_outof_module),0x02) = DEBDEREF((z80pio_base->sig_calls_into_module),3);
-    DEBDEREF((jtable_io_wr__base->sig_calls_outof_module),0x03) = DEBDEREF((z80pio_base->sig_calls_into_module),4);
-    DEBDEREF((jtable_io_wr__base->sig_calls_outof_module),0x08) = DEBDEREF((do_col_port_wr->sig_calls_into_module),0);
-    DEBDEREF((jtable_io_wr__base->sig_calls_outof_module),0x0b) = DEBDEREF((do_romread_wr->sig_calls_into_module),0);
-    DEBDEREF((jtable_io_wr__base->sig_calls_outof_module),0x0c) = DEBDEREF((sy6545_base->sig_calls_into_module),2);
-    DEBDEREF((jtable_io_wr__base->sig_calls_outof_module),0x0d) = DEBDEREF((sy6545_base->sig_calls_into_module),3);
-    DEBDEREF((jtable_io_wr__base->sig_calls_outof_module),0x0e) = DEBDEREF((sy6545_base->sig_calls_into_module),2);
-    DEBDEREF((jtable_io_wr__base->sig_calls_outof_module),0x0f) = DEBDEREF((sy6545_base->sig_calls_into_module),3);
-    DEBDEREF((jtable_io_wr__base->sig_calls_outof_module),0x10) = DEBDEREF((z80pio_base->sig_calls_into_module),1);
-    DEBDEREF((jtable_io_wr__base->sig_calls_outof_module),0x11) = DEBDEREF((z80pio_base->sig_calls_into_module),2);
-    DEBDEREF((jtable_io_wr__base->sig_calls_outof_module),0x12) = DEBDEREF((z80pio_base->sig_calls_into_module),3);
-    DEBDEREF((jtable_io_wr__base->sig_calls_outof_module),0x13) = DEBDEREF((z80pio_base->sig_calls_into_module),4);
-    DEBDEREF((jtable_io_wr__base->sig_calls_outof_module),0x18) = DEBDEREF((do_col_port_wr->sig_calls_into_module),0);
-    DEBDEREF((jtable_io_wr__base->sig_calls_outof_module),0x1b) = DEBDEREF((do_romread_wr->sig_calls_into_module),0);
-    DEBDEREF((jtable_io_wr__base->sig_calls_outof_module),0x1c) = DEBDEREF((sy6545_base->sig_calls_into_module),2);
-    DEBDEREF((jtable_io_wr__base->sig_calls_outof_module),0x1d) = DEBDEREF((sy6545_base->sig_calls_into_module),3);
-    DEBDEREF((jtable_io_wr__base->sig_calls_outof_module),0x1e) = DEBDEREF((sy6545_base->sig_calls_into_module),2);
-    DEBDEREF((jtable_io_wr__base->sig_calls_outof_module),0x1f) = DEBDEREF((sy6545_base->sig_calls_into_module),3);
-    DEBDEREF((jtable_io_wr__base->sig_calls_outof_args),0x00)   = (void *) z80pio_base;
-    DEBDEREF((jtable_io_wr__base->sig_calls_outof_args),0x01)   = (void *) z80pio_base;
-    DEBDEREF((jtable_io_wr__base->sig_calls_outof_args),0x02)   = (void *) z80pio_base;
-    DEBDEREF((jtable_io_wr__base->sig_calls_outof_args),0x03)   = (void *) z80pio_base;
-    DEBDEREF((jtable_io_wr__base->sig_calls_outof_args),0x08)   = (void *) do_col_port_wr;
-    DEBDEREF((jtable_io_wr__base->sig_calls_outof_args),0x0b)   = (void *) do_romread_wr;
-    DEBDEREF((jtable_io_wr__base->sig_calls_outof_args),0x0c)   = (void *) sy6545_base;
-    DEBDEREF((jtable_io_wr__base->sig_calls_outof_args),0x0d)   = (void *) sy6545_base;
-    DEBDEREF((jtable_io_wr__base->sig_calls_outof_args),0x0e)   = (void *) sy6545_base;
-    DEBDEREF((jtable_io_wr__base->sig_calls_outof_args),0x0f)   = (void *) sy6545_base;
-    DEBDEREF((jtable_io_wr__base->sig_calls_outof_args),0x10)   = (void *) z80pio_base;
-    DEBDEREF((jtable_io_wr__base->sig_calls_outof_args),0x11)   = (void *) z80pio_base;
-    DEBDEREF((jtable_io_wr__base->sig_calls_outof_args),0x12)   = (void *) z80pio_base;
-    DEBDEREF((jtable_io_wr__base->sig_calls_outof_args),0x13)   = (void *) z80pio_base;
-    DEBDEREF((jtable_io_wr__base->sig_calls_outof_args),0x18)   = (void *) do_col_port_wr;
-    DEBDEREF((jtable_io_wr__base->sig_calls_outof_args),0x1b)   = (void *) do_romread_wr;
-    DEBDEREF((jtable_io_wr__base->sig_calls_outof_args),0x1c)   = (void *) sy6545_base;
-    DEBDEREF((jtable_io_wr__base->sig_calls_outof_args),0x1d)   = (void *) sy6545_base;
-    DEBDEREF((jtable_io_wr__base->sig_calls_outof_args),0x1e)   = (void *) sy6545_base;
-    DEBDEREF((jtable_io_wr__base->sig_calls_outof_args),0x1f)   = (void *) sy6545_base;
-
-    DEBDEREF((sy6545_base->bus_8bit),0)                = DEBDEREF((bus_z80_data->bus_8bit),0);
-    DEBDEREF((sy6545_base->bus_8bit),1)                = DEBDEREF((bus_z80_data->bus_8bit),0);
-    DEBDEREF((sy6545_base->bus_8bit),2)                = DEBDEREF((bus_z80_data->bus_8bit),0);
-    DEBDEREF((sy6545_base->bus_8bit),3)                = DEBDEREF((bus_z80_data->bus_8bit),0);
-    DEBDEREF((sy6545_base->bus_8bit),4)                = DEBDEREF((bus_video_char_line->bus_8bit),0);
-    DEBDEREF((sy6545_base->bus_8bit),5)                = DEBDEREF((bus_col_isfore->bus_8bit),0);
-    DEBDEREF((sy6545_base->bus_8bit),6)                = DEBDEREF((bus_col_fore->bus_8bit),0);
-    DEBDEREF((sy6545_base->bus_8bit),7)                = DEBDEREF((bus_col_back->bus_8bit),0);
-    DEBDEREF((sy6545_base->bus_8bit),8)                = DEBDEREF((bus_col_inv->bus_8bit),0);
-    DEBDEREF((sy6545_base->bus_8bit),9)                = DEBDEREF((bus_sy6545_data->bus_8bit),0);
-    DEBDEREF((sy6545_base->bus_8bit),10)               = DEBDEREF((bus_sy6545_data->bus_8bit),0);
-    DEBDEREF((sy6545_base->bus_16bit),0)               = DEBDEREF((bus_geom->bus_16bit),0);
-    DEBDEREF((sy6545_base->bus_16bit),1)               = DEBDEREF((bus_geom->bus_16bit),0);
-    DEBDEREF((sy6545_base->bus_16bit),2)               = DEBDEREF((bus_geom->bus_16bit),0);
-    DEBDEREF((sy6545_base->bus_16bit),3)               = DEBDEREF((bus_geom->bus_16bit),0);
-    DEBDEREF((sy6545_base->bus_16bit),4)               = DEBDEREF((bus_geom->bus_16bit),0);
-    DEBDEREF((sy6545_base->bus_16bit),5)               = DEBDEREF((bus_geom->bus_16bit),0);
-    DEBDEREF((sy6545_base->bus_16bit),6)               = DEBDEREF((bus_video_mem_addr->bus_16bit),0);
-    DEBDEREF((sy6545_base->bus_16bit),7)               = DEBDEREF((bus_video_mem_addr->bus_16bit),0);
-    DEBDEREF((sy6545_base->bus_16bit),8)               = DEBDEREF((bus_video_mem_addr->bus_16bit),0);
-    DEBDEREF((sy6545_base->bus_16bit),9)               = DEBDEREF((bus_video_mem_addr->bus_16bit),0);
-    DEBDEREF((sy6545_base->bus_16bit),10)              = DEBDEREF((bus_video_data->bus_16bit),0);
-    DEBDEREF((sy6545_base->bus_16bit),11)              = DEBDEREF((bus_video_data->bus_16bit),0);
-    DEBDEREF((sy6545_base->bus_16bit),12)              = DEBDEREF((bus_video_data->bus_16bit),0);
-    DEBDEREF((sy6545_base->bus_16bit),13)              = DEBDEREF((bus_video_data->bus_16bit),0);
-    DEBDEREF((sy6545_base->bus_16bit),14)              = DEBDEREF((bus_geom_pos_x->bus_16bit),0);
-    DEBDEREF((sy6545_base->bus_16bit),15)              = DEBDEREF((bus_geom_pos_y->bus_16bit),0);
-    DEBDEREF((sy6545_base->bus_16bit),16)              = DEBDEREF((bus_sy6545_addr->bus_16bit),0);
-    DEBDEREF((sy6545_base->bus_16bit),17)              = DEBDEREF((bus_sy6545_addr->bus_16bit),0);
-    DEBDEREF((sy6545_base->bus_16bit),18)              = DEBDEREF((bus_sy6545_addr->bus_16bit),0);
-    DEBDEREF((sy6545_base->bus_16bit),19)              = DEBDEREF((bus_sy6545_addr->bus_16bit),0);
-    DEBDEREF((sy6545_base->bus_16bit),20)              = DEBDEREF((bus_sy6545_addr->bus_16bit),0);
-    DEBDEREF((sy6545_base->bus_16bit),21)              = DEBDEREF((bus_sy6545_addr->bus_16bit),0);
-    DEBDEREF((sy6545_base->bus_32bit),0)               = DEBDEREF((bus_cnt_lpen->bus_32bit),0);
-    DEBDEREF((sy6545_base->bus_32bit),1)               = DEBDEREF((bus_cnt_update->bus_32bit),0);
-    DEBDEREF((sy6545_base->bus_32bit),2)               = DEBDEREF((bus_lpen_callmask->bus_32bit),0);
-    DEBDEREF((sy6545_base->sig_calls_outof_module),0)  = DEBDEREF((bee_interf->sig_calls_into_module),0);
-    DEBDEREF((sy6545_base->sig_calls_outof_module),1)  = DEBDEREF((bee_interf->sig_calls_into_module),1);
-    DEBDEREF((sy6545_base->sig_calls_outof_module),2)  = DEBDEREF((bee_interf->sig_calls_into_module),2);
-    DEBDEREF((sy6545_base->sig_calls_outof_module),3)  = DEBDEREF((bee_interf->sig_calls_into_module),3);
-    DEBDEREF((sy6545_base->sig_calls_outof_module),4)  = DEBDEREF((bee_interf->sig_calls_into_module),4);
-    DEBDEREF((sy6545_base->sig_calls_outof_module),5)  = DEBDEREF((bee_interf->sig_calls_into_module),5);
-    DEBDEREF((sy6545_base->sig_calls_outof_module),6)  = DEBDEREF((bee_interf->sig_calls_into_module),6);
-    DEBDEREF((sy6545_base->sig_calls_outof_module),7)  = DEBDEREF((mem_lpen_table->sig_calls_into_module),5);
-    DEBDEREF((sy6545_base->sig_calls_outof_module),8)  = DEBDEREF((mem_lpen_table->sig_calls_into_module),5);
-    DEBDEREF((sy6545_base->sig_calls_outof_module),9)  = DEBDEREF((mem_lpen_feedback->sig_calls_into_module),8);
-    DEBDEREF((sy6545_base->sig_calls_outof_module),10) = DEBDEREF((mem_lpen_feedback->sig_calls_into_module),8);
-    DEBDEREF((sy6545_base->sig_calls_outof_module),11) = DEBDEREF((mem_lpen_feedrfsh->sig_calls_into_module),8);
-    DEBDEREF((sy6545_base->sig_calls_outof_module),12) = DEBDEREF((mem_lpen_feedrfsh->sig_calls_into_module),8);
-    DEBDEREF((sy6545_base->sig_calls_outof_args),0)    = (void *) bee_interf;
-    DEBDEREF((sy6545_base->sig_calls_outof_args),1)    = (void *) bee_interf;
-    DEBDEREF((sy6545_base->sig_calls_outof_args),2)    = (void *) bee_interf;
-    DEBDEREF((sy6545_base->sig_calls_outof_args),3)    = (void *) bee_interf;
-    DEBDEREF((sy6545_base->sig_calls_outof_args),4)    = (void *) bee_interf;
-    DEBDEREF((sy6545_base->sig_calls_outof_args),5)    = (void *) bee_interf;
-    DEBDEREF((sy6545_base->sig_calls_outof_args),6)    = (void *) bee_interf;
-    DEBDEREF((sy6545_base->sig_calls_outof_args),7)    = (void *) mem_lpen_table;
-    DEBDEREF((sy6545_base->sig_calls_outof_args),8)    = (void *) mem_lpen_table;
-    DEBDEREF((sy6545_base->sig_calls_outof_args),9)    = (void *) mem_lpen_feedback;
-    DEBDEREF((sy6545_base->sig_calls_outof_args),10)   = (void *) mem_lpen_feedback;
-    DEBDEREF((sy6545_base->sig_calls_outof_args),11)   = (void *) mem_lpen_feedrfsh;
-    DEBDEREF((sy6545_base->sig_calls_outof_args),12)   = (void *) mem_lpen_feedrfsh;
-
-    DEBDEREF((z80pio_base->bus_8bit),0)               = DEBDEREF((bus_pio_ieo->bus_8bit),0);
-    DEBDEREF((z80pio_base->bus_8bit),1)               = DEBDEREF((bus_pio_iei->bus_8bit),0);
-    DEBDEREF((z80pio_base->bus_8bit),2)               = DEBDEREF((bus_z80_data->bus_8bit),0);
-    DEBDEREF((z80pio_base->bus_8bit),3)               = DEBDEREF((bus_z80_data->bus_8bit),0);
-    DEBDEREF((z80pio_base->bus_8bit),4)               = DEBDEREF((bus_z80_data->bus_8bit),0);
-    DEBDEREF((z80pio_base->bus_8bit),5)               = DEBDEREF((bus_z80_data->bus_8bit),0);
-    DEBDEREF((z80pio_base->bus_8bit),6)               = DEBDEREF((bus_z80_data->bus_8bit),0);
-    DEBDEREF((z80pio_base->bus_8bit),7)               = DEBDEREF((bus_z80_data->bus_8bit),0);
-    DEBDEREF((z80pio_base->bus_8bit),8)               = DEBDEREF((bus_z80_data->bus_8bit),0);
-    DEBDEREF((z80pio_base->bus_8bit),9)               = DEBDEREF((bus_z80_data->bus_8bit),0);
-    DEBDEREF((z80pio_base->bus_8bit),10)              = DEBDEREF((bus_z80_data->bus_8bit),0);
-    DEBDEREF((z80pio_base->bus_8bit),11)              = DEBDEREF((bus_pio_a_rdy->bus_8bit),0);
-    DEBDEREF((z80pio_base->bus_8bit),12)              = DEBDEREF((bus_pio_a_strb->bus_8bit),0);
-    DEBDEREF((z80pio_base->bus_8bit),13)              = DEBDEREF((bus_pio_a_data->bus_8bit),0);
-    DEBDEREF((z80pio_base->bus_8bit),14)              = DEBDEREF((bus_pio_b_rdy->bus_8bit),0);
-    DEBDEREF((z80pio_base->bus_8bit),15)              = DEBDEREF((bus_pio_b_strb->bus_8bit),0);
-    DEBDEREF((z80pio_base->bus_8bit),16)              = DEBDEREF((bus_pio_b_data->bus_8bit),0);
-    DEBDEREF((z80pio_base->sig_calls_outof_module),0) = DEBDEREF((bee_interf->sig_calls_into_module),7);
-    DEBDEREF((z80pio_base->sig_calls_outof_module),1) = DEBDEREF((do_pio_b_rdy_data_out->sig_calls_into_module),0);
-    DEBDEREF((z80pio_base->sig_calls_outof_module),3) = DEBDEREF((z80cpu_base->sig_calls_into_module),3);
-    DEBDEREF((z80pio_base->sig_calls_outof_args),0)   = (void *) bee_interf;
-    DEBDEREF((z80pio_base->sig_calls_outof_args),1)   = (void *) do_pio_b_rdy_data_out;
-    DEBDEREF((z80pio_base->sig_calls_outof_args),3)   = (void *) z80cpu_base;
-
-    DEBDEREF((z80cpu_base->bus_8bit),0)                = DEBDEREF((bus_z80_wait->bus_8bit),0);
-    DEBDEREF((z80cpu_base->bus_8bit),1)                = DEBDEREF((bus_z80_rfsh->bus_8bit),0);
-    DEBDEREF((z80cpu_base->bus_8bit),2)                = DEBDEREF((bus_z80_data->bus_8bit),0);
-    DEBDEREF((z80cpu_base->bus_8bit),3)                = DEBDEREF((bus_z80_tab_num_start->bus_8bit),0);
-    DEBDEREF((z80cpu_base->bus_8bit),4)                = DEBDEREF((bus_z80_tab_num_finish->bus_8bit),0);
-    DEBDEREF((z80cpu_base->bus_16bit),0)               = DEBDEREF((bus_z80_addr->bus_16bit),0);
-    DEBDEREF((z80cpu_base->bus_16bit),1)               = DEBDEREF((bus_z80_tab_wr_wait->bus_16bit),0);
-    DEBDEREF((z80cpu_base->bus_16bit),2)               = DEBDEREF((bus_z80_tab_rd_wait->bus_16bit),0);
-    DEBDEREF((z80cpu_base->bus_32bit),0)               = DEBDEREF((bus_z80_reti_count->bus_32bit),0);
-    DEBDEREF((z80cpu_base->sig_calls_outof_module),0)  = &stop_emulator;
-    DEBDEREF((z80cpu_base->sig_calls_outof_module),1)  = DEBDEREF((do_z80_ack_reset->sig_calls_into_module),0);
-    DEBDEREF((z80cpu_base->sig_calls_outof_module),5)  = DEBDEREF((do_z80_ack_INT->sig_calls_into_module),0);
-    DEBDEREF((z80cpu_base->sig_calls_outof_module),6)  = DEBDEREF((do_startup_ramtest->sig_calls_into_module),0);
-    DEBDEREF((z80cpu_base->sig_calls_outof_module),7)  = DEBDEREF((branch_memwr->sig_calls_into_module),1);
-    DEBDEREF((z80cpu_base->sig_calls_outof_module),8)  = DEBDEREF((do_startup_ramtest->sig_calls_into_module),0);
-    DEBDEREF((z80cpu_base->sig_calls_outof_module),9)  = DEBDEREF((jtable_io_wr__base->sig_calls_into_module),1);
-    DEBDEREF((z80cpu_base->sig_calls_outof_module),10) = DEBDEREF((jtable_io_rd__base->sig_calls_into_module),1);
-    DEBDEREF((z80cpu_base->sig_calls_outof_args),0)    = NULL;
-    DEBDEREF((z80cpu_base->sig_calls_outof_args),1)    = (void *) do_z80_ack_reset;
-    DEBDEREF((z80cpu_base->sig_calls_outof_args),5)    = (void *) do_z80_ack_INT;
-    DEBDEREF((z80cpu_base->sig_calls_outof_args),6)    = (void *) do_startup_ramtest;
-    DEBDEREF((z80cpu_base->sig_calls_outof_args),7)    = (void *) branch_memwr;
-    DEBDEREF((z80cpu_base->sig_calls_outof_args),8)    = (void *) do_startup_ramtest;
-    DEBDEREF((z80cpu_base->sig_calls_outof_args),9)    = (void *) jtable_io_wr__base;
-    DEBDEREF((z80cpu_base->sig_calls_outof_args),10)   = (void *) jtable_io_rd__base;
+        if ( ( netlist = genmod_net_compile(machine->mods) ) == NULL )
+        {
+            return 12;
+        }
+    }
 
     /*
        Finalise modules
@@ -1712,118 +868,47 @@ int main(int argc, char *argv[])
     fprintf(stderr,"finalise modules\n");
     #endif
 
-    andconstmod_go(mask_colback);
-    andconstmod_go(mask_colctrl);
-    andconstmod_go(mask_pio_b);
-    andconstmod_go(mask_romread);
-    andconstmod_go(mask_soundbit);
-    andconstmod_go(mask_tapeout);
-    andconstmod_go(mask_video_mem_addr);
-    andconstmod_go(mask_video_mem_slfaddr);
-    andconstmod_go(mask_video_data);
-    andconstmod_go(mask_video_charline);
-    assignmod_go(assign_colback);
-    assignmod_go(assign_colctrl);
-    assignmod_go(assign_romread);
-    assignmod_go(assign_video_data);
-    assignmod_go(assign_video_charline);
-    assignconstmod_go(assign_lpenmask0);
-    assignconstmod_go(assign_lpenmask1);
-    busmod_go(bus_cnt_lpen);
-    busmod_go(bus_cnt_update);
-    busmod_go(bus_col_back);
-    busmod_go(bus_col_fore);
-    busmod_go(bus_col_inv);
-    busmod_go(bus_col_isfore);
-    busmod_go(bus_colback);
-    busmod_go(bus_colctrl);
-    busmod_go(bus_cputabsel);
-    busmod_go(bus_geom);
-    busmod_go(bus_geom_pos_x);
-    busmod_go(bus_geom_pos_y);
-    busmod_go(bus_lpen_callmask);
-    busmod_go(bus_new_colback);
-    busmod_go(bus_new_colctrl);
-    busmod_go(bus_new_romread);
-    busmod_go(bus_pio_iei);
-    busmod_go(bus_pio_ieo);
-    busmod_go(bus_pio_a_data);
-    busmod_go(bus_pio_a_rdy);
-    busmod_go(bus_pio_a_strb);
-    busmod_go(bus_pio_b_data);
-    busmod_go(bus_pio_b_rdy);
-    busmod_go(bus_pio_b_strb);
-    busmod_go(bus_romread);
-    busmod_go(bus_sound_bit);
-    busmod_go(bus_sy6545_addr);
-    busmod_go(bus_sy6545_data);
-    busmod_go(bus_tape_in);
-    busmod_go(bus_tape_out);
-    busmod_go(bus_video_char_line);
-    busmod_go(bus_video_data);
-    busmod_go(bus_video_mem_addr);
-    busmod_go(bus_z80_addr);
-    busmod_go(bus_z80_data);
-    busmod_go(bus_z80_reti_count);
-    busmod_go(bus_z80_rfsh);
-    busmod_go(bus_z80_tab_num_start);
-    busmod_go(bus_z80_tab_num_finish);
-    busmod_go(bus_z80_tab_rd_wait);
-    busmod_go(bus_z80_tab_wr_wait);
-    busmod_go(bus_z80_wait);
-    domod_go(do_fixup_romread);
-    domod_go(do_init_ramset);
-    domod_go(do_reset_ramset);
-    domod_go(do_romread_goes_high);
-    domod_go(do_romread_goes_low);
-    domod_go(do_startup_ramtest);
-    domod_go(do_romread_wr);
-    domod_go(do_z80_ack_INT);
-    domod_go(do_z80_ack_reset);
-    domod_go(do_vdu_ram_wr);
-    domod_go(do_col_ram_wr);
-    domod_go(do_pcg_ram_wr);
-    domod_go(do_switch_in_col_ram);
-    domod_go(do_switch_in_pcg_ram);
-    domod_go(do_colback_change);
-    domod_go(do_colctrl_change);
-    domod_go(do_col_port_wr);
-    domod_go(do_pio_b_rdy_data_out);
-    domod_go(do_tape_strober);
-    dowhilemod_go(dowhile_redo_bcolint);
-    equalsmod_go(branch_if_romread_diff);
-    equalsconstmod_go(branch_mem_startup);
-    istruemod_go(branch_romread_change);
-    istruemod_go(branch_vdu_ram_wr);
-    istruemod_go(branch_sw_col_pcg);
-    lessconstmod_go(branch_memwr);
-    istruemod_go(branch_sub_colpcg);
-    equalsmod_go(branch_diff_colback);
-    equalsmod_go(branch_diff_colctrl);
-    lut8mod_go(lut8_colour_table);
-    memmod_go(mem_colour_ram);
-    memmod_go(mem_lpen_feedback);
-    memmod_go(mem_lpen_feedrfsh);
-    memmod_go(mem_lpen_table);
-    memmod_go(mem_pcg_ram);
-    memmod_go(mem_rom1);
-    memmod_go(mem_rom2);
-    memmod_go(mem_rom3);
-    memmod_go(mem_rom4);
-    memmod_go(mem_rom5);
-    memmod_go(mem_user_ram_a);
-    memmod_go(mem_user_ram_b);
-    memmod_go(mem_vdu_ram);
-    ormod_go(or_backcol_backint);
-    ormod_go(or_pio_b_tape);
-    setbusmod_go(setbus_cpu_tab);
-    table8mod_go(jtable_io_rd__base);
-    table8mod_go(jtable_io_wr__base);
-
-    interf_go(bee_interf);
-    sy6545_go(sy6545_base);
-    z80cpu_go(z80cpu_base);
-    z80pio_go(z80pio_base);
+    crtc_pinned = ( interf_input_get_mode(bee_interf) != INTERF_INPUT_OFF ) || batch_headless;
+
+    if ( turbo_cmdline )
+    {
+        interf_set_turbo(bee_interf);
+    }
+
+    if ( batch_headless )
+    {
+        interf_set_headless(bee_interf);
+    }
+
+    machine_go(machine);
+
+    z80cpu_set_trace(z80cpu_base,cpu_trace_depth);
+
+    if ( watch_kinds )
+    {
+        if ( z80cpu_watch_add(z80cpu_base,(UINT_16) watch_start,(UINT_16) watch_end,(UINT_8) watch_kinds) )
+        {
+            return 17;
+        }
+
+        if ( ( watch_fp = fopen(WATCH_LOG_FILE,"w") ) == NULL )
+        {
+            return 17;
+        }
+    }
+
+    if ( rewind_seconds )
+    {
+        if ( ( rewind_ring = snap_ring_alloc(((rewind_seconds*REWIND_FRAMES_PER_SEC)/rewind_frames)+1,REWIND_MAX_BYTES) ) == NULL )
+        {
+            return 16;
+        }
+    }
+
+    if ( batch_start() )
+    {
+        return 18;
+    }
 
     /*
        Install the timer function.
@@ -1858,6 +943,80 @@ int main(int argc, char *argv[])
     fprintf(stderr,"exited emulator\n");
     #endif
 
+    /*
+       Get the cpu report (idle time skipped) to print once the modules
+       have been removed and the screen is back to normal.
+    */
+
+    cpu_report = z80cpu_getinf(z80cpu_base);
+
+    /*
+       Write whatever a batch run asked for at exit.
+    */
+
+    if ( batch_on )
+    {
+        batch_exit       = batch_finish();
+        batch_report_str = batch_getinf();
+    }
+
+    #ifdef Z80_PROFILE
+    if ( z80cpu_profile_csv(z80cpu_base,Z80_PROFILE_OP_FILE,Z80_PROFILE_MEM_FILE) )
+    {
+        fprintf(stderr,"Unable to write z80 profile.\n");
+    }
+    #endif
+
+    #ifdef Z80_TRACE
+    if ( cpu_trace_depth && z80cpu_trace_dump(z80cpu_base,Z80CPU_TRACE_FILE) )
+    {
+        fprintf(stderr,"Unable to write z80 trace.\n");
+    }
+    #endif
+
+    if ( cpu_pc_sample )
+    {
+        pc_report = pc_sample_getinf();
+
+        if ( pc_sample_folded(PC_SAMPLE_FILE) )
+        {
+            fprintf(stderr,"Unable to write PC samples.\n");
+        }
+    }
+
+    if ( watch_fp != NULL )
+    {
+        z80cpu_watch_clear(z80cpu_base);
+
+        fclose(watch_fp);
+    }
+
+    if ( turbo_fp != NULL )
+    {
+        turbo_stop();
+
+        turbo_report_str = turbo_getinf();
+
+        fclose(turbo_fp);
+    }
+
+    if ( rewind_ring != NULL )
+    {
+        snap_ring_free(rewind_ring);
+    }
+
+    if ( snapshot != NULL )
+    {
+        snap_free(snapshot);
+    }
+
+    if ( netlist != NULL )
+    {
+        netlist_report = genmod_net_getinf(netlist);
+
+        genmod_net_free(netlist);
+    }
+
     /*
        Remove timer interupt.
     */
@@ -1870,240 +1029,52 @@ int main(int argc, char *argv[])
     remove_int(speed_throttle);
 
     /*
-       Remove emulation modules in reverse order.
+       Remove emulation modules.
     */
 
     #ifdef DEBUGMODE
     fprintf(stderr,"remove modules\n");
     #endif
 
-    andconstmod_stop(mask_colback);
-    andconstmod_stop(mask_colctrl);
-    andconstmod_stop(mask_pio_b);
-    andconstmod_stop(mask_romread);
-    andconstmod_stop(mask_soundbit);
-    andconstmod_stop(mask_tapeout);
-    andconstmod_stop(mask_video_mem_addr);
-    andconstmod_stop(mask_video_mem_slfaddr);
-    andconstmod_stop(mask_video_data);
-    andconstmod_stop(mask_video_charline);
-    assignmod_stop(assign_colback);
-    assignmod_stop(assign_colctrl);
-    assignmod_stop(assign_romread);
-    assignmod_stop(assign_video_data);
-    assignmod_stop(assign_video_charline);
-    assignconstmod_stop(assign_lpenmask0);
-    assignconstmod_stop(assign_lpenmask1);
-    busmod_stop(bus_cnt_lpen);
-    busmod_stop(bus_cnt_update);
-    busmod_stop(bus_col_back);
-    busmod_stop(bus_col_fore);
-    busmod_stop(bus_col_inv);
-    busmod_stop(bus_col_isfore);
-    busmod_stop(bus_colback);
-    busmod_stop(bus_colctrl);
-    busmod_stop(bus_cputabsel);
-    busmod_stop(bus_geom);
-    busmod_stop(bus_geom_pos_x);
-    busmod_stop(bus_geom_pos_y);
-    busmod_stop(bus_lpen_callmask);
-    busmod_stop(bus_new_colback);
-    busmod_stop(bus_new_colctrl);
-    busmod_stop(bus_new_romread);
-    busmod_stop(bus_pio_iei);
-    busmod_stop(bus_pio_ieo);
-    busmod_stop(bus_pio_a_data);
-    busmod_stop(bus_pio_a_rdy);
-    busmod_stop(bus_pio_a_strb);
-    busmod_stop(bus_pio_b_data);
-    busmod_stop(bus_pio_b_rdy);
-    busmod_stop(bus_pio_b_strb);
-    busmod_stop(bus_romread);
-    busmod_stop(bus_sound_bit);
-    busmod_stop(bus_sy6545_addr);
-    busmod_stop(bus_sy6545_data);
-    busmod_stop(bus_tape_in);
-    busmod_stop(bus_tape_out);
-    busmod_stop(bus_video_char_line);
-    busmod_stop(bus_video_data);
-    busmod_stop(bus_video_mem_addr);
-    busmod_stop(bus_z80_addr);
-    busmod_stop(bus_z80_data);
-    busmod_stop(bus_z80_reti_count);
-    busmod_stop(bus_z80_rfsh);
-    busmod_stop(bus_z80_tab_num_start);
-    busmod_stop(bus_z80_tab_num_finish);
-    busmod_stop(bus_z80_tab_rd_wait);
-    busmod_stop(bus_z80_tab_wr_wait);
-    busmod_stop(bus_z80_wait);
-    domod_stop(do_fixup_romread);
-    domod_stop(do_init_ramset);
-    domod_stop(do_reset_ramset);
-    domod_stop(do_romread_goes_high);
-    domod_stop(do_romread_goes_low);
-    domod_stop(do_startup_ramtest);
-    domod_stop(do_romread_wr);
-    domod_stop(do_z80_ack_INT);
-    domod_stop(do_z80_ack_reset);
-    domod_stop(do_vdu_ram_wr);
-    domod_stop(do_col_ram_wr);
-    domod_stop(do_pcg_ram_wr);
-    domod_stop(do_switch_in_col_ram);
-    domod_stop(do_switch_in_pcg_ram);
-    domod_stop(do_colback_change);
-    domod_stop(do_colctrl_change);
-    domod_stop(do_col_port_wr);
-    domod_stop(do_pio_b_rdy_data_out);
-    domod_stop(do_tape_strober);
-    dowhilemod_stop(dowhile_redo_bcolint);
-    equalsmod_stop(branch_if_romread_diff);
-    equalsconstmod_stop(branch_mem_startup);
-    istruemod_stop(branch_romread_change);
-    istruemod_stop(branch_vdu_ram_wr);
-    istruemod_stop(branch_sw_col_pcg);
-    lessconstmod_stop(branch_memwr);
-    istruemod_stop(branch_sub_colpcg);
-    equalsmod_stop(branch_diff_colback);
-    equalsmod_stop(branch_diff_colctrl);
-    lut8mod_stop(lut8_colour_table);
-    memmod_stop(mem_colour_ram);
-    memmod_stop(mem_lpen_feedback);
-    memmod_stop(mem_lpen_feedrfsh);
-    memmod_stop(mem_lpen_table);
-    memmod_stop(mem_pcg_ram);
-    memmod_stop(mem_rom1);
-    memmod_stop(mem_rom2);
-    memmod_stop(mem_rom3);
-    memmod_stop(mem_rom4);
-    memmod_stop(mem_rom5);
-    memmod_stop(mem_user_ram_a);
-    memmod_stop(mem_user_ram_b);
-    memmod_stop(mem_vdu_ram);
-    ormod_stop(or_backcol_backint);
-    ormod_stop(or_pio_b_tape);
-    setbusmod_stop(setbus_cpu_tab);
-    table8mod_stop(jtable_io_rd__base);
-    table8mod_stop(jtable_io_wr__base);
-
-    interf_stop(bee_interf);
-    sy6545_stop(sy6545_base);
-    z80cpu_stop(z80cpu_base);
-    z80pio_stop(z80pio_base);
-
-    andconstmod_remove(mask_colback);
-    andconstmod_remove(mask_colctrl);
-    andconstmod_remove(mask_pio_b);
-    andconstmod_remove(mask_romread);
-    andconstmod_remove(mask_soundbit);
-    andconstmod_remove(mask_tapeout);
-    andconstmod_remove(mask_video_mem_addr);
-    andconstmod_remove(mask_video_mem_slfaddr);
-    andconstmod_remove(mask_video_data);
-    andconstmod_remove(mask_video_charline);
-    assignmod_remove(assign_colback);
-    assignmod_remove(assign_colctrl);
-    assignmod_remove(assign_romread);
-    assignmod_remove(assign_video_data);
-    assignmod_remove(assign_video_charline);
-    assignconstmod_remove(assign_lpenmask0);
-    assignconstmod_remove(assign_lpenmask1);
-    busmod_remove(bus_cnt_lpen);
-    busmod_remove(bus_cnt_update);
-    busmod_remove(bus_col_back);
-    busmod_remove(bus_col_fore);
-    busmod_remove(bus_col_inv);
-    busmod_remove(bus_col_isfore);
-    busmod_remove(bus_colback);
-    busmod_remove(bus_colctrl);
-    busmod_remove(bus_cputabsel);
-    busmod_remove(bus_geom);
-    busmod_remove(bus_geom_pos_x);
-    busmod_remove(bus_geom_pos_y);
-    busmod_remove(bus_lpen_callmask);
-    busmod_remove(bus_new_colback);
-    busmod_remove(bus_new_colctrl);
-    busmod_remove(bus_new_romread);
-    busmod_remove(bus_pio_iei);
-    busmod_remove(bus_pio_ieo);
-    busmod_remove(bus_pio_a_data);
-    busmod_remove(bus_pio_a_rdy);
-    busmod_remove(bus_pio_a_strb);
-    busmod_remove(bus_pio_b_data);
-    busmod_remove(bus_pio_b_rdy);
-    busmod_remove(bus_pio_b_strb);
-    busmod_remove(bus_romread);
-    busmod_remove(bus_sound_bit);
-    busmod_remove(bus_sy6545_addr);
-    busmod_remove(bus_sy6545_data);
-    busmod_remove(bus_tape_in);
-    busmod_remove(bus_tape_out);
-    busmod_remove(bus_video_char_line);
-    busmod_remove(bus_video_data);
-    busmod_remove(bus_video_mem_addr);
-    busmod_remove(bus_z80_addr);
-    busmod_remove(bus_z80_data);
-    busmod_remove(bus_z80_reti_count);
-    busmod_remove(bus_z80_rfsh);
-    busmod_remove(bus_z80_tab_num_start);
-    busmod_remove(bus_z80_tab_num_finish);
-    busmod_remove(bus_z80_tab_rd_wait);
-    busmod_remove(bus_z80_tab_wr_wait);
-    busmod_remove(bus_z80_wait);
-    domod_remove(do_fixup_romread);
-    domod_remove(do_init_ramset);
-    domod_remove(do_reset_ramset);
-    domod_remove(do_romread_goes_high);
-    domod_remove(do_romread_goes_low);
-    domod_remove(do_startup_ramtest);
-    domod_remove(do_romread_wr);
-    domod_remove(do_z80_ack_INT);
-    domod_remove(do_z80_ack_reset);
-    domod_remove(do_vdu_ram_wr);
-    domod_remove(do_col_ram_wr);
-    domod_remove(do_pcg_ram_wr);
-    domod_remove(do_switch_in_col_ram);
-    domod_remove(do_switch_in_pcg_ram);
-    domod_remove(do_colback_change);
-    domod_remove(do_colctrl_change);
-    domod_remove(do_col_port_wr);
-    domod_remove(do_pio_b_rdy_data_out);
-    domod_remove(do_tape_strober);
-    dowhilemod_remove(dowhile_redo_bcolint);
-    equalsmod_remove(branch_if_romread_diff);
-    equalsconstmod_remove(branch_mem_startup);
-    istruemod_remove(branch_romread_change);
-    istruemod_remove(branch_vdu_ram_wr);
-    istruemod_remove(branch_sw_col_pcg);
-    lessconstmod_remove(branch_memwr);
-    istruemod_remove(branch_sub_colpcg);
-    equalsmod_remove(branch_diff_colback);
-    equalsmod_remove(branch_diff_colctrl);
-    lut8mod_remove(lut8_colour_table);
-    memmod_remove(mem_colour_ram);
-    memmod_remove(mem_lpen_feedback);
-    memmod_remove(mem_lpen_feedrfsh);
-    memmod_remove(mem_lpen_table);
-    memmod_remove(mem_pcg_ram);
-    memmod_remove(mem_rom1);
-    memmod_remove(mem_rom2);
-    memmod_remove(mem_rom3);
-    memmod_remove(mem_rom4);
-    memmod_remove(mem_rom5);
-    memmod_remove(mem_user_ram_a);
-    memmod_remove(mem_user_ram_b);
-    memmod_remove(mem_vdu_ram);
-    ormod_remove(or_backcol_backint);
-    ormod_remove(or_pio_b_tape);
-    setbusmod_remove(setbus_cpu_tab);
-    table8mod_remove(jtable_io_rd__base);
-    table8mod_remove(jtable_io_wr__base);
-
-    interf_remove(bee_interf);
-    sy6545_remove(sy6545_base);
-    z80cpu_remove(z80cpu_base);
-    z80pio_remove(z80pio_base);
+    machine_stop(machine);
+    machine_remove(machine);
 
-    return 0;
+    if ( cpu_report != NULL )
+    {
+        printf("%s",cpu_report);
+
+        DEBFREE(cpu_report);
+    }
+
+    if ( pc_report != NULL )
+    {
+        printf("%s",pc_report);
+
+        DEBFREE(pc_report);
+    }
+
+    if ( netlist_report != NULL )
+    {
+        printf("%s",netlist_report);
+
+        DEBFREE(netlist_report);
+    }
+
+    if ( turbo_report_str != NULL )
+    {
+        printf("%s",turbo_report_str);
+
+        DEBFREE(turbo_report_str);
+    }
+
+    if ( batch_report_str != NULL )
+    {
+        printf("%s",batch_report_str);
+
+        DEBFREE(batch_report_str);
+    }
+
+    return batch_exit;
 }
 END_OF_MAIN()
 
@@ -2147,111 +1118,1761 @@ cpu clock speed) speed.  Thus the keyboard operation is not impeeded.
 
 These values have been selected by trial and error.
 
+                              Scheduling
+                              ==========
+
+The machine used to be stepped 4 clock cycles at a time: run the z80 for 4
+clock cycles, then the 6545, then the interface, and round again.  Almost
+all of those steps do nothing but add 4 to a few counters, so instead each
+time around the loop works out the "event horizon" - the number of clock
+cycles until something will actually happen - and runs the z80 up to it in
+one go before catching up everything else.  The horizon is the least of:
+
+- 6545:      at REAL_CRTC_GRANULARITY and REAL_CRTC_CLOCK_DIV, clock
+             cycles until the 6545 status register could next change by
+             itself (sy6545_horizon), or one step while any key is down
+             (as the lightpen could then be strobed at any time).
+             Otherwise, clock cycles until the 6545 cycle counter next
+             exceeds crtc_granularity (so the 6545 is called at exactly
+             the same points as before).
+- interface: interf_horizon(), which covers the keyboard refresh, sound,
+             parallel port handshaking and the tape, and is one step
+             while a key file (-keys) is being typed.
+- throttle:  clock cycles until actual_clocks drops below -catchup_point
+             (or, if THROTTLE_SLEEPS, the THROTTLE_SLEEP_NS worth of clock
+             cycles if that's more) and the emulator has to wait for real
+             time to catch up.
+- batch:     clock cycles until the -max-cycles budget runs out (see
+             "Batch runs").
+- reset:     while the reset key is held it is passed on every step.
+- MAX_RUN_CLOCKS, so that things driven by the host (keypresses, the
+  timer sync point, the menu and so on) are never left waiting long.
+
+The horizon is rounded up to a multiple of Z80CPU_RUN_SLICE (4), so the
+places where the other modules are clocked are exactly where they would
+have been when stepping 4 at a time.  Because the z80 carries any overrun
+from one run to the next, it executes exactly the same instructions either
+way.  If an io write brings an event forward (for example starting a
+parallel port handshake) the interface calls z80cpu infn26, which ends the
+run at the end of the current slice, and only the clock cycles actually
+run (clk_bus less bus_z80_clk_left) are passed on to the other modules.
+The interface then times the handshake from the end of that slice.
+
+At REAL_CRTC_GRANULARITY the 6545 used to be clocked every step, which
+kept the runs to a single step.  Now, within a run, it is only clocked
+when the z80 touches it: the 6545 calls crtc_catch_up (its outfn13) before
+any port access or change to video, colour or character memory, which
+clocks it up to the start of the step the z80 is in (z80cpu_run_left),
+just as far as it would have got when stepping.  The rest of the run is
+caught up afterwards.  As nothing else can see the 6545 in between, and
+its status can't change before the horizon, the result is the same, but
+a run is now usually a whole character row (a few thousand clock cycles)
+rather than 4.  Anything the z80 does that moves the 6545 horizon (a
+write to R0-R9, an update strobe, a reset) ends the run through z80cpu
+infn26 (the 6545's outfn14).  The interface is caught up in the same way
+(interf_catch_up, its outfn21) before it looks at the speaker, tape output
+or parallel port buses, so that it times their edges as it did when
+stepping.
+
+The z80pio has no clocked events of its own, and the reti counter (below)
+is only checked after each run.
+
+To check any of this, build a second copy with MAX_RUN_CLOCKS set to 4
+(which makes every run a single step), run both headless for the same
+-max-cycles, with and without -keys, and compare the -save-state files.
+They should be byte for byte the same, cpu registers included.
+
 
 **********************************************************************/
 
 void sync_clock(void)
 {
     UINT_16 clk_bus                    = 0;
-    UINT_32 local_sy6545_cycle_counter = 0;
-    UINT_32 sy6545_clk_odds            = 0;
-    UINT_16 cycle_counter_sy6545_bus   = 0;
+    UINT_32 clk_horizon;
+    UINT_32 clk_temp;
+    SINT_64 clk_ahead;
+    SINT_64 throttle_point;
+    UINT_32 rewind_clocks              = 0;
     int local_sync_point;
+    #ifdef THROTTLE_SLEEPS
+    UINT_64 throttle_deadline          = 0;
+    UINT_64 throttle_now;
+    #endif
 
     while ( mbee_power_flag )
     {
-        clk_bus += 4;
-
-        local_sync_point = sync_point;
-        sync_point       = 0;
-
-        z80cpu_cycle(z80cpu_base,clk_bus,1,local_sync_point);
-
         /*
-           Microbee clock sync section.
+           Work out the event horizon (see above).
         */
 
-        if ( do_throttle )
+        clk_horizon = interf_horizon(bee_interf);
+        crtc_lazy   = ( crtc_granularity == REAL_CRTC_GRANULARITY ) && ( crtc_clock_division == REAL_CRTC_CLOCK_DIV );
+
+        if ( crtc_lazy )
         {
-            actual_clocks -= clk_bus;
+            clk_temp = interf_key_down(bee_interf) ? 1 : sy6545_horizon(sy6545_base);
 
-            if ( actual_clocks < -catchup_point )
+            if ( crtc_cycle_counter >= clk_temp )
             {
-                is_wait = 1;
+                clk_temp = 1;
+            }
 
-                while ( actual_clocks < 0 )
-                {
-                    if ( !do_throttle )
-                    {
-                        break;
-                    }
-                }
+            else
+            {
+                clk_temp = ( CRTC6545_RELATIVE_CLOCK_RATE * ( clk_temp - crtc_cycle_counter ) ) - crtc_clk_odds;
             }
         }
 
-        is_wait = 0;
-
-        /*
-           6545 clock
+        else
+        {
+            clk_temp = crtc_granularity;
 
-           - Add any "left over" clock cycles to the clk_bus counter.
-           - Round the clock count to half the z80 cpu frequency and save
-             any leftovers for next time.
-           - Halve the count.
-           - update the 6545 cycle counter.
-        */
+            if ( crtc_cycle_counter > clk_temp )
+            {
+                clk_temp = 1;
+            }
 
-        local_sy6545_cycle_counter += ( (clk_bus+sy6545_clk_odds) / CRTC6545_RELATIVE_CLOCK_RATE );
-        sy6545_clk_odds             = ( (clk_bus+sy6545_clk_odds) % CRTC6545_RELATIVE_CLOCK_RATE );
+            else
+            {
+                clk_temp = ( CRTC6545_RELATIVE_CLOCK_RATE * ( clk_temp - crtc_cycle_counter + 1 ) ) - crtc_clk_odds;
+            }
+        }
 
-        if ( local_sy6545_cycle_counter > crtc_granularity )
+        if ( clk_temp < clk_horizon )
         {
-            cycle_counter_sy6545_bus    = local_sy6545_cycle_counter / crtc_clock_division;
-            local_sy6545_cycle_counter -= cycle_counter_sy6545_bus * crtc_clock_division;
-
-            sy6545_cycle(sy6545_base,cycle_counter_sy6545_bus,crtc_clock_division,local_sync_point);
+            clk_horizon = clk_temp;
         }
 
-        /*
-           Interface cycling
-        */
+        throttle_point = catchup_point;
 
-        interf_cycle(bee_interf,clk_bus,1,local_sync_point);
+        #ifdef THROTTLE_SLEEPS
+        if ( throttle_point < (SINT_64) ( THROTTLE_SLEEP_NS / clock_period ) )
+        {
+            throttle_point = THROTTLE_SLEEP_NS / clock_period;
+        }
+        #endif
 
-        /*
-           Clear the clock cycle bus
-        */
+        if ( do_throttle )
+        {
+            clk_ahead = actual_clocks + throttle_point;
+
+            if ( clk_ahead < (SINT_64) clk_horizon )
+            {
+                clk_horizon = ( clk_ahead < 0 ) ? 1 : ( (UINT_32) clk_ahead ) + 1;
+            }
+        }
+
+        if ( batch_max_cycles && ( batch_max_cycles - batch_cycles < (UINT_64) clk_horizon ) )
+        {
+            clk_horizon = ( batch_max_cycles > batch_cycles ) ? (UINT_32) ( batch_max_cycles - batch_cycles ) : 1;
+        }
+
+        if ( mbee_reset_flag || ( clk_horizon > MAX_RUN_CLOCKS ) )
+        {
+            clk_horizon = mbee_reset_flag ? 1 : MAX_RUN_CLOCKS;
+        }
+
+        clk_bus = (UINT_16) ( ( ( clk_horizon + Z80CPU_RUN_SLICE - 1 ) / Z80CPU_RUN_SLICE ) * Z80CPU_RUN_SLICE );
+
+        /*
+           Run the z80 up to the horizon.  The run may be cut short, in
+           which case only clk_bus less the clock cycles left over have
+           passed.
+        */
+
+        local_sync_point = sync_point;
+        sync_point       = 0;
+
+        crtc_run_clocks = clk_bus;
+        crtc_run_done   = 0;
+        interf_run_done = 0;
+
+        z80cpu_cycle(z80cpu_base,clk_bus,1,local_sync_point);
+
+        crtc_run_clocks = 0;
+
+        /*
+           Take a PC sample if the timer has ticked (see "PC sampling").
+        */
+
+        if ( local_sync_point && cpu_pc_sample )
+        {
+            pc_sample_count[z80cpu_get_pc(z80cpu_base)>>8]++;
+        }
+
+        /*
+           Log any watched memory accesses (see "Watchpoints").
+        */
+
+        if ( ( watch_fp != NULL ) || batch_watched )
+        {
+            watch_report();
+        }
+
+        clk_bus -= (*(DEBDEREF((bus_z80_clk_left->bus_16bit),0)));
+
+        /*
+           Batch stop conditions (see "Batch runs").
+        */
+
+        if ( batch_on )
+        {
+            batch_check(clk_bus);
+        }
+
+        /*
+           Turbo mode statistics (see "Turbo mode").
+        */
+
+        if ( turbo_mode )
+        {
+            turbo_clocks += clk_bus;
+            turbo_runs++;
+
+            if ( ( local_sync_point || !( turbo_runs & TURBO_CHECK_MASK ) ) && ( turbo_elapsed_ns() >= TURBO_REPORT_NS ) )
+            {
+                turbo_report();
+            }
+        }
+
+        /*
+           Microbee clock sync section.
+        */
+
+        #ifndef THROTTLE_SLEEPS
+        if ( do_throttle )
+        {
+            actual_clocks -= clk_bus;
+
+            if ( actual_clocks < -catchup_point )
+            {
+                is_wait = 1;
+
+                while ( actual_clocks < 0 )
+                {
+                    if ( !do_throttle )
+                    {
+                        break;
+                    }
+                }
+            }
+        }
+        #endif
+
+        #ifdef THROTTLE_SLEEPS
+        if ( do_throttle )
+        {
+            throttle_now = throttle_host_ns();
+
+            if ( throttle_rebase )
+            {
+                throttle_rebase   = 0;
+                throttle_deadline = throttle_now;
+            }
+
+            throttle_deadline += ( (UINT_64) clk_bus ) * clock_period;
+
+            if ( throttle_now > throttle_deadline )
+            {
+                actual_clocks = (SINT_64) ( ( throttle_now - throttle_deadline ) / clock_period );
+
+                if ( actual_clocks > (SINT_64) max_clockovr )
+                {
+                    actual_clocks     = max_clockovr_pb;
+                    throttle_deadline = throttle_now - ( ( (UINT_64) max_clockovr_pb ) * clock_period );
+
+                    #ifndef DISABLE_CRTC_THROTTLING
+                    throttle_behind();
+                    #endif
+                }
+            }
+
+            else
+            {
+                actual_clocks = -( (SINT_64) ( ( throttle_deadline - throttle_now ) / clock_period ) );
+
+                if ( actual_clocks < -throttle_point )
+                {
+                    is_wait = 1;
+
+                    throttle_sleep_until(throttle_deadline);
+
+                    actual_clocks = 0;
+                }
+            }
+        }
+        #endif
+
+        is_wait = 0;
+
+        /*
+           6545 clock: whatever of the run the 6545 hasn't already been
+           clocked through.
+        */
+
+        crtc_clock(clk_bus-crtc_run_done,local_sync_point);
+
+        /*
+           Interface cycling
+        */
+
+        interf_cycle(bee_interf,clk_bus-interf_run_done,1,local_sync_point);
+
+        if ( mbee_reset_flag )
+        {
+            /*
+               The reset key has been pressed.  Pass this signal back to the z80
+               emulation module.  This module will subsequently call the correct
+               reset function.
+            */
+
+            (DEBDEREF((z80cpu_base->sig_calls_into_module),0))((void *) z80cpu_base);
+        }
+
+        /*
+           Finally, some pio stuff to take care of - if a reti instruction has
+           occured, we need to tell the z80 pio about it.
+        */
+
+        if ( (*(DEBDEREF((bus_z80_reti_count->bus_32bit),0))) )
+        {
+            (*(DEBDEREF((bus_z80_reti_count->bus_32bit),0))) = 0;
+
+            (DEBDEREF((z80pio_base->sig_calls_into_module),13))((void *) z80pio_base);
+        }
+
+        /*
+           Take a rewind snapshot every rewind_frames frames (see "Rewind").
+        */
+
+        if ( rewind_ring != NULL )
+        {
+            rewind_clocks += clk_bus;
+
+            if ( rewind_clocks >= rewind_frames*REWIND_FRAME_CLOCKS )
+            {
+                rewind_clocks -= rewind_frames*REWIND_FRAME_CLOCKS;
+
+                rewind_capture();
+            }
+        }
+    }
+
+    return;
+}
+
+void crtc_clock(UINT_32 clocks, int lsync_point)
+{
+    UINT_32 cycle_counter_sy6545_bus;
+
+    /*
+       - Add any "left over" clock cycles to the clock count.
+       - Round the clock count to half the z80 cpu frequency and save
+         any leftovers for next time.
+       - Halve the count.
+       - update the 6545 cycle counter.
+    */
+
+    crtc_cycle_counter += ( (clocks+crtc_clk_odds) / CRTC6545_RELATIVE_CLOCK_RATE );
+    crtc_clk_odds       = ( (clocks+crtc_clk_odds) % CRTC6545_RELATIVE_CLOCK_RATE );
+
+    if ( crtc_cycle_counter > crtc_granularity )
+    {
+        cycle_counter_sy6545_bus  = crtc_cycle_counter / crtc_clock_division;
+        crtc_cycle_counter       -= cycle_counter_sy6545_bus * crtc_clock_division;
+
+        sy6545_cycle(sy6545_base,(UINT_16) cycle_counter_sy6545_bus,crtc_clock_division,lsync_point);
+    }
+
+    return;
+}
+
+/*
+   Called by the 6545 (outfn13) before the z80 touches it: clock it up to
+   the start of the step of the run the z80 is in (see "Scheduling").
+*/
+
+void crtc_catch_up(void *what)
+{
+    UINT_32 clk_target;
+
+    if ( crtc_lazy && crtc_run_clocks )
+    {
+        clk_target = crtc_run_clocks - z80cpu_run_left(z80cpu_base);
+
+        if ( clk_target > crtc_run_done )
+        {
+            crtc_clock(clk_target-crtc_run_done,0);
+
+            crtc_run_done = clk_target;
+        }
+    }
+
+    return;
+
+    what = NULL;
+}
+
+/*
+   Called by the interface (outfn21) before it looks at the speaker, tape
+   output or parallel port buses, so that an edge is timed from the start
+   of the step the z80 is in, as it was when stepping.
+*/
+
+void interf_catch_up(void *what)
+{
+    UINT_32 clk_target;
+
+    if ( crtc_run_clocks )
+    {
+        clk_target = crtc_run_clocks - z80cpu_run_left(z80cpu_base);
+
+        if ( clk_target > interf_run_done )
+        {
+            interf_cycle(bee_interf,clk_target-interf_run_done,1,0);
+
+            interf_run_done = clk_target;
+        }
+    }
+
+    return;
+
+    what = NULL;
+}
+
+
+
+
+
+
+
+
+
+
+
+/**********************************************************************
+
+                             PC sampling
+                             ===========
+
+If cpu_pc_sample is set (in mbee32k.ini) the z80 PC is sampled once per
+tick of the speed_throttle timer.  The timer interupt can't look at the
+z80 itself, but it already sets sync_point on every tick, so sync_clock
+takes the sample at the end of the first run after the tick.  Nothing is
+added to the instruction path, so the cost is one counter per tick.  A
+run is at most MAX_RUN_CLOCKS long, which is well under a timer tick at
+normal speed, so few ticks are lost.
+
+Samples are counted by 256 byte page, and each page belongs to one of the
+regions of the Microbee memory map:
+
+   0000-7fff  user RAM (ram_user)
+   8000-9fff  BASIC ROM (bas522a.rom)
+   a000-bfff  BASIC ROM (bas522b.rom)
+   c000-dfff  editor/assembler ROM (edasm.rom, or wbee12.rom if the
+              Wordbee ROM is put in this socket)
+   e000-efff  network ROM socket (empty, so rom_empty)
+   f000-f7ff  VDU RAM (ram_vdu)
+   f800-ffff  PCG RAM (ram_pcg)
+
+ROM regions are named after the file loaded into that socket (or after
+the memory module if the socket is empty).  Colour RAM and the character
+ROM also switch in at f800, but as they can't usefully be executed they
+are counted as PCG RAM.
+
+On exit the emulator prints the regions and the PC_SAMPLE_TOP hottest
+pages, most samples first, and writes every page sampled to
+PC_SAMPLE_FILE in folded stack format (one "region;page count" line per
+page), which can be fed straight to flamegraph.pl and the like.
+
+**********************************************************************/
+
+/*
+   Region of the memory map the page is in (0 to PC_SAMPLE_REGIONS-1).
+*/
+
+int pc_sample_region(int page)
+{
+    if ( page < 0x080 ) { return 0; }
+    if ( page < 0x0a0 ) { return 1; }
+    if ( page < 0x0c0 ) { return 2; }
+    if ( page < 0x0e0 ) { return 3; }
+    if ( page < 0x0f0 ) { return 4; }
+    if ( page < 0x0f8 ) { return 5; }
+
+    return 6;
+}
+
+const char *pc_sample_region_name(int region)
+{
+    module_data *mem;
+
+    switch ( region )
+    {
+        case 0:  { return "ram_user";                  }
+        case 1:  { mem = mem_rom1; break;              }
+        case 2:  { mem = mem_rom2; break;              }
+        case 3:  { mem = mem_rom3; break;              }
+        case 4:  { mem = mem_rom4; break;              }
+        case 5:  { return DEREF_MODNAME(mem_vdu_ram);  }
+        default: { return DEREF_MODNAME(mem_pcg_ram);  }
+    }
+
+    if ( ( DEREF_STRGVAR(mem,0) != NULL ) && ( *(DEREF_STRGVAR(mem,0)) != '\0' ) )
+    {
+        return DEREF_STRGVAR(mem,0);
+    }
+
+    return DEREF_MODNAME(mem);
+}
+
+/*
+   Hot spot report.  Must be called before the memory modules are removed,
+   as the region names belong to them.
+*/
+
+char *pc_sample_getinf(void)
+{
+    char *dest;
+    char *pos;
+    UINT_64 region_count[PC_SAMPLE_REGIONS];
+    UINT_64 samples = 0;
+    UINT_64 total;
+    int order[256];
+    int i;
+    int j;
+    int k;
+
+    if ( ( dest = (char *) DEBMALLOC(((PC_SAMPLE_REGIONS+PC_SAMPLE_TOP+6)*PC_SAMPLE_LINE+1)*sizeof(char)) ) == NULL )
+    {
+        return NULL;
+    }
+
+    for ( i = 0 ; i < PC_SAMPLE_REGIONS ; i++ )
+    {
+        region_count[i] = 0;
+    }
+
+    for ( i = 0 ; i < 256 ; i++ )
+    {
+        samples += pc_sample_count[i];
+        region_count[pc_sample_region(i)] += pc_sample_count[i];
+    }
+
+    total = samples ? samples : 1;
+
+    /*
+       Sort the pages by sample count (insertion sort, ties go to the lower
+       page).
+    */
+
+    for ( i = 0 ; i < 256 ; i++ )
+    {
+        for ( j = i ; ( j > 0 ) && ( pc_sample_count[order[j-1]] < pc_sample_count[i] ) ; j-- )
+        {
+            order[j] = order[j-1];
+        }
+
+        order[j] = i;
+    }
+
+    pos  = dest;
+    pos += sprintf(pos,"PC samples: %lu\n\nregion                   samples      %%\n",
+                       (unsigned long) samples);
+
+    /*
+       Regions, most samples first.
+    */
+
+    for ( i = 0 ; i < PC_SAMPLE_REGIONS ; i++ )
+    {
+        k = 0;
+
+        for ( j = 1 ; j < PC_SAMPLE_REGIONS ; j++ )
+        {
+            if ( region_count[j] > region_count[k] )
+            {
+                k = j;
+            }
+        }
+
+        if ( ( i > 0 ) && ( region_count[k] == 0 ) )
+        {
+            break;
+        }
+
+        pos += sprintf(pos,"%-20.20s %11lu %6.2f\n",pc_sample_region_name(k),
+                           (unsigned long) region_count[k],
+                           ( 100.0 * region_count[k] ) / total);
+
+        region_count[k] = 0;
+    }
+
+    pos += sprintf(pos,"\npage  region               samples      %%\n");
+
+    for ( i = 0 ; ( i < PC_SAMPLE_TOP ) && pc_sample_count[order[i]] ; i++ )
+    {
+        pos += sprintf(pos,"%04x  %-16.16s %11lu %6.2f\n",order[i]<<8,
+                           pc_sample_region_name(pc_sample_region(order[i])),
+                           (unsigned long) pc_sample_count[order[i]],
+                           ( 100.0 * pc_sample_count[order[i]] ) / total);
+    }
+
+    return dest;
+}
+
+/*
+   Write the samples in folded stack format.  Returns 0 on success, 1 if
+   the file can't be written.
+*/
+
+int pc_sample_folded(const char *filename)
+{
+    FILE *fp;
+    int result = 0;
+    int i;
+
+    if ( ( fp = fopen(filename,"w") ) == NULL )
+    {
+        return 1;
+    }
+
+    for ( i = 0 ; i < 256 ; i++ )
+    {
+        if ( pc_sample_count[i] )
+        {
+            fprintf(fp,"%s;%04x %lu\n",pc_sample_region_name(pc_sample_region(i)),i<<8,
+                       (unsigned long) pc_sample_count[i]);
+        }
+    }
+
+    if ( ferror(fp) )
+    {
+        result = 1;
+    }
+
+    if ( fclose(fp) )
+    {
+        result = 1;
+    }
+
+    return result;
+}
+
+
+
+
+
+
+
+
+
+
+
+/**********************************************************************
+
+                             Watchpoints
+                             ===========
+
+If watch_kinds is set (in mbee32k.ini) the addresses watch_start to
+watch_end are watched for the accesses given by watch_kinds: 1 for
+writes, 2 for reads and 4 for opcode reads, added together.  Only the
+pages the range covers are slowed down (see z80cpu.h), and the colour
+and PCG RAM switching goes on as normal underneath.  A watched access
+ends the current run, so sync_clock writes a line to WATCH_LOG_FILE
+straight after it: the number of timer ticks since startup, the kind of
+access, the address, the data and the PC.  If more than one access was
+caught in the run only the first is described, followed by the count.
+The -until-pc and -until-mem batch options (see "Batch runs") add
+watchpoints of their own, which are logged as well if watch_kinds is set.
+
+**********************************************************************/
+
+void watch_report(void)
+{
+    const char *kind_name;
+    UINT_32 hits;
+    UINT_8 kind = 0;
+    UINT_8 data = 0;
+    UINT_16 addr = 0;
+    UINT_16 pc = 0;
+
+    if ( ( hits = z80cpu_watch_hits(z80cpu_base,&kind,&addr,&data,&pc) ) == 0 )
+    {
+        return;
+    }
+
+    if ( batch_watched )
+    {
+        batch_watch_hit(kind,addr);
+    }
+
+    if ( watch_fp == NULL )
+    {
+        return;
+    }
+
+    switch ( kind )
+    {
+        case Z80CPU_WATCH_WR: { kind_name = "write";  break; }
+        case Z80CPU_WATCH_RD: { kind_name = "read";   break; }
+        default:              { kind_name = "opread"; break; }
+    }
+
+    fprintf(watch_fp,"%12lu %-6s %04x=%02x pc %04x",(unsigned long) throttle_call_count,kind_name,addr,data,pc);
+
+    if ( hits > 1 )
+    {
+        fprintf(watch_fp," (+%lu)",(unsigned long) ( hits - 1 ));
+    }
+
+    fprintf(watch_fp,"\n");
+
+    return;
+}
+
+
+
+
+
+
+
+
+
+
+
+/**********************************************************************
+
+                              Turbo mode
+                              ==========
+
+Turbo mode is for getting through slow tape loads and long computations
+quickly, and for measuring how fast the emulator is.  It is selected from
+the "CPU clock rate" menu or by starting the emulator with -turbo.  It
+is the same as "unlimited" (speed emulation off, with the 6545 slowed to
+max_crtc_granularity and max_crtc_clock_division unless crtc_pinned is
+set), but also keeps the figures below.  Going back to "normal" puts the
+6545 settings back as they were.
+
+About once a second (TURBO_REPORT_NS) a line is written to
+TURBO_LOG_FILE with:
+
+- the emulated z80 speed in MHz,
+- 6545 frames per second (counted at the start of VSYNC, see 6545.h),
+- sync_clock runs per second,
+- host cycles per emulated clock cycle (the time stamp counter, on x86
+  gcc builds - TURBO_HOST_CYCLES) or host nanoseconds per clock cycle
+  (anywhere else),
+- host cache misses per 1000 emulated clock cycles, if the host will
+  count them (Linux gcc builds - TURBO_CACHE_MISSES - where the kernel
+  lets user programs read the hardware counters).  This is the figure to
+  watch when changing how module data is laid out in memory.
+
+The time is taken from the host's monotonic clock where there is one
+(HOST_CLOCK_NS, the same clock the throttle sleeps on), and otherwise from
+the timer ticks (the calibrated timer_period_x).  sync_clock looks at the
+clock whenever the timer ticks and every TURBO_CHECK_MASK+1 runs, so the
+lines are written even where there is no timer (the headless build).  If
+no time could be measured at all the rates are given as n/a.  The totals
+for all the time spent in turbo mode are printed when the emulator exits.
+
+**********************************************************************/
+
+void turbo_start(void)
+{
+    if ( turbo_fp == NULL )
+    {
+        turbo_fp = fopen(TURBO_LOG_FILE,"w");
+    }
+
+    turbo_clocks      = 0;
+    turbo_runs        = 0;
+    turbo_ticks       = 0;
+    turbo_frames_base = crtc_frame_count;
+    turbo_cache_base  = turbo_cache_misses();
+
+    #ifdef HOST_CLOCK_NS
+    turbo_ns_base = throttle_host_ns();
+    #endif
+
+    #ifdef TURBO_HOST_CYCLES
+    turbo_host_base = TURBO_HOST_CYCLES();
+    #endif
+
+    turbo_mode = 1;
+
+    return;
+}
+
+void turbo_stop(void)
+{
+    if ( turbo_mode )
+    {
+        turbo_report();
+
+        turbo_mode = 0;
+    }
+
+    return;
+}
+
+void turbo_report(void)
+{
+    double ns;
+    double clocks;
+    UINT_32 frames;
+    UINT_64 host = 0;
+    UINT_64 cache;
+
+    ns     = turbo_elapsed_ns();
+    clocks = (double) turbo_clocks;
+    frames = crtc_frame_count - turbo_frames_base;
+    cache  = turbo_cache_misses() - turbo_cache_base;
+
+    #ifdef TURBO_HOST_CYCLES
+    host = TURBO_HOST_CYCLES() - turbo_host_base;
+    #endif
+
+    if ( ( ns > 0 ) && ( clocks > 0 ) && ( turbo_fp != NULL ) )
+    {
+        #ifdef TURBO_HOST_CYCLES
+        fprintf(turbo_fp,"%9.3f MHz %7.1f frames/s %9.0f runs/s %8.2f host cycles/cycle",
+                clocks*1000.0/ns,frames*1000000000.0/ns,turbo_runs*1000000000.0/ns,host/clocks);
+        #endif
+
+        #ifndef TURBO_HOST_CYCLES
+        fprintf(turbo_fp,"%9.3f MHz %7.1f frames/s %9.0f runs/s %8.2f host ns/cycle",
+                clocks*1000.0/ns,frames*1000000000.0/ns,turbo_runs*1000000000.0/ns,ns/clocks);
+        #endif
+
+        if ( turbo_cache_fd >= 0 )
+        {
+            fprintf(turbo_fp," %8.3f cache misses/kcycle",cache*1000.0/clocks);
+        }
+
+        fprintf(turbo_fp,"\n");
+        fflush(turbo_fp);
+    }
+
+    turbo_total_clocks += turbo_clocks;
+    turbo_total_runs   += turbo_runs;
+    turbo_total_frames += frames;
+    turbo_total_host   += host;
+    turbo_total_cache  += cache;
+    turbo_total_ns     += ns;
+
+    turbo_clocks      = 0;
+    turbo_runs        = 0;
+    turbo_ticks       = 0;
+    turbo_frames_base = crtc_frame_count;
+    turbo_cache_base  = turbo_cache_misses();
+
+    #ifdef HOST_CLOCK_NS
+    turbo_ns_base = throttle_host_ns();
+    #endif
+
+    #ifdef TURBO_HOST_CYCLES
+    turbo_host_base = TURBO_HOST_CYCLES();
+    #endif
+
+    return;
+}
+
+/*
+   Nanoseconds since the last turbo report (see "Turbo mode"), or 0 if
+   there is no host clock and the timer isn't running.
+*/
+
+double turbo_elapsed_ns(void)
+{
+    #ifdef HOST_CLOCK_NS
+    return (double) ( throttle_host_ns() - turbo_ns_base );
+    #endif
+
+    #ifndef HOST_CLOCK_NS
+    return ( (double) turbo_ticks ) * timer_period_x;
+    #endif
+}
+
+char *turbo_getinf(void)
+{
+    char *dest;
+    double ns;
+    double clocks;
+
+    ns     = turbo_total_ns;
+    clocks = ( turbo_total_clocks > 0 ) ? (double) turbo_total_clocks : 1;
+
+    if ( ( dest = (char *) DEBMALLOC((TURBO_MESSAGE_SIZE+1)*sizeof(char)) ) == NULL )
+    {
+        return NULL;
+    }
+
+    if ( ns > 0 )
+    {
+        sprintf(dest,"Turbo mode: %.1f s at %.3f MHz, %.1f frames/s, %.0f runs/s",
+                ns/1000000000.0,turbo_total_clocks*1000.0/ns,turbo_total_frames*1000000000.0/ns,
+                turbo_total_runs*1000000000.0/ns);
+    }
+
+    else
+    {
+        sprintf(dest,"Turbo mode: time n/a, %.0f clock cycles, %.0f frames, %.0f runs",
+                (double) turbo_total_clocks,(double) turbo_total_frames,(double) turbo_total_runs);
+    }
+
+    #ifdef TURBO_HOST_CYCLES
+    sprintf(dest+strlen(dest),", %.2f host cycles/cycle.\n",turbo_total_host/clocks);
+    #endif
+
+    #ifndef TURBO_HOST_CYCLES
+    if ( ns > 0 )
+    {
+        sprintf(dest+strlen(dest),", %.2f host ns/cycle.\n",ns/clocks);
+    }
+
+    else
+    {
+        sprintf(dest+strlen(dest),", host ns/cycle n/a.\n");
+    }
+    #endif
+
+    if ( turbo_cache_fd >= 0 )
+    {
+        sprintf(dest+strlen(dest),"Turbo mode: %.3f host cache misses/kcycle.\n",turbo_total_cache*1000.0/clocks);
+    }
+
+    return dest;
+}
+
+/*
+   Host cache misses so far, counted for this thread only, or 0 if the
+   host won't count them (see "Turbo mode").  The counter is opened the
+   first time through.
+*/
+
+UINT_64 turbo_cache_misses(void)
+{
+    #ifdef TURBO_CACHE_MISSES
+    struct perf_event_attr attr;
+    UINT_64 count;
+
+    if ( turbo_cache_fd == -1 )
+    {
+        memset(&attr,0,sizeof(attr));
+
+        attr.type           = PERF_TYPE_HARDWARE;
+        attr.size           = sizeof(attr);
+        attr.config         = PERF_COUNT_HW_CACHE_MISSES;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv     = 1;
+
+        if ( ( turbo_cache_fd = (int) syscall(__NR_perf_event_open,&attr,0,-1,-1,0) ) < 0 )
+        {
+            turbo_cache_fd = -2;
+        }
+    }
+
+    if ( turbo_cache_fd >= 0 )
+    {
+        if ( read(turbo_cache_fd,&count,sizeof(count)) == sizeof(count) )
+        {
+            return count;
+        }
+    }
+    #endif
+
+    return 0;
+}
+
+
+
+
+
+
+
+
+
+
+
+/**********************************************************************
+
+                              Batch runs
+                              ==========
+
+The emulator can be run from a script, with no one at the keyboard, and
+stopped when something happens.  The options (which may also be written
+with two dashes, as --until-pc etc.) are:
+
+   -headless           run with speed emulation off and the 6545 pinned at
+                       REAL_CRTC_GRANULARITY and REAL_CRTC_CLOCK_DIV (see
+                       crtc_pinned), so the run only depends on what is
+                       typed and loaded.  Built with IS_WEB there is no
+                       display or sound at all, which is the build to use
+                       for running lots of programs at once.
+   -load file          pipe file in through the tape port at 300 baud, as
+                       the "Tape in" menu does (-load1200 for 1200 baud).
+                       The program still has to be LOADed (see -keys).
+   -keys file          type the keystrokes in file, as the "Keyboard" menu
+                       does.
+   -until-pc addr      stop once the opcode at addr has been fetched.
+   -until-mem addr=val stop once val has been written to addr.
+   -until-text string  stop once string is on the screen.  The screen is
+                       read out of VDU RAM (see batch_screen_text) once
+                       every BATCH_TEXT_CLOCKS clock cycles (one frame).
+   -max-cycles n       stop after n clock cycles (n may be written 1e9).
+   -dump-screen file   at exit, write the screen text to file, one line
+                       per row.
+   -dump-ram s-e=file  at exit, write the memory from s to e (inclusive) to
+                       file.  Up to BATCH_MAX_DUMPS of these may be given.
+   -save-state file    at exit, save a snapshot (see "Snapshots") to file.
+
+Addresses and values may be in decimal or (with 0x) hex.  The first
+condition met stops the emulator.  The pc and memory conditions use
+watchpoints (see "Watchpoints"), so they are exact and only slow down the
+page they are on.  The cycle budget is part of the event horizon (see
+"Scheduling"), so it is met to within one step (Z80CPU_RUN_SLICE), and
+the text condition is checked at the end of each run, so is met to within
+one run (MAX_RUN_CLOCKS).  The memory
+seen by -until-mem and -dump-ram is RAM, ROM, VDU RAM (f000-f7ff) and PCG
+RAM (f800-ffff), whatever is switched in at the time.
+
+A line saying why the emulator stopped, and after how many clock cycles,
+is printed at exit.  The exit code is BATCH_EXIT_DUMP_FAILED if any of the
+files couldn't be written, BATCH_EXIT_NOT_MET if a pc, memory or text
+condition was given but the emulator stopped some other way (the cycle
+budget ran out or it was switched off), and 0 otherwise.  Errors in the
+options give 2, and key or tape files that can't be read give 18.
+
+**********************************************************************/
+
+/*
+   Deal with the option opt (with its leading dashes removed), whose
+   arguments (if any) are the nargs strings in args.  Returns the number
+   of strings used up (including the option itself), or 0 if the option
+   is unknown or its arguments are missing or make no sense.
+*/
+
+int batch_option(const char *opt, int nargs, char *args[])
+{
+    char *end;
+    unsigned long val;
+    unsigned long addr;
+    double cycles;
+
+    batch_on = 1;
+
+    if ( strcmp(opt,"headless") == 0 )
+    {
+        batch_headless = 1;
+
+        return 1;
+    }
+
+    if ( nargs < 1 )
+    {
+        return 0;
+    }
+
+    if ( strcmp(opt,"load") == 0 )
+    {
+        batch_tape_file  = args[0];
+        batch_tape_speed = 0;
+
+        return 2;
+    }
+
+    if ( strcmp(opt,"load1200") == 0 )
+    {
+        batch_tape_file  = args[0];
+        batch_tape_speed = 1;
+
+        return 2;
+    }
+
+    if ( strcmp(opt,"keys") == 0 )
+    {
+        batch_key_file = args[0];
+
+        return 2;
+    }
+
+    if ( strcmp(opt,"until-pc") == 0 )
+    {
+        val = strtoul(args[0],&end,0);
+
+        if ( ( *end != '\0' ) || ( val > 0x0ffff ) )
+        {
+            return 0;
+        }
+
+        batch_until_pc = (UINT_16) val;
+        batch_has_pc   = 1;
+        batch_watched  = 1;
+
+        return 2;
+    }
+
+    if ( strcmp(opt,"until-mem") == 0 )
+    {
+        addr = strtoul(args[0],&end,0);
+
+        if ( ( *end != '=' ) || ( addr > 0x0ffff ) )
+        {
+            return 0;
+        }
+
+        val = strtoul(end+1,&end,0);
+
+        if ( ( *end != '\0' ) || ( val > 0x0ff ) )
+        {
+            return 0;
+        }
+
+        batch_until_addr = (UINT_16) addr;
+        batch_until_val  = (UINT_8) val;
+        batch_has_mem    = 1;
+        batch_watched    = 1;
+
+        return 2;
+    }
+
+    if ( strcmp(opt,"until-text") == 0 )
+    {
+        if ( args[0][0] == '\0' )
+        {
+            return 0;
+        }
+
+        batch_until_text = args[0];
+
+        return 2;
+    }
+
+    if ( strcmp(opt,"max-cycles") == 0 )
+    {
+        cycles = strtod(args[0],&end);
+
+        if ( ( *end != '\0' ) || ( cycles < 1 ) )
+        {
+            return 0;
+        }
+
+        batch_max_cycles = (UINT_64) cycles;
+
+        return 2;
+    }
+
+    if ( strcmp(opt,"dump-screen") == 0 )
+    {
+        batch_screen_file = args[0];
+
+        return 2;
+    }
+
+    if ( strcmp(opt,"dump-ram") == 0 )
+    {
+        if ( batch_dumps >= BATCH_MAX_DUMPS )
+        {
+            return 0;
+        }
+
+        addr = strtoul(args[0],&end,0);
+
+        if ( ( *end != '-' ) || ( addr > 0x0ffff ) )
+        {
+            return 0;
+        }
+
+        val = strtoul(end+1,&end,0);
+
+        if ( ( *end != '=' ) || ( val > 0x0ffff ) || ( val < addr ) || ( end[1] == '\0' ) )
+        {
+            return 0;
+        }
+
+        batch_dump_start[batch_dumps] = (UINT_16) addr;
+        batch_dump_end[batch_dumps]   = (UINT_16) val;
+        batch_dump_file[batch_dumps]  = end+1;
+
+        batch_dumps++;
+
+        return 2;
+    }
+
+    if ( strcmp(opt,"save-state") == 0 )
+    {
+        batch_state_file = args[0];
+
+        return 2;
+    }
+
+    return 0;
+}
+
+/*
+   Set up the watchpoints and start typing and loading.  This has to be
+   done after interf_go, which closes the key and tape files.  Returns 0
+   on success.
+*/
+
+int batch_start(void)
+{
+    char *errdesc;
+
+    if ( batch_has_pc )
+    {
+        if ( z80cpu_watch_add(z80cpu_base,batch_until_pc,batch_until_pc,Z80CPU_WATCH_OP) )
+        {
+            printf("Unable to watch for pc %04x.\n",batch_until_pc);
+
+            return 1;
+        }
+    }
+
+    if ( batch_has_mem )
+    {
+        if ( z80cpu_watch_add(z80cpu_base,batch_until_addr,batch_until_addr,Z80CPU_WATCH_WR) )
+        {
+            printf("Unable to watch memory at %04x.\n",batch_until_addr);
+
+            return 1;
+        }
+    }
+
+    if ( batch_key_file != NULL )
+    {
+        if ( interf_set_key_file(bee_interf,batch_key_file) )
+        {
+            printf("Unable to open key file %s.\n",batch_key_file);
+
+            return 1;
+        }
+    }
+
+    if ( batch_tape_file != NULL )
+    {
+        if ( ( errdesc = interf_set_tape_file(bee_interf,batch_tape_file,batch_tape_speed) ) != NULL )
+        {
+            printf("Tape file %s: %s\n",batch_tape_file,errdesc);
+
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/*
+   Called by watch_report with the first watched access of a run.  The
+   memory condition is checked against what is in memory now, in case
+   the value written was changed again later in the run.
+*/
+
+void batch_watch_hit(UINT_8 kind, UINT_16 addr)
+{
+    if ( batch_hit )
+    {
+        return;
+    }
+
+    if ( batch_has_pc && ( kind == Z80CPU_WATCH_OP ) && ( addr == batch_until_pc ) )
+    {
+        batch_hit = BATCH_HIT_PC;
+    }
+
+    else if ( batch_has_mem && ( batch_peek(batch_until_addr) == batch_until_val ) )
+    {
+        batch_hit = BATCH_HIT_MEM;
+    }
+
+    return;
+}
+
+/*
+   Called by sync_clock after every run of clk_bus clock cycles.  Checks
+   the text and cycle conditions, and stops the emulator if any condition
+   has been met.
+*/
+
+void batch_check(UINT_16 clk_bus)
+{
+    UINT_8 cols;
+
+    batch_cycles += clk_bus;
+
+    if ( !batch_hit && ( batch_until_text != NULL ) )
+    {
+        batch_text_clocks += clk_bus;
+
+        if ( batch_text_clocks >= BATCH_TEXT_CLOCKS )
+        {
+            batch_text_clocks -= BATCH_TEXT_CLOCKS;
 
-        clk_bus = 0;
+            batch_screen_text(batch_text,&cols);
 
-        if ( mbee_reset_flag )
+            if ( strstr(batch_text,batch_until_text) != NULL )
+            {
+                batch_hit = BATCH_HIT_TEXT;
+            }
+        }
+    }
+
+    if ( !batch_hit && batch_max_cycles && ( batch_cycles >= batch_max_cycles ) )
+    {
+        batch_hit = BATCH_HIT_BUDGET;
+    }
+
+    if ( batch_hit )
+    {
+        mbee_power_flag = 0;
+    }
+
+    return;
+}
+
+/*
+   Read the byte at addr from the memory behind it, whatever is switched
+   in at f000-ffff.
+*/
+
+UINT_8 batch_peek(UINT_16 addr)
+{
+    module_data *mem;
+
+    if      ( addr < 0x04000 ) { mem = mem_user_ram_a; }
+    else if ( addr < 0x08000 ) { mem = mem_user_ram_b; }
+    else if ( addr < 0x0a000 ) { mem = mem_rom1;       }
+    else if ( addr < 0x0c000 ) { mem = mem_rom2;       }
+    else if ( addr < 0x0e000 ) { mem = mem_rom3;       }
+    else if ( addr < 0x0f000 ) { mem = mem_rom4;       }
+    else if ( addr < 0x0f800 ) { mem = mem_vdu_ram;    }
+    else                       { mem = mem_pcg_ram;    }
+
+    return DEBDEREF((DEBDEREF((mem->bus_8bit),2)),(addr & *DEBDEREF((mem->bus_32bit),1)));
+}
+
+/*
+   Put the text on the screen into dest (at least BATCH_VDU_SIZE+1 chars)
+   as one string, row after row, with the number of characters per row in
+   cols.  The text is read out of VDU RAM using the display start address
+   and size from the 6545.  Characters that aren't printable (including
+   PCG characters) are given as '.'.  Returns the number of characters.
+*/
+
+UINT_32 batch_screen_text(char *dest, UINT_8 *cols)
+{
+    UINT_8 *vdu;
+    UINT_16 start;
+    UINT_8 rows;
+    UINT_32 size;
+    UINT_32 i;
+    UINT_8 c;
+
+    vdu = DEBDEREF((mem_vdu_ram->bus_8bit),2);
+
+    sy6545_text_geometry(sy6545_base,&start,cols,&rows);
+
+    if ( ( size = ( (UINT_32) *cols ) * rows ) > BATCH_VDU_SIZE )
+    {
+        size = ( BATCH_VDU_SIZE / *cols ) * *cols;
+    }
+
+    for ( i = 0 ; i < size ; i++ )
+    {
+        c = DEBDEREF(vdu,((start+i) & ( BATCH_VDU_SIZE - 1 )));
+
+        dest[i] = ( ( c >= 0x020 ) && ( c < 0x07f ) ) ? (char) c : '.';
+    }
+
+    dest[size] = '\0';
+
+    return size;
+}
+
+/*
+   Write the screen, memory and snapshot files asked for.  Returns the
+   exit code (see above).
+*/
+
+int batch_finish(void)
+{
+    FILE *fp;
+    UINT_32 size;
+    UINT_32 i;
+    UINT_32 addr;
+    UINT_8 cols;
+    int result = 0;
+    int n;
+
+    if ( ( batch_has_pc || batch_has_mem || ( batch_until_text != NULL ) ) && ( ( batch_hit == 0 ) || ( batch_hit == BATCH_HIT_BUDGET ) ) )
+    {
+        result = BATCH_EXIT_NOT_MET;
+    }
+
+    if ( batch_screen_file != NULL )
+    {
+        size = batch_screen_text(batch_text,&cols);
+
+        if ( ( fp = fopen(batch_screen_file,"w") ) == NULL )
         {
-            /*
-               The reset key has been pressed.  Pass this signal back to the z80
-               emulation module.  This module will subsequently call the correct
-               reset function.
-            */
+            result = BATCH_EXIT_DUMP_FAILED;
+        }
 
-            (DEBDEREF((z80cpu_base->sig_calls_into_module),0))((void *) z80cpu_base);
+        else
+        {
+            for ( i = 0 ; i < size ; i += cols )
+            {
+                fprintf(fp,"%.*s\n",(int) cols,batch_text+i);
+            }
+
+            if ( fclose(fp) )
+            {
+                result = BATCH_EXIT_DUMP_FAILED;
+            }
         }
+    }
 
-        /*
-           Finally, some pio stuff to take care of - if a reti instruction has
-           occured, we need to tell the z80 pio about it.
-        */
+    for ( n = 0 ; n < batch_dumps ; n++ )
+    {
+        if ( ( fp = fopen(batch_dump_file[n],"wb") ) == NULL )
+        {
+            result = BATCH_EXIT_DUMP_FAILED;
 
-        if ( (*(DEBDEREF((bus_z80_reti_count->bus_32bit),0))) )
+            continue;
+        }
+
+        for ( addr = batch_dump_start[n] ; addr <= batch_dump_end[n] ; addr++ )
         {
-            (*(DEBDEREF((bus_z80_reti_count->bus_32bit),0))) = 0;
+            fputc(batch_peek((UINT_16) addr),fp);
+        }
 
-            (DEBDEREF((z80pio_base->sig_calls_into_module),13))((void *) z80pio_base);
+        if ( fclose(fp) )
+        {
+            result = BATCH_EXIT_DUMP_FAILED;
+        }
+    }
+
+    if ( batch_state_file != NULL )
+    {
+        if ( snapshot_save(batch_state_file) )
+        {
+            result = BATCH_EXIT_DUMP_FAILED;
+        }
+    }
+
+    return result;
+}
+
+char *batch_getinf(void)
+{
+    char *dest;
+
+    if ( ( dest = (char *) DEBMALLOC((BATCH_MESSAGE_SIZE+1)*sizeof(char)) ) == NULL )
+    {
+        return NULL;
+    }
+
+    switch ( batch_hit )
+    {
+        case BATCH_HIT_PC:     { sprintf(dest,"Batch run: reached pc %04x",batch_until_pc);                          break; }
+        case BATCH_HIT_MEM:    { sprintf(dest,"Batch run: %02x written to %04x",batch_until_val,batch_until_addr);   break; }
+        case BATCH_HIT_TEXT:   { sprintf(dest,"Batch run: found text on screen");                                    break; }
+        case BATCH_HIT_BUDGET: { sprintf(dest,"Batch run: cycle budget used up");                                    break; }
+        default:               { sprintf(dest,"Batch run: stopped");                                                 break; }
+    }
+
+    sprintf(dest+strlen(dest)," after %.0f clock cycles.\n",(double) batch_cycles);
+
+    return dest;
+}
+
+
+
+
+
+
+
+
+
+
+
+/**********************************************************************
+
+                              Snapshots
+                              =========
+
+The machine state can be saved to SNAPSHOT_FILE and loaded back from the
+menu.  The snapshot is made up of one section (see modules.h) for each
+module that holds state, listed in snapshot_sections below.  Memory comes
+first, as the cpu saves its page table as pointers into the memory
+modules, then the buses (which hold the memory map, colour and port
+latches, etc.), then the devices.  Modules that only pass signals along
+(and, or, do, etc.) have no state of their own and aren't saved, nor are
+modules the machine description left out (see machine_bindings).
+
+When loading, sections are matched by name.  Sections that aren't in the
+table, or that were written by a newer version of the module than this
+one, are skipped, and modules without a section are left as they are.
+The ROMs only save a checksum (see memmod_rom_serialise), as they can't
+change and are loaded from their files at startup, and a snapshot taken
+with different ROMs is refused.  Only the portable C z80 core can be
+saved and loaded, and the crtc clock left over from the last run in
+sync_clock (less than one crtc clock) is not saved.
+
+**********************************************************************/
+
+typedef struct
+{
+    const char *name;
+    module_data **module;
+    int (*serialise)(module_data *, snap_data *);
+    int (*deserialise)(module_data *, snap_data *);
+    UINT_32 version;
+}
+snapshot_section;
+
+snapshot_section snapshot_sections[] =
+{
+    { "ram_col",         &mem_colour_ram,         memmod_serialise,     memmod_deserialise,     MEMMOD_SNAP_VERSION     },
+    { "ram_lpen_read",   &mem_lpen_feedback,      memmod_serialise,     memmod_deserialise,     MEMMOD_SNAP_VERSION     },
+    { "ram_lpen_rfsh",   &mem_lpen_feedrfsh,      memmod_serialise,     memmod_deserialise,     MEMMOD_SNAP_VERSION     },
+    { "ram_lpen_keymap", &mem_lpen_table,         memmod_serialise,     memmod_deserialise,     MEMMOD_SNAP_VERSION     },
+    { "ram_pcg",         &mem_pcg_ram,            memmod_serialise,     memmod_deserialise,     MEMMOD_SNAP_VERSION     },
+    { "rom_basic1",      &mem_rom1,               memmod_rom_serialise, memmod_rom_deserialise, MEMMOD_ROM_SNAP_VERSION },
+    { "rom_basic2",      &mem_rom2,               memmod_rom_serialise, memmod_rom_deserialise, MEMMOD_ROM_SNAP_VERSION },
+    { "rom_edasm",       &mem_rom3,               memmod_rom_serialise, memmod_rom_deserialise, MEMMOD_ROM_SNAP_VERSION },
+    { "rom_empty",       &mem_rom4,               memmod_rom_serialise, memmod_rom_deserialise, MEMMOD_ROM_SNAP_VERSION },
+    { "rom_char",        &mem_rom5,               memmod_rom_serialise, memmod_rom_deserialise, MEMMOD_ROM_SNAP_VERSION },
+    { "ram_base1",       &mem_user_ram_a,         memmod_serialise,     memmod_deserialise,     MEMMOD_SNAP_VERSION     },
+    { "ram_base2",       &mem_user_ram_b,         memmod_serialise,     memmod_deserialise,     MEMMOD_SNAP_VERSION     },
+    { "ram_vdu",         &mem_vdu_ram,            memmod_serialise,     memmod_deserialise,     MEMMOD_SNAP_VERSION     },
+    { "bus_cnt_lpen",    &bus_cnt_lpen,           busmod_serialise,     busmod_deserialise,     BUSMOD_SNAP_VERSION     },
+    { "bus_cnt_update",  &bus_cnt_update,         busmod_serialise,     busmod_deserialise,     BUSMOD_SNAP_VERSION     },
+    { "bus_col_back",    &bus_col_back,           busmod_serialise,     busmod_deserialise,     BUSMOD_SNAP_VERSION     },
+    { "bus_col_fore",    &bus_col_fore,           busmod_serialise,     busmod_deserialise,     BUSMOD_SNAP_VERSION     },
+    { "bus_col_inv",     &bus_col_inv,            busmod_serialise,     busmod_deserialise,     BUSMOD_SNAP_VERSION     },
+    { "bus_col_isfore",  &bus_col_isfore,         busmod_serialise,     busmod_deserialise,     BUSMOD_SNAP_VERSION     },
+    { "bus_colback",     &bus_colback,            busmod_serialise,     busmod_deserialise,     BUSMOD_SNAP_VERSION     },
+    { "bus_colctrl",     &bus_colctrl,            busmod_serialise,     busmod_deserialise,     BUSMOD_SNAP_VERSION     },
+    { "bus_cputabsel",   &bus_cputabsel,          busmod_serialise,     busmod_deserialise,     BUSMOD_SNAP_VERSION     },
+    { "bus_geom",        &bus_geom,               busmod_serialise,     busmod_deserialise,     BUSMOD_SNAP_VERSION     },
+    { "bus_geom_pos_x",  &bus_geom_pos_x,         busmod_serialise,     busmod_deserialise,     BUSMOD_SNAP_VERSION     },
+    { "bus_geom_pos_y",  &bus_geom_pos_y,         busmod_serialise,     busmod_deserialise,     BUSMOD_SNAP_VERSION     },
+    { "bus_lpen_cmask",  &bus_lpen_callmask,      busmod_serialise,     busmod_deserialise,     BUSMOD_SNAP_VERSION     },
+    { "bus_new_colback", &bus_new_colback,        busmod_serialise,     busmod_deserialise,     BUSMOD_SNAP_VERSION     },
+    { "bus_new_colctrl", &bus_new_colctrl,        busmod_serialise,     busmod_deserialise,     BUSMOD_SNAP_VERSION     },
+    { "bus_new_romread", &bus_new_romread,        busmod_serialise,     busmod_deserialise,     BUSMOD_SNAP_VERSION     },
+    { "bus_pio_iei",     &bus_pio_iei,            busmod_serialise,     busmod_deserialise,     BUSMOD_SNAP_VERSION     },
+    { "bus_pio_ieo",     &bus_pio_ieo,            busmod_serialise,     busmod_deserialise,     BUSMOD_SNAP_VERSION     },
+    { "bus_pio_a_data",  &bus_pio_a_data,         busmod_serialise,     busmod_deserialise,     BUSMOD_SNAP_VERSION     },
+    { "bus_pio_a_rdy",   &bus_pio_a_rdy,          busmod_serialise,     busmod_deserialise,     BUSMOD_SNAP_VERSION     },
+    { "bus_pio_a_strb",  &bus_pio_a_strb,         busmod_serialise,     busmod_deserialise,     BUSMOD_SNAP_VERSION     },
+    { "bus_pio_b_data",  &bus_pio_b_data,         busmod_serialise,     busmod_deserialise,     BUSMOD_SNAP_VERSION     },
+    { "bus_pio_b_rdy",   &bus_pio_b_rdy,          busmod_serialise,     busmod_deserialise,     BUSMOD_SNAP_VERSION     },
+    { "bus_pio_b_strb",  &bus_pio_b_strb,         busmod_serialise,     busmod_deserialise,     BUSMOD_SNAP_VERSION     },
+    { "bus_romread",     &bus_romread,            busmod_serialise,     busmod_deserialise,     BUSMOD_SNAP_VERSION     },
+    { "bus_sound_bit",   &bus_sound_bit,          busmod_serialise,     busmod_deserialise,     BUSMOD_SNAP_VERSION     },
+    { "bus_sy6545_addr", &bus_sy6545_addr,        busmod_serialise,     busmod_deserialise,     BUSMOD_SNAP_VERSION     },
+    { "bus_sy6545_data", &bus_sy6545_data,        busmod_serialise,     busmod_deserialise,     BUSMOD_SNAP_VERSION     },
+    { "bus_tape_in",     &bus_tape_in,            busmod_serialise,     busmod_deserialise,     BUSMOD_SNAP_VERSION     },
+    { "bus_tape_out",    &bus_tape_out,           busmod_serialise,     busmod_deserialise,     BUSMOD_SNAP_VERSION     },
+    { "bus_vid_charln",  &bus_video_char_line,    busmod_serialise,     busmod_deserialise,     BUSMOD_SNAP_VERSION     },
+    { "bus_vid_data",    &bus_video_data,         busmod_serialise,     busmod_deserialise,     BUSMOD_SNAP_VERSION     },
+    { "bus_vid_memaddr", &bus_video_mem_addr,     busmod_serialise,     busmod_deserialise,     BUSMOD_SNAP_VERSION     },
+    { "bus_z80_addr",    &bus_z80_addr,           busmod_serialise,     busmod_deserialise,     BUSMOD_SNAP_VERSION     },
+    { "bus_z80_data",    &bus_z80_data,           busmod_serialise,     busmod_deserialise,     BUSMOD_SNAP_VERSION     },
+    { "bus_z80_reti",    &bus_z80_reti_count,     busmod_serialise,     busmod_deserialise,     BUSMOD_SNAP_VERSION     },
+    { "bus_z80_clkleft", &bus_z80_clk_left,       busmod_serialise,     busmod_deserialise,     BUSMOD_SNAP_VERSION     },
+    { "bus_z80_rfsh",    &bus_z80_rfsh,           busmod_serialise,     busmod_deserialise,     BUSMOD_SNAP_VERSION     },
+    { "bus_z80_tabstrt", &bus_z80_tab_num_start,  busmod_serialise,     busmod_deserialise,     BUSMOD_SNAP_VERSION     },
+    { "bus_z80_tabfin",  &bus_z80_tab_num_finish, busmod_serialise,     busmod_deserialise,     BUSMOD_SNAP_VERSION     },
+    { "bus_z80_tabrdwt", &bus_z80_tab_rd_wait,    busmod_serialise,     busmod_deserialise,     BUSMOD_SNAP_VERSION     },
+    { "bus_z80_tabwrwt", &bus_z80_tab_wr_wait,    busmod_serialise,     busmod_deserialise,     BUSMOD_SNAP_VERSION     },
+    { "bus_z80_wait",    &bus_z80_wait,           busmod_serialise,     busmod_deserialise,     BUSMOD_SNAP_VERSION     },
+    { "z80cpu",          &z80cpu_base,            z80cpu_serialise,     z80cpu_deserialise,     Z80CPU_SNAP_VERSION     },
+    { "crtc",            &sy6545_base,            sy6545_serialise,     sy6545_deserialise,     SY6545_SNAP_VERSION     },
+    { "z80pio",          &z80pio_base,            z80pio_serialise,     z80pio_deserialise,     Z80PIO_SNAP_VERSION     },
+    { "interf",          &bee_interf,             interf_serialise,     interf_deserialise,     INTERF_SNAP_VERSION     },
+    { NULL,              NULL,                    NULL,                 NULL,                   0                       }
+};
+
+/*
+   Save the machine state to the snapshot buffer, and then to the file
+   (unless filename is NULL).  Returns 0 on success.
+*/
+
+int snapshot_save(const char *filename)
+{
+    snapshot_section *sect;
+
+    if ( snapshot == NULL )
+    {
+        if ( ( snapshot = snap_alloc() ) == NULL )
+        {
+            return 1;
+        }
+    }
+
+    snap_clear(snapshot);
+
+    for ( sect = snapshot_sections ; sect->name != NULL ; sect++ )
+    {
+        if ( *(sect->module) == NULL )
+        {
+            continue;
+        }
+
+        snap_begin_section(snapshot,sect->name,sect->version);
+        (sect->serialise)(*(sect->module),snapshot);
+        snap_end_section(snapshot);
+    }
+
+    if ( snapshot->error )
+    {
+        return 1;
+    }
+
+    if ( filename != NULL )
+    {
+        return snap_write_file(snapshot,filename);
+    }
+
+    return 0;
+}
+
+/*
+   Load the machine state from the file (or, if filename is NULL, from
+   whatever is in the snapshot buffer).  Returns 0 on success.
+*/
+
+int snapshot_load(const char *filename)
+{
+    snapshot_section *sect;
+    char name[SNAP_NAME_SIZE];
+
+    if ( snapshot == NULL )
+    {
+        if ( filename == NULL )
+        {
+            return 1;
+        }
+
+        if ( ( snapshot = snap_alloc() ) == NULL )
+        {
+            return 1;
+        }
+    }
+
+    if ( filename != NULL )
+    {
+        if ( snap_read_file(snapshot,filename) )
+        {
+            return 1;
+        }
+    }
+
+    else
+    {
+        if ( snap_rewind(snapshot) )
+        {
+            return 1;
+        }
+    }
+
+    while ( snap_next_section(snapshot,name) == 0 )
+    {
+        for ( sect = snapshot_sections ; sect->name != NULL ; sect++ )
+        {
+            if ( strcmp(sect->name,name) == 0 )
+            {
+                if ( ( *(sect->module) != NULL ) && ( snapshot->sect_version <= sect->version ) )
+                {
+                    (sect->deserialise)(*(sect->module),snapshot);
+                }
+
+                break;
+            }
         }
+
+        snap_end_section(snapshot);
+    }
+
+    /*
+       Don't try to catch up on the time spent loading.
+    */
+
+    actual_clocks   = 0;
+    throttle_rebase = 1;
+
+    return snapshot->error;
+}
+
+
+
+
+
+
+
+
+
+
+/**********************************************************************
+
+                               Rewind
+                               ======
+
+If rewind_seconds is set (in mbee32k.ini) a snapshot of the machine (see
+"Snapshots") is taken every rewind_frames frames of emulated time (a frame
+being REWIND_FRAME_CLOCKS z80 clock cycles, 1/50 of a second) and kept in
+rewind_ring, which holds rewind_seconds worth.  The ring only keeps the
+newest snapshot whole, and the rest as the run length encoded XOR of each
+with the one after it (see "Snapshot rings" in modules.h), which as only a
+few hundred bytes of a snapshot change from one to the next is very
+little.  The ring is also limited to REWIND_MAX_BYTES, and throws away the
+oldest snapshots if it would go over.  As the ROM sections only hold a
+checksum, the newest snapshot doesn't carry a copy of the ROMs either.
+
+Rewinding (from the menu) winds the ring back one second's worth of
+snapshots, loads the snapshot reached, and carries on from there.  The
+snapshots after it are thrown away, so rewinding again goes back another
+second.
+
+**********************************************************************/
+
+/*
+   Add a snapshot of the machine as it is now to the rewind ring.
+*/
+
+void rewind_capture(void)
+{
+    if ( snapshot_save(NULL) == 0 )
+    {
+        snap_ring_push(rewind_ring,snapshot);
     }
 
     return;
 }
 
+/*
+   Wind the machine back the given number of seconds (or as far as the
+   ring goes).  Returns 0 on success.
+*/
+
+int rewind_back(UINT_32 seconds)
+{
+    if ( rewind_ring == NULL )
+    {
+        return 1;
+    }
+
+    if ( snap_ring_back(rewind_ring,snapshot,(seconds*REWIND_FRAMES_PER_SEC)/rewind_frames) )
+    {
+        return 1;
+    }
 
+    return snapshot_load(NULL);
+}
 
 
 
@@ -2270,11 +2891,22 @@ void sync_clock(void)
 
 void timer_speed_emul_off(void *what)
 {
-    do_throttle   = 0;
-    actual_clocks = 0;
+    turbo_stop();
+
+    if ( do_throttle )
+    {
+        temp_crtc_granularity    = crtc_granularity;
+        temp_crtc_clock_division = crtc_clock_division;
+    }
+
+    do_throttle     = 0;
+    actual_clocks   = 0;
+    throttle_rebase = 1;
 
-    temp_crtc_granularity    = crtc_granularity;
-    temp_crtc_clock_division = crtc_clock_division;
+    if ( crtc_pinned )
+    {
+        return;
+    }
 
     #ifdef FAST_IS_SLOW
     crtc_granularity    = REAL_CRTC_GRANULARITY;
@@ -2293,8 +2925,11 @@ void timer_speed_emul_off(void *what)
 
 void timer_speed_emul_on(void *what)
 {
-    do_throttle   = 1;
-    actual_clocks = 0;
+    turbo_stop();
+
+    do_throttle     = 1;
+    actual_clocks   = 0;
+    throttle_rebase = 1;
 
     crtc_granularity    = temp_crtc_granularity;
     crtc_clock_division = temp_crtc_clock_division;
@@ -2304,6 +2939,17 @@ void timer_speed_emul_on(void *what)
     what = NULL;
 }
 
+void turbo_on(void *what)
+{
+    timer_speed_emul_off(what);
+
+    turbo_start();
+
+    return;
+
+    what = NULL;
+}
+
 void stop_emulator(void *what)
 {
     /*
@@ -2329,7 +2975,8 @@ void pause_emulation(void *what)
 
 void restart_emulation(void *what)
 {
-    is_paused = 0;
+    is_paused       = 0;
+    throttle_rebase = 1;
 
     return;
 
@@ -2354,6 +3001,39 @@ void clear_reset_flag(void *what)
     what = NULL;
 }
 
+void save_machine_state(void *what)
+{
+    if ( snapshot_save(SNAPSHOT_FILE) )
+    {
+        fprintf(stderr,"Unable to save machine state.\n");
+    }
+
+    return;
+
+    what = NULL;
+}
+
+void load_machine_state(void *what)
+{
+    if ( snapshot_load(SNAPSHOT_FILE) )
+    {
+        fprintf(stderr,"Unable to load machine state.\n");
+    }
+
+    return;
+
+    what = NULL;
+}
+
+void rewind_machine_state(void *what)
+{
+    rewind_back(1);
+
+    return;
+
+    what = NULL;
+}
+
 
 
 
@@ -2381,7 +3061,6 @@ void clear_reset_flag(void *what)
 
 module_data *bus_cputabsel;
 
-module_data *setbus_cpu_tab;
 
 (setbus_cpu_tab->var_32bit)[0] = 10;
 (setbus_cpu_tab->var_32bit)[3] = 5;
@@ -2583,6 +3262,41 @@ module_data *setbus_cpu_tab;
    is only inserted when actual_clocks goes below -catchup_point.
 
 
+   Sleeping Rather Than Spinning
+   =============================
+
+   Waiting for speed_throttle to top up actual_clocks means spinning, which
+   keeps a host core flat out even when the microbee is doing nothing.  So
+   where the host has clock_nanosleep (THROTTLE_SLEEPS, which is defined if
+   time.h has TIMER_ABSTIME and CLOCK_MONOTONIC unless DISABLE_THROTTLE_SLEEP
+   is defined) sync_clock paces the emulator against the host clock instead:
+
+   - throttle_deadline is the host time (CLOCK_MONOTONIC, in nanoseconds) at
+     which the microbee should have got to where the emulator is now.  It
+     is advanced by clk_bus*clock_period after every run.
+   - actual_clocks is set from how far the host clock is past (positive)
+     or short of (negative) the deadline, in clock cycles, rather than being
+     added to by speed_throttle.  So everything above still applies.
+   - The emulator only waits once it is at least THROTTLE_SLEEP_NS (1ms)
+     ahead, or catchup_point clock cycles if that is more, so that it
+     sleeps a few times a frame rather than every few hundred clock cycles
+     (each sleep and wake up costs the host far more than the emulation in
+     between).  It then sleeps until THROTTLE_SPIN_NS (5us) before the
+     deadline, using an absolute deadline so that errors don't build up,
+     and spins for the rest.  Oversleeping is made up on the next run, as
+     actual_clocks then goes positive.
+   - When actual_clocks goes over max_clockovr the deadline is moved up
+     so that actual_clocks is max_clockovr_pb, and the 6545 is slowed as
+     below (throttle_behind).  So emulated time never lags by more than
+     max_clockovr clock cycles (about a frame with the defaults).
+   - Whenever actual_clocks would have been zeroed (speed emulation turned
+     on or off, the emulator restarted after the menu, a snapshot loaded)
+     throttle_rebase is set and the deadline starts again from now.
+
+   speed_throttle still ticks, setting sync_point and counting is_wait
+   (below) as before.  Some older libraries need -lrt for clock_nanosleep.
+
+
    When the Computer Can't Keep Up
    ===============================
 
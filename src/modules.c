@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "u_dtype.h"
 #include "modules.h"
@@ -23,6 +24,131 @@ SetupData default_setdat[] =
 
 void global_nothingfn(void *what);
 
+/*
+   Module memory (see modules.h).  module_block allocates size bytes
+   aligned to MODULE_ALIGN, putting the pointer to be freed in *raw, and
+   module_carve takes the next num elements of size bytes from *next.
+   Sizes are worked out in the order the arrays are carved, largest
+   alignment first, so nothing needs padding.
+*/
+
+static UINT_8 *module_block(void **raw, size_t size)
+{
+    if ( ( *raw = DEBMALLOC(size+MODULE_ALIGN-1) ) == NULL )
+    {
+        return NULL;
+    }
+
+    return (UINT_8 *) ( ( ( (size_t) *raw ) + MODULE_ALIGN - 1 ) & ~( (size_t) ( MODULE_ALIGN - 1 ) ) );
+}
+
+static void *module_carve(UINT_8 **next, UINT_64 num, size_t size)
+{
+    void *result = NULL;
+
+    if ( num > 0 )
+    {
+        result = (void *) *next;
+
+        *next += num*size;
+
+        DEBCARVE(result,num*size);
+    }
+
+    return result;
+}
+
+static size_t module_var_size(module_data *result)
+{
+    return ( result->num_stringvars * sizeof(char *)  ) +
+           ( result->num_var_32bit  * sizeof(UINT_32) ) +
+           ( result->num_var_16bit  * sizeof(UINT_16) ) +
+           ( result->num_var_8bit   * sizeof(UINT_8)  );
+}
+
+static size_t module_bus_size(module_data *result)
+{
+    return ( result->num_bus_8bit               * sizeof(UINT_8  *)                ) +
+           ( result->num_bus_16bit              * sizeof(UINT_16 *)                ) +
+           ( result->num_bus_32bit              * sizeof(UINT_32 *)                ) +
+           ( result->num_sig_calls_into_module  * sizeof(weird_pointer_jive_wargs) ) +
+           ( result->num_sig_calls_outof_module * sizeof(weird_pointer_jive_wargs) ) +
+           ( result->num_sig_calls_outof_module * sizeof(void *)                   ) +
+           ( result->num_modptrs                * sizeof(module_data *)            );
+}
+
+static void module_var_carve(module_data *result, UINT_8 **next)
+{
+    UINT_64 i;
+
+    result->stringvars = (char **)   module_carve(next,result->num_stringvars,sizeof(char *));
+    result->var_32bit  = (UINT_32 *) module_carve(next,result->num_var_32bit, sizeof(UINT_32));
+    result->var_16bit  = (UINT_16 *) module_carve(next,result->num_var_16bit, sizeof(UINT_16));
+    result->var_8bit   = (UINT_8  *) module_carve(next,result->num_var_8bit,  sizeof(UINT_8));
+
+    for ( i = 0 ; i < result->num_var_8bit   ; i++ ) { DEBDEREF((result->var_8bit),i)   = global_8dummyvar;  }
+    for ( i = 0 ; i < result->num_var_16bit  ; i++ ) { DEBDEREF((result->var_16bit),i)  = global_16dummyvar; }
+    for ( i = 0 ; i < result->num_var_32bit  ; i++ ) { DEBDEREF((result->var_32bit),i)  = global_32dummyvar; }
+    for ( i = 0 ; i < result->num_stringvars ; i++ ) { DEBDEREF((result->stringvars),i) = global_strdummy;   }
+
+    return;
+}
+
+static void module_bus_carve(module_data *result, UINT_8 **next)
+{
+    UINT_64 i;
+
+    result->bus_8bit  = (VOLATILITY UINT_8  **) module_carve(next,result->num_bus_8bit, sizeof(UINT_8  *));
+    result->bus_16bit = (VOLATILITY UINT_16 **) module_carve(next,result->num_bus_16bit,sizeof(UINT_16 *));
+    result->bus_32bit = (VOLATILITY UINT_32 **) module_carve(next,result->num_bus_32bit,sizeof(UINT_32 *));
+
+    result->sig_calls_into_module  = (weird_pointer_jive_wargs *) module_carve(next,result->num_sig_calls_into_module, sizeof(weird_pointer_jive_wargs));
+    result->sig_calls_outof_module = (weird_pointer_jive_wargs *) module_carve(next,result->num_sig_calls_outof_module,sizeof(weird_pointer_jive_wargs));
+    result->sig_calls_outof_args   = (void **)                    module_carve(next,result->num_sig_calls_outof_module,sizeof(void *));
+
+    result->modptrs = (module_data **) module_carve(next,result->num_modptrs,sizeof(module_data *));
+
+    for ( i = 0 ; i < result->num_modptrs   ; i++ ) { DEBDEREF((result->modptrs),i)   = NULL;              }
+    for ( i = 0 ; i < result->num_bus_8bit  ; i++ ) { DEBDEREF((result->bus_8bit),i)  = global_8dummyptr;  }
+    for ( i = 0 ; i < result->num_bus_16bit ; i++ ) { DEBDEREF((result->bus_16bit),i) = global_16dummyptr; }
+    for ( i = 0 ; i < result->num_bus_32bit ; i++ ) { DEBDEREF((result->bus_32bit),i) = global_32dummyptr; }
+
+    for ( i = 0 ; i < result->num_sig_calls_outof_module ; i++ ) { DEBDEREF((result->sig_calls_outof_module),i) = global_nothingfn; }
+    for ( i = 0 ; i < result->num_sig_calls_outof_module ; i++ ) { DEBDEREF((result->sig_calls_outof_args),i)   = NULL;             }
+
+    return;
+}
+
+static void module_set_counts(module_data *result,
+                              UINT_64 num_var_8bit,
+                              UINT_64 num_var_16bit,
+                              UINT_64 num_var_32bit,
+                              UINT_64 num_stringvars,
+                              UINT_64 num_modptrs,
+                              UINT_64 num_bus_8bit,
+                              UINT_64 num_bus_16bit,
+                              UINT_64 num_bus_32bit,
+                              UINT_64 num_sig_calls_into_module,
+                              UINT_64 num_sig_calls_outof_module)
+{
+    result->num_var_8bit  = num_var_8bit;
+    result->num_var_16bit = num_var_16bit;
+    result->num_var_32bit = num_var_32bit;
+
+    result->num_stringvars = num_stringvars;
+
+    result->num_modptrs = num_modptrs;
+
+    result->num_bus_8bit  = num_bus_8bit;
+    result->num_bus_16bit = num_bus_16bit;
+    result->num_bus_32bit = num_bus_32bit;
+
+    result->num_sig_calls_into_module  = num_sig_calls_into_module;
+    result->num_sig_calls_outof_module = num_sig_calls_outof_module;
+
+    return;
+}
+
 module_data *gen_module_data(const char *module_name,
                              int is_mod_clocked,
                              UINT_64 num_var_8bit,
@@ -36,20 +162,91 @@ module_data *gen_module_data(const char *module_name,
                              UINT_64 num_sig_calls_into_module,
                              UINT_64 num_sig_calls_outof_module)
 {
+    module_data counts;
     module_data *result;
-    UINT_64 i;
+    UINT_8 *next;
+    void *raw;
 
-    if ( ( result = DEBMALLOC(sizeof(module_data)) ) != NULL )
+    module_set_counts(&counts,num_var_8bit,num_var_16bit,num_var_32bit,num_stringvars,num_modptrs,num_bus_8bit,num_bus_16bit,num_bus_32bit,num_sig_calls_into_module,num_sig_calls_outof_module);
+
+    if ( ( next = module_block(&raw,sizeof(module_data)+module_bus_size(&counts)+module_var_size(&counts)) ) != NULL )
     {
+        result = (module_data *) next;
+        next  += sizeof(module_data);
+
+        *result = counts;
+
         result->module_name = module_name;
         result->config_data = default_setdat;
 
-        result->num_var_8bit  = num_var_8bit;
-        result->num_var_16bit = num_var_16bit;
-        result->num_var_32bit = num_var_32bit;
+        result->internal_data = NULL;
+
+        result->mod_clocked = is_mod_clocked;
+
+        result->block     = raw;
+        result->bus_block = NULL;
+
+        module_bus_carve(result,&next);
+        module_var_carve(result,&next);
+
+        return result;
+    }
+
+    return NULL;
+}
+
+module_data *gen_module_data_varonly(const char *module_name,
+                                     int is_mod_clocked,
+                                     UINT_64 num_var_8bit,
+                                     UINT_64 num_var_16bit,
+                                     UINT_64 num_var_32bit,
+                                     UINT_64 num_stringvars)
+{
+    module_data counts;
+    module_data *result;
+    UINT_8 *next;
+    void *raw;
+
+    module_set_counts(&counts,num_var_8bit,num_var_16bit,num_var_32bit,num_stringvars,0,0,0,0,0,0);
+
+    if ( ( next = module_block(&raw,sizeof(module_data)+module_var_size(&counts)) ) != NULL )
+    {
+        result = (module_data *) next;
+        next  += sizeof(module_data);
+
+        *result = counts;
+
+        result->module_name = module_name;
+        result->config_data = default_setdat;
+
+        result->internal_data = NULL;
 
-        result->num_stringvars = num_stringvars;
+        result->mod_clocked = is_mod_clocked;
+
+        result->block     = raw;
+        result->bus_block = NULL;
+
+        module_bus_carve(result,&next);
+        module_var_carve(result,&next);
+
+        return result;
+    }
+
+    return NULL;
+}
 
+module_data *gen_module_data_nonvaronly(module_data *result,
+                                        UINT_64 num_modptrs,
+                                        UINT_64 num_bus_8bit,
+                                        UINT_64 num_bus_16bit,
+                                        UINT_64 num_bus_32bit,
+                                        UINT_64 num_sig_calls_into_module,
+                                        UINT_64 num_sig_calls_outof_module)
+{
+    UINT_8 *next;
+
+    if ( result != NULL )
+    {
         result->num_modptrs = num_modptrs;
 
         result->num_bus_8bit  = num_bus_8bit;
@@ -59,192 +256,817 @@ module_data *gen_module_data(const char *module_name,
         result->num_sig_calls_into_module  = num_sig_calls_into_module;
         result->num_sig_calls_outof_module = num_sig_calls_outof_module;
 
-        result->var_8bit  = NULL;
-        result->var_16bit = NULL;
-        result->var_32bit = NULL;
+        if ( ( next = module_block(&(result->bus_block),module_bus_size(result)) ) == NULL )
+        {
+            return NULL;
+        }
 
-        result->stringvars = NULL;
+        module_bus_carve(result,&next);
+    }
 
-        result->modptrs = NULL;
+    return result;
+}
 
-        result->bus_8bit  = NULL;
-        result->bus_16bit = NULL;
-        result->bus_32bit = NULL;
+void global_nothingfn(void *what)
+{
+    return;
 
-        result->sig_calls_into_module  = NULL;
-        result->sig_calls_outof_module = NULL;
-        result->sig_calls_outof_args   = NULL;
+    what = NULL;
+}
 
-        result->internal_data = NULL;
+void free_module_data(module_data *what)
+{
+    if ( what != NULL )
+    {
+        DEBUNCARVE(what->bus_8bit);
+        DEBUNCARVE(what->bus_16bit);
+        DEBUNCARVE(what->bus_32bit);
 
-        result->mod_clocked = is_mod_clocked;
+        DEBUNCARVE(what->sig_calls_into_module);
+        DEBUNCARVE(what->sig_calls_outof_module);
+        DEBUNCARVE(what->sig_calls_outof_args);
+
+        DEBUNCARVE(what->modptrs);
+        DEBUNCARVE(what->stringvars);
+
+        DEBUNCARVE(what->var_32bit);
+        DEBUNCARVE(what->var_16bit);
+        DEBUNCARVE(what->var_8bit);
 
-        if ( num_var_8bit  > 0 ) { if ( ( result->var_8bit  = (UINT_8  *) DEBMALLOC(num_var_8bit *sizeof(UINT_8 )) ) == NULL ) { return NULL; } }
-        if ( num_var_16bit > 0 ) { if ( ( result->var_16bit = (UINT_16 *) DEBMALLOC(num_var_16bit*sizeof(UINT_16)) ) == NULL ) { return NULL; } }
-        if ( num_var_32bit > 0 ) { if ( ( result->var_32bit = (UINT_32 *) DEBMALLOC(num_var_32bit*sizeof(UINT_32)) ) == NULL ) { return NULL; } }
+        if ( what->bus_block != NULL )
+        {
+            DEBFREE(what->bus_block);
+        }
 
-        if ( num_stringvars > 0 ) { if ( ( result->stringvars = (char **) DEBMALLOC(num_stringvars*sizeof(char *)) ) == NULL ) { return NULL; } }
+        DEBFREE(what->block);
+    }
 
-        if ( num_modptrs > 0 ) { if ( ( result->modptrs = (module_data **) DEBMALLOC(num_modptrs*sizeof(module_data *)) ) == NULL ) { return NULL; } }
+    return;
+}
 
-        if ( num_bus_8bit  > 0 ) { if ( ( result->bus_8bit  = (UINT_8  **) DEBMALLOC(num_bus_8bit *sizeof(UINT_8  *)) ) == NULL ) { return NULL; } }
-        if ( num_bus_16bit > 0 ) { if ( ( result->bus_16bit = (UINT_16 **) DEBMALLOC(num_bus_16bit*sizeof(UINT_16 *)) ) == NULL ) { return NULL; } }
-        if ( num_bus_32bit > 0 ) { if ( ( result->bus_32bit = (UINT_32 **) DEBMALLOC(num_bus_32bit*sizeof(UINT_32 *)) ) == NULL ) { return NULL; } }
 
-        if ( num_sig_calls_into_module  > 0 ) { if ( ( result->sig_calls_into_module  = (weird_pointer_jive_wargs *) DEBMALLOC(num_sig_calls_into_module *sizeof(weird_pointer_jive_wargs)) ) == NULL ) { return NULL; } }
-        if ( num_sig_calls_outof_module > 0 ) { if ( ( result->sig_calls_outof_module = (weird_pointer_jive_wargs *) DEBMALLOC(num_sig_calls_outof_module*sizeof(weird_pointer_jive_wargs)) ) == NULL ) { return NULL; } }
-        if ( num_sig_calls_outof_module > 0 ) { if ( ( result->sig_calls_outof_args   = (void **)                    DEBMALLOC(num_sig_calls_outof_module*sizeof(void *                  )) ) == NULL ) { return NULL; } }
 
-        if ( num_var_8bit  > 0 ) { for ( i = 0 ; i < num_var_8bit  ; i++ ) { DEBDEREF((result->var_8bit),i)  = global_8dummyvar;  } }
-        if ( num_var_16bit > 0 ) { for ( i = 0 ; i < num_var_16bit ; i++ ) { DEBDEREF((result->var_16bit),i) = global_16dummyvar; } }
-        if ( num_var_32bit > 0 ) { for ( i = 0 ; i < num_var_32bit ; i++ ) { DEBDEREF((result->var_32bit),i) = global_32dummyvar; } }
 
-        if ( num_stringvars > 0 ) { for ( i = 0 ; i < num_stringvars ; i++ ) { DEBDEREF((result->stringvars),i) = global_strdummy; } }
+/*
+   Snapshots (see modules.h).
+*/
 
-        if ( num_modptrs > 0 ) { for ( i = 0 ; i < num_modptrs ; i++ ) { DEBDEREF((result->modptrs),i) = NULL; } }
+snap_data *snap_alloc(void)
+{
+    snap_data *snap;
 
-        if ( num_bus_8bit  > 0 ) { for ( i = 0 ; i < num_bus_8bit  ; i++ ) { DEBDEREF((result->bus_8bit),i)  = global_8dummyptr;  } }
-        if ( num_bus_16bit > 0 ) { for ( i = 0 ; i < num_bus_16bit ; i++ ) { DEBDEREF((result->bus_16bit),i) = global_16dummyptr; } }
-        if ( num_bus_32bit > 0 ) { for ( i = 0 ; i < num_bus_32bit ; i++ ) { DEBDEREF((result->bus_32bit),i) = global_32dummyptr; } }
+    if ( ( snap = (snap_data *) DEBMALLOC(sizeof(snap_data)) ) != NULL )
+    {
+        snap->data  = NULL;
+        snap->alloc = 0;
 
-        if ( num_sig_calls_outof_module > 0 ) { for ( i = 0 ; i < num_sig_calls_outof_module ; i++ ) { DEBDEREF((result->sig_calls_outof_module),i) = global_nothingfn; } }
-        if ( num_sig_calls_outof_module > 0 ) { for ( i = 0 ; i < num_sig_calls_outof_module ; i++ ) { DEBDEREF((result->sig_calls_outof_args),i)   = NULL;             } }
+        snap_clear(snap);
     }
 
-    return result;
+    return snap;
 }
 
-module_data *gen_module_data_varonly(const char *module_name,
-                                     int is_mod_clocked,
-                                     UINT_64 num_var_8bit,
-                                     UINT_64 num_var_16bit,
-                                     UINT_64 num_var_32bit,
-                                     UINT_64 num_stringvars)
+void snap_free(snap_data *snap)
 {
-    UINT_64 i;
+    if ( snap != NULL )
+    {
+        if ( snap->data != NULL )
+        {
+            DEBFREE(snap->data);
+        }
 
-    module_data *result;
+        DEBFREE(snap);
+    }
+
+    return;
+}
+
+/*
+   Make room for len more bytes at the end of the buffer.  The buffer is
+   at least doubled each time it grows.
+*/
 
-    if ( ( result = DEBMALLOC(sizeof(module_data)) ) != NULL )
+static int snap_grow(snap_data *snap, UINT_32 len)
+{
+    UINT_8 *data;
+    UINT_32 alloc;
+
+    if ( snap->size + len <= snap->alloc )
     {
-        result->module_name = module_name;
-        result->config_data = default_setdat;
+        return 0;
+    }
 
-        result->num_var_8bit  = num_var_8bit;
-        result->num_var_16bit = num_var_16bit;
-        result->num_var_32bit = num_var_32bit;
+    alloc = ( snap->alloc < 0x010000 ) ? 0x010000 : snap->alloc;
 
-        result->num_stringvars = num_stringvars;
+    while ( alloc < snap->size + len )
+    {
+        alloc *= 2;
+    }
 
-        result->var_8bit  = NULL;
-        result->var_16bit = NULL;
-        result->var_32bit = NULL;
+    if ( ( data = (UINT_8 *) DEBMALLOC(alloc) ) == NULL )
+    {
+        snap->error = 1;
 
-        result->stringvars = NULL;
+        return 1;
+    }
 
-        result->modptrs = NULL;
+    if ( snap->data != NULL )
+    {
+        memcpy(data,snap->data,snap->size);
 
-        result->bus_8bit  = NULL;
-        result->bus_16bit = NULL;
-        result->bus_32bit = NULL;
+        DEBFREE(snap->data);
+    }
 
-        result->sig_calls_into_module  = NULL;
-        result->sig_calls_outof_module = NULL;
-        result->sig_calls_outof_args   = NULL;
+    snap->data  = data;
+    snap->alloc = alloc;
 
-        result->internal_data = NULL;
+    return 0;
+}
 
-        result->mod_clocked = is_mod_clocked;
+static void snap_poke(UINT_8 *dest, UINT_64 val, int len)
+{
+    int i;
 
-        if ( num_var_8bit  > 0 ) { if ( ( result->var_8bit  = (UINT_8  *) DEBMALLOC(num_var_8bit *sizeof(UINT_8 )) ) == NULL ) { return NULL; } }
-        if ( num_var_16bit > 0 ) { if ( ( result->var_16bit = (UINT_16 *) DEBMALLOC(num_var_16bit*sizeof(UINT_16)) ) == NULL ) { return NULL; } }
-        if ( num_var_32bit > 0 ) { if ( ( result->var_32bit = (UINT_32 *) DEBMALLOC(num_var_32bit*sizeof(UINT_32)) ) == NULL ) { return NULL; } }
+    for ( i = 0 ; i < len ; i++ )
+    {
+        dest[i] = (UINT_8) ( val >> ( 8 * i ) );
+    }
 
-        if ( num_stringvars > 0 ) { if ( ( result->stringvars = (char **) DEBMALLOC(num_stringvars*sizeof(char *)) ) == NULL ) { return NULL; } }
+    return;
+}
 
-        if ( num_var_8bit  > 0 ) { for ( i = 0 ; i < num_var_8bit  ; i++ ) { DEBDEREF((result->var_8bit),i)  = global_8dummyvar;  } }
-        if ( num_var_16bit > 0 ) { for ( i = 0 ; i < num_var_16bit ; i++ ) { DEBDEREF((result->var_16bit),i) = global_16dummyvar; } }
-        if ( num_var_32bit > 0 ) { for ( i = 0 ; i < num_var_32bit ; i++ ) { DEBDEREF((result->var_32bit),i) = global_32dummyvar; } }
+static UINT_64 snap_peek(const UINT_8 *src, int len)
+{
+    UINT_64 val = 0;
+    int i;
 
-        if ( num_stringvars > 0 ) { for ( i = 0 ; i < num_stringvars ; i++ ) { DEBDEREF((result->stringvars),i) = global_strdummy; } }
+    for ( i = len-1 ; i >= 0 ; i-- )
+    {
+        val = ( val << 8 ) | src[i];
     }
 
-    return result;
+    return val;
 }
 
-        
-module_data *gen_module_data_nonvaronly(module_data *result,
-                                        UINT_64 num_modptrs,
-                                        UINT_64 num_bus_8bit,
-                                        UINT_64 num_bus_16bit,
-                                        UINT_64 num_bus_32bit,
-                                        UINT_64 num_sig_calls_into_module,
-                                        UINT_64 num_sig_calls_outof_module)
+/*
+   Empty the buffer (keeping its memory) and write the header.
+*/
+
+void snap_clear(snap_data *snap)
 {
-    UINT_64 i;
+    snap->size         = 0;
+    snap->pos          = 0;
+    snap->sect_start   = 0;
+    snap->sect_end     = 0;
+    snap->sect_version = 0;
+    snap->error        = 0;
+    snap->num_blocks   = 0;
+
+    if ( snap_grow(snap,SNAP_HEAD_SIZE) == 0 )
+    {
+        memcpy(snap->data,SNAP_MAGIC,8);
+        snap_poke(snap->data+8,SNAP_VERSION,4);
 
-    if ( result != NULL )
+        snap->size = SNAP_HEAD_SIZE;
+    }
+
+    return;
+}
+
+/*
+   Check the header and get ready to read the first section.
+*/
+
+int snap_rewind(snap_data *snap)
+{
+    UINT_32 i;
+
+    snap->pos          = SNAP_HEAD_SIZE;
+    snap->sect_start   = SNAP_HEAD_SIZE;
+    snap->sect_end     = SNAP_HEAD_SIZE;
+    snap->sect_version = 0;
+    snap->error        = 0;
+    snap->num_blocks   = 0;
+
+    for ( i = 0 ; i < SNAP_MAX_BLOCKS ; i++ )
     {
-        result->num_modptrs = num_modptrs;
+        snap->block_base[i] = NULL;
+        snap->block_size[i] = 0;
+    }
 
-        result->num_bus_8bit  = num_bus_8bit;
-        result->num_bus_16bit = num_bus_16bit;
-        result->num_bus_32bit = num_bus_32bit;
+    if ( ( snap->size < SNAP_HEAD_SIZE ) || memcmp(snap->data,SNAP_MAGIC,8) || ( snap_peek(snap->data+8,4) != SNAP_VERSION ) )
+    {
+        snap->error = 1;
 
-        result->num_sig_calls_into_module  = num_sig_calls_into_module;
-        result->num_sig_calls_outof_module = num_sig_calls_outof_module;
+        return 1;
+    }
+
+    return 0;
+}
+
+void snap_begin_section(snap_data *snap, const char *name, UINT_32 version)
+{
+    if ( snap_grow(snap,SNAP_SECT_HEAD_SIZE) == 0 )
+    {
+        memset(snap->data+snap->size,0,SNAP_SECT_HEAD_SIZE);
+        strncpy((char *) (snap->data+snap->size),name,SNAP_NAME_SIZE-1);
+        snap_poke(snap->data+snap->size+SNAP_NAME_SIZE,version,4);
+
+        snap->sect_start   = snap->size;
+        snap->sect_version = version;
+        snap->size        += SNAP_SECT_HEAD_SIZE;
+    }
+
+    return;
+}
 
-        if ( num_modptrs > 0 ) { if ( ( result->modptrs = (module_data **) DEBMALLOC(num_modptrs*sizeof(module_data *)) ) == NULL ) { return NULL; } }
+/*
+   Find the next section.  name must have room for SNAP_NAME_SIZE
+   characters.
+*/
 
-        if ( num_bus_8bit  > 0 ) { if ( ( result->bus_8bit  = (UINT_8  **) DEBMALLOC(num_bus_8bit *sizeof(UINT_8  *)) ) == NULL ) { return NULL; } }
-        if ( num_bus_16bit > 0 ) { if ( ( result->bus_16bit = (UINT_16 **) DEBMALLOC(num_bus_16bit*sizeof(UINT_16 *)) ) == NULL ) { return NULL; } }
-        if ( num_bus_32bit > 0 ) { if ( ( result->bus_32bit = (UINT_32 **) DEBMALLOC(num_bus_32bit*sizeof(UINT_32 *)) ) == NULL ) { return NULL; } }
+int snap_next_section(snap_data *snap, char *name)
+{
+    UINT_32 len;
 
-        if ( num_sig_calls_into_module  > 0 ) { if ( ( result->sig_calls_into_module  = (weird_pointer_jive_wargs *) DEBMALLOC(num_sig_calls_into_module *sizeof(weird_pointer_jive_wargs)) ) == NULL ) { return NULL; } }
-        if ( num_sig_calls_outof_module > 0 ) { if ( ( result->sig_calls_outof_module = (weird_pointer_jive_wargs *) DEBMALLOC(num_sig_calls_outof_module*sizeof(weird_pointer_jive_wargs)) ) == NULL ) { return NULL; } }
-        if ( num_sig_calls_outof_module > 0 ) { if ( ( result->sig_calls_outof_args   = (void **)                    DEBMALLOC(num_sig_calls_outof_module*sizeof(void *                  )) ) == NULL ) { return NULL; } }
+    snap->pos = snap->sect_end;
 
-        if ( num_modptrs > 0 ) { for ( i = 0 ; i < num_modptrs ; i++ ) { DEBDEREF((result->modptrs),i) = NULL; } }
+    if ( snap->pos + SNAP_SECT_HEAD_SIZE > snap->size )
+    {
+        return 1;
+    }
 
-        if ( num_bus_8bit  > 0 ) { for ( i = 0 ; i < num_bus_8bit  ; i++ ) { DEBDEREF((result->bus_8bit),i)  = global_8dummyptr;  } }
-        if ( num_bus_16bit > 0 ) { for ( i = 0 ; i < num_bus_16bit ; i++ ) { DEBDEREF((result->bus_16bit),i) = global_16dummyptr; } }
-        if ( num_bus_32bit > 0 ) { for ( i = 0 ; i < num_bus_32bit ; i++ ) { DEBDEREF((result->bus_32bit),i) = global_32dummyptr; } }
+    len = (UINT_32) snap_peek(snap->data+snap->pos+SNAP_NAME_SIZE+4,4);
 
-        if ( num_sig_calls_outof_module > 0 ) { for ( i = 0 ; i < num_sig_calls_outof_module ; i++ ) { DEBDEREF((result->sig_calls_outof_module),i) = global_nothingfn; } }
-        if ( num_sig_calls_outof_module > 0 ) { for ( i = 0 ; i < num_sig_calls_outof_module ; i++ ) { DEBDEREF((result->sig_calls_outof_args),i)   = NULL;             } }
+    if ( len > snap->size - snap->pos - SNAP_SECT_HEAD_SIZE )
+    {
+        snap->error = 1;
+
+        return 1;
     }
 
-    return result;
+    memcpy(name,snap->data+snap->pos,SNAP_NAME_SIZE);
+    name[SNAP_NAME_SIZE-1] = '\0';
+
+    snap->sect_start   = snap->pos;
+    snap->sect_version = (UINT_32) snap_peek(snap->data+snap->pos+SNAP_NAME_SIZE,4);
+    snap->sect_end     = snap->pos + SNAP_SECT_HEAD_SIZE + len;
+    snap->pos         += SNAP_SECT_HEAD_SIZE;
+
+    return 0;
 }
 
-void global_nothingfn(void *what)
+/*
+   When saving, fills in the length of the section just written.  When
+   loading, skips whatever is left of the section just read.
+*/
+
+void snap_end_section(snap_data *snap)
 {
+    if ( snap->sect_end > snap->sect_start )
+    {
+        snap->pos = snap->sect_end;
+    }
+
+    else if ( snap->sect_start + SNAP_SECT_HEAD_SIZE <= snap->size )
+    {
+        snap_poke(snap->data+snap->sect_start+SNAP_NAME_SIZE+4,snap->size-snap->sect_start-SNAP_SECT_HEAD_SIZE,4);
+    }
+
     return;
+}
 
-    what = NULL;
+static void snap_put(snap_data *snap, UINT_64 val, int len)
+{
+    if ( snap_grow(snap,(UINT_32) len) == 0 )
+    {
+        snap_poke(snap->data+snap->size,val,len);
+
+        snap->size += (UINT_32) len;
+    }
+
+    return;
 }
 
-void free_module_data(module_data *what)
+void snap_put8(snap_data *snap, UINT_8 val)   { snap_put(snap,val,1); return; }
+void snap_put16(snap_data *snap, UINT_16 val) { snap_put(snap,val,2); return; }
+void snap_put32(snap_data *snap, UINT_32 val) { snap_put(snap,val,4); return; }
+void snap_put64(snap_data *snap, UINT_64 val) { snap_put(snap,val,8); return; }
+
+void snap_put_data(snap_data *snap, const void *src, UINT_32 len)
 {
-    if ( what != NULL )
+    if ( snap_grow(snap,len) == 0 )
+    {
+        memcpy(snap->data+snap->size,src,len);
+
+        snap->size += len;
+    }
+
+    return;
+}
+
+static UINT_64 snap_get(snap_data *snap, int len)
+{
+    UINT_64 val;
+
+    if ( snap->pos + (UINT_32) len > snap->sect_end )
     {
-        if ( what->var_8bit  != NULL ) { DEBFREE(what->var_8bit);  }
-        if ( what->var_16bit != NULL ) { DEBFREE(what->var_16bit); }
-        if ( what->var_32bit != NULL ) { DEBFREE(what->var_32bit); }
+        snap->error = 1;
+
+        return 0;
+    }
+
+    val = snap_peek(snap->data+snap->pos,len);
+
+    snap->pos += (UINT_32) len;
+
+    return val;
+}
 
-        if ( what->stringvars != NULL ) { DEBFREE(what->stringvars); }
+UINT_8  snap_get8(snap_data *snap)  { return (UINT_8)  snap_get(snap,1); }
+UINT_16 snap_get16(snap_data *snap) { return (UINT_16) snap_get(snap,2); }
+UINT_32 snap_get32(snap_data *snap) { return (UINT_32) snap_get(snap,4); }
+UINT_64 snap_get64(snap_data *snap) { return (UINT_64) snap_get(snap,8); }
 
-        if ( what->modptrs != NULL ) { DEBFREE(what->modptrs); }
+void snap_get_data(snap_data *snap, void *dest, UINT_32 len)
+{
+    if ( ( len > snap->sect_end ) || ( snap->pos > snap->sect_end - len ) )
+    {
+        snap->error = 1;
 
-        if ( what->bus_8bit  != NULL ) { DEBFREE(what->bus_8bit);  }
-        if ( what->bus_16bit != NULL ) { DEBFREE(what->bus_16bit); }
-        if ( what->bus_32bit != NULL ) { DEBFREE(what->bus_32bit); }
+        memset(dest,0,len);
 
-        if ( what->sig_calls_into_module  != NULL ) { DEBFREE(what->sig_calls_into_module);  }
-        if ( what->sig_calls_outof_module != NULL ) { DEBFREE(what->sig_calls_outof_module); }
-        if ( what->sig_calls_outof_args   != NULL ) { DEBFREE(what->sig_calls_outof_args);   }
+        return;
     }
 
+    memcpy(dest,snap->data+snap->pos,len);
+
+    snap->pos += len;
+
     return;
 }
 
+UINT_32 snap_add_block(snap_data *snap, UINT_8 *base, UINT_32 size)
+{
+    if ( snap->num_blocks >= SNAP_MAX_BLOCKS )
+    {
+        snap->error = 1;
+
+        return SNAP_BLOCK_NULL;
+    }
+
+    snap->block_base[snap->num_blocks] = base;
+    snap->block_size[snap->num_blocks] = size;
+
+    return (snap->num_blocks)++;
+}
+
+void snap_set_block(snap_data *snap, UINT_32 num, UINT_8 *base, UINT_32 size)
+{
+    if ( num >= SNAP_MAX_BLOCKS )
+    {
+        snap->error = 1;
+
+        return;
+    }
+
+    snap->block_base[num] = base;
+    snap->block_size[num] = size;
+
+    return;
+}
+
+void snap_put_ptr(snap_data *snap, const void *ptr)
+{
+    const UINT_8 *p = (const UINT_8 *) ptr;
+    UINT_32 i;
+
+    if ( p != NULL )
+    {
+        for ( i = 0 ; i < snap->num_blocks ; i++ )
+        {
+            if ( ( p >= snap->block_base[i] ) && ( p < snap->block_base[i] + snap->block_size[i] ) )
+            {
+                snap_put32(snap,i);
+                snap_put32(snap,(UINT_32) ( p - snap->block_base[i] ));
+
+                return;
+            }
+        }
+
+        snap->error = 1;
+    }
+
+    snap_put32(snap,SNAP_BLOCK_NULL);
+    snap_put32(snap,0);
+
+    return;
+}
+
+UINT_8 *snap_get_ptr(snap_data *snap)
+{
+    UINT_32 num;
+    UINT_32 offset;
+
+    num    = snap_get32(snap);
+    offset = snap_get32(snap);
+
+    if ( num == SNAP_BLOCK_NULL )
+    {
+        return NULL;
+    }
+
+    if ( ( num >= SNAP_MAX_BLOCKS ) || ( snap->block_base[num] == NULL ) || ( offset >= snap->block_size[num] ) )
+    {
+        snap->error = 1;
+
+        return NULL;
+    }
+
+    return snap->block_base[num] + offset;
+}
+
+int snap_write_file(snap_data *snap, const char *filename)
+{
+    FILE *fp;
+    int result = 0;
+
+    if ( ( fp = fopen(filename,"wb") ) == NULL )
+    {
+        return 1;
+    }
+
+    if ( fwrite(snap->data,1,snap->size,fp) != snap->size )
+    {
+        result = 1;
+    }
+
+    if ( fclose(fp) )
+    {
+        result = 1;
+    }
+
+    return result;
+}
+
+int snap_read_file(snap_data *snap, const char *filename)
+{
+    FILE *fp;
+    long len;
+    int result = 1;
+
+    if ( ( fp = fopen(filename,"rb") ) == NULL )
+    {
+        return 1;
+    }
+
+    if ( !fseek(fp,0,SEEK_END) && ( ( len = ftell(fp) ) >= SNAP_HEAD_SIZE ) && !fseek(fp,0,SEEK_SET) )
+    {
+        snap->size = 0;
+
+        if ( snap_grow(snap,(UINT_32) len) == 0 )
+        {
+            if ( fread(snap->data,1,(size_t) len,fp) == (size_t) len )
+            {
+                snap->size = (UINT_32) len;
+
+                result = snap_rewind(snap);
+            }
+        }
+    }
+
+    fclose(fp);
+
+    return result;
+}
+
+/*
+   Snapshot rings (see modules.h).
+*/
+
+snap_ring *snap_ring_alloc(UINT_32 max_entries, UINT_32 max_bytes)
+{
+    snap_ring *ring;
+
+    if ( max_entries == 0 )
+    {
+        return NULL;
+    }
+
+    if ( ( ring = (snap_ring *) DEBMALLOC(sizeof(snap_ring)) ) == NULL )
+    {
+        return NULL;
+    }
+
+    if ( ( ring->entry = (snap_ring_entry *) DEBMALLOC(max_entries*sizeof(snap_ring_entry)) ) == NULL )
+    {
+        DEBFREE(ring);
+
+        return NULL;
+    }
+
+    ring->max_entries  = max_entries;
+    ring->max_bytes    = max_bytes;
+    ring->first        = 0;
+    ring->num          = 0;
+    ring->bytes        = 0;
+    ring->newest       = NULL;
+    ring->newest_size  = 0;
+    ring->newest_alloc = 0;
+    ring->work         = NULL;
+    ring->work_alloc   = 0;
+
+    return ring;
+}
+
+void snap_ring_free(snap_ring *ring)
+{
+    if ( ring != NULL )
+    {
+        snap_ring_clear(ring);
+
+        if ( ring->newest != NULL )
+        {
+            DEBFREE(ring->newest);
+        }
+
+        if ( ring->work != NULL )
+        {
+            DEBFREE(ring->work);
+        }
+
+        DEBFREE(ring->entry);
+        DEBFREE(ring);
+    }
+
+    return;
+}
+
+/*
+   Throw away the oldest difference.
+*/
+
+static void snap_ring_drop(snap_ring *ring)
+{
+    snap_ring_entry *entry;
+
+    entry = &((ring->entry)[ring->first]);
+
+    ring->bytes -= entry->delta_size;
+
+    DEBFREE(entry->delta);
+
+    ring->first = ( ring->first + 1 ) % ring->max_entries;
+    ring->num--;
+
+    return;
+}
+
+void snap_ring_clear(snap_ring *ring)
+{
+    while ( ring->num > 0 )
+    {
+        snap_ring_drop(ring);
+    }
+
+    ring->first       = 0;
+    ring->newest_size = 0;
+
+    return;
+}
+
+/*
+   Make sure *buf has room for size bytes, keeping the first keep bytes.
+*/
+
+static int snap_ring_reserve(UINT_8 **buf, UINT_32 *alloc, UINT_32 size, UINT_32 keep)
+{
+    UINT_8 *data;
+
+    if ( size <= *alloc )
+    {
+        return 0;
+    }
+
+    if ( ( data = (UINT_8 *) DEBMALLOC(size) ) == NULL )
+    {
+        return 1;
+    }
+
+    if ( *buf != NULL )
+    {
+        memcpy(data,*buf,keep);
+
+        DEBFREE(*buf);
+    }
+
+    *buf   = data;
+    *alloc = size;
+
+    return 0;
+}
+
+/*
+   Encode (older XOR newer) over the length of older, with newer taken as
+   zero past its end, into ring->work.  Returns the encoded length.
+*/
+
+#define SNAP_RING_DIFF(i)   ( older[i] ^ ( ( (i) < newer_size ) ? newer[i] : 0 ) )
+
+static UINT_32 snap_ring_encode(snap_ring *ring, const UINT_8 *older, UINT_32 older_size, const UINT_8 *newer, UINT_32 newer_size)
+{
+    UINT_8 *out;
+    UINT_32 i,j,k,zeros;
+
+    out = ring->work;
+    i   = 0;
+
+    while ( i < older_size )
+    {
+        /*
+           Zeros to skip, then bytes up to the next run of at least
+           SNAP_RING_MIN_RUN zeros.
+        */
+
+        for ( j = i ; ( j < older_size ) && ( j-i < SNAP_RING_MAX_RUN ) && !SNAP_RING_DIFF(j) ; j++ )
+        {
+            ;
+        }
+
+        zeros = j-i;
+        i     = j;
+
+        for ( ; ( j < older_size ) && ( j-i < SNAP_RING_MAX_RUN ) ; j++ )
+        {
+            if ( !SNAP_RING_DIFF(j) )
+            {
+                for ( k = j ; ( k < older_size ) && ( k-j < SNAP_RING_MIN_RUN ) && !SNAP_RING_DIFF(k) ; k++ )
+                {
+                    ;
+                }
+
+                if ( ( k == older_size ) || ( k-j == SNAP_RING_MIN_RUN ) )
+                {
+                    break;
+                }
+            }
+        }
+
+        snap_poke(out,zeros,2);
+        snap_poke(out+2,j-i,2);
+
+        out += 4;
+
+        for ( ; i < j ; i++ )
+        {
+            *out++ = SNAP_RING_DIFF(i);
+        }
+    }
+
+    return (UINT_32) ( out - ring->work );
+}
+
+int snap_ring_push(snap_ring *ring, snap_data *snap)
+{
+    snap_ring_entry *entry;
+    UINT_32 worst;
+    UINT_32 len;
+
+    if ( snap->error )
+    {
+        return 1;
+    }
+
+    if ( ( ring->newest_size > 0 ) && ( ring->max_entries > 1 ) )
+    {
+        /*
+           Keep the newest snapshot as the difference from this one.  The
+           encoding is never more than 4 bytes in SNAP_RING_MIN_RUN longer
+           than it would be as it stands, and far less in practice.
+        */
+
+        worst = ring->newest_size + 4*( ring->newest_size/SNAP_RING_MIN_RUN + 1 );
+
+        if ( snap_ring_reserve(&(ring->work),&(ring->work_alloc),worst,0) )
+        {
+            return 1;
+        }
+
+        len = snap_ring_encode(ring,ring->newest,ring->newest_size,snap->data,snap->size);
+
+        if ( ring->num + 1 == ring->max_entries )
+        {
+            snap_ring_drop(ring);
+        }
+
+        entry = &((ring->entry)[( ring->first + ring->num ) % ring->max_entries]);
+
+        if ( ( entry->delta = (UINT_8 *) DEBMALLOC(len ? len : 1) ) == NULL )
+        {
+            return 1;
+        }
+
+        memcpy(entry->delta,ring->work,len);
+
+        entry->delta_size = len;
+        entry->size       = ring->newest_size;
+
+        ring->bytes += len;
+        ring->num++;
+    }
+
+    if ( snap_ring_reserve(&(ring->newest),&(ring->newest_alloc),snap->size,0) )
+    {
+        ring->newest_size = 0;
+
+        return 1;
+    }
+
+    memcpy(ring->newest,snap->data,snap->size);
+
+    ring->newest_size = snap->size;
+
+    while ( ( ring->num > 0 ) && ( ring->bytes + ring->newest_size > ring->max_bytes ) )
+    {
+        snap_ring_drop(ring);
+    }
+
+    return 0;
+}
+
+int snap_ring_back(snap_ring *ring, snap_data *snap, UINT_32 count)
+{
+    snap_ring_entry *entry;
+    UINT_8 *in;
+    UINT_8 *end;
+    UINT_8 *dest;
+    UINT_32 zeros,len;
+
+    if ( ring->newest_size == 0 )
+    {
+        return 1;
+    }
+
+    while ( ( count > 0 ) && ( ring->num > 0 ) )
+    {
+        entry = &((ring->entry)[( ring->first + ring->num - 1 ) % ring->max_entries]);
+
+        if ( snap_ring_reserve(&(ring->newest),&(ring->newest_alloc),entry->size,ring->newest_size) )
+        {
+            return 1;
+        }
+
+        if ( entry->size > ring->newest_size )
+        {
+            memset(ring->newest+ring->newest_size,0,entry->size-ring->newest_size);
+        }
+
+        in   = entry->delta;
+        end  = entry->delta + entry->delta_size;
+        dest = ring->newest;
+
+        while ( in < end )
+        {
+            zeros = (UINT_32) snap_peek(in,2);
+            len   = (UINT_32) snap_peek(in+2,2);
+
+            in   += 4;
+            dest += zeros;
+
+            while ( len-- )
+            {
+                *dest++ ^= *in++;
+            }
+        }
+
+        ring->newest_size = entry->size;
+        ring->bytes      -= entry->delta_size;
+        ring->num--;
+
+        DEBFREE(entry->delta);
+
+        count--;
+    }
+
+    snap->size = 0;
+
+    if ( snap_grow(snap,ring->newest_size) )
+    {
+        return 1;
+    }
+
+    memcpy(snap->data,ring->newest,ring->newest_size);
+
+    snap->size = ring->newest_size;
+
+    return snap_rewind(snap);
+}
+
+/*
+   Number of snapshots in the ring.
+*/
+
+UINT_32 snap_ring_count(snap_ring *ring)
+{
+    return ( ring->newest_size > 0 ) ? ring->num + 1 : 0;
+}
@@ -50,6 +50,16 @@
    Finally, modname_getinf will return a string containing details of the
    module state in ascii form, for display/debugging purposes.
 
+   Modules that hold machine state (as opposed to wiring) may also provide:
+
+   int modname_serialise(module_data *what, snap_data *snap);
+   int modname_deserialise(module_data *what, snap_data *snap);
+
+   which write the state of the module into the body of the current section
+   of a snapshot, and read it back again (see "Snapshots" below).  Both
+   return 0 on success.  The caller starts and ends the section, so the
+   module only deals with its own fields.
+
 */
 
 
@@ -74,15 +84,11 @@ typedef struct Module_Data
        variables: num_var_*bit, num_bus_*bit, 
        num_sig_calls_into_module and num_sig_calls_outof_module.  All of
        these counts will be provided by the module initialiser.
-    */
 
-    UINT_8  *var_8bit;
-    UINT_16 *var_16bit;
-    UINT_32 *var_32bit;
-
-    char **stringvars;
-
-    struct Module_Data **modptrs;
+       The struct and its arrays are allocated by gen_module_data (see
+       "Module memory" below).  The buses and functions, which are used
+       every time the module does anything, come first.
+    */
 
     VOLATILITY UINT_8  **bus_8bit;
     VOLATILITY UINT_16 **bus_16bit;
@@ -92,6 +98,14 @@ typedef struct Module_Data
     weird_pointer_jive_wargs  *sig_calls_outof_module;
     void                     **sig_calls_outof_args;
 
+    UINT_8  *var_8bit;
+    UINT_16 *var_16bit;
+    UINT_32 *var_32bit;
+
+    char **stringvars;
+
+    struct Module_Data **modptrs;
+
     UINT_64 num_var_8bit;
     UINT_64 num_var_16bit;
     UINT_64 num_var_32bit;
@@ -131,10 +145,51 @@ typedef struct Module_Data
     */
 
     void *internal_data;
+
+    /*
+       Memory blocks holding the struct and its arrays (see "Module
+       memory").  bus_block is NULL unless the module was made using
+       gen_module_data_varonly.
+    */
+
+    void *block;
+    void *bus_block;
 }
 module_data;
 
 
+/*
+
+Module memory
+=============
+
+gen_module_data allocates a module in one block, aligned to MODULE_ALIGN
+bytes (a cache line on current hosts), laid out as:
+
+   module_data
+   bus_8bit, bus_16bit, bus_32bit
+   sig_calls_into_module, sig_calls_outof_module, sig_calls_outof_args
+   modptrs, stringvars
+   var_32bit, var_16bit, var_8bit
+
+so that the pointers a module follows to get at its buses and functions
+sit together, right after the struct, rather than wherever the heap put
+them.  free_module_data frees the lot in one go, so the arrays must never
+be freed or replaced individually.  Cache misses haven't been measured
+before and after this layout, and turbo mode timings showed no change
+either way.
+
+Modules whose bus and function counts depend on their variables are made
+with gen_module_data_varonly (the struct and the variables) and then
+gen_module_data_nonvaronly (the rest) once the variables are set.  These
+get a second block for the buses, functions and module pointers, laid out
+as above.
+
+*/
+
+#define MODULE_ALIGN            64
+
+
 module_data *gen_module_data(const char *module_name,
                              int is_mod_clocked,
                              UINT_64 num_var_8bit,
@@ -197,4 +252,199 @@ void free_module_data(module_data *what);
 #define DEREF_MODNAME(what)     (((module_data *) (what))->module_name)
 #define DEREF_INTERNAL(what)    (((module_data *) (what))->internal_data)
 
+
+/*
+
+                               Snapshots
+                               =========
+
+A snapshot is the state of a running machine, held in memory as a single
+block of bytes (a snap_data), which can be written to and read from a file
+as it stands.  The layout is:
+
+header:  0  magic (SNAP_MAGIC, 8 bytes)
+         8  format version (SNAP_VERSION, 4 bytes)
+
+followed by any number of sections, each of which is:
+
+         0  section name (SNAP_NAME_SIZE bytes, padded with zeros)
+        16  section version (4 bytes)
+        20  body length (4 bytes)
+        24  body
+
+All numbers are little-endian whatever the host.  Each section holds the
+state of one module, written by its modname_serialise function and read by
+its modname_deserialise function.  The section version belongs to the
+module: when a module gains new fields it appends them to the end of its
+body and bumps its version, and its deserialise function only reads the
+new fields if snap->sect_version says they are there.  Reading past the
+end of a body gives zeros and sets snap->error, and whatever is left of a
+body when deserialise returns is skipped, so older code can read newer
+snapshots (it just misses the new bits).  Sections the reader doesn't know
+are skipped altogether, so new devices can simply add sections.
+
+Saving goes:
+
+   snap_clear(snap);
+   snap_begin_section(snap,name,version);
+   modname_serialise(module,snap);
+   snap_end_section(snap);
+   ...
+   snap_write_file(snap,filename);   (if it's to go to a file)
+
+and loading:
+
+   snap_read_file(snap,filename);    (if it's from a file)
+   snap_rewind(snap);
+   while ( snap_next_section(snap,name) == 0 )
+   {
+       modname_deserialise(module,snap);  (module found from name)
+       snap_end_section(snap);
+   }
+
+snap_rewind and snap_read_file return nonzero if the header is wrong (or
+the file can't be read), snap_next_section returns nonzero when there are
+no more sections.  snap->error is set (and stays set) if anything goes
+wrong along the way: a short body, a bad pointer, running out of memory
+and so on.
+
+The buffer is kept between snapshots, so taking one snapshot after
+another doesn't go back to malloc once the buffer has grown to size.
+
+Pointers: modules that have pointers into memory belonging to other
+modules (such as the z80 page tables, which point into memmod content)
+can't save them as they stand.  Instead, modules that own memory register
+it with snap_add_block while saving (which returns the block number, to be
+saved with the memory) and snap_set_block while loading (with the block
+number read back), and the pointers are saved with snap_put_ptr, which
+writes the block number and offset, and read with snap_get_ptr, which
+turns them back into a pointer.  Blocks must therefore come before any
+section that points into them.  NULL is saved as such.  A pointer that
+isn't in any registered block sets snap->error when saved.
+
+*/
+
+#define SNAP_MAGIC              "MBEESNAP"
+#define SNAP_VERSION            1
+#define SNAP_HEAD_SIZE          12
+#define SNAP_NAME_SIZE          16
+#define SNAP_SECT_HEAD_SIZE     24
+#define SNAP_MAX_BLOCKS         32
+#define SNAP_BLOCK_NULL         0x0ffffffff
+
+typedef struct
+{
+    UINT_8  *data;
+    UINT_32  size;
+    UINT_32  alloc;
+    UINT_32  pos;
+
+    UINT_32  sect_start;
+    UINT_32  sect_end;
+    UINT_32  sect_version;
+
+    int      error;
+
+    UINT_32  num_blocks;
+    UINT_8  *block_base[SNAP_MAX_BLOCKS];
+    UINT_32  block_size[SNAP_MAX_BLOCKS];
+}
+snap_data;
+
+snap_data *snap_alloc(void);
+void       snap_free(snap_data *snap);
+void       snap_clear(snap_data *snap);
+int        snap_rewind(snap_data *snap);
+
+void       snap_begin_section(snap_data *snap, const char *name, UINT_32 version);
+int        snap_next_section(snap_data *snap, char *name);
+void       snap_end_section(snap_data *snap);
+
+void       snap_put8(snap_data *snap, UINT_8 val);
+void       snap_put16(snap_data *snap, UINT_16 val);
+void       snap_put32(snap_data *snap, UINT_32 val);
+void       snap_put64(snap_data *snap, UINT_64 val);
+void       snap_put_data(snap_data *snap, const void *src, UINT_32 len);
+void       snap_put_ptr(snap_data *snap, const void *ptr);
+
+UINT_8     snap_get8(snap_data *snap);
+UINT_16    snap_get16(snap_data *snap);
+UINT_32    snap_get32(snap_data *snap);
+UINT_64    snap_get64(snap_data *snap);
+void       snap_get_data(snap_data *snap, void *dest, UINT_32 len);
+UINT_8    *snap_get_ptr(snap_data *snap);
+
+UINT_32    snap_add_block(snap_data *snap, UINT_8 *base, UINT_32 size);
+void       snap_set_block(snap_data *snap, UINT_32 num, UINT_8 *base, UINT_32 size);
+
+int        snap_write_file(snap_data *snap, const char *filename);
+int        snap_read_file(snap_data *snap, const char *filename);
+
+/*
+
+Snapshot rings
+==============
+
+A snapshot ring keeps a run of snapshots (as taken above) so that the
+machine can be wound back.  The newest snapshot is kept whole, and each
+older one is kept only as the difference from the one after it: the two
+are XORed together (so everything that hasn't changed, which is nearly
+all of memory, comes out as zero) and the result is run length encoded as
+a list of
+
+   UINT_16  number of zero bytes to skip
+   UINT_16  number of bytes that follow
+   UINT_8   bytes to XOR in
+
+Runs of fewer than SNAP_RING_MIN_RUN zeros are left in with the bytes that
+follow, as it takes as many bytes to skip them.  A snapshot is wound back
+by XORing the differences into the newest one, one after another, so
+winding back n snapshots costs n passes over what has changed rather than
+anything proportional to the size of memory.
+
+snap_ring_alloc takes the most snapshots (max_entries) and bytes
+(max_bytes) the ring may hold.  When snap_ring_push adds a snapshot that
+would take the ring past either, the oldest are thrown away.
+snap_ring_back goes back count snapshots (or as far as it can), throws
+away the newer ones and puts the snapshot reached into snap, ready to be
+read (snap_rewind has been called).  Both return 0 on success.
+
+*/
+
+#define SNAP_RING_MIN_RUN       4
+#define SNAP_RING_MAX_RUN       0x0ffff
+
+typedef struct
+{
+    UINT_8  *delta;
+    UINT_32  delta_size;
+    UINT_32  size;
+}
+snap_ring_entry;
+
+typedef struct
+{
+    snap_ring_entry *entry;
+    UINT_32          max_entries;
+    UINT_32          max_bytes;
+    UINT_32          first;
+    UINT_32          num;
+    UINT_32          bytes;
+
+    UINT_8          *newest;
+    UINT_32          newest_size;
+    UINT_32          newest_alloc;
+
+    UINT_8          *work;
+    UINT_32          work_alloc;
+}
+snap_ring;
+
+snap_ring *snap_ring_alloc(UINT_32 max_entries, UINT_32 max_bytes);
+void       snap_ring_free(snap_ring *ring);
+void       snap_ring_clear(snap_ring *ring);
+int        snap_ring_push(snap_ring *ring, snap_data *snap);
+int        snap_ring_back(snap_ring *ring, snap_data *snap, UINT_32 count);
+UINT_32    snap_ring_count(snap_ring *ring);
+
 #endif
@@ -0,0 +1,462 @@
+/*
+
+                        Z80 Core Throughput Benchmark
+                        =============================
+
+Runs the z80 core (through the z80cpu module) on a flat 64K of directly
+mapped memory with no peripherals and reports how fast it goes.  This
+measures the core alone: there is no video, keyboard or throttling, and
+no indirect memory access.
+
+Usage: z80bench [-nodcache] [-instances n] [-trace n] [tstates [romfile [org [entry]]]]
+
+-nodcache - run with the pre-decoded instruction cache off (it is on by
+          default, as in the emulator).
+-instances n - run n independent cpus, each with its own copy of memory
+          (default 1).  The cpus take turns a slice at a time, or if
+          z80bench.c is compiled with Z80BENCH_THREADS (and linked with
+          -lpthread) each runs flat out on a thread of its own.  As the
+          cores share no state every cpu must end with the same checksum,
+          which is checked.  Figures are totals over all of the cpus.
+-trace n - keep a trace of the last n instructions, and write that of
+          the first cpu to z80trace.bin at the end (see z80cpu.h).  Only
+          if compiled with Z80_TRACE, ignored otherwise.
+tstates - number of z80 T-states to run (default 100000000).
+romfile - binary to load instead of the built-in workload.
+org     - load address (hex, default 0).
+entry   - start address (hex, default org).  A JP to the entry point is
+          put at address 0 if the binary is loaded above 0x0002.
+
+If compiled with Z80_PROFILE (along with z80cpu.c and z80core.c) the
+profile of the first cpu is printed and written to z80ops.csv and
+z80mem.csv (see z80cpu.h).
+
+The built-in workload is a loop of block moves, ALU, CB and indexed ops,
+calls, pushes and pops, which is roughly the mix seen in the Microbee ROMs.
+
+Reported figures are emulated MHz (T-states per host second), steps per
+second (a step is a call to z80_cycle: an instruction, interupt
+acknowledge or HALT cycle, a bulk run of LDIR/LDDR/CPIR/CPDR iterations,
+or with the block translator in z80jit.c a run of translated code) and a
+checksum of memory at the end of the run, which should be identical for
+any two cores given the same T-state count.  The core is run in slices of
+0x1000 T-states, exactly as z80cpu_cycle does.
+
+Built with Z80_ASM_CORE (and linked with the nasm object) this runs
+z80cpu.asm instead.  That hasn't been done yet, as it needs nasm and a
+32-bit toolchain, so how the C core compares with the asm core in
+emulated MHz is unmeasured.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "u_dtype.h"
+#include "modules.h"
+#include "debmaloc.h"
+#include "z80cpu.h"
+#include "z80core.h"
+
+#ifdef Z80BENCH_THREADS
+#include <pthread.h>
+#endif
+
+
+
+#define BENCH_DEFAULT_TSTATES   100000000L
+#define BENCH_MAX_INSTANCES     256
+#define BENCH_SLICE             0x01000
+
+/*
+   Built-in workload (see above).
+*/
+
+UINT_8 bench_workload[] = {
+    0x031, 0x000, 0x0f0,            /* 0000       LD   SP,0F000h  */
+    0x0dd, 0x021, 0x000, 0x070,     /* 0003       LD   IX,7000h   */
+    0x021, 0x000, 0x040,            /* 0007 outer LD   HL,4000h   */
+    0x011, 0x000, 0x050,            /* 000A       LD   DE,5000h   */
+    0x001, 0x000, 0x001,            /* 000D       LD   BC,0100h   */
+    0x0ed, 0x0b0,                   /* 0010       LDIR            */
+    0x006, 0x000,                   /* 0012       LD   B,0        */
+    0x0af,                          /* 0014       XOR  A          */
+    0x080,                          /* 0015 inner ADD  A,B        */
+    0x04f,                          /* 0016       LD   C,A        */
+    0x0cb, 0x001,                   /* 0017       RLC  C          */
+    0x0dd, 0x071, 0x005,            /* 0019       LD   (IX+5),C   */
+    0x0dd, 0x034, 0x005,            /* 001C       INC  (IX+5)     */
+    0x0cd, 0x029, 0x000,            /* 001F       CALL sub        */
+    0x0f5,                          /* 0022       PUSH AF         */
+    0x0d1,                          /* 0023       POP  DE         */
+    0x010, 0x0ef,                   /* 0024       DJNZ inner      */
+    0x0c3, 0x007, 0x000,            /* 0026       JP   outer      */
+    0x0e5,                          /* 0029 sub   PUSH HL         */
+    0x026, 0x060,                   /* 002A       LD   H,60h      */
+    0x06b,                          /* 002C       LD   L,E        */
+    0x077,                          /* 002D       LD   (HL),A     */
+    0x023,                          /* 002E       INC  HL         */
+    0x009,                          /* 002F       ADD  HL,BC      */
+    0x0e6, 0x07f,                   /* 0030       AND  7Fh        */
+    0x0e1,                          /* 0032       POP  HL         */
+    0x0c9                           /* 0033       RET             */
+};
+
+/*
+   One cpu and its memory.
+*/
+
+typedef struct
+{
+    module_data *cpu;
+    z80_block *block;
+    UINT_8 *mem;
+    double tstates;
+    double steps;
+    double tstates_max;
+}
+bench_inst;
+
+UINT_8  bench_tab_start = 0x000;
+UINT_8  bench_tab_end   = 0x0ff;
+UINT_16 bench_tab_wait  = 0;
+
+/*
+   Set up a cpu with all of memory directly mapped and no waits.  Returns
+   0 on success.
+*/
+
+int bench_setup(bench_inst *b, const UINT_8 *image, int dcache_on, double tstates_max)
+{
+    if ( ( b->mem = (UINT_8 *) DEBMALLOC(0x010000) ) == NULL )
+    {
+        printf("Unable to allocate memory.\n");
+
+        return 1;
+    }
+
+    memcpy(b->mem,image,0x010000);
+
+    if ( ( b->cpu = z80cpu_alloc("z80bench") ) == NULL )
+    {
+        printf("Unable to allocate cpu.\n");
+
+        return 1;
+    }
+
+    if ( z80cpu_init(b->cpu) )
+    {
+        printf("Unable to initialise cpu.\n");
+
+        return 1;
+    }
+
+    DEREF_8MEM(b->cpu,3)  = &bench_tab_start;
+    DEREF_8MEM(b->cpu,4)  = &bench_tab_end;
+    DEREF_8MEM(b->cpu,5)  = b->mem;
+    DEREF_16MEM(b->cpu,1) = &bench_tab_wait;
+    DEREF_16MEM(b->cpu,2) = &bench_tab_wait;
+
+    z80cpu_go(b->cpu);
+
+    (DEREF_INFN(b->cpu,7))((void *) b->cpu);
+    (DEREF_INFN(b->cpu,10))((void *) b->cpu);
+    (DEREF_INFN(b->cpu,13))((void *) b->cpu);
+
+    if ( dcache_on ) { (DEREF_INFN(b->cpu,24))((void *) b->cpu); }
+    else             { (DEREF_INFN(b->cpu,25))((void *) b->cpu); }
+
+    b->block       = (z80_block *) DEREF_INTERNAL(b->cpu);
+    b->tstates     = 0;
+    b->steps       = 0;
+    b->tstates_max = tstates_max;
+
+    return 0;
+}
+
+/*
+   Run one slice.  This is the z80cpu_cycle loop, but counting steps as
+   well.
+*/
+
+void bench_slice(bench_inst *b)
+{
+    z80_block *block = b->block;
+
+    block->clk_count += BENCH_SLICE;
+    block->clk        = 0;
+
+    while ( block->clk_count > Z80_CLK_COUNT_BASE )
+    {
+        z80_cycle((void *) block);
+
+        b->steps   += 1;
+        b->tstates += block->clk;
+
+        block->clk_count -= block->clk;
+        block->clk        = 0;
+    }
+
+    return;
+}
+
+#ifdef Z80BENCH_THREADS
+void *bench_thread(void *arg)
+{
+    bench_inst *b = (bench_inst *) arg;
+
+    while ( b->tstates < b->tstates_max )
+    {
+        bench_slice(b);
+    }
+
+    return NULL;
+}
+#endif
+
+unsigned long bench_checksum(const UINT_8 *mem)
+{
+    unsigned long checksum = 0;
+    long i;
+
+    for ( i = 0 ; i < 0x010000 ; i++ )
+    {
+        checksum = ( ( checksum << 1 ) | ( ( checksum >> 31 ) & 1 ) ) ^ mem[i];
+        checksum &= 0x0ffffffffL;
+    }
+
+    return checksum;
+}
+
+int main(int argc, char *argv[])
+{
+    bench_inst *inst;
+    UINT_8 *image;
+    unsigned long org   = 0;
+    unsigned long entry = 0;
+    double tstates_max = BENCH_DEFAULT_TSTATES;
+    double tstates = 0;
+    double steps = 0;
+    double host_secs;
+    unsigned long checksum = 0;
+    FILE *romfile;
+    UINT_32 trace_depth = 0;
+    int dcache_on = 1;
+    int num_inst = 1;
+    int mismatch = 0;
+    int n;
+    #ifdef Z80_PROFILE
+    char *report;
+    #endif
+    #ifdef Z80BENCH_THREADS
+    pthread_t thread[BENCH_MAX_INSTANCES];
+    struct timespec wall_start;
+    struct timespec wall_end;
+    #endif
+    #ifndef Z80BENCH_THREADS
+    clock_t start;
+    int running;
+    #endif
+
+    if ( ( argc > 1 ) && !strcmp(argv[1],"-nodcache") )
+    {
+        dcache_on = 0;
+
+        argc--;
+        argv++;
+    }
+
+    if ( ( argc > 2 ) && !strcmp(argv[1],"-instances") )
+    {
+        num_inst = atoi(argv[2]);
+
+        if ( ( num_inst < 1 ) || ( num_inst > BENCH_MAX_INSTANCES ) )
+        {
+            printf("Number of instances must be 1 to %d.\n",BENCH_MAX_INSTANCES);
+
+            return 1;
+        }
+
+        argc -= 2;
+        argv += 2;
+    }
+
+    if ( ( argc > 2 ) && !strcmp(argv[1],"-trace") )
+    {
+        trace_depth = strtoul(argv[2],NULL,10);
+
+        argc -= 2;
+        argv += 2;
+    }
+
+    if ( argc > 1 )
+    {
+        tstates_max = atof(argv[1]);
+    }
+
+    if ( ( image = (UINT_8 *) DEBMALLOC(0x010000) ) == NULL )
+    {
+        printf("Unable to allocate memory.\n");
+
+        return 1;
+    }
+
+    memset(image,0,0x010000);
+
+    if ( argc > 2 )
+    {
+        if ( argc > 3 ) { org   = strtoul(argv[3],NULL,16) & 0x0ffff; }
+        entry = org;
+        if ( argc > 4 ) { entry = strtoul(argv[4],NULL,16) & 0x0ffff; }
+
+        if ( ( romfile = fopen(argv[2],"rb") ) == NULL )
+        {
+            printf("Unable to open %s.\n",argv[2]);
+
+            return 1;
+        }
+
+        fread(image+org,1,0x010000-org,romfile);
+        fclose(romfile);
+
+        if ( org > 0x002 )
+        {
+            image[0] = 0x0c3;
+            image[1] = (UINT_8) entry;
+            image[2] = (UINT_8) ( entry >> 8 );
+        }
+    }
+
+    else
+    {
+        memcpy(image,bench_workload,sizeof(bench_workload));
+    }
+
+    if ( ( inst = (bench_inst *) DEBMALLOC(num_inst*sizeof(bench_inst)) ) == NULL )
+    {
+        printf("Unable to allocate memory.\n");
+
+        return 1;
+    }
+
+    for ( n = 0 ; n < num_inst ; n++ )
+    {
+        if ( bench_setup(&inst[n],image,dcache_on,tstates_max) )
+        {
+            return 1;
+        }
+
+        z80cpu_set_trace(inst[n].cpu,trace_depth);
+    }
+
+    /*
+       Run.  clock() counts the cpu time of every thread, so threaded runs
+       are timed by the wall clock instead.
+    */
+
+    #ifdef Z80BENCH_THREADS
+    clock_gettime(CLOCK_MONOTONIC,&wall_start);
+
+    for ( n = 0 ; n < num_inst ; n++ )
+    {
+        pthread_create(&thread[n],NULL,bench_thread,(void *) &inst[n]);
+    }
+
+    for ( n = 0 ; n < num_inst ; n++ )
+    {
+        pthread_join(thread[n],NULL);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC,&wall_end);
+
+    host_secs = ( (double) ( wall_end.tv_sec  - wall_start.tv_sec  ) )
+              + ( (double) ( wall_end.tv_nsec - wall_start.tv_nsec ) ) / 1000000000.0;
+    #endif
+
+    #ifndef Z80BENCH_THREADS
+    start = clock();
+
+    do
+    {
+        running = 0;
+
+        for ( n = 0 ; n < num_inst ; n++ )
+        {
+            if ( inst[n].tstates < tstates_max )
+            {
+                bench_slice(&inst[n]);
+
+                running = 1;
+            }
+        }
+    }
+    while ( running );
+
+    host_secs = ( (double) ( clock() - start ) ) / CLOCKS_PER_SEC;
+    #endif
+
+    if ( host_secs <= 0 )
+    {
+        host_secs = 1.0 / CLOCKS_PER_SEC;
+    }
+
+    for ( n = 0 ; n < num_inst ; n++ )
+    {
+        tstates += inst[n].tstates;
+        steps   += inst[n].steps;
+
+        if ( n == 0 )
+        {
+            checksum = bench_checksum(inst[n].mem);
+        }
+
+        else if ( bench_checksum(inst[n].mem) != checksum )
+        {
+            mismatch = 1;
+        }
+    }
+
+    printf("Decode cache:    %s\n",dcache_on ? "on" : "off");
+    printf("Instances:       %d\n",num_inst);
+    printf("T-states:        %.0f\n",tstates);
+    printf("Steps:           %.0f\n",steps);
+    printf("Host seconds:    %.3f\n",host_secs);
+    printf("Emulated MHz:    %.2f\n",tstates/host_secs/1000000.0);
+    printf("Steps/second:    %.0f\n",steps/host_secs);
+    printf("Memory checksum: %08lx%s\n",checksum,mismatch ? " (instances differ)" : "");
+
+    #ifdef Z80_PROFILE
+    if ( ( report = z80cpu_getinf(inst[0].cpu) ) != NULL )
+    {
+        printf("%s",report);
+
+        DEBFREE(report);
+    }
+
+    if ( z80cpu_profile_csv(inst[0].cpu,"z80ops.csv","z80mem.csv") )
+    {
+        printf("Unable to write z80 profile.\n");
+    }
+    #endif
+
+    #ifdef Z80_TRACE
+    if ( trace_depth && z80cpu_trace_dump(inst[0].cpu,Z80CPU_TRACE_FILE) )
+    {
+        printf("Unable to write z80 trace.\n");
+    }
+    #endif
+
+    for ( n = 0 ; n < num_inst ; n++ )
+    {
+        z80cpu_stop(inst[n].cpu);
+        z80cpu_remove(inst[n].cpu);
+
+        DEBFREE(inst[n].mem);
+    }
+
+    DEBFREE(inst);
+    DEBFREE(image);
+
+    return mismatch;
+}
@@ -0,0 +1,4672 @@
+#include "z80core.h"
+#include "z80jit.h"
+#include "u_dtype.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*
+
+                          Portable Z80 Core
+                          =================
+
+This is a portable C implementation of the z80 emulation core, providing
+exactly the same functions, buses and memory tables as z80cpu.asm (see
+z80cpu.c for details of these).  Timing follows z80cpu.asm:
+
+- opfetch is 4 T-states, plus the read waits for the page (unless naw).
+- memory reads and writes are 3 T-states, plus the page waits (unless naw).
+- io reads and writes are 4 T-states.
+- acknowledging INT is 5 T-states, NMI is 5 and bus request is 1.
+- waits inserted using z80_set_wait (or left on the wait bus after an
+  external call) are added to the clock bus at the end of the step.
+
+Each call to z80_cycle runs one step, which is one complete instruction
+(including any prefixes), an interupt/NMI/bus request acknowledge or a
+HALT cycle (a repeating block move or compare may also run a number of its
+iterations in one step, see "Block instructions" below).  As with
+z80cpu.asm, what the next step will be is decided at the end of the
+current step, so signals that arrive between calls to z80_cycle are seen
+one step later.  Unlike z80cpu.asm, prefix bytes do not end a step (they
+can't be interupted anyway, apart from by reset).
+
+The undocumented flags (bits 3 and 5) and the hidden register (WZ) are
+emulated as described in Sean Young's "The Undocumented Z80 Documented".
+The DAA result is calculated rather than looked up, and matches the table
+in z80cpu.asm (which was measured on a real z80) for all inputs.
+
+Lazy flags
+==========
+
+Most flag results are never looked at: the next ALU op overwrites them
+before any conditional jump, PUSH AF or the like gets to see them.  So
+8-bit ADD, ADC, SUB, SBC, CP, INC and DEC don't work out F.  Instead they
+record the operation, its operands, carry in and result (lazy_op, lazy_x,
+lazy_y, lazy_c and lazy_r), and F is only worked out from these when
+something reads it.  All access to F goes through REG_F and REG_AF, which
+do this first, except that:
+
+- FLAG_CY gives the carry flag without working out the rest (ADC, SBC,
+  rotates, INC/DEC and so on only need the carry).
+- z80_cond works out NZ, Z, NC, C, P and M straight from the result, so
+  the usual DEC B / JR NZ and CP n / JR Z don't work out F at all.
+- code that replaces F outright drops the pending operation first
+  (c->lazy_op = Z80_LAZY_NONE) rather than work out flags that are about
+  to be overwritten.
+
+Anything outside the core that looks at F (for example to save a
+snapshot) must call z80_sync_flags first.  Translated code (z80jit.c)
+works on F directly, so the flags are always worked out before it is run
+and after each instruction it hands back to the core.  F comes out
+bit-for-bit the same either way, undocumented bits included.  Define
+Z80_NO_LAZY_FLAGS to work out F as each instruction runs.
+
+Pre-decoded instruction cache
+=============================
+
+With the cache on (z80_set_dcache_on), each instruction run from a page
+that is set up for direct opreads and direct reads is decoded once into a
+z80_dcache_rec, which holds its bytes, length, the number of opcode
+fetches and the T-states taken by all of its fetches.  The next time the
+instruction is run PC, R and the clock are all advanced in one go and the
+opcode and operand bytes come from the record, so none of the per-byte
+page table lookups are done.  The opcode handlers are the same either way
+(the record's first byte is dispatched as usual), as are the results.
+
+Records are kept in a table for each page (indexed by the low byte of the
+address), which is allocated the first time code is run from the page.
+Instructions that cross into the next page, DD/FD prefixes followed by
+another DD/FD or ED prefix and instructions on pages that aren't direct
+for both opreads and reads are marked as not cached and always go through
+the usual fetch.  A write to any byte of a cached instruction throws that
+record away, and changing a page's access method or waits via the
+z80_set_mem_* functions throws away the whole page.  As with the block
+translator, memory mapped at two different pages is not tracked.
+
+Turning the cache off (z80_set_dcache_off) frees the tables.
+
+Block instructions
+==================
+
+LDIR, LDDR, CPIR and CPDR run one iteration per step, as on a real z80
+(each iteration is a complete instruction that ends by moving PC back to
+the start of itself).  Once the first iteration of a step has repeated,
+if the source and destination pages are direct the following iterations
+are done in the same step in bulk, using memmove and memchr on the page
+memory, one page at a time.  The clock, R, WZ, flags and registers end up
+exactly as if each iteration had been a step of its own, and the bulk run
+stops where the step by step one would have:
+
+- when the clock reaches the limit given by clk_count (so any device that
+  would have been clocked, or would have raised an interupt, in between
+  still gets its chance at the same point),
+- whenever the next step would be anything but the next iteration (reset,
+  bus request, NMI or an enabled INT pending),
+- at any page that isn't direct for reads (and writes, for LDIR/LDDR), so
+  writes to indirect pages such as the video ram still go through the
+  external write function a byte at a time,
+- before an iteration that would overwrite the instruction itself.
+
+Overlapping moves that rely on the byte by byte copy (such as the usual
+fill with LD (HL),n, LD DE,HL+1, LDIR) are done byte by byte on the page
+memory.  Writes throw away cached instructions and translated code as
+usual.  INIR, INDR, OTIR and OTDR are not done in bulk: each iteration is
+an io access, which can change anything.  Define Z80_NO_BULK to turn all
+of this off.
+
+Skipping idle time
+==================
+
+A lot of the time the z80 has nothing to do: it sits in HALT waiting for
+an interupt, or goes round a short loop reading an io port until some
+device changes state.
+Devices are only clocked between runs of z80_cycle (see z80cpu.c and the
+scheduler in mbee.c), so until the end of the run nothing they return can
+change.  Rather than go round a cycle at a time the core can skip straight
+to the end of the run, set with z80_set_skip_none (off), z80_set_skip_halt
+(HALT only) and z80_set_skip_idle (HALT and idle loops):
+
+- HALT: once the first HALT cycle of a step has been done from a direct
+  page, the rest of the HALT cycles up to the clock limit given by
+  clk_count are done at once (nothing can happen in between, as none of
+  them make any external calls).
+
+- Idle loops: after each IN A,(n) or IN r,(C) the registers are compared
+  with those just after the previous one.  If they are the same, the IN
+  was at the same address and nothing in between wrote memory, made an
+  external memory access, wrote to an io port or took an interupt (and no
+  more than Z80_IDLE_MAX_CLK T-states have passed) then every trip around
+  the loop will be exactly the same until a device changes, so as many
+  whole trips as fit before the clock limit are skipped in one go (each
+  adding its T-states and R increments).  The rest of the run is done as
+  usual.  This relies on io reads having no side effects of their own
+  that could change what a later read returns, which is the case for all
+  of the microbee's ports.  Translated code (z80jit.c) isn't looked at.
+  Only pure read and compare spin loops are skipped: a loop that pushes,
+  calls a subroutine or selects a 6545 register on the way round (such as
+  the BASIC keyboard scan) writes memory or an io port every trip, so it
+  is always run in full.
+
+The T-states skipped are counted in skip_halt and skip_idle.
+
+Profiling
+=========
+
+If Z80_PROFILE is defined each instruction is counted, along with the
+T-states it took (waits included), against its opcode in the table it was
+run from: main, CB, ED, DD, FD, DDCB or FDCB.  The opcode bytes are
+recorded as they are fetched (by z80_fetch_op, or from the cache record)
+and sorted out at the end of the step by z80_prof_step, so the dispatch
+itself is unchanged.  A DD or FD prefix followed by another prefix counts
+as opcode DD or FD of the DD/FD table (the z80 treats it as a NOP), and a
+bulk run of a block instruction counts one execution per iteration.
+Interupt, NMI, bus request and HALT cycles aren't instructions and aren't
+counted, and nor is time skipped in idle loops.
+
+Memory writes, reads and opcode reads are also counted for each page and
+method (none, direct or indirect) at the time of the access, including
+those done from the cache and in bulk runs.
+
+Without Z80_PROFILE there is no trace of any of this in the code.
+
+Tracing
+=======
+
+If Z80_TRACE is defined, z80_set_trace sets up a ring of trace records
+(z80_trace_rec, see z80core.h) of the given depth, rounded up to a power
+of 2, or turns tracing off and frees the ring if the depth is 0.  While
+it is on, every instruction step and every interupt or NMI acknowledge
+step writes the next record in the ring, overwriting the oldest.  The
+record is filled in with the time and registers at the start of the step,
+and the opcode and operand bytes are added as they are fetched (so
+nothing is read twice, and indirect pages see exactly the same accesses
+as without tracing).  HALT and bus request cycles aren't recorded, and
+nor are the extra iterations of a bulk run or idle loops skipped over:
+each of these is part of the record for its step.
+
+The ring is only ever written by z80_cycle and only read (by z80cpu.c)
+between steps, by the same thread, so it needs no locking.
+
+Watchpoints
+===========
+
+z80_watch_add watches a range of addresses for any of writes, reads and
+opcode reads (Z80_WATCH_WR, Z80_WATCH_RD and Z80_WATCH_OP), up to
+Z80_WATCH_MAX ranges at once, and z80_watch_clear removes them all.
+Neither should be called from within z80_cycle.
+
+Watching costs nothing on pages without a watchpoint.  The method each
+page was last set to (by z80_set_mem_*) is kept in wr_real, rd_real and
+op_real, and the method actually used (wr_mode etc) is the same except
+that any access watched on the page is switched to indirect.  The only
+test added to the memory access path is on the indirect path, where
+watch_page sends the access to z80_watch_wr (etc).  These check the
+address against the ranges and then carry out the access by the page's
+real method, so memory, waits and timing are exactly as they would be
+without the watchpoint.  Setting a page's method while it is watched
+(such as the colour/PCG RAM switching in mbee.c) just changes its real
+method, and removing the watchpoints puts the real methods back.
+
+The first access caught is recorded (watch_kind, watch_addr, watch_data
+and watch_pc, which is the PC at the time of the access rather than the
+start of the instruction) and every one is counted in watch_hits.  Each
+also asks z80cpu.c to end the run (end_run), so the rest of the machine
+sees the access within Z80CPU_RUN_SLICE clock cycles.  Pre-decoded and
+translated code is only ever run from direct pages, so none is kept for
+a page with an opcode read watchpoint.
+
+*/
+
+#ifndef Z80_ASM_CORE
+
+
+/*
+   What the next call to z80_cycle will do.
+*/
+
+#define Z80_NEXT_START          0
+#define Z80_NEXT_NORM           1
+#define Z80_NEXT_HALT           2
+#define Z80_NEXT_BUSRQ          3
+#define Z80_NEXT_NMI            4
+#define Z80_NEXT_INT            5
+
+/*
+   Register shorthand (all assume z80_core *c is in scope).
+*/
+
+#define REG_AF                  (*( c->lazy_op ? ( z80_flags(c), &(c->af.w) ) : &(c->af.w) ))
+#define REG_BC                  (c->bc.w)
+#define REG_DE                  (c->de.w)
+#define REG_HL                  (c->hl.w)
+#define REG_IX                  (c->ix.w)
+#define REG_IY                  (c->iy.w)
+#define REG_SP                  (c->sp.w)
+#define REG_PC                  (c->pc.w)
+#define REG_WZ                  (c->wz.w)
+
+#define REG_A                   (c->af.b.h)
+#define REG_F                   (*( c->lazy_op ? z80_flags(c) : &(c->af.b.l) ))
+#define REG_B                   (c->bc.b.h)
+#define REG_C                   (c->bc.b.l)
+#define REG_D                   (c->de.b.h)
+#define REG_E                   (c->de.b.l)
+#define REG_H                   (c->hl.b.h)
+#define REG_L                   (c->hl.b.l)
+
+#define FLAGS_53                ( Z80_FLAG_5 | Z80_FLAG_3 )
+#define FLAGS_SZPV              ( Z80_FLAG_S | Z80_FLAG_Z | Z80_FLAG_PV )
+
+/*
+   Sign extend displacement d and add to address a.
+*/
+
+#define ADD_DISP(a,d)           ( (UINT_16) ( (a) + (d) - ( ( (d) & 0x080 ) << 1 ) ) )
+
+
+/*
+   Flag lookup tables: S, Z, 5 and 3 flags for the given result, and the
+   same with the parity flag added.
+*/
+
+static const UINT_8 z80_sz53_table[256] =
+{
+    0x040, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x008, 0x008, 0x008, 0x008, 0x008, 0x008, 0x008, 0x008,
+    0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x008, 0x008, 0x008, 0x008, 0x008, 0x008, 0x008, 0x008,
+    0x020, 0x020, 0x020, 0x020, 0x020, 0x020, 0x020, 0x020, 0x028, 0x028, 0x028, 0x028, 0x028, 0x028, 0x028, 0x028,
+    0x020, 0x020, 0x020, 0x020, 0x020, 0x020, 0x020, 0x020, 0x028, 0x028, 0x028, 0x028, 0x028, 0x028, 0x028, 0x028,
+    0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x008, 0x008, 0x008, 0x008, 0x008, 0x008, 0x008, 0x008,
+    0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x008, 0x008, 0x008, 0x008, 0x008, 0x008, 0x008, 0x008,
+    0x020, 0x020, 0x020, 0x020, 0x020, 0x020, 0x020, 0x020, 0x028, 0x028, 0x028, 0x028, 0x028, 0x028, 0x028, 0x028,
+    0x020, 0x020, 0x020, 0x020, 0x020, 0x020, 0x020, 0x020, 0x028, 0x028, 0x028, 0x028, 0x028, 0x028, 0x028, 0x028,
+    0x080, 0x080, 0x080, 0x080, 0x080, 0x080, 0x080, 0x080, 0x088, 0x088, 0x088, 0x088, 0x088, 0x088, 0x088, 0x088,
+    0x080, 0x080, 0x080, 0x080, 0x080, 0x080, 0x080, 0x080, 0x088, 0x088, 0x088, 0x088, 0x088, 0x088, 0x088, 0x088,
+    0x0a0, 0x0a0, 0x0a0, 0x0a0, 0x0a0, 0x0a0, 0x0a0, 0x0a0, 0x0a8, 0x0a8, 0x0a8, 0x0a8, 0x0a8, 0x0a8, 0x0a8, 0x0a8,
+    0x0a0, 0x0a0, 0x0a0, 0x0a0, 0x0a0, 0x0a0, 0x0a0, 0x0a0, 0x0a8, 0x0a8, 0x0a8, 0x0a8, 0x0a8, 0x0a8, 0x0a8, 0x0a8,
+    0x080, 0x080, 0x080, 0x080, 0x080, 0x080, 0x080, 0x080, 0x088, 0x088, 0x088, 0x088, 0x088, 0x088, 0x088, 0x088,
+    0x080, 0x080, 0x080, 0x080, 0x080, 0x080, 0x080, 0x080, 0x088, 0x088, 0x088, 0x088, 0x088, 0x088, 0x088, 0x088,
+    0x0a0, 0x0a0, 0x0a0, 0x0a0, 0x0a0, 0x0a0, 0x0a0, 0x0a0, 0x0a8, 0x0a8, 0x0a8, 0x0a8, 0x0a8, 0x0a8, 0x0a8, 0x0a8,
+    0x0a0, 0x0a0, 0x0a0, 0x0a0, 0x0a0, 0x0a0, 0x0a0, 0x0a0, 0x0a8, 0x0a8, 0x0a8, 0x0a8, 0x0a8, 0x0a8, 0x0a8, 0x0a8
+};
+
+static const UINT_8 z80_sz53p_table[256] =
+{
+    0x044, 0x000, 0x000, 0x004, 0x000, 0x004, 0x004, 0x000, 0x008, 0x00c, 0x00c, 0x008, 0x00c, 0x008, 0x008, 0x00c,
+    0x000, 0x004, 0x004, 0x000, 0x004, 0x000, 0x000, 0x004, 0x00c, 0x008, 0x008, 0x00c, 0x008, 0x00c, 0x00c, 0x008,
+    0x020, 0x024, 0x024, 0x020, 0x024, 0x020, 0x020, 0x024, 0x02c, 0x028, 0x028, 0x02c, 0x028, 0x02c, 0x02c, 0x028,
+    0x024, 0x020, 0x020, 0x024, 0x020, 0x024, 0x024, 0x020, 0x028, 0x02c, 0x02c, 0x028, 0x02c, 0x028, 0x028, 0x02c,
+    0x000, 0x004, 0x004, 0x000, 0x004, 0x000, 0x000, 0x004, 0x00c, 0x008, 0x008, 0x00c, 0x008, 0x00c, 0x00c, 0x008,
+    0x004, 0x000, 0x000, 0x004, 0x000, 0x004, 0x004, 0x000, 0x008, 0x00c, 0x00c, 0x008, 0x00c, 0x008, 0x008, 0x00c,
+    0x024, 0x020, 0x020, 0x024, 0x020, 0x024, 0x024, 0x020, 0x028, 0x02c, 0x02c, 0x028, 0x02c, 0x028, 0x028, 0x02c,
+    0x020, 0x024, 0x024, 0x020, 0x024, 0x020, 0x020, 0x024, 0x02c, 0x028, 0x028, 0x02c, 0x028, 0x02c, 0x02c, 0x028,
+    0x080, 0x084, 0x084, 0x080, 0x084, 0x080, 0x080, 0x084, 0x08c, 0x088, 0x088, 0x08c, 0x088, 0x08c, 0x08c, 0x088,
+    0x084, 0x080, 0x080, 0x084, 0x080, 0x084, 0x084, 0x080, 0x088, 0x08c, 0x08c, 0x088, 0x08c, 0x088, 0x088, 0x08c,
+    0x0a4, 0x0a0, 0x0a0, 0x0a4, 0x0a0, 0x0a4, 0x0a4, 0x0a0, 0x0a8, 0x0ac, 0x0ac, 0x0a8, 0x0ac, 0x0a8, 0x0a8, 0x0ac,
+    0x0a0, 0x0a4, 0x0a4, 0x0a0, 0x0a4, 0x0a0, 0x0a0, 0x0a4, 0x0ac, 0x0a8, 0x0a8, 0x0ac, 0x0a8, 0x0ac, 0x0ac, 0x0a8,
+    0x084, 0x080, 0x080, 0x084, 0x080, 0x084, 0x084, 0x080, 0x088, 0x08c, 0x08c, 0x088, 0x08c, 0x088, 0x088, 0x08c,
+    0x080, 0x084, 0x084, 0x080, 0x084, 0x080, 0x080, 0x084, 0x08c, 0x088, 0x088, 0x08c, 0x088, 0x08c, 0x08c, 0x088,
+    0x0a0, 0x0a4, 0x0a4, 0x0a0, 0x0a4, 0x0a0, 0x0a0, 0x0a4, 0x0ac, 0x0a8, 0x0a8, 0x0ac, 0x0a8, 0x0ac, 0x0ac, 0x0a8,
+    0x0a4, 0x0a0, 0x0a0, 0x0a4, 0x0a0, 0x0a4, 0x0a4, 0x0a0, 0x0a8, 0x0ac, 0x0ac, 0x0a8, 0x0ac, 0x0a8, 0x0a8, 0x0ac
+};
+
+
+/***********************************************************************/
+/***********************************************************************/
+/***********************************************************************/
+
+/*
+   Lazy flags (see above).  z80_flags works out F from the pending
+   operation (if any) and returns a pointer to it, z80_lazy_carry gives
+   just the carry flag of the pending operation and z80_lazy records an
+   operation (for INC/DEC lazy_c is the carry flag that is kept, for the
+   rest it is the carry in).
+*/
+
+#define Z80_LAZY_NONE           0
+#define Z80_LAZY_ADD            1
+#define Z80_LAZY_SUB            2
+#define Z80_LAZY_CP             3
+#define Z80_LAZY_INC            4
+#define Z80_LAZY_DEC            5
+
+static UINT_8 *z80_flags(z80_core *c)
+{
+    UINT_32 res;
+    UINT_8 x = c->lazy_x;
+    UINT_8 y = c->lazy_y;
+    UINT_8 r = c->lazy_r;
+    UINT_8 f;
+
+    switch ( c->lazy_op )
+    {
+        case Z80_LAZY_ADD:
+        {
+            res = x + y + c->lazy_c;
+            f   = (UINT_8) ( z80_sz53_table[r]
+                           | ( ( res >> 8 ) & Z80_FLAG_C )
+                           | ( ( x ^ y ^ r ) & Z80_FLAG_H )
+                           | ( ( ( ( x ^ ~y ) & ( x ^ r ) ) & 0x080 ) >> 5 ) );
+
+            break;
+        }
+
+        case Z80_LAZY_SUB:
+        case Z80_LAZY_CP:
+        {
+            res = x - y - c->lazy_c;
+            f   = (UINT_8) ( Z80_FLAG_N
+                           | ( ( res >> 8 ) & Z80_FLAG_C )
+                           | ( ( x ^ y ^ r ) & Z80_FLAG_H )
+                           | ( ( ( ( x ^ y ) & ( x ^ r ) ) & 0x080 ) >> 5 ) );
+
+            /*
+               CP takes flags 5 and 3 from the operand.
+            */
+
+            if ( c->lazy_op == Z80_LAZY_SUB ) { f |= z80_sz53_table[r]; }
+            else                              { f |= (UINT_8) ( ( z80_sz53_table[r] & ( Z80_FLAG_S | Z80_FLAG_Z ) ) | ( y & FLAGS_53 ) ); }
+
+            break;
+        }
+
+        case Z80_LAZY_INC:
+        {
+            f = (UINT_8) ( c->lazy_c
+                         | z80_sz53_table[r]
+                         | ( ( ( x & 0x00f ) == 0x00f ) ? Z80_FLAG_H  : 0 )
+                         | ( ( x == 0x07f )             ? Z80_FLAG_PV : 0 ) );
+
+            break;
+        }
+
+        case Z80_LAZY_DEC:
+        {
+            f = (UINT_8) ( c->lazy_c
+                         | Z80_FLAG_N
+                         | z80_sz53_table[r]
+                         | ( ( ( x & 0x00f ) == 0x000 ) ? Z80_FLAG_H  : 0 )
+                         | ( ( x == 0x080 )             ? Z80_FLAG_PV : 0 ) );
+
+            break;
+        }
+
+        default:
+        {
+            return &(c->af.b.l);
+        }
+    }
+
+    c->af.b.l  = f;
+    c->lazy_op = Z80_LAZY_NONE;
+
+    return &(c->af.b.l);
+}
+
+static UINT_8 z80_lazy_carry(z80_core *c)
+{
+    switch ( c->lazy_op )
+    {
+        case Z80_LAZY_ADD: return (UINT_8) ( ( ( c->lazy_x + c->lazy_y + c->lazy_c ) >> 8 ) & Z80_FLAG_C );
+        case Z80_LAZY_SUB:
+        case Z80_LAZY_CP:  return (UINT_8) ( ( ( c->lazy_x - c->lazy_y - c->lazy_c ) >> 8 ) & Z80_FLAG_C );
+        default:           break;
+    }
+
+    return c->lazy_c;
+}
+
+static void z80_lazy(z80_core *c, UINT_8 op, UINT_8 x, UINT_8 y, UINT_8 cy, UINT_8 r)
+{
+    c->lazy_op = op;
+    c->lazy_x  = x;
+    c->lazy_y  = y;
+    c->lazy_c  = cy;
+    c->lazy_r  = r;
+
+    #ifdef Z80_NO_LAZY_FLAGS
+    z80_flags(c);
+    #endif
+
+    return;
+}
+
+#define FLAG_CY                 ( c->lazy_op ? z80_lazy_carry(c) : (UINT_8) ( c->af.b.l & Z80_FLAG_C ) )
+
+
+/***********************************************************************/
+/***********************************************************************/
+/***********************************************************************/
+
+/*
+   Pre-decoded instruction cache: throwing records away.  A write to addr
+   throws away the records for the 4 addresses up to and including addr
+   (no instruction is longer than 4 bytes, and records never cross into
+   the next page).
+*/
+
+static void z80_dcache_write(z80_core *c, UINT_16 addr)
+{
+    z80_dcache_rec *rec = c->dcache[addr >> 8];
+    int i;
+
+    for ( i = addr & 0x0ff ; ( i >= 0 ) && ( i > ( addr & 0x0ff ) - 4 ) ; i-- )
+    {
+        rec[i].state = Z80_DCACHE_EMPTY;
+    }
+
+    return;
+}
+
+static void z80_dcache_flush_page(z80_core *c, UINT_8 page)
+{
+    int i;
+
+    if ( c->dcache[page] != NULL )
+    {
+        for ( i = 0 ; i < 256 ; i++ )
+        {
+            (c->dcache[page])[i].state = Z80_DCACHE_EMPTY;
+        }
+    }
+
+    return;
+}
+
+
+/***********************************************************************/
+/***********************************************************************/
+/***********************************************************************/
+
+/*
+   Watchpoints (see above).  z80_watch_check records an access if it falls
+   in a range being watched for that kind of access.  z80_watch_wr etc
+   carry out an access to a page with a watchpoint by the page's real
+   method and check it.
+*/
+
+static void z80_watch_check(z80_block *z, UINT_8 kind, UINT_16 addr, UINT_8 data)
+{
+    z80_core *c = &(z->core);
+    int i;
+
+    if ( !( c->watch_page[addr >> 8] & kind ) )
+    {
+        return;
+    }
+
+    for ( i = 0 ; i < c->watch_num ; i++ )
+    {
+        if ( ( c->watch[i].kinds & kind ) && ( addr >= c->watch[i].start ) && ( addr <= c->watch[i].end ) )
+        {
+            if ( !c->watch_hits )
+            {
+                c->watch_kind = kind;
+                c->watch_addr = addr;
+                c->watch_data = data;
+                c->watch_pc   = REG_PC;
+            }
+
+            c->watch_hits++;
+
+            z->end_run = 1;
+
+            return;
+        }
+    }
+
+    return;
+}
+
+static void z80_watch_wr(z80_block *z, UINT_16 addr, UINT_8 val)
+{
+    z80_core *c = &(z->core);
+    UINT_8 page = (UINT_8) ( addr >> 8 );
+
+    switch ( c->wr_real[page] )
+    {
+        case Z80_MEM_DIRECT:
+        {
+            (c->mem_addr[page])[addr & 0x0ff] = val;
+
+            break;
+        }
+
+        case Z80_MEM_INDIRECT:
+        {
+            z->addr = addr;
+            z->data = val;
+            z80_wr_mem((void *) z);
+            c->wait_word += (UINT_16) ( z->wait & 0x0ff );
+
+            break;
+        }
+
+        default:
+        {
+            break;
+        }
+    }
+
+    z80_watch_check(z,Z80_WATCH_WR,addr,val);
+
+    return;
+}
+
+static UINT_8 z80_watch_rd(z80_block *z, UINT_16 addr)
+{
+    z80_core *c = &(z->core);
+    UINT_8 page = (UINT_8) ( addr >> 8 );
+    UINT_8 val = 0;
+
+    switch ( c->rd_real[page] )
+    {
+        case Z80_MEM_DIRECT:
+        {
+            val = (c->mem_addr[page])[addr & 0x0ff];
+
+            break;
+        }
+
+        case Z80_MEM_INDIRECT:
+        {
+            z->addr = addr;
+            z->data = 0;
+            z80_rd_mem((void *) z);
+            c->wait_word += (UINT_16) ( z->wait & 0x0ff );
+
+            val = (UINT_8) z->data;
+
+            break;
+        }
+
+        default:
+        {
+            break;
+        }
+    }
+
+    z80_watch_check(z,Z80_WATCH_RD,addr,val);
+
+    return val;
+}
+
+static UINT_8 z80_watch_op(z80_block *z, UINT_16 addr)
+{
+    z80_core *c = &(z->core);
+    UINT_8 page = (UINT_8) ( addr >> 8 );
+    UINT_8 val = 0;
+
+    switch ( c->op_real[page] )
+    {
+        case Z80_MEM_DIRECT:
+        {
+            val = (c->mem_addr[page])[addr & 0x0ff];
+
+            break;
+        }
+
+        case Z80_MEM_INDIRECT:
+        {
+            z->addr = addr;
+            z->rfsh = c->r;
+            z->data = 0;
+            z80_opfetch((void *) z);
+            c->wait_word += (UINT_16) ( z->wait & 0x0ff );
+
+            val = (UINT_8) z->data;
+
+            break;
+        }
+
+        default:
+        {
+            break;
+        }
+    }
+
+    z80_watch_check(z,Z80_WATCH_OP,addr,val);
+
+    return val;
+}
+
+
+/***********************************************************************/
+/***********************************************************************/
+/***********************************************************************/
+
+/*
+   Memory and io access.
+*/
+
+/*
+   Opcode (OP_BYTE) and operand (ARG_BYTE) bytes pass through these on the
+   way from the fetch to the dispatch, for the profile and trace (see
+   "Profiling" and "Tracing").  They do nothing otherwise.
+*/
+
+#ifdef Z80_TRACE
+#define ARG_BYTE(val)           z80_trace_byte(c,(val))
+
+static UINT_8 z80_trace_byte(z80_core *c, UINT_8 val)
+{
+    if ( ( c->trace_rec != NULL ) && ( c->trace_rec->len < 4 ) )
+    {
+        c->trace_rec->op[c->trace_rec->len++] = val;
+    }
+
+    return val;
+}
+#endif
+
+#ifndef Z80_TRACE
+#define ARG_BYTE(val)           (val)
+#endif
+
+#if defined(Z80_PROFILE) || defined(Z80_TRACE)
+#define OP_BYTE(val)            z80_op_byte(c,(val))
+
+static UINT_8 z80_op_byte(z80_core *c, UINT_8 val)
+{
+    #ifdef Z80_PROFILE
+    c->prof_op[c->prof_n & 3] = val;
+    c->prof_n++;
+    #endif
+
+    #ifdef Z80_TRACE
+    z80_trace_byte(c,val);
+    #endif
+
+    return val;
+}
+#endif
+
+#if !defined(Z80_PROFILE) && !defined(Z80_TRACE)
+#define OP_BYTE(val)            (val)
+#endif
+
+static UINT_8 z80_rd_byte(z80_block *z, UINT_16 addr)
+{
+    z80_core *c = &(z->core);
+    UINT_8 page = (UINT_8) ( addr >> 8 );
+
+    z->clk += 3 + c->rd_wait[page];
+
+    #ifdef Z80_PROFILE
+    c->prof.mem[Z80_PROF_RD][page][c->rd_mode[page]]++;
+    #endif
+
+    if ( c->rd_mode[page] == Z80_MEM_DIRECT )
+    {
+        return (c->mem_addr[page])[addr & 0x0ff];
+    }
+
+    if ( c->rd_mode[page] == Z80_MEM_INDIRECT )
+    {
+        c->idle_armed = 0;
+
+        if ( c->watch_page[page] )
+        {
+            return z80_watch_rd(z,addr);
+        }
+
+        z->addr = addr;
+        z->data = 0;
+        z80_rd_mem((void *) z);
+        c->wait_word += (UINT_16) ( z->wait & 0x0ff );
+
+        return (UINT_8) z->data;
+    }
+
+    return 0;
+}
+
+static void z80_wr_byte(z80_block *z, UINT_16 addr, UINT_8 val)
+{
+    z80_core *c = &(z->core);
+    UINT_8 page = (UINT_8) ( addr >> 8 );
+
+    z->clk += 3 + c->wr_wait[page];
+
+    c->idle_armed = 0;
+
+    #ifdef Z80_PROFILE
+    c->prof.mem[Z80_PROF_WR][page][c->wr_mode[page]]++;
+    #endif
+
+    if ( c->dcache[page] != NULL )
+    {
+        z80_dcache_write(c,addr);
+    }
+
+    #ifdef Z80_JIT
+    if ( c->jit_code[page] )
+    {
+        z80_jit_write(z,addr);
+    }
+    #endif
+
+    if ( c->wr_mode[page] == Z80_MEM_DIRECT )
+    {
+        (c->mem_addr[page])[addr & 0x0ff] = val;
+    }
+
+    else if ( c->wr_mode[page] == Z80_MEM_INDIRECT )
+    {
+        if ( c->watch_page[page] )
+        {
+            z80_watch_wr(z,addr,val);
+
+            return;
+        }
+
+        z->addr = addr;
+        z->data = val;
+        z80_wr_mem((void *) z);
+        c->wait_word += (UINT_16) ( z->wait & 0x0ff );
+    }
+
+    return;
+}
+
+static UINT_8 z80_in_byte(z80_block *z, UINT_16 port)
+{
+    z80_core *c = &(z->core);
+
+    z->clk += 4;
+    z->addr = port;
+    z->data = 0;
+    z80_rd_io((void *) z);
+    c->wait_word += (UINT_16) ( z->wait & 0x0ff );
+
+    return (UINT_8) z->data;
+}
+
+static void z80_out_byte(z80_block *z, UINT_16 port, UINT_8 val)
+{
+    z80_core *c = &(z->core);
+
+    z->clk += 4;
+    z->addr = port;
+    z->data = val;
+    z80_wr_io((void *) z);
+    c->idle_armed = 0;
+    c->wait_word += (UINT_16) ( z->wait & 0x0ff );
+
+    return;
+}
+
+/*
+   Interupt acknowledge cycle: returns byte put on the data bus.
+*/
+
+static UINT_8 z80_int_ack(z80_block *z)
+{
+    z80_core *c = &(z->core);
+
+    z->clk += 5;
+    z->addr = REG_PC;
+    z->data = 0;
+    z80_ack_INT((void *) z);
+    c->idle_armed = 0;
+    c->wait_word += (UINT_16) ( z->wait & 0x0ff );
+
+    return (UINT_8) z->data;
+}
+
+/*
+   Opcode read from address (without incrementing R or PC).
+*/
+
+static UINT_8 z80_op_rd(z80_block *z, UINT_16 addr)
+{
+    z80_core *c = &(z->core);
+    UINT_8 page = (UINT_8) ( addr >> 8 );
+
+    z->clk += 4 + c->op_wait[page];
+
+    #ifdef Z80_PROFILE
+    c->prof.mem[Z80_PROF_OP][page][c->op_mode[page]]++;
+    #endif
+
+    if ( c->op_mode[page] == Z80_MEM_DIRECT )
+    {
+        return (c->mem_addr[page])[addr & 0x0ff];
+    }
+
+    if ( c->op_mode[page] == Z80_MEM_INDIRECT )
+    {
+        c->idle_armed = 0;
+
+        if ( c->watch_page[page] )
+        {
+            return z80_watch_op(z,addr);
+        }
+
+        z->addr = addr;
+        z->rfsh = c->r;
+        z->data = 0;
+        z80_opfetch((void *) z);
+        c->wait_word += (UINT_16) ( z->wait & 0x0ff );
+
+        return (UINT_8) z->data;
+    }
+
+    return 0;
+}
+
+/*
+   Opcode fetch (M1 cycle).  Increments the low 7 bits of R.  If an IM0
+   interupt is being processed then the opcode comes from the interupting
+   device and PC is not incremented.  For instructions run from the cache
+   the opcode comes from the cache record (PC, R and the clock having
+   already been dealt with).
+*/
+
+static UINT_8 z80_fetch_op(z80_block *z)
+{
+    z80_core *c = &(z->core);
+
+    if ( c->dcache_next != NULL )
+    {
+        return OP_BYTE(*(c->dcache_next++));
+    }
+
+    c->r = (UINT_8) ( ( c->r & 0x080 ) | ( ( c->r + 1 ) & 0x07f ) );
+
+    if ( c->st2 & Z80_ST2_INTOP )
+    {
+        return OP_BYTE(z80_int_ack(z));
+    }
+
+    return OP_BYTE(z80_op_rd(z,REG_PC++));
+}
+
+/*
+   Read data byte from PC (getopbyte).  During IM0 interupts data is read
+   using the external memory read function, with PC stationary.  As with
+   opcodes, bytes of cached instructions come from the cache record.
+*/
+
+static UINT_8 z80_fetch_arg(z80_block *z)
+{
+    z80_core *c = &(z->core);
+
+    if ( c->dcache_next != NULL )
+    {
+        return ARG_BYTE(*(c->dcache_next++));
+    }
+
+    if ( c->st2 & Z80_ST2_INTOP )
+    {
+        z->clk += 3;
+        z->addr = REG_PC;
+        z->data = 0;
+        z80_rd_mem((void *) z);
+        c->wait_word += (UINT_16) ( z->wait & 0x0ff );
+
+        return ARG_BYTE((UINT_8) z->data);
+    }
+
+    return ARG_BYTE(z80_rd_byte(z,REG_PC++));
+}
+
+static UINT_16 z80_fetch_arg16(z80_block *z)
+{
+    UINT_16 lo;
+
+    lo = z80_fetch_arg(z);
+
+    return (UINT_16) ( lo | ( ( (UINT_16) z80_fetch_arg(z) ) << 8 ) );
+}
+
+static UINT_16 z80_rd_word(z80_block *z, UINT_16 addr)
+{
+    UINT_16 lo;
+
+    lo = z80_rd_byte(z,addr);
+
+    return (UINT_16) ( lo | ( ( (UINT_16) z80_rd_byte(z,(UINT_16) ( addr + 1 )) ) << 8 ) );
+}
+
+static void z80_wr_word(z80_block *z, UINT_16 addr, UINT_16 val)
+{
+    z80_wr_byte(z,addr,(UINT_8) val);
+    z80_wr_byte(z,(UINT_16) ( addr + 1 ),(UINT_8) ( val >> 8 ));
+
+    return;
+}
+
+static void z80_push(z80_block *z, UINT_16 val)
+{
+    z80_core *c = &(z->core);
+
+    REG_SP--;
+    z80_wr_byte(z,REG_SP,(UINT_8) ( val >> 8 ));
+    REG_SP--;
+    z80_wr_byte(z,REG_SP,(UINT_8) val);
+
+    return;
+}
+
+static UINT_16 z80_pop(z80_block *z)
+{
+    z80_core *c = &(z->core);
+    UINT_16 lo;
+
+    lo = z80_rd_byte(z,REG_SP++);
+
+    return (UINT_16) ( lo | ( ( (UINT_16) z80_rd_byte(z,REG_SP++) ) << 8 ) );
+}
+
+
+/***********************************************************************/
+/***********************************************************************/
+/***********************************************************************/
+
+/*
+   ALU operations.
+*/
+
+static void z80_add_a(z80_core *c, UINT_8 val, UINT_8 carry)
+{
+    UINT_8 r8 = (UINT_8) ( REG_A + val + carry );
+
+    z80_lazy(c,Z80_LAZY_ADD,REG_A,val,carry,r8);
+    REG_A = r8;
+
+    return;
+}
+
+/*
+   SUB/SBC/CP: store is zero for CP (flags only, 5/3 from operand).
+*/
+
+static void z80_sub_a(z80_core *c, UINT_8 val, UINT_8 carry, int store)
+{
+    UINT_8 r8 = (UINT_8) ( REG_A - val - carry );
+
+    if ( store )
+    {
+        z80_lazy(c,Z80_LAZY_SUB,REG_A,val,carry,r8);
+        REG_A = r8;
+    }
+
+    else
+    {
+        z80_lazy(c,Z80_LAZY_CP,REG_A,val,carry,r8);
+    }
+
+    return;
+}
+
+static void z80_and_a(z80_core *c, UINT_8 val)
+{
+    REG_A &= val;
+    c->lazy_op = Z80_LAZY_NONE;
+    REG_F = (UINT_8) ( z80_sz53p_table[REG_A] | Z80_FLAG_H );
+
+    return;
+}
+
+static void z80_xor_a(z80_core *c, UINT_8 val)
+{
+    REG_A ^= val;
+    c->lazy_op = Z80_LAZY_NONE;
+    REG_F = z80_sz53p_table[REG_A];
+
+    return;
+}
+
+static void z80_or_a(z80_core *c, UINT_8 val)
+{
+    REG_A |= val;
+    c->lazy_op = Z80_LAZY_NONE;
+    REG_F = z80_sz53p_table[REG_A];
+
+    return;
+}
+
+static UINT_8 z80_inc8(z80_core *c, UINT_8 val)
+{
+    UINT_8 res = (UINT_8) ( val + 1 );
+
+    z80_lazy(c,Z80_LAZY_INC,val,1,FLAG_CY,res);
+
+    return res;
+}
+
+static UINT_8 z80_dec8(z80_core *c, UINT_8 val)
+{
+    UINT_8 res = (UINT_8) ( val - 1 );
+
+    z80_lazy(c,Z80_LAZY_DEC,val,1,FLAG_CY,res);
+
+    return res;
+}
+
+static UINT_16 z80_add16(z80_core *c, UINT_16 a, UINT_16 b)
+{
+    UINT_32 res = a + b;
+
+    REG_WZ = (UINT_16) ( a + 1 );
+    REG_F  = (UINT_8) ( ( REG_F & FLAGS_SZPV )
+                      | ( ( res >> 16 ) & Z80_FLAG_C )
+                      | ( ( res >> 8 ) & FLAGS_53 )
+                      | ( ( ( a ^ b ^ res ) >> 8 ) & Z80_FLAG_H ) );
+
+    return (UINT_16) res;
+}
+
+static void z80_adc_hl(z80_core *c, UINT_16 val)
+{
+    UINT_32 res = REG_HL + val + FLAG_CY;
+
+    REG_WZ = (UINT_16) ( REG_HL + 1 );
+    c->lazy_op = Z80_LAZY_NONE;
+    REG_F  = (UINT_8) ( ( ( res >> 8 ) & ( Z80_FLAG_S | FLAGS_53 ) )
+                      | ( ( res & 0x0ffff ) ? 0 : Z80_FLAG_Z )
+                      | ( ( ( REG_HL ^ val ^ res ) >> 8 ) & Z80_FLAG_H )
+                      | ( ( ( ( REG_HL ^ ~val ) & ( REG_HL ^ res ) ) & 0x08000 ) >> 13 )
+                      | ( ( res >> 16 ) & Z80_FLAG_C ) );
+    REG_HL = (UINT_16) res;
+
+    return;
+}
+
+static void z80_sbc_hl(z80_core *c, UINT_16 val)
+{
+    UINT_32 res = REG_HL - val - FLAG_CY;
+
+    REG_WZ = (UINT_16) ( REG_HL + 1 );
+    c->lazy_op = Z80_LAZY_NONE;
+    REG_F  = (UINT_8) ( Z80_FLAG_N
+                      | ( ( res >> 8 ) & ( Z80_FLAG_S | FLAGS_53 ) )
+                      | ( ( res & 0x0ffff ) ? 0 : Z80_FLAG_Z )
+                      | ( ( ( REG_HL ^ val ^ res ) >> 8 ) & Z80_FLAG_H )
+                      | ( ( ( ( REG_HL ^ val ) & ( REG_HL ^ res ) ) & 0x08000 ) >> 13 )
+                      | ( ( res >> 16 ) & Z80_FLAG_C ) );
+    REG_HL = (UINT_16) res;
+
+    return;
+}
+
+/*
+   CB rotate/shift group: what = bits 5-3 of the opcode.
+*/
+
+static UINT_8 z80_rot(z80_core *c, UINT_8 what, UINT_8 val)
+{
+    UINT_8 res;
+    UINT_8 cy;
+
+    switch ( what )
+    {
+        case 0:  cy = (UINT_8) ( val >> 7 );   res = (UINT_8) ( ( val << 1 ) | cy );                        break; /* RLC */
+        case 1:  cy = (UINT_8) ( val & 1 );    res = (UINT_8) ( ( val >> 1 ) | ( cy << 7 ) );               break; /* RRC */
+        case 2:  cy = (UINT_8) ( val >> 7 );   res = (UINT_8) ( ( val << 1 ) | FLAG_CY );    break; /* RL  */
+        case 3:  cy = (UINT_8) ( val & 1 );    res = (UINT_8) ( ( val >> 1 ) | ( FLAG_CY << 7 ) ); break; /* RR  */
+        case 4:  cy = (UINT_8) ( val >> 7 );   res = (UINT_8) ( val << 1 );                                 break; /* SLA */
+        case 5:  cy = (UINT_8) ( val & 1 );    res = (UINT_8) ( ( val >> 1 ) | ( val & 0x080 ) );           break; /* SRA */
+        case 6:  cy = (UINT_8) ( val >> 7 );   res = (UINT_8) ( ( val << 1 ) | 1 );                         break; /* SLL */
+        default: cy = (UINT_8) ( val & 1 );    res = (UINT_8) ( val >> 1 );                                 break; /* SRL */
+    }
+
+    c->lazy_op = Z80_LAZY_NONE;
+    REG_F = (UINT_8) ( z80_sz53p_table[res] | cy );
+
+    return res;
+}
+
+/*
+   BIT n,x: xy is the source of flag bits 5 and 3.
+*/
+
+static void z80_bit(z80_core *c, UINT_8 bit, UINT_8 val, UINT_8 xy)
+{
+    UINT_8 res = (UINT_8) ( val & ( 1 << bit ) );
+    UINT_8 cy  = FLAG_CY;
+
+    c->lazy_op = Z80_LAZY_NONE;
+    REG_F = (UINT_8) ( cy
+                     | Z80_FLAG_H
+                     | ( xy & FLAGS_53 )
+                     | ( res ? ( res & Z80_FLAG_S ) : ( Z80_FLAG_Z | Z80_FLAG_PV ) ) );
+
+    return;
+}
+
+static void z80_daa(z80_core *c)
+{
+    UINT_8 lo   = (UINT_8) ( REG_A & 0x00f );
+    UINT_8 diff = 0;
+    UINT_8 f    = (UINT_8) ( REG_F & Z80_FLAG_N );
+
+    if ( ( REG_F & Z80_FLAG_H ) || ( lo > 9 ) )
+    {
+        diff |= 0x006;
+    }
+
+    if ( FLAG_CY || ( REG_A > 0x099 ) )
+    {
+        diff |= 0x060;
+        f    |= Z80_FLAG_C;
+    }
+
+    if ( REG_F & Z80_FLAG_N )
+    {
+        f |= ( ( REG_F & Z80_FLAG_H ) && ( lo < 6 ) ) ? Z80_FLAG_H : 0;
+        REG_A = (UINT_8) ( REG_A - diff );
+    }
+
+    else
+    {
+        f |= ( lo > 9 ) ? Z80_FLAG_H : 0;
+        REG_A = (UINT_8) ( REG_A + diff );
+    }
+
+    c->lazy_op = Z80_LAZY_NONE;
+    REG_F = (UINT_8) ( f | z80_sz53p_table[REG_A] );
+
+    return;
+}
+
+/*
+   Condition codes NZ,Z,NC,C,PO,PE,P,M.
+*/
+
+static int z80_cond(z80_core *c, UINT_8 cc)
+{
+    if ( c->lazy_op )
+    {
+        switch ( cc & 7 )
+        {
+            case 0:  return ( c->lazy_r != 0 );
+            case 1:  return ( c->lazy_r == 0 );
+            case 2:  return !z80_lazy_carry(c);
+            case 3:  return  z80_lazy_carry(c);
+            case 6:  return !( c->lazy_r & 0x080 );
+            case 7:  return  ( c->lazy_r & 0x080 );
+            default: break;
+        }
+    }
+
+    switch ( cc & 7 )
+    {
+        case 0:  return !( REG_F & Z80_FLAG_Z  );
+        case 1:  return  ( REG_F & Z80_FLAG_Z  );
+        case 2:  return !( REG_F & Z80_FLAG_C  );
+        case 3:  return  ( REG_F & Z80_FLAG_C  );
+        case 4:  return !( REG_F & Z80_FLAG_PV );
+        case 5:  return  ( REG_F & Z80_FLAG_PV );
+        case 6:  return !( REG_F & Z80_FLAG_S  );
+        default: break;
+    }
+
+    return ( REG_F & Z80_FLAG_S );
+}
+
+/*
+   Access to register r (as encoded in bits 2-0 or 5-3 of the opcode),
+   with H and L taken from hl (which is IX or IY for DD/FD ops).  (HL)
+   is not handled here.
+*/
+
+static UINT_8 z80_get_reg(z80_core *c, z80_pair *hl, UINT_8 r)
+{
+    switch ( r & 7 )
+    {
+        case 0:  return REG_B;
+        case 1:  return REG_C;
+        case 2:  return REG_D;
+        case 3:  return REG_E;
+        case 4:  return hl->b.h;
+        case 5:  return hl->b.l;
+        default: break;
+    }
+
+    return REG_A;
+}
+
+static void z80_set_reg(z80_core *c, z80_pair *hl, UINT_8 r, UINT_8 val)
+{
+    switch ( r & 7 )
+    {
+        case 0:  REG_B   = val; break;
+        case 1:  REG_C   = val; break;
+        case 2:  REG_D   = val; break;
+        case 3:  REG_E   = val; break;
+        case 4:  hl->b.h = val; break;
+        case 5:  hl->b.l = val; break;
+        default: REG_A   = val; break;
+    }
+
+    return;
+}
+
+/*
+   ALU op (bits 5-3 of opcode) on A.
+*/
+
+static void z80_alu(z80_core *c, UINT_8 what, UINT_8 val)
+{
+    switch ( what & 7 )
+    {
+        case 0:  z80_add_a(c,val,0);                                    break;
+        case 1:  z80_add_a(c,val,FLAG_CY);      break;
+        case 2:  z80_sub_a(c,val,0,1);                                  break;
+        case 3:  z80_sub_a(c,val,FLAG_CY,1);    break;
+        case 4:  z80_and_a(c,val);                                      break;
+        case 5:  z80_xor_a(c,val);                                      break;
+        case 6:  z80_or_a(c,val);                                       break;
+        default: z80_sub_a(c,val,0,0);                                  break;
+    }
+
+    return;
+}
+
+
+
+
+/***********************************************************************/
+/***********************************************************************/
+/***********************************************************************/
+
+/*
+   Flags for INI/IND/OUTI/OUTD and repeats.  k is the sum described in
+   "The Undocumented Z80 Documented".
+*/
+
+static void z80_block_io_flags(z80_core *c, UINT_8 val, UINT_16 k)
+{
+    c->lazy_op = Z80_LAZY_NONE;
+    REG_F = (UINT_8) ( z80_sz53_table[REG_B]
+                     | ( ( val & 0x080 ) ? Z80_FLAG_N : 0 )
+                     | ( ( k > 0x0ff ) ? ( Z80_FLAG_H | Z80_FLAG_C ) : 0 )
+                     | ( z80_sz53p_table[( k & 7 ) ^ REG_B] & Z80_FLAG_PV ) );
+
+    return;
+}
+
+/*
+   Number of further steps (or loop iterations) of step_clk T-states each
+   that z80cpu_cycle would start before the clock limit is reached, given
+   what has been used so far this step.
+*/
+
+static UINT_32 z80_steps_left(z80_block *z, UINT_32 step_clk)
+{
+    UINT_32 limit;
+    UINT_32 used;
+
+    limit = ( z->clk_count > Z80_CLK_COUNT_BASE ) ? ( z->clk_count - Z80_CLK_COUNT_BASE ) : 0;
+    used  = z->clk + z->core.wait_word;
+
+    if ( used >= limit )
+    {
+        return 0;
+    }
+
+    return ( ( limit - used ) + step_clk - 1 ) / step_clk;
+}
+
+/*
+   Idle loop detector (see above), called at the end of each step if idle
+   loops are being skipped.
+*/
+
+#define Z80_IDLE_MAX_CLK        256
+
+static void z80_idle_step(z80_block *z)
+{
+    z80_core *c = &(z->core);
+    UINT_32 iter_clk;
+    UINT_32 n;
+    UINT_32 limit;
+
+    if ( !c->idle_in )
+    {
+        if ( c->idle_armed )
+        {
+            c->idle_clk += z->clk;
+
+            if ( c->idle_clk > Z80_IDLE_MAX_CLK )
+            {
+                c->idle_armed = 0;
+            }
+        }
+
+        return;
+    }
+
+    c->idle_in = 0;
+
+    z80_flags(c);
+
+    if ( c->idle_armed && ( c->next_op == Z80_NEXT_NORM ) && ( c->i == c->idle_i ) && ( c->st1 == c->idle_st1 ) &&
+         !memcmp(&(c->af),c->idle_regs,sizeof(c->idle_regs)) )
+    {
+        /*
+           Same again: skip as many whole trips around the loop as leave
+           some of the run still to go.
+        */
+
+        iter_clk = c->idle_clk + z->clk;
+        limit    = ( z->clk_count > Z80_CLK_COUNT_BASE ) ? ( z->clk_count - Z80_CLK_COUNT_BASE ) : 0;
+        n        = ( limit > z->clk ) ? ( limit - z->clk - 1 ) / iter_clk : 0;
+
+        z->clk       += n * iter_clk;
+        c->skip_idle += n * iter_clk;
+        c->r          = (UINT_8) ( ( c->r & 0x080 ) | ( ( c->r + n * ( c->r - c->idle_r ) ) & 0x07f ) );
+        c->idle_r     = c->r;
+        c->idle_clk   = 0;
+
+        return;
+    }
+
+    memcpy(c->idle_regs,&(c->af),sizeof(c->idle_regs));
+
+    c->idle_r     = c->r;
+    c->idle_i     = c->i;
+    c->idle_st1   = c->st1;
+    c->idle_clk   = 0;
+    c->idle_armed = 1;
+
+    return;
+}
+
+/*
+   Block instruction bulk runs (see above).  z80_bulk_ok is zero if the
+   next step must be something other than the next iteration.  It is
+   called with the first iteration already done and repeating (PC back on
+   the ED prefix).
+*/
+
+#ifndef Z80_NO_BULK
+
+static int z80_bulk_ok(z80_block *z)
+{
+    z80_core *c = &(z->core);
+
+    if ( c->st2 & ( Z80_ST2_RESET | Z80_ST2_BUSRQ | Z80_ST2_NMI | Z80_ST2_INTOP ) )
+    {
+        return 0;
+    }
+
+    if ( ( c->st2 & Z80_ST2_INT ) && ( c->st1 & Z80_ST1_IFF1 ) )
+    {
+        return 0;
+    }
+
+    if ( ( c->op_mode[c->pc.b.h] != Z80_MEM_DIRECT ) || ( c->op_mode[(UINT_8) ( ( REG_PC + 1 ) >> 8 )] != Z80_MEM_DIRECT ) )
+    {
+        return 0;
+    }
+
+    return 1;
+}
+
+/*
+   Written page memory: throw away cached instructions and translated
+   code for addr to addr+n-1 (all in one page).
+*/
+
+static void z80_bulk_written(z80_block *z, UINT_16 addr, UINT_32 n)
+{
+    z80_core *c = &(z->core);
+    UINT_8 page = (UINT_8) ( addr >> 8 );
+    UINT_32 i;
+
+    c->idle_armed = 0;
+
+    if ( c->dcache[page] != NULL )
+    {
+        for ( i = ( ( addr & 0x0ff ) > 3 ) ? ( addr & 0x0ff ) - 3 : 0 ; i < ( addr & 0x0ff ) + n ; i++ )
+        {
+            (c->dcache[page])[i].state = Z80_DCACHE_EMPTY;
+        }
+    }
+
+    #ifdef Z80_JIT
+    if ( c->jit_code[page] )
+    {
+        for ( i = 0 ; i < n ; i++ )
+        {
+            z80_jit_write(z,(UINT_16) ( addr + i ));
+        }
+    }
+    #endif
+
+    return;
+}
+
+/*
+   Profile n bulk iterations reading from page rd_page (see "Profiling").
+*/
+
+#ifdef Z80_PROFILE
+static void z80_prof_bulk(z80_core *c, UINT_32 n, UINT_8 rd_page)
+{
+    c->prof_bulk += n;
+
+    c->prof.mem[Z80_PROF_OP][c->pc.b.h][Z80_MEM_DIRECT] += n;
+    c->prof.mem[Z80_PROF_OP][(UINT_8) ( ( REG_PC + 1 ) >> 8 )][Z80_MEM_DIRECT] += n;
+    c->prof.mem[Z80_PROF_RD][rd_page][Z80_MEM_DIRECT] += n;
+
+    return;
+}
+#endif
+
+/*
+   LDIR/LDDR, step is 1 or -1.
+*/
+
+static void z80_bulk_ldxr(z80_block *z, UINT_16 step)
+{
+    z80_core *c = &(z->core);
+    UINT_8 *src;
+    UINT_8 *dst;
+    UINT_32 iter_clk;
+    UINT_32 n;
+    UINT_32 i;
+    UINT_16 lo;
+    UINT_8 sp;
+    UINT_8 dp;
+    UINT_8 val;
+
+    while ( REG_BC && z80_bulk_ok(z) )
+    {
+        sp = REG_H;
+        dp = REG_D;
+
+        if ( ( c->rd_mode[sp] != Z80_MEM_DIRECT ) || ( c->wr_mode[dp] != Z80_MEM_DIRECT ) )
+        {
+            break;
+        }
+
+        iter_clk = 8 + c->op_wait[c->pc.b.h] + c->op_wait[(UINT_8) ( ( REG_PC + 1 ) >> 8 )]
+                 + 3 + c->rd_wait[sp] + 3 + c->wr_wait[dp] + 2 + 5;
+
+        /*
+           Iterations: as many as time allows, up to the end of the count
+           and of both pages.
+        */
+
+        n = z80_steps_left(z,iter_clk);
+
+        if ( n > REG_BC ) { n = REG_BC; }
+
+        if ( step == 1 )
+        {
+            if ( n > (UINT_32) ( 0x0100 - REG_L ) ) { n = 0x0100 - REG_L; }
+            if ( n > (UINT_32) ( 0x0100 - REG_E ) ) { n = 0x0100 - REG_E; }
+
+            lo = REG_DE;
+        }
+
+        else
+        {
+            if ( n > (UINT_32) REG_L + 1 ) { n = REG_L + 1; }
+            if ( n > (UINT_32) REG_E + 1 ) { n = REG_E + 1; }
+
+            lo = (UINT_16) ( REG_DE - ( n - 1 ) );
+        }
+
+        if ( ( n == 0 ) || ( (UINT_16) ( REG_PC - lo ) < n ) || ( (UINT_16) ( REG_PC + 1 - lo ) < n ) )
+        {
+            break;
+        }
+
+        /*
+           Move.  A forward move onto the bytes just ahead of the source
+           (or a backward one just behind it) repeats the pattern, as the
+           z80 would, rather than doing what memmove does.
+        */
+
+        src = (c->mem_addr[sp]) + REG_L;
+        dst = (c->mem_addr[dp]) + REG_E;
+
+        if ( step == 1 )
+        {
+            if ( ( dst > src ) && ( dst < src + n ) )
+            {
+                for ( i = 0 ; i < n ; i++ ) { dst[i] = src[i]; }
+            }
+
+            else
+            {
+                memmove(dst,src,n);
+            }
+
+            val = dst[n-1];
+        }
+
+        else
+        {
+            if ( ( dst < src ) && ( dst + n > src ) )
+            {
+                for ( i = 0 ; i < n ; i++ ) { *(dst-i) = *(src-i); }
+            }
+
+            else
+            {
+                memmove(dst-(n-1),src-(n-1),n);
+            }
+
+            val = *(dst-(n-1));
+        }
+
+        z80_bulk_written(z,lo,n);
+
+        REG_HL += (UINT_16) ( step * n );
+        REG_DE += (UINT_16) ( step * n );
+        REG_BC -= (UINT_16) n;
+
+        c->r = (UINT_8) ( ( c->r & 0x080 ) | ( ( c->r + 2 * n ) & 0x07f ) );
+        z->clk += n * iter_clk;
+
+        #ifdef Z80_PROFILE
+        z80_prof_bulk(c,n,sp);
+        c->prof.mem[Z80_PROF_WR][dp][Z80_MEM_DIRECT] += n;
+        #endif
+
+        val = (UINT_8) ( val + REG_A );
+        REG_F = (UINT_8) ( ( REG_F & ( Z80_FLAG_S | Z80_FLAG_Z | Z80_FLAG_C ) )
+                         | ( REG_BC ? Z80_FLAG_PV : 0 )
+                         | ( val & Z80_FLAG_3 )
+                         | ( ( val & 0x002 ) << 4 ) );
+
+        if ( !REG_BC )
+        {
+            /*
+               The last iteration doesn't repeat.
+            */
+
+            z->clk -= 5;
+            REG_PC += 2;
+        }
+    }
+
+    return;
+}
+
+/*
+   CPIR/CPDR, step is 1 or -1.
+*/
+
+static void z80_bulk_cpxr(z80_block *z, UINT_16 step)
+{
+    z80_core *c = &(z->core);
+    UINT_8 *src;
+    UINT_8 *hit;
+    UINT_32 iter_clk;
+    UINT_32 n;
+    UINT_32 i;
+    UINT_8 sp;
+    UINT_8 val;
+    UINT_8 res;
+
+    while ( REG_BC && z80_bulk_ok(z) )
+    {
+        sp = REG_H;
+
+        if ( c->rd_mode[sp] != Z80_MEM_DIRECT )
+        {
+            break;
+        }
+
+        iter_clk = 8 + c->op_wait[c->pc.b.h] + c->op_wait[(UINT_8) ( ( REG_PC + 1 ) >> 8 )]
+                 + 3 + c->rd_wait[sp] + 5 + 5;
+
+        n = z80_steps_left(z,iter_clk);
+
+        if ( n > REG_BC ) { n = REG_BC; }
+
+        if ( step == 1 )
+        {
+            if ( n > (UINT_32) ( 0x0100 - REG_L ) ) { n = 0x0100 - REG_L; }
+        }
+
+        else
+        {
+            if ( n > (UINT_32) REG_L + 1 ) { n = REG_L + 1; }
+        }
+
+        if ( n == 0 )
+        {
+            break;
+        }
+
+        /*
+           Search, stopping at (and including) the first match.
+        */
+
+        src = (c->mem_addr[sp]) + REG_L;
+        hit = NULL;
+
+        if ( step == 1 )
+        {
+            if ( ( hit = (UINT_8 *) memchr(src,REG_A,n) ) != NULL )
+            {
+                n = (UINT_32) ( hit - src ) + 1;
+            }
+
+            val = src[n-1];
+        }
+
+        else
+        {
+            for ( i = 0 ; i < n ; i++ )
+            {
+                if ( *(src-i) == REG_A )
+                {
+                    hit = src-i;
+                    n   = i + 1;
+
+                    break;
+                }
+            }
+
+            val = *(src-(n-1));
+        }
+
+        REG_HL += (UINT_16) ( step * n );
+        REG_BC -= (UINT_16) n;
+
+        c->r = (UINT_8) ( ( c->r & 0x080 ) | ( ( c->r + 2 * n ) & 0x07f ) );
+        z->clk += n * iter_clk;
+
+        #ifdef Z80_PROFILE
+        z80_prof_bulk(c,n,sp);
+        #endif
+
+        res = (UINT_8) ( REG_A - val );
+        REG_F = (UINT_8) ( FLAG_CY
+                         | Z80_FLAG_N
+                         | ( z80_sz53_table[res] & ( Z80_FLAG_S | Z80_FLAG_Z ) )
+                         | ( ( REG_A ^ val ^ res ) & Z80_FLAG_H )
+                         | ( REG_BC ? Z80_FLAG_PV : 0 ) );
+
+        if ( REG_F & Z80_FLAG_H )
+        {
+            res--;
+        }
+
+        REG_F |= (UINT_8) ( ( res & Z80_FLAG_3 ) | ( ( res & 0x002 ) << 4 ) );
+
+        if ( !REG_BC || ( hit != NULL ) )
+        {
+            /*
+               The last iteration doesn't repeat, so WZ is stepped on from
+               PC+1 instead of being set back to it.
+            */
+
+            z->clk -= 5;
+            REG_PC += 2;
+            REG_WZ += step;
+
+            break;
+        }
+    }
+
+    return;
+}
+
+#endif
+
+/*
+   Calculate (IX+d)/(IY+d) address for DD/FD opcodes.
+*/
+
+static UINT_16 z80_index_addr(z80_block *z, z80_pair *xy)
+{
+    z80_core *c = &(z->core);
+    UINT_8 d;
+
+    d = z80_fetch_arg(z);
+    z->clk += 5;
+    REG_WZ = ADD_DISP(xy->w,d);
+
+    return REG_WZ;
+}
+
+/*
+   DDCB/FDCB prefixed opcodes (both prefixes already fetched).  The opcode
+   follows the displacement and is fetched using the opfetch method, but R
+   is only incremented for the two prefixes.  Results for register forms
+   are written to both memory and the (real) register.
+*/
+
+static void z80_exec_index_cb(z80_block *z, z80_pair *xy)
+{
+    z80_core *c = &(z->core);
+    UINT_16 addr;
+    UINT_8 op;
+    UINT_8 reg;
+    UINT_8 bit;
+    UINT_8 val;
+
+    val  = z80_fetch_arg(z);
+    addr = ADD_DISP(xy->w,val);
+    REG_WZ = addr;
+
+    c->r = (UINT_8) ( ( c->r & 0x080 ) | ( ( c->r - 1 ) & 0x07f ) );
+    op  = z80_fetch_op(z);
+    reg = (UINT_8) ( op & 7 );
+    bit = (UINT_8) ( ( op >> 3 ) & 7 );
+
+    z->clk += 1;
+    val = z80_rd_byte(z,addr);
+    z->clk += 1;
+
+    switch ( op >> 6 )
+    {
+        case 0:  val = z80_rot(c,bit,val);                  break;
+        case 1:  z80_bit(c,bit,val,c->wz.b.h);              return;
+        case 2:  val = (UINT_8) ( val & ~( 1 << bit ) );    break;
+        default: val = (UINT_8) ( val | ( 1 << bit ) );     break;
+    }
+
+    z80_wr_byte(z,addr,val);
+
+    if ( reg != 6 )
+    {
+        z80_set_reg(c,&(c->hl),reg,val);
+    }
+
+    return;
+}
+
+
+/***********************************************************************/
+/***********************************************************************/
+/***********************************************************************/
+
+/*
+   Opcode dispatch.  Each opcode has its own handler, and each prefix has
+   its own handler table (main, CB, ED and DD/FD).  Prefixes jump straight
+   to the dispatch for the next table, so an instruction costs one indirect
+   branch per opcode byte, and the common unprefixed case costs just the
+   one.
+
+   With gcc (or anything that claims to be gcc) the tables are arrays of
+   label addresses and dispatch is a computed goto.  Otherwise (or if
+   Z80_NO_THREADED is defined) each table is a switch statement, which is
+   slower but gives identical results.  The difference is clear in
+   z80bench, but small in the whole emulator, where the other modules
+   take most of the time (a few per cent on a BASIC FOR loop).
+
+   DD/FD opcodes that don't involve HL are the same as the unprefixed
+   opcode, so the DD/FD table points those at the main handler.  ED
+   opcodes that aren't defined are NOPs.
+*/
+
+#if defined(__GNUC__) && !defined(Z80_NO_THREADED)
+#define Z80_THREADED
+#endif
+
+#ifdef Z80_THREADED
+#define OPCODE(tab,n)           tab##_##n:
+#define DISPATCH(tab,n)         goto *tab##_tab[n];
+#define DISPATCH_END
+#define DISPATCH_END_MAIN
+#else
+#define OPCODE(tab,n)           case n:
+#define DISPATCH(tab,n)         switch ( n ) {
+#define DISPATCH_END            default: break; } return;
+#define DISPATCH_END_MAIN       default: break; } z80_exec(z,op); return;
+#endif
+
+/*
+   Execute one instruction, starting with opcode op (which has already been
+   fetched).
+*/
+
+static void z80_exec(z80_block *z, UINT_8 op)
+{
+    z80_core *c = &(z->core);
+    z80_pair *xy = &(c->ix);
+    UINT_16 temp;
+    UINT_16 step;
+    UINT_8 val;
+    UINT_8 res;
+
+#ifdef Z80_THREADED
+    static const void *const main_tab[256] =
+    {
+        &&main_0x000, &&main_0x001, &&main_0x002, &&main_0x003,
+        &&main_0x004, &&main_0x005, &&main_0x006, &&main_0x007,
+        &&main_0x008, &&main_0x009, &&main_0x00a, &&main_0x00b,
+        &&main_0x00c, &&main_0x00d, &&main_0x00e, &&main_0x00f,
+        &&main_0x010, &&main_0x011, &&main_0x012, &&main_0x013,
+        &&main_0x014, &&main_0x015, &&main_0x016, &&main_0x017,
+        &&main_0x018, &&main_0x019, &&main_0x01a, &&main_0x01b,
+        &&main_0x01c, &&main_0x01d, &&main_0x01e, &&main_0x01f,
+        &&main_0x020, &&main_0x021, &&main_0x022, &&main_0x023,
+        &&main_0x024, &&main_0x025, &&main_0x026, &&main_0x027,
+        &&main_0x028, &&main_0x029, &&main_0x02a, &&main_0x02b,
+        &&main_0x02c, &&main_0x02d, &&main_0x02e, &&main_0x02f,
+        &&main_0x030, &&main_0x031, &&main_0x032, &&main_0x033,
+        &&main_0x034, &&main_0x035, &&main_0x036, &&main_0x037,
+        &&main_0x038, &&main_0x039, &&main_0x03a, &&main_0x03b,
+        &&main_0x03c, &&main_0x03d, &&main_0x03e, &&main_0x03f,
+        &&main_0x040, &&main_0x041, &&main_0x042, &&main_0x043,
+        &&main_0x044, &&main_0x045, &&main_0x046, &&main_0x047,
+        &&main_0x048, &&main_0x049, &&main_0x04a, &&main_0x04b,
+        &&main_0x04c, &&main_0x04d, &&main_0x04e, &&main_0x04f,
+        &&main_0x050, &&main_0x051, &&main_0x052, &&main_0x053,
+        &&main_0x054, &&main_0x055, &&main_0x056, &&main_0x057,
+        &&main_0x058, &&main_0x059, &&main_0x05a, &&main_0x05b,
+        &&main_0x05c, &&main_0x05d, &&main_0x05e, &&main_0x05f,
+        &&main_0x060, &&main_0x061, &&main_0x062, &&main_0x063,
+        &&main_0x064, &&main_0x065, &&main_0x066, &&main_0x067,
+        &&main_0x068, &&main_0x069, &&main_0x06a, &&main_0x06b,
+        &&main_0x06c, &&main_0x06d, &&main_0x06e, &&main_0x06f,
+        &&main_0x070, &&main_0x071, &&main_0x072, &&main_0x073,
+        &&main_0x074, &&main_0x075, &&main_0x076, &&main_0x077,
+        &&main_0x078, &&main_0x079, &&main_0x07a, &&main_0x07b,
+        &&main_0x07c, &&main_0x07d, &&main_0x07e, &&main_0x07f,
+        &&main_0x080, &&main_0x081, &&main_0x082, &&main_0x083,
+        &&main_0x084, &&main_0x085, &&main_0x086, &&main_0x087,
+        &&main_0x088, &&main_0x089, &&main_0x08a, &&main_0x08b,
+        &&main_0x08c, &&main_0x08d, &&main_0x08e, &&main_0x08f,
+        &&main_0x090, &&main_0x091, &&main_0x092, &&main_0x093,
+        &&main_0x094, &&main_0x095, &&main_0x096, &&main_0x097,
+        &&main_0x098, &&main_0x099, &&main_0x09a, &&main_0x09b,
+        &&main_0x09c, &&main_0x09d, &&main_0x09e, &&main_0x09f,
+        &&main_0x0a0, &&main_0x0a1, &&main_0x0a2, &&main_0x0a3,
+        &&main_0x0a4, &&main_0x0a5, &&main_0x0a6, &&main_0x0a7,
+        &&main_0x0a8, &&main_0x0a9, &&main_0x0aa, &&main_0x0ab,
+        &&main_0x0ac, &&main_0x0ad, &&main_0x0ae, &&main_0x0af,
+        &&main_0x0b0, &&main_0x0b1, &&main_0x0b2, &&main_0x0b3,
+        &&main_0x0b4, &&main_0x0b5, &&main_0x0b6, &&main_0x0b7,
+        &&main_0x0b8, &&main_0x0b9, &&main_0x0ba, &&main_0x0bb,
+        &&main_0x0bc, &&main_0x0bd, &&main_0x0be, &&main_0x0bf,
+        &&main_0x0c0, &&main_0x0c1, &&main_0x0c2, &&main_0x0c3,
+        &&main_0x0c4, &&main_0x0c5, &&main_0x0c6, &&main_0x0c7,
+        &&main_0x0c8, &&main_0x0c9, &&main_0x0ca, &&main_0x0cb,
+        &&main_0x0cc, &&main_0x0cd, &&main_0x0ce, &&main_0x0cf,
+        &&main_0x0d0, &&main_0x0d1, &&main_0x0d2, &&main_0x0d3,
+        &&main_0x0d4, &&main_0x0d5, &&main_0x0d6, &&main_0x0d7,
+        &&main_0x0d8, &&main_0x0d9, &&main_0x0da, &&main_0x0db,
+        &&main_0x0dc, &&main_0x0dd, &&main_0x0de, &&main_0x0df,
+        &&main_0x0e0, &&main_0x0e1, &&main_0x0e2, &&main_0x0e3,
+        &&main_0x0e4, &&main_0x0e5, &&main_0x0e6, &&main_0x0e7,
+        &&main_0x0e8, &&main_0x0e9, &&main_0x0ea, &&main_0x0eb,
+        &&main_0x0ec, &&main_0x0ed, &&main_0x0ee, &&main_0x0ef,
+        &&main_0x0f0, &&main_0x0f1, &&main_0x0f2, &&main_0x0f3,
+        &&main_0x0f4, &&main_0x0f5, &&main_0x0f6, &&main_0x0f7,
+        &&main_0x0f8, &&main_0x0f9, &&main_0x0fa, &&main_0x0fb,
+        &&main_0x0fc, &&main_0x0fd, &&main_0x0fe, &&main_0x0ff
+    };
+
+    static const void *const cb_tab[256] =
+    {
+        &&cb_0x000, &&cb_0x001, &&cb_0x002, &&cb_0x003,
+        &&cb_0x004, &&cb_0x005, &&cb_0x006, &&cb_0x007,
+        &&cb_0x008, &&cb_0x009, &&cb_0x00a, &&cb_0x00b,
+        &&cb_0x00c, &&cb_0x00d, &&cb_0x00e, &&cb_0x00f,
+        &&cb_0x010, &&cb_0x011, &&cb_0x012, &&cb_0x013,
+        &&cb_0x014, &&cb_0x015, &&cb_0x016, &&cb_0x017,
+        &&cb_0x018, &&cb_0x019, &&cb_0x01a, &&cb_0x01b,
+        &&cb_0x01c, &&cb_0x01d, &&cb_0x01e, &&cb_0x01f,
+        &&cb_0x020, &&cb_0x021, &&cb_0x022, &&cb_0x023,
+        &&cb_0x024, &&cb_0x025, &&cb_0x026, &&cb_0x027,
+        &&cb_0x028, &&cb_0x029, &&cb_0x02a, &&cb_0x02b,
+        &&cb_0x02c, &&cb_0x02d, &&cb_0x02e, &&cb_0x02f,
+        &&cb_0x030, &&cb_0x031, &&cb_0x032, &&cb_0x033,
+        &&cb_0x034, &&cb_0x035, &&cb_0x036, &&cb_0x037,
+        &&cb_0x038, &&cb_0x039, &&cb_0x03a, &&cb_0x03b,
+        &&cb_0x03c, &&cb_0x03d, &&cb_0x03e, &&cb_0x03f,
+        &&cb_0x040, &&cb_0x041, &&cb_0x042, &&cb_0x043,
+        &&cb_0x044, &&cb_0x045, &&cb_0x046, &&cb_0x047,
+        &&cb_0x048, &&cb_0x049, &&cb_0x04a, &&cb_0x04b,
+        &&cb_0x04c, &&cb_0x04d, &&cb_0x04e, &&cb_0x04f,
+        &&cb_0x050, &&cb_0x051, &&cb_0x052, &&cb_0x053,
+        &&cb_0x054, &&cb_0x055, &&cb_0x056, &&cb_0x057,
+        &&cb_0x058, &&cb_0x059, &&cb_0x05a, &&cb_0x05b,
+        &&cb_0x05c, &&cb_0x05d, &&cb_0x05e, &&cb_0x05f,
+        &&cb_0x060, &&cb_0x061, &&cb_0x062, &&cb_0x063,
+        &&cb_0x064, &&cb_0x065, &&cb_0x066, &&cb_0x067,
+        &&cb_0x068, &&cb_0x069, &&cb_0x06a, &&cb_0x06b,
+        &&cb_0x06c, &&cb_0x06d, &&cb_0x06e, &&cb_0x06f,
+        &&cb_0x070, &&cb_0x071, &&cb_0x072, &&cb_0x073,
+        &&cb_0x074, &&cb_0x075, &&cb_0x076, &&cb_0x077,
+        &&cb_0x078, &&cb_0x079, &&cb_0x07a, &&cb_0x07b,
+        &&cb_0x07c, &&cb_0x07d, &&cb_0x07e, &&cb_0x07f,
+        &&cb_0x080, &&cb_0x081, &&cb_0x082, &&cb_0x083,
+        &&cb_0x084, &&cb_0x085, &&cb_0x086, &&cb_0x087,
+        &&cb_0x088, &&cb_0x089, &&cb_0x08a, &&cb_0x08b,
+        &&cb_0x08c, &&cb_0x08d, &&cb_0x08e, &&cb_0x08f,
+        &&cb_0x090, &&cb_0x091, &&cb_0x092, &&cb_0x093,
+        &&cb_0x094, &&cb_0x095, &&cb_0x096, &&cb_0x097,
+        &&cb_0x098, &&cb_0x099, &&cb_0x09a, &&cb_0x09b,
+        &&cb_0x09c, &&cb_0x09d, &&cb_0x09e, &&cb_0x09f,
+        &&cb_0x0a0, &&cb_0x0a1, &&cb_0x0a2, &&cb_0x0a3,
+        &&cb_0x0a4, &&cb_0x0a5, &&cb_0x0a6, &&cb_0x0a7,
+        &&cb_0x0a8, &&cb_0x0a9, &&cb_0x0aa, &&cb_0x0ab,
+        &&cb_0x0ac, &&cb_0x0ad, &&cb_0x0ae, &&cb_0x0af,
+        &&cb_0x0b0, &&cb_0x0b1, &&cb_0x0b2, &&cb_0x0b3,
+        &&cb_0x0b4, &&cb_0x0b5, &&cb_0x0b6, &&cb_0x0b7,
+        &&cb_0x0b8, &&cb_0x0b9, &&cb_0x0ba, &&cb_0x0bb,
+        &&cb_0x0bc, &&cb_0x0bd, &&cb_0x0be, &&cb_0x0bf,
+        &&cb_0x0c0, &&cb_0x0c1, &&cb_0x0c2, &&cb_0x0c3,
+        &&cb_0x0c4, &&cb_0x0c5, &&cb_0x0c6, &&cb_0x0c7,
+        &&cb_0x0c8, &&cb_0x0c9, &&cb_0x0ca, &&cb_0x0cb,
+        &&cb_0x0cc, &&cb_0x0cd, &&cb_0x0ce, &&cb_0x0cf,
+        &&cb_0x0d0, &&cb_0x0d1, &&cb_0x0d2, &&cb_0x0d3,
+        &&cb_0x0d4, &&cb_0x0d5, &&cb_0x0d6, &&cb_0x0d7,
+        &&cb_0x0d8, &&cb_0x0d9, &&cb_0x0da, &&cb_0x0db,
+        &&cb_0x0dc, &&cb_0x0dd, &&cb_0x0de, &&cb_0x0df,
+        &&cb_0x0e0, &&cb_0x0e1, &&cb_0x0e2, &&cb_0x0e3,
+        &&cb_0x0e4, &&cb_0x0e5, &&cb_0x0e6, &&cb_0x0e7,
+        &&cb_0x0e8, &&cb_0x0e9, &&cb_0x0ea, &&cb_0x0eb,
+        &&cb_0x0ec, &&cb_0x0ed, &&cb_0x0ee, &&cb_0x0ef,
+        &&cb_0x0f0, &&cb_0x0f1, &&cb_0x0f2, &&cb_0x0f3,
+        &&cb_0x0f4, &&cb_0x0f5, &&cb_0x0f6, &&cb_0x0f7,
+        &&cb_0x0f8, &&cb_0x0f9, &&cb_0x0fa, &&cb_0x0fb,
+        &&cb_0x0fc, &&cb_0x0fd, &&cb_0x0fe, &&cb_0x0ff
+    };
+
+    static const void *const ed_tab[256] =
+    {
+        &&ed_0x000, &&ed_0x000, &&ed_0x000, &&ed_0x000,
+        &&ed_0x000, &&ed_0x000, &&ed_0x000, &&ed_0x000,
+        &&ed_0x000, &&ed_0x000, &&ed_0x000, &&ed_0x000,
+        &&ed_0x000, &&ed_0x000, &&ed_0x000, &&ed_0x000,
+        &&ed_0x000, &&ed_0x000, &&ed_0x000, &&ed_0x000,
+        &&ed_0x000, &&ed_0x000, &&ed_0x000, &&ed_0x000,
+        &&ed_0x000, &&ed_0x000, &&ed_0x000, &&ed_0x000,
+        &&ed_0x000, &&ed_0x000, &&ed_0x000, &&ed_0x000,
+        &&ed_0x000, &&ed_0x000, &&ed_0x000, &&ed_0x000,
+        &&ed_0x000, &&ed_0x000, &&ed_0x000, &&ed_0x000,
+        &&ed_0x000, &&ed_0x000, &&ed_0x000, &&ed_0x000,
+        &&ed_0x000, &&ed_0x000, &&ed_0x000, &&ed_0x000,
+        &&ed_0x000, &&ed_0x000, &&ed_0x000, &&ed_0x000,
+        &&ed_0x000, &&ed_0x000, &&ed_0x000, &&ed_0x000,
+        &&ed_0x000, &&ed_0x000, &&ed_0x000, &&ed_0x000,
+        &&ed_0x000, &&ed_0x000, &&ed_0x000, &&ed_0x000,
+        &&ed_0x040, &&ed_0x041, &&ed_0x042, &&ed_0x043,
+        &&ed_0x044, &&ed_0x045, &&ed_0x046, &&ed_0x047,
+        &&ed_0x048, &&ed_0x049, &&ed_0x04a, &&ed_0x04b,
+        &&ed_0x04c, &&ed_0x04d, &&ed_0x04e, &&ed_0x04f,
+        &&ed_0x050, &&ed_0x051, &&ed_0x052, &&ed_0x053,
+        &&ed_0x054, &&ed_0x055, &&ed_0x056, &&ed_0x057,
+        &&ed_0x058, &&ed_0x059, &&ed_0x05a, &&ed_0x05b,
+        &&ed_0x05c, &&ed_0x05d, &&ed_0x05e, &&ed_0x05f,
+        &&ed_0x060, &&ed_0x061, &&ed_0x062, &&ed_0x063,
+        &&ed_0x064, &&ed_0x065, &&ed_0x066, &&ed_0x067,
+        &&ed_0x068, &&ed_0x069, &&ed_0x06a, &&ed_0x06b,
+        &&ed_0x06c, &&ed_0x06d, &&ed_0x06e, &&ed_0x06f,
+        &&ed_0x070, &&ed_0x071, &&ed_0x072, &&ed_0x073,
+        &&ed_0x074, &&ed_0x075, &&ed_0x076, &&ed_0x000,
+        &&ed_0x078, &&ed_0x079, &&ed_0x07a, &&ed_0x07b,
+        &&ed_0x07c, &&ed_0x07d, &&ed_0x07e, &&ed_0x000,
+        &&ed_0x000, &&ed_0x000, &&ed_0x000, &&ed_0x000,
+        &&ed_0x000, &&ed_0x000, &&ed_0x000, &&ed_0x000,
+        &&ed_0x000, &&ed_0x000, &&ed_0x000, &&ed_0x000,
+        &&ed_0x000, &&ed_0x000, &&ed_0x000, &&ed_0x000,
+        &&ed_0x000, &&ed_0x000, &&ed_0x000, &&ed_0x000,
+        &&ed_0x000, &&ed_0x000, &&ed_0x000, &&ed_0x000,
+        &&ed_0x000, &&ed_0x000, &&ed_0x000, &&ed_0x000,
+        &&ed_0x000, &&ed_0x000, &&ed_0x000, &&ed_0x000,
+        &&ed_0x0a0, &&ed_0x0a1, &&ed_0x0a2, &&ed_0x0a3,
+        &&ed_0x000, &&ed_0x000, &&ed_0x000, &&ed_0x000,
+        &&ed_0x0a8, &&ed_0x0a9, &&ed_0x0aa, &&ed_0x0ab,
+        &&ed_0x000, &&ed_0x000, &&ed_0x000, &&ed_0x000,
+        &&ed_0x0b0, &&ed_0x0b1, &&ed_0x0b2, &&ed_0x0b3,
+        &&ed_0x000, &&ed_0x000, &&ed_0x000, &&ed_0x000,
+        &&ed_0x0b8, &&ed_0x0b9, &&ed_0x0ba, &&ed_0x0bb,
+        &&ed_0x000, &&ed_0x000, &&ed_0x000, &&ed_0x000,
+        &&ed_0x000, &&ed_0x000, &&ed_0x000, &&ed_0x000,
+        &&ed_0x000, &&ed_0x000, &&ed_0x000, &&ed_0x000,
+        &&ed_0x000, &&ed_0x000, &&ed_0x000, &&ed_0x000,
+        &&ed_0x000, &&ed_0x000, &&ed_0x000, &&ed_0x000,
+        &&ed_0x000, &&ed_0x000, &&ed_0x000, &&ed_0x000,
+        &&ed_0x000, &&ed_0x000, &&ed_0x000, &&ed_0x000,
+        &&ed_0x000, &&ed_0x000, &&ed_0x000, &&ed_0x000,
+        &&ed_0x000, &&ed_0x000, &&ed_0x000, &&ed_0x000,
+        &&ed_0x000, &&ed_0x000, &&ed_0x000, &&ed_0x000,
+        &&ed_0x000, &&ed_0x000, &&ed_0x000, &&ed_0x000,
+        &&ed_0x000, &&ed_0x000, &&ed_0x000, &&ed_0x000,
+        &&ed_0x000, &&ed_0x000, &&ed_0x000, &&ed_0x000,
+        &&ed_0x000, &&ed_0x000, &&ed_0x000, &&ed_0x000,
+        &&ed_0x000, &&ed_0x000, &&ed_0x000, &&ed_0x000,
+        &&ed_0x000, &&ed_0x000, &&ed_0x000, &&ed_0x000,
+        &&ed_0x000, &&ed_0x000, &&ed_0x000, &&ed_0x000
+    };
+
+    static const void *const index_tab[256] =
+    {
+        &&main_0x000, &&main_0x001, &&main_0x002, &&main_0x003,
+        &&main_0x004, &&main_0x005, &&main_0x006, &&main_0x007,
+        &&main_0x008, &&index_0x009, &&main_0x00a, &&main_0x00b,
+        &&main_0x00c, &&main_0x00d, &&main_0x00e, &&main_0x00f,
+        &&main_0x010, &&main_0x011, &&main_0x012, &&main_0x013,
+        &&main_0x014, &&main_0x015, &&main_0x016, &&main_0x017,
+        &&main_0x018, &&index_0x019, &&main_0x01a, &&main_0x01b,
+        &&main_0x01c, &&main_0x01d, &&main_0x01e, &&main_0x01f,
+        &&main_0x020, &&index_0x021, &&index_0x022, &&index_0x023,
+        &&index_0x024, &&index_0x025, &&index_0x026, &&main_0x027,
+        &&main_0x028, &&index_0x029, &&index_0x02a, &&index_0x02b,
+        &&index_0x02c, &&index_0x02d, &&index_0x02e, &&main_0x02f,
+        &&main_0x030, &&main_0x031, &&main_0x032, &&main_0x033,
+        &&index_0x034, &&index_0x035, &&index_0x036, &&main_0x037,
+        &&main_0x038, &&index_0x039, &&main_0x03a, &&main_0x03b,
+        &&main_0x03c, &&main_0x03d, &&main_0x03e, &&main_0x03f,
+        &&main_0x040, &&main_0x041, &&main_0x042, &&main_0x043,
+        &&index_0x044, &&index_0x045, &&index_0x046, &&main_0x047,
+        &&main_0x048, &&main_0x049, &&main_0x04a, &&main_0x04b,
+        &&index_0x04c, &&index_0x04d, &&index_0x04e, &&main_0x04f,
+        &&main_0x050, &&main_0x051, &&main_0x052, &&main_0x053,
+        &&index_0x054, &&index_0x055, &&index_0x056, &&main_0x057,
+        &&main_0x058, &&main_0x059, &&main_0x05a, &&main_0x05b,
+        &&index_0x05c, &&index_0x05d, &&index_0x05e, &&main_0x05f,
+        &&index_0x060, &&index_0x061, &&index_0x062, &&index_0x063,
+        &&index_0x064, &&index_0x065, &&index_0x066, &&index_0x067,
+        &&index_0x068, &&index_0x069, &&index_0x06a, &&index_0x06b,
+        &&index_0x06c, &&index_0x06d, &&index_0x06e, &&index_0x06f,
+        &&index_0x070, &&index_0x071, &&index_0x072, &&index_0x073,
+        &&index_0x074, &&index_0x075, &&main_0x076, &&index_0x077,
+        &&main_0x078, &&main_0x079, &&main_0x07a, &&main_0x07b,
+        &&index_0x07c, &&index_0x07d, &&index_0x07e, &&main_0x07f,
+        &&main_0x080, &&main_0x081, &&main_0x082, &&main_0x083,
+        &&index_0x084, &&index_0x085, &&index_0x086, &&main_0x087,
+        &&main_0x088, &&main_0x089, &&main_0x08a, &&main_0x08b,
+        &&index_0x08c, &&index_0x08d, &&index_0x08e, &&main_0x08f,
+        &&main_0x090, &&main_0x091, &&main_0x092, &&main_0x093,
+        &&index_0x094, &&index_0x095, &&index_0x096, &&main_0x097,
+        &&main_0x098, &&main_0x099, &&main_0x09a, &&main_0x09b,
+        &&index_0x09c, &&index_0x09d, &&index_0x09e, &&main_0x09f,
+        &&main_0x0a0, &&main_0x0a1, &&main_0x0a2, &&main_0x0a3,
+        &&index_0x0a4, &&index_0x0a5, &&index_0x0a6, &&main_0x0a7,
+        &&main_0x0a8, &&main_0x0a9, &&main_0x0aa, &&main_0x0ab,
+        &&index_0x0ac, &&index_0x0ad, &&index_0x0ae, &&main_0x0af,
+        &&main_0x0b0, &&main_0x0b1, &&main_0x0b2, &&main_0x0b3,
+        &&index_0x0b4, &&index_0x0b5, &&index_0x0b6, &&main_0x0b7,
+        &&main_0x0b8, &&main_0x0b9, &&main_0x0ba, &&main_0x0bb,
+        &&index_0x0bc, &&index_0x0bd, &&index_0x0be, &&main_0x0bf,
+        &&main_0x0c0, &&main_0x0c1, &&main_0x0c2, &&main_0x0c3,
+        &&main_0x0c4, &&main_0x0c5, &&main_0x0c6, &&main_0x0c7,
+        &&main_0x0c8, &&main_0x0c9, &&main_0x0ca, &&index_0x0cb,
+        &&main_0x0cc, &&main_0x0cd, &&main_0x0ce, &&main_0x0cf,
+        &&main_0x0d0, &&main_0x0d1, &&main_0x0d2, &&main_0x0d3,
+        &&main_0x0d4, &&main_0x0d5, &&main_0x0d6, &&main_0x0d7,
+        &&main_0x0d8, &&main_0x0d9, &&main_0x0da, &&main_0x0db,
+        &&main_0x0dc, &&index_0x0dd, &&main_0x0de, &&main_0x0df,
+        &&main_0x0e0, &&index_0x0e1, &&main_0x0e2, &&index_0x0e3,
+        &&main_0x0e4, &&index_0x0e5, &&main_0x0e6, &&main_0x0e7,
+        &&main_0x0e8, &&index_0x0e9, &&main_0x0ea, &&main_0x0eb,
+        &&main_0x0ec, &&main_0x0ed, &&main_0x0ee, &&main_0x0ef,
+        &&main_0x0f0, &&main_0x0f1, &&main_0x0f2, &&main_0x0f3,
+        &&main_0x0f4, &&main_0x0f5, &&main_0x0f6, &&main_0x0f7,
+        &&main_0x0f8, &&index_0x0f9, &&main_0x0fa, &&main_0x0fb,
+        &&main_0x0fc, &&index_0x0fd, &&main_0x0fe, &&main_0x0ff
+    };
+#endif
+
+    /*
+       Unprefixed opcodes.
+    */
+
+    DISPATCH(main,op)
+
+    OPCODE(main,0x000) /* NOP */
+    {
+        return;
+    }
+
+    OPCODE(main,0x001) REG_BC = z80_fetch_arg16(z); return; /* LD BC,nn */
+    OPCODE(main,0x011) REG_DE = z80_fetch_arg16(z); return; /* LD DE,nn */
+    OPCODE(main,0x021) REG_HL = z80_fetch_arg16(z); return; /* LD HL,nn */
+    OPCODE(main,0x031) REG_SP = z80_fetch_arg16(z); return; /* LD SP,nn */
+
+    OPCODE(main,0x002) /* LD (BC),A */
+    {
+        z80_wr_byte(z,REG_BC,REG_A);
+        REG_WZ = (UINT_16) ( ( REG_A << 8 ) | ( ( REG_BC + 1 ) & 0x0ff ) );
+        return;
+    }
+
+    OPCODE(main,0x012) /* LD (DE),A */
+    {
+        z80_wr_byte(z,REG_DE,REG_A);
+        REG_WZ = (UINT_16) ( ( REG_A << 8 ) | ( ( REG_DE + 1 ) & 0x0ff ) );
+        return;
+    }
+
+    OPCODE(main,0x00a) /* LD A,(BC) */
+    {
+        REG_A  = z80_rd_byte(z,REG_BC);
+        REG_WZ = (UINT_16) ( REG_BC + 1 );
+        return;
+    }
+
+    OPCODE(main,0x01a) /* LD A,(DE) */
+    {
+        REG_A  = z80_rd_byte(z,REG_DE);
+        REG_WZ = (UINT_16) ( REG_DE + 1 );
+        return;
+    }
+
+    OPCODE(main,0x003) z->clk += 2; REG_BC++; return; /* INC BC */
+    OPCODE(main,0x013) z->clk += 2; REG_DE++; return; /* INC DE */
+    OPCODE(main,0x023) z->clk += 2; REG_HL++; return; /* INC HL */
+    OPCODE(main,0x033) z->clk += 2; REG_SP++; return; /* INC SP */
+    OPCODE(main,0x00b) z->clk += 2; REG_BC--; return; /* DEC BC */
+    OPCODE(main,0x01b) z->clk += 2; REG_DE--; return; /* DEC DE */
+    OPCODE(main,0x02b) z->clk += 2; REG_HL--; return; /* DEC HL */
+    OPCODE(main,0x03b) z->clk += 2; REG_SP--; return; /* DEC SP */
+
+    OPCODE(main,0x004) REG_B = z80_inc8(c,REG_B); return; /* INC B */
+    OPCODE(main,0x00c) REG_C = z80_inc8(c,REG_C); return; /* INC C */
+    OPCODE(main,0x014) REG_D = z80_inc8(c,REG_D); return; /* INC D */
+    OPCODE(main,0x01c) REG_E = z80_inc8(c,REG_E); return; /* INC E */
+    OPCODE(main,0x024) REG_H = z80_inc8(c,REG_H); return; /* INC H */
+    OPCODE(main,0x02c) REG_L = z80_inc8(c,REG_L); return; /* INC L */
+    OPCODE(main,0x03c) REG_A = z80_inc8(c,REG_A); return; /* INC A */
+    OPCODE(main,0x005) REG_B = z80_dec8(c,REG_B); return; /* DEC B */
+    OPCODE(main,0x00d) REG_C = z80_dec8(c,REG_C); return; /* DEC C */
+    OPCODE(main,0x015) REG_D = z80_dec8(c,REG_D); return; /* DEC D */
+    OPCODE(main,0x01d) REG_E = z80_dec8(c,REG_E); return; /* DEC E */
+    OPCODE(main,0x025) REG_H = z80_dec8(c,REG_H); return; /* DEC H */
+    OPCODE(main,0x02d) REG_L = z80_dec8(c,REG_L); return; /* DEC L */
+    OPCODE(main,0x03d) REG_A = z80_dec8(c,REG_A); return; /* DEC A */
+
+    OPCODE(main,0x034) /* INC (HL) */
+    {
+        val = z80_rd_byte(z,REG_HL);
+        z->clk += 1;
+        z80_wr_byte(z,REG_HL,z80_inc8(c,val));
+        return;
+    }
+
+    OPCODE(main,0x035) /* DEC (HL) */
+    {
+        val = z80_rd_byte(z,REG_HL);
+        z->clk += 1;
+        z80_wr_byte(z,REG_HL,z80_dec8(c,val));
+        return;
+    }
+
+    OPCODE(main,0x006) REG_B = z80_fetch_arg(z); return; /* LD B,n */
+    OPCODE(main,0x00e) REG_C = z80_fetch_arg(z); return; /* LD C,n */
+    OPCODE(main,0x016) REG_D = z80_fetch_arg(z); return; /* LD D,n */
+    OPCODE(main,0x01e) REG_E = z80_fetch_arg(z); return; /* LD E,n */
+    OPCODE(main,0x026) REG_H = z80_fetch_arg(z); return; /* LD H,n */
+    OPCODE(main,0x02e) REG_L = z80_fetch_arg(z); return; /* LD L,n */
+    OPCODE(main,0x03e) REG_A = z80_fetch_arg(z); return; /* LD A,n */
+
+    OPCODE(main,0x036) /* LD (HL),n */
+    {
+        val = z80_fetch_arg(z);
+        z80_wr_byte(z,REG_HL,val);
+        return;
+    }
+
+    OPCODE(main,0x007) /* RLCA */
+    {
+        REG_A = (UINT_8) ( ( REG_A << 1 ) | ( REG_A >> 7 ) );
+        REG_F = (UINT_8) ( ( REG_F & FLAGS_SZPV ) | ( REG_A & ( FLAGS_53 | Z80_FLAG_C ) ) );
+        return;
+    }
+
+    OPCODE(main,0x00f) /* RRCA */
+    {
+        REG_F = (UINT_8) ( ( REG_F & FLAGS_SZPV ) | ( REG_A & Z80_FLAG_C ) );
+        REG_A = (UINT_8) ( ( REG_A >> 1 ) | ( REG_A << 7 ) );
+        REG_F |= (UINT_8) ( REG_A & FLAGS_53 );
+        return;
+    }
+
+    OPCODE(main,0x017) /* RLA */
+    {
+        val   = (UINT_8) ( REG_A >> 7 );
+        REG_A = (UINT_8) ( ( REG_A << 1 ) | FLAG_CY );
+        REG_F = (UINT_8) ( ( REG_F & FLAGS_SZPV ) | ( REG_A & FLAGS_53 ) | val );
+        return;
+    }
+
+    OPCODE(main,0x01f) /* RRA */
+    {
+        val   = (UINT_8) ( REG_A & Z80_FLAG_C );
+        REG_A = (UINT_8) ( ( REG_A >> 1 ) | ( FLAG_CY << 7 ) );
+        REG_F = (UINT_8) ( ( REG_F & FLAGS_SZPV ) | ( REG_A & FLAGS_53 ) | val );
+        return;
+    }
+
+    OPCODE(main,0x008) /* EX AF,AF' */
+    {
+        temp   = REG_AF;
+        REG_AF = c->afx.w;
+        c->afx.w = temp;
+        return;
+    }
+
+    OPCODE(main,0x009) z->clk += 7; REG_HL = z80_add16(c,REG_HL,REG_BC); return; /* ADD HL,BC */
+    OPCODE(main,0x019) z->clk += 7; REG_HL = z80_add16(c,REG_HL,REG_DE); return; /* ADD HL,DE */
+    OPCODE(main,0x029) z->clk += 7; REG_HL = z80_add16(c,REG_HL,REG_HL); return; /* ADD HL,HL */
+    OPCODE(main,0x039) z->clk += 7; REG_HL = z80_add16(c,REG_HL,REG_SP); return; /* ADD HL,SP */
+
+    OPCODE(main,0x010) /* DJNZ d */
+    {
+        z->clk += 1;
+        val = z80_fetch_arg(z);
+        REG_B--;
+
+        if ( REG_B )
+        {
+            z->clk += 5;
+            REG_PC = ADD_DISP(REG_PC,val);
+            REG_WZ = REG_PC;
+        }
+
+        return;
+    }
+
+    OPCODE(main,0x018) /* JR d */
+    {
+        val = z80_fetch_arg(z);
+        z->clk += 5;
+        REG_PC = ADD_DISP(REG_PC,val);
+        REG_WZ = REG_PC;
+        return;
+    }
+
+    OPCODE(main,0x020) /* JR NZ,d */
+    OPCODE(main,0x028) /* JR Z,d  */
+    OPCODE(main,0x030) /* JR NC,d */
+    OPCODE(main,0x038) /* JR C,d  */
+    {
+        val = z80_fetch_arg(z);
+
+        if ( z80_cond(c,(UINT_8) ( ( op >> 3 ) & 3 )) )
+        {
+            z->clk += 5;
+            REG_PC = ADD_DISP(REG_PC,val);
+            REG_WZ = REG_PC;
+        }
+
+        return;
+    }
+
+    OPCODE(main,0x022) /* LD (nn),HL */
+    {
+        temp = z80_fetch_arg16(z);
+        z80_wr_word(z,temp,REG_HL);
+        REG_WZ = (UINT_16) ( temp + 1 );
+        return;
+    }
+
+    OPCODE(main,0x02a) /* LD HL,(nn) */
+    {
+        temp = z80_fetch_arg16(z);
+        REG_HL = z80_rd_word(z,temp);
+        REG_WZ = (UINT_16) ( temp + 1 );
+        return;
+    }
+
+    OPCODE(main,0x032) /* LD (nn),A */
+    {
+        temp = z80_fetch_arg16(z);
+        z80_wr_byte(z,temp,REG_A);
+        REG_WZ = (UINT_16) ( ( REG_A << 8 ) | ( ( temp + 1 ) & 0x0ff ) );
+        return;
+    }
+
+    OPCODE(main,0x03a) /* LD A,(nn) */
+    {
+        temp = z80_fetch_arg16(z);
+        REG_A = z80_rd_byte(z,temp);
+        REG_WZ = (UINT_16) ( temp + 1 );
+        return;
+    }
+
+    OPCODE(main,0x027) /* DAA */
+    {
+        z80_daa(c);
+        return;
+    }
+
+    OPCODE(main,0x02f) /* CPL */
+    {
+        REG_A = (UINT_8) ~REG_A;
+        REG_F = (UINT_8) ( ( REG_F & ( FLAGS_SZPV | Z80_FLAG_C ) ) | Z80_FLAG_H | Z80_FLAG_N | ( REG_A & FLAGS_53 ) );
+        return;
+    }
+
+    OPCODE(main,0x037) /* SCF */
+    {
+        REG_F = (UINT_8) ( ( REG_F & FLAGS_SZPV ) | ( REG_A & FLAGS_53 ) | Z80_FLAG_C );
+        return;
+    }
+
+    OPCODE(main,0x03f) /* CCF */
+    {
+        REG_F = (UINT_8) ( ( REG_F & FLAGS_SZPV ) | ( REG_A & FLAGS_53 ) | ( FLAG_CY ? Z80_FLAG_H : Z80_FLAG_C ) );
+        return;
+    }
+
+    OPCODE(main,0x076) /* HALT */
+    {
+        c->st2 |= Z80_ST2_HALTED;
+        z80_ack_halt((void *) z);
+        return;
+    }
+
+    OPCODE(main,0x040) return; /* LD B,B */
+    OPCODE(main,0x041) REG_B = REG_C; return; /* LD B,C */
+    OPCODE(main,0x042) REG_B = REG_D; return; /* LD B,D */
+    OPCODE(main,0x043) REG_B = REG_E; return; /* LD B,E */
+    OPCODE(main,0x044) REG_B = REG_H; return; /* LD B,H */
+    OPCODE(main,0x045) REG_B = REG_L; return; /* LD B,L */
+    OPCODE(main,0x046) REG_B = z80_rd_byte(z,REG_HL); return; /* LD B,(HL) */
+    OPCODE(main,0x047) REG_B = REG_A; return; /* LD B,A */
+    OPCODE(main,0x048) REG_C = REG_B; return; /* LD C,B */
+    OPCODE(main,0x049) return; /* LD C,C */
+    OPCODE(main,0x04a) REG_C = REG_D; return; /* LD C,D */
+    OPCODE(main,0x04b) REG_C = REG_E; return; /* LD C,E */
+    OPCODE(main,0x04c) REG_C = REG_H; return; /* LD C,H */
+    OPCODE(main,0x04d) REG_C = REG_L; return; /* LD C,L */
+    OPCODE(main,0x04e) REG_C = z80_rd_byte(z,REG_HL); return; /* LD C,(HL) */
+    OPCODE(main,0x04f) REG_C = REG_A; return; /* LD C,A */
+    OPCODE(main,0x050) REG_D = REG_B; return; /* LD D,B */
+    OPCODE(main,0x051) REG_D = REG_C; return; /* LD D,C */
+    OPCODE(main,0x052) return; /* LD D,D */
+    OPCODE(main,0x053) REG_D = REG_E; return; /* LD D,E */
+    OPCODE(main,0x054) REG_D = REG_H; return; /* LD D,H */
+    OPCODE(main,0x055) REG_D = REG_L; return; /* LD D,L */
+    OPCODE(main,0x056) REG_D = z80_rd_byte(z,REG_HL); return; /* LD D,(HL) */
+    OPCODE(main,0x057) REG_D = REG_A; return; /* LD D,A */
+    OPCODE(main,0x058) REG_E = REG_B; return; /* LD E,B */
+    OPCODE(main,0x059) REG_E = REG_C; return; /* LD E,C */
+    OPCODE(main,0x05a) REG_E = REG_D; return; /* LD E,D */
+    OPCODE(main,0x05b) return; /* LD E,E */
+    OPCODE(main,0x05c) REG_E = REG_H; return; /* LD E,H */
+    OPCODE(main,0x05d) REG_E = REG_L; return; /* LD E,L */
+    OPCODE(main,0x05e) REG_E = z80_rd_byte(z,REG_HL); return; /* LD E,(HL) */
+    OPCODE(main,0x05f) REG_E = REG_A; return; /* LD E,A */
+    OPCODE(main,0x060) REG_H = REG_B; return; /* LD H,B */
+    OPCODE(main,0x061) REG_H = REG_C; return; /* LD H,C */
+    OPCODE(main,0x062) REG_H = REG_D; return; /* LD H,D */
+    OPCODE(main,0x063) REG_H = REG_E; return; /* LD H,E */
+    OPCODE(main,0x064) return; /* LD H,H */
+    OPCODE(main,0x065) REG_H = REG_L; return; /* LD H,L */
+    OPCODE(main,0x066) REG_H = z80_rd_byte(z,REG_HL); return; /* LD H,(HL) */
+    OPCODE(main,0x067) REG_H = REG_A; return; /* LD H,A */
+    OPCODE(main,0x068) REG_L = REG_B; return; /* LD L,B */
+    OPCODE(main,0x069) REG_L = REG_C; return; /* LD L,C */
+    OPCODE(main,0x06a) REG_L = REG_D; return; /* LD L,D */
+    OPCODE(main,0x06b) REG_L = REG_E; return; /* LD L,E */
+    OPCODE(main,0x06c) REG_L = REG_H; return; /* LD L,H */
+    OPCODE(main,0x06d) return; /* LD L,L */
+    OPCODE(main,0x06e) REG_L = z80_rd_byte(z,REG_HL); return; /* LD L,(HL) */
+    OPCODE(main,0x06f) REG_L = REG_A; return; /* LD L,A */
+    OPCODE(main,0x070) z80_wr_byte(z,REG_HL,REG_B); return; /* LD (HL),B */
+    OPCODE(main,0x071) z80_wr_byte(z,REG_HL,REG_C); return; /* LD (HL),C */
+    OPCODE(main,0x072) z80_wr_byte(z,REG_HL,REG_D); return; /* LD (HL),D */
+    OPCODE(main,0x073) z80_wr_byte(z,REG_HL,REG_E); return; /* LD (HL),E */
+    OPCODE(main,0x074) z80_wr_byte(z,REG_HL,REG_H); return; /* LD (HL),H */
+    OPCODE(main,0x075) z80_wr_byte(z,REG_HL,REG_L); return; /* LD (HL),L */
+    OPCODE(main,0x077) z80_wr_byte(z,REG_HL,REG_A); return; /* LD (HL),A */
+    OPCODE(main,0x078) REG_A = REG_B; return; /* LD A,B */
+    OPCODE(main,0x079) REG_A = REG_C; return; /* LD A,C */
+    OPCODE(main,0x07a) REG_A = REG_D; return; /* LD A,D */
+    OPCODE(main,0x07b) REG_A = REG_E; return; /* LD A,E */
+    OPCODE(main,0x07c) REG_A = REG_H; return; /* LD A,H */
+    OPCODE(main,0x07d) REG_A = REG_L; return; /* LD A,L */
+    OPCODE(main,0x07e) REG_A = z80_rd_byte(z,REG_HL); return; /* LD A,(HL) */
+    OPCODE(main,0x07f) return; /* LD A,A */
+    OPCODE(main,0x080) z80_add_a(c,REG_B,0); return; /* ADD A,B */
+    OPCODE(main,0x081) z80_add_a(c,REG_C,0); return; /* ADD A,C */
+    OPCODE(main,0x082) z80_add_a(c,REG_D,0); return; /* ADD A,D */
+    OPCODE(main,0x083) z80_add_a(c,REG_E,0); return; /* ADD A,E */
+    OPCODE(main,0x084) z80_add_a(c,REG_H,0); return; /* ADD A,H */
+    OPCODE(main,0x085) z80_add_a(c,REG_L,0); return; /* ADD A,L */
+    OPCODE(main,0x086) z80_add_a(c,z80_rd_byte(z,REG_HL),0); return; /* ADD A,(HL) */
+    OPCODE(main,0x087) z80_add_a(c,REG_A,0); return; /* ADD A,A */
+    OPCODE(main,0x088) z80_add_a(c,REG_B,FLAG_CY); return; /* ADC A,B */
+    OPCODE(main,0x089) z80_add_a(c,REG_C,FLAG_CY); return; /* ADC A,C */
+    OPCODE(main,0x08a) z80_add_a(c,REG_D,FLAG_CY); return; /* ADC A,D */
+    OPCODE(main,0x08b) z80_add_a(c,REG_E,FLAG_CY); return; /* ADC A,E */
+    OPCODE(main,0x08c) z80_add_a(c,REG_H,FLAG_CY); return; /* ADC A,H */
+    OPCODE(main,0x08d) z80_add_a(c,REG_L,FLAG_CY); return; /* ADC A,L */
+    OPCODE(main,0x08e) z80_add_a(c,z80_rd_byte(z,REG_HL),FLAG_CY); return; /* ADC A,(HL) */
+    OPCODE(main,0x08f) z80_add_a(c,REG_A,FLAG_CY); return; /* ADC A,A */
+    OPCODE(main,0x090) z80_sub_a(c,REG_B,0,1); return; /* SUB B */
+    OPCODE(main,0x091) z80_sub_a(c,REG_C,0,1); return; /* SUB C */
+    OPCODE(main,0x092) z80_sub_a(c,REG_D,0,1); return; /* SUB D */
+    OPCODE(main,0x093) z80_sub_a(c,REG_E,0,1); return; /* SUB E */
+    OPCODE(main,0x094) z80_sub_a(c,REG_H,0,1); return; /* SUB H */
+    OPCODE(main,0x095) z80_sub_a(c,REG_L,0,1); return; /* SUB L */
+    OPCODE(main,0x096) z80_sub_a(c,z80_rd_byte(z,REG_HL),0,1); return; /* SUB (HL) */
+    OPCODE(main,0x097) z80_sub_a(c,REG_A,0,1); return; /* SUB A */
+    OPCODE(main,0x098) z80_sub_a(c,REG_B,FLAG_CY,1); return; /* SBC A,B */
+    OPCODE(main,0x099) z80_sub_a(c,REG_C,FLAG_CY,1); return; /* SBC A,C */
+    OPCODE(main,0x09a) z80_sub_a(c,REG_D,FLAG_CY,1); return; /* SBC A,D */
+    OPCODE(main,0x09b) z80_sub_a(c,REG_E,FLAG_CY,1); return; /* SBC A,E */
+    OPCODE(main,0x09c) z80_sub_a(c,REG_H,FLAG_CY,1); return; /* SBC A,H */
+    OPCODE(main,0x09d) z80_sub_a(c,REG_L,FLAG_CY,1); return; /* SBC A,L */
+    OPCODE(main,0x09e) z80_sub_a(c,z80_rd_byte(z,REG_HL),FLAG_CY,1); return; /* SBC A,(HL) */
+    OPCODE(main,0x09f) z80_sub_a(c,REG_A,FLAG_CY,1); return; /* SBC A,A */
+    OPCODE(main,0x0a0) z80_and_a(c,REG_B); return; /* AND B */
+    OPCODE(main,0x0a1) z80_and_a(c,REG_C); return; /* AND C */
+    OPCODE(main,0x0a2) z80_and_a(c,REG_D); return; /* AND D */
+    OPCODE(main,0x0a3) z80_and_a(c,REG_E); return; /* AND E */
+    OPCODE(main,0x0a4) z80_and_a(c,REG_H); return; /* AND H */
+    OPCODE(main,0x0a5) z80_and_a(c,REG_L); return; /* AND L */
+    OPCODE(main,0x0a6) z80_and_a(c,z80_rd_byte(z,REG_HL)); return; /* AND (HL) */
+    OPCODE(main,0x0a7) z80_and_a(c,REG_A); return; /* AND A */
+    OPCODE(main,0x0a8) z80_xor_a(c,REG_B); return; /* XOR B */
+    OPCODE(main,0x0a9) z80_xor_a(c,REG_C); return; /* XOR C */
+    OPCODE(main,0x0aa) z80_xor_a(c,REG_D); return; /* XOR D */
+    OPCODE(main,0x0ab) z80_xor_a(c,REG_E); return; /* XOR E */
+    OPCODE(main,0x0ac) z80_xor_a(c,REG_H); return; /* XOR H */
+    OPCODE(main,0x0ad) z80_xor_a(c,REG_L); return; /* XOR L */
+    OPCODE(main,0x0ae) z80_xor_a(c,z80_rd_byte(z,REG_HL)); return; /* XOR (HL) */
+    OPCODE(main,0x0af) z80_xor_a(c,REG_A); return; /* XOR A */
+    OPCODE(main,0x0b0) z80_or_a(c,REG_B); return; /* OR B */
+    OPCODE(main,0x0b1) z80_or_a(c,REG_C); return; /* OR C */
+    OPCODE(main,0x0b2) z80_or_a(c,REG_D); return; /* OR D */
+    OPCODE(main,0x0b3) z80_or_a(c,REG_E); return; /* OR E */
+    OPCODE(main,0x0b4) z80_or_a(c,REG_H); return; /* OR H */
+    OPCODE(main,0x0b5) z80_or_a(c,REG_L); return; /* OR L */
+    OPCODE(main,0x0b6) z80_or_a(c,z80_rd_byte(z,REG_HL)); return; /* OR (HL) */
+    OPCODE(main,0x0b7) z80_or_a(c,REG_A); return; /* OR A */
+    OPCODE(main,0x0b8) z80_sub_a(c,REG_B,0,0); return; /* CP B */
+    OPCODE(main,0x0b9) z80_sub_a(c,REG_C,0,0); return; /* CP C */
+    OPCODE(main,0x0ba) z80_sub_a(c,REG_D,0,0); return; /* CP D */
+    OPCODE(main,0x0bb) z80_sub_a(c,REG_E,0,0); return; /* CP E */
+    OPCODE(main,0x0bc) z80_sub_a(c,REG_H,0,0); return; /* CP H */
+    OPCODE(main,0x0bd) z80_sub_a(c,REG_L,0,0); return; /* CP L */
+    OPCODE(main,0x0be) z80_sub_a(c,z80_rd_byte(z,REG_HL),0,0); return; /* CP (HL) */
+    OPCODE(main,0x0bf) z80_sub_a(c,REG_A,0,0); return; /* CP A */
+
+    OPCODE(main,0x0c0) /* RET NZ */
+    OPCODE(main,0x0c8) /* RET Z  */
+    OPCODE(main,0x0d0) /* RET NC */
+    OPCODE(main,0x0d8) /* RET C  */
+    OPCODE(main,0x0e0) /* RET PO */
+    OPCODE(main,0x0e8) /* RET PE */
+    OPCODE(main,0x0f0) /* RET P  */
+    OPCODE(main,0x0f8) /* RET M  */
+    {
+        z->clk += 1;
+
+        if ( z80_cond(c,(UINT_8) ( op >> 3 )) )
+        {
+            REG_PC = z80_pop(z);
+            REG_WZ = REG_PC;
+        }
+
+        return;
+    }
+
+    OPCODE(main,0x0c9) /* RET */
+    {
+        REG_PC = z80_pop(z);
+        REG_WZ = REG_PC;
+        return;
+    }
+
+    OPCODE(main,0x0c1) REG_BC = z80_pop(z); return; /* POP BC */
+    OPCODE(main,0x0d1) REG_DE = z80_pop(z); return; /* POP DE */
+    OPCODE(main,0x0e1) REG_HL = z80_pop(z); return; /* POP HL */
+    OPCODE(main,0x0f1) REG_AF = z80_pop(z); return; /* POP AF */
+
+    OPCODE(main,0x0c5) z->clk += 1; z80_push(z,REG_BC); return; /* PUSH BC */
+    OPCODE(main,0x0d5) z->clk += 1; z80_push(z,REG_DE); return; /* PUSH DE */
+    OPCODE(main,0x0e5) z->clk += 1; z80_push(z,REG_HL); return; /* PUSH HL */
+    OPCODE(main,0x0f5) z->clk += 1; z80_push(z,REG_AF); return; /* PUSH AF */
+
+    OPCODE(main,0x0c2) /* JP NZ,nn */
+    OPCODE(main,0x0ca) /* JP Z,nn  */
+    OPCODE(main,0x0d2) /* JP NC,nn */
+    OPCODE(main,0x0da) /* JP C,nn  */
+    OPCODE(main,0x0e2) /* JP PO,nn */
+    OPCODE(main,0x0ea) /* JP PE,nn */
+    OPCODE(main,0x0f2) /* JP P,nn  */
+    OPCODE(main,0x0fa) /* JP M,nn  */
+    {
+        REG_WZ = z80_fetch_arg16(z);
+
+        if ( z80_cond(c,(UINT_8) ( op >> 3 )) )
+        {
+            REG_PC = REG_WZ;
+        }
+
+        return;
+    }
+
+    OPCODE(main,0x0c3) /* JP nn */
+    {
+        REG_WZ = z80_fetch_arg16(z);
+        REG_PC = REG_WZ;
+        return;
+    }
+
+    OPCODE(main,0x0c4) /* CALL NZ,nn */
+    OPCODE(main,0x0cc) /* CALL Z,nn  */
+    OPCODE(main,0x0d4) /* CALL NC,nn */
+    OPCODE(main,0x0dc) /* CALL C,nn  */
+    OPCODE(main,0x0e4) /* CALL PO,nn */
+    OPCODE(main,0x0ec) /* CALL PE,nn */
+    OPCODE(main,0x0f4) /* CALL P,nn  */
+    OPCODE(main,0x0fc) /* CALL M,nn  */
+    {
+        REG_WZ = z80_fetch_arg16(z);
+
+        if ( z80_cond(c,(UINT_8) ( op >> 3 )) )
+        {
+            z->clk += 1;
+            z80_push(z,REG_PC);
+            REG_PC = REG_WZ;
+        }
+
+        return;
+    }
+
+    OPCODE(main,0x0cd) /* CALL nn */
+    {
+        REG_WZ = z80_fetch_arg16(z);
+        z->clk += 1;
+        z80_push(z,REG_PC);
+        REG_PC = REG_WZ;
+        return;
+    }
+
+    OPCODE(main,0x0c6) /* ADD A,n */
+    OPCODE(main,0x0ce) /* ADC A,n */
+    OPCODE(main,0x0d6) /* SUB n   */
+    OPCODE(main,0x0de) /* SBC A,n */
+    OPCODE(main,0x0e6) /* AND n   */
+    OPCODE(main,0x0ee) /* XOR n   */
+    OPCODE(main,0x0f6) /* OR n    */
+    OPCODE(main,0x0fe) /* CP n    */
+    {
+        z80_alu(c,(UINT_8) ( op >> 3 ),z80_fetch_arg(z));
+        return;
+    }
+
+    OPCODE(main,0x0c7) /* RST 00 */
+    OPCODE(main,0x0cf) /* RST 08 */
+    OPCODE(main,0x0d7) /* RST 10 */
+    OPCODE(main,0x0df) /* RST 18 */
+    OPCODE(main,0x0e7) /* RST 20 */
+    OPCODE(main,0x0ef) /* RST 28 */
+    OPCODE(main,0x0f7) /* RST 30 */
+    OPCODE(main,0x0ff) /* RST 38 */
+    {
+        z->clk += 1;
+        z80_push(z,REG_PC);
+        REG_PC = (UINT_16) ( op & 0x038 );
+        REG_WZ = REG_PC;
+        return;
+    }
+
+    OPCODE(main,0x0cb) /* CB prefix */
+    {
+        goto cb_prefix;
+    }
+
+    OPCODE(main,0x0ed) /* ED prefix */
+    {
+        goto ed_prefix;
+    }
+
+    OPCODE(main,0x0dd) /* DD prefix */
+    {
+        xy = &(c->ix);
+        goto index_prefix;
+    }
+
+    OPCODE(main,0x0fd) /* FD prefix */
+    {
+        xy = &(c->iy);
+        goto index_prefix;
+    }
+
+    OPCODE(main,0x0d3) /* OUT (n),A */
+    {
+        val = z80_fetch_arg(z);
+        z80_out_byte(z,(UINT_16) ( ( REG_A << 8 ) | val ),REG_A);
+        REG_WZ = (UINT_16) ( ( REG_A << 8 ) | ( ( val + 1 ) & 0x0ff ) );
+        return;
+    }
+
+    OPCODE(main,0x0db) /* IN A,(n) */
+    {
+        temp = (UINT_16) ( ( REG_A << 8 ) | z80_fetch_arg(z) );
+        REG_A = z80_in_byte(z,temp);
+        REG_WZ = (UINT_16) ( temp + 1 );
+        c->idle_in = 1;
+        return;
+    }
+
+    OPCODE(main,0x0d9) /* EXX */
+    {
+        temp = REG_BC; REG_BC = c->bcx.w; c->bcx.w = temp;
+        temp = REG_DE; REG_DE = c->dex.w; c->dex.w = temp;
+        temp = REG_HL; REG_HL = c->hlx.w; c->hlx.w = temp;
+        return;
+    }
+
+    OPCODE(main,0x0e3) /* EX (SP),HL */
+    {
+        temp = z80_rd_byte(z,REG_SP);
+        temp |= (UINT_16) ( z80_rd_byte(z,(UINT_16) ( REG_SP + 1 )) << 8 );
+        z->clk += 1;
+        z80_wr_byte(z,(UINT_16) ( REG_SP + 1 ),REG_H);
+        z80_wr_byte(z,REG_SP,REG_L);
+        z->clk += 2;
+        REG_HL = temp;
+        REG_WZ = temp;
+        return;
+    }
+
+    OPCODE(main,0x0e9) /* JP (HL) */
+    {
+        REG_PC = REG_HL;
+        return;
+    }
+
+    OPCODE(main,0x0eb) /* EX DE,HL */
+    {
+        temp   = REG_DE;
+        REG_DE = REG_HL;
+        REG_HL = temp;
+        return;
+    }
+
+    OPCODE(main,0x0f3) /* DI */
+    {
+        c->st1 &= (UINT_8) ~( Z80_ST1_IFF1 | Z80_ST1_IFF2 );
+        c->st1 |= Z80_ST1_DI;
+        return;
+    }
+
+    OPCODE(main,0x0fb) /* EI */
+    {
+        c->st1 |= Z80_ST1_IFF1 | Z80_ST1_IFF2 | Z80_ST1_DI;
+        return;
+    }
+
+    OPCODE(main,0x0f9) /* LD SP,HL */
+    {
+        z->clk += 2;
+        REG_SP = REG_HL;
+        return;
+    }
+
+    DISPATCH_END
+
+    /*
+       CB prefixed opcodes.  (HL) forms share a handler per group.
+    */
+
+    cb_prefix:
+
+    op = z80_fetch_op(z);
+
+    DISPATCH(cb,op)
+
+    OPCODE(cb,0x000) REG_B = z80_rot(c,0,REG_B); return; /* RLC B */
+    OPCODE(cb,0x001) REG_C = z80_rot(c,0,REG_C); return; /* RLC C */
+    OPCODE(cb,0x002) REG_D = z80_rot(c,0,REG_D); return; /* RLC D */
+    OPCODE(cb,0x003) REG_E = z80_rot(c,0,REG_E); return; /* RLC E */
+    OPCODE(cb,0x004) REG_H = z80_rot(c,0,REG_H); return; /* RLC H */
+    OPCODE(cb,0x005) REG_L = z80_rot(c,0,REG_L); return; /* RLC L */
+    OPCODE(cb,0x007) REG_A = z80_rot(c,0,REG_A); return; /* RLC A */
+    OPCODE(cb,0x008) REG_B = z80_rot(c,1,REG_B); return; /* RRC B */
+    OPCODE(cb,0x009) REG_C = z80_rot(c,1,REG_C); return; /* RRC C */
+    OPCODE(cb,0x00a) REG_D = z80_rot(c,1,REG_D); return; /* RRC D */
+    OPCODE(cb,0x00b) REG_E = z80_rot(c,1,REG_E); return; /* RRC E */
+    OPCODE(cb,0x00c) REG_H = z80_rot(c,1,REG_H); return; /* RRC H */
+    OPCODE(cb,0x00d) REG_L = z80_rot(c,1,REG_L); return; /* RRC L */
+    OPCODE(cb,0x00f) REG_A = z80_rot(c,1,REG_A); return; /* RRC A */
+    OPCODE(cb,0x010) REG_B = z80_rot(c,2,REG_B); return; /* RL B */
+    OPCODE(cb,0x011) REG_C = z80_rot(c,2,REG_C); return; /* RL C */
+    OPCODE(cb,0x012) REG_D = z80_rot(c,2,REG_D); return; /* RL D */
+    OPCODE(cb,0x013) REG_E = z80_rot(c,2,REG_E); return; /* RL E */
+    OPCODE(cb,0x014) REG_H = z80_rot(c,2,REG_H); return; /* RL H */
+    OPCODE(cb,0x015) REG_L = z80_rot(c,2,REG_L); return; /* RL L */
+    OPCODE(cb,0x017) REG_A = z80_rot(c,2,REG_A); return; /* RL A */
+    OPCODE(cb,0x018) REG_B = z80_rot(c,3,REG_B); return; /* RR B */
+    OPCODE(cb,0x019) REG_C = z80_rot(c,3,REG_C); return; /* RR C */
+    OPCODE(cb,0x01a) REG_D = z80_rot(c,3,REG_D); return; /* RR D */
+    OPCODE(cb,0x01b) REG_E = z80_rot(c,3,REG_E); return; /* RR E */
+    OPCODE(cb,0x01c) REG_H = z80_rot(c,3,REG_H); return; /* RR H */
+    OPCODE(cb,0x01d) REG_L = z80_rot(c,3,REG_L); return; /* RR L */
+    OPCODE(cb,0x01f) REG_A = z80_rot(c,3,REG_A); return; /* RR A */
+    OPCODE(cb,0x020) REG_B = z80_rot(c,4,REG_B); return; /* SLA B */
+    OPCODE(cb,0x021) REG_C = z80_rot(c,4,REG_C); return; /* SLA C */
+    OPCODE(cb,0x022) REG_D = z80_rot(c,4,REG_D); return; /* SLA D */
+    OPCODE(cb,0x023) REG_E = z80_rot(c,4,REG_E); return; /* SLA E */
+    OPCODE(cb,0x024) REG_H = z80_rot(c,4,REG_H); return; /* SLA H */
+    OPCODE(cb,0x025) REG_L = z80_rot(c,4,REG_L); return; /* SLA L */
+    OPCODE(cb,0x027) REG_A = z80_rot(c,4,REG_A); return; /* SLA A */
+    OPCODE(cb,0x028) REG_B = z80_rot(c,5,REG_B); return; /* SRA B */
+    OPCODE(cb,0x029) REG_C = z80_rot(c,5,REG_C); return; /* SRA C */
+    OPCODE(cb,0x02a) REG_D = z80_rot(c,5,REG_D); return; /* SRA D */
+    OPCODE(cb,0x02b) REG_E = z80_rot(c,5,REG_E); return; /* SRA E */
+    OPCODE(cb,0x02c) REG_H = z80_rot(c,5,REG_H); return; /* SRA H */
+    OPCODE(cb,0x02d) REG_L = z80_rot(c,5,REG_L); return; /* SRA L */
+    OPCODE(cb,0x02f) REG_A = z80_rot(c,5,REG_A); return; /* SRA A */
+    OPCODE(cb,0x030) REG_B = z80_rot(c,6,REG_B); return; /* SLL B */
+    OPCODE(cb,0x031) REG_C = z80_rot(c,6,REG_C); return; /* SLL C */
+    OPCODE(cb,0x032) REG_D = z80_rot(c,6,REG_D); return; /* SLL D */
+    OPCODE(cb,0x033) REG_E = z80_rot(c,6,REG_E); return; /* SLL E */
+    OPCODE(cb,0x034) REG_H = z80_rot(c,6,REG_H); return; /* SLL H */
+    OPCODE(cb,0x035) REG_L = z80_rot(c,6,REG_L); return; /* SLL L */
+    OPCODE(cb,0x037) REG_A = z80_rot(c,6,REG_A); return; /* SLL A */
+    OPCODE(cb,0x038) REG_B = z80_rot(c,7,REG_B); return; /* SRL B */
+    OPCODE(cb,0x039) REG_C = z80_rot(c,7,REG_C); return; /* SRL C */
+    OPCODE(cb,0x03a) REG_D = z80_rot(c,7,REG_D); return; /* SRL D */
+    OPCODE(cb,0x03b) REG_E = z80_rot(c,7,REG_E); return; /* SRL E */
+    OPCODE(cb,0x03c) REG_H = z80_rot(c,7,REG_H); return; /* SRL H */
+    OPCODE(cb,0x03d) REG_L = z80_rot(c,7,REG_L); return; /* SRL L */
+    OPCODE(cb,0x03f) REG_A = z80_rot(c,7,REG_A); return; /* SRL A */
+
+    OPCODE(cb,0x006) /* RLC (HL) */
+    OPCODE(cb,0x00e) /* RRC (HL) */
+    OPCODE(cb,0x016) /* RL (HL) */
+    OPCODE(cb,0x01e) /* RR (HL) */
+    OPCODE(cb,0x026) /* SLA (HL) */
+    OPCODE(cb,0x02e) /* SRA (HL) */
+    OPCODE(cb,0x036) /* SLL (HL) */
+    OPCODE(cb,0x03e) /* SRL (HL) */
+    {
+        val = z80_rd_byte(z,REG_HL);
+        z->clk += 1;
+        z80_wr_byte(z,REG_HL,z80_rot(c,(UINT_8) ( ( op >> 3 ) & 7 ),val));
+        return;
+    }
+
+    OPCODE(cb,0x040) z80_bit(c,0,REG_B,REG_B); return; /* BIT 0,B */
+    OPCODE(cb,0x041) z80_bit(c,0,REG_C,REG_C); return; /* BIT 0,C */
+    OPCODE(cb,0x042) z80_bit(c,0,REG_D,REG_D); return; /* BIT 0,D */
+    OPCODE(cb,0x043) z80_bit(c,0,REG_E,REG_E); return; /* BIT 0,E */
+    OPCODE(cb,0x044) z80_bit(c,0,REG_H,REG_H); return; /* BIT 0,H */
+    OPCODE(cb,0x045) z80_bit(c,0,REG_L,REG_L); return; /* BIT 0,L */
+    OPCODE(cb,0x047) z80_bit(c,0,REG_A,REG_A); return; /* BIT 0,A */
+    OPCODE(cb,0x048) z80_bit(c,1,REG_B,REG_B); return; /* BIT 1,B */
+    OPCODE(cb,0x049) z80_bit(c,1,REG_C,REG_C); return; /* BIT 1,C */
+    OPCODE(cb,0x04a) z80_bit(c,1,REG_D,REG_D); return; /* BIT 1,D */
+    OPCODE(cb,0x04b) z80_bit(c,1,REG_E,REG_E); return; /* BIT 1,E */
+    OPCODE(cb,0x04c) z80_bit(c,1,REG_H,REG_H); return; /* BIT 1,H */
+    OPCODE(cb,0x04d) z80_bit(c,1,REG_L,REG_L); return; /* BIT 1,L */
+    OPCODE(cb,0x04f) z80_bit(c,1,REG_A,REG_A); return; /* BIT 1,A */
+    OPCODE(cb,0x050) z80_bit(c,2,REG_B,REG_B); return; /* BIT 2,B */
+    OPCODE(cb,0x051) z80_bit(c,2,REG_C,REG_C); return; /* BIT 2,C */
+    OPCODE(cb,0x052) z80_bit(c,2,REG_D,REG_D); return; /* BIT 2,D */
+    OPCODE(cb,0x053) z80_bit(c,2,REG_E,REG_E); return; /* BIT 2,E */
+    OPCODE(cb,0x054) z80_bit(c,2,REG_H,REG_H); return; /* BIT 2,H */
+    OPCODE(cb,0x055) z80_bit(c,2,REG_L,REG_L); return; /* BIT 2,L */
+    OPCODE(cb,0x057) z80_bit(c,2,REG_A,REG_A); return; /* BIT 2,A */
+    OPCODE(cb,0x058) z80_bit(c,3,REG_B,REG_B); return; /* BIT 3,B */
+    OPCODE(cb,0x059) z80_bit(c,3,REG_C,REG_C); return; /* BIT 3,C */
+    OPCODE(cb,0x05a) z80_bit(c,3,REG_D,REG_D); return; /* BIT 3,D */
+    OPCODE(cb,0x05b) z80_bit(c,3,REG_E,REG_E); return; /* BIT 3,E */
+    OPCODE(cb,0x05c) z80_bit(c,3,REG_H,REG_H); return; /* BIT 3,H */
+    OPCODE(cb,0x05d) z80_bit(c,3,REG_L,REG_L); return; /* BIT 3,L */
+    OPCODE(cb,0x05f) z80_bit(c,3,REG_A,REG_A); return; /* BIT 3,A */
+    OPCODE(cb,0x060) z80_bit(c,4,REG_B,REG_B); return; /* BIT 4,B */
+    OPCODE(cb,0x061) z80_bit(c,4,REG_C,REG_C); return; /* BIT 4,C */
+    OPCODE(cb,0x062) z80_bit(c,4,REG_D,REG_D); return; /* BIT 4,D */
+    OPCODE(cb,0x063) z80_bit(c,4,REG_E,REG_E); return; /* BIT 4,E */
+    OPCODE(cb,0x064) z80_bit(c,4,REG_H,REG_H); return; /* BIT 4,H */
+    OPCODE(cb,0x065) z80_bit(c,4,REG_L,REG_L); return; /* BIT 4,L */
+    OPCODE(cb,0x067) z80_bit(c,4,REG_A,REG_A); return; /* BIT 4,A */
+    OPCODE(cb,0x068) z80_bit(c,5,REG_B,REG_B); return; /* BIT 5,B */
+    OPCODE(cb,0x069) z80_bit(c,5,REG_C,REG_C); return; /* BIT 5,C */
+    OPCODE(cb,0x06a) z80_bit(c,5,REG_D,REG_D); return; /* BIT 5,D */
+    OPCODE(cb,0x06b) z80_bit(c,5,REG_E,REG_E); return; /* BIT 5,E */
+    OPCODE(cb,0x06c) z80_bit(c,5,REG_H,REG_H); return; /* BIT 5,H */
+    OPCODE(cb,0x06d) z80_bit(c,5,REG_L,REG_L); return; /* BIT 5,L */
+    OPCODE(cb,0x06f) z80_bit(c,5,REG_A,REG_A); return; /* BIT 5,A */
+    OPCODE(cb,0x070) z80_bit(c,6,REG_B,REG_B); return; /* BIT 6,B */
+    OPCODE(cb,0x071) z80_bit(c,6,REG_C,REG_C); return; /* BIT 6,C */
+    OPCODE(cb,0x072) z80_bit(c,6,REG_D,REG_D); return; /* BIT 6,D */
+    OPCODE(cb,0x073) z80_bit(c,6,REG_E,REG_E); return; /* BIT 6,E */
+    OPCODE(cb,0x074) z80_bit(c,6,REG_H,REG_H); return; /* BIT 6,H */
+    OPCODE(cb,0x075) z80_bit(c,6,REG_L,REG_L); return; /* BIT 6,L */
+    OPCODE(cb,0x077) z80_bit(c,6,REG_A,REG_A); return; /* BIT 6,A */
+    OPCODE(cb,0x078) z80_bit(c,7,REG_B,REG_B); return; /* BIT 7,B */
+    OPCODE(cb,0x079) z80_bit(c,7,REG_C,REG_C); return; /* BIT 7,C */
+    OPCODE(cb,0x07a) z80_bit(c,7,REG_D,REG_D); return; /* BIT 7,D */
+    OPCODE(cb,0x07b) z80_bit(c,7,REG_E,REG_E); return; /* BIT 7,E */
+    OPCODE(cb,0x07c) z80_bit(c,7,REG_H,REG_H); return; /* BIT 7,H */
+    OPCODE(cb,0x07d) z80_bit(c,7,REG_L,REG_L); return; /* BIT 7,L */
+    OPCODE(cb,0x07f) z80_bit(c,7,REG_A,REG_A); return; /* BIT 7,A */
+
+    OPCODE(cb,0x046) /* BIT 0,(HL) */
+    OPCODE(cb,0x04e) /* BIT 1,(HL) */
+    OPCODE(cb,0x056) /* BIT 2,(HL) */
+    OPCODE(cb,0x05e) /* BIT 3,(HL) */
+    OPCODE(cb,0x066) /* BIT 4,(HL) */
+    OPCODE(cb,0x06e) /* BIT 5,(HL) */
+    OPCODE(cb,0x076) /* BIT 6,(HL) */
+    OPCODE(cb,0x07e) /* BIT 7,(HL) */
+    {
+        val = z80_rd_byte(z,REG_HL);
+        z->clk += 1;
+        z80_bit(c,(UINT_8) ( ( op >> 3 ) & 7 ),val,c->wz.b.h);
+        return;
+    }
+
+    OPCODE(cb,0x080) REG_B &= 0x0fe; return; /* RES 0,B */
+    OPCODE(cb,0x081) REG_C &= 0x0fe; return; /* RES 0,C */
+    OPCODE(cb,0x082) REG_D &= 0x0fe; return; /* RES 0,D */
+    OPCODE(cb,0x083) REG_E &= 0x0fe; return; /* RES 0,E */
+    OPCODE(cb,0x084) REG_H &= 0x0fe; return; /* RES 0,H */
+    OPCODE(cb,0x085) REG_L &= 0x0fe; return; /* RES 0,L */
+    OPCODE(cb,0x087) REG_A &= 0x0fe; return; /* RES 0,A */
+    OPCODE(cb,0x088) REG_B &= 0x0fd; return; /* RES 1,B */
+    OPCODE(cb,0x089) REG_C &= 0x0fd; return; /* RES 1,C */
+    OPCODE(cb,0x08a) REG_D &= 0x0fd; return; /* RES 1,D */
+    OPCODE(cb,0x08b) REG_E &= 0x0fd; return; /* RES 1,E */
+    OPCODE(cb,0x08c) REG_H &= 0x0fd; return; /* RES 1,H */
+    OPCODE(cb,0x08d) REG_L &= 0x0fd; return; /* RES 1,L */
+    OPCODE(cb,0x08f) REG_A &= 0x0fd; return; /* RES 1,A */
+    OPCODE(cb,0x090) REG_B &= 0x0fb; return; /* RES 2,B */
+    OPCODE(cb,0x091) REG_C &= 0x0fb; return; /* RES 2,C */
+    OPCODE(cb,0x092) REG_D &= 0x0fb; return; /* RES 2,D */
+    OPCODE(cb,0x093) REG_E &= 0x0fb; return; /* RES 2,E */
+    OPCODE(cb,0x094) REG_H &= 0x0fb; return; /* RES 2,H */
+    OPCODE(cb,0x095) REG_L &= 0x0fb; return; /* RES 2,L */
+    OPCODE(cb,0x097) REG_A &= 0x0fb; return; /* RES 2,A */
+    OPCODE(cb,0x098) REG_B &= 0x0f7; return; /* RES 3,B */
+    OPCODE(cb,0x099) REG_C &= 0x0f7; return; /* RES 3,C */
+    OPCODE(cb,0x09a) REG_D &= 0x0f7; return; /* RES 3,D */
+    OPCODE(cb,0x09b) REG_E &= 0x0f7; return; /* RES 3,E */
+    OPCODE(cb,0x09c) REG_H &= 0x0f7; return; /* RES 3,H */
+    OPCODE(cb,0x09d) REG_L &= 0x0f7; return; /* RES 3,L */
+    OPCODE(cb,0x09f) REG_A &= 0x0f7; return; /* RES 3,A */
+    OPCODE(cb,0x0a0) REG_B &= 0x0ef; return; /* RES 4,B */
+    OPCODE(cb,0x0a1) REG_C &= 0x0ef; return; /* RES 4,C */
+    OPCODE(cb,0x0a2) REG_D &= 0x0ef; return; /* RES 4,D */
+    OPCODE(cb,0x0a3) REG_E &= 0x0ef; return; /* RES 4,E */
+    OPCODE(cb,0x0a4) REG_H &= 0x0ef; return; /* RES 4,H */
+    OPCODE(cb,0x0a5) REG_L &= 0x0ef; return; /* RES 4,L */
+    OPCODE(cb,0x0a7) REG_A &= 0x0ef; return; /* RES 4,A */
+    OPCODE(cb,0x0a8) REG_B &= 0x0df; return; /* RES 5,B */
+    OPCODE(cb,0x0a9) REG_C &= 0x0df; return; /* RES 5,C */
+    OPCODE(cb,0x0aa) REG_D &= 0x0df; return; /* RES 5,D */
+    OPCODE(cb,0x0ab) REG_E &= 0x0df; return; /* RES 5,E */
+    OPCODE(cb,0x0ac) REG_H &= 0x0df; return; /* RES 5,H */
+    OPCODE(cb,0x0ad) REG_L &= 0x0df; return; /* RES 5,L */
+    OPCODE(cb,0x0af) REG_A &= 0x0df; return; /* RES 5,A */
+    OPCODE(cb,0x0b0) REG_B &= 0x0bf; return; /* RES 6,B */
+    OPCODE(cb,0x0b1) REG_C &= 0x0bf; return; /* RES 6,C */
+    OPCODE(cb,0x0b2) REG_D &= 0x0bf; return; /* RES 6,D */
+    OPCODE(cb,0x0b3) REG_E &= 0x0bf; return; /* RES 6,E */
+    OPCODE(cb,0x0b4) REG_H &= 0x0bf; return; /* RES 6,H */
+    OPCODE(cb,0x0b5) REG_L &= 0x0bf; return; /* RES 6,L */
+    OPCODE(cb,0x0b7) REG_A &= 0x0bf; return; /* RES 6,A */
+    OPCODE(cb,0x0b8) REG_B &= 0x07f; return; /* RES 7,B */
+    OPCODE(cb,0x0b9) REG_C &= 0x07f; return; /* RES 7,C */
+    OPCODE(cb,0x0ba) REG_D &= 0x07f; return; /* RES 7,D */
+    OPCODE(cb,0x0bb) REG_E &= 0x07f; return; /* RES 7,E */
+    OPCODE(cb,0x0bc) REG_H &= 0x07f; return; /* RES 7,H */
+    OPCODE(cb,0x0bd) REG_L &= 0x07f; return; /* RES 7,L */
+    OPCODE(cb,0x0bf) REG_A &= 0x07f; return; /* RES 7,A */
+
+    OPCODE(cb,0x086) /* RES 0,(HL) */
+    OPCODE(cb,0x08e) /* RES 1,(HL) */
+    OPCODE(cb,0x096) /* RES 2,(HL) */
+    OPCODE(cb,0x09e) /* RES 3,(HL) */
+    OPCODE(cb,0x0a6) /* RES 4,(HL) */
+    OPCODE(cb,0x0ae) /* RES 5,(HL) */
+    OPCODE(cb,0x0b6) /* RES 6,(HL) */
+    OPCODE(cb,0x0be) /* RES 7,(HL) */
+    {
+        val = z80_rd_byte(z,REG_HL);
+        z->clk += 1;
+        z80_wr_byte(z,REG_HL,(UINT_8) ( val & ~( 1 << ( ( op >> 3 ) & 7 ) ) ));
+        return;
+    }
+
+    OPCODE(cb,0x0c0) REG_B |= 0x001; return; /* SET 0,B */
+    OPCODE(cb,0x0c1) REG_C |= 0x001; return; /* SET 0,C */
+    OPCODE(cb,0x0c2) REG_D |= 0x001; return; /* SET 0,D */
+    OPCODE(cb,0x0c3) REG_E |= 0x001; return; /* SET 0,E */
+    OPCODE(cb,0x0c4) REG_H |= 0x001; return; /* SET 0,H */
+    OPCODE(cb,0x0c5) REG_L |= 0x001; return; /* SET 0,L */
+    OPCODE(cb,0x0c7) REG_A |= 0x001; return; /* SET 0,A */
+    OPCODE(cb,0x0c8) REG_B |= 0x002; return; /* SET 1,B */
+    OPCODE(cb,0x0c9) REG_C |= 0x002; return; /* SET 1,C */
+    OPCODE(cb,0x0ca) REG_D |= 0x002; return; /* SET 1,D */
+    OPCODE(cb,0x0cb) REG_E |= 0x002; return; /* SET 1,E */
+    OPCODE(cb,0x0cc) REG_H |= 0x002; return; /* SET 1,H */
+    OPCODE(cb,0x0cd) REG_L |= 0x002; return; /* SET 1,L */
+    OPCODE(cb,0x0cf) REG_A |= 0x002; return; /* SET 1,A */
+    OPCODE(cb,0x0d0) REG_B |= 0x004; return; /* SET 2,B */
+    OPCODE(cb,0x0d1) REG_C |= 0x004; return; /* SET 2,C */
+    OPCODE(cb,0x0d2) REG_D |= 0x004; return; /* SET 2,D */
+    OPCODE(cb,0x0d3) REG_E |= 0x004; return; /* SET 2,E */
+    OPCODE(cb,0x0d4) REG_H |= 0x004; return; /* SET 2,H */
+    OPCODE(cb,0x0d5) REG_L |= 0x004; return; /* SET 2,L */
+    OPCODE(cb,0x0d7) REG_A |= 0x004; return; /* SET 2,A */
+    OPCODE(cb,0x0d8) REG_B |= 0x008; return; /* SET 3,B */
+    OPCODE(cb,0x0d9) REG_C |= 0x008; return; /* SET 3,C */
+    OPCODE(cb,0x0da) REG_D |= 0x008; return; /* SET 3,D */
+    OPCODE(cb,0x0db) REG_E |= 0x008; return; /* SET 3,E */
+    OPCODE(cb,0x0dc) REG_H |= 0x008; return; /* SET 3,H */
+    OPCODE(cb,0x0dd) REG_L |= 0x008; return; /* SET 3,L */
+    OPCODE(cb,0x0df) REG_A |= 0x008; return; /* SET 3,A */
+    OPCODE(cb,0x0e0) REG_B |= 0x010; return; /* SET 4,B */
+    OPCODE(cb,0x0e1) REG_C |= 0x010; return; /* SET 4,C */
+    OPCODE(cb,0x0e2) REG_D |= 0x010; return; /* SET 4,D */
+    OPCODE(cb,0x0e3) REG_E |= 0x010; return; /* SET 4,E */
+    OPCODE(cb,0x0e4) REG_H |= 0x010; return; /* SET 4,H */
+    OPCODE(cb,0x0e5) REG_L |= 0x010; return; /* SET 4,L */
+    OPCODE(cb,0x0e7) REG_A |= 0x010; return; /* SET 4,A */
+    OPCODE(cb,0x0e8) REG_B |= 0x020; return; /* SET 5,B */
+    OPCODE(cb,0x0e9) REG_C |= 0x020; return; /* SET 5,C */
+    OPCODE(cb,0x0ea) REG_D |= 0x020; return; /* SET 5,D */
+    OPCODE(cb,0x0eb) REG_E |= 0x020; return; /* SET 5,E */
+    OPCODE(cb,0x0ec) REG_H |= 0x020; return; /* SET 5,H */
+    OPCODE(cb,0x0ed) REG_L |= 0x020; return; /* SET 5,L */
+    OPCODE(cb,0x0ef) REG_A |= 0x020; return; /* SET 5,A */
+    OPCODE(cb,0x0f0) REG_B |= 0x040; return; /* SET 6,B */
+    OPCODE(cb,0x0f1) REG_C |= 0x040; return; /* SET 6,C */
+    OPCODE(cb,0x0f2) REG_D |= 0x040; return; /* SET 6,D */
+    OPCODE(cb,0x0f3) REG_E |= 0x040; return; /* SET 6,E */
+    OPCODE(cb,0x0f4) REG_H |= 0x040; return; /* SET 6,H */
+    OPCODE(cb,0x0f5) REG_L |= 0x040; return; /* SET 6,L */
+    OPCODE(cb,0x0f7) REG_A |= 0x040; return; /* SET 6,A */
+    OPCODE(cb,0x0f8) REG_B |= 0x080; return; /* SET 7,B */
+    OPCODE(cb,0x0f9) REG_C |= 0x080; return; /* SET 7,C */
+    OPCODE(cb,0x0fa) REG_D |= 0x080; return; /* SET 7,D */
+    OPCODE(cb,0x0fb) REG_E |= 0x080; return; /* SET 7,E */
+    OPCODE(cb,0x0fc) REG_H |= 0x080; return; /* SET 7,H */
+    OPCODE(cb,0x0fd) REG_L |= 0x080; return; /* SET 7,L */
+    OPCODE(cb,0x0ff) REG_A |= 0x080; return; /* SET 7,A */
+
+    OPCODE(cb,0x0c6) /* SET 0,(HL) */
+    OPCODE(cb,0x0ce) /* SET 1,(HL) */
+    OPCODE(cb,0x0d6) /* SET 2,(HL) */
+    OPCODE(cb,0x0de) /* SET 3,(HL) */
+    OPCODE(cb,0x0e6) /* SET 4,(HL) */
+    OPCODE(cb,0x0ee) /* SET 5,(HL) */
+    OPCODE(cb,0x0f6) /* SET 6,(HL) */
+    OPCODE(cb,0x0fe) /* SET 7,(HL) */
+    {
+        val = z80_rd_byte(z,REG_HL);
+        z->clk += 1;
+        z80_wr_byte(z,REG_HL,(UINT_8) ( val | ( 1 << ( ( op >> 3 ) & 7 ) ) ));
+        return;
+    }
+
+    DISPATCH_END
+
+    /*
+       ED prefixed opcodes.
+    */
+
+    ed_prefix:
+
+    op = z80_fetch_op(z);
+
+    DISPATCH(ed,op)
+
+    OPCODE(ed,0x000) /* undefined opcodes are NOPs */
+    {
+        return;
+    }
+
+    OPCODE(ed,0x040) /* IN B,(C) */
+    OPCODE(ed,0x048) /* IN C,(C) */
+    OPCODE(ed,0x050) /* IN D,(C) */
+    OPCODE(ed,0x058) /* IN E,(C) */
+    OPCODE(ed,0x060) /* IN H,(C) */
+    OPCODE(ed,0x068) /* IN L,(C) */
+    OPCODE(ed,0x070) /* IN F,(C) */
+    OPCODE(ed,0x078) /* IN A,(C) */
+    {
+        val = z80_in_byte(z,REG_BC);
+        REG_WZ = (UINT_16) ( REG_BC + 1 );
+        REG_F  = (UINT_8) ( FLAG_CY | z80_sz53p_table[val] );
+
+        if ( op != 0x070 )
+        {
+            z80_set_reg(c,&(c->hl),(UINT_8) ( op >> 3 ),val);
+        }
+
+        c->idle_in = 1;
+        return;
+    }
+
+    OPCODE(ed,0x041) /* OUT (C),B */
+    OPCODE(ed,0x049) /* OUT (C),C */
+    OPCODE(ed,0x051) /* OUT (C),D */
+    OPCODE(ed,0x059) /* OUT (C),E */
+    OPCODE(ed,0x061) /* OUT (C),H */
+    OPCODE(ed,0x069) /* OUT (C),L */
+    OPCODE(ed,0x071) /* OUT (C),0 */
+    OPCODE(ed,0x079) /* OUT (C),A */
+    {
+        val = (UINT_8) ( ( op == 0x071 ) ? 0 : z80_get_reg(c,&(c->hl),(UINT_8) ( op >> 3 )) );
+        z80_out_byte(z,REG_BC,val);
+        REG_WZ = (UINT_16) ( REG_BC + 1 );
+        return;
+    }
+
+    OPCODE(ed,0x042) z->clk += 7; z80_sbc_hl(c,REG_BC); return; /* SBC HL,BC */
+    OPCODE(ed,0x052) z->clk += 7; z80_sbc_hl(c,REG_DE); return; /* SBC HL,DE */
+    OPCODE(ed,0x062) z->clk += 7; z80_sbc_hl(c,REG_HL); return; /* SBC HL,HL */
+    OPCODE(ed,0x072) z->clk += 7; z80_sbc_hl(c,REG_SP); return; /* SBC HL,SP */
+    OPCODE(ed,0x04a) z->clk += 7; z80_adc_hl(c,REG_BC); return; /* ADC HL,BC */
+    OPCODE(ed,0x05a) z->clk += 7; z80_adc_hl(c,REG_DE); return; /* ADC HL,DE */
+    OPCODE(ed,0x06a) z->clk += 7; z80_adc_hl(c,REG_HL); return; /* ADC HL,HL */
+    OPCODE(ed,0x07a) z->clk += 7; z80_adc_hl(c,REG_SP); return; /* ADC HL,SP */
+
+    OPCODE(ed,0x043) /* LD (nn),BC */
+    {
+        temp = z80_fetch_arg16(z);
+        z80_wr_word(z,temp,REG_BC);
+        REG_WZ = (UINT_16) ( temp + 1 );
+        return;
+    }
+
+    OPCODE(ed,0x053) /* LD (nn),DE */
+    {
+        temp = z80_fetch_arg16(z);
+        z80_wr_word(z,temp,REG_DE);
+        REG_WZ = (UINT_16) ( temp + 1 );
+        return;
+    }
+
+    OPCODE(ed,0x063) /* LD (nn),HL */
+    {
+        temp = z80_fetch_arg16(z);
+        z80_wr_word(z,temp,REG_HL);
+        REG_WZ = (UINT_16) ( temp + 1 );
+        return;
+    }
+
+    OPCODE(ed,0x073) /* LD (nn),SP */
+    {
+        temp = z80_fetch_arg16(z);
+        z80_wr_word(z,temp,REG_SP);
+        REG_WZ = (UINT_16) ( temp + 1 );
+        return;
+    }
+
+    OPCODE(ed,0x04b) /* LD BC,(nn) */
+    {
+        temp = z80_fetch_arg16(z);
+        REG_BC = z80_rd_word(z,temp);
+        REG_WZ = (UINT_16) ( temp + 1 );
+        return;
+    }
+
+    OPCODE(ed,0x05b) /* LD DE,(nn) */
+    {
+        temp = z80_fetch_arg16(z);
+        REG_DE = z80_rd_word(z,temp);
+        REG_WZ = (UINT_16) ( temp + 1 );
+        return;
+    }
+
+    OPCODE(ed,0x06b) /* LD HL,(nn) */
+    {
+        temp = z80_fetch_arg16(z);
+        REG_HL = z80_rd_word(z,temp);
+        REG_WZ = (UINT_16) ( temp + 1 );
+        return;
+    }
+
+    OPCODE(ed,0x07b) /* LD SP,(nn) */
+    {
+        temp = z80_fetch_arg16(z);
+        REG_SP = z80_rd_word(z,temp);
+        REG_WZ = (UINT_16) ( temp + 1 );
+        return;
+    }
+
+    OPCODE(ed,0x044) /* NEG */
+    OPCODE(ed,0x04c)
+    OPCODE(ed,0x054)
+    OPCODE(ed,0x05c)
+    OPCODE(ed,0x064)
+    OPCODE(ed,0x06c)
+    OPCODE(ed,0x074)
+    OPCODE(ed,0x07c)
+    {
+        val   = REG_A;
+        REG_A = 0;
+        z80_sub_a(c,val,0,1);
+        return;
+    }
+
+    OPCODE(ed,0x04d) /* RETI */
+    {
+        z->reti++;
+        c->st1 = (UINT_8) ( ( c->st1 & ~Z80_ST1_IFF1 ) | ( ( c->st1 & Z80_ST1_IFF2 ) >> 1 ) );
+        REG_PC = z80_pop(z);
+        REG_WZ = REG_PC;
+        return;
+    }
+
+    OPCODE(ed,0x045) /* RETN */
+    OPCODE(ed,0x055)
+    OPCODE(ed,0x05d)
+    OPCODE(ed,0x065)
+    OPCODE(ed,0x06d)
+    OPCODE(ed,0x075)
+    OPCODE(ed,0x07d)
+    {
+        c->st1 = (UINT_8) ( ( c->st1 & ~Z80_ST1_IFF1 ) | ( ( c->st1 & Z80_ST1_IFF2 ) >> 1 ) );
+        REG_PC = z80_pop(z);
+        REG_WZ = REG_PC;
+        return;
+    }
+
+    OPCODE(ed,0x046) /* IM 0 */
+    OPCODE(ed,0x04e)
+    OPCODE(ed,0x066)
+    OPCODE(ed,0x06e)
+    {
+        c->st1 &= (UINT_8) ~( Z80_ST1_IM0 | Z80_ST1_IM1 );
+        return;
+    }
+
+    OPCODE(ed,0x056) /* IM 1 */
+    OPCODE(ed,0x076)
+    {
+        c->st1 = (UINT_8) ( ( c->st1 & ~Z80_ST1_IM0 ) | Z80_ST1_IM1 );
+        return;
+    }
+
+    OPCODE(ed,0x05e) /* IM 2 */
+    OPCODE(ed,0x07e)
+    {
+        c->st1 |= Z80_ST1_IM0 | Z80_ST1_IM1;
+        return;
+    }
+
+    OPCODE(ed,0x047) z->clk += 1; c->i = REG_A; return; /* LD I,A */
+    OPCODE(ed,0x04f) z->clk += 1; c->r = REG_A; return; /* LD R,A */
+
+    OPCODE(ed,0x057) /* LD A,I */
+    OPCODE(ed,0x05f) /* LD A,R */
+    {
+        z->clk += 1;
+        REG_A = ( op == 0x057 ) ? c->i : c->r;
+        REG_F = (UINT_8) ( FLAG_CY | z80_sz53_table[REG_A] | ( ( c->st1 & Z80_ST1_IFF2 ) ? Z80_FLAG_PV : 0 ) );
+        return;
+    }
+
+    OPCODE(ed,0x067) /* RRD */
+    {
+        val = z80_rd_byte(z,REG_HL);
+        z->clk += 4;
+        z80_wr_byte(z,REG_HL,(UINT_8) ( ( REG_A << 4 ) | ( val >> 4 ) ));
+        REG_A  = (UINT_8) ( ( REG_A & 0x0f0 ) | ( val & 0x00f ) );
+        REG_F  = (UINT_8) ( FLAG_CY | z80_sz53p_table[REG_A] );
+        REG_WZ = (UINT_16) ( REG_HL + 1 );
+        return;
+    }
+
+    OPCODE(ed,0x06f) /* RLD */
+    {
+        val = z80_rd_byte(z,REG_HL);
+        z->clk += 4;
+        z80_wr_byte(z,REG_HL,(UINT_8) ( ( val << 4 ) | ( REG_A & 0x00f ) ));
+        REG_A  = (UINT_8) ( ( REG_A & 0x0f0 ) | ( val >> 4 ) );
+        REG_F  = (UINT_8) ( FLAG_CY | z80_sz53p_table[REG_A] );
+        REG_WZ = (UINT_16) ( REG_HL + 1 );
+        return;
+    }
+
+    OPCODE(ed,0x0a0) /* LDI  */
+    OPCODE(ed,0x0a8) /* LDD  */
+    OPCODE(ed,0x0b0) /* LDIR */
+    OPCODE(ed,0x0b8) /* LDDR */
+    {
+        step = (UINT_16) ( ( op & 0x008 ) ? 0x0ffff : 0x00001 );
+
+        val = z80_rd_byte(z,REG_HL);
+        z80_wr_byte(z,REG_DE,val);
+        z->clk += 2;
+
+        REG_HL += step;
+        REG_DE += step;
+        REG_BC--;
+
+        val = (UINT_8) ( val + REG_A );
+        REG_F = (UINT_8) ( ( REG_F & ( Z80_FLAG_S | Z80_FLAG_Z | Z80_FLAG_C ) )
+                         | ( REG_BC ? Z80_FLAG_PV : 0 )
+                         | ( val & Z80_FLAG_3 )
+                         | ( ( val & 0x002 ) << 4 ) );
+
+        if ( ( op & 0x010 ) && REG_BC )
+        {
+            z->clk += 5;
+            REG_PC -= 2;
+            REG_WZ = (UINT_16) ( REG_PC + 1 );
+
+            #ifndef Z80_NO_BULK
+            z80_bulk_ldxr(z,step);
+            #endif
+        }
+
+        return;
+    }
+
+    OPCODE(ed,0x0a1) /* CPI  */
+    OPCODE(ed,0x0a9) /* CPD  */
+    OPCODE(ed,0x0b1) /* CPIR */
+    OPCODE(ed,0x0b9) /* CPDR */
+    {
+        step = (UINT_16) ( ( op & 0x008 ) ? 0x0ffff : 0x00001 );
+
+        val = z80_rd_byte(z,REG_HL);
+        res = (UINT_8) ( REG_A - val );
+        z->clk += 5;
+
+        REG_HL += step;
+        REG_WZ += step;
+        REG_BC--;
+
+        REG_F = (UINT_8) ( FLAG_CY
+                         | Z80_FLAG_N
+                         | ( z80_sz53_table[res] & ( Z80_FLAG_S | Z80_FLAG_Z ) )
+                         | ( ( REG_A ^ val ^ res ) & Z80_FLAG_H )
+                         | ( REG_BC ? Z80_FLAG_PV : 0 ) );
+
+        if ( REG_F & Z80_FLAG_H )
+        {
+            res--;
+        }
+
+        REG_F |= (UINT_8) ( ( res & Z80_FLAG_3 ) | ( ( res & 0x002 ) << 4 ) );
+
+        if ( ( op & 0x010 ) && REG_BC && !( REG_F & Z80_FLAG_Z ) )
+        {
+            z->clk += 5;
+            REG_PC -= 2;
+            REG_WZ = (UINT_16) ( REG_PC + 1 );
+
+            #ifndef Z80_NO_BULK
+            z80_bulk_cpxr(z,step);
+            #endif
+        }
+
+        return;
+    }
+
+    OPCODE(ed,0x0a2) /* INI  */
+    OPCODE(ed,0x0aa) /* IND  */
+    OPCODE(ed,0x0b2) /* INIR */
+    OPCODE(ed,0x0ba) /* INDR */
+    {
+        step = (UINT_16) ( ( op & 0x008 ) ? 0x0ffff : 0x00001 );
+
+        z->clk += 1;
+        val = z80_in_byte(z,REG_BC);
+        REG_WZ = (UINT_16) ( REG_BC + step );
+        REG_B--;
+        z80_wr_byte(z,REG_HL,val);
+        REG_HL += step;
+
+        z80_block_io_flags(c,val,(UINT_16) ( val + (UINT_8) ( REG_C + step ) ));
+
+        if ( ( op & 0x010 ) && REG_B )
+        {
+            z->clk += 5;
+            REG_PC -= 2;
+        }
+
+        return;
+    }
+
+    OPCODE(ed,0x0a3) /* OUTI */
+    OPCODE(ed,0x0ab) /* OUTD */
+    OPCODE(ed,0x0b3) /* OTIR */
+    OPCODE(ed,0x0bb) /* OTDR */
+    {
+        step = (UINT_16) ( ( op & 0x008 ) ? 0x0ffff : 0x00001 );
+
+        z->clk += 1;
+        val = z80_rd_byte(z,REG_HL);
+        REG_B--;
+        z80_out_byte(z,REG_BC,val);
+        REG_WZ = (UINT_16) ( REG_BC + step );
+        REG_HL += step;
+
+        z80_block_io_flags(c,val,(UINT_16) ( val + REG_L ));
+
+        if ( ( op & 0x010 ) && REG_B )
+        {
+            z->clk += 5;
+            REG_PC -= 2;
+        }
+
+        return;
+    }
+
+    DISPATCH_END
+
+    /*
+       DD/FD prefixed opcodes, xy points to IX or IY.  If the prefix is
+       followed by another DD/FD prefix then the first is treated as a NOP
+       and the second is left pending for the next step (with interupts held
+       off in the meantime), so long prefix strings can't lock up the
+       emulator.
+    */
+
+    index_prefix:
+
+    op = z80_fetch_op(z);
+
+    DISPATCH(index,op)
+
+    OPCODE(index,0x009) z->clk += 7; xy->w = z80_add16(c,xy->w,REG_BC); return; /* ADD IX,BC */
+    OPCODE(index,0x019) z->clk += 7; xy->w = z80_add16(c,xy->w,REG_DE); return; /* ADD IX,DE */
+    OPCODE(index,0x029) z->clk += 7; xy->w = z80_add16(c,xy->w,xy->w);  return; /* ADD IX,IX */
+    OPCODE(index,0x039) z->clk += 7; xy->w = z80_add16(c,xy->w,REG_SP); return; /* ADD IX,SP */
+
+    OPCODE(index,0x021) xy->w = z80_fetch_arg16(z); return; /* LD IX,nn */
+
+    OPCODE(index,0x022) /* LD (nn),IX */
+    {
+        temp = z80_fetch_arg16(z);
+        z80_wr_word(z,temp,xy->w);
+        REG_WZ = (UINT_16) ( temp + 1 );
+        return;
+    }
+
+    OPCODE(index,0x02a) /* LD IX,(nn) */
+    {
+        temp = z80_fetch_arg16(z);
+        xy->w = z80_rd_word(z,temp);
+        REG_WZ = (UINT_16) ( temp + 1 );
+        return;
+    }
+
+    OPCODE(index,0x023) z->clk += 2; xy->w++; return; /* INC IX */
+    OPCODE(index,0x02b) z->clk += 2; xy->w--; return; /* DEC IX */
+
+    OPCODE(index,0x024) xy->b.h = z80_inc8(c,xy->b.h);   return; /* INC IXH */
+    OPCODE(index,0x025) xy->b.h = z80_dec8(c,xy->b.h);   return; /* DEC IXH */
+    OPCODE(index,0x026) xy->b.h = z80_fetch_arg(z);      return; /* LD IXH,n */
+    OPCODE(index,0x02c) xy->b.l = z80_inc8(c,xy->b.l);   return; /* INC IXL */
+    OPCODE(index,0x02d) xy->b.l = z80_dec8(c,xy->b.l);   return; /* DEC IXL */
+    OPCODE(index,0x02e) xy->b.l = z80_fetch_arg(z);      return; /* LD IXL,n */
+
+    OPCODE(index,0x034) /* INC (IX+d) */
+    {
+        temp = z80_index_addr(z,xy);
+        val = z80_rd_byte(z,temp);
+        z->clk += 1;
+        z80_wr_byte(z,temp,z80_inc8(c,val));
+        return;
+    }
+
+    OPCODE(index,0x035) /* DEC (IX+d) */
+    {
+        temp = z80_index_addr(z,xy);
+        val = z80_rd_byte(z,temp);
+        z->clk += 1;
+        z80_wr_byte(z,temp,z80_dec8(c,val));
+        return;
+    }
+
+    OPCODE(index,0x036) /* LD (IX+d),n */
+    {
+        val = z80_fetch_arg(z);
+        REG_WZ = ADD_DISP(xy->w,val);
+        val = z80_fetch_arg(z);
+        z->clk += 2;
+        z80_wr_byte(z,REG_WZ,val);
+        return;
+    }
+
+    OPCODE(index,0x0e1) xy->w = z80_pop(z); return; /* POP IX */
+    OPCODE(index,0x0e5) z->clk += 1; z80_push(z,xy->w); return; /* PUSH IX */
+
+    OPCODE(index,0x0e3) /* EX (SP),IX */
+    {
+        temp = z80_rd_byte(z,REG_SP);
+        temp |= (UINT_16) ( z80_rd_byte(z,(UINT_16) ( REG_SP + 1 )) << 8 );
+        z->clk += 1;
+        z80_wr_byte(z,(UINT_16) ( REG_SP + 1 ),xy->b.h);
+        z80_wr_byte(z,REG_SP,xy->b.l);
+        z->clk += 2;
+        xy->w  = temp;
+        REG_WZ = temp;
+        return;
+    }
+
+    OPCODE(index,0x0e9) REG_PC = xy->w; return; /* JP (IX) */
+    OPCODE(index,0x0f9) z->clk += 2; REG_SP = xy->w; return; /* LD SP,IX */
+
+    OPCODE(index,0x0cb) /* DDCB/FDCB prefix */
+    {
+        z80_exec_index_cb(z,xy);
+        return;
+    }
+
+    OPCODE(index,0x0dd) /* DD/FD prefix following prefix */
+    OPCODE(index,0x0fd)
+    {
+        c->next_prefix = op;
+        c->st1 |= Z80_ST1_DI;
+        return;
+    }
+
+    OPCODE(index,0x044) REG_B = xy->b.h; return; /* LD B,IXH */
+    OPCODE(index,0x045) REG_B = xy->b.l; return; /* LD B,IXL */
+    OPCODE(index,0x046) REG_B = z80_rd_byte(z,z80_index_addr(z,xy)); return; /* LD B,(IX+d) */
+
+    OPCODE(index,0x04c) REG_C = xy->b.h; return; /* LD C,IXH */
+    OPCODE(index,0x04d) REG_C = xy->b.l; return; /* LD C,IXL */
+    OPCODE(index,0x04e) REG_C = z80_rd_byte(z,z80_index_addr(z,xy)); return; /* LD C,(IX+d) */
+
+    OPCODE(index,0x054) REG_D = xy->b.h; return; /* LD D,IXH */
+    OPCODE(index,0x055) REG_D = xy->b.l; return; /* LD D,IXL */
+    OPCODE(index,0x056) REG_D = z80_rd_byte(z,z80_index_addr(z,xy)); return; /* LD D,(IX+d) */
+
+    OPCODE(index,0x05c) REG_E = xy->b.h; return; /* LD E,IXH */
+    OPCODE(index,0x05d) REG_E = xy->b.l; return; /* LD E,IXL */
+    OPCODE(index,0x05e) REG_E = z80_rd_byte(z,z80_index_addr(z,xy)); return; /* LD E,(IX+d) */
+
+    OPCODE(index,0x060) xy->b.h = REG_B; return; /* LD IXH,B */
+    OPCODE(index,0x061) xy->b.h = REG_C; return; /* LD IXH,C */
+    OPCODE(index,0x062) xy->b.h = REG_D; return; /* LD IXH,D */
+    OPCODE(index,0x063) xy->b.h = REG_E; return; /* LD IXH,E */
+    OPCODE(index,0x064) return; /* LD IXH,IXH */
+    OPCODE(index,0x065) xy->b.h = xy->b.l; return; /* LD IXH,IXL */
+    OPCODE(index,0x066) REG_H = z80_rd_byte(z,z80_index_addr(z,xy)); return; /* LD H,(IX+d) */
+    OPCODE(index,0x067) xy->b.h = REG_A; return; /* LD IXH,A */
+
+    OPCODE(index,0x068) xy->b.l = REG_B; return; /* LD IXL,B */
+    OPCODE(index,0x069) xy->b.l = REG_C; return; /* LD IXL,C */
+    OPCODE(index,0x06a) xy->b.l = REG_D; return; /* LD IXL,D */
+    OPCODE(index,0x06b) xy->b.l = REG_E; return; /* LD IXL,E */
+    OPCODE(index,0x06c) xy->b.l = xy->b.h; return; /* LD IXL,IXH */
+    OPCODE(index,0x06d) return; /* LD IXL,IXL */
+    OPCODE(index,0x06e) REG_L = z80_rd_byte(z,z80_index_addr(z,xy)); return; /* LD L,(IX+d) */
+    OPCODE(index,0x06f) xy->b.l = REG_A; return; /* LD IXL,A */
+
+    OPCODE(index,0x070) z80_wr_byte(z,z80_index_addr(z,xy),REG_B); return; /* LD (IX+d),B */
+    OPCODE(index,0x071) z80_wr_byte(z,z80_index_addr(z,xy),REG_C); return; /* LD (IX+d),C */
+    OPCODE(index,0x072) z80_wr_byte(z,z80_index_addr(z,xy),REG_D); return; /* LD (IX+d),D */
+    OPCODE(index,0x073) z80_wr_byte(z,z80_index_addr(z,xy),REG_E); return; /* LD (IX+d),E */
+    OPCODE(index,0x074) z80_wr_byte(z,z80_index_addr(z,xy),REG_H); return; /* LD (IX+d),H */
+    OPCODE(index,0x075) z80_wr_byte(z,z80_index_addr(z,xy),REG_L); return; /* LD (IX+d),L */
+    OPCODE(index,0x077) z80_wr_byte(z,z80_index_addr(z,xy),REG_A); return; /* LD (IX+d),A */
+
+    OPCODE(index,0x07c) REG_A = xy->b.h; return; /* LD A,IXH */
+    OPCODE(index,0x07d) REG_A = xy->b.l; return; /* LD A,IXL */
+    OPCODE(index,0x07e) REG_A = z80_rd_byte(z,z80_index_addr(z,xy)); return; /* LD A,(IX+d) */
+
+    OPCODE(index,0x084) z80_add_a(c,xy->b.h,0); return; /* ADD A,IXH */
+    OPCODE(index,0x085) z80_add_a(c,xy->b.l,0); return; /* ADD A,IXL */
+    OPCODE(index,0x086) z80_add_a(c,z80_rd_byte(z,z80_index_addr(z,xy)),0); return; /* ADD A,(IX+d) */
+
+    OPCODE(index,0x08c) z80_add_a(c,xy->b.h,FLAG_CY); return; /* ADC A,IXH */
+    OPCODE(index,0x08d) z80_add_a(c,xy->b.l,FLAG_CY); return; /* ADC A,IXL */
+    OPCODE(index,0x08e) z80_add_a(c,z80_rd_byte(z,z80_index_addr(z,xy)),FLAG_CY); return; /* ADC A,(IX+d) */
+
+    OPCODE(index,0x094) z80_sub_a(c,xy->b.h,0,1); return; /* SUB IXH */
+    OPCODE(index,0x095) z80_sub_a(c,xy->b.l,0,1); return; /* SUB IXL */
+    OPCODE(index,0x096) z80_sub_a(c,z80_rd_byte(z,z80_index_addr(z,xy)),0,1); return; /* SUB (IX+d) */
+
+    OPCODE(index,0x09c) z80_sub_a(c,xy->b.h,FLAG_CY,1); return; /* SBC A,IXH */
+    OPCODE(index,0x09d) z80_sub_a(c,xy->b.l,FLAG_CY,1); return; /* SBC A,IXL */
+    OPCODE(index,0x09e) z80_sub_a(c,z80_rd_byte(z,z80_index_addr(z,xy)),FLAG_CY,1); return; /* SBC A,(IX+d) */
+
+    OPCODE(index,0x0a4) z80_and_a(c,xy->b.h); return; /* AND IXH */
+    OPCODE(index,0x0a5) z80_and_a(c,xy->b.l); return; /* AND IXL */
+    OPCODE(index,0x0a6) z80_and_a(c,z80_rd_byte(z,z80_index_addr(z,xy))); return; /* AND (IX+d) */
+
+    OPCODE(index,0x0ac) z80_xor_a(c,xy->b.h); return; /* XOR IXH */
+    OPCODE(index,0x0ad) z80_xor_a(c,xy->b.l); return; /* XOR IXL */
+    OPCODE(index,0x0ae) z80_xor_a(c,z80_rd_byte(z,z80_index_addr(z,xy))); return; /* XOR (IX+d) */
+
+    OPCODE(index,0x0b4) z80_or_a(c,xy->b.h); return; /* OR IXH */
+    OPCODE(index,0x0b5) z80_or_a(c,xy->b.l); return; /* OR IXL */
+    OPCODE(index,0x0b6) z80_or_a(c,z80_rd_byte(z,z80_index_addr(z,xy))); return; /* OR (IX+d) */
+
+    OPCODE(index,0x0bc) z80_sub_a(c,xy->b.h,0,0); return; /* CP IXH */
+    OPCODE(index,0x0bd) z80_sub_a(c,xy->b.l,0,0); return; /* CP IXL */
+    OPCODE(index,0x0be) z80_sub_a(c,z80_rd_byte(z,z80_index_addr(z,xy)),0,0); return; /* CP (IX+d) */
+
+    DISPATCH_END_MAIN
+}
+
+
+
+/***********************************************************************/
+/***********************************************************************/
+/***********************************************************************/
+
+/*
+   Reset registers and interface buses.
+*/
+
+static void z80_clear_state(z80_block *z)
+{
+    z80_core *c = &(z->core);
+
+    REG_AF = 0x0ffff;
+    REG_BC = 0x0ffff;
+    REG_DE = 0x0ffff;
+    REG_HL = 0x0ffff;
+    REG_IX = 0x0ffff;
+    REG_IY = 0x0ffff;
+    REG_SP = 0x0ffff;
+    REG_PC = 0x00000;
+    REG_WZ = 0x00000;
+
+    c->afx.w = 0x0ffff;
+    c->bcx.w = 0x0ffff;
+    c->dex.w = 0x0ffff;
+    c->hlx.w = 0x0ffff;
+
+    c->i           = 0;
+    c->r           = 0;
+    c->st1         = 0;
+    c->st2         = 0;
+    c->lazy_op     = Z80_LAZY_NONE;
+    c->next_prefix = 0;
+    c->wait_word   = 0;
+    c->idle_in     = 0;
+    c->idle_armed  = 0;
+
+    z->wait = 0;
+    z->rfsh = 0;
+    z->data = 0;
+    z->addr = 0;
+    z->clk  = 0;
+    z->reti = 0;
+
+    return;
+}
+
+/*
+   Decide what the next step will be.
+*/
+
+static void z80_schedule(z80_block *z)
+{
+    z80_core *c = &(z->core);
+
+    if ( c->st2 & Z80_ST2_RESET )
+    {
+        c->st2 &= (UINT_8) ~Z80_ST2_RESET;
+
+        z80_ack_reset((void *) z);
+        z80_clear_state(z);
+    }
+
+    if ( !( c->st1 & Z80_ST1_DI ) )
+    {
+        if ( c->st2 & Z80_ST2_BUSRQ )
+        {
+            c->next_op = Z80_NEXT_BUSRQ;
+
+            return;
+        }
+
+        if ( c->st2 & Z80_ST2_NMI )
+        {
+            c->next_op = Z80_NEXT_NMI;
+
+            return;
+        }
+
+        if ( ( c->st2 & Z80_ST2_INT ) && ( c->st1 & Z80_ST1_IFF1 ) )
+        {
+            c->next_op = Z80_NEXT_INT;
+
+            return;
+        }
+    }
+
+    c->next_op = ( c->st2 & Z80_ST2_HALTED ) ? Z80_NEXT_HALT : Z80_NEXT_NORM;
+
+    return;
+}
+
+/*
+   Acknowledge maskable interupt and start processing it.
+*/
+
+static void z80_interupt(z80_block *z)
+{
+    z80_core *c = &(z->core);
+    UINT_8 val;
+
+    c->st2 &= (UINT_8) ~Z80_ST2_HALTED;
+    c->st1 &= (UINT_8) ~( Z80_ST1_IFF1 | Z80_ST1_IFF2 );
+
+    switch ( c->st1 & ( Z80_ST1_IM0 | Z80_ST1_IM1 ) )
+    {
+        case Z80_ST1_IM1: /* IM 1 */
+        {
+            z80_int_ack(z);
+            z80_push(z,REG_PC);
+            REG_PC = 0x00038;
+            REG_WZ = REG_PC;
+
+            break;
+        }
+
+        case ( Z80_ST1_IM0 | Z80_ST1_IM1 ): /* IM 2 */
+        {
+            val = z80_int_ack(z);
+            z80_push(z,REG_PC);
+            REG_PC = z80_rd_word(z,(UINT_16) ( ( c->i << 8 ) | val ));
+            REG_WZ = REG_PC;
+
+            break;
+        }
+
+        default: /* IM 0 */
+        {
+            c->st2 |= Z80_ST2_INTOP;
+            z80_exec(z,z80_fetch_op(z));
+            c->st2 &= (UINT_8) ~Z80_ST2_INTOP;
+
+            break;
+        }
+    }
+
+    return;
+}
+
+/*
+   Pre-decoded instruction cache: decoding.  z80_dcache_len gives the
+   length of unprefixed opcode op.  z80_dcache_decode fills in record rec
+   for the instruction at offset offs in page, marking it as not cached if
+   it can't be (see above), and returns non-zero if it can be run from the
+   cache.
+*/
+
+static int z80_dcache_len(UINT_8 op)
+{
+    if ( ( ( op & 0x0c7 ) == 0x006 ) || ( ( op & 0x0c7 ) == 0x0c6 ) ) { return 2; }
+    if ( ( ( op & 0x0e7 ) == 0x020 ) || ( op == 0x010 ) || ( op == 0x018 ) ) { return 2; }
+    if ( ( op == 0x0d3 ) || ( op == 0x0db ) || ( op == 0x0cb ) ) { return 2; }
+    if ( ( ( op & 0x0cf ) == 0x001 ) || ( ( op & 0x0e7 ) == 0x022 ) ) { return 3; }
+    if ( ( ( op & 0x0c7 ) == 0x0c2 ) || ( ( op & 0x0c7 ) == 0x0c4 ) ) { return 3; }
+    if ( ( op == 0x0c3 ) || ( op == 0x0cd ) ) { return 3; }
+
+    return 1;
+}
+
+static int z80_dcache_decode(z80_core *c, z80_dcache_rec *rec, UINT_8 page, UINT_8 offs)
+{
+    const UINT_8 *m = c->mem_addr[page] + offs;
+    UINT_32 clk;
+    int avail = 0x0100 - offs;
+    int len;
+    int ops;
+    int i;
+
+    rec->state = Z80_DCACHE_UNCACHED;
+
+    if ( ( c->op_mode[page] != Z80_MEM_DIRECT ) || ( c->rd_mode[page] != Z80_MEM_DIRECT ) || ( c->mem_addr[page] == NULL ) )
+    {
+        return 0;
+    }
+
+    if ( ( m[0] != 0x0cb ) && ( m[0] != 0x0ed ) && ( m[0] != 0x0dd ) && ( m[0] != 0x0fd ) )
+    {
+        len = z80_dcache_len(m[0]);
+        ops = 1;
+    }
+
+    else if ( avail < 2 )
+    {
+        return 0;
+    }
+
+    else if ( m[0] == 0x0cb )
+    {
+        len = 2;
+        ops = 2;
+    }
+
+    else if ( m[0] == 0x0ed )
+    {
+        len = ( ( m[1] & 0x0c7 ) == 0x043 ) ? 4 : 2;
+        ops = 2;
+    }
+
+    else if ( ( m[1] == 0x0dd ) || ( m[1] == 0x0fd ) || ( m[1] == 0x0ed ) )
+    {
+        return 0;
+    }
+
+    else if ( m[1] == 0x0cb )
+    {
+        len = 4;
+        ops = 3;
+    }
+
+    else
+    {
+        len = 1 + z80_dcache_len(m[1]);
+        ops = 2;
+
+        if ( ( m[1] == 0x034 ) || ( m[1] == 0x035 ) || ( m[1] == 0x036 ) ||
+             ( ( m[1] >= 0x040 ) && ( m[1] < 0x0c0 ) && ( m[1] != 0x076 ) && ( ( ( m[1] & 7 ) == 6 ) || ( ( m[1] & 0x0f8 ) == 0x070 ) ) ) )
+        {
+            len++;
+        }
+    }
+
+    clk = ( ops * ( 4 + c->op_wait[page] ) ) + ( ( len - ops ) * ( 3 + c->rd_wait[page] ) );
+
+    if ( ( len > avail ) || ( clk > 0x0ff ) )
+    {
+        return 0;
+    }
+
+    for ( i = 0 ; i < 4 ; i++ )
+    {
+        rec->op[i] = (UINT_8) ( ( i < len ) ? m[i] : 0 );
+    }
+
+    rec->len   = (UINT_8) len;
+    rec->r_inc = (UINT_8) ops;
+    rec->clk   = (UINT_8) clk;
+    rec->state = Z80_DCACHE_VALID;
+
+    return 1;
+}
+
+/*
+   Run one instruction from the cache.  Returns zero (having done nothing)
+   if the instruction at PC can't be run from the cache.
+*/
+
+static int z80_dcache_run(z80_block *z)
+{
+    z80_core *c = &(z->core);
+    z80_dcache_rec *rec;
+    UINT_8 page = c->pc.b.h;
+
+    if ( ( rec = c->dcache[page] ) == NULL )
+    {
+        if ( c->op_mode[page] != Z80_MEM_DIRECT )
+        {
+            return 0;
+        }
+
+        if ( ( rec = (z80_dcache_rec *) calloc(256,sizeof(z80_dcache_rec)) ) == NULL )
+        {
+            return 0;
+        }
+
+        c->dcache[page] = rec;
+    }
+
+    rec += c->pc.b.l;
+
+    if ( ( rec->state != Z80_DCACHE_VALID ) && ( ( rec->state == Z80_DCACHE_UNCACHED ) || !z80_dcache_decode(c,rec,page,c->pc.b.l) ) )
+    {
+        return 0;
+    }
+
+    c->r = (UINT_8) ( ( c->r & 0x080 ) | ( ( c->r + rec->r_inc ) & 0x07f ) );
+    REG_PC += rec->len;
+    z->clk += rec->clk;
+
+    #ifdef Z80_PROFILE
+    c->prof.mem[Z80_PROF_OP][page][Z80_MEM_DIRECT] += rec->r_inc;
+    c->prof.mem[Z80_PROF_RD][page][Z80_MEM_DIRECT] += rec->len - rec->r_inc;
+    #endif
+
+    c->dcache_next = &(rec->op[1]);
+    z80_exec(z,OP_BYTE(rec->op[0]));
+    c->dcache_next = NULL;
+
+    return 1;
+}
+
+/*
+   Profile the instruction run in this step (see "Profiling"), which took
+   clk T-states.
+*/
+
+#ifdef Z80_PROFILE
+static void z80_prof_step(z80_core *c, UINT_32 clk)
+{
+    int tab = Z80_PROF_MAIN;
+    int i = 0;
+
+    if ( c->prof_op[0] == 0x0cb )
+    {
+        tab = Z80_PROF_CB;
+        i   = 1;
+    }
+
+    else if ( c->prof_op[0] == 0x0ed )
+    {
+        tab = Z80_PROF_ED;
+        i   = 1;
+    }
+
+    else if ( ( ( c->prof_op[0] == 0x0dd ) || ( c->prof_op[0] == 0x0fd ) ) && ( c->prof_n > 1 ) )
+    {
+        if ( ( c->prof_op[1] == 0x0cb ) && ( c->prof_n > 2 ) )
+        {
+            tab = ( c->prof_op[0] == 0x0dd ) ? Z80_PROF_DDCB : Z80_PROF_FDCB;
+            i   = 2;
+        }
+
+        else
+        {
+            tab = ( c->prof_op[0] == 0x0dd ) ? Z80_PROF_DD : Z80_PROF_FD;
+            i   = 1;
+        }
+    }
+
+    c->prof.count[tab][c->prof_op[i]] += 1 + c->prof_bulk;
+    c->prof.clk[tab][c->prof_op[i]]   += clk;
+
+    return;
+}
+#endif
+
+/*
+   Start the trace record for this step, if it is to be traced (see
+   "Tracing").  A prefix left over from the last step is counted as part
+   of the instruction, so the record starts at it.
+*/
+
+#ifdef Z80_TRACE
+static void z80_trace_start(z80_block *z)
+{
+    z80_core *c = &(z->core);
+    z80_trace_rec *rec;
+
+    c->trace_rec = NULL;
+
+    if ( c->trace == NULL )
+    {
+        return;
+    }
+
+    rec = &((c->trace)[c->trace_next]);
+
+    switch ( c->next_op )
+    {
+        case Z80_NEXT_NORM: { rec->kind = Z80_TRACE_OP;  break; }
+        case Z80_NEXT_INT:  { rec->kind = Z80_TRACE_INT; break; }
+        case Z80_NEXT_NMI:  { rec->kind = Z80_TRACE_NMI; break; }
+        default:            { return; }
+    }
+
+    rec->time = c->trace_time;
+    rec->pc   = (UINT_16) ( REG_PC - ( c->next_prefix ? 1 : 0 ) );
+    rec->af   = REG_AF;
+    rec->bc   = REG_BC;
+    rec->de   = REG_DE;
+    rec->hl   = REG_HL;
+    rec->sp   = REG_SP;
+    rec->ix   = REG_IX;
+    rec->iy   = REG_IY;
+    rec->len  = 0;
+    rec->r    = c->r;
+    rec->st1  = c->st1;
+
+    c->trace_rec = rec;
+
+    return;
+}
+#endif
+
+/*
+   Execute one step.
+*/
+
+void z80_cycle(void *z80block)
+{
+    z80_block *z = (z80_block *) z80block;
+    z80_core *c = &(z->core);
+    UINT_8 prefix;
+    UINT_32 halt_clk;
+    UINT_32 n;
+
+    #ifdef Z80_PROFILE
+    UINT_32 prof_clk = z->clk;
+    UINT_8 prof_norm = (UINT_8) ( c->next_op == Z80_NEXT_NORM );
+
+    c->prof_n    = 0;
+    c->prof_bulk = 0;
+    #endif
+
+    #ifdef Z80_TRACE
+    UINT_32 trace_clk = z->clk;
+
+    z80_trace_start(z);
+    #endif
+
+    switch ( c->next_op )
+    {
+        case Z80_NEXT_NORM:
+        {
+            c->st1 &= (UINT_8) ~Z80_ST1_DI;
+
+            if ( ( prefix = c->next_prefix ) != 0 )
+            {
+                c->next_prefix = 0;
+                z80_exec(z,OP_BYTE(prefix));
+
+                break;
+            }
+
+            #ifdef Z80_JIT
+            z80_flags(c);
+
+            if ( z80_jit_run(z) )
+            {
+                c->idle_in    = 0;
+                c->idle_armed = 0;
+
+                break;
+            }
+            #endif
+
+            if ( c->dcache_on && z80_dcache_run(z) )
+            {
+                break;
+            }
+
+            z80_exec(z,z80_fetch_op(z));
+
+            break;
+        }
+
+        case Z80_NEXT_HALT:
+        {
+            c->r = (UINT_8) ( ( c->r & 0x080 ) | ( ( c->r + 1 ) & 0x07f ) );
+            z80_op_rd(z,REG_PC);
+
+            c->idle_armed = 0;
+
+            if ( c->skip_mode && ( c->op_mode[c->pc.b.h] == Z80_MEM_DIRECT ) && ( c->st2 & Z80_ST2_HALTED ) &&
+                 !( c->st2 & ( Z80_ST2_RESET | Z80_ST2_BUSRQ | Z80_ST2_NMI ) ) &&
+                 !( ( c->st2 & Z80_ST2_INT ) && ( c->st1 & Z80_ST1_IFF1 ) ) )
+            {
+                /*
+                   Nothing is waiting to end the HALT, so do the rest of
+                   the HALT cycles up to the clock limit (see above).
+                */
+
+                halt_clk = 4 + c->op_wait[c->pc.b.h];
+
+                n = z80_steps_left(z,halt_clk);
+
+                c->r = (UINT_8) ( ( c->r & 0x080 ) | ( ( c->r + n ) & 0x07f ) );
+                z->clk       += n * halt_clk;
+                c->skip_halt += n * halt_clk;
+            }
+
+            break;
+        }
+
+        case Z80_NEXT_BUSRQ:
+        {
+            c->st2 &= (UINT_8) ~Z80_ST2_BUSRQ;
+            c->idle_armed = 0;
+
+            z->clk += 1;
+            z80_ack_busrq((void *) z);
+            c->wait_word += (UINT_16) ( z->wait & 0x0ff );
+
+            break;
+        }
+
+        case Z80_NEXT_NMI:
+        {
+            c->st2 &= (UINT_8) ~( Z80_ST2_NMI | Z80_ST2_HALTED );
+            c->st1 &= (UINT_8) ~Z80_ST1_IFF1;
+
+            z->clk += 5;
+            z->addr = REG_PC;
+            z->rfsh = c->r;
+            z80_ack_NMI((void *) z);
+            c->wait_word += (UINT_16) ( z->wait & 0x0ff );
+
+            z80_push(z,REG_PC);
+            REG_PC = 0x00066;
+            REG_WZ = REG_PC;
+
+            break;
+        }
+
+        case Z80_NEXT_INT:
+        {
+            z80_interupt(z);
+
+            break;
+        }
+
+        default:
+        {
+            break;
+        }
+    }
+
+    z->clk += c->wait_word;
+    c->wait_word = 0;
+
+    #ifdef Z80_PROFILE
+    if ( prof_norm && c->prof_n )
+    {
+        z80_prof_step(c,z->clk-prof_clk);
+    }
+    #endif
+
+    z80_schedule(z);
+
+    if ( c->skip_mode == Z80_SKIP_IDLE )
+    {
+        z80_idle_step(z);
+    }
+
+    #ifdef Z80_TRACE
+    c->trace_time += z->clk - trace_clk;
+
+    if ( c->trace_rec != NULL )
+    {
+        c->trace_rec   = NULL;
+        c->trace_next  = ( c->trace_next + 1 ) & c->trace_mask;
+        c->trace_total++;
+    }
+    #endif
+
+    return;
+}
+
+
+/***********************************************************************/
+/***********************************************************************/
+/***********************************************************************/
+
+/*
+   Support for the block translator (z80jit.c).  z80_jit_stop returns
+   non-zero if the next step would be anything other than a plain
+   instruction (or translated code has been thrown away, or the run is to
+   be ended), so translated code must hand back to z80_cycle.
+   z80_jit_step runs one instruction the same way z80_cycle would, for the
+   instructions the translator doesn't handle itself, and returns
+   z80_jit_stop.  It notes where in the step the instruction started
+   (step_clk), so that z80cpu.c can tell which slice of the run any
+   external call it makes falls in.
+*/
+
+#ifdef Z80_JIT
+
+int z80_jit_stop(z80_block *z)
+{
+    z80_core *c = &(z->core);
+
+    if ( c->jit_dirty || c->next_prefix || ( c->st1 & Z80_ST1_DI ) || z->end_run )
+    {
+        return 1;
+    }
+
+    if ( c->st2 & ( Z80_ST2_RESET | Z80_ST2_BUSRQ | Z80_ST2_NMI | Z80_ST2_HALTED ) )
+    {
+        return 1;
+    }
+
+    if ( ( c->st2 & Z80_ST2_INT ) && ( c->st1 & Z80_ST1_IFF1 ) )
+    {
+        return 1;
+    }
+
+    return 0;
+}
+
+int z80_jit_step(z80_block *z)
+{
+    z80_core *c = &(z->core);
+
+    z->step_clk = z->clk;
+
+    z80_exec(z,z80_fetch_op(z));
+    z80_flags(c);
+
+    z->clk += c->wait_word;
+    c->wait_word = 0;
+
+    return z80_jit_stop(z);
+}
+
+#endif
+
+
+/***********************************************************************/
+/***********************************************************************/
+/***********************************************************************/
+
+/*
+   Initialisation and signals.
+*/
+
+void z80_init(void *z80block)
+{
+    z80_block *z = (z80_block *) z80block;
+    z80_core *c = &(z->core);
+    int i;
+
+    for ( i = 0 ; i < 256 ; i++ )
+    {
+        c->wr_mode[i]  = Z80_MEM_INDIRECT;
+        c->rd_mode[i]  = Z80_MEM_INDIRECT;
+        c->op_mode[i]  = Z80_MEM_INDIRECT;
+        c->wr_real[i]  = Z80_MEM_INDIRECT;
+        c->rd_real[i]  = Z80_MEM_INDIRECT;
+        c->op_real[i]  = Z80_MEM_INDIRECT;
+        c->wr_naw[i]   = 0;
+        c->rd_naw[i]   = 0;
+        c->op_naw[i]   = 0;
+        c->wr_wait[i]  = 0;
+        c->rd_wait[i]  = 0;
+        c->op_wait[i]  = 0;
+        c->mem_wtwr[i] = 0;
+        c->mem_wtrd[i] = 0;
+        c->mem_addr[i] = NULL;
+
+        #ifdef Z80_JIT
+        c->jit_code[i] = 0;
+        #endif
+    }
+
+    #ifdef Z80_JIT
+    c->jit_dirty  = 0;
+    c->jit_failed = 0;
+    z80_jit_flush(z);
+    #endif
+
+    for ( i = 0 ; i < 256 ; i++ )
+    {
+        z80_dcache_flush_page(c,(UINT_8) i);
+    }
+
+    c->dcache_next = NULL;
+
+    #ifdef Z80_TRACE
+    c->trace_rec  = NULL;
+    c->trace_time = 0;
+    #endif
+
+    z80_clear_state(z);
+
+    c->next_op = Z80_NEXT_START;
+
+    return;
+}
+
+void z80_set_reset(void *z80block)
+{
+    ((z80_block *) z80block)->core.st2 |= Z80_ST2_RESET;
+
+    return;
+}
+
+void z80_set_busrq(void *z80block)
+{
+    ((z80_block *) z80block)->core.st2 |= Z80_ST2_BUSRQ;
+
+    return;
+}
+
+void z80_set_NMI(void *z80block)
+{
+    ((z80_block *) z80block)->core.st2 |= Z80_ST2_NMI;
+
+    return;
+}
+
+void z80_set_INT(void *z80block)
+{
+    ((z80_block *) z80block)->core.st2 |= Z80_ST2_INT;
+
+    return;
+}
+
+void z80_res_INT(void *z80block)
+{
+    ((z80_block *) z80block)->core.st2 &= (UINT_8) ~Z80_ST2_INT;
+
+    return;
+}
+
+void z80_set_wait(void *z80block)
+{
+    z80_block *z = (z80_block *) z80block;
+
+    z->core.wait_word += (UINT_16) ( z->wait & 0x0ff );
+
+    return;
+}
+
+/*
+   Turn the pre-decoded instruction cache on or off.  Turning it off frees
+   the cache tables.  Neither may be called from within z80_cycle (or any
+   of the functions it calls).
+*/
+
+void z80_set_dcache_on(void *z80block)
+{
+    ((z80_block *) z80block)->core.dcache_on = 1;
+
+    return;
+}
+
+void z80_set_dcache_off(void *z80block)
+{
+    z80_core *c = &(((z80_block *) z80block)->core);
+    int i;
+
+    c->dcache_on = 0;
+
+    for ( i = 0 ; i < 256 ; i++ )
+    {
+        if ( c->dcache[i] != NULL )
+        {
+            free(c->dcache[i]);
+
+            c->dcache[i] = NULL;
+        }
+    }
+
+    return;
+}
+
+
+void z80_set_skip_none(void *z80block)
+{
+    ((z80_block *) z80block)->core.skip_mode = Z80_SKIP_NONE;
+
+    return;
+}
+
+void z80_set_skip_halt(void *z80block)
+{
+    ((z80_block *) z80block)->core.skip_mode = Z80_SKIP_HALT;
+
+    return;
+}
+
+void z80_set_skip_idle(void *z80block)
+{
+    ((z80_block *) z80block)->core.skip_mode  = Z80_SKIP_IDLE;
+    ((z80_block *) z80block)->core.idle_armed = 0;
+
+    return;
+}
+
+void z80_sync_flags(void *z80block)
+{
+    z80_flags(&(((z80_block *) z80block)->core));
+
+    return;
+}
+
+/*
+   Throw away everything the core has worked out from its state and from
+   memory: pre-decoded and translated code, the idle loop detector and any
+   flags not yet worked out (F is taken as it stands).  Call this after
+   changing the registers, page tables or memory from outside the core (eg.
+   when loading a snapshot).  Not to be called from within z80_cycle.
+*/
+
+void z80_flush(void *z80block)
+{
+    z80_block *z = (z80_block *) z80block;
+    z80_core *c = &(z->core);
+    int i;
+
+    for ( i = 0 ; i < 256 ; i++ )
+    {
+        z80_dcache_flush_page(c,(UINT_8) i);
+
+        #ifdef Z80_JIT
+        if ( c->jit_code[i] )
+        {
+            z80_jit_invalidate(z,(UINT_8) i);
+        }
+        #endif
+    }
+
+    c->dcache_next = NULL;
+    c->idle_armed  = 0;
+    c->lazy_op     = Z80_LAZY_NONE;
+
+    return;
+}
+
+/*
+   PC of the next instruction.  Only meaningful between calls to
+   z80_cycle.
+*/
+
+UINT_16 z80_get_pc(void *z80block)
+{
+    return ((z80_block *) z80block)->core.pc.w;
+}
+
+/*
+   Set up a trace ring of (at least) depth records, or turn tracing off if
+   depth is 0 (see "Tracing").  Any trace so far is thrown away.  If the
+   ring can't be allocated tracing is left off.  Does nothing unless
+   compiled with Z80_TRACE.  Mustn't be called from within z80_cycle.
+*/
+
+void z80_set_trace(void *z80block, UINT_32 depth)
+{
+    #ifdef Z80_TRACE
+    {
+        z80_core *c = &(((z80_block *) z80block)->core);
+        UINT_32 size = 1;
+
+        if ( c->trace != NULL )
+        {
+            free(c->trace);
+        }
+
+        c->trace       = NULL;
+        c->trace_rec   = NULL;
+        c->trace_mask  = 0;
+        c->trace_next  = 0;
+        c->trace_total = 0;
+
+        if ( depth )
+        {
+            while ( ( size < depth ) && ( size < 0x080000000L ) )
+            {
+                size <<= 1;
+            }
+
+            if ( ( c->trace = (z80_trace_rec *) calloc(size,sizeof(z80_trace_rec)) ) != NULL )
+            {
+                c->trace_mask = size - 1;
+            }
+        }
+    }
+    #endif
+
+    return;
+
+    z80block = NULL;
+    depth = 0;
+}
+
+
+/***********************************************************************/
+/***********************************************************************/
+/***********************************************************************/
+
+/*
+   Memory table setup.  Each call sets the access method for page tab_num
+   and (as in z80cpu.asm) updates the shared address and wait tables for
+   that page.  The method set is the page's real method, and
+   z80_page_modes works out the method actually used from it and any
+   watchpoints on the page (see "Watchpoints").
+*/
+
+#define Z80_PAGE_WR             0
+#define Z80_PAGE_RD             1
+#define Z80_PAGE_OP             2
+
+static void z80_page_modes(z80_core *c, UINT_8 page)
+{
+    c->wr_mode[page] = ( c->watch_page[page] & Z80_WATCH_WR ) ? Z80_MEM_INDIRECT : c->wr_real[page];
+    c->rd_mode[page] = ( c->watch_page[page] & Z80_WATCH_RD ) ? Z80_MEM_INDIRECT : c->rd_real[page];
+    c->op_mode[page] = ( c->watch_page[page] & Z80_WATCH_OP ) ? Z80_MEM_INDIRECT : c->op_real[page];
+
+    return;
+}
+
+static void z80_set_page(z80_block *z, int method, UINT_8 how, UINT_8 no_wait)
+{
+    z80_core *c = &(z->core);
+    UINT_8 page = (UINT_8) z->tab_num;
+
+    c->idle_armed = 0;
+
+    z80_dcache_flush_page(c,page);
+
+    #ifdef Z80_JIT
+    if ( c->jit_code[page] )
+    {
+        z80_jit_invalidate(z,page);
+    }
+    #endif
+
+    c->mem_wtwr[page] = (UINT_16) z->tab_wr_wait;
+    c->mem_wtrd[page] = (UINT_16) z->tab_rd_wait;
+    c->mem_addr[page] = z->tab_addr;
+
+    switch ( method )
+    {
+        case Z80_PAGE_WR: c->wr_real[page] = how; c->wr_naw[page] = no_wait; break;
+        case Z80_PAGE_RD: c->rd_real[page] = how; c->rd_naw[page] = no_wait; break;
+        default:          c->op_real[page] = how; c->op_naw[page] = no_wait; break;
+    }
+
+    z80_page_modes(c,page);
+
+    c->wr_wait[page] = (UINT_16) ( c->wr_naw[page] ? 0 : c->mem_wtwr[page] );
+    c->rd_wait[page] = (UINT_16) ( c->rd_naw[page] ? 0 : c->mem_wtrd[page] );
+    c->op_wait[page] = (UINT_16) ( c->op_naw[page] ? 0 : c->mem_wtrd[page] );
+
+    return;
+}
+
+void z80_set_mem_write_none(void *z80block)
+{
+    z80_set_page((z80_block *) z80block,Z80_PAGE_WR,Z80_MEM_NONE,0);
+
+    return;
+}
+
+void z80_set_mem_write_direct(void *z80block)
+{
+    z80_set_page((z80_block *) z80block,Z80_PAGE_WR,Z80_MEM_DIRECT,0);
+
+    return;
+}
+
+void z80_set_mem_write_indirect(void *z80block)
+{
+    z80_set_page((z80_block *) z80block,Z80_PAGE_WR,Z80_MEM_INDIRECT,0);
+
+    return;
+}
+
+void z80_set_mem_read_none(void *z80block)
+{
+    z80_set_page((z80_block *) z80block,Z80_PAGE_RD,Z80_MEM_NONE,0);
+
+    return;
+}
+
+void z80_set_mem_read_direct(void *z80block)
+{
+    z80_set_page((z80_block *) z80block,Z80_PAGE_RD,Z80_MEM_DIRECT,0);
+
+    return;
+}
+
+void z80_set_mem_read_indirect(void *z80block)
+{
+    z80_set_page((z80_block *) z80block,Z80_PAGE_RD,Z80_MEM_INDIRECT,0);
+
+    return;
+}
+
+void z80_set_mem_opread_none(void *z80block)
+{
+    z80_set_page((z80_block *) z80block,Z80_PAGE_OP,Z80_MEM_NONE,0);
+
+    return;
+}
+
+void z80_set_mem_opread_direct(void *z80block)
+{
+    z80_set_page((z80_block *) z80block,Z80_PAGE_OP,Z80_MEM_DIRECT,0);
+
+    return;
+}
+
+void z80_set_mem_opread_indirect(void *z80block)
+{
+    z80_set_page((z80_block *) z80block,Z80_PAGE_OP,Z80_MEM_INDIRECT,0);
+
+    return;
+}
+
+void z80_set_mem_write_none_naw(void *z80block)
+{
+    z80_set_page((z80_block *) z80block,Z80_PAGE_WR,Z80_MEM_NONE,1);
+
+    return;
+}
+
+void z80_set_mem_write_direct_naw(void *z80block)
+{
+    z80_set_page((z80_block *) z80block,Z80_PAGE_WR,Z80_MEM_DIRECT,1);
+
+    return;
+}
+
+void z80_set_mem_write_indirect_naw(void *z80block)
+{
+    z80_set_page((z80_block *) z80block,Z80_PAGE_WR,Z80_MEM_INDIRECT,1);
+
+    return;
+}
+
+void z80_set_mem_read_none_naw(void *z80block)
+{
+    z80_set_page((z80_block *) z80block,Z80_PAGE_RD,Z80_MEM_NONE,1);
+
+    return;
+}
+
+void z80_set_mem_read_direct_naw(void *z80block)
+{
+    z80_set_page((z80_block *) z80block,Z80_PAGE_RD,Z80_MEM_DIRECT,1);
+
+    return;
+}
+
+void z80_set_mem_read_indirect_naw(void *z80block)
+{
+    z80_set_page((z80_block *) z80block,Z80_PAGE_RD,Z80_MEM_INDIRECT,1);
+
+    return;
+}
+
+void z80_set_mem_opread_none_naw(void *z80block)
+{
+    z80_set_page((z80_block *) z80block,Z80_PAGE_OP,Z80_MEM_NONE,1);
+
+    return;
+}
+
+void z80_set_mem_opread_direct_naw(void *z80block)
+{
+    z80_set_page((z80_block *) z80block,Z80_PAGE_OP,Z80_MEM_DIRECT,1);
+
+    return;
+}
+
+void z80_set_mem_opread_indirect_naw(void *z80block)
+{
+    z80_set_page((z80_block *) z80block,Z80_PAGE_OP,Z80_MEM_INDIRECT,1);
+
+    return;
+}
+
+
+/*
+   Watchpoints (see "Watchpoints" above).  z80_watch_add returns 0 on
+   success, or 1 if no kind of access is given, the range is backwards or
+   Z80_WATCH_MAX ranges are already being watched.
+*/
+
+static void z80_watch_page(z80_block *z, UINT_8 page)
+{
+    z80_core *c = &(z->core);
+
+    c->idle_armed  = 0;
+    c->dcache_next = NULL;
+
+    z80_dcache_flush_page(c,page);
+
+    #ifdef Z80_JIT
+    if ( c->jit_code[page] )
+    {
+        z80_jit_invalidate(z,page);
+    }
+    #endif
+
+    z80_page_modes(c,page);
+
+    return;
+}
+
+int z80_watch_add(void *z80block, UINT_16 start, UINT_16 end, UINT_8 kinds)
+{
+    z80_block *z = (z80_block *) z80block;
+    z80_core *c = &(z->core);
+    int i;
+
+    kinds &= Z80_WATCH_WR | Z80_WATCH_RD | Z80_WATCH_OP;
+
+    if ( !kinds || ( start > end ) || ( c->watch_num >= Z80_WATCH_MAX ) )
+    {
+        return 1;
+    }
+
+    c->watch[c->watch_num].start = start;
+    c->watch[c->watch_num].end   = end;
+    c->watch[c->watch_num].kinds = kinds;
+
+    c->watch_num++;
+
+    for ( i = start >> 8 ; i <= ( end >> 8 ) ; i++ )
+    {
+        c->watch_page[i] |= kinds;
+
+        z80_watch_page(z,(UINT_8) i);
+    }
+
+    return 0;
+}
+
+void z80_watch_clear(void *z80block)
+{
+    z80_block *z = (z80_block *) z80block;
+    z80_core *c = &(z->core);
+    int i;
+
+    for ( i = 0 ; i < 256 ; i++ )
+    {
+        if ( c->watch_page[i] )
+        {
+            c->watch_page[i] = 0;
+
+            z80_watch_page(z,(UINT_8) i);
+        }
+    }
+
+    c->watch_num  = 0;
+    c->watch_hits = 0;
+
+    return;
+}
+
+#endif
@@ -0,0 +1,559 @@
+
+#include "u_dtype.h"
+
+#ifndef _z80core_h
+#define _z80core_h
+
+/*
+
+                         Z80 CPU Emulation Core
+                         ======================
+
+This is the interface between z80cpu.c (the module wrapper) and the z80
+emulation core proper.  There are two cores that provide this interface:
+
+z80core.c  - portable C core.  This is the default, and is the only core
+             that can be used on 64-bit hosts.
+z80cpu.asm - the original NASM core (32-bit COFF only).  To use it, define
+             Z80_ASM_CORE when compiling z80cpu.c and z80core.c and link
+             the object produced by nasm.
+
+Both cores work on a single block of memory (the z80_block), which is
+allocated by z80cpu.c and passed to every core function.  The start of the
+block is the external interface (buses and table buses), which is shared by
+both cores.  On 32-bit hosts these fields sit at the red_z80_* offsets
+used by z80cpu.asm.  The rest of the block is private to the core, apart
+from the back reference and clock counter at the end, which belong to
+z80cpu.c.
+
+See z80cpu.c for a description of the functions and buses.
+
+The C core can also translate code into x86-64 machine code as it runs
+(see z80jit.c).  This is enabled by defining Z80_JIT when compiling
+z80cpu.c, z80core.c and z80jit.c, and is quietly turned off if the host
+can't run it.
+
+The C core also has a pre-decoded instruction cache, which can be turned on
+and off at any time with z80_set_dcache_on and z80_set_dcache_off (see
+z80core.c).  Results are the same either way.  z80cpu.asm has no such
+cache, so with Z80_ASM_CORE z80cpu.c provides empty versions of both.
+
+Likewise the C core can skip over time spent in HALT, and in short loops
+that do nothing but poll an io port, rather than running it a cycle at a
+time (see "Skipping idle time" in z80core.c).  This is set with
+z80_set_skip_none, z80_set_skip_halt and z80_set_skip_idle, which are
+also empty with Z80_ASM_CORE.
+
+The C core can also watch ranges of addresses for writes, reads and
+opcode reads (z80_watch_add and z80_watch_clear, see "Watchpoints" in
+z80core.c).  With Z80_ASM_CORE z80cpu.c provides versions of these that
+refuse to set anything.
+
+If Z80_PROFILE is defined when compiling z80cpu.c and z80core.c, the C core
+counts executions and T-states for every opcode of each prefix table, and
+memory accesses by page and method, in the z80_profile part of its private
+data (see "Profiling" in z80core.c).  z80cpu.c reports these.  Without
+Z80_PROFILE none of this is compiled in.  The translator is turned off in
+profiling builds, as translated code doesn't go past the counters.
+
+If Z80_TRACE is defined when compiling z80cpu.c and z80core.c the C core
+can also keep a trace of the last few instructions run in a ring of fixed
+size binary records (z80_trace_rec), set up with z80_set_trace (see
+"Tracing" in z80core.c).  z80cpu.c dumps the ring to a file, and
+z80trace.c decodes the dump.  As with profiling, the translator is turned
+off in tracing builds.
+
+The C core (and the translator) keeps no state outside the z80_block: there
+are no writable globals or statics anywhere in z80core.c or z80jit.c, only
+constant tables.  Each z80cpu module therefore has a core of its own, and
+any number of them can be run at once, including from different threads
+provided each module is only ever used by one thread at a time.  The block
+is aligned to Z80_BLOCK_ALIGN bytes (a cache line on current hosts) so that
+blocks belonging to different threads never share a line.  z80cpu.asm
+keeps its state (what_ops, PC_incr and so on) in its own data section, so
+with Z80_ASM_CORE only one z80cpu module may exist at a time and
+z80cpu_init will refuse to create a second.
+
+This only goes for the cpu.  The interface (interf.c), the 6545 (6545.c)
+and mbee.c keep the rest of the machine in file-scope globals, so there
+can still only be one Microbee per process.  Independent cpus can be run
+side by side (see z80bench -instances), but whole machines have to be run
+as separate processes (see "Batch runs" in mbee.c).
+
+*/
+
+
+/*
+   The translator needs the C core and gcc on an x86-64 unix host (it
+   emits SysV calls and needs mmap), and isn't used when profiling or
+   tracing.  The profiler and trace need the C core.
+*/
+
+#if defined(Z80_JIT) && ( defined(Z80_ASM_CORE) || defined(Z80_PROFILE) || defined(Z80_TRACE) || !defined(__GNUC__) || !defined(__x86_64__) || defined(_WIN32) || defined(__CYGWIN__) )
+#undef Z80_JIT
+#endif
+
+#if defined(Z80_PROFILE) && defined(Z80_ASM_CORE)
+#undef Z80_PROFILE
+#endif
+
+#if defined(Z80_TRACE) && defined(Z80_ASM_CORE)
+#undef Z80_TRACE
+#endif
+
+/*
+   z80cpu.c runs the core while the clock counter (clk_count) is above
+   this value.
+*/
+
+#define Z80_CLK_COUNT_BASE      0x00fffffffL
+
+/*
+   Alignment of the z80_block (see above).  Must be a power of 2.
+*/
+
+#define Z80_BLOCK_ALIGN         64
+
+/*
+   Idle time skipping modes (see z80core.c).
+*/
+
+#define Z80_SKIP_NONE           0
+#define Z80_SKIP_HALT           1
+#define Z80_SKIP_IDLE           2
+
+
+/*
+   Memory page access methods (per page, separately for write, read and
+   opread).
+*/
+
+#define Z80_MEM_NONE            0
+#define Z80_MEM_DIRECT          1
+#define Z80_MEM_INDIRECT        2
+
+/*
+   Watchpoint kinds (see "Watchpoints" in z80core.c), and the number of
+   address ranges that can be watched at once.
+*/
+
+#define Z80_WATCH_WR            0x01
+#define Z80_WATCH_RD            0x02
+#define Z80_WATCH_OP            0x04
+
+#define Z80_WATCH_MAX           16
+
+/*
+   State byte bits (see z80cpu.c for details).
+*/
+
+#define Z80_ST1_DI              0x01
+#define Z80_ST1_IFF1            0x02
+#define Z80_ST1_IFF2            0x04
+#define Z80_ST1_IM0             0x08
+#define Z80_ST1_IM1             0x10
+
+#define Z80_ST2_INTOP           0x01
+#define Z80_ST2_HALTED          0x02
+#define Z80_ST2_INT             0x08
+#define Z80_ST2_NMI             0x10
+#define Z80_ST2_BUSRQ           0x20
+#define Z80_ST2_RESET           0x40
+
+/*
+   Flag register bits.
+*/
+
+#define Z80_FLAG_C              0x01
+#define Z80_FLAG_N              0x02
+#define Z80_FLAG_PV             0x04
+#define Z80_FLAG_3              0x08
+#define Z80_FLAG_H              0x10
+#define Z80_FLAG_5              0x20
+#define Z80_FLAG_Z              0x40
+#define Z80_FLAG_S              0x80
+
+/*
+   Size of the private scratch area used by z80cpu.asm (offsets 0x02c to
+   0x14ff of the original scratchpad).
+*/
+
+#define Z80_ASM_SCRATCH_SIZE    0x014d4
+
+#ifndef Z80_ASM_CORE
+
+/*
+   Pre-decoded instruction (see z80core.c).  op holds the opcode and
+   operand bytes, len the number of bytes, r_inc the number of opcode
+   fetches (each of which increments R) and clk the T-states taken by all
+   of the fetches.
+*/
+
+#define Z80_DCACHE_EMPTY        0
+#define Z80_DCACHE_VALID        1
+#define Z80_DCACHE_UNCACHED     2
+
+typedef struct
+{
+    UINT_8 op[4];
+    UINT_8 len;
+    UINT_8 r_inc;
+    UINT_8 clk;
+    UINT_8 state;
+}
+z80_dcache_rec;
+
+/*
+   Watched address range (start to end inclusive) and the kinds of access
+   watched.
+*/
+
+typedef struct
+{
+    UINT_16 start;
+    UINT_16 end;
+    UINT_8  kinds;
+}
+z80_watch;
+
+/*
+   Opcode and memory access profile (see z80core.c).  count and clk are
+   indexed by prefix table (Z80_PROF_MAIN etc) and opcode, mem by access
+   (Z80_PROF_WR etc), page and method (Z80_MEM_NONE etc).
+*/
+
+#define Z80_PROF_MAIN           0
+#define Z80_PROF_CB             1
+#define Z80_PROF_ED             2
+#define Z80_PROF_DD             3
+#define Z80_PROF_FD             4
+#define Z80_PROF_DDCB           5
+#define Z80_PROF_FDCB           6
+#define Z80_PROF_TABLES         7
+
+#define Z80_PROF_WR             0
+#define Z80_PROF_RD             1
+#define Z80_PROF_OP             2
+
+typedef struct
+{
+    UINT_64 count[Z80_PROF_TABLES][256];
+    UINT_64 clk[Z80_PROF_TABLES][256];
+    UINT_64 mem[3][256][3];
+}
+z80_profile;
+
+/*
+   Trace record (see z80core.c).  time is the number of T-states run since
+   z80_init at the start of the step, the registers are as they were at
+   the start of the step, op holds the len opcode and operand bytes
+   fetched during it (prefixes included), kind says what the step was
+   (Z80_TRACE_OP etc) and r and st1 are the R register and state byte 1 at
+   the start of the step.  Records are 32 bytes.
+*/
+
+#define Z80_TRACE_OP            0
+#define Z80_TRACE_INT           1
+#define Z80_TRACE_NMI           2
+
+typedef struct
+{
+    UINT_64 time;
+    UINT_16 pc;
+    UINT_16 af;
+    UINT_16 bc;
+    UINT_16 de;
+    UINT_16 hl;
+    UINT_16 sp;
+    UINT_16 ix;
+    UINT_16 iy;
+    UINT_8  op[4];
+    UINT_8  len;
+    UINT_8  kind;
+    UINT_8  r;
+    UINT_8  st1;
+}
+z80_trace_rec;
+
+/*
+   Register pair.  Define Z80_BIG_ENDIAN on big-endian hosts.
+*/
+
+typedef union
+{
+    UINT_16 w;
+    struct
+    {
+        #ifndef Z80_BIG_ENDIAN
+        UINT_8 l;
+        UINT_8 h;
+        #endif
+        #ifdef Z80_BIG_ENDIAN
+        UINT_8 h;
+        UINT_8 l;
+        #endif
+    }
+    b;
+}
+z80_pair;
+
+/*
+   Private state of the C core.
+
+   st1 and st2 follow the st1_ and st2_ layout described in z80cpu.c (the
+   mode bits of st1 are not used, as prefixed opcodes are always completed
+   in one step).  next_op records what the next call to z80_cycle will do,
+   as decided at the end of the previous call.  next_prefix holds a DD/FD
+   prefix that was fetched but not yet acted on (see z80core.c).
+
+   lazy_op is the last 8-bit arithmetic operation if F hasn't yet been
+   worked out from it, with its operands, carry and result in lazy_x,
+   lazy_y, lazy_c and lazy_r (see "Lazy flags" in z80core.c).  Use
+   z80_sync_flags before looking at F from outside the core.
+
+   The direct access page address and the wait tables are shared by the
+   write, read and opread methods (as is the case in z80cpu.asm).  The
+   *_wait arrays hold the waits that are actually inserted for each page,
+   which is zero for pages set up with the _naw functions.
+
+   jit_code is set for pages that hold translated code, jit_dirty is set
+   whenever translated code is thrown away, jit_failed is set if the
+   translator couldn't get its memory and jit points to the translator's
+   state (NULL until first used).
+
+   dcache points to the 256 pre-decoded instructions for each page (NULL
+   until code is first run from the page with the cache on), dcache_on is
+   set if the cache is in use and dcache_next points to the next cached
+   byte of the instruction being run from the cache (NULL otherwise).
+
+   wr_real, rd_real and op_real hold the methods the pages were set to,
+   which are the same as wr_mode etc except on pages with a watchpoint.
+   watch_page holds the kinds of watchpoint (Z80_WATCH_WR etc) on each
+   page, and watch the watch_num address ranges being watched.  watch_hits
+   counts the accesses caught since z80cpu.c last looked, and watch_kind,
+   watch_addr, watch_data and watch_pc describe the first of them.
+
+   skip_mode is the idle time skipping mode and skip_halt/skip_idle count
+   the T-states skipped in HALT and in idle loops.  idle_in is set by the
+   IN instructions the idle loop detector looks at, idle_armed is set while
+   idle_regs, idle_r, idle_i and idle_st1 hold the state just after the
+   last of them (at which point nothing with a side effect has happened
+   since), and idle_clk counts the T-states since then.
+
+   With Z80_PROFILE, prof_op holds the opcode bytes (prefixes included)
+   fetched so far in the current step and prof_n the number of them,
+   prof_bulk counts the extra iterations done by bulk runs in the step and
+   prof is the profile itself.
+
+   With Z80_TRACE, trace points to the ring of trace_mask+1 records (NULL
+   if tracing is off), trace_next is the index of the next record to be
+   written, trace_total the number of records written since the ring was
+   set up, trace_rec the record for the current step (NULL if the step
+   isn't traced) and trace_time the number of T-states run since z80_init.
+*/
+
+typedef struct
+{
+    z80_pair af;
+    z80_pair bc;
+    z80_pair de;
+    z80_pair hl;
+    z80_pair ix;
+    z80_pair iy;
+    z80_pair sp;
+    z80_pair pc;
+    z80_pair afx;
+    z80_pair bcx;
+    z80_pair dex;
+    z80_pair hlx;
+    z80_pair wz;
+
+    UINT_8  i;
+    UINT_8  r;
+    UINT_8  st1;
+    UINT_8  st2;
+    UINT_8  next_op;
+    UINT_8  next_prefix;
+
+    UINT_8  lazy_op;
+    UINT_8  lazy_x;
+    UINT_8  lazy_y;
+    UINT_8  lazy_c;
+    UINT_8  lazy_r;
+
+    UINT_16 wait_word;
+
+    UINT_8  wr_mode[256];
+    UINT_8  rd_mode[256];
+    UINT_8  op_mode[256];
+    UINT_8  wr_naw[256];
+    UINT_8  rd_naw[256];
+    UINT_8  op_naw[256];
+    UINT_16 wr_wait[256];
+    UINT_16 rd_wait[256];
+    UINT_16 op_wait[256];
+    UINT_16 mem_wtwr[256];
+    UINT_16 mem_wtrd[256];
+    UINT_8 *mem_addr[256];
+
+    z80_dcache_rec *dcache[256];
+    const UINT_8   *dcache_next;
+    UINT_8          dcache_on;
+
+    UINT_8   skip_mode;
+    UINT_8   idle_in;
+    UINT_8   idle_armed;
+    UINT_8   idle_r;
+    UINT_8   idle_i;
+    UINT_8   idle_st1;
+    UINT_32  idle_clk;
+    z80_pair idle_regs[13];
+    UINT_64  skip_halt;
+    UINT_64  skip_idle;
+
+    UINT_8    wr_real[256];
+    UINT_8    rd_real[256];
+    UINT_8    op_real[256];
+    UINT_8    watch_page[256];
+    z80_watch watch[Z80_WATCH_MAX];
+    UINT_8    watch_num;
+    UINT_8    watch_kind;
+    UINT_8    watch_data;
+    UINT_16   watch_addr;
+    UINT_16   watch_pc;
+    UINT_32   watch_hits;
+
+    #ifdef Z80_JIT
+    UINT_8  jit_code[256];
+    UINT_8  jit_dirty;
+    UINT_8  jit_failed;
+    void   *jit;
+    #endif
+
+    #ifdef Z80_PROFILE
+    UINT_8  prof_op[4];
+    UINT_8  prof_n;
+    UINT_32 prof_bulk;
+    z80_profile prof;
+    #endif
+
+    #ifdef Z80_TRACE
+    z80_trace_rec *trace;
+    z80_trace_rec *trace_rec;
+    UINT_32 trace_mask;
+    UINT_32 trace_next;
+    UINT_64 trace_total;
+    UINT_64 trace_time;
+    #endif
+}
+z80_core;
+
+#endif
+
+typedef struct
+{
+    /*
+       External interface.
+    */
+
+    UINT_32  tab_num;
+    UINT_8  *tab_addr;
+    UINT_32  tab_wr_wait;
+    UINT_32  tab_rd_wait;
+    UINT_32  wait;
+    UINT_32  rfsh;
+    UINT_32  data;
+    UINT_32  addr;
+    UINT_32  reserved;
+    UINT_32  clk;
+    UINT_32  reti;
+
+    /*
+       Core private data.
+    */
+
+    #ifdef Z80_ASM_CORE
+    UINT_8   asm_scratch[Z80_ASM_SCRATCH_SIZE];
+    #endif
+    #ifndef Z80_ASM_CORE
+    z80_core core;
+    #endif
+
+    /*
+       z80cpu.c data: module back reference, clock counter, end of run
+       request (see z80cpu_end_run) and the allocation the block was
+       aligned within (see z80cpu_init).  step_clk is the part of clk
+       already used by earlier instructions in the same step, which is
+       only ever non-zero within translated code (see z80_jit_step).
+    */
+
+    void    *module;
+    UINT_32  clk_count;
+    UINT_32  end_run;
+    void    *alloc;
+    UINT_32  step_clk;
+}
+z80_block;
+
+
+/* Emulator functions */
+
+void z80_init(void *z80block);
+void z80_cycle(void *z80block);
+void z80_set_reset(void *z80block);
+void z80_set_busrq(void *z80block);
+void z80_set_NMI(void *z80block);
+void z80_set_INT(void *z80block);
+void z80_res_INT(void *z80block);
+void z80_set_wait(void *z80block);
+void z80_set_dcache_on(void *z80block);
+void z80_set_dcache_off(void *z80block);
+void z80_set_skip_none(void *z80block);
+void z80_set_skip_halt(void *z80block);
+void z80_set_skip_idle(void *z80block);
+void z80_sync_flags(void *z80block);
+void z80_flush(void *z80block);
+UINT_16 z80_get_pc(void *z80block);
+void z80_set_trace(void *z80block, UINT_32 depth);
+int  z80_watch_add(void *z80block, UINT_16 start, UINT_16 end, UINT_8 kinds);
+void z80_watch_clear(void *z80block);
+
+void z80_set_mem_write_none(void *z80block);
+void z80_set_mem_write_direct(void *z80block);
+void z80_set_mem_write_indirect(void *z80block);
+
+void z80_set_mem_read_none(void *z80block);
+void z80_set_mem_read_direct(void *z80block);
+void z80_set_mem_read_indirect(void *z80block);
+
+void z80_set_mem_opread_none(void *z80block);
+void z80_set_mem_opread_direct(void *z80block);
+void z80_set_mem_opread_indirect(void *z80block);
+
+void z80_set_mem_write_none_naw(void *z80block);
+void z80_set_mem_write_direct_naw(void *z80block);
+void z80_set_mem_write_indirect_naw(void *z80block);
+
+void z80_set_mem_read_none_naw(void *z80block);
+void z80_set_mem_read_direct_naw(void *z80block);
+void z80_set_mem_read_indirect_naw(void *z80block);
+
+void z80_set_mem_opread_none_naw(void *z80block);
+void z80_set_mem_opread_direct_naw(void *z80block);
+void z80_set_mem_opread_indirect_naw(void *z80block);
+
+/* Functions provided to the emulator (by z80cpu.c) */
+
+void z80_sig_error(void *backref);
+void z80_ack_reset(void *backref);
+void z80_ack_busrq(void *backref);
+void z80_ack_halt(void *backref);
+void z80_ack_NMI(void *backref);
+void z80_ack_INT(void *backref);
+void z80_opfetch(void *backref);
+void z80_wr_mem(void *backref);
+void z80_rd_mem(void *backref);
+void z80_wr_io(void *backref);
+void z80_rd_io(void *backref);
+
+#endif
@@ -1,8 +1,12 @@
 
+#include <stdio.h>
+#include <string.h>
 #include "z80cpu.h"
 #include "u_dtype.h"
 #include "debmaloc.h"
 #include "modules.h"
+#include "z80core.h"
+#include "z80jit.h"
 
 /*
 
@@ -238,41 +242,7 @@ in the counter).
 
 
 
-/* Emulator functions */
-
-void z80_init(void *z80block);
-void z80_cycle(void *z80block);
-
-void z80_set_reset(void *z80block);
-void z80_set_busrq(void *z80block);
-void z80_set_NMI(void *z80block);
-void z80_set_INT(void *z80block);
-void z80_res_INT(void *z80block);
-void z80_set_wait(void *z80block);
-
-void z80_set_mem_write_none(void *z80block);
-void z80_set_mem_write_direct(void *z80block);
-void z80_set_mem_write_indirect(void *z80block);
-
-void z80_set_mem_read_none(void *z80block);
-void z80_set_mem_read_direct(void *z80block);
-void z80_set_mem_read_indirect(void *z80block);
-
-void z80_set_mem_opread_none(void *z80block);
-void z80_set_mem_opread_direct(void *z80block);
-void z80_set_mem_opread_indirect(void *z80block);
-
-void z80_set_mem_write_none_naw(void *z80block);
-void z80_set_mem_write_direct_naw(void *z80block);
-void z80_set_mem_write_indirect_naw(void *z80block);
-
-void z80_set_mem_read_none_naw(void *z80block);
-void z80_set_mem_read_direct_naw(void *z80block);
-void z80_set_mem_read_indirect_naw(void *z80block);
-
-void z80_set_mem_opread_none_naw(void *z80block);
-void z80_set_mem_opread_direct_naw(void *z80block);
-void z80_set_mem_opread_indirect_naw(void *z80block);
+/* Emulator functions - see z80core.h */
 
 
 
@@ -313,6 +283,13 @@ void z80cpu_set_NMI(void *what);
 void z80cpu_set_INT(void *what);
 void z80cpu_res_INT(void *what);
 void z80cpu_set_wait(void *what);
+void z80cpu_set_dcache_on(void *what);
+void z80cpu_set_dcache_off(void *what);
+void z80cpu_end_run(void *what);
+void z80cpu_set_skip_none(void *what);
+void z80cpu_set_skip_halt(void *what);
+void z80cpu_set_skip_idle(void *what);
+void z80cpu_dump_trace(void *what);
 
 void z80cpu_set_mem_write_none(void *what);
 void z80cpu_set_mem_write_direct(void *what);
@@ -341,22 +318,6 @@ void z80cpu_set_mem_opread_indirect_naw(void *what);
 
 
 
-void z80_sig_error(void *backref);
-void z80_ack_reset(void *backref);
-void z80_ack_busrq(void *backref);
-void z80_ack_halt(void *backref);
-void z80_ack_NMI(void *backref);
-void z80_ack_INT(void *backref);
-void z80_opfetch(void *backref);
-void z80_wr_mem(void *backref);
-void z80_rd_mem(void *backref);
-void z80_wr_io(void *backref);
-void z80_rd_io(void *backref);
-
-
-
-
-
 #define Z80CPU_WAIT_BUS(what)   DEREF_8BUS(what,0)
 #define Z80CPU_RFSH_BUS(what)   DEREF_8BUS(what,1)
 #define Z80CPU_DATA_BUS(what)   DEREF_8BUS(what,2)
@@ -366,22 +327,26 @@ void z80_rd_io(void *backref);
 #define Z80CPU_ADDR_BUS(what)   DEREF_16BUS(what,0)
 #define Z80CPU_TWRW_BUS(what)   DEREF_16BUS(what,1)
 #define Z80CPU_TRDW_BUS(what)   DEREF_16BUS(what,2)
+#define Z80CPU_LEFT_BUS(what)   DEREF_16BUS(what,3)
 #define Z80CPU_RETI_BUS(what)   DEREF_32BUS(what,0)
 
 
-#define Z80CPU_TNUM_LOCAL(what) (*((UINT_8  *) &(((UINT_32 *) DEREF_INTERNAL(what))[0x0000])))
-#define Z80CPU_TDAC_LOCAL(what) (*((UINT_8 **) &(((UINT_32 *) DEREF_INTERNAL(what))[0x0001])))
-#define Z80CPU_TWRW_LOCAL(what) (*((UINT_16 *) &(((UINT_32 *) DEREF_INTERNAL(what))[0x0002])))
-#define Z80CPU_TRDW_LOCAL(what) (*((UINT_16 *) &(((UINT_32 *) DEREF_INTERNAL(what))[0x0003])))
-#define Z80CPU_WAIT_LOCAL(what) (*((UINT_8  *) &(((UINT_32 *) DEREF_INTERNAL(what))[0x0004])))
-#define Z80CPU_RFSH_LOCAL(what) (*((UINT_8  *) &(((UINT_32 *) DEREF_INTERNAL(what))[0x0005])))
-#define Z80CPU_DATA_LOCAL(what) (*((UINT_8  *) &(((UINT_32 *) DEREF_INTERNAL(what))[0x0006])))
-#define Z80CPU_ADDR_LOCAL(what) (*((UINT_16 *) &(((UINT_32 *) DEREF_INTERNAL(what))[0x0007])))
-#define Z80CPU_CLK__LOCAL(what) (*((UINT_16 *) &(((UINT_32 *) DEREF_INTERNAL(what))[0x0009])))
-#define Z80CPU_RETI_LOCAL(what) (*((UINT_32 *) &(((UINT_32 *) DEREF_INTERNAL(what))[0x000A])))
+#define Z80CPU_BLOCK(what)      ((z80_block *) DEREF_INTERNAL(what))
 
+#define Z80CPU_TNUM_LOCAL(what) (Z80CPU_BLOCK(what)->tab_num)
+#define Z80CPU_TDAC_LOCAL(what) (Z80CPU_BLOCK(what)->tab_addr)
+#define Z80CPU_TWRW_LOCAL(what) (Z80CPU_BLOCK(what)->tab_wr_wait)
+#define Z80CPU_TRDW_LOCAL(what) (Z80CPU_BLOCK(what)->tab_rd_wait)
+#define Z80CPU_WAIT_LOCAL(what) (Z80CPU_BLOCK(what)->wait)
+#define Z80CPU_RFSH_LOCAL(what) (Z80CPU_BLOCK(what)->rfsh)
+#define Z80CPU_DATA_LOCAL(what) (Z80CPU_BLOCK(what)->data)
+#define Z80CPU_ADDR_LOCAL(what) (Z80CPU_BLOCK(what)->addr)
+#define Z80CPU_CLK__LOCAL(what) (Z80CPU_BLOCK(what)->clk)
+#define Z80CPU_RETI_LOCAL(what) (Z80CPU_BLOCK(what)->reti)
 
-#define Z80CPU_CLK_COUNT(what)  (*((UINT_32 *) &(((UINT_32 *) DEREF_INTERNAL(what))[0x0544])))
+#define Z80CPU_CLK_COUNT(what)  (Z80CPU_BLOCK(what)->clk_count)
+#define Z80CPU_END_RUN(what)    (Z80CPU_BLOCK(what)->end_run)
+#define Z80CPU_STEP_CLK(what)   (Z80CPU_BLOCK(what)->step_clk)
 
 
 #define Z80CPU_SIGERR_OUT(what) OUTFNCALL(what,0)
@@ -397,18 +362,27 @@ void z80_rd_io(void *backref);
 #define Z80CPU_IO__RD_OUT(what) OUTFNCALL(what,10)
 
 
-/* here be dragons */
-#define Z80CPU_GET_MODULE(what) ((module_data *) (((UINT_32 **) (what))[0x0540]))
+#define Z80CPU_GET_MODULE(what) ((module_data *) (((z80_block *) (what))->module))
 #define Z80CPU_SCRATCHPAD(what) DEREF_INTERNAL(what)
 
 
+/*
+   z80cpu.asm keeps its state in its own data section, so only one module
+   can use it at a time (see z80core.h).  The C core needs no such flag.
+*/
+
+#ifdef Z80_ASM_CORE
+static int z80cpu_asm_in_use = 0;
+#endif
+
+
 
 
 module_data *z80cpu_alloc(const char *module_name)
 {
     module_data *result;
 
-    result = gen_module_data(module_name,1,0,0,0,0,0,6,3,1,24,11);
+    result = gen_module_data(module_name,1,0,0,0,0,0,6,4,1,31,11);
 
     return result;
 }
@@ -416,6 +390,7 @@ module_data *z80cpu_alloc(const char *module_name)
 int z80cpu_init(module_data *what)
 {
     int result = 1;
+    void *alloc;
 
     DEREF_INFN(what,0)  = z80cpu_set_reset;
     DEREF_INFN(what,1)  = z80cpu_set_busrq;
@@ -441,14 +416,44 @@ int z80cpu_init(module_data *what)
     DEREF_INFN(what,21) = z80cpu_set_mem_opread_none_naw;
     DEREF_INFN(what,22) = z80cpu_set_mem_opread_direct_naw;
     DEREF_INFN(what,23) = z80cpu_set_mem_opread_indirect_naw;
+    DEREF_INFN(what,24) = z80cpu_set_dcache_on;
+    DEREF_INFN(what,25) = z80cpu_set_dcache_off;
+    DEREF_INFN(what,26) = z80cpu_end_run;
+    DEREF_INFN(what,27) = z80cpu_set_skip_none;
+    DEREF_INFN(what,28) = z80cpu_set_skip_halt;
+    DEREF_INFN(what,29) = z80cpu_set_skip_idle;
+    DEREF_INFN(what,30) = z80cpu_dump_trace;
+
+    Z80CPU_SCRATCHPAD(what) = NULL;
+
+    #ifdef Z80_ASM_CORE
+    if ( z80cpu_asm_in_use )
+    {
+        return result;
+    }
+    #endif
 
-    if ( ( Z80CPU_SCRATCHPAD(what) = DEBMALLOC(0x01600) ) != NULL )
+    /*
+       The block is aligned to Z80_BLOCK_ALIGN within a slightly larger
+       allocation, which is kept in the block so that it can be freed.
+    */
+
+    if ( ( alloc = DEBMALLOC(sizeof(z80_block)+Z80_BLOCK_ALIGN-1) ) != NULL )
     {
+        Z80CPU_SCRATCHPAD(what) = (void *) ( ( ( (size_t) alloc ) + Z80_BLOCK_ALIGN - 1 ) & ~( (size_t) ( Z80_BLOCK_ALIGN - 1 ) ) );
+
+        memset(Z80CPU_SCRATCHPAD(what),0,sizeof(z80_block));
+
+        Z80CPU_BLOCK(what)->module = (void *) what;
+        Z80CPU_BLOCK(what)->alloc  = alloc;
+
+        #ifdef Z80_ASM_CORE
+        z80cpu_asm_in_use = 1;
+        #endif
+
         result = 0;
     }
 
-    ((void **) Z80CPU_SCRATCHPAD(what))[0x0540] = (void *) what;
-
     return result;
 }
 
@@ -456,7 +461,7 @@ void z80cpu_go(module_data *what)
 {
     z80_init(Z80CPU_SCRATCHPAD(what));
 
-    Z80CPU_CLK_COUNT(what) = 0x00fffffff;
+    Z80CPU_CLK_COUNT(what) = Z80_CLK_COUNT_BASE;
 
     return;
 }
@@ -474,7 +479,18 @@ void z80cpu_remove(module_data *what)
     {
         if ( Z80CPU_SCRATCHPAD(what) != NULL )
         {
-            DEBFREE(Z80CPU_SCRATCHPAD(what));
+            #ifdef Z80_JIT
+            z80_jit_free(Z80CPU_BLOCK(what));
+            #endif
+
+            z80_set_dcache_off(Z80CPU_SCRATCHPAD(what));
+            z80_set_trace(Z80CPU_SCRATCHPAD(what),0);
+
+            #ifdef Z80_ASM_CORE
+            z80cpu_asm_in_use = 0;
+            #endif
+
+            DEBFREE(Z80CPU_BLOCK(what)->alloc);
         }
 
         free_module_data(what);
@@ -485,15 +501,40 @@ void z80cpu_remove(module_data *what)
 
 void z80cpu_cycle(module_data *what, UINT_16 num_cycles, UINT_8 clock_div, int lsync_point)
 {
+    UINT_32 clk_start;
+    UINT_32 clk_left;
+
     Z80CPU_CLK_COUNT(what)  += num_cycles;
     Z80CPU_CLK__LOCAL(what)  = 0;
+    Z80CPU_END_RUN(what)     = 0;
+    Z80CPU_LEFT_BUS(what)    = 0;
 
-    while ( Z80CPU_CLK_COUNT(what) > 0x00fffffff )
+    while ( Z80CPU_CLK_COUNT(what) > Z80_CLK_COUNT_BASE )
     {
+        clk_start = Z80CPU_CLK_COUNT(what);
+
+        Z80CPU_STEP_CLK(what) = 0;
+
         z80_cycle(Z80CPU_SCRATCHPAD(what));
 
         Z80CPU_CLK_COUNT(what)  -= Z80CPU_CLK__LOCAL(what);
         Z80CPU_CLK__LOCAL(what)  = 0;
+
+        if ( Z80CPU_END_RUN(what) )
+        {
+            /*
+               Drop the whole slices of the run after the one in which the
+               instruction just executed started (see z80cpu.h).
+            */
+
+            Z80CPU_END_RUN(what) = 0;
+
+            clk_left  = clk_start - Z80_CLK_COUNT_BASE - Z80CPU_STEP_CLK(what) - 1;
+            clk_left -= clk_left % Z80CPU_RUN_SLICE;
+
+            Z80CPU_CLK_COUNT(what) -= clk_left;
+            Z80CPU_LEFT_BUS(what)  += (UINT_16) clk_left;
+        }
     }
 
     return;
@@ -502,19 +543,583 @@ void z80cpu_cycle(module_data *what, UINT_16 num_cycles, UINT_8 clock_div, int l
     lsync_point = 0;
 }
 
+/*
+   Clock cycles from the start of the slice of the run in which the
+   current instruction started to the end of the run (see z80cpu.h).
+*/
+
+UINT_32 z80cpu_run_left(module_data *what)
+{
+    UINT_32 clk_left;
+
+    clk_left = Z80CPU_CLK_COUNT(what) - Z80_CLK_COUNT_BASE - Z80CPU_STEP_CLK(what);
+
+    return ( ( clk_left + Z80CPU_RUN_SLICE - 1 ) / Z80CPU_RUN_SLICE ) * Z80CPU_RUN_SLICE;
+}
+
+#define Z80CPU_MESSAGE_SIZE 200
+
+/*
+   Profile report (see z80cpu.h).  Z80CPU_PROF_TOP is the number of opcodes
+   listed by z80cpu_getinf.
+*/
+
+#define Z80CPU_PROF_TOP         10
+#define Z80CPU_PROF_LINE        100
+
+#ifdef Z80_PROFILE
+static const char *z80cpu_prof_table[Z80_PROF_TABLES] = { "main", "cb", "ed", "dd", "fd", "ddcb", "fdcb" };
+static const char *z80cpu_prof_method[3] = { "none", "direct", "indirect" };
+static const char *z80cpu_prof_access[3] = { "writes", "reads", "opreads" };
+
+static void z80cpu_prof_summary(z80_profile *prof, char *dest)
+{
+    UINT_64 total_count = 0;
+    UINT_64 total_clk = 0;
+    UINT_64 by_method[3][3];
+    UINT_64 last = ~( (UINT_64) 0 );
+    UINT_64 best;
+    int best_tab;
+    int best_op;
+    int tab;
+    int op;
+    int n;
+    int i;
+
+    memset(by_method,0,sizeof(by_method));
+
+    for ( tab = 0 ; tab < Z80_PROF_TABLES ; tab++ )
+    {
+        for ( op = 0 ; op < 256 ; op++ )
+        {
+            total_count += prof->count[tab][op];
+            total_clk   += prof->clk[tab][op];
+        }
+    }
+
+    for ( i = 0 ; i < 3 ; i++ )
+    {
+        for ( op = 0 ; op < 256 ; op++ )
+        {
+            for ( n = 0 ; n < 3 ; n++ )
+            {
+                by_method[i][n] += prof->mem[i][op][n];
+            }
+        }
+    }
+
+    dest += sprintf(dest,"Z80 instructions executed:              %lu (%lu clock cycles)" "\n",
+                         (unsigned long) total_count,(unsigned long) total_clk);
+
+    for ( i = 0 ; i < 3 ; i++ )
+    {
+        dest += sprintf(dest,"Z80 %-7s direct/indirect/none:       %lu/%lu/%lu" "\n",
+                             z80cpu_prof_access[i],
+                             (unsigned long) by_method[i][Z80_MEM_DIRECT],
+                             (unsigned long) by_method[i][Z80_MEM_INDIRECT],
+                             (unsigned long) by_method[i][Z80_MEM_NONE]);
+    }
+
+    /*
+       Opcodes taking the most clock cycles, largest first (opcodes with
+       exactly the same count as one already listed are left out, which is
+       good enough for a summary).
+    */
+
+    for ( n = 0 ; n < Z80CPU_PROF_TOP ; n++ )
+    {
+        best = 0;
+        best_tab = 0;
+        best_op = 0;
+
+        for ( tab = 0 ; tab < Z80_PROF_TABLES ; tab++ )
+        {
+            for ( op = 0 ; op < 256 ; op++ )
+            {
+                if ( ( prof->clk[tab][op] > best ) && ( prof->clk[tab][op] < last ) )
+                {
+                    best     = prof->clk[tab][op];
+                    best_tab = tab;
+                    best_op  = op;
+                }
+            }
+        }
+
+        if ( !best )
+        {
+            break;
+        }
+
+        dest += sprintf(dest,"  %-4s %02x: %lu executions, %lu clock cycles" "\n",
+                             z80cpu_prof_table[best_tab],best_op,
+                             (unsigned long) prof->count[best_tab][best_op],
+                             (unsigned long) best);
+
+        last = best;
+    }
+
+    return;
+}
+#endif
+
 char *z80cpu_getinf(module_data *what)
 {
     char *dest;
 
-    dest = DEBMALLOC(10*sizeof(UINT_8));
+    #ifdef Z80_PROFILE
+    dest = DEBMALLOC((Z80CPU_MESSAGE_SIZE+((Z80CPU_PROF_TOP+4)*Z80CPU_PROF_LINE)+1)*sizeof(char));
+    #endif
+    #ifndef Z80_PROFILE
+    dest = DEBMALLOC((Z80CPU_MESSAGE_SIZE+1)*sizeof(char));
+    #endif
 
+    if ( dest == NULL )
+    {
+        return NULL;
+    }
+
+    #ifndef Z80_ASM_CORE
+    sprintf(dest,"Z80 clock cycles skipped in HALT:       %lu" "\n"
+                 "Z80 clock cycles skipped in idle loops: %lu" "\n",
+                 (unsigned long) Z80CPU_BLOCK(what)->core.skip_halt,
+                 (unsigned long) Z80CPU_BLOCK(what)->core.skip_idle);
+    #endif
+    #ifdef Z80_ASM_CORE
     sprintf(dest,"\n");
+    #endif
+
+    #ifdef Z80_PROFILE
+    z80cpu_prof_summary(&(Z80CPU_BLOCK(what)->core.prof),dest+strlen(dest));
+    #endif
 
     return dest;
 
     what = NULL;
 }
 
+int z80cpu_profile_csv(module_data *what, const char *op_file, const char *mem_file)
+{
+    int result = 1;
+
+    #ifdef Z80_PROFILE
+    {
+        z80_profile *prof = &(Z80CPU_BLOCK(what)->core.prof);
+        FILE *fp;
+        int tab;
+        int op;
+        int page;
+        int method;
+
+        result = 0;
+
+        if ( ( fp = fopen(op_file,"w") ) == NULL )
+        {
+            return 1;
+        }
+
+        fprintf(fp,"table,opcode,count,clocks\n");
+
+        for ( tab = 0 ; tab < Z80_PROF_TABLES ; tab++ )
+        {
+            for ( op = 0 ; op < 256 ; op++ )
+            {
+                if ( prof->count[tab][op] )
+                {
+                    fprintf(fp,"%s,%02x,%lu,%lu\n",z80cpu_prof_table[tab],op,
+                               (unsigned long) prof->count[tab][op],
+                               (unsigned long) prof->clk[tab][op]);
+                }
+            }
+        }
+
+        if ( fclose(fp) )
+        {
+            result = 1;
+        }
+
+        if ( ( fp = fopen(mem_file,"w") ) == NULL )
+        {
+            return 1;
+        }
+
+        fprintf(fp,"page,method,writes,reads,opreads\n");
+
+        for ( page = 0 ; page < 256 ; page++ )
+        {
+            for ( method = 0 ; method < 3 ; method++ )
+            {
+                if ( prof->mem[Z80_PROF_WR][page][method] || prof->mem[Z80_PROF_RD][page][method] || prof->mem[Z80_PROF_OP][page][method] )
+                {
+                    fprintf(fp,"%02x,%s,%lu,%lu,%lu\n",page,z80cpu_prof_method[method],
+                               (unsigned long) prof->mem[Z80_PROF_WR][page][method],
+                               (unsigned long) prof->mem[Z80_PROF_RD][page][method],
+                               (unsigned long) prof->mem[Z80_PROF_OP][page][method]);
+                }
+            }
+        }
+
+        if ( fclose(fp) )
+        {
+            result = 1;
+        }
+    }
+    #endif
+
+    return result;
+
+    what = NULL;
+    op_file = NULL;
+    mem_file = NULL;
+}
+
+
+/*
+   Trace (see z80cpu.h).  Everything in the dump is little-endian,
+   whatever the host.
+*/
+
+#define Z80CPU_TRACE_HEAD       32
+#define Z80CPU_TRACE_REC        32
+
+#ifdef Z80_TRACE
+static void z80cpu_trace_put(UINT_8 *dest, UINT_64 val, int len)
+{
+    int i;
+
+    for ( i = 0 ; i < len ; i++ )
+    {
+        dest[i] = (UINT_8) ( val >> ( 8 * i ) );
+    }
+
+    return;
+}
+#endif
+
+UINT_16 z80cpu_get_pc(module_data *what)
+{
+    return z80_get_pc(Z80CPU_SCRATCHPAD(what));
+}
+
+void z80cpu_set_trace(module_data *what, UINT_32 depth)
+{
+    z80_set_trace(Z80CPU_SCRATCHPAD(what),depth);
+
+    return;
+}
+
+int z80cpu_trace_dump(module_data *what, const char *filename)
+{
+    int result = 1;
+
+    #ifdef Z80_TRACE
+    {
+        z80_core *c = &(Z80CPU_BLOCK(what)->core);
+        z80_trace_rec *rec;
+        UINT_8 buffer[Z80CPU_TRACE_HEAD];
+        UINT_32 num;
+        UINT_32 i;
+        FILE *fp;
+
+        result = 0;
+
+        if ( c->trace == NULL )
+        {
+            return 1;
+        }
+
+        if ( ( fp = fopen(filename,"wb") ) == NULL )
+        {
+            return 1;
+        }
+
+        num = ( c->trace_total > c->trace_mask ) ? c->trace_mask + 1 : (UINT_32) c->trace_total;
+
+        memset(buffer,0,Z80CPU_TRACE_HEAD);
+        memcpy(buffer,Z80CPU_TRACE_MAGIC,8);
+        z80cpu_trace_put(buffer+8, Z80CPU_TRACE_VERSION,4);
+        z80cpu_trace_put(buffer+12,Z80CPU_TRACE_REC,4);
+        z80cpu_trace_put(buffer+16,num,4);
+        z80cpu_trace_put(buffer+20,c->trace_total,8);
+
+        if ( fwrite(buffer,1,Z80CPU_TRACE_HEAD,fp) != Z80CPU_TRACE_HEAD )
+        {
+            result = 1;
+        }
+
+        /*
+           Oldest record first.
+        */
+
+        for ( i = 0 ; ( i < num ) && !result ; i++ )
+        {
+            rec = &((c->trace)[( c->trace_next - num + i ) & c->trace_mask]);
+
+            z80cpu_trace_put(buffer,   rec->time,8);
+            z80cpu_trace_put(buffer+8, rec->pc,  2);
+            z80cpu_trace_put(buffer+10,rec->af,  2);
+            z80cpu_trace_put(buffer+12,rec->bc,  2);
+            z80cpu_trace_put(buffer+14,rec->de,  2);
+            z80cpu_trace_put(buffer+16,rec->hl,  2);
+            z80cpu_trace_put(buffer+18,rec->sp,  2);
+            z80cpu_trace_put(buffer+20,rec->ix,  2);
+            z80cpu_trace_put(buffer+22,rec->iy,  2);
+            memcpy(buffer+24,rec->op,4);
+            buffer[28] = rec->len;
+            buffer[29] = rec->kind;
+            buffer[30] = rec->r;
+            buffer[31] = rec->st1;
+
+            if ( fwrite(buffer,1,Z80CPU_TRACE_REC,fp) != Z80CPU_TRACE_REC )
+            {
+                result = 1;
+            }
+        }
+
+        if ( fclose(fp) )
+        {
+            result = 1;
+        }
+    }
+    #endif
+
+    return result;
+
+    what = NULL;
+    filename = NULL;
+}
+
+/*
+   Snapshot (see z80cpu.h).  The page address is only saved for pages with
+   at least one direct method, as it isn't used otherwise (and needn't
+   point anywhere sensible).
+*/
+
+#ifndef Z80_ASM_CORE
+static void z80cpu_put_pair(snap_data *snap, z80_pair *pair)
+{
+    snap_put16(snap,pair->w);
+
+    return;
+}
+
+static void z80cpu_get_pair(snap_data *snap, z80_pair *pair)
+{
+    pair->w = snap_get16(snap);
+
+    return;
+}
+#endif
+
+int z80cpu_serialise(module_data *what, snap_data *snap)
+{
+    #ifndef Z80_ASM_CORE
+    z80_block *z = Z80CPU_BLOCK(what);
+    z80_core *c = &(z->core);
+    int i;
+
+    z80_sync_flags(z);
+
+    snap_put32(snap,z->wait);
+    snap_put32(snap,z->rfsh);
+    snap_put32(snap,z->data);
+    snap_put32(snap,z->addr);
+    snap_put32(snap,z->reserved);
+    snap_put32(snap,z->clk);
+    snap_put32(snap,z->reti);
+    snap_put32(snap,z->clk_count);
+    snap_put32(snap,z->end_run);
+
+    z80cpu_put_pair(snap,&(c->af));
+    z80cpu_put_pair(snap,&(c->bc));
+    z80cpu_put_pair(snap,&(c->de));
+    z80cpu_put_pair(snap,&(c->hl));
+    z80cpu_put_pair(snap,&(c->ix));
+    z80cpu_put_pair(snap,&(c->iy));
+    z80cpu_put_pair(snap,&(c->sp));
+    z80cpu_put_pair(snap,&(c->pc));
+    z80cpu_put_pair(snap,&(c->afx));
+    z80cpu_put_pair(snap,&(c->bcx));
+    z80cpu_put_pair(snap,&(c->dex));
+    z80cpu_put_pair(snap,&(c->hlx));
+    z80cpu_put_pair(snap,&(c->wz));
+
+    snap_put8(snap,c->i);
+    snap_put8(snap,c->r);
+    snap_put8(snap,c->st1);
+    snap_put8(snap,c->st2);
+    snap_put8(snap,c->next_op);
+    snap_put8(snap,c->next_prefix);
+    snap_put16(snap,c->wait_word);
+
+    for ( i = 0 ; i < 256 ; i++ )
+    {
+        snap_put8(snap,c->wr_real[i]);
+        snap_put8(snap,c->rd_real[i]);
+        snap_put8(snap,c->op_real[i]);
+        snap_put8(snap,c->wr_naw[i]);
+        snap_put8(snap,c->rd_naw[i]);
+        snap_put8(snap,c->op_naw[i]);
+        snap_put16(snap,c->mem_wtwr[i]);
+        snap_put16(snap,c->mem_wtrd[i]);
+
+        if ( ( c->wr_real[i] == Z80_MEM_DIRECT ) || ( c->rd_real[i] == Z80_MEM_DIRECT ) || ( c->op_real[i] == Z80_MEM_DIRECT ) )
+        {
+            snap_put_ptr(snap,c->mem_addr[i]);
+        }
+
+        else
+        {
+            snap_put_ptr(snap,NULL);
+        }
+    }
+
+    return snap->error;
+    #endif
+
+    #ifdef Z80_ASM_CORE
+    return 1;
+
+    what = NULL;
+    snap = NULL;
+    #endif
+}
+
+int z80cpu_deserialise(module_data *what, snap_data *snap)
+{
+    #ifndef Z80_ASM_CORE
+    z80_block *z = Z80CPU_BLOCK(what);
+    z80_core *c = &(z->core);
+    int i;
+
+    z->wait      = snap_get32(snap);
+    z->rfsh      = snap_get32(snap);
+    z->data      = snap_get32(snap);
+    z->addr      = snap_get32(snap);
+    z->reserved  = snap_get32(snap);
+    z->clk       = snap_get32(snap);
+    z->reti      = snap_get32(snap);
+    z->clk_count = snap_get32(snap);
+    z->end_run   = snap_get32(snap);
+
+    z80cpu_get_pair(snap,&(c->af));
+    z80cpu_get_pair(snap,&(c->bc));
+    z80cpu_get_pair(snap,&(c->de));
+    z80cpu_get_pair(snap,&(c->hl));
+    z80cpu_get_pair(snap,&(c->ix));
+    z80cpu_get_pair(snap,&(c->iy));
+    z80cpu_get_pair(snap,&(c->sp));
+    z80cpu_get_pair(snap,&(c->pc));
+    z80cpu_get_pair(snap,&(c->afx));
+    z80cpu_get_pair(snap,&(c->bcx));
+    z80cpu_get_pair(snap,&(c->dex));
+    z80cpu_get_pair(snap,&(c->hlx));
+    z80cpu_get_pair(snap,&(c->wz));
+
+    c->i           = snap_get8(snap);
+    c->r           = snap_get8(snap);
+    c->st1         = snap_get8(snap);
+    c->st2         = snap_get8(snap);
+    c->next_op     = snap_get8(snap);
+    c->next_prefix = snap_get8(snap);
+    c->wait_word   = snap_get16(snap);
+
+    for ( i = 0 ; i < 256 ; i++ )
+    {
+        c->wr_real[i]  = snap_get8(snap);
+        c->rd_real[i]  = snap_get8(snap);
+        c->op_real[i]  = snap_get8(snap);
+        c->wr_naw[i]   = snap_get8(snap);
+        c->rd_naw[i]   = snap_get8(snap);
+        c->op_naw[i]   = snap_get8(snap);
+        c->mem_wtwr[i] = snap_get16(snap);
+        c->mem_wtrd[i] = snap_get16(snap);
+        c->mem_addr[i] = snap_get_ptr(snap);
+
+        c->wr_wait[i] = (UINT_16) ( c->wr_naw[i] ? 0 : c->mem_wtwr[i] );
+        c->rd_wait[i] = (UINT_16) ( c->rd_naw[i] ? 0 : c->mem_wtrd[i] );
+        c->op_wait[i] = (UINT_16) ( c->op_naw[i] ? 0 : c->mem_wtrd[i] );
+
+        /*
+           Never leave a direct page without an address, even if the
+           snapshot is bad.
+        */
+
+        if ( c->mem_addr[i] == NULL )
+        {
+            if ( c->wr_real[i] == Z80_MEM_DIRECT ) { c->wr_real[i] = Z80_MEM_INDIRECT; }
+            if ( c->rd_real[i] == Z80_MEM_DIRECT ) { c->rd_real[i] = Z80_MEM_INDIRECT; }
+            if ( c->op_real[i] == Z80_MEM_DIRECT ) { c->op_real[i] = Z80_MEM_INDIRECT; }
+        }
+
+        /*
+           Watchpoints stay as they are, so watched accesses stay
+           indirect.
+        */
+
+        c->wr_mode[i] = ( c->watch_page[i] & Z80_WATCH_WR ) ? Z80_MEM_INDIRECT : c->wr_real[i];
+        c->rd_mode[i] = ( c->watch_page[i] & Z80_WATCH_RD ) ? Z80_MEM_INDIRECT : c->rd_real[i];
+        c->op_mode[i] = ( c->watch_page[i] & Z80_WATCH_OP ) ? Z80_MEM_INDIRECT : c->op_real[i];
+    }
+
+    z80_flush(z);
+
+    return snap->error;
+    #endif
+
+    #ifdef Z80_ASM_CORE
+    return 1;
+
+    what = NULL;
+    snap = NULL;
+    #endif
+}
+
+/*
+   Watchpoints (see z80cpu.h).
+*/
+
+int z80cpu_watch_add(module_data *what, UINT_16 start, UINT_16 end, UINT_8 kinds)
+{
+    return z80_watch_add(Z80CPU_SCRATCHPAD(what),start,end,kinds);
+}
+
+void z80cpu_watch_clear(module_data *what)
+{
+    z80_watch_clear(Z80CPU_SCRATCHPAD(what));
+
+    return;
+}
+
+UINT_32 z80cpu_watch_hits(module_data *what, UINT_8 *kind, UINT_16 *addr, UINT_8 *data, UINT_16 *pc)
+{
+    #ifndef Z80_ASM_CORE
+    z80_core *c = &(Z80CPU_BLOCK(what)->core);
+    UINT_32 hits = c->watch_hits;
+
+    if ( hits )
+    {
+        *kind = c->watch_kind;
+        *addr = c->watch_addr;
+        *data = c->watch_data;
+        *pc   = c->watch_pc;
+
+        c->watch_hits = 0;
+    }
+
+    return hits;
+    #endif
+
+    #ifdef Z80_ASM_CORE
+    return 0;
+
+    what = NULL;
+    kind = NULL;
+    addr = NULL;
+    data = NULL;
+    pc = NULL;
+    #endif
+}
+
 
 void z80cpu_set_reset(void *what)
 {
@@ -551,6 +1156,13 @@ void z80cpu_res_INT(void *what)
     return;
 }
 
+void z80cpu_end_run(void *what)
+{
+    Z80CPU_END_RUN(what) = 1;
+
+    return;
+}
+
 void z80cpu_set_wait(void *what)
 {
     Z80CPU_WAIT_LOCAL(what) = Z80CPU_WAIT_BUS(what);
@@ -560,6 +1172,165 @@ void z80cpu_set_wait(void *what)
     return;
 }
 
+/*
+   z80cpu.asm has no pre-decoded instruction cache, so turning it on or off
+   does nothing.
+*/
+
+#ifdef Z80_ASM_CORE
+
+void z80_set_dcache_on(void *z80block)
+{
+    return;
+
+    z80block = NULL;
+}
+
+void z80_set_dcache_off(void *z80block)
+{
+    return;
+
+    z80block = NULL;
+}
+
+#endif
+
+/*
+   Nor can it skip idle time.
+*/
+
+#ifdef Z80_ASM_CORE
+
+void z80_set_skip_none(void *z80block)
+{
+    return;
+
+    z80block = NULL;
+}
+
+void z80_set_skip_halt(void *z80block)
+{
+    return;
+
+    z80block = NULL;
+}
+
+void z80_set_skip_idle(void *z80block)
+{
+    return;
+
+    z80block = NULL;
+}
+
+/*
+   z80cpu.asm always works out the flags as it goes.
+*/
+
+void z80_sync_flags(void *z80block)
+{
+    return;
+
+    z80block = NULL;
+}
+
+/*
+   Nor does it keep anything it would have to throw away.
+*/
+
+void z80_flush(void *z80block)
+{
+    return;
+
+    z80block = NULL;
+}
+
+/*
+   Between runs z80cpu.asm keeps PC in the top half of its saved copy of
+   ebx (red_local_ebx, 0x078 from the start of the scratchpad).
+*/
+
+UINT_16 z80_get_pc(void *z80block)
+{
+    return *((UINT_16 *) ( ((UINT_8 *) z80block) + 0x0007a ));
+}
+
+/*
+   Nor can it keep a trace.
+*/
+
+void z80_set_trace(void *z80block, UINT_32 depth)
+{
+    return;
+
+    z80block = NULL;
+    depth = 0;
+}
+
+/*
+   Nor can it watch memory.
+*/
+
+int z80_watch_add(void *z80block, UINT_16 start, UINT_16 end, UINT_8 kinds)
+{
+    return 1;
+
+    z80block = NULL;
+    start = 0;
+    end = 0;
+    kinds = 0;
+}
+
+void z80_watch_clear(void *z80block)
+{
+    return;
+
+    z80block = NULL;
+}
+
+#endif
+
+void z80cpu_set_dcache_on(void *what)
+{
+    z80_set_dcache_on(Z80CPU_SCRATCHPAD(what));
+
+    return;
+}
+
+void z80cpu_set_dcache_off(void *what)
+{
+    z80_set_dcache_off(Z80CPU_SCRATCHPAD(what));
+
+    return;
+}
+
+void z80cpu_set_skip_none(void *what)
+{
+    z80_set_skip_none(Z80CPU_SCRATCHPAD(what));
+
+    return;
+}
+
+void z80cpu_set_skip_halt(void *what)
+{
+    z80_set_skip_halt(Z80CPU_SCRATCHPAD(what));
+
+    return;
+}
+
+void z80cpu_set_skip_idle(void *what)
+{
+    z80_set_skip_idle(Z80CPU_SCRATCHPAD(what));
+
+    return;
+}
+
+void z80cpu_dump_trace(void *what)
+{
+    z80cpu_trace_dump((module_data *) what,Z80CPU_TRACE_FILE);
+
+    return;
+}
+
 void z80cpu_set_mem_write_none(void *what)
 {
     UINT_32 i;
@@ -904,6 +1675,10 @@ void z80cpu_set_mem_opread_indirect_naw(void *what)
 
 void z80_sig_error(void *backref)
 {
+    #ifdef Z80_TRACE
+    z80cpu_trace_dump(Z80CPU_GET_MODULE(backref),Z80CPU_TRACE_FILE);
+    #endif
+
     Z80CPU_SIGERR_OUT(Z80CPU_GET_MODULE(backref));
 
     return;
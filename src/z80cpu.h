@@ -44,6 +44,7 @@ Module details
 16 bit buses: busb0 address bus
               busb1 table bus: write waits inserted for this memory
               busb2 table bus: read waits inserted for this memory
+              busb3 clocks left over when a run is ended early (see infn26)
 32 bit buses: busc0 reti counter bus (incremented when reti opcode executed)
 
 incoming functions: infn0  send reset signal.
@@ -82,6 +83,20 @@ incoming functions: infn0  send reset signal.
                     infn21 op: infn12, but no waits inserted.
                     infn22 op: infn13, but no waits inserted.
                     infn23 op: infn14, but no waits inserted.
+                       === the pre-decoded instruction cache (see    ===
+                       === z80core.c) can be switched at any time,   ===
+                       === without changing the results.             ===
+                    infn24 turn on the pre-decoded instruction cache.
+                    infn25 turn off the pre-decoded instruction cache.
+                    infn26 end the current run early (see below).
+                       === idle time skipping (see z80core.c) can    ===
+                       === also be switched at any time without      ===
+                       === changing the results.                     ===
+                    infn27 don't skip idle time.
+                    infn28 skip time spent in HALT.
+                    infn29 skip time spent in HALT and in idle loops.
+                    infn30 dump the trace to Z80CPU_TRACE_FILE (see
+                           below).
 
 outgoing functions: outfn0  indicates an emulation error.
                     outfn1  acknowledges reset.
@@ -112,10 +127,112 @@ outgoing functions: outfn0  indicates an emulation error.
                             data bus (busa2).  The data bus will be reset
                             before calling this function.
 
-Module is clocked.
+Module is clocked.  Each call to z80cpu_cycle is a "run": the z80 is given
+num_cycles more clock cycles and executes every instruction that starts
+before they are used up.  Any overrun is taken from the next run, so the
+instructions executed depend only on the total number of clock cycles
+given, not on how it is split between calls.
+
+If infn26 is called during a run (usually by some device whose next event
+has just been brought forward by an io write) the run is cut short at the
+end of the current Z80CPU_RUN_SLICE clock slice of the run, and the clock
+cycles not used are put on busb3 (which is zero otherwise).  The caller
+should only clock the rest of the machine by num_cycles less busb3.  As long
+as num_cycles is a multiple of Z80CPU_RUN_SLICE this gives exactly the same
+result as making the same run in Z80CPU_RUN_SLICE clock steps and stopping
+after the step in which infn26 was called.
+
+z80cpu_run_left may be called by a device during a run (from one of the
+outfns above) to find out where in the run the z80 has got to.  It
+returns the number of clock cycles from the start of the
+Z80CPU_RUN_SLICE slice in which the current instruction started to the
+end of the run, so num_cycles less this is the number of clock cycles
+that had passed before that slice began.  When stepping the same run a
+slice at a time, this is how far the rest of the machine would have been
+clocked when the instruction was run.
+
+z80cpu_getinf reports the number of clock cycles skipped in HALT and in
+idle loops (see infn27-29).
+
+z80cpu_get_pc returns the PC of the next instruction.  It should only be
+called between runs.
+
+If compiled with Z80_PROFILE (see z80core.h) z80cpu_getinf also gives a
+summary of the profile: instructions executed, the opcodes that took the
+most clock cycles and memory accesses by method.  z80cpu_profile_csv
+writes the whole profile out as two CSV files: op_file has a line for
+each opcode executed (table, opcode, count, clock cycles) and mem_file a
+line for each page and method used (page, method, writes, reads,
+opreads).  It returns 0 on success, and 1 if either file can't be written
+or the profile isn't compiled in.
+
+If compiled with Z80_TRACE (see z80core.h) z80cpu_set_trace sets the depth
+of the trace ring (in records, 0 turns tracing off, which is how it
+starts) and z80cpu_trace_dump writes the records in the ring to a file,
+oldest first.  It returns 0 on success, and 1 if the file can't be
+written or there is no trace.  The trace is also dumped to
+Z80CPU_TRACE_FILE by infn30 and whenever the core signals an error
+(outfn0).  A dump is a 32 byte header followed by the records, 32 bytes
+each, all little-endian:
+
+header: 0  magic (Z80CPU_TRACE_MAGIC, 8 bytes)
+        8  format version (Z80CPU_TRACE_VERSION, 4 bytes)
+        12 record size (4 bytes)
+        16 number of records in the dump (4 bytes)
+        20 number of records written since the ring was set up (8 bytes)
+        28 unused (4 bytes)
+record: 0  time (T-states since reset, 8 bytes)
+        8  PC, AF, BC, DE, HL, SP, IX, IY (2 bytes each)
+        24 opcode and operand bytes (4 bytes, of which len are used)
+        28 len, kind, R, st1 (1 byte each)
+
+See z80_trace_rec in z80core.h for what the fields mean, and z80trace.c
+for a decoder.
+
+z80cpu_serialise and z80cpu_deserialise save and load the state of the
+cpu in a snapshot section (see "Snapshots" in modules.h): the buses as the
+core last saw them, the clock counter, the registers (F worked out in
+full), st1_ and st2_, what the core was going to do next and the page
+tables.  Page addresses are saved as pointers into snapshot blocks, so the
+memory they point into must have been saved (and be loaded) first.  The
+table buses (busa3-busa5, busb1 and busb2) only mean something during a
+call to one of infn6-23, so they aren't saved, and nor are settings such as
+the decode cache, idle skipping, the trace and watchpoints, which stay as
+they are.  The page tables are saved as set through infn6-23, whatever
+watchpoints there are.  Loading throws away any pre-decoded or translated
+code.  The section version is Z80CPU_SNAP_VERSION.  Both return 0 on
+success.  With Z80_ASM_CORE neither is available and both return 1.
+
+z80cpu_watch_add watches the addresses start to end (inclusive) for any
+of the kinds of access in kinds (Z80CPU_WATCH_WR, Z80CPU_WATCH_RD and
+Z80CPU_WATCH_OP for writes, reads and opcode reads).  It returns 0 on
+success, and 1 if there are already Z80CPU_WATCH_MAX ranges, the range or
+kinds make no sense, or the core is Z80_ASM_CORE.  z80cpu_watch_clear
+removes all of them.  Only the pages with a watchpoint are affected: the
+watched accesses to them are made indirect, and are checked and then
+carried out as the page was set up through infn6-23 (so infn6-23 can still
+be used on watched pages, for example for bank switching).  Nothing else
+runs any slower.  When a watched access happens the run is ended as if
+infn26 had been called.  z80cpu_watch_hits returns the number of watched
+accesses since it was last called and, if there were any, the kind,
+address, data and PC (as it was during the access) of the first of them.
+Both should be called between runs.
 
 */
 
+#define Z80CPU_RUN_SLICE        4
+
+#define Z80CPU_TRACE_FILE       "z80trace.bin"
+#define Z80CPU_TRACE_MAGIC      "Z80TRACE"
+#define Z80CPU_TRACE_VERSION    1
+
+#define Z80CPU_SNAP_VERSION     1
+
+#define Z80CPU_WATCH_WR         0x01
+#define Z80CPU_WATCH_RD         0x02
+#define Z80CPU_WATCH_OP         0x04
+#define Z80CPU_WATCH_MAX        16
+
 
 module_data *z80cpu_alloc(const char *module_name);
 int          z80cpu_init(module_data *what);
@@ -124,5 +241,15 @@ void         z80cpu_stop(module_data *what);
 void         z80cpu_remove(module_data *what);
 void         z80cpu_cycle(module_data *what, UINT_16 num_cycles, UINT_8 clock_div, int lsync_point);
 char        *z80cpu_getinf(module_data *what);
+UINT_16      z80cpu_get_pc(module_data *what);
+UINT_32      z80cpu_run_left(module_data *what);
+int          z80cpu_profile_csv(module_data *what, const char *op_file, const char *mem_file);
+void         z80cpu_set_trace(module_data *what, UINT_32 depth);
+int          z80cpu_trace_dump(module_data *what, const char *filename);
+int          z80cpu_serialise(module_data *what, snap_data *snap);
+int          z80cpu_deserialise(module_data *what, snap_data *snap);
+int          z80cpu_watch_add(module_data *what, UINT_16 start, UINT_16 end, UINT_8 kinds);
+void         z80cpu_watch_clear(module_data *what);
+UINT_32      z80cpu_watch_hits(module_data *what, UINT_8 *kind, UINT_16 *addr, UINT_8 *data, UINT_16 *pc);
 
 #endif
@@ -0,0 +1,1195 @@
+#include "z80core.h"
+#include "z80jit.h"
+#include "u_dtype.h"
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+
+/*
+
+                        Z80 Block Translator (JIT)
+                        ==========================
+
+This translates z80 code running from directly mapped opread pages into
+x86-64 machine code, one basic block at a time, and runs it in place of
+the interpreter in z80core.c.  It is only built if Z80_JIT is defined (see
+z80core.h), and the results (registers, memory, io and clock) are exactly
+the same as those of the interpreter.
+
+Blocks
+======
+
+A block is translated the first time its start address is executed, and
+is cached in a per page table (indexed by the low byte of the address) so
+each 256 byte page holds the translations of the code in it.  A block
+never extends past the end of its page, and stops after a jump, call,
+return, restart, HALT, EI, DI, block repeat or RETI/RETN, or after
+Z80_JIT_MAX_OPS instructions.
+
+Within a block, the simple register only instructions (LD r,r', LD r,n,
+LD rr,nn, INC/DEC r and rr, EX DE,HL, the ALU ops on registers and
+immediates, JR, JR cc, DJNZ, JP nn and JP cc,nn) are translated into host
+code that works on the register file in the z80_block.  The x86 flags are
+laid out like the z80 flags (S, Z, H, P and C are in the same bits), so
+the flags come straight out of lahf.  Everything else is translated into
+a call to z80_jit_step, which runs that instruction through the
+interpreter.  Blocks that would contain only such calls are not worth
+translating, and are left to the interpreter.
+
+Opcode fetch timing and the operand read timing for the page are worked
+out when the block is translated, so translated instructions just add a
+constant to the clock.  Operands are only read directly from the page if
+the page is also set up for direct reads; otherwise the instruction goes
+through the interpreter.
+
+Timing and signals
+==================
+
+z80_cycle calls z80_jit_run instead of running a single instruction.  This
+runs translated blocks for as long as z80cpu_cycle would keep calling
+z80_cycle (that is, until the clock reaches the limit given by clk_count)
+and nothing happens that would make the next step anything other than an
+ordinary instruction.  The clock is checked before every instruction, and
+the state (pending signals, HALT, EI/DI, pending prefix) after every
+instruction that goes through the interpreter, as only those can change
+it.  The result is that exactly the same instructions are run between
+calls to z80cpu_cycle as with the interpreter, so the clock on the clock
+bus is exact.  Indirect opread pages, IM0 interupts and the other signal
+handling are always done by the interpreter.
+
+Invalidation
+============
+
+Each page that holds translated code has its jit_code flag set in the
+z80_core, and the bytes covered by translated instructions are marked in
+a bitmap.  A write (direct or indirect) to a marked byte throws away all
+translations for that page, as does changing the page's access method or
+waits via the z80_set_mem_* functions.  Code space is only reclaimed when
+the buffer fills up, at which point everything is thrown away and
+translation starts again.  Memory that is mapped at two different pages
+is not tracked (a write through one page won't invalidate code in the
+other).
+
+*/
+
+#ifdef Z80_JIT
+
+#include <sys/mman.h>
+
+
+#define Z80_JIT_CODE_SIZE       0x0400000
+#define Z80_JIT_BLOCK_SPACE     0x04000
+#define Z80_JIT_MAX_OPS         64
+#define Z80_JIT_MAX_FIXUPS      ( ( 2 * Z80_JIT_MAX_OPS ) + 4 )
+
+/*
+   Translated code is called as fn(z,limit).
+*/
+
+typedef void (*z80_jit_fn)(z80_block *z, UINT_32 limit);
+
+/*
+   Translator state.  entry holds the block for each address (NULL if not
+   yet translated, Z80_JIT_NONE if left to the interpreter), and covered
+   marks the bytes of each page that have been translated.  fixup lists
+   the jumps to the exit of the block being translated.
+*/
+
+typedef struct
+{
+    UINT_8  *code;
+    UINT_32  code_used;
+    UINT_8  *entry[256][256];
+    UINT_8   covered[256][32];
+    UINT_8   page_used[256];
+
+    UINT_8  *p;
+    UINT_8  *body;
+    UINT_8  *fixup[Z80_JIT_MAX_FIXUPS];
+    int      num_fixups;
+}
+z80_jit_state;
+
+static const UINT_8 z80_jit_none = 0;
+
+#define Z80_JIT_NONE            ((UINT_8 *) &z80_jit_none)
+
+/*
+   Offsets into the z80_block.
+*/
+
+#define OFS(field)              ( (UINT_32) offsetof(z80_block,field) )
+
+#define OFS_CLK                 OFS(clk)
+#define OFS_PC                  OFS(core.pc.w)
+#define OFS_WZ                  OFS(core.wz.w)
+#define OFS_DE                  OFS(core.de.w)
+#define OFS_HL                  OFS(core.hl.w)
+#define OFS_A                   OFS(core.af.b.h)
+#define OFS_F                   OFS(core.af.b.l)
+#define OFS_B                   OFS(core.bc.b.h)
+#define OFS_R                   OFS(core.r)
+
+#define CLK_IS_64               ( sizeof(((z80_block *) 0)->clk) == 8 )
+
+/*
+   Host registers (8-bit names, and their 32/64-bit equivalents).
+*/
+
+#define HOST_AL                 0
+#define HOST_CL                 1
+#define HOST_DL                 2
+#define HOST_AH                 4
+
+static const UINT_32 z80_jit_reg8[8] =
+{
+    OFS(core.bc.b.h), OFS(core.bc.b.l), OFS(core.de.b.h), OFS(core.de.b.l),
+    OFS(core.hl.b.h), OFS(core.hl.b.l), 0,                OFS(core.af.b.h)
+};
+
+static const UINT_32 z80_jit_reg16[4] =
+{
+    OFS(core.bc.w), OFS(core.de.w), OFS(core.hl.w), OFS(core.sp.w)
+};
+
+
+/***********************************************************************/
+/***********************************************************************/
+/***********************************************************************/
+
+/*
+   Code emission.  All z80 state is addressed as [rbx+disp32], rbx being
+   the z80_block.  rax, rcx and rdx are scratch, r12 holds the clock
+   limit.
+*/
+
+static void jit_byte(z80_jit_state *j, UINT_8 b)
+{
+    *(j->p)++ = b;
+
+    return;
+}
+
+static void jit_word(z80_jit_state *j, UINT_16 w)
+{
+    jit_byte(j,(UINT_8) w);
+    jit_byte(j,(UINT_8) ( w >> 8 ));
+
+    return;
+}
+
+static void jit_dword(z80_jit_state *j, UINT_32 d)
+{
+    jit_word(j,(UINT_16) d);
+    jit_word(j,(UINT_16) ( d >> 16 ));
+
+    return;
+}
+
+static void jit_bytes(z80_jit_state *j, const char *what, int n)
+{
+    while ( n-- )
+    {
+        jit_byte(j,(UINT_8) *what++);
+    }
+
+    return;
+}
+
+/*
+   modrm byte and displacement for [rbx+ofs], with reg (or the opcode
+   extension) in the reg field.
+*/
+
+static void jit_mem(z80_jit_state *j, UINT_8 reg, UINT_32 ofs)
+{
+    jit_byte(j,(UINT_8) ( 0x083 | ( reg << 3 ) ));
+    jit_dword(j,ofs);
+
+    return;
+}
+
+static void jit_ld8(z80_jit_state *j, UINT_8 reg, UINT_32 ofs)
+{
+    jit_byte(j,0x08a);
+    jit_mem(j,reg,ofs);
+
+    return;
+}
+
+static void jit_st8(z80_jit_state *j, UINT_8 reg, UINT_32 ofs)
+{
+    jit_byte(j,0x088);
+    jit_mem(j,reg,ofs);
+
+    return;
+}
+
+static void jit_set8(z80_jit_state *j, UINT_32 ofs, UINT_8 val)
+{
+    jit_byte(j,0x0c6);
+    jit_mem(j,0,ofs);
+    jit_byte(j,val);
+
+    return;
+}
+
+static void jit_set16(z80_jit_state *j, UINT_32 ofs, UINT_16 val)
+{
+    jit_byte(j,0x066);
+    jit_byte(j,0x0c7);
+    jit_mem(j,0,ofs);
+    jit_word(j,val);
+
+    return;
+}
+
+static void jit_add_clk(z80_jit_state *j, UINT_32 n)
+{
+    if ( n )
+    {
+        if ( CLK_IS_64 )
+        {
+            jit_byte(j,0x048);
+        }
+
+        jit_byte(j,0x081);
+        jit_mem(j,0,OFS_CLK);
+        jit_dword(j,n);
+    }
+
+    return;
+}
+
+/*
+   Jumps.  jit_jump emits a jump (jmp if cc is zero, otherwise the 0x0f
+   prefixed jcc) and returns the address of the displacement, for
+   jit_patch.  jit_exit records a jump to the block exit.
+*/
+
+static UINT_8 *jit_jump(z80_jit_state *j, UINT_8 cc)
+{
+    if ( cc )
+    {
+        jit_byte(j,0x00f);
+        jit_byte(j,cc);
+    }
+
+    else
+    {
+        jit_byte(j,0x0e9);
+    }
+
+    jit_dword(j,0);
+
+    return j->p - 4;
+}
+
+static void jit_patch(UINT_8 *disp, UINT_8 *target)
+{
+    UINT_32 rel = (UINT_32) ( target - ( disp + 4 ) );
+
+    disp[0] = (UINT_8) rel;
+    disp[1] = (UINT_8) ( rel >> 8 );
+    disp[2] = (UINT_8) ( rel >> 16 );
+    disp[3] = (UINT_8) ( rel >> 24 );
+
+    return;
+}
+
+#define JCC_JZ                  0x084
+#define JCC_JNZ                 0x085
+#define JCC_JAE                 0x083
+
+static void jit_exit(z80_jit_state *j, UINT_8 cc)
+{
+    j->fixup[j->num_fixups++] = jit_jump(j,cc);
+
+    return;
+}
+
+/*
+   Exit if the clock has reached the limit.
+*/
+
+static void jit_budget(z80_jit_state *j)
+{
+    if ( CLK_IS_64 )
+    {
+        jit_bytes(j,"\x48\x8b",2);                      /* mov rax,[clk]  */
+        jit_mem(j,0,OFS_CLK);
+        jit_bytes(j,"\x4c\x39\xe0",3);                  /* cmp rax,r12    */
+    }
+
+    else
+    {
+        jit_byte(j,0x08b);                              /* mov eax,[clk]  */
+        jit_mem(j,0,OFS_CLK);
+        jit_bytes(j,"\x44\x39\xe0",3);                  /* cmp eax,r12d   */
+    }
+
+    jit_exit(j,JCC_JAE);
+
+    return;
+}
+
+/*
+   Opcode fetch: increment the low 7 bits of R.
+*/
+
+static void jit_inc_r(z80_jit_state *j)
+{
+    jit_ld8(j,HOST_AL,OFS_R);
+    jit_bytes(j,"\x88\xc1\xfe\xc0\x24\x7f\x80\xe1\x80\x08\xc8",11);
+    jit_st8(j,HOST_AL,OFS_R);
+
+    return;
+}
+
+/*
+   Run one instruction through the interpreter.  Returns with eax non-zero
+   if the block must stop.
+*/
+
+static void jit_call_step(z80_jit_state *j)
+{
+    UINT_64 fn = (UINT_64) (size_t) z80_jit_step;
+
+    jit_bytes(j,"\x48\x89\xdf\x48\xb8",5);              /* mov rdi,rbx; mov rax,fn */
+    jit_dword(j,(UINT_32) fn);
+    jit_dword(j,(UINT_32) ( fn >> 32 ));
+    jit_bytes(j,"\xff\xd0",2);                          /* call rax       */
+
+    return;
+}
+
+/*
+   Pack the flags in ah (after lahf) into the z80 F register.  keep is the
+   set of x86 flags to keep, over is set if P/V is overflow (from OF), and
+   src53 is the host register that supplies flags 5 and 3 (al for the
+   result, cl for the operand).  If keep_c is set the z80 carry is kept
+   (INC/DEC), and cl is used for it.
+*/
+
+static void jit_flags(z80_jit_state *j, UINT_8 keep, int over, UINT_8 src53, UINT_8 set, int keep_c)
+{
+    if ( over )
+    {
+        jit_bytes(j,"\x0f\x90\xc2",3);                  /* seto dl        */
+    }
+
+    jit_bytes(j,"\x80\xe4",2);                          /* and ah,keep    */
+    jit_byte(j,keep);
+
+    if ( over )
+    {
+        jit_bytes(j,"\xc0\xe2\x02\x08\xd4",5);          /* shl dl,2; or ah,dl */
+    }
+
+    jit_byte(j,0x088);                                  /* mov dl,src53   */
+    jit_byte(j,(UINT_8) ( 0x0c2 | ( src53 << 3 ) ));
+    jit_bytes(j,"\x80\xe2\x28\x08\xd4",5);              /* and dl,28h; or ah,dl */
+
+    if ( set )
+    {
+        jit_bytes(j,"\x80\xcc",2);                      /* or ah,set      */
+        jit_byte(j,set);
+    }
+
+    if ( keep_c )
+    {
+        jit_ld8(j,HOST_CL,OFS_F);
+        jit_bytes(j,"\x80\xe1\x01\x08\xcc",5);      /* and cl,1; or ah,cl */
+    }
+
+    jit_st8(j,HOST_AH,OFS_F);
+
+    return;
+}
+
+/*
+   ALU op what (ADD, ADC, SUB, SBC, AND, XOR, OR, CP) on A, with either
+   the register at src or the immediate val.
+*/
+
+static void jit_alu(z80_jit_state *j, UINT_8 what, int imm, UINT_32 src, UINT_8 val)
+{
+    static const UINT_8 op_reg[8] = { 0x000, 0x010, 0x028, 0x018, 0x020, 0x030, 0x008, 0x038 };
+    static const UINT_8 op_imm[8] = { 0x004, 0x014, 0x02c, 0x01c, 0x024, 0x034, 0x00c, 0x03c };
+
+    what &= 7;
+
+    /*
+       Operand in cl (needed for CP flags 5 and 3 too), A in al and the
+       z80 carry in CF for ADC/SBC.
+    */
+
+    if ( imm )
+    {
+        jit_byte(j,0x0b1);                              /* mov cl,val     */
+        jit_byte(j,val);
+    }
+
+    else
+    {
+        jit_ld8(j,HOST_CL,src);
+    }
+
+    jit_ld8(j,HOST_AL,OFS_A);
+
+    if ( ( what == 1 ) || ( what == 3 ) )
+    {
+        jit_ld8(j,HOST_DL,OFS_F);
+        jit_bytes(j,"\xd0\xea",2);                      /* shr dl,1       */
+    }
+
+    if ( imm )
+    {
+        jit_byte(j,op_imm[what]);
+        jit_byte(j,val);
+    }
+
+    else
+    {
+        jit_byte(j,op_reg[what]);
+        jit_byte(j,0x0c8);
+    }
+
+    jit_byte(j,0x09f);                                  /* lahf           */
+
+    switch ( what )
+    {
+        case 0:
+        case 1:  jit_flags(j,0x0d1,1,HOST_AL,0,0);                  break;
+        case 2:
+        case 3:  jit_flags(j,0x0d1,1,HOST_AL,Z80_FLAG_N,0);         break;
+        case 4:  jit_flags(j,0x0c4,0,HOST_AL,Z80_FLAG_H,0);         break;
+        case 5:
+        case 6:  jit_flags(j,0x0c4,0,HOST_AL,0,0);                  break;
+        default: jit_flags(j,0x0d1,1,HOST_CL,Z80_FLAG_N,0);         break;
+    }
+
+    if ( what != 7 )
+    {
+        jit_st8(j,HOST_AL,OFS_A);
+    }
+
+    return;
+}
+
+/*
+   INC r/DEC r (carry is kept).
+*/
+
+static void jit_incdec(z80_jit_state *j, UINT_32 reg, int dec)
+{
+    jit_ld8(j,HOST_AL,reg);
+    jit_byte(j,0x0fe);                                  /* inc al/dec al  */
+    jit_byte(j,(UINT_8) ( dec ? 0x0c8 : 0x0c0 ));
+    jit_byte(j,0x09f);                                  /* lahf           */
+    jit_flags(j,0x0d0,1,HOST_AL,(UINT_8) ( dec ? Z80_FLAG_N : 0 ),1);
+    jit_st8(j,HOST_AL,reg);
+
+    return;
+}
+
+/*
+   Conditional jump to not taken code for condition cc (as in the opcode).
+   Returns the displacement to patch.
+*/
+
+static UINT_8 *jit_cond(z80_jit_state *j, UINT_8 cc)
+{
+    static const UINT_8 mask[4] = { Z80_FLAG_Z, Z80_FLAG_C, Z80_FLAG_PV, Z80_FLAG_S };
+
+    jit_byte(j,0x0f6);                                  /* test [F],mask  */
+    jit_mem(j,0,OFS_F);
+    jit_byte(j,mask[( cc >> 1 ) & 3]);
+
+    return jit_jump(j,(UINT_8) ( ( cc & 1 ) ? JCC_JZ : JCC_JNZ ));
+}
+
+/*
+   Branch taken: set PC (and WZ), then either loop back to the start of
+   the block (if that is the target) or exit.
+*/
+
+static void jit_taken(z80_jit_state *j, UINT_16 target, UINT_16 start, UINT_32 extra, int wz)
+{
+    jit_add_clk(j,extra);
+    jit_set16(j,OFS_PC,target);
+
+    if ( wz )
+    {
+        jit_set16(j,OFS_WZ,target);
+    }
+
+    if ( target == start )
+    {
+        jit_budget(j);
+        jit_patch(jit_jump(j,0),j->body);
+    }
+
+    else
+    {
+        jit_exit(j,0);
+    }
+
+    return;
+}
+
+
+/***********************************************************************/
+/***********************************************************************/
+/***********************************************************************/
+
+/*
+   Instruction decoding.  Only the opcode bytes are looked at, as these
+   decide the length.
+*/
+
+static int z80_jit_main_len(UINT_8 op)
+{
+    if ( ( ( op & 0x0c7 ) == 0x006 ) || ( ( op & 0x0c7 ) == 0x0c6 ) ) { return 2; }
+    if ( ( ( op & 0x0e7 ) == 0x020 ) || ( op == 0x010 ) || ( op == 0x018 ) ) { return 2; }
+    if ( ( op == 0x0d3 ) || ( op == 0x0db ) || ( op == 0x0cb ) ) { return 2; }
+    if ( ( ( op & 0x0cf ) == 0x001 ) || ( ( op & 0x0e7 ) == 0x022 ) ) { return 3; }
+    if ( ( ( op & 0x0c7 ) == 0x0c2 ) || ( ( op & 0x0c7 ) == 0x0c4 ) ) { return 3; }
+    if ( ( op == 0x0c3 ) || ( op == 0x0cd ) ) { return 3; }
+
+    return 1;
+}
+
+/*
+   Does the (interpreted) instruction end a block?
+*/
+
+static int z80_jit_main_ends(UINT_8 op)
+{
+    switch ( op )
+    {
+        case 0x010: /* DJNZ     */
+        case 0x018: /* JR       */
+        case 0x076: /* HALT     */
+        case 0x0c3: /* JP       */
+        case 0x0c9: /* RET      */
+        case 0x0cd: /* CALL     */
+        case 0x0e9: /* JP (HL)  */
+        case 0x0f3: /* DI       */
+        case 0x0fb: /* EI       */
+        {
+            return 1;
+        }
+
+        default:
+        {
+            break;
+        }
+    }
+
+    return ( ( op & 0x0e7 ) == 0x020 ) || ( ( op & 0x0c0 ) == 0x0c0 && ( ( op & 0x007 ) == 0x000 || ( op & 0x007 ) == 0x002 || ( op & 0x007 ) == 0x004 || ( op & 0x007 ) == 0x007 ) );
+}
+
+/*
+   Decode the instruction at m (avail bytes left in the page).  Returns the
+   length and sets ends if the instruction ends the block.
+*/
+
+static int z80_jit_decode(const UINT_8 *m, int avail, int *ends)
+{
+    UINT_8 op = m[0];
+    UINT_8 op2;
+
+    *ends = 0;
+
+    if ( ( op != 0x0cb ) && ( op != 0x0ed ) && ( op != 0x0dd ) && ( op != 0x0fd ) )
+    {
+        *ends = z80_jit_main_ends(op);
+
+        return z80_jit_main_len(op);
+    }
+
+    if ( avail < 2 )
+    {
+        *ends = 1;
+
+        return 1;
+    }
+
+    op2 = m[1];
+
+    if ( op == 0x0cb )
+    {
+        return 2;
+    }
+
+    if ( op == 0x0ed )
+    {
+        *ends = ( ( op2 & 0x0c7 ) == 0x045 ) || ( ( op2 & 0x0f4 ) == 0x0b0 );
+
+        return ( ( op2 & 0x0c7 ) == 0x043 ) ? 4 : 2;
+    }
+
+    if ( ( op2 == 0x0dd ) || ( op2 == 0x0fd ) || ( op2 == 0x0ed ) )
+    {
+        *ends = 1;
+
+        return 2;
+    }
+
+    if ( op2 == 0x0cb )
+    {
+        return 4;
+    }
+
+    *ends = z80_jit_main_ends(op2);
+
+    if ( ( op2 == 0x034 ) || ( op2 == 0x035 ) || ( op2 == 0x036 ) ||
+         ( ( op2 >= 0x040 ) && ( op2 < 0x0c0 ) && ( op2 != 0x076 ) && ( ( ( op2 & 7 ) == 6 ) || ( ( op2 & 0x0f8 ) == 0x070 ) ) ) )
+    {
+        return 2 + z80_jit_main_len(op2);
+    }
+
+    return 1 + z80_jit_main_len(op2);
+}
+
+
+/***********************************************************************/
+/***********************************************************************/
+/***********************************************************************/
+
+/*
+   Translate the instruction at m (address addr) into host code, if it is
+   one of the ones handled.  fetch is the opfetch time and arg the operand
+   read time (zero if operands can't be read directly).  Returns 0 if not
+   handled, 1 if translated and 2 if translated and the block ends here.
+*/
+
+static int z80_jit_native(z80_jit_state *j, const UINT_8 *m, UINT_16 addr, UINT_16 start, int len, UINT_32 fetch, UINT_32 arg)
+{
+    UINT_8 op  = m[0];
+    UINT_8 dst = (UINT_8) ( ( op >> 3 ) & 7 );
+    UINT_8 src = (UINT_8) ( op & 7 );
+    UINT_16 next = (UINT_16) ( addr + len );
+    UINT_16 target;
+    UINT_8 *not_taken;
+
+    /*
+       Instructions without operands.
+    */
+
+    if ( ( op >= 0x040 ) && ( op < 0x080 ) && ( src != 6 ) && ( dst != 6 ) )
+    {
+        jit_inc_r(j);
+        jit_add_clk(j,fetch);
+
+        if ( src != dst )
+        {
+            jit_ld8(j,HOST_AL,z80_jit_reg8[src]);
+            jit_st8(j,HOST_AL,z80_jit_reg8[dst]);
+        }
+
+        jit_set16(j,OFS_PC,next);
+
+        return 1;
+    }
+
+    if ( ( op >= 0x080 ) && ( op < 0x0c0 ) && ( src != 6 ) )
+    {
+        jit_inc_r(j);
+        jit_add_clk(j,fetch);
+        jit_alu(j,dst,0,z80_jit_reg8[src],0);
+        jit_set16(j,OFS_PC,next);
+
+        return 1;
+    }
+
+    if ( ( ( op & 0x0c6 ) == 0x004 ) && ( dst != 6 ) )
+    {
+        jit_inc_r(j);
+        jit_add_clk(j,fetch);
+        jit_incdec(j,z80_jit_reg8[dst],op & 1);
+        jit_set16(j,OFS_PC,next);
+
+        return 1;
+    }
+
+    if ( ( ( op & 0x0c7 ) == 0x003 ) )
+    {
+        jit_inc_r(j);
+        jit_add_clk(j,fetch + 2);
+        jit_byte(j,0x066);                              /* inc/dec word   */
+        jit_byte(j,0x0ff);
+        jit_mem(j,(UINT_8) ( ( op & 0x008 ) ? 1 : 0 ),z80_jit_reg16[( op >> 4 ) & 3]);
+        jit_set16(j,OFS_PC,next);
+
+        return 1;
+    }
+
+    if ( ( op == 0x000 ) || ( op == 0x0eb ) )
+    {
+        jit_inc_r(j);
+        jit_add_clk(j,fetch);
+
+        if ( op == 0x0eb )
+        {
+            jit_bytes(j,"\x66\x8b",2);                  /* mov ax,[DE]    */
+            jit_mem(j,0,OFS_DE);
+            jit_bytes(j,"\x66\x8b",2);                  /* mov cx,[HL]    */
+            jit_mem(j,1,OFS_HL);
+            jit_bytes(j,"\x66\x89",2);                  /* mov [DE],cx    */
+            jit_mem(j,1,OFS_DE);
+            jit_bytes(j,"\x66\x89",2);                  /* mov [HL],ax    */
+            jit_mem(j,0,OFS_HL);
+        }
+
+        jit_set16(j,OFS_PC,next);
+
+        return 1;
+    }
+
+    /*
+       The rest have operands, which must be readable directly.
+    */
+
+    if ( !arg )
+    {
+        return 0;
+    }
+
+    if ( ( ( op & 0x0c7 ) == 0x006 ) && ( dst != 6 ) )
+    {
+        jit_inc_r(j);
+        jit_add_clk(j,fetch + arg);
+        jit_set8(j,z80_jit_reg8[dst],m[1]);
+        jit_set16(j,OFS_PC,next);
+
+        return 1;
+    }
+
+    if ( ( op & 0x0cf ) == 0x001 )
+    {
+        jit_inc_r(j);
+        jit_add_clk(j,fetch + ( 2 * arg ));
+        jit_set16(j,z80_jit_reg16[( op >> 4 ) & 3],(UINT_16) ( m[1] | ( m[2] << 8 ) ));
+        jit_set16(j,OFS_PC,next);
+
+        return 1;
+    }
+
+    if ( ( op & 0x0c7 ) == 0x0c6 )
+    {
+        jit_inc_r(j);
+        jit_add_clk(j,fetch + arg);
+        jit_alu(j,dst,1,0,m[1]);
+        jit_set16(j,OFS_PC,next);
+
+        return 1;
+    }
+
+    /*
+       Relative jumps and DJNZ.  Not taken carries on with the block.
+    */
+
+    target = (UINT_16) ( next + (SINT_8) m[1] );
+
+    if ( op == 0x018 )
+    {
+        jit_inc_r(j);
+        jit_add_clk(j,fetch + arg);
+        jit_taken(j,target,start,5,1);
+
+        return 2;
+    }
+
+    if ( ( op == 0x010 ) || ( ( op & 0x0e7 ) == 0x020 ) )
+    {
+        jit_inc_r(j);
+        jit_add_clk(j,fetch + arg + ( ( op == 0x010 ) ? 1 : 0 ));
+        jit_set16(j,OFS_PC,next);
+
+        if ( op == 0x010 )
+        {
+            jit_byte(j,0x0fe);                          /* dec byte [B]   */
+            jit_mem(j,1,OFS_B);
+            not_taken = jit_jump(j,JCC_JZ);
+        }
+
+        else
+        {
+            not_taken = jit_cond(j,(UINT_8) ( dst & 3 ));
+        }
+
+        jit_taken(j,target,start,5,1);
+        jit_patch(not_taken,j->p);
+
+        return 1;
+    }
+
+    /*
+       Absolute jumps.
+    */
+
+    target = (UINT_16) ( m[1] | ( m[2] << 8 ) );
+
+    if ( op == 0x0c3 )
+    {
+        jit_inc_r(j);
+        jit_add_clk(j,fetch + ( 2 * arg ));
+        jit_taken(j,target,start,0,1);
+
+        return 2;
+    }
+
+    if ( ( op & 0x0c7 ) == 0x0c2 )
+    {
+        jit_inc_r(j);
+        jit_add_clk(j,fetch + ( 2 * arg ));
+        jit_set16(j,OFS_WZ,target);
+        jit_set16(j,OFS_PC,next);
+        not_taken = jit_cond(j,dst);
+        jit_taken(j,target,start,0,0);
+        jit_patch(not_taken,j->p);
+
+        return 1;
+    }
+
+    return 0;
+}
+
+/*
+   Mark bytes as translated.
+*/
+
+static void z80_jit_cover(z80_jit_state *j, UINT_8 page, int off, int len)
+{
+    for ( ; ( len > 0 ) && ( off < 0x0100 ) ; off++, len-- )
+    {
+        j->covered[page][off >> 3] |= (UINT_8) ( 1 << ( off & 7 ) );
+    }
+
+    return;
+}
+
+/*
+   Translate the block starting at PC.  Returns the entry point, or
+   Z80_JIT_NONE if the block is left to the interpreter.
+*/
+
+static UINT_8 *z80_jit_translate(z80_block *z, z80_jit_state *j)
+{
+    z80_core *c = &(z->core);
+    UINT_16 start = c->pc.w;
+    UINT_8 page = (UINT_8) ( start >> 8 );
+    int off = start & 0x0ff;
+    const UINT_8 *m = c->mem_addr[page];
+    UINT_32 fetch = 4 + c->op_wait[page];
+    UINT_32 arg = ( c->rd_mode[page] == Z80_MEM_DIRECT ) ? ( 3 + c->rd_wait[page] ) : 0;
+    UINT_8 *entry;
+    int native = 0;
+    int done = 0;
+    int ends;
+    int len;
+    int n;
+    int i;
+
+    if ( j->code_used + Z80_JIT_BLOCK_SPACE > Z80_JIT_CODE_SIZE )
+    {
+        z80_jit_flush(z);
+    }
+
+    c->jit_code[page]  = 1;
+    j->page_used[page] = 1;
+
+    entry = j->p = j->code + j->code_used;
+    j->num_fixups = 0;
+
+    jit_bytes(j,"\x53\x41\x54\x48\x83\xec\x08\x48\x89\xfb",10);   /* push rbx; push r12; sub rsp,8; mov rbx,rdi */
+
+    if ( CLK_IS_64 )
+    {
+        jit_bytes(j,"\x49\x89\xf4",3);                  /* mov r12,rsi    */
+    }
+
+    else
+    {
+        jit_bytes(j,"\x41\x89\xf4",3);                  /* mov r12d,esi   */
+    }
+
+    j->body = j->p;
+
+    for ( n = 0 ; ( n < Z80_JIT_MAX_OPS ) && !done ; n++ )
+    {
+        len = z80_jit_decode(m + off,0x0100 - off,&ends);
+
+        if ( off + len > 0x0100 )
+        {
+            ends = 1;
+        }
+
+        z80_jit_cover(j,page,off,len);
+
+        if ( n )
+        {
+            jit_budget(j);
+        }
+
+        switch ( ( off + len > 0x0100 ) ? 0 : z80_jit_native(j,m + off,(UINT_16) ( ( page << 8 ) | off ),start,len,fetch,arg) )
+        {
+            case 0:
+            {
+                jit_call_step(j);
+
+                if ( ends )
+                {
+                    jit_exit(j,0);
+                    done = 1;
+                }
+
+                else
+                {
+                    jit_bytes(j,"\x85\xc0",2);          /* test eax,eax   */
+                    jit_exit(j,JCC_JNZ);
+                }
+
+                break;
+            }
+
+            case 1:
+            {
+                native++;
+
+                break;
+            }
+
+            default:
+            {
+                native++;
+                done = 1;
+
+                break;
+            }
+        }
+
+        off += len;
+
+        if ( off >= 0x0100 )
+        {
+            break;
+        }
+    }
+
+    if ( !native )
+    {
+        j->entry[page][start & 0x0ff] = Z80_JIT_NONE;
+
+        return Z80_JIT_NONE;
+    }
+
+    if ( !done )
+    {
+        jit_exit(j,0);
+    }
+
+    for ( i = 0 ; i < j->num_fixups ; i++ )
+    {
+        jit_patch(j->fixup[i],j->p);
+    }
+
+    jit_bytes(j,"\x48\x83\xc4\x08\x41\x5c\x5b\xc3",8);  /* add rsp,8; pop r12; pop rbx; ret */
+
+    j->code_used += (UINT_32) ( j->p - entry );
+    j->entry[page][start & 0x0ff] = entry;
+
+    return entry;
+}
+
+
+/***********************************************************************/
+/***********************************************************************/
+/***********************************************************************/
+
+/*
+   Set up the translator (on first use).
+*/
+
+static z80_jit_state *z80_jit_alloc(z80_block *z)
+{
+    z80_core *c = &(z->core);
+    z80_jit_state *j;
+    void *code;
+
+    if ( c->jit_failed )
+    {
+        return NULL;
+    }
+
+    c->jit_failed = 1;
+
+    if ( ( j = (z80_jit_state *) malloc(sizeof(z80_jit_state)) ) == NULL )
+    {
+        return NULL;
+    }
+
+    code = mmap(NULL,Z80_JIT_CODE_SIZE,PROT_READ | PROT_WRITE | PROT_EXEC,MAP_PRIVATE | MAP_ANONYMOUS,-1,0);
+
+    if ( code == MAP_FAILED )
+    {
+        free(j);
+
+        return NULL;
+    }
+
+    memset(j,0,sizeof(z80_jit_state));
+
+    j->code = (UINT_8 *) code;
+    c->jit  = (void *) j;
+    c->jit_failed = 0;
+
+    return j;
+}
+
+/*
+   Run translated code for as long as z80cpu_cycle would keep running the
+   core (see above).  Returns 0 if nothing was run (the caller must then
+   run the instruction itself).
+*/
+
+int z80_jit_run(z80_block *z)
+{
+    z80_core *c = &(z->core);
+    z80_jit_state *j;
+    UINT_8 *entry;
+    UINT_32 limit;
+    UINT_16 pc;
+    int ran = 0;
+
+    if ( ( ( j = (z80_jit_state *) c->jit ) == NULL ) && ( ( j = z80_jit_alloc(z) ) == NULL ) )
+    {
+        return 0;
+    }
+
+    c->jit_dirty = 0;
+
+    if ( z80_jit_stop(z) )
+    {
+        return 0;
+    }
+
+    limit = ( z->clk_count > Z80_CLK_COUNT_BASE ) ? ( z->clk_count - Z80_CLK_COUNT_BASE ) : 0;
+
+    while ( 1 )
+    {
+        pc = c->pc.w;
+
+        if ( c->op_mode[pc >> 8] != Z80_MEM_DIRECT )
+        {
+            break;
+        }
+
+        if ( ( entry = j->entry[pc >> 8][pc & 0x0ff] ) == NULL )
+        {
+            entry = z80_jit_translate(z,j);
+        }
+
+        if ( entry == Z80_JIT_NONE )
+        {
+            break;
+        }
+
+        ((z80_jit_fn) entry)(z,limit);
+
+        ran = 1;
+
+        if ( ( z->clk >= limit ) || z80_jit_stop(z) )
+        {
+            break;
+        }
+    }
+
+    return ran;
+}
+
+/*
+   Write to a page holding translated code (called by the core before the
+   write).
+*/
+
+void z80_jit_write(z80_block *z, UINT_16 addr)
+{
+    z80_jit_state *j = (z80_jit_state *) z->core.jit;
+    UINT_8 page = (UINT_8) ( addr >> 8 );
+
+    if ( ( j != NULL ) && ( j->covered[page][( addr & 0x0ff ) >> 3] & ( 1 << ( addr & 7 ) ) ) )
+    {
+        z80_jit_invalidate(z,page);
+    }
+
+    return;
+}
+
+/*
+   Throw away translations for one page, or for all pages.
+*/
+
+void z80_jit_invalidate(z80_block *z, UINT_8 page)
+{
+    z80_core *c = &(z->core);
+    z80_jit_state *j = (z80_jit_state *) c->jit;
+
+    c->jit_code[page] = 0;
+    c->jit_dirty = 1;
+
+    if ( j != NULL )
+    {
+        memset(j->entry[page],0,sizeof(j->entry[page]));
+        memset(j->covered[page],0,sizeof(j->covered[page]));
+        j->page_used[page] = 0;
+    }
+
+    return;
+}
+
+void z80_jit_flush(z80_block *z)
+{
+    z80_core *c = &(z->core);
+    z80_jit_state *j = (z80_jit_state *) c->jit;
+    int i;
+
+    if ( j != NULL )
+    {
+        for ( i = 0 ; i < 256 ; i++ )
+        {
+            if ( j->page_used[i] )
+            {
+                memset(j->entry[i],0,sizeof(j->entry[i]));
+                memset(j->covered[i],0,sizeof(j->covered[i]));
+                j->page_used[i] = 0;
+            }
+
+            c->jit_code[i] = 0;
+        }
+
+        j->code_used = 0;
+    }
+
+    return;
+}
+
+void z80_jit_free(z80_block *z)
+{
+    z80_core *c = &(z->core);
+    z80_jit_state *j = (z80_jit_state *) c->jit;
+
+    if ( j != NULL )
+    {
+        munmap(j->code,Z80_JIT_CODE_SIZE);
+        free(j);
+
+        c->jit = NULL;
+    }
+
+    return;
+}
+
+#endif
@@ -0,0 +1,35 @@
+#include "u_dtype.h"
+#include "z80core.h"
+
+#ifndef _z80jit_h
+#define _z80jit_h
+
+/*
+
+                       Z80 Block Translator Interface
+                       ==============================
+
+Interface between the C core (z80core.c) and the x86-64 block translator
+(z80jit.c).  Everything here only exists if Z80_JIT is defined (see
+z80core.h), and only the core and z80cpu.c need to use it.
+
+*/
+
+#ifdef Z80_JIT
+
+/* Translator functions (z80jit.c) */
+
+int  z80_jit_run(z80_block *z);
+void z80_jit_write(z80_block *z, UINT_16 addr);
+void z80_jit_invalidate(z80_block *z, UINT_8 page);
+void z80_jit_flush(z80_block *z);
+void z80_jit_free(z80_block *z);
+
+/* Functions provided to the translator (by z80core.c) */
+
+int  z80_jit_step(z80_block *z);
+int  z80_jit_stop(z80_block *z);
+
+#endif
+
+#endif
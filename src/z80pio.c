@@ -2394,3 +2394,77 @@ char *z80pio_getinf(module_data *what)
     return dest;
 }
 
+/*
+   Snapshot body: the z80pio_state fields in order, port A then port B.
+*/
+
+int z80pio_serialise(module_data *what, snap_data *snap)
+{
+    z80pio_state *st = (z80pio_state *) DEREF_INTERNAL(what);
+
+    snap_put8(snap,st->a_reg_output);
+    snap_put8(snap,st->a_reg_input);
+    snap_put8(snap,st->a_reg_mode);
+    snap_put8(snap,st->a_reg_intvect);
+    snap_put8(snap,st->a_reg_ioctrl);
+    snap_put8(snap,st->a_reg_intctrl);
+    snap_put8(snap,st->a_reg_maskctrl);
+    snap_put8(snap,st->a_regctrl_pending);
+    snap_put8(snap,st->a_maskctrl_pending);
+    snap_put8(snap,st->a_int_inhibit);
+    snap_put8(snap,st->a_mode02_state);
+    snap_put8(snap,st->a_mode123_state);
+    snap_put8(snap,st->a_strb_prime);
+
+    snap_put8(snap,st->b_reg_output);
+    snap_put8(snap,st->b_reg_input);
+    snap_put8(snap,st->b_reg_mode);
+    snap_put8(snap,st->b_reg_intvect);
+    snap_put8(snap,st->b_reg_ioctrl);
+    snap_put8(snap,st->b_reg_intctrl);
+    snap_put8(snap,st->b_reg_maskctrl);
+    snap_put8(snap,st->b_regctrl_pending);
+    snap_put8(snap,st->b_maskctrl_pending);
+    snap_put8(snap,st->b_int_inhibit);
+    snap_put8(snap,st->b_mode02_state);
+    snap_put8(snap,st->b_mode123_state);
+    snap_put8(snap,st->b_strb_prime);
+
+    return snap->error;
+}
+
+int z80pio_deserialise(module_data *what, snap_data *snap)
+{
+    z80pio_state *st = (z80pio_state *) DEREF_INTERNAL(what);
+
+    st->a_reg_output       = snap_get8(snap);
+    st->a_reg_input        = snap_get8(snap);
+    st->a_reg_mode         = snap_get8(snap);
+    st->a_reg_intvect      = snap_get8(snap);
+    st->a_reg_ioctrl       = snap_get8(snap);
+    st->a_reg_intctrl      = snap_get8(snap);
+    st->a_reg_maskctrl     = snap_get8(snap);
+    st->a_regctrl_pending  = snap_get8(snap);
+    st->a_maskctrl_pending = snap_get8(snap);
+    st->a_int_inhibit      = snap_get8(snap);
+    st->a_mode02_state     = snap_get8(snap);
+    st->a_mode123_state    = snap_get8(snap);
+    st->a_strb_prime       = snap_get8(snap);
+
+    st->b_reg_output       = snap_get8(snap);
+    st->b_reg_input        = snap_get8(snap);
+    st->b_reg_mode         = snap_get8(snap);
+    st->b_reg_intvect      = snap_get8(snap);
+    st->b_reg_ioctrl       = snap_get8(snap);
+    st->b_reg_intctrl      = snap_get8(snap);
+    st->b_reg_maskctrl     = snap_get8(snap);
+    st->b_regctrl_pending  = snap_get8(snap);
+    st->b_maskctrl_pending = snap_get8(snap);
+    st->b_int_inhibit      = snap_get8(snap);
+    st->b_mode02_state     = snap_get8(snap);
+    st->b_mode123_state    = snap_get8(snap);
+    st->b_strb_prime       = snap_get8(snap);
+
+    return snap->error;
+}
+
@@ -111,8 +111,15 @@ outgoing functions: outfn0 signal possible change in the external state of
 
 Module is unclocked.
 
+z80pio_serialise/z80pio_deserialise save and load the internal state of
+both ports (registers, pending control words, handshake and interupt
+state) in a snapshot section (see modules.h), version Z80PIO_SNAP_VERSION.
+The buses belong to the modules they come from, and are saved with them.
+
 */
 
+#define Z80PIO_SNAP_VERSION     1
+
 
 module_data *z80pio_alloc(const char *module_name);
 int          z80pio_init(module_data *what);
@@ -121,5 +128,7 @@ void         z80pio_stop(module_data *what);
 void         z80pio_remove(module_data *what);
 void         z80pio_cycle(module_data *what, UINT_16 num_cycles, UINT_8 clock_div, int lsync_point);
 char        *z80pio_getinf(module_data *what);
+int          z80pio_serialise(module_data *what, snap_data *snap);
+int          z80pio_deserialise(module_data *what, snap_data *snap);
 
 #endif
@@ -0,0 +1,579 @@
+/*
+
+                           Z80 Trace Decoder
+                           =================
+
+Reads a trace dump written by z80cpu_trace_dump (see z80cpu.h) and prints
+it, one line per record, oldest first:
+
+    time  PC    bytes        instruction           AF   BC   DE   HL   SP   IX   IY
+
+Usage: z80trace [-last n] tracefile
+
+-last n - only print the last n records.
+
+time is the number of T-states since reset at the start of the record, and
+the registers are as they were at the start of the record (so the effect
+of an instruction shows on the line after it).  Interupt and NMI
+acknowledges are printed as <INT> and <NMI>, followed by whatever opcode
+the interupting device supplied in IM0.  Undocumented opcodes are shown
+with the usual names (IXH, SLL and so on).  A DD or FD prefix followed by
+another prefix is shown as NOP, as the z80 ignores it.
+
+The decoder doesn't need anything else from the emulator, and works on any
+host (the dump is little-endian whatever the host).
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "u_dtype.h"
+#include "z80core.h"
+#include "z80cpu.h"
+
+
+
+#define TRACE_HEAD_SIZE         32
+#define TRACE_REC_SIZE          32
+
+/*
+   Disassembler.  Operands are taken from op[] in order, starting at pos,
+   which is how the z80 fetches them (the displacement of an indexed
+   instruction comes before any immediate operand).  idx is 0 for HL, or
+   "IX"/"IY" for DD/FD prefixed opcodes, and mem is set if the instruction
+   uses (HL)/(IX+d), in which case H and L aren't replaced by the index
+   register halves.
+*/
+
+typedef struct
+{
+    const UINT_8 *op;
+    int len;
+    int pos;
+    int bad;
+    UINT_16 pc;
+    const char *idx;
+    int mem;
+    char disp[12];
+}
+trace_dis;
+
+static const char *trace_r[8]   = { "B", "C", "D", "E", "H", "L", "(HL)", "A" };
+static const char *trace_cc[8]  = { "NZ", "Z", "NC", "C", "PO", "PE", "P", "M" };
+static const char *trace_alu[8] = { "ADD A,", "ADC A,", "SUB ", "SBC A,", "AND ", "XOR ", "OR ", "CP " };
+static const char *trace_rot[8] = { "RLC", "RRC", "RL", "RR", "SLA", "SRA", "SLL", "SRL" };
+static const char *trace_im[8]  = { "0", "0", "1", "2", "0", "0", "1", "2" };
+static const char *trace_x0z7[8] = { "RLCA", "RRCA", "RLA", "RRA", "DAA", "CPL", "SCF", "CCF" };
+static const char *trace_ed7[8] = { "LD I,A", "LD R,A", "LD A,I", "LD A,R", "RRD", "RLD", "NOP", "NOP" };
+static const char *trace_bli[4][4] =
+{
+    { "LDI",  "CPI",  "INI",  "OUTI" },
+    { "LDD",  "CPD",  "IND",  "OUTD" },
+    { "LDIR", "CPIR", "INIR", "OTIR" },
+    { "LDDR", "CPDR", "INDR", "OTDR" }
+};
+
+static UINT_8 trace_next(trace_dis *d)
+{
+    if ( d->pos >= d->len )
+    {
+        d->bad = 1;
+
+        return 0;
+    }
+
+    return d->op[d->pos++];
+}
+
+static UINT_16 trace_next16(trace_dis *d)
+{
+    UINT_16 lo;
+
+    lo = trace_next(d);
+
+    return (UINT_16) ( lo | ( ( (UINT_16) trace_next(d) ) << 8 ) );
+}
+
+/*
+   (IX+d) with the displacement, fetched the first time it is needed.
+*/
+
+static const char *trace_index_mem(trace_dis *d)
+{
+    SINT_8 disp;
+
+    if ( !d->disp[0] )
+    {
+        disp = (SINT_8) trace_next(d);
+
+        sprintf(d->disp,"(%s%c%02Xh)",d->idx,( disp < 0 ) ? '-' : '+',( disp < 0 ) ? -disp : disp);
+    }
+
+    return d->disp;
+}
+
+static const char *trace_reg8(trace_dis *d, int r)
+{
+    static char name[2][4];
+    static int which = 0;
+
+    if ( d->idx == NULL )
+    {
+        return trace_r[r];
+    }
+
+    if ( r == 6 )
+    {
+        return trace_index_mem(d);
+    }
+
+    if ( ( ( r == 4 ) || ( r == 5 ) ) && !d->mem )
+    {
+        which ^= 1;
+
+        sprintf(name[which],"%s%c",d->idx,( r == 4 ) ? 'H' : 'L');
+
+        return name[which];
+    }
+
+    return trace_r[r];
+}
+
+static const char *trace_rp(trace_dis *d, int p, int af)
+{
+    static const char *rp[4]  = { "BC", "DE", "HL", "SP" };
+    static const char *rp2[4] = { "BC", "DE", "HL", "AF" };
+
+    if ( ( p == 2 ) && ( d->idx != NULL ) )
+    {
+        return d->idx;
+    }
+
+    return af ? rp2[p] : rp[p];
+}
+
+static void trace_dis_cb(trace_dis *d, UINT_8 op, char *dest)
+{
+    int x = op >> 6;
+    int y = ( op >> 3 ) & 7;
+    int z = op & 7;
+    const char *arg;
+
+    /*
+       DDCB/FDCB: always (IX+d), which has already been fetched.  Register
+       forms also copy the result to the register.
+    */
+
+    arg = ( d->idx != NULL ) ? d->disp : trace_r[z];
+
+    switch ( x )
+    {
+        case 0:  { sprintf(dest,"%s %s",trace_rot[y],arg);   break; }
+        case 1:  { sprintf(dest,"BIT %d,%s",y,arg);          return; }
+        case 2:  { sprintf(dest,"RES %d,%s",y,arg);          break; }
+        default: { sprintf(dest,"SET %d,%s",y,arg);          break; }
+    }
+
+    if ( ( d->idx != NULL ) && ( z != 6 ) )
+    {
+        sprintf(dest+strlen(dest),",%s",trace_r[z]);
+    }
+
+    return;
+}
+
+static void trace_dis_ed(trace_dis *d, UINT_8 op, char *dest)
+{
+    int x = op >> 6;
+    int y = ( op >> 3 ) & 7;
+    int z = op & 7;
+    int p = y >> 1;
+    int q = y & 1;
+
+    d->idx = NULL;
+
+    if ( x == 1 )
+    {
+        switch ( z )
+        {
+            case 0:  { if ( y == 6 ) { sprintf(dest,"IN (C)"); } else { sprintf(dest,"IN %s,(C)",trace_r[y]); } break; }
+            case 1:  { if ( y == 6 ) { sprintf(dest,"OUT (C),0"); } else { sprintf(dest,"OUT (C),%s",trace_r[y]); } break; }
+            case 2:  { sprintf(dest,"%s HL,%s",q ? "ADC" : "SBC",trace_rp(d,p,0)); break; }
+            case 3:  { if ( q ) { sprintf(dest,"LD %s,(%04Xh)",trace_rp(d,p,0),trace_next16(d)); } else { sprintf(dest,"LD (%04Xh),%s",trace_next16(d),trace_rp(d,p,0)); } break; }
+            case 4:  { sprintf(dest,"NEG");                       break; }
+            case 5:  { sprintf(dest,( y == 1 ) ? "RETI" : "RETN"); break; }
+            case 6:  { sprintf(dest,"IM %s",trace_im[y]);         break; }
+            default: { sprintf(dest,"%s",trace_ed7[y]);           break; }
+        }
+
+        return;
+    }
+
+    if ( ( x == 2 ) && ( z <= 3 ) && ( y >= 4 ) )
+    {
+        sprintf(dest,"%s",trace_bli[y-4][z]);
+
+        return;
+    }
+
+    sprintf(dest,"NOP");
+
+    return;
+}
+
+static void trace_dis_main(trace_dis *d, UINT_8 op, char *dest)
+{
+    int x = op >> 6;
+    int y = ( op >> 3 ) & 7;
+    int z = op & 7;
+    int p = y >> 1;
+    int q = y & 1;
+    const char *a;
+    SINT_8 rel;
+
+    switch ( x )
+    {
+        case 0:
+        {
+            switch ( z )
+            {
+                case 0:
+                {
+                    if ( y == 0 ) { sprintf(dest,"NOP");       break; }
+                    if ( y == 1 ) { sprintf(dest,"EX AF,AF'"); break; }
+
+                    rel = (SINT_8) trace_next(d);
+
+                    if ( y == 2 )      { sprintf(dest,"DJNZ %04Xh",(UINT_16) ( d->pc + d->pos + rel )); }
+                    else if ( y == 3 ) { sprintf(dest,"JR %04Xh",(UINT_16) ( d->pc + d->pos + rel )); }
+                    else               { sprintf(dest,"JR %s,%04Xh",trace_cc[y-4],(UINT_16) ( d->pc + d->pos + rel )); }
+
+                    break;
+                }
+
+                case 1:
+                {
+                    if ( q ) { sprintf(dest,"ADD %s,%s",trace_rp(d,2,0),trace_rp(d,p,0)); }
+                    else     { sprintf(dest,"LD %s,%04Xh",trace_rp(d,p,0),trace_next16(d)); }
+
+                    break;
+                }
+
+                case 2:
+                {
+                    switch ( y )
+                    {
+                        case 0:  { sprintf(dest,"LD (BC),A");                                     break; }
+                        case 1:  { sprintf(dest,"LD A,(BC)");                                     break; }
+                        case 2:  { sprintf(dest,"LD (DE),A");                                     break; }
+                        case 3:  { sprintf(dest,"LD A,(DE)");                                     break; }
+                        case 4:  { sprintf(dest,"LD (%04Xh),%s",trace_next16(d),trace_rp(d,2,0)); break; }
+                        case 5:  { sprintf(dest,"LD %s,(%04Xh)",trace_rp(d,2,0),trace_next16(d)); break; }
+                        case 6:  { sprintf(dest,"LD (%04Xh),A",trace_next16(d));                  break; }
+                        default: { sprintf(dest,"LD A,(%04Xh)",trace_next16(d));                  break; }
+                    }
+
+                    break;
+                }
+
+                case 3:  { sprintf(dest,"%s %s",q ? "DEC" : "INC",trace_rp(d,p,0)); break; }
+                case 4:  { d->mem = ( y == 6 ); sprintf(dest,"INC %s",trace_reg8(d,y)); break; }
+                case 5:  { d->mem = ( y == 6 ); sprintf(dest,"DEC %s",trace_reg8(d,y)); break; }
+
+                case 6:
+                {
+                    d->mem = ( y == 6 );
+                    a = trace_reg8(d,y);
+                    sprintf(dest,"LD %s,%02Xh",a,trace_next(d));
+
+                    break;
+                }
+
+                default: { sprintf(dest,"%s",trace_x0z7[y]); break; }
+            }
+
+            break;
+        }
+
+        case 1:
+        {
+            if ( ( y == 6 ) && ( z == 6 ) )
+            {
+                sprintf(dest,"HALT");
+
+                break;
+            }
+
+            d->mem = ( y == 6 ) || ( z == 6 );
+            a = trace_reg8(d,y);
+            sprintf(dest,"LD %s,%s",a,trace_reg8(d,z));
+
+            break;
+        }
+
+        case 2:
+        {
+            d->mem = ( z == 6 );
+            sprintf(dest,"%s%s",trace_alu[y],trace_reg8(d,z));
+
+            break;
+        }
+
+        default:
+        {
+            switch ( z )
+            {
+                case 0:  { sprintf(dest,"RET %s",trace_cc[y]); break; }
+
+                case 1:
+                {
+                    if ( !q )        { sprintf(dest,"POP %s",trace_rp(d,p,1)); }
+                    else if ( p == 0 ) { sprintf(dest,"RET"); }
+                    else if ( p == 1 ) { sprintf(dest,"EXX"); }
+                    else if ( p == 2 ) { sprintf(dest,"JP (%s)",trace_rp(d,2,0)); }
+                    else             { sprintf(dest,"LD SP,%s",trace_rp(d,2,0)); }
+
+                    break;
+                }
+
+                case 2:  { sprintf(dest,"JP %s,%04Xh",trace_cc[y],trace_next16(d)); break; }
+
+                case 3:
+                {
+                    switch ( y )
+                    {
+                        case 0:  { sprintf(dest,"JP %04Xh",trace_next16(d));         break; }
+                        case 2:  { sprintf(dest,"OUT (%02Xh),A",trace_next(d));      break; }
+                        case 3:  { sprintf(dest,"IN A,(%02Xh)",trace_next(d));       break; }
+                        case 4:  { sprintf(dest,"EX (SP),%s",trace_rp(d,2,0));       break; }
+                        case 5:  { sprintf(dest,"EX DE,HL");                         break; }
+                        case 6:  { sprintf(dest,"DI");                               break; }
+                        default: { sprintf(dest,"EI");                               break; }
+                    }
+
+                    break;
+                }
+
+                case 4:  { sprintf(dest,"CALL %s,%04Xh",trace_cc[y],trace_next16(d)); break; }
+
+                case 5:
+                {
+                    if ( !q ) { sprintf(dest,"PUSH %s",trace_rp(d,p,1)); }
+                    else      { sprintf(dest,"CALL %04Xh",trace_next16(d)); }
+
+                    break;
+                }
+
+                case 6:  { sprintf(dest,"%s%02Xh",trace_alu[y],trace_next(d)); break; }
+                default: { sprintf(dest,"RST %02Xh",y*8);                       break; }
+            }
+
+            break;
+        }
+    }
+
+    return;
+}
+
+/*
+   Disassemble the len bytes at op (an instruction at pc).
+*/
+
+void trace_disassemble(const UINT_8 *op, int len, UINT_16 pc, char *dest)
+{
+    trace_dis d;
+    UINT_8 val;
+
+    memset(&d,0,sizeof(d));
+
+    d.op  = op;
+    d.len = len;
+    d.pc  = pc;
+
+    val = trace_next(&d);
+
+    if ( ( val == 0x0dd ) || ( val == 0x0fd ) )
+    {
+        d.idx = ( val == 0x0dd ) ? "IX" : "IY";
+        val   = trace_next(&d);
+
+        if ( ( val == 0x0dd ) || ( val == 0x0fd ) )
+        {
+            sprintf(dest,"NOP");
+
+            return;
+        }
+
+        if ( val == 0x0cb )
+        {
+            trace_index_mem(&d);
+            trace_dis_cb(&d,trace_next(&d),dest);
+        }
+
+        else if ( val == 0x0ed )
+        {
+            trace_dis_ed(&d,trace_next(&d),dest);
+        }
+
+        else
+        {
+            trace_dis_main(&d,val,dest);
+        }
+    }
+
+    else if ( val == 0x0cb )
+    {
+        trace_dis_cb(&d,trace_next(&d),dest);
+    }
+
+    else if ( val == 0x0ed )
+    {
+        trace_dis_ed(&d,trace_next(&d),dest);
+    }
+
+    else
+    {
+        trace_dis_main(&d,val,dest);
+    }
+
+    if ( d.bad )
+    {
+        sprintf(dest,"?");
+    }
+
+    return;
+}
+
+static UINT_64 trace_get(const UINT_8 *src, int len)
+{
+    UINT_64 val = 0;
+    int i;
+
+    for ( i = len-1 ; i >= 0 ; i-- )
+    {
+        val = ( val << 8 ) | src[i];
+    }
+
+    return val;
+}
+
+int main(int argc, char *argv[])
+{
+    UINT_8 head[TRACE_HEAD_SIZE];
+    UINT_8 rec[TRACE_REC_SIZE];
+    char bytes[16];
+    char text[40];
+    unsigned long last = 0;
+    UINT_32 rec_size;
+    UINT_32 num;
+    UINT_32 i;
+    UINT_16 pc;
+    FILE *fp;
+    int len;
+    int j;
+
+    if ( ( argc > 2 ) && !strcmp(argv[1],"-last") )
+    {
+        last = strtoul(argv[2],NULL,10);
+
+        argc -= 2;
+        argv += 2;
+    }
+
+    if ( argc != 2 )
+    {
+        printf("Usage: z80trace [-last n] tracefile\n");
+
+        return 1;
+    }
+
+    if ( ( fp = fopen(argv[1],"rb") ) == NULL )
+    {
+        printf("Unable to open %s.\n",argv[1]);
+
+        return 1;
+    }
+
+    if ( ( fread(head,1,TRACE_HEAD_SIZE,fp) != TRACE_HEAD_SIZE ) || memcmp(head,Z80CPU_TRACE_MAGIC,8) )
+    {
+        printf("%s is not a z80 trace.\n",argv[1]);
+
+        return 1;
+    }
+
+    rec_size = (UINT_32) trace_get(head+12,4);
+    num      = (UINT_32) trace_get(head+16,4);
+
+    if ( ( trace_get(head+8,4) != Z80CPU_TRACE_VERSION ) || ( rec_size < TRACE_REC_SIZE ) )
+    {
+        printf("%s is from a different version of the emulator.\n",argv[1]);
+
+        return 1;
+    }
+
+    printf("%lu records (of %lu written)\n",(unsigned long) num,(unsigned long) trace_get(head+20,8));
+    printf("          time  PC    bytes        instruction           AF   BC   DE   HL   SP   IX   IY\n");
+
+    for ( i = 0 ; i < num ; i++ )
+    {
+        if ( fread(rec,1,TRACE_REC_SIZE,fp) != TRACE_REC_SIZE )
+        {
+            printf("Trace is truncated.\n");
+
+            return 1;
+        }
+
+        if ( rec_size > TRACE_REC_SIZE )
+        {
+            fseek(fp,rec_size-TRACE_REC_SIZE,SEEK_CUR);
+        }
+
+        if ( last && ( num - i > last ) )
+        {
+            continue;
+        }
+
+        pc  = (UINT_16) trace_get(rec+8,2);
+        len = ( rec[28] > 4 ) ? 4 : rec[28];
+
+        bytes[0] = '\0';
+
+        for ( j = 0 ; j < len ; j++ )
+        {
+            sprintf(bytes+strlen(bytes),"%02X ",rec[24+j]);
+        }
+
+        if ( len )
+        {
+            trace_disassemble(rec+24,len,pc,text);
+        }
+
+        else
+        {
+            text[0] = '\0';
+        }
+
+        if ( rec[29] == Z80_TRACE_INT )
+        {
+            memmove(text+6,text,strlen(text)+1);
+            memcpy(text,"<INT> ",6);
+        }
+
+        else if ( rec[29] == Z80_TRACE_NMI )
+        {
+            sprintf(text,"<NMI>");
+        }
+
+        printf("%14lu  %04X  %-12s %-21s %04X %04X %04X %04X %04X %04X %04X\n",
+               (unsigned long) trace_get(rec,8),pc,bytes,text,
+               (unsigned int) trace_get(rec+10,2),(unsigned int) trace_get(rec+12,2),
+               (unsigned int) trace_get(rec+14,2),(unsigned int) trace_get(rec+16,2),
+               (unsigned int) trace_get(rec+18,2),(unsigned int) trace_get(rec+20,2),
+               (unsigned int) trace_get(rec+22,2));
+    }
+
+    fclose(fp);
+
+    return 0;
+}
@@ -0,0 +1,492 @@
+/*
+
+                     Z80 Core Conformance Runner
+                     ===========================
+
+Runs a CP/M instruction exerciser (ZEXDOC, ZEXALL or anything else written
+the same way) on the z80 core, headless, and reports each test group as it
+finishes.  Only the z80cpu module and a flat 64K memmod are set up, with a
+minimal CP/M around them, so it builds and runs anywhere the core does
+(there is no video, keyboard or allegro).
+
+The exercisers aren't part of the emulator and have to be got separately.
+So far the runner itself has only been checked with a small hand made
+program that prints a passing and a failing group; no ZEXDOC or ZEXALL
+results have been recorded for this core, with or without the decode
+cache, Z80_JIT or Z80_NO_BULK.
+
+Usage: z80zex [-nodcache] [-quiet] [-max tstates] comfile
+
+-nodcache   - run with the pre-decoded instruction cache off (it is on by
+              default, as in the emulator).
+-quiet      - only print the test group results and summary, not
+              everything the program prints.
+-max tstates - give up after this many T-states (default 0, no limit).
+comfile     - the CP/M program, loaded at 0100h.
+
+CP/M is emulated by ZEX_BDOS (a few bytes near the top of memory) and
+the io port handler zex_io_write:
+
+   0000  OUT (ZEX_PORT_BOOT),A  cold boot the first time (the cpu starts
+                               here after reset), warm boot - the program
+                               has finished - after that.
+   0002  JP ZEX_ORG             start the program.
+   0005  JP ZEX_BDOS           BDOS entry (0006 also gives the top of the
+                               TPA, which the exercisers use to set SP).
+   ZEX_BDOS:
+         LD A,E / OUT (ZEX_PORT_E),A
+         LD A,D / OUT (ZEX_PORT_D),A
+         LD A,C / OUT (ZEX_PORT_FN),A
+         RET
+
+Writing the function number to ZEX_PORT_FN carries it out, using the DE
+written just before: function 2 prints the character in E and function 9
+the string at DE (up to a '$').  Anything else is ignored, as is all io
+that isn't to these ports.  Only io is used, never the core's registers,
+so this works with any core.
+
+Output is collected a line at a time.  A line ending in "OK" is a test
+group that passed and a line with "ERROR" in it one that failed (which
+is how the exercisers report).  For each of these z80zex prints PASS or
+FAIL, the group name and the emulated MHz (T-states per host second) and
+host nanoseconds per step while the group ran (a step is one call to
+z80_cycle, which is one instruction apart from bulk runs of block
+instructions and translated code - see z80bench.c).  At the end it
+prints the totals.
+
+The exit status is 0 if at least one group was run, none failed and the
+program finished (by warm boot) within the T-state limit, and 1
+otherwise.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "u_dtype.h"
+#include "modules.h"
+#include "debmaloc.h"
+#include "genmod.h"
+#include "z80cpu.h"
+#include "z80core.h"
+
+
+
+#define ZEX_SLICE               0x01000
+#define ZEX_ORG                 0x00100
+#define ZEX_BDOS                0x0fe00
+#define ZEX_PORT_FN             0x000
+#define ZEX_PORT_E              0x001
+#define ZEX_PORT_D              0x002
+#define ZEX_PORT_BOOT           0x0ff
+#define ZEX_LINE                256
+
+/*
+   CP/M page zero and BDOS stub (see above).
+*/
+
+UINT_8 zex_page_zero[] = {
+    0x0d3, ZEX_PORT_BOOT,                   /* 0000 OUT  (BOOT),A   */
+    0x0c3, ( ZEX_ORG & 0x0ff ),             /* 0002 JP   ORG        */
+    ( ZEX_ORG >> 8 ),
+    0x0c3, 0x000, ( ZEX_BDOS >> 8 )         /* 0005 JP   BDOS       */
+};
+
+UINT_8 zex_bdos[] = {
+    0x07b,                                  /* LD   A,E             */
+    0x0d3, ZEX_PORT_E,                      /* OUT  (E),A           */
+    0x07a,                                  /* LD   A,D             */
+    0x0d3, ZEX_PORT_D,                      /* OUT  (D),A           */
+    0x079,                                  /* LD   A,C             */
+    0x0d3, ZEX_PORT_FN,                     /* OUT  (FN),A          */
+    0x0c9                                   /* RET                  */
+};
+
+/*
+   State of the run.
+
+   zex_cpu, zex_ram: the cpu and memory modules.
+   zex_mem: the memory itself.
+   zex_de: DE as last written to ZEX_PORT_E and ZEX_PORT_D.
+   zex_boots: number of times 0000h has been run.
+   zex_done: set once the program warm boots.
+   zex_quiet: set to only print the results.
+   zex_line, zex_line_len: the line of output being collected.
+   zex_pass, zex_fail: number of test groups that passed and failed.
+   zex_tstates, zex_steps: totals so far.
+   zex_group_*: where the current group started.
+*/
+
+module_data *zex_cpu = NULL;
+module_data *zex_ram = NULL;
+UINT_8      *zex_mem = NULL;
+
+UINT_8  zex_tab_start = 0x000;
+UINT_8  zex_tab_end   = 0x0ff;
+UINT_16 zex_tab_wait  = 0;
+
+UINT_16 zex_de    = 0;
+int     zex_boots = 0;
+int     zex_done  = 0;
+int     zex_quiet = 0;
+
+char zex_line[ZEX_LINE];
+int  zex_line_len = 0;
+
+int     zex_pass           = 0;
+int     zex_fail           = 0;
+double  zex_tstates        = 0;
+double  zex_steps          = 0;
+double  zex_group_tstates  = 0;
+double  zex_group_steps    = 0;
+clock_t zex_group_start;
+
+void zex_io_write(void *what);
+void zex_io_read(void *what);
+void zex_putc(char ch);
+void zex_end_line(void);
+
+/*
+   Output.  Characters are echoed (unless -quiet) and collected into lines,
+   and each complete line is checked for a test group result.
+*/
+
+void zex_putc(char ch)
+{
+    if ( !zex_quiet )
+    {
+        putchar(ch);
+    }
+
+    if ( ch == '\n' )
+    {
+        zex_end_line();
+    }
+
+    else if ( ( ch != '\r' ) && ( zex_line_len < ZEX_LINE-1 ) )
+    {
+        zex_line[zex_line_len++] = ch;
+    }
+
+    return;
+}
+
+void zex_end_line(void)
+{
+    double secs;
+    double tstates;
+    double steps;
+    int len;
+    int pass;
+
+    zex_line[zex_line_len] = '\0';
+
+    for ( len = zex_line_len ; ( len > 0 ) && ( zex_line[len-1] == ' ' ) ; len-- ) ;
+
+    zex_line_len = 0;
+
+    if ( ( len >= 2 ) && !strncmp(zex_line+len-2,"OK",2) )
+    {
+        pass = 1;
+    }
+
+    else if ( strstr(zex_line,"ERROR") != NULL )
+    {
+        pass = 0;
+    }
+
+    else
+    {
+        return;
+    }
+
+    secs    = ( (double) ( clock() - zex_group_start ) ) / CLOCKS_PER_SEC;
+    tstates = zex_tstates - zex_group_tstates;
+    steps   = zex_steps   - zex_group_steps;
+
+    if ( secs <= 0 )
+    {
+        secs = 1.0 / CLOCKS_PER_SEC;
+    }
+
+    /*
+       The group name is whatever comes before the dots.
+    */
+
+    zex_line[strcspn(zex_line,".")] = '\0';
+
+    printf("%s %-40.40s %9.2f MHz %8.2f ns/step\n",pass ? "PASS" : "FAIL",zex_line,
+           tstates/secs/1000000.0,steps ? secs*1000000000.0/steps : 0.0);
+    fflush(stdout);
+
+    if ( pass ) { zex_pass++; }
+    else        { zex_fail++; }
+
+    zex_group_tstates = zex_tstates;
+    zex_group_steps   = zex_steps;
+    zex_group_start   = clock();
+
+    return;
+}
+
+/*
+   io handlers (cpu outfn9 and outfn10).
+*/
+
+void zex_io_write(void *what)
+{
+    UINT_16 addr;
+
+    switch ( DEREF_16BUS(what,0) & 0x0ff )
+    {
+        case ZEX_PORT_E:
+        {
+            zex_de = (UINT_16) ( ( zex_de & 0x0ff00 ) | DEREF_8BUS(what,2) );
+
+            break;
+        }
+
+        case ZEX_PORT_D:
+        {
+            zex_de = (UINT_16) ( ( zex_de & 0x000ff ) | ( DEREF_8BUS(what,2) << 8 ) );
+
+            break;
+        }
+
+        case ZEX_PORT_FN:
+        {
+            if ( DEREF_8BUS(what,2) == 2 )
+            {
+                zex_putc((char) ( zex_de & 0x0ff ));
+            }
+
+            else if ( DEREF_8BUS(what,2) == 9 )
+            {
+                for ( addr = zex_de ; zex_mem[addr] != '$' ; addr++ )
+                {
+                    zex_putc((char) zex_mem[addr]);
+
+                    if ( addr == 0x0ffff )
+                    {
+                        break;
+                    }
+                }
+            }
+
+            break;
+        }
+
+        case ZEX_PORT_BOOT:
+        {
+            if ( zex_boots++ )
+            {
+                zex_done = 1;
+
+                (DEREF_INFN(what,26))(what);
+            }
+
+            break;
+        }
+
+        default:
+        {
+            break;
+        }
+    }
+
+    return;
+}
+
+void zex_io_read(void *what)
+{
+    DEREF_8BUS(what,2) = 0x0ff;
+
+    return;
+}
+
+int main(int argc, char *argv[])
+{
+    z80_block *block;
+    FILE *comfile;
+    double tstates_max = 0;
+    double host_secs;
+    clock_t start;
+    int dcache_on = 1;
+
+    while ( ( argc > 1 ) && ( argv[1][0] == '-' ) )
+    {
+        if ( !strcmp(argv[1],"-nodcache") )
+        {
+            dcache_on = 0;
+        }
+
+        else if ( !strcmp(argv[1],"-quiet") )
+        {
+            zex_quiet = 1;
+        }
+
+        else if ( !strcmp(argv[1],"-max") && ( argc > 2 ) )
+        {
+            tstates_max = atof(argv[2]);
+
+            argc--;
+            argv++;
+        }
+
+        else
+        {
+            break;
+        }
+
+        argc--;
+        argv++;
+    }
+
+    if ( argc != 2 )
+    {
+        printf("Usage: z80zex [-nodcache] [-quiet] [-max tstates] comfile\n");
+
+        return 1;
+    }
+
+    /*
+       Memory: a flat 64K of RAM, all directly mapped.
+    */
+
+    if ( ( zex_ram = memmod_alloc("zex_ram") ) == NULL )
+    {
+        printf("Unable to allocate memory.\n");
+
+        return 1;
+    }
+
+    DEBDEREF((zex_ram->var_32bit),0) = 0x0ffff;
+    DEBDEREF((zex_ram->var_32bit),1) = 0x0ffff;
+
+    if ( memmod_init(zex_ram) )
+    {
+        printf("Unable to initialise memory.\n");
+
+        return 1;
+    }
+
+    memmod_go(zex_ram);
+
+    zex_mem = DEBDEREF((zex_ram->bus_8bit),2);
+
+    if ( ( comfile = fopen(argv[1],"rb") ) == NULL )
+    {
+        printf("Unable to open %s.\n",argv[1]);
+
+        return 1;
+    }
+
+    fread(zex_mem+ZEX_ORG,1,ZEX_BDOS-ZEX_ORG,comfile);
+    fclose(comfile);
+
+    memcpy(zex_mem,zex_page_zero,sizeof(zex_page_zero));
+    memcpy(zex_mem+ZEX_BDOS,zex_bdos,sizeof(zex_bdos));
+
+    /*
+       The cpu, which starts from reset at 0000h.
+    */
+
+    if ( ( zex_cpu = z80cpu_alloc("z80zex") ) == NULL )
+    {
+        printf("Unable to allocate cpu.\n");
+
+        return 1;
+    }
+
+    if ( z80cpu_init(zex_cpu) )
+    {
+        printf("Unable to initialise cpu.\n");
+
+        return 1;
+    }
+
+    DEREF_8MEM(zex_cpu,3)  = &zex_tab_start;
+    DEREF_8MEM(zex_cpu,4)  = &zex_tab_end;
+    DEREF_8MEM(zex_cpu,5)  = zex_mem;
+    DEREF_16MEM(zex_cpu,1) = &zex_tab_wait;
+    DEREF_16MEM(zex_cpu,2) = &zex_tab_wait;
+
+    DEBDEREF((zex_cpu->sig_calls_outof_module),9)  = zex_io_write;
+    DEBDEREF((zex_cpu->sig_calls_outof_module),10) = zex_io_read;
+    DEBDEREF((zex_cpu->sig_calls_outof_args),9)    = (void *) zex_cpu;
+    DEBDEREF((zex_cpu->sig_calls_outof_args),10)   = (void *) zex_cpu;
+
+    z80cpu_go(zex_cpu);
+
+    (DEREF_INFN(zex_cpu,7))((void *) zex_cpu);
+    (DEREF_INFN(zex_cpu,10))((void *) zex_cpu);
+    (DEREF_INFN(zex_cpu,13))((void *) zex_cpu);
+
+    if ( dcache_on ) { (DEREF_INFN(zex_cpu,24))((void *) zex_cpu); }
+    else             { (DEREF_INFN(zex_cpu,25))((void *) zex_cpu); }
+
+    block = (z80_block *) DEREF_INTERNAL(zex_cpu);
+
+    /*
+       Run a slice at a time (as z80bench does, counting steps) until the
+       program warm boots or the limit is reached.
+    */
+
+    start = clock();
+
+    zex_group_start = start;
+
+    while ( !zex_done && ( ( tstates_max <= 0 ) || ( zex_tstates < tstates_max ) ) )
+    {
+        block->clk_count += ZEX_SLICE;
+        block->end_run    = 0;
+
+        while ( block->clk_count > Z80_CLK_COUNT_BASE )
+        {
+            z80_cycle((void *) block);
+
+            zex_steps   += 1;
+            zex_tstates += block->clk;
+
+            block->clk_count -= block->clk;
+            block->clk        = 0;
+
+            if ( block->end_run )
+            {
+                break;
+            }
+        }
+    }
+
+    host_secs = ( (double) ( clock() - start ) ) / CLOCKS_PER_SEC;
+
+    if ( host_secs <= 0 )
+    {
+        host_secs = 1.0 / CLOCKS_PER_SEC;
+    }
+
+    if ( zex_line_len )
+    {
+        zex_putc('\n');
+    }
+
+    printf("\n");
+    printf("Decode cache:    %s\n",dcache_on ? "on" : "off");
+    printf("Groups passed:   %d\n",zex_pass);
+    printf("Groups failed:   %d\n",zex_fail);
+    printf("Finished:        %s\n",zex_done ? "yes" : "no (T-state limit reached)");
+    printf("T-states:        %.0f\n",zex_tstates);
+    printf("Steps:           %.0f\n",zex_steps);
+    printf("Host seconds:    %.3f\n",host_secs);
+    printf("Emulated MHz:    %.2f\n",zex_tstates/host_secs/1000000.0);
+    printf("Host ns/step:    %.2f\n",host_secs*1000000000.0/zex_steps);
+
+    z80cpu_stop(zex_cpu);
+    z80cpu_remove(zex_cpu);
+
+    memmod_stop(zex_ram);
+    memmod_remove(zex_ram);
+
+    return ( zex_done && zex_pass && !zex_fail ) ? 0 : 1;
+}